@@ -0,0 +1,392 @@
+/**
+ * @file tls_bench_transport.c
+ * @brief In-memory transport shared by the benchmarks
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Dependencies
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "tls.h"
+#include "tls_bench_transport.h"
+
+
+/**
+ * @brief Initialize an in-memory link
+ * @param[in] link Pointer to the link
+ * @param[in] datagram Datagram semantics (DTLS) or byte stream (TLS)
+ **/
+
+void tlsBenchInitLink(TlsBenchLink *link, bool_t datagram)
+{
+   //Both directions are initially empty
+   memset(link, 0, sizeof(TlsBenchLink));
+
+   //Set the semantics of the link
+   link->clientToServer.datagram = datagram;
+   link->serverToClient.datagram = datagram;
+
+   //The client writes to the first direction and reads from the second one
+   link->client.tx = &link->clientToServer;
+   link->client.rx = &link->serverToClient;
+
+   //The server does the opposite
+   link->server.tx = &link->serverToClient;
+   link->server.rx = &link->clientToServer;
+}
+
+
+/**
+ * @brief Send callback of an in-memory link
+ * @param[in] handle Endpoint of the link
+ * @param[in] data Pointer to the data to be written
+ * @param[in] length Number of bytes to write
+ * @param[out] written Number of bytes that have been written
+ * @param[in] flags Unused parameter
+ * @return Error code
+ **/
+
+error_t tlsBenchSend(TlsSocketHandle handle, const void *data,
+   size_t length, size_t *written, uint_t flags)
+{
+   size_t n;
+   uint_t i;
+   TlsBenchPipe *pipe;
+
+   //Point to the direction the endpoint writes to
+   pipe = ((TlsBenchEndpoint *) handle)->tx;
+
+   //Move the unread bytes to the beginning of the buffer
+   if(pipe->start > 0 && (TLS_BENCH_PIPE_SIZE - pipe->end) < length)
+   {
+      memmove(pipe->data, pipe->data + pipe->start, pipe->end - pipe->start);
+      pipe->end -= pipe->start;
+      pipe->start = 0;
+   }
+
+   //Number of bytes that can be written
+   n = MIN(length, TLS_BENCH_PIPE_SIZE - pipe->end);
+
+   //Datagram link?
+   if(pipe->datagram)
+   {
+      //Datagrams are never truncated
+      if(n < length || pipe->dgramCount >= TLS_BENCH_MAX_DATAGRAMS)
+         return ERROR_WOULD_BLOCK;
+
+      //Queue the datagram
+      i = (pipe->dgramHead + pipe->dgramCount) % TLS_BENCH_MAX_DATAGRAMS;
+      pipe->dgramLen[i] = n;
+      pipe->dgramCount++;
+   }
+
+   //The buffer is full?
+   if(n == 0 && length > 0)
+      return ERROR_WOULD_BLOCK;
+
+   //Copy the data
+   memcpy(pipe->data + pipe->end, data, n);
+   pipe->end += n;
+
+   //Number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Receive callback of an in-memory link
+ * @param[in] handle Endpoint of the link
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Unused parameter
+ * @return Error code
+ **/
+
+error_t tlsBenchReceive(TlsSocketHandle handle, void *data,
+   size_t size, size_t *received, uint_t flags)
+{
+   size_t n;
+   size_t length;
+   TlsBenchPipe *pipe;
+
+   //Point to the direction the endpoint reads from
+   pipe = ((TlsBenchEndpoint *) handle)->rx;
+
+   //No data available?
+   if(pipe->start >= pipe->end)
+      return ERROR_WOULD_BLOCK;
+
+   //Datagram link?
+   if(pipe->datagram)
+   {
+      //Retrieve the length of the oldest datagram
+      length = pipe->dgramLen[pipe->dgramHead];
+
+      //Dequeue the datagram
+      pipe->dgramHead = (pipe->dgramHead + 1) % TLS_BENCH_MAX_DATAGRAMS;
+      pipe->dgramCount--;
+
+      //The part of the datagram that does not fit in the buffer is lost
+      n = MIN(length, size);
+   }
+   else
+   {
+      //Read as many bytes as possible
+      length = MIN(size, pipe->end - pipe->start);
+      n = length;
+   }
+
+   //Copy the data
+   memcpy(data, pipe->data + pipe->start, n);
+   pipe->start += length;
+
+   //Rewind the buffer once all the data has been read
+   if(pipe->start == pipe->end)
+   {
+      pipe->start = 0;
+      pipe->end = 0;
+   }
+
+   //Number of bytes that have been received
+   *received = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Attach a client and a server to an in-memory link
+ * @param[in] link Pointer to the link
+ * @param[in] client Client context
+ * @param[in] server Server context
+ * @return Error code
+ **/
+
+error_t tlsBenchAttach(TlsBenchLink *link, TlsContext *client,
+   TlsContext *server)
+{
+   error_t error;
+
+   //Set the socket callbacks of the client
+   error = tlsSetSocketCallbacks(client, tlsBenchSend, tlsBenchReceive,
+      (TlsSocketHandle) &link->client);
+
+   //Check status code
+   if(!error)
+   {
+      //Set the socket callbacks of the server
+      error = tlsSetSocketCallbacks(server, tlsBenchSend, tlsBenchReceive,
+         (TlsSocketHandle) &link->server);
+   }
+
+#if (DTLS_SUPPORT == ENABLED)
+   //Datagram link?
+   if(!error && link->clientToServer.datagram)
+   {
+      //The link has no MTU, so that records are never fragmented
+      error = tlsSetPmtu(client, TLS_BENCH_PIPE_SIZE / 2);
+
+      //Check status code
+      if(!error)
+         error = tlsSetPmtu(server, TLS_BENCH_PIPE_SIZE / 2);
+   }
+#endif
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Run the handshake between a client and a server
+ *
+ * Both ends are driven alternately from the calling thread until the
+ * handshake completes on each side
+ *
+ * @param[in] client Client context
+ * @param[in] server Server context
+ * @return Error code
+ **/
+
+error_t tlsBenchHandshake(TlsContext *client, TlsContext *server)
+{
+   uint_t i;
+   error_t clientError;
+   error_t serverError;
+
+   //Initialize status codes
+   clientError = ERROR_WOULD_BLOCK;
+   serverError = ERROR_WOULD_BLOCK;
+
+   //Each round lets both ends progress as far as possible
+   for(i = 0; i < TLS_BENCH_MAX_ROUNDS; i++)
+   {
+      //Client side
+      if(clientError != NO_ERROR)
+         clientError = tlsConnect(client);
+
+      //Server side
+      if(serverError != NO_ERROR)
+         serverError = tlsConnect(server);
+
+      //The handshake has completed on both sides?
+      if(clientError == NO_ERROR && serverError == NO_ERROR)
+         return NO_ERROR;
+
+      //The handshake has failed on the client side?
+      if(clientError != NO_ERROR && clientError != ERROR_WOULD_BLOCK &&
+         clientError != ERROR_TIMEOUT)
+      {
+         return clientError;
+      }
+
+      //The handshake has failed on the server side?
+      if(serverError != NO_ERROR && serverError != ERROR_WOULD_BLOCK &&
+         serverError != ERROR_TIMEOUT)
+      {
+         return serverError;
+      }
+   }
+
+   //The handshake does not make any progress
+   return ERROR_TIMEOUT;
+}
+
+
+/**
+ * @brief Certificate verification callback that accepts any certificate
+ *
+ * Used when no trusted CA list is supplied, so that the benchmarks can run
+ * with a self-signed certificate
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] certInfo Certificate to be verified
+ * @param[in] pathLen Certificate path length
+ * @param[in] param Unused parameter
+ * @return Error code
+ **/
+
+error_t tlsBenchAcceptCertificate(TlsContext *context,
+   const X509CertificateInfo *certInfo, uint_t pathLen, void *param)
+{
+   //The certificate is accepted
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Load the contents of a file
+ * @param[in] path Path to the file
+ * @param[out] buffer NULL-terminated contents of the file
+ * @param[out] length Length of the file, in bytes
+ * @return Error code
+ **/
+
+error_t tlsBenchLoadFile(const char_t *path, char_t **buffer,
+   size_t *length)
+{
+   error_t error;
+   long n;
+   FILE *fp;
+
+   //Open the file
+   fp = fopen(path, "rb");
+   //Failed to open the file?
+   if(fp == NULL)
+      return ERROR_OPEN_FAILED;
+
+   //Retrieve the length of the file
+   if(fseek(fp, 0, SEEK_END) == 0 && (n = ftell(fp)) >= 0 &&
+      fseek(fp, 0, SEEK_SET) == 0)
+   {
+      //Allocate a buffer to hold the contents of the file
+      *buffer = tlsAllocMem(n + 1);
+
+      //Successful memory allocation?
+      if(*buffer != NULL)
+      {
+         //Read the contents of the file
+         if(fread(*buffer, 1, n, fp) == (size_t) n)
+         {
+            //Properly terminate the string
+            (*buffer)[n] = '\0';
+            *length = n;
+
+            //Successful processing
+            error = NO_ERROR;
+         }
+         else
+         {
+            //Release the buffer
+            tlsFreeMem(*buffer);
+            *buffer = NULL;
+
+            //Report an error
+            error = ERROR_READ_FAILED;
+         }
+      }
+      else
+      {
+         //Failed to allocate memory
+         error = ERROR_OUT_OF_MEMORY;
+      }
+   }
+   else
+   {
+      //Report an error
+      error = ERROR_READ_FAILED;
+   }
+
+   //Close the file
+   fclose(fp);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the value of a monotonic clock
+ * @return Current time, in nanoseconds
+ **/
+
+uint64_t tlsBenchGetTime(void)
+{
+   struct timespec ts;
+
+   //The benchmarks run on a POSIX host
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   //Convert the time to nanoseconds
+   return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file tls_bench_transport.h
+ * @brief In-memory transport shared by the benchmarks
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_BENCH_TRANSPORT_H
+#define _TLS_BENCH_TRANSPORT_H
+
+//Dependencies
+#include "tls.h"
+
+//Size of the buffer of each direction of a link
+#ifndef TLS_BENCH_PIPE_SIZE
+   #define TLS_BENCH_PIPE_SIZE 65536
+#elif (TLS_BENCH_PIPE_SIZE < 20480)
+   #error TLS_BENCH_PIPE_SIZE parameter is not valid
+#endif
+
+//Maximum number of datagrams queued in each direction of a link
+#ifndef TLS_BENCH_MAX_DATAGRAMS
+   #define TLS_BENCH_MAX_DATAGRAMS 64
+#elif (TLS_BENCH_MAX_DATAGRAMS < 1)
+   #error TLS_BENCH_MAX_DATAGRAMS parameter is not valid
+#endif
+
+//Maximum number of handshake rounds without progress
+#ifndef TLS_BENCH_MAX_ROUNDS
+   #define TLS_BENCH_MAX_ROUNDS 64
+#elif (TLS_BENCH_MAX_ROUNDS < 1)
+   #error TLS_BENCH_MAX_ROUNDS parameter is not valid
+#endif
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief One direction of an in-memory link
+ **/
+
+typedef struct
+{
+   bool_t datagram;                              ///<Datagram semantics (DTLS)
+   uint8_t data[TLS_BENCH_PIPE_SIZE];            ///<Bytes written and not yet read
+   size_t start;                                 ///<Offset of the first unread byte
+   size_t end;                                   ///<Offset following the last written byte
+   size_t dgramLen[TLS_BENCH_MAX_DATAGRAMS];     ///<Length of the queued datagrams
+   uint_t dgramHead;                             ///<Index of the oldest queued datagram
+   uint_t dgramCount;                            ///<Number of queued datagrams
+} TlsBenchPipe;
+
+
+/**
+ * @brief Endpoint of an in-memory link (socket handle)
+ **/
+
+typedef struct
+{
+   TlsBenchPipe *tx; ///<Direction the endpoint writes to
+   TlsBenchPipe *rx; ///<Direction the endpoint reads from
+} TlsBenchEndpoint;
+
+
+/**
+ * @brief In-memory link joining a client and a server
+ **/
+
+typedef struct
+{
+   TlsBenchPipe clientToServer; ///<Records sent by the client
+   TlsBenchPipe serverToClient; ///<Records sent by the server
+   TlsBenchEndpoint client;     ///<Socket handle of the client
+   TlsBenchEndpoint server;     ///<Socket handle of the server
+} TlsBenchLink;
+
+
+//Benchmark transport related functions
+void tlsBenchInitLink(TlsBenchLink *link, bool_t datagram);
+
+error_t tlsBenchSend(TlsSocketHandle handle, const void *data,
+   size_t length, size_t *written, uint_t flags);
+
+error_t tlsBenchReceive(TlsSocketHandle handle, void *data,
+   size_t size, size_t *received, uint_t flags);
+
+error_t tlsBenchAttach(TlsBenchLink *link, TlsContext *client,
+   TlsContext *server);
+
+error_t tlsBenchHandshake(TlsContext *client, TlsContext *server);
+
+error_t tlsBenchAcceptCertificate(TlsContext *context,
+   const X509CertificateInfo *certInfo, uint_t pathLen, void *param);
+
+error_t tlsBenchLoadFile(const char_t *path, char_t **buffer,
+   size_t *length);
+
+uint64_t tlsBenchGetTime(void);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
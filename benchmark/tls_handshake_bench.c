@@ -0,0 +1,831 @@
+/**
+ * @file tls_handshake_bench.c
+ * @brief Multi-threaded handshake benchmark
+ *
+ * Each thread connects a client and a server over its own in-memory link,
+ * over and over, and the latency of every handshake is recorded. The
+ * following modes are measured, as enabled in the build:
+ *
+ * - full: full handshake (TLS 1.2, and TLS 1.3 with each key exchange group)
+ * - session-id: TLS 1.2 session resumption through a shared TlsCache
+ * - ticket: resumption with tickets protected by tlsEncryptTicket() and
+ *   tlsDecryptTicket() under a shared TlsTicketContext
+ * - psk: TLS 1.3 handshake with an external PSK
+ * - 0-rtt: TLS 1.3 ticket resumption carrying early data
+ *
+ * Every mode is run with 1, 2, 4... threads up to the requested number, so
+ * that the contention on the shared cache and ticket mutexes shows up as
+ * the thread count increases. One CSV line is printed per mode and thread
+ * count:
+ *
+ * mode,protocol,group,threads,handshakes,handshakes_per_s,p50_us,p90_us,p99_us
+ *
+ * Usage: tls_handshake_bench [-t threads] [-n count] <cert.pem> <key.pem>
+ *   [<ca.pem>]
+ *
+ * The key type of the server is the one of the supplied certificate, so the
+ * program is run once per certificate (RSA-2048, RSA-3072, ECDSA P-256,
+ * ECDSA P-384, Ed25519). It is linked against CycloneSSL and CycloneCRYPTO,
+ * and runs on a POSIX host.
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Dependencies
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tls.h"
+#include "tls_cache.h"
+#include "tls_ticket.h"
+#include "rng/yarrow.h"
+#include "tls_bench_transport.h"
+
+//Default number of handshakes per thread
+#ifndef TLS_BENCH_DEFAULT_COUNT
+   #define TLS_BENCH_DEFAULT_COUNT 200
+#elif (TLS_BENCH_DEFAULT_COUNT < 1)
+   #error TLS_BENCH_DEFAULT_COUNT parameter is not valid
+#endif
+
+//Default maximum number of threads
+#ifndef TLS_BENCH_DEFAULT_THREADS
+   #define TLS_BENCH_DEFAULT_THREADS 8
+#elif (TLS_BENCH_DEFAULT_THREADS < 1)
+   #error TLS_BENCH_DEFAULT_THREADS parameter is not valid
+#endif
+
+//Number of entries of the shared session cache
+#ifndef TLS_BENCH_CACHE_SIZE
+   #define TLS_BENCH_CACHE_SIZE 1024
+#elif (TLS_BENCH_CACHE_SIZE < 1)
+   #error TLS_BENCH_CACHE_SIZE parameter is not valid
+#endif
+
+//Amount of early data sent in 0-RTT mode
+#define TLS_BENCH_EARLY_DATA_SIZE 512
+
+
+/**
+ * @brief Handshake modes
+ **/
+
+typedef enum
+{
+   TLS_BENCH_MODE_FULL       = 0,
+   TLS_BENCH_MODE_SESSION_ID = 1,
+   TLS_BENCH_MODE_TICKET     = 2,
+   TLS_BENCH_MODE_PSK        = 3,
+   TLS_BENCH_MODE_EARLY_DATA = 4
+} TlsBenchMode;
+
+
+/**
+ * @brief Handshake scenario
+ **/
+
+typedef struct
+{
+   const char_t *name;      ///<Name of the mode reported in the results
+   TlsBenchMode mode;       ///<Handshake mode
+   uint16_t version;        ///<TLS protocol version
+   const char_t *groupName; ///<Name of the key exchange group
+   uint16_t group;          ///<Key exchange group (0 for the default groups)
+} TlsBenchScenario;
+
+
+/**
+ * @brief Benchmark thread
+ **/
+
+typedef struct
+{
+   pthread_t thread;                   ///<Thread handle
+   const TlsBenchScenario *scenario;   ///<Scenario run by the thread
+   uint_t count;                       ///<Number of handshakes to perform
+   uint64_t *latencies;                ///<Handshake latencies, in nanoseconds
+   uint64_t start;                     ///<Time at which the measurement started
+   uint64_t end;                       ///<Time at which the measurement ended
+   TlsBenchLink *link;                 ///<In-memory link of the thread
+   error_t error;                      ///<Status code
+} TlsBenchWorker;
+
+
+//Scenarios enabled in the build
+const TlsBenchScenario tlsBenchScenarios[] =
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   {"full", TLS_BENCH_MODE_FULL, TLS_VERSION_1_2, "default", 0},
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   {"session-id", TLS_BENCH_MODE_SESSION_ID, TLS_VERSION_1_2, "default", 0},
+#endif
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   {"ticket", TLS_BENCH_MODE_TICKET, TLS_VERSION_1_2, "default", 0},
+#endif
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+#if (TLS_X25519_SUPPORT == ENABLED)
+   {"full", TLS_BENCH_MODE_FULL, TLS_VERSION_1_3, "x25519",
+      TLS_GROUP_ECDH_X25519},
+#endif
+#if (TLS_SECP256R1_SUPPORT == ENABLED)
+   {"full", TLS_BENCH_MODE_FULL, TLS_VERSION_1_3, "secp256r1",
+      TLS_GROUP_SECP256R1},
+#endif
+#if (TLS_SECP384R1_SUPPORT == ENABLED)
+   {"full", TLS_BENCH_MODE_FULL, TLS_VERSION_1_3, "secp384r1",
+      TLS_GROUP_SECP384R1},
+#endif
+#if (TLS_FFDHE_SUPPORT == ENABLED && TLS_FFDHE2048_SUPPORT == ENABLED)
+   {"full", TLS_BENCH_MODE_FULL, TLS_VERSION_1_3, "ffdhe2048",
+      TLS_GROUP_FFDHE2048},
+#endif
+   {"ticket", TLS_BENCH_MODE_TICKET, TLS_VERSION_1_3, "default", 0},
+#if (TLS13_PSK_KE_SUPPORT == ENABLED || TLS13_PSK_DHE_KE_SUPPORT == ENABLED || \
+   TLS13_PSK_ECDHE_KE_SUPPORT == ENABLED)
+   {"psk", TLS_BENCH_MODE_PSK, TLS_VERSION_1_3, "default", 0},
+#endif
+#if (TLS13_EARLY_DATA_SUPPORT == ENABLED)
+   {"0-rtt", TLS_BENCH_MODE_EARLY_DATA, TLS_VERSION_1_3, "default", 0},
+#endif
+#endif
+};
+
+//Pre-shared key used in PSK mode
+const uint8_t tlsBenchPsk[32] =
+{
+   0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+   0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+   0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+   0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F
+};
+
+//Early data sent in 0-RTT mode
+uint8_t tlsBenchEarlyData[TLS_BENCH_EARLY_DATA_SIZE];
+
+//PRNG shared by all the TLS contexts
+YarrowContext tlsBenchPrngContext;
+
+//Session cache shared by all the servers
+TlsCache *tlsBenchCache;
+
+//Ticket encryption context shared by all the servers
+TlsTicketContext tlsBenchTicketContext;
+
+//Credentials of the server
+char_t *tlsBenchCertChain;
+size_t tlsBenchCertChainLen;
+char_t *tlsBenchPrivateKey;
+size_t tlsBenchPrivateKeyLen;
+
+//Trusted CA list of the client (optional)
+char_t *tlsBenchCaList;
+size_t tlsBenchCaListLen;
+
+
+/**
+ * @brief PSK callback of the server
+ * @param[in] context Pointer to the TLS context
+ * @param[in] pskIdentity PSK identity of the client
+ * @param[in] pskIdentityLen Length of the PSK identity, in bytes
+ * @return Error code
+ **/
+
+error_t tlsBenchPskCallback(TlsContext *context, const uint8_t *pskIdentity,
+   size_t pskIdentityLen)
+{
+   //All the clients share the same external PSK
+   return tlsSetPsk(context, tlsBenchPsk, sizeof(tlsBenchPsk));
+}
+
+
+/**
+ * @brief Configure one end of a benchmark connection
+ * @param[in] context Pointer to the TLS context
+ * @param[in] entity Specifies whether the context is a client or a server
+ * @param[in] scenario Scenario to be run
+ * @return Error code
+ **/
+
+error_t tlsBenchInitContext(TlsContext *context, TlsConnectionEnd entity,
+   const TlsBenchScenario *scenario)
+{
+   error_t error;
+
+   //Start of exception handling block
+   do
+   {
+      //Select the end of the connection
+      error = tlsSetConnectionEnd(context, entity);
+      if(error)
+         break;
+
+      //Only the measured version may be negotiated
+      error = tlsSetVersion(context, scenario->version, scenario->version);
+      if(error)
+         break;
+
+      //Set the PRNG
+      error = tlsSetPrng(context, YARROW_PRNG_ALGO, &tlsBenchPrngContext);
+      if(error)
+         break;
+
+      //Restrict the key exchange to the measured group, if any
+      if(scenario->group != 0)
+      {
+         error = tlsSetSupportedGroups(context, &scenario->group, 1);
+         if(error)
+            break;
+      }
+
+      //Client or server?
+      if(entity == TLS_CONNECTION_END_CLIENT)
+      {
+         //PSK mode?
+         if(scenario->mode == TLS_BENCH_MODE_PSK)
+         {
+            //Set the external PSK and its identity
+            error = tlsSetPsk(context, tlsBenchPsk, sizeof(tlsBenchPsk));
+            if(error)
+               break;
+
+            error = tlsSetPskIdentity(context, "bench");
+            if(error)
+               break;
+         }
+
+         //Check whether a trusted CA list has been supplied
+         if(tlsBenchCaList != NULL)
+         {
+            error = tlsSetTrustedCaList(context, tlsBenchCaList,
+               tlsBenchCaListLen);
+         }
+         else
+         {
+            error = tlsSetCertificateVerifyCallback(context,
+               tlsBenchAcceptCertificate, NULL);
+         }
+      }
+      else
+      {
+         //Load the certificate and the private key of the server
+         error = tlsAddCertificate(context, tlsBenchCertChain,
+            tlsBenchCertChainLen, tlsBenchPrivateKey, tlsBenchPrivateKeyLen);
+         if(error)
+            break;
+
+         //PSK mode?
+         if(scenario->mode == TLS_BENCH_MODE_PSK)
+         {
+            //Look up the external PSK of the client
+            error = tlsSetPskCallback(context, tlsBenchPskCallback);
+         }
+         //Session ID resumption?
+         else if(scenario->mode == TLS_BENCH_MODE_SESSION_ID)
+         {
+            //All the servers share the same session cache
+            error = tlsSetCache(context, tlsBenchCache);
+         }
+         //Ticket resumption?
+         else if(scenario->mode == TLS_BENCH_MODE_TICKET ||
+            scenario->mode == TLS_BENCH_MODE_EARLY_DATA)
+         {
+            //All the servers share the same ticket encryption keys
+            error = tlsSetTicketCallbacks(context, tlsEncryptTicket,
+               tlsDecryptTicket, &tlsBenchTicketContext);
+         }
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //TLS 1.2 session tickets must be enabled on both sides
+      if(scenario->mode == TLS_BENCH_MODE_TICKET &&
+         scenario->version == TLS_VERSION_1_2)
+      {
+         error = tlsEnableSessionTickets(context, TRUE);
+         if(error)
+            break;
+      }
+#endif
+
+#if (TLS13_EARLY_DATA_SUPPORT == ENABLED)
+      //The server accepts early data in 0-RTT mode
+      if(scenario->mode == TLS_BENCH_MODE_EARLY_DATA &&
+         entity == TLS_CONNECTION_END_SERVER)
+      {
+         error = tlsSetMaxEarlyDataSize(context, TLS_BENCH_EARLY_DATA_SIZE);
+         if(error)
+            break;
+      }
+#endif
+
+      //End of exception handling block
+   } while(0);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Perform one handshake
+ * @param[in] worker Benchmark thread
+ * @param[in,out] session Session state used for resumption
+ * @param[in] resume Resume the specified session (else save the state of
+ *   the new session)
+ * @param[out] latency Duration of the handshake, in nanoseconds
+ * @return Error code
+ **/
+
+error_t tlsBenchConnect(TlsBenchWorker *worker, TlsSessionState *session,
+   bool_t resume, uint64_t *latency)
+{
+   error_t error;
+   size_t n;
+   uint64_t start;
+   uint8_t buffer[64];
+   TlsContext *client;
+   TlsContext *server;
+   const TlsBenchScenario *scenario;
+
+   //Point to the scenario run by the thread
+   scenario = worker->scenario;
+
+   //Create the two ends of the connection
+   client = tlsInit();
+   server = tlsInit();
+
+   //Start of exception handling block
+   do
+   {
+      //Failed to allocate memory?
+      if(client == NULL || server == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //Configure the client and the server
+      error = tlsBenchInitContext(client, TLS_CONNECTION_END_CLIENT,
+         scenario);
+      if(error)
+         break;
+
+      error = tlsBenchInitContext(server, TLS_CONNECTION_END_SERVER,
+         scenario);
+      if(error)
+         break;
+
+      //Join the client and the server
+      tlsBenchInitLink(worker->link, FALSE);
+
+      error = tlsBenchAttach(worker->link, client, server);
+      if(error)
+         break;
+
+      //Resume the session established by the first handshake, if requested
+      if(resume)
+      {
+         error = tlsRestoreSessionState(client, session);
+         if(error)
+            break;
+      }
+
+      //Start of the measurement
+      start = tlsBenchGetTime();
+
+#if (TLS13_EARLY_DATA_SUPPORT == ENABLED)
+      //The client sends early data along with its ClientHello
+      if(resume && scenario->mode == TLS_BENCH_MODE_EARLY_DATA)
+      {
+         error = tlsWriteEarlyData(client, tlsBenchEarlyData,
+            sizeof(tlsBenchEarlyData), &n, 0);
+
+         //The client waits for the ServerHello
+         if(error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+            error = NO_ERROR;
+
+         //Any error to report?
+         if(error)
+            break;
+      }
+#endif
+
+      //Complete the handshake
+      error = tlsBenchHandshake(client, server);
+
+      //End of the measurement
+      *latency = tlsBenchGetTime() - start;
+
+      //Any error to report?
+      if(error)
+         break;
+
+      //Save the state of the new session
+      if(!resume && scenario->mode != TLS_BENCH_MODE_FULL &&
+         scenario->mode != TLS_BENCH_MODE_PSK)
+      {
+         //With TLS 1.3, the ticket is carried by a post-handshake message
+         if(scenario->version == TLS_VERSION_1_3)
+         {
+            error = tlsRead(client, buffer, sizeof(buffer), &n, 0);
+
+            //No application data is expected
+            if(error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+               error = NO_ERROR;
+            else if(!error)
+               error = ERROR_UNEXPECTED_MESSAGE;
+
+            //Any error to report?
+            if(error)
+               break;
+         }
+
+         //Save the session state
+         error = tlsSaveSessionState(client, session);
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Release the two ends of the connection
+   if(client != NULL)
+      tlsFree(client);
+
+   if(server != NULL)
+      tlsFree(server);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Benchmark thread routine
+ * @param[in] param Benchmark thread
+ * @return Unused value
+ **/
+
+void *tlsBenchWorkerTask(void *param)
+{
+   error_t error;
+   uint_t i;
+   bool_t resume;
+   uint64_t latency;
+   TlsSessionState session;
+   TlsBenchWorker *worker;
+
+   //Point to the benchmark thread
+   worker = (TlsBenchWorker *) param;
+
+   //Initialize session state
+   tlsInitSessionState(&session);
+
+   //Resumption modes are measured against a session established once
+   resume = (worker->scenario->mode == TLS_BENCH_MODE_SESSION_ID ||
+      worker->scenario->mode == TLS_BENCH_MODE_TICKET ||
+      worker->scenario->mode == TLS_BENCH_MODE_EARLY_DATA);
+
+   //Establish the session to be resumed, if any
+   if(resume)
+      error = tlsBenchConnect(worker, &session, FALSE, &latency);
+   else
+      error = NO_ERROR;
+
+   //Start of the measurement
+   worker->start = tlsBenchGetTime();
+
+   //Perform the handshakes
+   for(i = 0; i < worker->count && !error; i++)
+   {
+      error = tlsBenchConnect(worker, &session, resume,
+         &worker->latencies[i]);
+   }
+
+   //End of the measurement
+   worker->end = tlsBenchGetTime();
+
+   //Release session state
+   tlsFreeSessionState(&session);
+
+   //Save status code
+   worker->error = error;
+
+   //The return value is not used
+   return NULL;
+}
+
+
+/**
+ * @brief Compare two latencies (qsort callback)
+ * @param[in] a Pointer to the first latency
+ * @param[in] b Pointer to the second latency
+ * @return Comparison result
+ **/
+
+int tlsBenchCompareLatency(const void *a, const void *b)
+{
+   uint64_t x;
+   uint64_t y;
+
+   //Retrieve the latencies
+   x = *((const uint64_t *) a);
+   y = *((const uint64_t *) b);
+
+   //Compare the latencies
+   return (x > y) - (x < y);
+}
+
+
+/**
+ * @brief Run a scenario with the specified number of threads
+ * @param[in] scenario Scenario to be run
+ * @param[in] numThreads Number of threads
+ * @param[in] count Number of handshakes per thread
+ * @return Error code
+ **/
+
+error_t tlsBenchRunScenario(const TlsBenchScenario *scenario,
+   uint_t numThreads, uint_t count)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint64_t start;
+   uint64_t end;
+   uint64_t *latencies;
+   TlsBenchWorker *workers;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Allocate the benchmark threads and the latency samples
+   workers = tlsAllocMem(numThreads * sizeof(TlsBenchWorker));
+   latencies = tlsAllocMem(numThreads * count * sizeof(uint64_t));
+
+   //Failed to allocate memory?
+   if(workers == NULL || latencies == NULL)
+      error = ERROR_OUT_OF_MEMORY;
+
+   //Start the benchmark threads
+   for(n = 0; n < numThreads && !error; n++)
+   {
+      //Initialize the benchmark thread
+      memset(&workers[n], 0, sizeof(TlsBenchWorker));
+      workers[n].scenario = scenario;
+      workers[n].count = count;
+      workers[n].latencies = latencies + n * count;
+
+      //Each thread has its own in-memory link
+      workers[n].link = tlsAllocMem(sizeof(TlsBenchLink));
+
+      //Failed to allocate memory?
+      if(workers[n].link == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+      }
+      else if(pthread_create(&workers[n].thread, NULL, tlsBenchWorkerTask,
+         &workers[n]) != 0)
+      {
+         tlsFreeMem(workers[n].link);
+         error = ERROR_OUT_OF_RESOURCES;
+      }
+   }
+
+   //Undo the last increment if a thread could not be started
+   if(error && n > 0)
+      n--;
+
+   //Wait for the benchmark threads to complete
+   for(i = 0; i < n; i++)
+   {
+      //Join the thread
+      pthread_join(workers[i].thread, NULL);
+      tlsFreeMem(workers[i].link);
+
+      //Any error to report?
+      if(!error && workers[i].error)
+         error = workers[i].error;
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //The measurement spans from the first start to the last end
+      start = workers[0].start;
+      end = workers[0].end;
+
+      for(i = 1; i < numThreads; i++)
+      {
+         start = MIN(start, workers[i].start);
+         end = MAX(end, workers[i].end);
+      }
+
+      //Sort the latency samples of all the threads
+      n = numThreads * count;
+      qsort(latencies, n, sizeof(uint64_t), tlsBenchCompareLatency);
+
+      //Report the result of the measurement
+      printf("%s,%s,%s,%u,%u,%.1f,%.1f,%.1f,%.1f\n", scenario->name,
+         (scenario->version == TLS_VERSION_1_3) ? "TLS1.3" : "TLS1.2",
+         scenario->groupName, numThreads, n,
+         (double) n * 1000000000.0 / MAX(end - start, 1),
+         (double) latencies[(n - 1) * 50 / 100] / 1000.0,
+         (double) latencies[(n - 1) * 90 / 100] / 1000.0,
+         (double) latencies[(n - 1) * 99 / 100] / 1000.0);
+   }
+
+   //Release resources
+   if(workers != NULL)
+      tlsFreeMem(workers);
+
+   if(latencies != NULL)
+      tlsFreeMem(latencies);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Seed the PRNG shared by the TLS contexts
+ * @return Error code
+ **/
+
+error_t tlsBenchInitPrng(void)
+{
+   error_t error;
+   FILE *fp;
+   uint8_t seed[32];
+
+   //Initialize the PRNG
+   error = yarrowInit(&tlsBenchPrngContext);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Read the seed from the entropy source of the host
+   fp = fopen("/dev/urandom", "rb");
+   //Failed to open the entropy source?
+   if(fp == NULL)
+      return ERROR_OPEN_FAILED;
+
+   //Read the seed
+   if(fread(seed, 1, sizeof(seed), fp) == sizeof(seed))
+      error = yarrowSeed(&tlsBenchPrngContext, seed, sizeof(seed));
+   else
+      error = ERROR_READ_FAILED;
+
+   //Close the entropy source
+   fclose(fp);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Benchmark entry point
+ * @param[in] argc Number of command line arguments
+ * @param[in] argv Command line arguments
+ * @return Exit status
+ **/
+
+int main(int argc, char *argv[])
+{
+   error_t error;
+   int i;
+   uint_t j;
+   uint_t numThreads;
+   uint_t maxThreads;
+   uint_t count;
+
+   //Default settings
+   maxThreads = TLS_BENCH_DEFAULT_THREADS;
+   count = TLS_BENCH_DEFAULT_COUNT;
+
+   //Parse the options
+   for(i = 1; (i + 1) < argc && argv[i][0] == '-'; i += 2)
+   {
+      if(!strcmp(argv[i], "-t"))
+         maxThreads = strtoul(argv[i + 1], NULL, 10);
+      else if(!strcmp(argv[i], "-n"))
+         count = strtoul(argv[i + 1], NULL, 10);
+      else
+         break;
+   }
+
+   //Check command line arguments
+   if((argc - i) < 2 || (argc - i) > 3 || maxThreads < 1 || count < 1)
+   {
+      fprintf(stderr, "Usage: %s [-t threads] [-n count] <cert.pem> "
+         "<key.pem> [<ca.pem>]\n", argv[0]);
+      return 1;
+   }
+
+   //Load the certificate chain and the private key of the server
+   error = tlsBenchLoadFile(argv[i], &tlsBenchCertChain,
+      &tlsBenchCertChainLen);
+
+   if(!error)
+   {
+      error = tlsBenchLoadFile(argv[i + 1], &tlsBenchPrivateKey,
+         &tlsBenchPrivateKeyLen);
+   }
+
+   //Load the trusted CA list of the client, if any
+   if(!error && (argc - i) == 3)
+   {
+      error = tlsBenchLoadFile(argv[i + 2], &tlsBenchCaList,
+         &tlsBenchCaListLen);
+   }
+
+   //Seed the PRNG
+   if(!error)
+      error = tlsBenchInitPrng();
+
+   //Create the session cache shared by the servers
+   if(!error)
+   {
+      tlsBenchCache = tlsInitCache(TLS_BENCH_CACHE_SIZE);
+      //Failed to create the cache?
+      if(tlsBenchCache == NULL)
+         error = ERROR_OUT_OF_MEMORY;
+   }
+
+   //Initialize the ticket encryption context shared by the servers
+   if(!error)
+      error = tlsInitTicketContext(&tlsBenchTicketContext);
+
+   //Any error to report?
+   if(error)
+   {
+      fprintf(stderr, "Initialization failed (error %d)\n", error);
+      return 1;
+   }
+
+   //Header of the results
+   printf("mode,protocol,group,threads,handshakes,handshakes_per_s,"
+      "p50_us,p90_us,p99_us\n");
+
+   //Loop through the scenarios enabled in the build
+   for(j = 0; j < arraysize(tlsBenchScenarios); j++)
+   {
+      //Double the number of threads at each step
+      for(numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+      {
+         //Run the scenario
+         error = tlsBenchRunScenario(&tlsBenchScenarios[j], numThreads,
+            count);
+
+         //The scenario cannot be run with these credentials?
+         if(error)
+         {
+            fprintf(stderr, "Skipping %s %s (error %d)\n",
+               tlsBenchScenarios[j].name, tlsBenchScenarios[j].groupName,
+               error);
+            break;
+         }
+      }
+   }
+
+   //Release resources
+   tlsFreeTicketContext(&tlsBenchTicketContext);
+   tlsFreeCache(tlsBenchCache);
+   yarrowRelease(&tlsBenchPrngContext);
+   tlsFreeMem(tlsBenchCertChain);
+   tlsFreeMem(tlsBenchPrivateKey);
+
+   if(tlsBenchCaList != NULL)
+      tlsFreeMem(tlsBenchCaList);
+
+   //Successful processing
+   return 0;
+}
@@ -0,0 +1,476 @@
+/**
+ * @file tls_record_bench.c
+ * @brief Record layer throughput benchmark
+ *
+ * A client and a server are joined by an in-memory link and connected once
+ * per protocol version and cipher suite. The client then sends application
+ * data to the server at a sweep of record sizes, and the time spent in
+ * tlsWrite() and tlsRead() is reported as one CSV line per measurement:
+ *
+ * protocol,cipher_suite,record_size,records,mb_per_s,ns_per_record
+ *
+ * Usage: tls_record_bench <cert.pem> <key.pem> [<ca.pem>]
+ *
+ * Cipher suites that cannot be negotiated with the supplied certificate are
+ * reported on the standard error and skipped. The program is linked against
+ * CycloneSSL and CycloneCRYPTO, and runs on a POSIX host
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Dependencies
+#include <stdio.h>
+#include <string.h>
+#include "tls.h"
+#include "tls_cipher_suites.h"
+#include "rng/yarrow.h"
+#include "tls_bench_transport.h"
+
+//Number of plaintext bytes transferred for each measurement
+#ifndef TLS_BENCH_RECORD_BYTES
+   #define TLS_BENCH_RECORD_BYTES 8388608
+#elif (TLS_BENCH_RECORD_BYTES < 1)
+   #error TLS_BENCH_RECORD_BYTES parameter is not valid
+#endif
+
+//Minimum number of records for each measurement
+#ifndef TLS_BENCH_MIN_RECORDS
+   #define TLS_BENCH_MIN_RECORDS 64
+#elif (TLS_BENCH_MIN_RECORDS < 1)
+   #error TLS_BENCH_MIN_RECORDS parameter is not valid
+#endif
+
+//Smallest and largest record sizes of the sweep
+#define TLS_BENCH_MIN_RECORD_SIZE 64
+#define TLS_BENCH_MAX_RECORD_SIZE 16384
+
+
+/**
+ * @brief Protocol version measured by the benchmark
+ **/
+
+typedef struct
+{
+   const char_t *name;                     ///<Name reported in the results
+   uint16_t version;                       ///<TLS protocol version
+   TlsTransportProtocol transportProtocol; ///<Transport protocol (TLS or DTLS)
+} TlsBenchProtocol;
+
+
+//Protocol versions enabled in the build
+const TlsBenchProtocol tlsBenchProtocols[] =
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   {"TLS1.2", TLS_VERSION_1_2, TLS_TRANSPORT_PROTOCOL_STREAM},
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   {"TLS1.3", TLS_VERSION_1_3, TLS_TRANSPORT_PROTOCOL_STREAM},
+#endif
+#if (DTLS_SUPPORT == ENABLED && TLS_MAX_VERSION >= TLS_VERSION_1_2 && \
+   TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   {"DTLS1.2", TLS_VERSION_1_2, TLS_TRANSPORT_PROTOCOL_DATAGRAM},
+#endif
+};
+
+//Pre-shared key used by the PSK cipher suites
+const uint8_t tlsBenchPsk[32] =
+{
+   0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+   0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+   0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+   0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F
+};
+
+//PRNG shared by all the TLS contexts
+YarrowContext tlsBenchPrngContext;
+
+//Credentials of the server
+char_t *tlsBenchCertChain;
+size_t tlsBenchCertChainLen;
+char_t *tlsBenchPrivateKey;
+size_t tlsBenchPrivateKeyLen;
+
+//Trusted CA list of the client (optional)
+char_t *tlsBenchCaList;
+size_t tlsBenchCaListLen;
+
+//Application data buffers
+uint8_t tlsBenchTxBuffer[TLS_BENCH_MAX_RECORD_SIZE];
+uint8_t tlsBenchRxBuffer[TLS_BENCH_MAX_RECORD_SIZE];
+
+
+/**
+ * @brief Configure one end of a benchmark connection
+ * @param[in] context Pointer to the TLS context
+ * @param[in] entity Specifies whether the context is a client or a server
+ * @param[in] protocol Protocol version to be negotiated
+ * @param[in] cipherSuite Cipher suite to be negotiated
+ * @return Error code
+ **/
+
+error_t tlsBenchInitContext(TlsContext *context, TlsConnectionEnd entity,
+   const TlsBenchProtocol *protocol, uint16_t cipherSuite)
+{
+   error_t error;
+
+   //Start of exception handling block
+   do
+   {
+      //Select the end of the connection
+      error = tlsSetConnectionEnd(context, entity);
+      if(error)
+         break;
+
+      //Select the transport protocol
+      error = tlsSetTransportProtocol(context, protocol->transportProtocol);
+      if(error)
+         break;
+
+      //Only the measured version may be negotiated
+      error = tlsSetVersion(context, protocol->version, protocol->version);
+      if(error)
+         break;
+
+      //Set the PRNG
+      error = tlsSetPrng(context, YARROW_PRNG_ALGO, &tlsBenchPrngContext);
+      if(error)
+         break;
+
+      //Only the measured cipher suite may be negotiated
+      error = tlsSetCipherSuites(context, &cipherSuite, 1);
+      if(error)
+         break;
+
+      //Set the pre-shared key used by the PSK cipher suites
+      error = tlsSetPsk(context, tlsBenchPsk, sizeof(tlsBenchPsk));
+      if(error)
+         break;
+
+      //Client or server?
+      if(entity == TLS_CONNECTION_END_CLIENT)
+      {
+         //Set the PSK identity
+         error = tlsSetPskIdentity(context, "bench");
+         if(error)
+            break;
+
+         //Check whether a trusted CA list has been supplied
+         if(tlsBenchCaList != NULL)
+         {
+            error = tlsSetTrustedCaList(context, tlsBenchCaList,
+               tlsBenchCaListLen);
+         }
+         else
+         {
+            error = tlsSetCertificateVerifyCallback(context,
+               tlsBenchAcceptCertificate, NULL);
+         }
+      }
+      else
+      {
+         //Load the certificate and the private key of the server
+         error = tlsAddCertificate(context, tlsBenchCertChain,
+            tlsBenchCertChainLen, tlsBenchPrivateKey, tlsBenchPrivateKeyLen);
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Transfer application data from the client to the server
+ * @param[in] client Client context
+ * @param[in] server Server context
+ * @param[in] size Size of each record
+ * @param[in] count Number of records to transfer
+ * @return Error code
+ **/
+
+error_t tlsBenchTransfer(TlsContext *client, TlsContext *server,
+   size_t size, uint_t count)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   size_t length;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Transfer the records one at a time
+   for(i = 0; i < count && !error; i++)
+   {
+      //Encrypt the record
+      error = tlsWrite(client, tlsBenchTxBuffer, size, &n, 0);
+
+      //The whole record must have been sent
+      if(!error && n != size)
+         error = ERROR_WRITE_FAILED;
+
+      //Decrypt the record
+      for(length = 0; length < size && !error; length += n)
+      {
+         error = tlsRead(server, tlsBenchRxBuffer + length, size - length,
+            &n, 0);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Measure the throughput of a cipher suite
+ * @param[in] protocol Protocol version to be negotiated
+ * @param[in] cipherSuite Cipher suite to be negotiated
+ * @return Error code
+ **/
+
+error_t tlsBenchRunCipherSuite(const TlsBenchProtocol *protocol,
+   const TlsCipherSuiteInfo *cipherSuite)
+{
+   error_t error;
+   uint_t count;
+   size_t size;
+   uint64_t start;
+   uint64_t elapsed;
+   TlsContext *client;
+   TlsContext *server;
+   TlsBenchLink link;
+
+   //Create the two ends of the connection
+   client = tlsInit();
+   server = tlsInit();
+
+   //Start of exception handling block
+   do
+   {
+      //Failed to allocate memory?
+      if(client == NULL || server == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //Configure the client
+      error = tlsBenchInitContext(client, TLS_CONNECTION_END_CLIENT, protocol,
+         cipherSuite->identifier);
+      if(error)
+         break;
+
+      //Configure the server
+      error = tlsBenchInitContext(server, TLS_CONNECTION_END_SERVER, protocol,
+         cipherSuite->identifier);
+      if(error)
+         break;
+
+      //Join the client and the server
+      tlsBenchInitLink(&link,
+         protocol->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM);
+
+      error = tlsBenchAttach(&link, client, server);
+      if(error)
+         break;
+
+      //Establish the connection
+      error = tlsBenchHandshake(client, server);
+      if(error)
+         break;
+
+      //Sweep the record sizes
+      for(size = TLS_BENCH_MIN_RECORD_SIZE; size <= TLS_BENCH_MAX_RECORD_SIZE;
+         size *= 2)
+      {
+         //Number of records to transfer
+         count = MAX(TLS_BENCH_RECORD_BYTES / size, TLS_BENCH_MIN_RECORDS);
+
+         //Warm up the caches and the buffers of both ends
+         error = tlsBenchTransfer(client, server, size, 1);
+         if(error)
+            break;
+
+         //Measure the time spent encrypting and decrypting the records
+         start = tlsBenchGetTime();
+         error = tlsBenchTransfer(client, server, size, count);
+         elapsed = tlsBenchGetTime() - start;
+
+         //Any error to report?
+         if(error)
+            break;
+
+         //Report the result of the measurement
+         printf("%s,%s,%" PRIuSIZE ",%u,%.2f,%.0f\n", protocol->name,
+            cipherSuite->name, size, count,
+            (double) size * count * 1000.0 / MAX(elapsed, 1),
+            (double) elapsed / count);
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Release the two ends of the connection
+   if(client != NULL)
+      tlsFree(client);
+
+   if(server != NULL)
+      tlsFree(server);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Seed the PRNG shared by the TLS contexts
+ * @return Error code
+ **/
+
+error_t tlsBenchInitPrng(void)
+{
+   error_t error;
+   FILE *fp;
+   uint8_t seed[32];
+
+   //Initialize the PRNG
+   error = yarrowInit(&tlsBenchPrngContext);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Read the seed from the entropy source of the host
+   fp = fopen("/dev/urandom", "rb");
+   //Failed to open the entropy source?
+   if(fp == NULL)
+      return ERROR_OPEN_FAILED;
+
+   //Read the seed
+   if(fread(seed, 1, sizeof(seed), fp) == sizeof(seed))
+      error = yarrowSeed(&tlsBenchPrngContext, seed, sizeof(seed));
+   else
+      error = ERROR_READ_FAILED;
+
+   //Close the entropy source
+   fclose(fp);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Benchmark entry point
+ * @param[in] argc Number of command line arguments
+ * @param[in] argv Command line arguments
+ * @return Exit status
+ **/
+
+int main(int argc, char *argv[])
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   const TlsCipherSuiteInfo *cipherSuite;
+
+   //Check command line arguments
+   if(argc < 3 || argc > 4)
+   {
+      fprintf(stderr, "Usage: %s <cert.pem> <key.pem> [<ca.pem>]\n", argv[0]);
+      return 1;
+   }
+
+   //Load the certificate chain and the private key of the server
+   error = tlsBenchLoadFile(argv[1], &tlsBenchCertChain,
+      &tlsBenchCertChainLen);
+
+   if(!error)
+   {
+      error = tlsBenchLoadFile(argv[2], &tlsBenchPrivateKey,
+         &tlsBenchPrivateKeyLen);
+   }
+
+   //Load the trusted CA list of the client, if any
+   if(!error && argc == 4)
+      error = tlsBenchLoadFile(argv[3], &tlsBenchCaList, &tlsBenchCaListLen);
+
+   //Seed the PRNG
+   if(!error)
+      error = tlsBenchInitPrng();
+
+   //Any error to report?
+   if(error)
+   {
+      fprintf(stderr, "Initialization failed (error %d)\n", error);
+      return 1;
+   }
+
+   //Header of the results
+   printf("protocol,cipher_suite,record_size,records,mb_per_s,ns_per_record\n");
+
+   //Loop through the protocol versions enabled in the build
+   for(i = 0; i < arraysize(tlsBenchProtocols); i++)
+   {
+      //Loop through the cipher suites enabled in the build
+      for(j = 0; j < tlsGetNumSupportedCipherSuites(); j++)
+      {
+         //Point to the current cipher suite
+         cipherSuite = &tlsSupportedCipherSuites[j];
+
+         //Skip the cipher suites that do not apply to this version
+         if(!tlsIsCipherSuiteAcceptable(cipherSuite,
+            tlsBenchProtocols[i].version, tlsBenchProtocols[i].version,
+            tlsBenchProtocols[i].transportProtocol))
+         {
+            continue;
+         }
+
+         //Measure the throughput of the cipher suite
+         error = tlsBenchRunCipherSuite(&tlsBenchProtocols[i], cipherSuite);
+
+         //The cipher suite cannot be negotiated with these credentials?
+         if(error)
+         {
+            fprintf(stderr, "Skipping %s %s (error %d)\n",
+               tlsBenchProtocols[i].name, cipherSuite->name, error);
+         }
+      }
+   }
+
+   //Release resources
+   yarrowRelease(&tlsBenchPrngContext);
+   tlsFreeMem(tlsBenchCertChain);
+   tlsFreeMem(tlsBenchPrivateKey);
+
+   if(tlsBenchCaList != NULL)
+      tlsFreeMem(tlsBenchCaList);
+
+   //Successful processing
+   return 0;
+}
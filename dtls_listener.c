@@ -0,0 +1,1424 @@
+/**
+ * @file dtls_listener.c
+ * @brief DTLS listener (many DTLS sessions on a single UDP socket)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_misc.h"
+#include "dtls_misc.h"
+#include "dtls_listener.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && DTLS_SUPPORT == ENABLED && TLS_SERVER_SUPPORT == ENABLED)
+
+
+/**
+ * @brief DTLS listener initialization
+ *
+ * The listener owns a single UDP socket and demultiplexes the incoming
+ * datagrams to the TLS contexts bound to it, using a hash table keyed by the
+ * address of the peer. ClientHello messages from unknown peers are answered
+ * with a stateless HelloVerifyRequest, so that no context is allocated
+ * before the peer has proven it can receive datagrams at its address
+ *
+ * @param[in] socketHandle Handle of the shared UDP socket
+ * @param[in] sendCallback Send callback function (sendto)
+ * @param[in] receiveCallback Receive callback function (recvfrom). The
+ *   callback must honor the TLS_FLAG_PEEK flag
+ * @param[in] bufferSize Size of the buffer used to receive datagrams from
+ *   unknown peers
+ * @param[in] numBuckets Size of the hash table (power of two)
+ * @return Pointer to the newly created listener
+ **/
+
+DtlsListener *dtlsInitListener(TlsSocketHandle socketHandle,
+   DtlsListenerSendCallback sendCallback,
+   DtlsListenerReceiveCallback receiveCallback, size_t bufferSize,
+   uint_t numBuckets)
+{
+   size_t n;
+   DtlsListener *listener;
+
+   //Check parameters
+   if(sendCallback == NULL || receiveCallback == NULL)
+      return NULL;
+
+   //The buffer must be large enough to hold a ClientHello message
+   if(bufferSize < sizeof(DtlsRecord) + sizeof(DtlsHandshake) +
+      sizeof(TlsClientHello))
+   {
+      return NULL;
+   }
+
+   //The size of the hash table must be a power of two
+   if(numBuckets < 1 || (numBuckets & (numBuckets - 1)) != 0)
+      return NULL;
+
+   //Size of the memory required (peer address and CID hash tables)
+   n = sizeof(DtlsListener) + 2 * numBuckets * sizeof(TlsContext *) +
+      bufferSize;
+
+   //Allocate a memory buffer to hold the listener
+   listener = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(listener == NULL)
+      return NULL;
+
+   //Clear memory
+   memset(listener, 0, n);
+
+   //Create a mutex to prevent simultaneous access to the listener
+   if(!osCreateMutex(&listener->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(listener);
+      //Report an error
+      return NULL;
+   }
+
+   //The hash tables and the buffer follow the listener structure
+   listener->buckets = (TlsContext **) (listener + 1);
+   listener->cidBuckets = listener->buckets + numBuckets;
+   listener->buffer = (uint8_t *) (listener->cidBuckets + numBuckets);
+
+   //Save parameters
+   listener->socketHandle = socketHandle;
+   listener->sendCallback = sendCallback;
+   listener->receiveCallback = receiveCallback;
+   listener->bufferSize = bufferSize;
+   listener->numBuckets = numBuckets;
+
+   //Return a pointer to the newly created listener
+   return listener;
+}
+
+
+/**
+ * @brief Set cookie generation/verification callbacks
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] cookieGenerateCallback Cookie generation callback function
+ * @param[in] cookieVerifyCallback Cookie verification callback function
+ * @param[in] param An opaque pointer passed to the callback functions
+ * @return Error code
+ **/
+
+error_t dtlsSetListenerCookieCallbacks(DtlsListener *listener,
+   DtlsCookieGenerateCallback cookieGenerateCallback,
+   DtlsCookieVerifyCallback cookieVerifyCallback, void *param)
+{
+   //Invalid listener?
+   if(listener == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(cookieGenerateCallback == NULL || cookieVerifyCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save cookie generation/verification callback functions. The callbacks
+   //are invoked with a NULL context, since no context exists yet
+   listener->cookieGenerateCallback = cookieGenerateCallback;
+   listener->cookieVerifyCallback = cookieVerifyCallback;
+   listener->cookieParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the callback that creates the context of a new peer
+ *
+ * The callback is invoked once the peer has returned a valid cookie. It
+ * returns a TLS context initialized as a DTLS server, or NULL to refuse
+ * the peer. The context does not need cookie callbacks of its own
+ *
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] acceptCallback Accept callback function
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t dtlsSetListenerAcceptCallback(DtlsListener *listener,
+   DtlsListenerAcceptCallback acceptCallback, void *param)
+{
+   //Check parameters
+   if(listener == NULL || acceptCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save accept callback function
+   listener->acceptCallback = acceptCallback;
+   listener->acceptParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the length of the connection IDs assigned to the peers
+ *
+ * When a non-zero length is set, every context bound to the listener asks
+ * its peer for a random CID of this length (RFC 9146). Records carrying a
+ * CID are then routed by CID rather than by address, so that sessions
+ * survive a NAT rebinding. The length is fixed because the CID length is
+ * not encoded in the records
+ *
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] length Length of the CIDs, in bytes (0 to disable)
+ * @return Error code
+ **/
+
+error_t dtlsSetListenerCidLength(DtlsListener *listener, size_t length)
+{
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Check parameters
+   if(listener == NULL || length > DTLS_MAX_CID_SIZE)
+      return ERROR_INVALID_PARAMETER;
+
+   //The length cannot be changed once contexts are bound to the listener
+   if(listener->numContexts > 0)
+      return ERROR_WRONG_STATE;
+
+   //Save the length of the connection IDs
+   listener->cidLen = length;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set batched datagram I/O callbacks (sendmmsg/recvmmsg)
+ *
+ * The receive batch callback replaces the peek-then-receive scheme: a whole
+ * batch of datagrams is received at once, and each datagram is copied into
+ * the receive buffer of its context when the context reads it. The send
+ * batch callback is used by the bound contexts to send the datagrams of a
+ * flight (and the application data datagrams of a single write) together
+ *
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] sendBatchCallback Send batch callback function (optional)
+ * @param[in] receiveBatchCallback Receive batch callback function (optional)
+ * @param[in] batchSize Maximum number of datagrams per batch. Each datagram
+ *   buffer is as large as the listener buffer
+ * @return Error code
+ **/
+
+error_t dtlsSetListenerBatchCallbacks(DtlsListener *listener,
+   DtlsListenerSendBatchCallback sendBatchCallback,
+   DtlsListenerReceiveBatchCallback receiveBatchCallback, uint_t batchSize)
+{
+   uint_t i;
+   size_t n;
+   uint8_t *p;
+   DtlsDatagram *rxBatch;
+
+   //Check parameters
+   if(listener == NULL || batchSize < 1 || batchSize > DTLS_MAX_BATCH_SIZE)
+      return ERROR_INVALID_PARAMETER;
+
+   //The callbacks cannot be changed once contexts are bound to the listener
+   if(listener->numContexts > 0)
+      return ERROR_WRONG_STATE;
+
+   //Initialize pointer
+   rxBatch = NULL;
+
+   //Batched receive?
+   if(receiveBatchCallback != NULL)
+   {
+      //Size of the memory required
+      n = batchSize * (sizeof(DtlsDatagram) + sizeof(DtlsPeerAddr) +
+         listener->bufferSize);
+
+      //Allocate a memory buffer to hold the datagrams of a batch
+      rxBatch = tlsAllocMem(n);
+      //Failed to allocate memory?
+      if(rxBatch == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Clear memory
+      memset(rxBatch, 0, n);
+
+      //The peer addresses and the datagram buffers follow the descriptors
+      p = (uint8_t *) (rxBatch + batchSize);
+
+      //Initialize the descriptors
+      for(i = 0; i < batchSize; i++)
+      {
+         rxBatch[i].peerAddr = (DtlsPeerAddr *) p + i;
+      }
+
+      //Point to the first datagram buffer
+      p += batchSize * sizeof(DtlsPeerAddr);
+
+      //Each datagram has its own buffer
+      for(i = 0; i < batchSize; i++)
+      {
+         rxBatch[i].data = p + i * listener->bufferSize;
+         rxBatch[i].size = listener->bufferSize;
+      }
+   }
+
+   //Release the previous batch, if any
+   if(listener->rxBatch != NULL)
+   {
+      tlsFreeMem(listener->rxBatch);
+   }
+
+   //Save batched datagram I/O callbacks
+   listener->sendBatchCallback = sendBatchCallback;
+   listener->receiveBatchCallback = receiveBatchCallback;
+   listener->batchSize = batchSize;
+   listener->rxBatch = rxBatch;
+   listener->rxBatchCount = 0;
+   listener->rxBatchPos = 0;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Wait for the next datagram and find the context it belongs to
+ *
+ * Only the address of the peer is peeked from the socket. The datagram
+ * itself is received by the context, directly into its own receive buffer,
+ * when the application drives it (tlsConnect, tlsRead...)
+ *
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[out] context TLS context that has a datagram to process
+ * @return Error code
+ **/
+
+error_t dtlsPollListener(DtlsListener *listener, TlsContext **context)
+{
+   error_t error;
+   size_t n;
+   uint8_t header[sizeof(DtlsRecord) + DTLS_MAX_CID_SIZE];
+   DtlsPeerAddr peerAddr;
+   DtlsDatagram *datagram;
+
+   //Check parameters
+   if(listener == NULL || context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize pointer
+   *context = NULL;
+
+   //Acquire exclusive access to the listener
+   osAcquireMutex(&listener->mutex);
+
+   //The ClientHello of a newly accepted peer must be delivered first
+   if(listener->bufferLen > 0 && listener->pendingContext != NULL)
+   {
+      *context = listener->pendingContext;
+      error = NO_ERROR;
+   }
+   else if(listener->receiveBatchCallback != NULL)
+   {
+      //All the datagrams of the last batch have been dispatched?
+      if(listener->rxBatchPos >= listener->rxBatchCount)
+      {
+         //Receive a new batch of datagrams
+         error = dtlsReceiveListenerBatch(listener);
+      }
+      else
+      {
+         //Dispatch the next datagram
+         error = NO_ERROR;
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Point to the next datagram of the batch
+         datagram = &listener->rxBatch[listener->rxBatchPos];
+
+         //Look up the context the datagram belongs to
+         *context = dtlsLookupListenerContext(listener, datagram->data,
+            datagram->length, datagram->peerAddr);
+
+         //Datagram from an unknown peer?
+         if(*context == NULL)
+         {
+            //The datagram is processed by the listener itself
+            n = MIN(datagram->length, listener->bufferSize);
+            memcpy(listener->buffer, datagram->data, n);
+            peerAddr = *datagram->peerAddr;
+
+            //The datagram has been consumed
+            listener->rxBatchPos++;
+         }
+
+         //The datagram will be received by this context
+         listener->pendingContext = *context;
+      }
+   }
+   else
+   {
+      //Peek the address of the peer and the header of the first record
+      error = listener->receiveCallback(listener->socketHandle, header,
+         sizeof(header), &n, &peerAddr, TLS_FLAG_PEEK);
+
+      //Check status code
+      if(!error)
+      {
+         //Look up the context the datagram belongs to
+         *context = dtlsLookupListenerContext(listener, header, n, &peerAddr);
+
+         //The datagram will be received by this context
+         listener->pendingContext = *context;
+      }
+   }
+
+   //Release exclusive access to the listener
+   osReleaseMutex(&listener->mutex);
+
+   //Datagram from an unknown peer?
+   if(!error && *context == NULL)
+   {
+      //Receive the datagram, unless it has been taken from the last batch
+      if(listener->receiveBatchCallback == NULL)
+      {
+         error = listener->receiveCallback(listener->socketHandle,
+            listener->buffer, listener->bufferSize, &n, &peerAddr, 0);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Only a ClientHello can create a new session
+         error = dtlsProcessListenerClientHello(listener, &peerAddr, n,
+            context);
+
+         //Silently discard datagrams that do not create a session
+         if(error)
+         {
+            listener->dropCount++;
+         }
+
+         //Nothing for the application to process
+         if(*context == NULL)
+         {
+            error = ERROR_WOULD_BLOCK;
+         }
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Find the context an incoming datagram belongs to
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] data Beginning of the datagram
+ * @param[in] length Number of bytes available
+ * @param[in] peerAddr Address of the peer
+ * @return Pointer to the matching context, if any
+ **/
+
+TlsContext *dtlsLookupListenerContext(DtlsListener *listener,
+   const uint8_t *data, size_t length, const DtlsPeerAddr *peerAddr)
+{
+   TlsContext *context;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Record carrying a connection ID?
+   if(listener->cidLen > 0 && length >= (sizeof(DtlsRecord) + listener->cidLen) &&
+      data[0] == TLS_TYPE_TLS12_CID)
+   {
+      //The CID immediately follows the sequence number
+      context = dtlsFindListenerCidContext(listener,
+         data + offsetof(DtlsRecord, length));
+   }
+   else
+#endif
+   {
+      //Look up the context bound to the peer
+      context = dtlsFindListenerContext(listener, peerAddr);
+   }
+
+   //Return the matching context, if any
+   return context;
+}
+
+
+/**
+ * @brief Receive a batch of datagrams
+ * @param[in] listener Pointer to the DTLS listener
+ * @return Error code
+ **/
+
+error_t dtlsReceiveListenerBatch(DtlsListener *listener)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+
+   //Each datagram is received in its own buffer
+   for(i = 0; i < listener->batchSize; i++)
+   {
+      listener->rxBatch[i].size = listener->bufferSize;
+      listener->rxBatch[i].length = 0;
+   }
+
+   //Receive as many datagrams as possible at once
+   error = listener->receiveBatchCallback(listener->socketHandle,
+      listener->rxBatch, listener->batchSize, &n, 0);
+
+   //Check status code
+   if(!error)
+   {
+      //Empty batch?
+      if(n == 0)
+      {
+         error = ERROR_WOULD_BLOCK;
+      }
+      else
+      {
+         //Save the number of datagrams in the batch
+         listener->rxBatchCount = MIN(n, listener->batchSize);
+         listener->rxBatchPos = 0;
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Hand over the next datagram of the last batch to a context
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[out] data Buffer where to copy the datagram
+ * @param[in] size Size of the buffer
+ * @param[out] received Length of the datagram
+ * @param[out] peerAddr Address of the peer
+ * @return Error code
+ **/
+
+error_t dtlsDeliverListenerDatagram(DtlsListener *listener, void *data,
+   size_t size, size_t *received, DtlsPeerAddr *peerAddr)
+{
+   error_t error;
+   DtlsDatagram *datagram;
+
+   //Any datagram left in the batch?
+   if(listener->rxBatchPos < listener->rxBatchCount)
+   {
+      //Point to the next datagram
+      datagram = &listener->rxBatch[listener->rxBatchPos];
+
+      //Make sure the datagram fits in the buffer of the context
+      if(datagram->length <= size)
+      {
+         //Copy the datagram
+         memcpy(data, datagram->data, datagram->length);
+         *received = datagram->length;
+         *peerAddr = *datagram->peerAddr;
+
+         //Successful processing
+         error = NO_ERROR;
+      }
+      else
+      {
+         //Report an error
+         error = ERROR_BUFFER_OVERFLOW;
+      }
+
+      //The datagram has been consumed
+      listener->rxBatchPos++;
+   }
+   else
+   {
+      //No datagram is available
+      error = ERROR_WOULD_BLOCK;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Hash a peer address
+ * @param[in] peerAddr Address of the peer
+ * @return Hash value (FNV-1a)
+ **/
+
+uint32_t dtlsComputePeerAddrHash(const DtlsPeerAddr *peerAddr)
+{
+   size_t i;
+   uint32_t h;
+
+   //Offset basis
+   h = 2166136261U;
+
+   //Digest the address of the peer
+   for(i = 0; i < peerAddr->length; i++)
+   {
+      h = (h ^ peerAddr->value[i]) * 16777619U;
+   }
+
+   //Return the resulting hash value
+   return h;
+}
+
+
+/**
+ * @brief Find the context bound to a given peer
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] peerAddr Address of the peer
+ * @return Pointer to the matching context, if any
+ **/
+
+TlsContext *dtlsFindListenerContext(DtlsListener *listener,
+   const DtlsPeerAddr *peerAddr)
+{
+   uint32_t h;
+   TlsContext *context;
+
+   //Hash the address of the peer
+   h = dtlsComputePeerAddrHash(peerAddr);
+
+   //Walk through the matching bucket
+   for(context = listener->buckets[h & (listener->numBuckets - 1)];
+      context != NULL; context = context->listenerNext)
+   {
+      //Compare addresses
+      if(context->peerAddrHash == h &&
+         context->peerAddr.length == peerAddr->length &&
+         !memcmp(context->peerAddr.value, peerAddr->value, peerAddr->length))
+      {
+         break;
+      }
+   }
+
+   //Return the matching context, if any
+   return context;
+}
+
+
+/**
+ * @brief Find the context a connection ID was assigned to
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] cid Connection ID (listener->cidLen bytes)
+ * @return Pointer to the matching context, if any
+ **/
+
+TlsContext *dtlsFindListenerCidContext(DtlsListener *listener,
+   const uint8_t *cid)
+{
+#if (DTLS_CID_SUPPORT == ENABLED)
+   uint32_t h;
+   TlsContext *context;
+   DtlsPeerAddr key;
+
+   //The CID is hashed the same way as a peer address
+   key.length = listener->cidLen;
+   memcpy(key.value, cid, listener->cidLen);
+   h = dtlsComputePeerAddrHash(&key);
+
+   //Walk through the matching bucket
+   for(context = listener->cidBuckets[h & (listener->numBuckets - 1)];
+      context != NULL; context = context->cidNext)
+   {
+      //Compare connection IDs
+      if(context->localCidHash == h &&
+         !memcmp(context->localCid, cid, listener->cidLen))
+      {
+         break;
+      }
+   }
+
+   //Return the matching context, if any
+   return context;
+#else
+   //Not implemented
+   return NULL;
+#endif
+}
+
+
+/**
+ * @brief Bind a context to the listener
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] context Pointer to the TLS context
+ * @param[in] peerAddr Address of the peer
+ * @return Error code
+ **/
+
+error_t dtlsAttachListenerContext(DtlsListener *listener, TlsContext *context,
+   const DtlsPeerAddr *peerAddr)
+{
+   uint_t i;
+
+   //Only DTLS servers can be bound to a listener
+   if(context->entity != TLS_CONNECTION_END_SERVER ||
+      context->transportProtocol != TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //A context is bound to one listener at most
+   if(context->listener != NULL)
+      return ERROR_WRONG_STATE;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Connection IDs assigned by the listener?
+   if(listener->cidLen > 0)
+   {
+      error_t error;
+      DtlsPeerAddr key;
+
+      //Sanity check
+      if(context->prngAlgo == NULL || context->prngContext == NULL)
+         return ERROR_NOT_CONFIGURED;
+
+      //Generate a random CID that is not already in use
+      do
+      {
+         //Generate a random value
+         error = context->prngAlgo->read(context->prngContext,
+            context->localCid, listener->cidLen);
+         //Any error to report?
+         if(error)
+            return error;
+
+      } while(dtlsFindListenerCidContext(listener, context->localCid) != NULL);
+
+      //The CID is hashed the same way as a peer address
+      key.length = listener->cidLen;
+      memcpy(key.value, context->localCid, listener->cidLen);
+
+      //The peer will be asked to use this CID
+      context->localCidLen = listener->cidLen;
+      context->localCidHash = dtlsComputePeerAddrHash(&key);
+      context->cidEnabled = TRUE;
+
+      //Insert the context at the head of its CID bucket
+      i = context->localCidHash & (listener->numBuckets - 1);
+      context->cidNext = listener->cidBuckets[i];
+      listener->cidBuckets[i] = context;
+   }
+#endif
+
+   //Save the address of the peer
+   context->peerAddr = *peerAddr;
+   context->peerAddrHash = dtlsComputePeerAddrHash(peerAddr);
+
+   //The context sends and receives through the listener
+   context->socketSendCallback = dtlsListenerSocketSend;
+   context->socketReceiveCallback = dtlsListenerSocketReceive;
+   context->socketHandle = (TlsSocketHandle) context;
+
+   //Batched send?
+   if(listener->sendBatchCallback != NULL)
+   {
+      context->socketSendBatchCallback = dtlsListenerSocketSendBatch;
+   }
+
+   //Insert the context at the head of its bucket
+   i = context->peerAddrHash & (listener->numBuckets - 1);
+   context->listenerNext = listener->buckets[i];
+   listener->buckets[i] = context;
+   listener->numContexts++;
+
+   //Save the listener
+   context->listener = listener;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Unbind a context from its listener
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void dtlsDetachListenerContext(TlsContext *context)
+{
+   TlsContext **p;
+   DtlsListener *listener;
+
+   //Point to the listener
+   listener = context->listener;
+
+   //Acquire exclusive access to the listener
+   osAcquireMutex(&listener->mutex);
+
+   //Walk through the matching bucket
+   p = &listener->buckets[context->peerAddrHash & (listener->numBuckets - 1)];
+
+   while(*p != NULL && *p != context)
+   {
+      p = &(*p)->listenerNext;
+   }
+
+   //Remove the context from the hash table
+   if(*p != NULL)
+   {
+      *p = context->listenerNext;
+      listener->numContexts--;
+   }
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Connection ID assigned by the listener?
+   if(listener->cidLen > 0 && context->localCidLen == listener->cidLen)
+   {
+      //Walk through the matching CID bucket
+      p = &listener->cidBuckets[context->localCidHash &
+         (listener->numBuckets - 1)];
+
+      while(*p != NULL && *p != context)
+      {
+         p = &(*p)->cidNext;
+      }
+
+      //Remove the context from the CID hash table
+      if(*p != NULL)
+      {
+         *p = context->cidNext;
+      }
+   }
+#endif
+
+   //Forget any datagram waiting for this context
+   if(listener->pendingContext == context)
+   {
+      listener->pendingContext = NULL;
+      listener->bufferLen = 0;
+   }
+
+   //Release exclusive access to the listener
+   osReleaseMutex(&listener->mutex);
+
+   //The context is no longer bound to the listener
+   context->listener = NULL;
+   context->listenerNext = NULL;
+#if (DTLS_CID_SUPPORT == ENABLED)
+   context->cidNext = NULL;
+#endif
+}
+
+
+/**
+ * @brief Move a context to the peer address it was last reached at
+ *
+ * Called once a record routed by CID from a new address has been
+ * authenticated and found to be newer than any other record received
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void dtlsUpdateListenerPeerAddr(TlsContext *context)
+{
+#if (DTLS_CID_SUPPORT == ENABLED)
+   uint_t i;
+   TlsContext **p;
+   DtlsListener *listener;
+
+   //Point to the listener
+   listener = context->listener;
+
+   //Acquire exclusive access to the listener
+   osAcquireMutex(&listener->mutex);
+
+   //Walk through the bucket matching the former address
+   p = &listener->buckets[context->peerAddrHash & (listener->numBuckets - 1)];
+
+   while(*p != NULL && *p != context)
+   {
+      p = &(*p)->listenerNext;
+   }
+
+   //Remove the context from its former bucket
+   if(*p != NULL)
+   {
+      *p = context->listenerNext;
+   }
+
+   //Debug message
+   TRACE_INFO("DTLS peer address changed (routed by CID)\r\n");
+
+   //Save the new address of the peer
+   context->peerAddr = context->rxPeerAddr;
+   context->peerAddrHash = dtlsComputePeerAddrHash(&context->peerAddr);
+
+   //Insert the context at the head of its new bucket
+   i = context->peerAddrHash & (listener->numBuckets - 1);
+   context->listenerNext = listener->buckets[i];
+   listener->buckets[i] = context;
+
+   //Release exclusive access to the listener
+   osReleaseMutex(&listener->mutex);
+#endif
+}
+
+
+/**
+ * @brief Parse a ClientHello without any per-client state
+ *
+ * Only unfragmented ClientHello messages sent in epoch 0 are accepted,
+ * which is all a well-behaved client sends before the cookie exchange
+ *
+ * @param[in] data Pointer to the datagram
+ * @param[in] length Length of the datagram
+ * @param[out] record DTLS record that carries the ClientHello
+ * @param[out] message DTLS handshake message header
+ * @param[out] clientParams Client's parameters
+ * @param[out] cookie Cookie returned by the client
+ * @return Error code
+ **/
+
+error_t dtlsParseListenerClientHello(const uint8_t *data, size_t length,
+   const DtlsRecord **record, const DtlsHandshake **message,
+   DtlsClientParameters *clientParams, const DtlsCookie **cookie)
+{
+   size_t n;
+   const uint8_t *p;
+   const TlsClientHello *clientHello;
+   const TlsCipherSuites *cipherSuites;
+   const TlsCompressMethods *compressMethods;
+
+   //Point to the DTLS record
+   *record = (const DtlsRecord *) data;
+
+   //Malformed record?
+   if(length < sizeof(DtlsRecord))
+      return ERROR_INVALID_LENGTH;
+   if(ntohs((*record)->length) > (length - sizeof(DtlsRecord)))
+      return ERROR_INVALID_LENGTH;
+
+   //ClientHello messages are sent in cleartext during epoch 0
+   if((*record)->type != TLS_TYPE_HANDSHAKE || ntohs((*record)->epoch) != 0)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Compliant servers must accept any value {254,XX} as the record layer
+   //version number for ClientHello
+   if(MSB(ntohs((*record)->version)) != MSB(DTLS_VERSION_1_0))
+      return ERROR_VERSION_NOT_SUPPORTED;
+
+   //Point to the handshake message
+   *message = (const DtlsHandshake *) (*record)->data;
+   //Length of the record payload
+   n = ntohs((*record)->length);
+
+   //Malformed handshake message?
+   if(n < sizeof(DtlsHandshake))
+      return ERROR_DECODING_FAILED;
+
+   //Check message type
+   if((*message)->msgType != TLS_TYPE_CLIENT_HELLO)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //The ClientHello must fit in a single fragment
+   if(LOAD24BE((*message)->fragOffset) != 0 ||
+      LOAD24BE((*message)->fragLength) != LOAD24BE((*message)->length) ||
+      LOAD24BE((*message)->fragLength) > (n - sizeof(DtlsHandshake)))
+   {
+      return ERROR_DECODING_FAILED;
+   }
+
+   //Point to the ClientHello
+   clientHello = (const TlsClientHello *) (*message)->data;
+   //Length of the ClientHello
+   n = LOAD24BE((*message)->length);
+
+   //Check the length of the ClientHello message
+   if(n < sizeof(TlsClientHello))
+      return ERROR_DECODING_FAILED;
+
+   //Point to the session ID
+   p = clientHello->sessionId;
+   //Remaining bytes to process
+   n -= sizeof(TlsClientHello);
+
+   //Check the length of the session ID
+   if(clientHello->sessionIdLen > n || clientHello->sessionIdLen > 32)
+      return ERROR_DECODING_FAILED;
+
+   //Point to the next field
+   p += clientHello->sessionIdLen;
+   n -= clientHello->sessionIdLen;
+
+   //Point to the Cookie field
+   *cookie = (const DtlsCookie *) p;
+
+   //Malformed ClientHello message?
+   if(n < sizeof(DtlsCookie) || n < (sizeof(DtlsCookie) + (*cookie)->length))
+      return ERROR_DECODING_FAILED;
+   if((*cookie)->length > DTLS_MAX_COOKIE_SIZE)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Point to the next field
+   p += sizeof(DtlsCookie) + (*cookie)->length;
+   n -= sizeof(DtlsCookie) + (*cookie)->length;
+
+   //List of cryptographic algorithms supported by the client
+   cipherSuites = (const TlsCipherSuites *) p;
+
+   //Malformed ClientHello message?
+   if(n < sizeof(TlsCipherSuites) ||
+      n < (sizeof(TlsCipherSuites) + ntohs(cipherSuites->length)))
+   {
+      return ERROR_DECODING_FAILED;
+   }
+
+   //Point to the next field
+   p += sizeof(TlsCipherSuites) + ntohs(cipherSuites->length);
+   n -= sizeof(TlsCipherSuites) + ntohs(cipherSuites->length);
+
+   //List of compression algorithms supported by the client
+   compressMethods = (const TlsCompressMethods *) p;
+
+   //Malformed ClientHello message?
+   if(n < sizeof(TlsCompressMethods) ||
+      n < (sizeof(TlsCompressMethods) + compressMethods->length))
+   {
+      return ERROR_DECODING_FAILED;
+   }
+
+   //The server should use client parameters (version, random, session_id,
+   //cipher_suites, compression_method) to generate its cookie
+   clientParams->version = ntohs(clientHello->clientVersion);
+   clientParams->random = clientHello->random;
+   clientParams->randomLen = 32;
+   clientParams->sessionId = clientHello->sessionId;
+   clientParams->sessionIdLen = clientHello->sessionIdLen;
+   clientParams->cipherSuites = (const uint8_t *) cipherSuites->value;
+   clientParams->cipherSuitesLen = ntohs(cipherSuites->length);
+   clientParams->compressMethods = compressMethods->value;
+   clientParams->compressMethodsLen = compressMethods->length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process a datagram received from an unknown peer
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] peerAddr Address of the peer
+ * @param[in] length Length of the datagram held in the listener buffer
+ * @param[out] context Newly created context, if the cookie is valid
+ * @return Error code
+ **/
+
+error_t dtlsProcessListenerClientHello(DtlsListener *listener,
+   const DtlsPeerAddr *peerAddr, size_t length, TlsContext **context)
+{
+   error_t error;
+   TlsContext *newContext;
+   const DtlsRecord *record;
+   const DtlsHandshake *message;
+   const DtlsCookie *cookie;
+   DtlsClientParameters clientParams;
+
+   //Parse the ClientHello without allocating anything
+   error = dtlsParseListenerClientHello(listener->buffer, length, &record,
+      &message, &clientParams, &cookie);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Any registered cookie callbacks?
+   if(listener->cookieVerifyCallback != NULL &&
+      listener->cookieGenerateCallback != NULL)
+   {
+      //Verify that the cookie is valid
+      error = listener->cookieVerifyCallback(NULL, &clientParams,
+         cookie->value, cookie->length, listener->cookieParam);
+
+      //Invalid cookie?
+      if(error == ERROR_WRONG_COOKIE)
+      {
+         //Answer with a stateless HelloVerifyRequest
+         return dtlsSendListenerHelloVerifyRequest(listener, peerAddr, record,
+            message, &clientParams);
+      }
+      else if(error)
+      {
+         //Report an error
+         return error;
+      }
+   }
+
+   //No accept callback registered?
+   if(listener->acceptCallback == NULL)
+      return ERROR_WRONG_STATE;
+
+   //The peer has proven it can receive datagrams at its address. The context
+   //is only allocated at this point
+   newContext = listener->acceptCallback(listener, peerAddr,
+      listener->acceptParam);
+   //The application refused the peer?
+   if(newContext == NULL)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Acquire exclusive access to the listener
+   osAcquireMutex(&listener->mutex);
+
+   //Bind the context to the listener
+   error = dtlsAttachListenerContext(listener, newContext, peerAddr);
+
+   //Check status code
+   if(!error)
+   {
+      //The ClientHello is delivered to the new context on its first read
+      listener->pendingContext = newContext;
+      listener->bufferLen = length;
+      *context = newContext;
+   }
+
+   //Release exclusive access to the listener
+   osReleaseMutex(&listener->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send a stateless HelloVerifyRequest
+ * @param[in] listener Pointer to the DTLS listener
+ * @param[in] peerAddr Address of the peer
+ * @param[in] record DTLS record that carries the ClientHello
+ * @param[in] message ClientHello message header
+ * @param[in] clientParams Client's parameters
+ * @return Error code
+ **/
+
+error_t dtlsSendListenerHelloVerifyRequest(DtlsListener *listener,
+   const DtlsPeerAddr *peerAddr, const DtlsRecord *record,
+   const DtlsHandshake *message, const DtlsClientParameters *clientParams)
+{
+   error_t error;
+   size_t n;
+   size_t cookieLen;
+   DtlsRecord *hvrRecord;
+   DtlsHandshake *hvrMessage;
+   DtlsHelloVerifyRequest *hvr;
+   uint8_t buffer[sizeof(DtlsRecord) + sizeof(DtlsHandshake) +
+      sizeof(DtlsHelloVerifyRequest) + DTLS_MAX_COOKIE_SIZE];
+
+   //Point to the HelloVerifyRequest message
+   hvrRecord = (DtlsRecord *) buffer;
+   hvrMessage = (DtlsHandshake *) hvrRecord->data;
+   hvr = (DtlsHelloVerifyRequest *) hvrMessage->data;
+
+   //Set the cookie size limit (32 or 255 bytes depending on DTLS version)
+   cookieLen = DTLS_MAX_COOKIE_SIZE;
+
+   //The DTLS server should generate cookies in such a way that they can be
+   //verified without retaining any per-client state on the server
+   error = listener->cookieGenerateCallback(NULL, clientParams, hvr->cookie,
+      &cookieLen, listener->cookieParam);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Sanity check
+   if(cookieLen > DTLS_MAX_COOKIE_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //In order to avoid the requirement to do version negotiation in the
+   //initial handshake, DTLS 1.2 server implementations should use DTLS
+   //version 1.0 regardless of the version of TLS that is expected to be
+   //negotiated
+   hvr->serverVersion = HTONS(DTLS_VERSION_1_0);
+   hvr->cookieLength = (uint8_t) cookieLen;
+
+   //Length of the HelloVerifyRequest message
+   n = sizeof(DtlsHelloVerifyRequest) + cookieLen;
+
+   //Format handshake message header. The message sequence number of the
+   //ClientHello is echoed back
+   hvrMessage->msgType = TLS_TYPE_HELLO_VERIFY_REQUEST;
+   STORE24BE(n, hvrMessage->length);
+   hvrMessage->msgSeq = message->msgSeq;
+   STORE24BE(0, hvrMessage->fragOffset);
+   STORE24BE(n, hvrMessage->fragLength);
+
+   //Length of the record payload
+   n += sizeof(DtlsHandshake);
+
+   //The server must use the record sequence number in the ClientHello as the
+   //record sequence number in its HelloVerifyRequest
+   hvrRecord->type = TLS_TYPE_HANDSHAKE;
+   hvrRecord->version = HTONS(DTLS_VERSION_1_0);
+   hvrRecord->epoch = HTONS(0);
+   hvrRecord->seqNum = record->seqNum;
+   hvrRecord->length = htons(n);
+
+   //Length of the datagram
+   n += sizeof(DtlsRecord);
+
+   //Debug message
+   TRACE_INFO("Sending stateless HelloVerifyRequest (%" PRIuSIZE " bytes)...\r\n", n);
+   TRACE_DEBUG_ARRAY("  ", buffer, n);
+
+   //Send datagram
+   error = listener->sendCallback(listener->socketHandle, buffer, n, peerAddr);
+
+   //Check status code
+   if(!error)
+   {
+      listener->helloVerifyCount++;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send callback of the contexts bound to a listener
+ * @param[in] handle Pointer to the TLS context
+ * @param[in] data Pointer to the datagram
+ * @param[in] length Length of the datagram
+ * @param[out] written Number of bytes that have been sent
+ * @param[in] flags Unused parameter
+ * @return Error code
+ **/
+
+error_t dtlsListenerSocketSend(TlsSocketHandle handle, const void *data,
+   size_t length, size_t *written, uint_t flags)
+{
+   error_t error;
+   TlsContext *context;
+
+   //Point to the TLS context
+   context = (TlsContext *) handle;
+
+   //Send the datagram to the peer through the shared socket
+   error = context->listener->sendCallback(context->listener->socketHandle,
+      data, length, &context->peerAddr);
+
+   //Check status code
+   if(!error)
+   {
+      //Total number of bytes that have been sent
+      *written = length;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send batch callback of the contexts bound to a listener
+ * @param[in] handle Pointer to the TLS context
+ * @param[in] datagrams Datagrams to be sent
+ * @param[in] count Number of datagrams
+ * @param[out] sent Number of datagrams that have been sent
+ * @param[in] flags Unused parameter
+ * @return Error code
+ **/
+
+error_t dtlsListenerSocketSendBatch(TlsSocketHandle handle,
+   const DtlsDatagram *datagrams, uint_t count, uint_t *sent, uint_t flags)
+{
+   uint_t i;
+   TlsContext *context;
+   DtlsDatagram batch[DTLS_MAX_BATCH_SIZE];
+
+   //Point to the TLS context
+   context = (TlsContext *) handle;
+
+   //Sanity check
+   if(count > DTLS_MAX_BATCH_SIZE)
+      count = DTLS_MAX_BATCH_SIZE;
+
+   //All the datagrams are sent to the peer of the context
+   for(i = 0; i < count; i++)
+   {
+      batch[i] = datagrams[i];
+      batch[i].peerAddr = &context->peerAddr;
+   }
+
+   //Send the datagrams through the shared socket
+   return context->listener->sendBatchCallback(context->listener->socketHandle,
+      batch, count, sent);
+}
+
+
+/**
+ * @brief Receive callback of the contexts bound to a listener
+ * @param[in] handle Pointer to the TLS context
+ * @param[out] data Buffer where to store the incoming datagram
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Unused parameter
+ * @return Error code
+ **/
+
+error_t dtlsListenerSocketReceive(TlsSocketHandle handle, void *data,
+   size_t size, size_t *received, uint_t flags)
+{
+   error_t error;
+   TlsContext *context;
+   DtlsListener *listener;
+   DtlsPeerAddr peerAddr;
+
+   //Point to the TLS context
+   context = (TlsContext *) handle;
+   //Point to the listener
+   listener = context->listener;
+
+   //Acquire exclusive access to the listener
+   osAcquireMutex(&listener->mutex);
+
+   //Does the waiting datagram belong to this context?
+   if(listener->pendingContext == context)
+   {
+      //ClientHello already received by the listener?
+      if(listener->bufferLen > 0)
+      {
+         //This copy only occurs once per session
+         if(listener->bufferLen <= size)
+         {
+            memcpy(data, listener->buffer, listener->bufferLen);
+            *received = listener->bufferLen;
+            error = NO_ERROR;
+         }
+         else
+         {
+            error = ERROR_BUFFER_OVERFLOW;
+         }
+
+         //The buffer is available again
+         listener->bufferLen = 0;
+      }
+      else
+      {
+         //Batched datagram I/O?
+         if(listener->receiveBatchCallback != NULL)
+         {
+            //Deliver the datagram from the last batch
+            error = dtlsDeliverListenerDatagram(listener, data, size, received,
+               &peerAddr);
+         }
+         else
+         {
+            //Receive the datagram directly into the buffer of the context
+            error = listener->receiveCallback(listener->socketHandle, data,
+               size, received, &peerAddr, 0);
+         }
+
+         //Check status code
+         if(!error && (peerAddr.length != context->peerAddr.length ||
+            memcmp(peerAddr.value, context->peerAddr.value, peerAddr.length)))
+         {
+#if (DTLS_CID_SUPPORT == ENABLED)
+            //Datagrams routed by CID may come from a new address. The
+            //address is only updated once the record has been authenticated
+            if(context->decryptionEngine.cidLen > 0)
+            {
+               context->rxPeerAddr = peerAddr;
+               context->rxPeerAddrChanged = TRUE;
+            }
+            else
+#endif
+            {
+               //Another socket user may have consumed the peeked datagram
+               listener->dropCount++;
+               error = ERROR_WOULD_BLOCK;
+            }
+         }
+#if (DTLS_CID_SUPPORT == ENABLED)
+         else
+         {
+            //The datagram comes from the current address of the peer
+            context->rxPeerAddrChanged = FALSE;
+         }
+#endif
+      }
+
+      //The datagram has been consumed
+      listener->pendingContext = NULL;
+   }
+   else
+   {
+      //No datagram is available for this context
+      error = ERROR_WOULD_BLOCK;
+   }
+
+   //Release exclusive access to the listener
+   osReleaseMutex(&listener->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release DTLS listener
+ *
+ * The contexts bound to the listener must be released first
+ *
+ * @param[in] listener Pointer to the DTLS listener
+ **/
+
+void dtlsFreeListener(DtlsListener *listener)
+{
+   //Valid listener?
+   if(listener != NULL)
+   {
+      //Release previously allocated resources
+      osDeleteMutex(&listener->mutex);
+
+      //Release the datagrams of the last batch
+      if(listener->rxBatch != NULL)
+      {
+         tlsFreeMem(listener->rxBatch);
+      }
+
+      //Clear the listener before freeing memory
+      memset(listener, 0, sizeof(DtlsListener));
+      tlsFreeMem(listener);
+   }
+}
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * @file dtls_listener.h
+ * @brief DTLS listener (many DTLS sessions on a single UDP socket)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _DTLS_LISTENER_H
+#define _DTLS_LISTENER_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//DTLS listener related functions
+TlsContext *dtlsLookupListenerContext(DtlsListener *listener,
+   const uint8_t *data, size_t length, const DtlsPeerAddr *peerAddr);
+
+error_t dtlsReceiveListenerBatch(DtlsListener *listener);
+
+error_t dtlsDeliverListenerDatagram(DtlsListener *listener, void *data,
+   size_t size, size_t *received, DtlsPeerAddr *peerAddr);
+
+uint32_t dtlsComputePeerAddrHash(const DtlsPeerAddr *peerAddr);
+
+TlsContext *dtlsFindListenerContext(DtlsListener *listener,
+   const DtlsPeerAddr *peerAddr);
+
+TlsContext *dtlsFindListenerCidContext(DtlsListener *listener,
+   const uint8_t *cid);
+
+error_t dtlsAttachListenerContext(DtlsListener *listener, TlsContext *context,
+   const DtlsPeerAddr *peerAddr);
+
+void dtlsDetachListenerContext(TlsContext *context);
+void dtlsUpdateListenerPeerAddr(TlsContext *context);
+
+error_t dtlsParseListenerClientHello(const uint8_t *data, size_t length,
+   const DtlsRecord **record, const DtlsHandshake **message,
+   DtlsClientParameters *clientParams, const DtlsCookie **cookie);
+
+error_t dtlsProcessListenerClientHello(DtlsListener *listener,
+   const DtlsPeerAddr *peerAddr, size_t length, TlsContext **context);
+
+error_t dtlsSendListenerHelloVerifyRequest(DtlsListener *listener,
+   const DtlsPeerAddr *peerAddr, const DtlsRecord *record,
+   const DtlsHandshake *message, const DtlsClientParameters *clientParams);
+
+error_t dtlsListenerSocketSend(TlsSocketHandle handle, const void *data,
+   size_t length, size_t *written, uint_t flags);
+
+error_t dtlsListenerSocketSendBatch(TlsSocketHandle handle,
+   const DtlsDatagram *datagrams, uint_t count, uint_t *sent, uint_t flags);
+
+error_t dtlsListenerSocketReceive(TlsSocketHandle handle, void *data,
+   size_t size, size_t *received, uint_t flags);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
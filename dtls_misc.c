@@ -435,22 +435,536 @@ error_t dtlsParseClientSupportedVersionsExtension(TlsContext *context,
 
 
 /**
- * @brief Initialize sliding window
+ * @brief Format ConnectionId extension (ClientHello)
  * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the ConnectionId extension
+ * @param[out] written Total number of bytes that have been written
  * @return Error code
  **/
 
-void dtlsInitReplayWindow(TlsContext *context)
+error_t dtlsFormatClientConnectionIdExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
 {
-#if (DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   size_t n = 0;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //DTLS protocol and ConnectionId extension enabled?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM &&
+      context->cidEnabled)
+   {
+      TlsExtension *extension;
+      DtlsConnectionId *connectionId;
+
+      //Add the ConnectionId extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_CONNECTION_ID);
+
+      //Point to the extension data field
+      connectionId = (DtlsConnectionId *) extension->value;
+
+      //The extension carries the CID the client wishes the server to use
+      //when sending messages to the client
+      connectionId->length = (uint8_t) context->localCidLen;
+      memcpy(connectionId->value, context->localCid, context->localCidLen);
+
+      //Length of the extension data field
+      n = sizeof(DtlsConnectionId) + context->localCidLen;
+      //Fix the length of the extension
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the ConnectionId extension
+      n += sizeof(TlsExtension);
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format ConnectionId extension (ServerHello)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the ConnectionId extension
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t dtlsFormatServerConnectionIdExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   size_t n = 0;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //An extension type must not appear in the ServerHello unless the same
+   //extension type appeared in the corresponding ClientHello
+   if(context->cidNegotiated)
+   {
+      TlsExtension *extension;
+      DtlsConnectionId *connectionId;
+
+      //Add the ConnectionId extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_CONNECTION_ID);
+
+      //Point to the extension data field
+      connectionId = (DtlsConnectionId *) extension->value;
+
+      //The extension carries the CID the server wishes the client to use
+      //when sending messages to the server
+      connectionId->length = (uint8_t) context->localCidLen;
+      memcpy(connectionId->value, context->localCid, context->localCidLen);
+
+      //Length of the extension data field
+      n = sizeof(DtlsConnectionId) + context->localCidLen;
+      //Fix the length of the extension
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the ConnectionId extension
+      n += sizeof(TlsExtension);
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse ConnectionId extension (ClientHello)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] connectionId Pointer to the ConnectionId extension
+ * @return Error code
+ **/
+
+error_t dtlsParseClientConnectionIdExtension(TlsContext *context,
+   const DtlsConnectionId *connectionId)
+{
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //The CID is only negotiated if the server supports it and the client
+   //asks for a length the server can accommodate
+   if(connectionId != NULL && context->cidEnabled &&
+      connectionId->length <= DTLS_MAX_CID_SIZE)
+   {
+      //Save the CID the server must use when sending records
+      memcpy(context->peerCid, connectionId->value, connectionId->length);
+      context->peerCidLen = connectionId->length;
+
+      //The ConnectionId extension has been successfully negotiated
+      context->cidNegotiated = TRUE;
+   }
+   else
+   {
+      //Records are sent without CID
+      context->cidNegotiated = FALSE;
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse ConnectionId extension (ServerHello)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] connectionId Pointer to the ConnectionId extension
+ * @return Error code
+ **/
+
+error_t dtlsParseServerConnectionIdExtension(TlsContext *context,
+   const DtlsConnectionId *connectionId)
+{
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //ConnectionId extension found?
+   if(connectionId != NULL)
+   {
+      //The server must not send the extension unless the client offered it
+      if(!context->cidEnabled)
+         return ERROR_UNSUPPORTED_EXTENSION;
+
+      //Check the length of the connection ID
+      if(connectionId->length > DTLS_MAX_CID_SIZE)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Save the CID the client must use when sending records
+      memcpy(context->peerCid, connectionId->value, connectionId->length);
+      context->peerCidLen = connectionId->length;
+
+      //The ConnectionId extension has been successfully negotiated
+      context->cidNegotiated = TRUE;
+   }
+   else
+   {
+      //The ConnectionId extension is not supported by the server
+      context->cidNegotiated = FALSE;
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format UseSrtp extension (ClientHello)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the UseSrtp extension
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t dtlsFormatClientUseSrtpExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   size_t n = 0;
+
+#if (DTLS_SRTP_SUPPORT == ENABLED)
+   //DTLS protocol and SRTP protection profiles configured?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM &&
+      context->numSrtpProfiles > 0)
+   {
+      uint_t i;
+      TlsExtension *extension;
+      DtlsSrtpProtectionProfiles *profiles;
+
+      //Add the UseSrtp extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_USE_SRTP);
+
+      //Point to the extension data field
+      profiles = (DtlsSrtpProtectionProfiles *) extension->value;
+
+      //List the supported protection profiles, in order of preference
+      for(i = 0; i < context->numSrtpProfiles; i++)
+      {
+         profiles->value[i] = htons(context->srtpProfiles[i]);
+      }
+
+      //Length of the list, in bytes
+      n = context->numSrtpProfiles * sizeof(uint16_t);
+      //Fix the length of the list
+      profiles->length = htons(n);
+
+      //Point to the srtp_mki field
+      p = (uint8_t *) profiles->value + n;
+
+      //The client uses the MKI field to indicate the MKI it will put in
+      //the SRTP packets it sends
+      p[0] = (uint8_t) context->srtpMkiLen;
+      memcpy(p + 1, context->srtpMki, context->srtpMkiLen);
+
+      //Length of the extension data field
+      n += sizeof(DtlsSrtpProtectionProfiles) + 1 + context->srtpMkiLen;
+      //Fix the length of the extension
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the UseSrtp extension
+      n += sizeof(TlsExtension);
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format UseSrtp extension (ServerHello)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the UseSrtp extension
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t dtlsFormatServerUseSrtpExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   size_t n = 0;
+
+#if (DTLS_SRTP_SUPPORT == ENABLED)
+   //The extension is only sent back if a common protection profile has
+   //been selected
+   if(context->srtpProfile != DTLS_SRTP_PROFILE_NONE)
+   {
+      TlsExtension *extension;
+      DtlsSrtpProtectionProfiles *profiles;
+
+      //Add the UseSrtp extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_USE_SRTP);
+
+      //Point to the extension data field
+      profiles = (DtlsSrtpProtectionProfiles *) extension->value;
+
+      //The list must contain a single protection profile
+      profiles->length = HTONS(sizeof(uint16_t));
+      profiles->value[0] = htons(context->srtpProfile);
+
+      //Point to the srtp_mki field
+      p = (uint8_t *) profiles->value + sizeof(uint16_t);
+
+      //The server echoes the MKI offered by the client, or sends an empty
+      //MKI if it does not support it (refer to RFC 5764, section 4.1.1)
+      p[0] = (uint8_t) context->srtpMkiLen;
+      memcpy(p + 1, context->srtpMki, context->srtpMkiLen);
+
+      //Length of the extension data field
+      n = sizeof(DtlsSrtpProtectionProfiles) + sizeof(uint16_t) + 1 +
+         context->srtpMkiLen;
+      //Fix the length of the extension
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the UseSrtp extension
+      n += sizeof(TlsExtension);
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse UseSrtp extension (ClientHello)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] profiles Pointer to the UseSrtp extension
+ * @return Error code
+ **/
+
+error_t dtlsParseClientUseSrtpExtension(TlsContext *context,
+   const DtlsSrtpProtectionProfiles *profiles)
+{
+#if (DTLS_SRTP_SUPPORT == ENABLED)
    uint_t i;
+   uint_t j;
+   size_t n;
+   const uint8_t *mki;
 
-   //Clear the bitmap window
-   for(i = 0; i < (DTLS_REPLAY_WINDOW_SIZE + 31) / 32; i++)
+   //No protection profile selected so far
+   context->srtpProfile = DTLS_SRTP_PROFILE_NONE;
+
+   //UseSrtp extension found?
+   if(profiles != NULL && context->numSrtpProfiles > 0)
+   {
+      //Retrieve the number of profiles offered by the client
+      n = ntohs(profiles->length) / sizeof(uint16_t);
+
+      //Loop through the profiles supported by the server, in order of
+      //preference
+      for(i = 0; i < context->numSrtpProfiles; i++)
+      {
+         //Check whether the client offered the current profile
+         for(j = 0; j < n; j++)
+         {
+            if(ntohs(profiles->value[j]) == context->srtpProfiles[i])
+               break;
+         }
+
+         //Common protection profile found?
+         if(j < n)
+         {
+            context->srtpProfile = context->srtpProfiles[i];
+            break;
+         }
+      }
+
+      //Point to the srtp_mki field
+      mki = (uint8_t *) profiles->value + n * sizeof(uint16_t);
+
+      //The MKI is ignored if it does not fit in the context
+      if(mki[0] <= DTLS_MAX_SRTP_MKI_SIZE)
+      {
+         //Save the MKI so that it can be echoed in the ServerHello
+         memcpy(context->srtpMki, mki + 1, mki[0]);
+         context->srtpMkiLen = mki[0];
+      }
+      else
+      {
+         //An empty MKI tells the client that it is not supported
+         context->srtpMkiLen = 0;
+      }
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse UseSrtp extension (ServerHello)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] profiles Pointer to the UseSrtp extension
+ * @return Error code
+ **/
+
+error_t dtlsParseServerUseSrtpExtension(TlsContext *context,
+   const DtlsSrtpProtectionProfiles *profiles)
+{
+#if (DTLS_SRTP_SUPPORT == ENABLED)
+   uint_t i;
+   uint16_t profile;
+   const uint8_t *mki;
+
+   //UseSrtp extension found?
+   if(profiles != NULL)
    {
-      context->replayWindow[i] = 0;
+      //The server must not send the extension unless the client offered it
+      if(context->numSrtpProfiles == 0)
+         return ERROR_UNSUPPORTED_EXTENSION;
+
+      //The list must contain a single protection profile
+      if(ntohs(profiles->length) != sizeof(uint16_t))
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Retrieve the protection profile selected by the server
+      profile = ntohs(profiles->value[0]);
+
+      //Make sure the profile is one of those offered by the client
+      for(i = 0; i < context->numSrtpProfiles; i++)
+      {
+         if(context->srtpProfiles[i] == profile)
+            break;
+      }
+
+      //Unknown protection profile?
+      if(i >= context->numSrtpProfiles)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Point to the srtp_mki field
+      mki = (uint8_t *) profiles->value + sizeof(uint16_t);
+
+      //A nonzero-length MKI must match the one offered by the client
+      //(refer to RFC 5764, section 4.1.1)
+      if(mki[0] != 0)
+      {
+         if(mki[0] != context->srtpMkiLen ||
+            memcmp(mki + 1, context->srtpMki, mki[0]) != 0)
+         {
+            return ERROR_ILLEGAL_PARAMETER;
+         }
+      }
+
+      //Save the negotiated protection profile
+      context->srtpProfile = profile;
+   }
+   else
+   {
+      //The UseSrtp extension is not supported by the server
+      context->srtpProfile = DTLS_SRTP_PROFILE_NONE;
    }
 #endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get the length of the SRTP master key and salt
+ * @param[in] profile SRTP protection profile
+ * @param[out] keyLen Length of the master key
+ * @param[out] saltLen Length of the master salt
+ * @return Error code
+ **/
+
+error_t dtlsGetSrtpKeyLengths(uint16_t profile, size_t *keyLen,
+   size_t *saltLen)
+{
+   error_t error;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Check protection profile
+   if(profile == DTLS_SRTP_AES128_CM_HMAC_SHA1_80 ||
+      profile == DTLS_SRTP_AES128_CM_HMAC_SHA1_32 ||
+      profile == DTLS_SRTP_NULL_HMAC_SHA1_80 ||
+      profile == DTLS_SRTP_NULL_HMAC_SHA1_32)
+   {
+      //128-bit master key and 112-bit master salt (refer to RFC 5764,
+      //section 4.1.2)
+      *keyLen = 16;
+      *saltLen = 14;
+   }
+   else if(profile == DTLS_SRTP_AEAD_AES_128_GCM)
+   {
+      //128-bit master key and 96-bit master salt (refer to RFC 7714,
+      //section 14.2)
+      *keyLen = 16;
+      *saltLen = 12;
+   }
+   else if(profile == DTLS_SRTP_AEAD_AES_256_GCM)
+   {
+      //256-bit master key and 96-bit master salt
+      *keyLen = 32;
+      *saltLen = 12;
+   }
+   else
+   {
+      //Unknown protection profile
+      error = ERROR_INVALID_PARAMETER;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Number of words needed to hold a sliding window
+ * @param[in] size Number of records covered by the window
+ * @return Number of 64-bit words (power of two)
+ **/
+
+uint_t dtlsComputeReplayWindowWords(uint_t size)
+{
+   uint_t n;
+
+   //The word that contains the right edge of the window is only partially
+   //used, hence one extra word. Rounding up to a power of two turns the
+   //ring index into a simple mask
+   n = 1;
+   while(n < ((size + 63) / 64 + 1))
+   {
+      n <<= 1;
+   }
+
+   //Return the number of words
+   return n;
+}
+
+
+/**
+ * @brief Initialize sliding window
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+void dtlsInitReplayWindow(TlsContext *context)
+{
+#if (DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   //Clear the bitmap window
+   memset(context->replayWindow, 0, context->replayWindowWords *
+      sizeof(uint64_t));
+#endif
 }
 
 
@@ -484,20 +998,17 @@ error_t dtlsCheckReplayWindow(TlsContext *context, DtlsSequenceNumber *seqNum)
       //Check sequence number
       if(n <= right)
       {
-         //Calculate the position relative to the right edge of the window
-         n = right - n;
-
          //Check whether the sequence number falls within the window
-         if(n < DTLS_REPLAY_WINDOW_SIZE)
+         if((right - n) < context->replayWindowSize)
          {
-            //Records falling within the window are checked against a list of
-            //received packets within the window
-            j = (uint_t) (n / 32);
-            k = (uint_t) (n % 32);
+            //The bitmap is a ring indexed by the sequence number itself, so
+            //that the position of a record never changes as the window slides
+            j = (uint_t) (n / 64) & (context->replayWindowWords - 1);
+            k = (uint_t) (n % 64);
 
             //Duplicate record are rejected through the use of a sliding
             //receive window
-            if(context->replayWindow[j] & (1 << k))
+            if(context->replayWindow[j] & ((uint64_t) 1 << k))
             {
                //The received record is a duplicate
                error = ERROR_INVALID_SEQUENCE_NUMBER;
@@ -508,7 +1019,6 @@ error_t dtlsCheckReplayWindow(TlsContext *context, DtlsSequenceNumber *seqNum)
                //then the receiver proceeds to MAC verification
                error = NO_ERROR;
             }
-
          }
          else
          {
@@ -546,6 +1056,9 @@ void dtlsUpdateReplayWindow(TlsContext *context, DtlsSequenceNumber *seqNum)
 {
    uint64_t n;
    uint64_t right;
+#if (DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   uint_t mask;
+#endif
 
    //Get the sequence number of the received DTLS record
    n = LOAD48BE(seqNum);
@@ -554,24 +1067,21 @@ void dtlsUpdateReplayWindow(TlsContext *context, DtlsSequenceNumber *seqNum)
    //number value received on this session
    right = LOAD48BE(&context->decryptionEngine.dtlsSeqNum);
 
+#if (DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   //The number of words is a power of two
+   mask = context->replayWindowWords - 1;
+#endif
+
    //Check sequence number
    if(n <= right)
    {
 #if (DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
-      uint_t j;
-      uint_t k;
-
-      //Calculate the position relative to the right edge of the window
-      n = right - n;
-
       //Check whether the sequence number falls within the window
-      if(n < DTLS_REPLAY_WINDOW_SIZE)
+      if((right - n) < context->replayWindowSize)
       {
-         j = (uint_t) (n / 32);
-         k = (uint_t) (n % 32);
-
          //Set the corresponding bit in the bitmap window
-         context->replayWindow[j] |= 1 << k;
+         context->replayWindow[(uint_t) (n / 64) & mask] |=
+            (uint64_t) 1 << (n % 64);
       }
 #endif
    }
@@ -579,59 +1089,29 @@ void dtlsUpdateReplayWindow(TlsContext *context, DtlsSequenceNumber *seqNum)
    {
 #if (DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
       uint_t i;
-      uint_t j;
-      uint_t k;
+      uint64_t delta;
 
-      //Calculate the position relative to the right edge of the window
-      n -= right;
+      //Number of words the right edge of the window moves across
+      delta = (n / 64) - (right / 64);
 
-      //Check resulting value
-      if(n < DTLS_REPLAY_WINDOW_SIZE)
+      //Words are recycled as the window advances. Only the words that enter
+      //the window need to be cleared, whatever its size
+      if(delta < context->replayWindowWords)
       {
-         j = (uint_t) (n / 32);
-         k = (uint_t) (n % 32);
-
-         //First, shift words
-         if(j > 0)
+         for(i = 1; i <= (uint_t) delta; i++)
          {
-            //Shift the most significant words of the window
-            for(i = (DTLS_REPLAY_WINDOW_SIZE - 1) / 32; i >= j; i--)
-            {
-               context->replayWindow[i] = context->replayWindow[i - j];
-            }
-
-            //Fill the least significant words with zeroes
-            for(i = 0; i < j; i++)
-            {
-               context->replayWindow[i] = 0;
-            }
-         }
-
-         //Then shift bits
-         if(k > 0)
-         {
-            //Shift the most significant words of the window
-            for(i = (DTLS_REPLAY_WINDOW_SIZE - 1) / 32; i >= 1; i--)
-            {
-               context->replayWindow[i] = (context->replayWindow[i] << k) |
-                  (context->replayWindow[i - 1] >> (32 - k));
-            }
-
-            //Shift the least significant word
-            context->replayWindow[0] <<= k;
+            context->replayWindow[(uint_t) ((right / 64) + i) & mask] = 0;
          }
       }
       else
       {
-         //Clear the bitmap window
-         for(i = 0; i < (DTLS_REPLAY_WINDOW_SIZE + 31) / 32; i++)
-         {
-            context->replayWindow[i] = 0;
-         }
+         //The whole window is left behind
+         dtlsInitReplayWindow(context);
       }
 
       //Set the corresponding bit in the bitmap window
-      context->replayWindow[0] |= 1;
+      context->replayWindow[(uint_t) (n / 64) & mask] |=
+         (uint64_t) 1 << (n % 64);
 #endif
 
       //Save the highest sequence number value received on this session
@@ -70,6 +70,82 @@
    #error DTLS_REPLAY_WINDOW_SIZE parameter is not valid
 #endif
 
+//Maximum size of the sliding window that can be set at runtime
+#ifndef DTLS_MAX_REPLAY_WINDOW_SIZE
+   #define DTLS_MAX_REPLAY_WINDOW_SIZE 16384
+#elif (DTLS_MAX_REPLAY_WINDOW_SIZE < DTLS_REPLAY_WINDOW_SIZE)
+   #error DTLS_MAX_REPLAY_WINDOW_SIZE parameter is not valid
+#endif
+
+//Number of 64-bit words that back the default sliding window
+#define DTLS_REPLAY_WINDOW_BUFFER_SIZE (2 * ((DTLS_REPLAY_WINDOW_SIZE + 63) / 64))
+
+//Connection ID support (RFC 9146)
+#ifndef DTLS_CID_SUPPORT
+   #define DTLS_CID_SUPPORT DISABLED
+#elif (DTLS_CID_SUPPORT != ENABLED && DTLS_CID_SUPPORT != DISABLED)
+   #error DTLS_CID_SUPPORT parameter is not valid
+#endif
+
+//Maximum length of connection IDs
+#ifndef DTLS_MAX_CID_SIZE
+   #define DTLS_MAX_CID_SIZE 16
+#elif (DTLS_MAX_CID_SIZE < 1 || DTLS_MAX_CID_SIZE > 255)
+   #error DTLS_MAX_CID_SIZE parameter is not valid
+#endif
+
+//DTLS-SRTP support (RFC 5764)
+#ifndef DTLS_SRTP_SUPPORT
+   #define DTLS_SRTP_SUPPORT DISABLED
+#elif (DTLS_SRTP_SUPPORT != ENABLED && DTLS_SRTP_SUPPORT != DISABLED)
+   #error DTLS_SRTP_SUPPORT parameter is not valid
+#endif
+
+//Maximum number of SRTP protection profiles
+#ifndef DTLS_MAX_SRTP_PROFILES
+   #define DTLS_MAX_SRTP_PROFILES 4
+#elif (DTLS_MAX_SRTP_PROFILES < 1)
+   #error DTLS_MAX_SRTP_PROFILES parameter is not valid
+#endif
+
+//Maximum length of the SRTP MKI
+#ifndef DTLS_MAX_SRTP_MKI_SIZE
+   #define DTLS_MAX_SRTP_MKI_SIZE 16
+#elif (DTLS_MAX_SRTP_MKI_SIZE < 1 || DTLS_MAX_SRTP_MKI_SIZE > 255)
+   #error DTLS_MAX_SRTP_MKI_SIZE parameter is not valid
+#endif
+
+//Maximum length of SRTP master keys
+#define DTLS_MAX_SRTP_KEY_SIZE 32
+//Maximum length of SRTP master salts
+#define DTLS_MAX_SRTP_SALT_SIZE 14
+
+//Flight cache (retransmission without rebuilding the flight)
+#ifndef DTLS_FLIGHT_CACHE_SUPPORT
+   #define DTLS_FLIGHT_CACHE_SUPPORT ENABLED
+#elif (DTLS_FLIGHT_CACHE_SUPPORT != ENABLED && DTLS_FLIGHT_CACHE_SUPPORT != DISABLED)
+   #error DTLS_FLIGHT_CACHE_SUPPORT parameter is not valid
+#endif
+
+//Number of levels of the retransmission timer wheel
+#define DTLS_TIMER_WHEEL_LEVELS 3
+//Number of slots per level (power of two)
+#define DTLS_TIMER_WHEEL_SLOTS 64
+
+//Maximum size of a peer address (DTLS listener)
+#ifndef DTLS_MAX_PEER_ADDR_SIZE
+   #define DTLS_MAX_PEER_ADDR_SIZE 28
+#elif (DTLS_MAX_PEER_ADDR_SIZE < 1)
+   #error DTLS_MAX_PEER_ADDR_SIZE parameter is not valid
+#endif
+
+//Maximum number of datagrams per batch (sendmmsg/recvmmsg)
+#ifndef DTLS_MAX_BATCH_SIZE
+   #define DTLS_MAX_BATCH_SIZE 16
+#elif (DTLS_MAX_BATCH_SIZE < 1)
+   #error DTLS_MAX_BATCH_SIZE parameter is not valid
+#endif
+
 //Maximum size for cookies
 #ifndef DTLS_MAX_COOKIE_SIZE
    #define DTLS_MAX_COOKIE_SIZE 32
@@ -124,6 +200,22 @@ typedef enum
 } DtlsRetransmitState;
 
 
+/**
+ * @brief SRTP protection profiles
+ **/
+
+typedef enum
+{
+   DTLS_SRTP_PROFILE_NONE           = 0x0000,
+   DTLS_SRTP_AES128_CM_HMAC_SHA1_80 = 0x0001,
+   DTLS_SRTP_AES128_CM_HMAC_SHA1_32 = 0x0002,
+   DTLS_SRTP_NULL_HMAC_SHA1_80      = 0x0005,
+   DTLS_SRTP_NULL_HMAC_SHA1_32      = 0x0006,
+   DTLS_SRTP_AEAD_AES_128_GCM       = 0x0007,
+   DTLS_SRTP_AEAD_AES_256_GCM       = 0x0008
+} DtlsSrtpProfile;
+
+
 //CodeWarrior or Win32 compiler?
 #if defined(__CWCC__) || defined(_WIN32)
    #pragma pack(push, 1)
@@ -162,6 +254,28 @@ typedef __start_packed struct
 } __end_packed DtlsSupportedVersionList;
 
 
+/**
+ * @brief Connection ID
+ **/
+
+typedef __start_packed struct
+{
+   uint8_t length;  //0
+   uint8_t value[]; //1
+} __end_packed DtlsConnectionId;
+
+
+/**
+ * @brief List of SRTP protection profiles
+ **/
+
+typedef __start_packed struct
+{
+   uint16_t length;  //0-1
+   uint16_t value[]; //2
+} __end_packed DtlsSrtpProtectionProfiles;
+
+
 /**
  * @brief DTLS record
  **/
@@ -228,6 +342,34 @@ typedef struct
 } DtlsClientParameters;
 
 
+/**
+ * @brief SRTP keying material
+ **/
+
+typedef struct
+{
+   uint16_t profile;                               ///<Negotiated protection profile
+   size_t keyLen;                                  ///<Length of the master keys
+   size_t saltLen;                                 ///<Length of the master salts
+   uint8_t clientKey[DTLS_MAX_SRTP_KEY_SIZE];      ///<Client write master key
+   uint8_t serverKey[DTLS_MAX_SRTP_KEY_SIZE];      ///<Server write master key
+   uint8_t clientSalt[DTLS_MAX_SRTP_SALT_SIZE];    ///<Client write master salt
+   uint8_t serverSalt[DTLS_MAX_SRTP_SALT_SIZE];    ///<Server write master salt
+} DtlsSrtpKeys;
+
+
+/**
+ * @brief SRTP packet callback function
+ *
+ * Invoked for every datagram received on the shared socket that does not
+ * carry a DTLS record (SRTP, SRTCP or STUN packets)
+ *
+ **/
+
+typedef void (*DtlsSrtpCallback)(TlsContext *context, const uint8_t *data,
+   size_t length, void *param);
+
+
 /**
  * @brief DTLS cookie generation callback function
  **/
@@ -266,6 +408,34 @@ error_t dtlsParseHelloVerifyRequest(TlsContext *context,
 error_t dtlsParseClientSupportedVersionsExtension(TlsContext *context,
    const DtlsSupportedVersionList *supportedVersionList);
 
+uint_t dtlsComputeReplayWindowWords(uint_t size);
+error_t dtlsFormatClientConnectionIdExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
+error_t dtlsFormatServerConnectionIdExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
+error_t dtlsParseClientConnectionIdExtension(TlsContext *context,
+   const DtlsConnectionId *connectionId);
+
+error_t dtlsParseServerConnectionIdExtension(TlsContext *context,
+   const DtlsConnectionId *connectionId);
+
+error_t dtlsFormatClientUseSrtpExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
+error_t dtlsFormatServerUseSrtpExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
+error_t dtlsParseClientUseSrtpExtension(TlsContext *context,
+   const DtlsSrtpProtectionProfiles *profiles);
+
+error_t dtlsParseServerUseSrtpExtension(TlsContext *context,
+   const DtlsSrtpProtectionProfiles *profiles);
+
+error_t dtlsGetSrtpKeyLengths(uint16_t profile, size_t *keyLen,
+   size_t *saltLen);
+
 void dtlsInitReplayWindow(TlsContext *context);
 error_t dtlsCheckReplayWindow(TlsContext *context, DtlsSequenceNumber *seqNum);
 void dtlsUpdateReplayWindow(TlsContext *context, DtlsSequenceNumber *seqNum);
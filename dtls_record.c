@@ -39,9 +39,12 @@
 #include "tls_record_encryption.h"
 #include "tls_record_decryption.h"
 #include "tls_misc.h"
+#include "tls_stats.h"
 #include "ssl_misc.h"
 #include "dtls_misc.h"
 #include "dtls_record.h"
+#include "dtls_listener.h"
+#include "dtls_timer.h"
 #include "debug.h"
 
 //Check TLS library configuration
@@ -234,18 +237,65 @@ error_t dtlsWriteRecord(TlsContext *context, const uint8_t *data,
    DtlsRecord *record;
    TlsEncryptionEngine *encryptionEngine;
 
+   //Point to the encryption engine
+   encryptionEngine = &context->encryptionEngine;
+
    //Calculate the length of the DTLS record
    n = length + sizeof(DtlsRecord);
 
+   //Check record type
+   if(contentType == TLS_TYPE_HANDSHAKE ||
+      contentType == TLS_TYPE_CHANGE_CIPHER_SPEC)
+   {
+      //The flight of messages is buffered where the packed records are
+      //assembled, so the pending datagram must be sent first
+      error = dtlsFlushDatagram(context);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+   else if(context->txDatagramLen > 0 || context->txBatchLen > 0)
+   {
+      //Estimate the length of the protected record
+      n += tlsComputeEncryptionOverhead(encryptionEngine, n);
+
+      //Records may not span datagrams
+      if(context->txDatagramLen > 0 && (context->txDatagramLen + n) > context->pmtu)
+      {
+         //The pending datagram is complete
+         error = dtlsSendDatagram(context);
+         //Any error to report?
+         if(error)
+            return error;
+      }
+
+      //Not enough room left behind the batched datagrams?
+      if((context->txBufferLen + context->txBatchLen + context->txDatagramLen +
+         n) > context->txBufferSize)
+      {
+         //Send the pending datagrams
+         error = dtlsFlushDatagram(context);
+         //Any error to report?
+         if(error)
+            return error;
+      }
+
+      //Length of the DTLS record
+      n = length + sizeof(DtlsRecord);
+   }
+
    //Make sure the buffer is large enough to hold the DTLS record
-   if((context->txBufferLen + n) > context->txBufferSize)
+   if((context->txBufferLen + context->txBatchLen + context->txDatagramLen +
+      n) > context->txBufferSize)
+   {
       return ERROR_BUFFER_OVERFLOW;
+   }
 
-   //Point to the encryption engine
-   encryptionEngine = &context->encryptionEngine;
-
-   //Point to the DTLS record header
-   record = (DtlsRecord *) (context->txBuffer + context->txBufferLen);
+   //Point to the DTLS record header. Packed records are encoded
+   //consecutively after the buffered flight of messages and the datagrams
+   //waiting in the batch
+   record = (DtlsRecord *) (context->txBuffer + context->txBufferLen +
+      context->txBatchLen + context->txDatagramLen);
 
    //Copy record data
    memmove(record->data, data, length);
@@ -275,40 +325,282 @@ error_t dtlsWriteRecord(TlsContext *context, const uint8_t *data,
       n += tlsComputeEncryptionOverhead(encryptionEngine, n);
 
       //Make sure the buffer is large enough to hold the encrypted record
-      if((context->txBufferLen + n) > context->txBufferSize)
+      if((context->txBufferLen + context->txBatchLen + context->txDatagramLen +
+         n) > context->txBufferSize)
+      {
          return ERROR_BUFFER_OVERFLOW;
+      }
+
+      //Encrypt DTLS record and retrieve its length
+      error = dtlsProtectRecord(context, encryptionEngine, record, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Increment sequence number
+      dtlsIncSequenceNumber(&encryptionEngine->dtlsSeqNum);
+
+      //Adjust the length of the pending datagram
+      context->txDatagramLen += n;
 
-      //Protect record payload?
-      if(encryptionEngine->cipherMode != CIPHER_MODE_NULL ||
-         encryptionEngine->hashAlgo != NULL)
+      //Application data records are held back when record packing is
+      //enabled, until the datagram is flushed
+      if(!context->recordPackingEnabled ||
+         contentType != TLS_TYPE_APPLICATION_DATA)
       {
-         //Encrypt DTLS record
-         error = tlsEncryptRecord(context, encryptionEngine, record);
+         //Send the datagram
+         error = dtlsFlushDatagram(context);
          //Any error to report?
          if(error)
             return error;
       }
+   }
 
-      //Debug message
-      TRACE_DEBUG("Encrypted DTLS record (%" PRIuSIZE " bytes)...\r\n", ntohs(record->length));
-      TRACE_DEBUG_ARRAY("  ", record, ntohs(record->length) + sizeof(DtlsRecord));
+   //Successful processing
+   return NO_ERROR;
+}
 
-      //Increment sequence number
-      dtlsIncSequenceNumber(&encryptionEngine->dtlsSeqNum);
 
-      //Length of the resulting datagram, in bytes
-      n = ntohs(record->length) + sizeof(DtlsRecord);
+/**
+ * @brief Send the pending datagrams
+ *
+ * The datagram being assembled holds the application data records that have
+ * been packed together since the last flush. It is sent along with the
+ * datagrams waiting in the batch, if any
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t dtlsFlushDatagram(TlsContext *context)
+{
+   error_t error;
+
+   //Complete the datagram being assembled
+   error = dtlsSendDatagram(context);
+
+   //Check status code
+   if(!error)
+   {
+      //Send the datagrams waiting in the batch
+      error = dtlsFlushBatch(context);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the datagram being assembled
+ *
+ * When a send batch callback is registered, the datagram is appended to the
+ * batch instead, and the batch is sent once it is full or once there is no
+ * room left for another full-sized datagram
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t dtlsSendDatagram(TlsContext *context)
+{
+   error_t error;
+   size_t n;
+   uint8_t *datagram;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Any datagram pending to be sent?
+   if(context->txDatagramLen > 0)
+   {
+      //The datagram immediately follows the batched datagrams
+      datagram = context->txBuffer + context->txBufferLen + context->txBatchLen;
+
+      //Batched datagram I/O?
+      if(context->socketSendBatchCallback != NULL)
+      {
+         //Append the datagram to the batch
+         context->txBatchLengths[context->txBatchCount++] =
+            (uint16_t) context->txDatagramLen;
+
+         //Adjust the length of the batch
+         context->txBatchLen += context->txDatagramLen;
+         context->txDatagramLen = 0;
+
+         //Send the batch if it is full or if another full-sized datagram
+         //would not fit in the buffer
+         if(context->txBatchCount >= DTLS_MAX_BATCH_SIZE ||
+            (context->txBufferLen + context->txBatchLen + context->pmtu) >
+            context->txBufferSize)
+         {
+            error = dtlsFlushBatch(context);
+         }
+      }
+      else
+      {
+         //Debug message
+         TRACE_INFO("Sending UDP datagram (%u bytes)...\r\n", context->txDatagramLen);
+
+         //Send datagram
+         error = context->socketSendCallback(context->socketHandle, datagram,
+            context->txDatagramLen, &n, 0);
+
+         //The records are discarded even if the datagram could not be sent,
+         //since DTLS does not retransmit application data
+         context->txDatagramLen = 0;
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the datagrams waiting in the batch
+ *
+ * The datagrams of a batch are contiguous in memory, so that the callback
+ * can hand them over with a single sendmmsg call (or as a single UDP GSO
+ * buffer when they all have the same length, except the last one)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t dtlsFlushBatch(TlsContext *context)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint8_t *p;
+   DtlsDatagram datagrams[DTLS_MAX_BATCH_SIZE];
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Any datagram waiting in the batch?
+   if(context->txBatchCount > 0)
+   {
+      //Point to the first datagram
+      p = context->txBuffer + context->txBufferLen;
+
+      //Describe the datagrams of the batch
+      for(i = 0; i < context->txBatchCount; i++)
+      {
+         datagrams[i].data = p;
+         datagrams[i].size = context->txBatchLengths[i];
+         datagrams[i].length = context->txBatchLengths[i];
+         datagrams[i].peerAddr = NULL;
+
+         //Point to the next datagram
+         p += context->txBatchLengths[i];
+      }
 
       //Debug message
-      TRACE_INFO("Sending UDP datagram (%u bytes)...\r\n", n);
+      TRACE_INFO("Sending %u UDP datagrams (%" PRIuSIZE " bytes)...\r\n",
+         context->txBatchCount, context->txBatchLen);
+
+      //Send the datagrams, in as few calls as possible
+      for(i = 0; i < context->txBatchCount && !error; i += n)
+      {
+         //Send the remaining datagrams
+         error = context->socketSendBatchCallback(context->socketHandle,
+            datagrams + i, context->txBatchCount - i, &n, 0);
+
+         //No progress?
+         if(!error && n == 0)
+            error = ERROR_WRITE_FAILED;
+      }
+
+      //The batch is empty
+      context->txBatchCount = 0;
+      context->txBatchLen = 0;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Protect a DTLS record
+ *
+ * When a CID is used, the real content type is appended to the payload
+ * before encryption and the CID is inserted in the record header (refer
+ * to RFC 9146, section 4)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] encryptionEngine Pointer to the encryption engine
+ * @param[in] record Pointer to the DTLS record
+ * @param[out] length Length of the protected record, as sent on the wire
+ * @return Error code
+ **/
 
-      //Send datagram
-      error = context->socketSendCallback(context->socketHandle, record, n, &n, 0);
+error_t dtlsProtectRecord(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, DtlsRecord *record, size_t *length)
+{
+   error_t error;
+   size_t n;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Record carrying a connection ID?
+   if(encryptionEngine->cidLen > 0)
+   {
+      //Get the length of the payload
+      n = ntohs(record->length);
+
+      //The DTLSInnerPlaintext is the payload followed by the real content
+      //type. No padding is added
+      record->data[n++] = record->type;
+      record->type = TLS_TYPE_TLS12_CID;
+      record->length = htons(n);
+   }
+#endif
+
+   //Protect record payload?
+   if(encryptionEngine->cipherMode != CIPHER_MODE_NULL ||
+      encryptionEngine->hashAlgo != NULL)
+   {
+      //Encrypt DTLS record
+      error = encryptionEngine->encryptRecord(context, encryptionEngine, record);
       //Any error to report?
       if(error)
          return error;
    }
 
+   //Debug message
+   TRACE_DEBUG("Encrypted DTLS record (%" PRIuSIZE " bytes)...\r\n", ntohs(record->length));
+   TRACE_DEBUG_ARRAY("  ", record, ntohs(record->length) + sizeof(DtlsRecord));
+
+   //Length of the protected record
+   n = ntohs(record->length) + sizeof(DtlsRecord);
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Record carrying a connection ID?
+   if(encryptionEngine->cidLen > 0)
+   {
+      uint8_t *p;
+
+      //Point to the length field
+      p = (uint8_t *) &record->length;
+
+      //The CID sits between the sequence number and the length field
+      memmove(p + encryptionEngine->cidLen, p, n - (p - (uint8_t *) record));
+      memcpy(p, encryptionEngine->cid, encryptionEngine->cidLen);
+
+      //Adjust the length of the record
+      n += encryptionEngine->cidLen;
+   }
+#endif
+
+   //Length of the record, as sent on the wire
+   *length = n;
+
+   //Update statistics
+   TLS_CONTEXT_STATS_ADD(context, recordsOut, 1);
+   TLS_CONTEXT_STATS_ADD(context, bytesOut, n);
+
    //Successful processing
    return NO_ERROR;
 }
@@ -325,6 +617,8 @@ error_t dtlsReadRecord(TlsContext *context)
    error_t error;
    DtlsRecord *record;
    size_t recordLen;
+   size_t wireLen;
+   size_t cidLen;
    TlsEncryptionEngine *decryptionEngine;
 
    //Point to the decryption engine
@@ -341,11 +635,37 @@ error_t dtlsReadRecord(TlsContext *context)
 
    //Point to the DTLS record
    record = (DtlsRecord *) (context->rxBuffer + context->rxDatagramPos);
+
+   //Length of the CID carried in the record header
+   cidLen = 0;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Record carrying a connection ID?
+   if(record->type == TLS_TYPE_TLS12_CID)
+   {
+      //The length of the CID is not encoded in the record. Only the CID
+      //the local endpoint asked for can be parsed
+      cidLen = decryptionEngine->cidLen;
+
+      //Unexpected CID or truncated header?
+      if(cidLen == 0 || context->rxDatagramLen < (sizeof(DtlsRecord) + cidLen))
+      {
+         //Drop received datagram
+         context->rxDatagramLen = 0;
+         //Report an error
+         return ERROR_UNEXPECTED_MESSAGE;
+      }
+   }
+#endif
+
    //Retrieve the length of the record
-   recordLen = ntohs(record->length);
+   recordLen = LOAD16BE((uint8_t *) &record->length + cidLen);
+
+   //Length of the record, as received on the wire
+   wireLen = recordLen + sizeof(DtlsRecord) + cidLen;
 
    //Sanity check
-   if((recordLen + sizeof(DtlsRecord)) > context->rxDatagramLen)
+   if(wireLen > context->rxDatagramLen)
    {
       //Drop received datagram
       context->rxDatagramLen = 0;
@@ -355,14 +675,38 @@ error_t dtlsReadRecord(TlsContext *context)
 
    //Debug message
    TRACE_DEBUG("DTLS encrypted record received (%" PRIuSIZE " bytes)...\r\n", recordLen);
-   TRACE_DEBUG_ARRAY("  ", record, recordLen + sizeof(DtlsRecord));
-
-   //Point to the payload data
-   context->rxRecordPos = context->rxDatagramPos + sizeof(DtlsRecord);
+   TRACE_DEBUG_ARRAY("  ", record, recordLen + sizeof(DtlsRecord) + cidLen);
 
    //It is acceptable to pack multiple DTLS records in the same datagram
-   context->rxDatagramPos += recordLen + sizeof(DtlsRecord);
-   context->rxDatagramLen -= recordLen + sizeof(DtlsRecord);
+   context->rxDatagramPos += wireLen;
+   context->rxDatagramLen -= wireLen;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Record carrying a connection ID?
+   if(cidLen > 0)
+   {
+      //Records with a CID other than the one the local endpoint asked for
+      //are discarded
+      if(memcmp((uint8_t *) &record->length, decryptionEngine->cid, cidLen))
+         return ERROR_UNEXPECTED_MESSAGE;
+
+      //Move the fixed part of the header next to the length field, so that
+      //the record can be processed as a regular DTLS record
+      memmove((uint8_t *) record + cidLen, record,
+         offsetof(DtlsRecord, length));
+
+      //Point to the resulting DTLS record
+      record = (DtlsRecord *) ((uint8_t *) record + cidLen);
+   }
+   else if(decryptionEngine->cidLen > 0)
+   {
+      //Once negotiated, the CID must be present in every protected record
+      return ERROR_UNEXPECTED_MESSAGE;
+   }
+#endif
+
+   //Point to the payload data
+   context->rxRecordPos = (uint8_t *) record->data - context->rxBuffer;
 
    //Compliant servers must accept any value {254,XX} as the record layer
    //version number for ClientHello
@@ -384,16 +728,45 @@ error_t dtlsReadRecord(TlsContext *context)
       decryptionEngine->hashAlgo != NULL)
    {
       //Decrypt DTLS record
-      error = tlsDecryptRecord(context, decryptionEngine, record);
+      error = decryptionEngine->decryptRecord(context, decryptionEngine, record);
       //If the MAC validation fails, the receiver must discard the record
       if(error)
          return error;
 
+#if (DTLS_CID_SUPPORT == ENABLED)
+      //Record carrying a connection ID?
+      if(cidLen > 0)
+      {
+         //Extract the real content type from the DTLSInnerPlaintext
+         error = dtlsParseInnerPlaintext(record);
+         //Any error to report?
+         if(error)
+            return error;
+      }
+#endif
+
       //The length of the plaintext record must not exceed 2^14 bytes
       if(ntohs(record->length) > TLS_MAX_RECORD_LENGTH)
          return ERROR_RECORD_OVERFLOW;
    }
 
+#if (DTLS_CID_SUPPORT == ENABLED && TLS_SERVER_SUPPORT == ENABLED)
+   //Datagram routed by CID but received from a new address?
+   if(context->listener != NULL && context->rxPeerAddrChanged)
+   {
+      //The peer address is updated only when the record is newer than any
+      //other record received so far (refer to RFC 9146, section 6)
+      if(LOAD48BE(&record->seqNum) >
+         LOAD48BE(&context->decryptionEngine.dtlsSeqNum))
+      {
+         dtlsUpdateListenerPeerAddr(context);
+      }
+
+      //The address change has been processed
+      context->rxPeerAddrChanged = FALSE;
+   }
+#endif
+
    //The receive window is updated only if the MAC verification succeeds
    dtlsUpdateReplayWindow(context, &record->seqNum);
 
@@ -411,6 +784,43 @@ error_t dtlsReadRecord(TlsContext *context)
    //Save record length
    context->rxRecordLen = recordLen;
 
+   //Update statistics
+   TLS_CONTEXT_STATS_ADD(context, recordsIn, 1);
+   TLS_CONTEXT_STATS_ADD(context, bytesIn, wireLen);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Extract the real content type of a record that carries a CID
+ * @param[in] record Pointer to the decrypted DTLS record
+ * @return Error code
+ **/
+
+error_t dtlsParseInnerPlaintext(DtlsRecord *record)
+{
+   size_t n;
+
+   //Get the length of the DTLSInnerPlaintext
+   n = ntohs(record->length);
+
+   //The real content type is the last non-zero byte
+   while(n > 0 && record->data[n - 1] == 0)
+   {
+      n--;
+   }
+
+   //If a receiving implementation does not find a non-zero byte in the
+   //cleartext, then it must terminate the connection
+   if(n == 0)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Restore the real content type and the length of the content
+   record->type = record->data[n - 1];
+   record->length = htons(n - 1);
+
    //Successful processing
    return NO_ERROR;
 }
@@ -720,6 +1130,21 @@ error_t dtlsSendFlight(TlsContext *context)
    DtlsHandshake *message;
    TlsEncryptionEngine *encryptionEngine;
 
+   //Send the application data records that are still held back
+   error = dtlsFlushDatagram(context);
+   //Any error to report?
+   if(error)
+      return error;
+
+#if (DTLS_FLIGHT_CACHE_SUPPORT == ENABLED)
+   //Retransmission of a flight whose records are cached?
+   if(dtlsPrepareFlightCache(context))
+   {
+      //Resend the cached records, without rebuilding the flight
+      return dtlsResendFlight(context);
+   }
+#endif
+
    //Determine the value of the PMTU
    pmtu = MIN(context->pmtu, context->txBufferSize - context->txBufferLen);
 
@@ -728,7 +1153,7 @@ error_t dtlsSendFlight(TlsContext *context)
       return ERROR_BUFFER_OVERFLOW;
 
    //Point to the buffer where to format the datagram
-   datagram = context->txBuffer + context->txBufferLen;
+   datagram = context->txBuffer + context->txBufferLen + context->txBatchLen;
    //Length of the datagram, in bytes
    context->txDatagramLen = 0;
    //Point to the first message of the flight
@@ -759,6 +1184,11 @@ error_t dtlsSendFlight(TlsContext *context)
          //Any error to report?
          if(error)
             return error;
+
+         //The datagrams completed by the fragmentation process may have
+         //been appended to the batch
+         datagram = context->txBuffer + context->txBufferLen +
+            context->txBatchLen;
       }
       else
       {
@@ -773,18 +1203,15 @@ error_t dtlsSendFlight(TlsContext *context)
             //Records may not span datagrams
             if((context->txDatagramLen + n) > pmtu)
             {
-               //Debug message
-               TRACE_INFO("Sending UDP datagram (%u bytes)...\r\n", context->txDatagramLen);
-
-               //Send datagram
-               error = context->socketSendCallback(context->socketHandle,
-                  datagram, context->txDatagramLen, &n, 0);
+               //The datagram is complete
+               error = dtlsSendDatagram(context);
                //Any error to report?
                if(error)
                   return error;
 
-               //The datagram has been successfully transmitted
-               context->txDatagramLen = 0;
+               //Point to the buffer where to format the next datagram
+               datagram = context->txBuffer + context->txBufferLen +
+                  context->txBatchLen;
             }
          }
 
@@ -794,8 +1221,11 @@ error_t dtlsSendFlight(TlsContext *context)
          n += tlsComputeEncryptionOverhead(encryptionEngine, n);
 
          //Make sure the buffer is large enough to hold the DTLS record
-         if((context->txBufferLen + context->txDatagramLen + n) > context->txBufferSize)
+         if((context->txBufferLen + context->txBatchLen + context->txDatagramLen +
+            n) > context->txBufferSize)
+         {
             return ERROR_BUFFER_OVERFLOW;
+         }
 
          //Multiple DTLS records may be placed in a single datagram. They are
          //simply encoded consecutively
@@ -809,47 +1239,228 @@ error_t dtlsSendFlight(TlsContext *context)
          //a new record. This record will have a new sequence number
          record->seqNum = encryptionEngine->dtlsSeqNum;
 
-         //Protect record payload?
-         if(encryptionEngine->cipherMode != CIPHER_MODE_NULL ||
-            encryptionEngine->hashAlgo != NULL)
-         {
-            //Encrypt DTLS record
-            error = tlsEncryptRecord(context, encryptionEngine, record);
-            //Any error to report?
-            if(error)
-               return error;
-         }
+#if (DTLS_FLIGHT_CACHE_SUPPORT == ENABLED)
+         //Keep a copy of the record as laid out in the datagram
+         dtlsCacheFlightRecord(context, record);
+#endif
 
-         //Debug message
-         TRACE_DEBUG("Encrypted DTLS record (%" PRIuSIZE " bytes)...\r\n", ntohs(record->length));
-         TRACE_DEBUG_ARRAY("  ", record, ntohs(record->length) + sizeof(DtlsRecord));
+         //Encrypt DTLS record
+         error = dtlsProtectRecord(context, encryptionEngine, record, &n);
+         //Any error to report?
+         if(error)
+            return error;
 
          //Increment sequence number
          dtlsIncSequenceNumber(&encryptionEngine->dtlsSeqNum);
 
          //Adjust the length of the datagram
-         context->txDatagramLen += ntohs(record->length) + sizeof(DtlsRecord);
+         context->txDatagramLen += n;
+
+         //Point to the buffered record
+         record = (DtlsRecord *) (context->txBuffer + context->txBufferPos);
       }
 
       //Loop through the flight of messages
       context->txBufferPos += ntohs(record->length) + sizeof(DtlsRecord);
    }
 
-   //Any datagram pending to be sent?
-   if(context->txDatagramLen > 0)
+   //Send the last datagram of the flight, along with the batched datagrams
+   error = dtlsFlushDatagram(context);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Flight retransmission?
+   if(context->retransmitCount > 0)
    {
-      //Debug message
-      TRACE_INFO("Sending UDP datagram (%u bytes)...\r\n", context->txDatagramLen);
+      //Update statistics
+      TLS_GLOBAL_STATS_INC(context, dtlsRetransmissions);
+   }
+
+   //Save the time at which the flight of messages was sent
+   context->retransmitTimestamp = osGetSystemTime();
+   //Increment retransmission counter
+   context->retransmitCount++;
+
+   //Arm the retransmission timer, if a timer wheel is used
+   dtlsArmTimer(context);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+#if (DTLS_FLIGHT_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Prepare the flight cache before sending a flight
+ *
+ * The size of the cache is computed when the flight is first sent, and
+ * the records are captured during the first retransmission. Flights that
+ * are never retransmitted do not consume any additional memory
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if the flight can be resent from the cache, else FALSE
+ **/
+
+bool_t dtlsPrepareFlightCache(TlsContext *context)
+{
+   //First transmission of a new flight?
+   if(context->retransmitCount == 0)
+   {
+      //Discard the records of the previous flight
+      dtlsFreeFlightCache(context);
+   }
+   else if(context->txFlightCache != NULL &&
+      context->txFlightCacheLen == context->txFlightCacheSize)
+   {
+      //The records of the flight have been captured
+      return TRUE;
+   }
+   else if(context->txFlightCache == NULL && context->txFlightCacheSize > 0)
+   {
+      //Allocate a buffer to capture the records of the flight. On failure,
+      //the flight is simply rebuilt
+      context->txFlightCache = tlsAllocMem(context->txFlightCacheSize);
+      context->txFlightCacheLen = 0;
+   }
+   else
+   {
+      //Capture the records again
+      context->txFlightCacheLen = 0;
+   }
+
+   //The flight must be rebuilt
+   return FALSE;
+}
+
+
+/**
+ * @brief Record the plaintext form of a record of the flight
+ * @param[in] context Pointer to the TLS context
+ * @param[in] record DTLS record, before encryption
+ **/
 
-      //Send datagram
-      error = context->socketSendCallback(context->socketHandle, datagram,
-         context->txDatagramLen, &n, 0);
+void dtlsCacheFlightRecord(TlsContext *context, const DtlsRecord *record)
+{
+   size_t n;
+
+   //Each entry is a flag telling whether the record starts a new datagram,
+   //followed by the record itself
+   n = 1 + sizeof(DtlsRecord) + ntohs(record->length);
+
+   //First transmission of the flight?
+   if(context->retransmitCount == 0)
+   {
+      //Compute the size of the cache
+      context->txFlightCacheSize += n;
+   }
+   else if(context->txFlightCache != NULL &&
+      (context->txFlightCacheLen + n) <= context->txFlightCacheSize)
+   {
+      //Save the datagram boundary
+      context->txFlightCache[context->txFlightCacheLen] =
+         (context->txDatagramLen == 0) ? TRUE : FALSE;
+
+      //Copy the record
+      memcpy(context->txFlightCache + context->txFlightCacheLen + 1, record,
+         n - 1);
+
+      //Adjust the length of the cache
+      context->txFlightCacheLen += n;
+   }
+}
+
+
+/**
+ * @brief Retransmit a flight from the cache
+ *
+ * The records are copied as laid out in the datagrams the first time. They
+ * still get a new sequence number and are encrypted again, since the peer
+ * must not see the same record twice
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t dtlsResendFlight(TlsContext *context)
+{
+   error_t error;
+   size_t n;
+   size_t pos;
+   size_t length;
+   uint8_t *datagram;
+   DtlsRecord *record;
+   TlsEncryptionEngine *encryptionEngine;
+
+   //Point to the buffer where to format the datagram
+   datagram = context->txBuffer + context->txBufferLen + context->txBatchLen;
+   //Length of the datagram, in bytes
+   context->txDatagramLen = 0;
+
+   //Loop through the cached records
+   for(pos = 0; pos < context->txFlightCacheLen; pos += length + 1)
+   {
+      //Point to the cached record
+      record = (DtlsRecord *) (context->txFlightCache + pos + 1);
+      //Length of the record
+      length = ntohs(record->length) + sizeof(DtlsRecord);
+
+      //The record starts a new datagram?
+      if(context->txFlightCache[pos] && context->txDatagramLen > 0)
+      {
+         //The datagram is complete
+         error = dtlsSendDatagram(context);
+         //Any error to report?
+         if(error)
+            return error;
+
+         //Point to the buffer where to format the next datagram
+         datagram = context->txBuffer + context->txBufferLen +
+            context->txBatchLen;
+      }
+
+      //Copy the record
+      memcpy(datagram + context->txDatagramLen, record, length);
+      //Point to the copy
+      record = (DtlsRecord *) (datagram + context->txDatagramLen);
+
+      //Select the relevant encryption engine
+      if(ntohs(record->epoch) == context->encryptionEngine.epoch)
+         encryptionEngine = &context->encryptionEngine;
+      else
+         encryptionEngine = &context->prevEncryptionEngine;
+
+      //The record will have a new sequence number
+      record->seqNum = encryptionEngine->dtlsSeqNum;
+
+      //Encrypt DTLS record
+      error = dtlsProtectRecord(context, encryptionEngine, record, &n);
       //Any error to report?
       if(error)
          return error;
 
-      //The datagram has been successfully transmitted
-      context->txDatagramLen = 0;
+      //Increment sequence number
+      dtlsIncSequenceNumber(&encryptionEngine->dtlsSeqNum);
+
+      //Adjust the length of the datagram
+      context->txDatagramLen += n;
+   }
+
+   //Send the last datagram of the flight, along with the batched datagrams
+   error = dtlsFlushDatagram(context);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //The whole flight has been sent
+   context->txBufferPos = context->txBufferLen;
+
+   //Flight retransmission?
+   if(context->retransmitCount > 0)
+   {
+      //Update statistics
+      TLS_GLOBAL_STATS_INC(context, dtlsRetransmissions);
    }
 
    //Save the time at which the flight of messages was sent
@@ -857,11 +1468,36 @@ error_t dtlsSendFlight(TlsContext *context)
    //Increment retransmission counter
    context->retransmitCount++;
 
+   //Arm the retransmission timer, if a timer wheel is used
+   dtlsArmTimer(context);
+
    //Successful processing
    return NO_ERROR;
 }
 
 
+/**
+ * @brief Release the flight cache
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void dtlsFreeFlightCache(TlsContext *context)
+{
+   //Release the cached records, if any
+   if(context->txFlightCache != NULL)
+   {
+      tlsFreeMem(context->txFlightCache);
+   }
+
+   //The cache is empty
+   context->txFlightCache = NULL;
+   context->txFlightCacheSize = 0;
+   context->txFlightCacheLen = 0;
+}
+
+#endif
+
+
 /**
  * @brief Handshake message fragmentation
  * @param[in] context Pointer to the TLS context
@@ -901,7 +1537,7 @@ error_t dtlsFragmentHandshakeMessage(TlsContext *context, uint16_t version,
    maxFragSize = pmtu - n;
 
    //Point to the buffer where to format the datagram
-   datagram = context->txBuffer + context->txBufferLen;
+   datagram = context->txBuffer + context->txBufferLen + context->txBatchLen;
    //Get the length of the handshake message
    totalLength = LOAD24BE(message->length);
    //Prepare to send the first fragment
@@ -924,18 +1560,15 @@ error_t dtlsFragmentHandshakeMessage(TlsContext *context, uint16_t version,
          //Records may not span datagrams
          if((context->txDatagramLen + n) > pmtu)
          {
-            //Debug message
-            TRACE_INFO("Sending UDP datagram (%u bytes)...\r\n", context->txDatagramLen);
-
-            //Send datagram
-            error = context->socketSendCallback(context->socketHandle,
-               datagram, context->txDatagramLen, &n, 0);
+            //The datagram is complete
+            error = dtlsSendDatagram(context);
             //Any error to report?
             if(error)
                return error;
 
-            //The datagram has been successfully transmitted
-            context->txDatagramLen = 0;
+            //Point to the buffer where to format the next datagram
+            datagram = context->txBuffer + context->txBufferLen +
+               context->txBatchLen;
          }
       }
 
@@ -976,26 +1609,22 @@ error_t dtlsFragmentHandshakeMessage(TlsContext *context, uint16_t version,
       TRACE_DEBUG("  fragLength = %u\r\n", LOAD24BE(fragment->fragLength));
       TRACE_DEBUG("  length = %u\r\n", LOAD24BE(fragment->length));
 
-      //Protect record payload?
-      if(encryptionEngine->cipherMode != CIPHER_MODE_NULL ||
-         encryptionEngine->hashAlgo != NULL)
-      {
-         //Encrypt DTLS record
-         error = tlsEncryptRecord(context, encryptionEngine, record);
-         //Any error to report?
-         if(error)
-            return error;
-      }
+#if (DTLS_FLIGHT_CACHE_SUPPORT == ENABLED)
+      //Keep a copy of the record as laid out in the datagram
+      dtlsCacheFlightRecord(context, record);
+#endif
 
-      //Debug message
-      TRACE_DEBUG("Encrypted DTLS record (%" PRIuSIZE " bytes)...\r\n", ntohs(record->length));
-      TRACE_DEBUG_ARRAY("  ", record, ntohs(record->length) + sizeof(DtlsRecord));
+      //Encrypt DTLS record
+      error = dtlsProtectRecord(context, encryptionEngine, record, &n);
+      //Any error to report?
+      if(error)
+         return error;
 
       //Increment sequence number
       dtlsIncSequenceNumber(&encryptionEngine->dtlsSeqNum);
 
       //Adjust the length of the datagram
-      context->txDatagramLen += ntohs(record->length) + sizeof(DtlsRecord);
+      context->txDatagramLen += n;
 
       //Next fragment
       fragOffset += fragLength;
@@ -1171,6 +1800,19 @@ error_t dtlsReadDatagram(TlsContext *context, uint8_t *data,
       error = context->socketReceiveCallback(context->socketHandle, data,
          size, length, 0);
 
+#if (DTLS_SRTP_SUPPORT == ENABLED)
+      //SRTP, SRTCP and STUN packets may share the socket with DTLS. The
+      //value of the first byte tells them apart (refer to RFC 7983)
+      if(error == NO_ERROR && context->srtpCallback != NULL &&
+         (*length == 0 || data[0] < 20 || data[0] > 63))
+      {
+         //Hand the packet over to the SRTP stack of the application
+         context->srtpCallback(context, data, *length, context->srtpParam);
+         //Wait for the next datagram
+         continue;
+      }
+#endif
+
       //Check status code
       if(error == NO_ERROR)
       {
@@ -1267,6 +1909,9 @@ error_t dtlsTick(TlsContext *context)
                //the RFC 6298 maximum of 60 seconds
                context->retransmitTimeout = MIN(context->retransmitTimeout * 2,
                   DTLS_MAX_TIMEOUT);
+
+               //Move the retransmission timer to the new deadline
+               dtlsArmTimer(context);
             }
             else
             {
@@ -49,11 +49,24 @@ error_t dtlsReadProtocolData(TlsContext *context,
 error_t dtlsWriteRecord(TlsContext *context, const uint8_t *data,
    size_t length, TlsContentType contentType);
 
+error_t dtlsFlushDatagram(TlsContext *context);
+error_t dtlsSendDatagram(TlsContext *context);
+error_t dtlsFlushBatch(TlsContext *context);
+
+error_t dtlsProtectRecord(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, DtlsRecord *record, size_t *length);
+
 error_t dtlsReadRecord(TlsContext *context);
+error_t dtlsParseInnerPlaintext(DtlsRecord *record);
 error_t dtlsProcessRecord(TlsContext *context);
 
 error_t dtlsSendFlight(TlsContext *context);
 
+bool_t dtlsPrepareFlightCache(TlsContext *context);
+void dtlsCacheFlightRecord(TlsContext *context, const DtlsRecord *record);
+error_t dtlsResendFlight(TlsContext *context);
+void dtlsFreeFlightCache(TlsContext *context);
+
 error_t dtlsFragmentHandshakeMessage(TlsContext *context, uint16_t version,
    TlsEncryptionEngine *encryptionEngine, const DtlsHandshake *message);
 
@@ -0,0 +1,416 @@
+/**
+ * @file dtls_timer.c
+ * @brief Retransmission timer wheel shared by many DTLS contexts
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "dtls_misc.h"
+#include "dtls_timer.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && DTLS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Timer wheel initialization
+ *
+ * The retransmission timers of all the contexts attached to the wheel are
+ * kept in a hierarchical timer wheel. Arming, moving and cancelling a timer
+ * take constant time, and dtlsPollTimerWheel() only returns the contexts
+ * whose timer has actually expired, instead of polling every context
+ *
+ * @param[in] resolution Duration of a tick, in milliseconds
+ * @return Pointer to the newly created timer wheel
+ **/
+
+DtlsTimerWheel *dtlsInitTimerWheel(systime_t resolution)
+{
+   DtlsTimerWheel *timerWheel;
+
+   //Check parameters
+   if(resolution == 0)
+      return NULL;
+
+   //Allocate a memory buffer to hold the timer wheel
+   timerWheel = tlsAllocMem(sizeof(DtlsTimerWheel));
+   //Failed to allocate memory?
+   if(timerWheel == NULL)
+      return NULL;
+
+   //Clear the timer wheel
+   memset(timerWheel, 0, sizeof(DtlsTimerWheel));
+
+   //Create a mutex to prevent simultaneous access to the timer wheel
+   if(!osCreateMutex(&timerWheel->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(timerWheel);
+      //Report an error
+      return NULL;
+   }
+
+   //Save the duration of a tick
+   timerWheel->resolution = resolution;
+   //Start the first tick
+   timerWheel->tickTime = osGetSystemTime();
+
+   //Return a pointer to the newly created timer wheel
+   return timerWheel;
+}
+
+
+/**
+ * @brief Get the next context whose retransmission timer has expired
+ *
+ * The application is expected to resume the handshake of the returned
+ * context (tlsConnect), which retransmits the flight of messages and
+ * re-arms the timer
+ *
+ * @param[in] timerWheel Pointer to the timer wheel
+ * @param[out] context Context whose timer has expired
+ * @return Error code
+ **/
+
+error_t dtlsPollTimerWheel(DtlsTimerWheel *timerWheel, TlsContext **context)
+{
+   //Check parameters
+   if(timerWheel == NULL || context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the timer wheel
+   osAcquireMutex(&timerWheel->mutex);
+
+   //Process the ticks that have elapsed
+   dtlsAdvanceTimerWheel(timerWheel, osGetSystemTime());
+
+   //Point to the first expired timer
+   *context = timerWheel->expired;
+
+   //Any timer expired?
+   if(*context != NULL)
+   {
+      //The timer is no longer armed
+      dtlsUnlinkTimer(*context);
+      timerWheel->numTimers--;
+   }
+
+   //Release exclusive access to the timer wheel
+   osReleaseMutex(&timerWheel->mutex);
+
+   //Return status code
+   return (*context != NULL) ? NO_ERROR : ERROR_WOULD_BLOCK;
+}
+
+
+/**
+ * @brief Arm (or move) the retransmission timer of a context
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void dtlsArmTimer(TlsContext *context)
+{
+   int32_t delay;
+   uint32_t ticks;
+   DtlsTimerWheel *timerWheel;
+
+   //Point to the timer wheel
+   timerWheel = context->timerWheel;
+
+   //The retransmission timer is polled by dtlsTick if no wheel is used
+   if(timerWheel != NULL)
+   {
+      //Acquire exclusive access to the timer wheel
+      osAcquireMutex(&timerWheel->mutex);
+
+      //Process the ticks that have elapsed
+      dtlsAdvanceTimerWheel(timerWheel, osGetSystemTime());
+
+      //Cancel the previous deadline
+      if(context->timerPrev != NULL)
+      {
+         dtlsUnlinkTimer(context);
+         timerWheel->numTimers--;
+      }
+
+      //Time remaining before the retransmission timer expires
+      delay = timeCompare(context->retransmitTimestamp +
+         context->retransmitTimeout, timerWheel->tickTime);
+
+      //Round up to the next tick, so that the timer never expires early
+      if(delay > 0)
+         ticks = (delay + timerWheel->resolution - 1) / timerWheel->resolution;
+      else
+         ticks = 1;
+
+      //Insert the timer
+      context->timerExpiry = timerWheel->currentTick + ticks;
+      dtlsInsertTimer(timerWheel, context);
+      timerWheel->numTimers++;
+
+      //Release exclusive access to the timer wheel
+      osReleaseMutex(&timerWheel->mutex);
+   }
+}
+
+
+/**
+ * @brief Cancel the retransmission timer of a context
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void dtlsDisarmTimer(TlsContext *context)
+{
+   DtlsTimerWheel *timerWheel;
+
+   //Point to the timer wheel
+   timerWheel = context->timerWheel;
+
+   //Valid timer wheel?
+   if(timerWheel != NULL)
+   {
+      //Acquire exclusive access to the timer wheel
+      osAcquireMutex(&timerWheel->mutex);
+
+      //Armed timer?
+      if(context->timerPrev != NULL)
+      {
+         dtlsUnlinkTimer(context);
+         timerWheel->numTimers--;
+      }
+
+      //Release exclusive access to the timer wheel
+      osReleaseMutex(&timerWheel->mutex);
+   }
+}
+
+
+/**
+ * @brief Insert a timer in the slot matching its expiry tick
+ *
+ * Level n holds the timers that expire within DTLS_TIMER_WHEEL_SLOTS^(n+1)
+ * ticks. Deadlines beyond the range of the wheel are truncated, and the
+ * timer is simply checked again by dtlsTick when it fires
+ *
+ * @param[in] timerWheel Pointer to the timer wheel
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void dtlsInsertTimer(DtlsTimerWheel *timerWheel, TlsContext *context)
+{
+   uint_t level;
+   uint32_t unit;
+   uint32_t delta;
+
+   //The deadline has already been reached?
+   if((int32_t) (context->timerExpiry - timerWheel->currentTick) <= 0)
+   {
+      //The timer is expired
+      dtlsLinkTimer(&timerWheel->expired, context);
+   }
+   else
+   {
+      //Number of ticks before the deadline
+      delta = context->timerExpiry - timerWheel->currentTick;
+
+      //Select the level whose range covers the deadline
+      for(level = 0, unit = 1; level < (DTLS_TIMER_WHEEL_LEVELS - 1) &&
+         delta >= (unit * DTLS_TIMER_WHEEL_SLOTS); level++)
+      {
+         unit *= DTLS_TIMER_WHEEL_SLOTS;
+      }
+
+      //Truncate deadlines beyond the range of the wheel
+      if(delta >= (unit * DTLS_TIMER_WHEEL_SLOTS))
+      {
+         context->timerExpiry = timerWheel->currentTick +
+            unit * DTLS_TIMER_WHEEL_SLOTS - 1;
+      }
+
+      //Insert the timer in the matching slot
+      dtlsLinkTimer(&timerWheel->slots[level][(context->timerExpiry / unit) &
+         (DTLS_TIMER_WHEEL_SLOTS - 1)], context);
+   }
+}
+
+
+/**
+ * @brief Insert a timer at the head of a list
+ * @param[in] head Head of the list
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void dtlsLinkTimer(TlsContext **head, TlsContext *context)
+{
+   //Insert the timer at the head of the list
+   context->timerNext = *head;
+   context->timerPrev = head;
+
+   //Update the backward link of the next timer
+   if(*head != NULL)
+   {
+      (*head)->timerPrev = &context->timerNext;
+   }
+
+   //Update the head of the list
+   *head = context;
+}
+
+
+/**
+ * @brief Remove a timer from the list it belongs to
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void dtlsUnlinkTimer(TlsContext *context)
+{
+   //Update the link pointing to this timer
+   *context->timerPrev = context->timerNext;
+
+   //Update the backward link of the next timer
+   if(context->timerNext != NULL)
+   {
+      context->timerNext->timerPrev = context->timerPrev;
+   }
+
+   //The timer is no longer armed
+   context->timerNext = NULL;
+   context->timerPrev = NULL;
+}
+
+
+/**
+ * @brief Process the ticks that have elapsed
+ * @param[in] timerWheel Pointer to the timer wheel
+ * @param[in] time Current time
+ **/
+
+void dtlsAdvanceTimerWheel(DtlsTimerWheel *timerWheel, systime_t time)
+{
+   uint_t i;
+   uint_t level;
+   uint32_t unit;
+   TlsContext **slot;
+   TlsContext *context;
+   TlsContext *next;
+
+   //No timer armed?
+   if(timerWheel->numTimers == 0)
+   {
+      //There is no need to walk through the elapsed ticks
+      if(timeCompare(time, timerWheel->tickTime) > 0)
+      {
+         timerWheel->tickTime = time;
+      }
+   }
+
+   //Process the elapsed ticks one at a time
+   while(timeCompare(time, timerWheel->tickTime + timerWheel->resolution) >= 0)
+   {
+      //Move to the next tick
+      timerWheel->tickTime += timerWheel->resolution;
+      timerWheel->currentTick++;
+
+      //The timers of a higher level slot are spread over the lower levels
+      //once the current tick reaches the start of the slot
+      for(level = DTLS_TIMER_WHEEL_LEVELS - 1; level > 0; level--)
+      {
+         //Number of ticks covered by a slot at this level
+         for(i = 0, unit = 1; i < level; i++)
+         {
+            unit *= DTLS_TIMER_WHEEL_SLOTS;
+         }
+
+         //Start of a slot?
+         if((timerWheel->currentTick % unit) == 0)
+         {
+            //Point to the slot
+            slot = &timerWheel->slots[level][(timerWheel->currentTick / unit) &
+               (DTLS_TIMER_WHEEL_SLOTS - 1)];
+
+            //Detach the list of timers from the slot
+            context = *slot;
+            *slot = NULL;
+
+            //Insert the timers again, relative to the current tick
+            while(context != NULL)
+            {
+               next = context->timerNext;
+               dtlsInsertTimer(timerWheel, context);
+               context = next;
+            }
+         }
+      }
+
+      //Point to the level 0 slot matching the current tick
+      slot = &timerWheel->slots[0][timerWheel->currentTick &
+         (DTLS_TIMER_WHEEL_SLOTS - 1)];
+
+      //Detach the list of timers from the slot
+      context = *slot;
+      *slot = NULL;
+
+      //All these timers expire now
+      while(context != NULL)
+      {
+         next = context->timerNext;
+         dtlsLinkTimer(&timerWheel->expired, context);
+         context = next;
+      }
+   }
+}
+
+
+/**
+ * @brief Release timer wheel
+ *
+ * The contexts attached to the timer wheel must be released first
+ *
+ * @param[in] timerWheel Pointer to the timer wheel
+ **/
+
+void dtlsFreeTimerWheel(DtlsTimerWheel *timerWheel)
+{
+   //Valid timer wheel?
+   if(timerWheel != NULL)
+   {
+      //Release previously allocated resources
+      osDeleteMutex(&timerWheel->mutex);
+
+      //Clear the timer wheel before freeing memory
+      memset(timerWheel, 0, sizeof(DtlsTimerWheel));
+      tlsFreeMem(timerWheel);
+   }
+}
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file dtls_timer.h
+ * @brief Retransmission timer wheel shared by many DTLS contexts
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _DTLS_TIMER_H
+#define _DTLS_TIMER_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//DTLS timer wheel related functions
+void dtlsArmTimer(TlsContext *context);
+void dtlsDisarmTimer(TlsContext *context);
+
+void dtlsInsertTimer(DtlsTimerWheel *timerWheel, TlsContext *context);
+void dtlsLinkTimer(TlsContext **head, TlsContext *context);
+void dtlsUnlinkTimer(TlsContext *context);
+void dtlsAdvanceTimerWheel(DtlsTimerWheel *timerWheel, systime_t time);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -83,7 +83,7 @@ error_t sslExpandKey(const uint8_t *secret, size_t secretLen,
       return ERROR_INVALID_LENGTH;
 
    //Allocate a memory buffer to hold the MD5 context
-   md5Context = tlsAllocMem(sizeof(Md5Context));
+   md5Context = tlsAllocObject(TLS_MEM_CLASS_HASH_CONTEXT, sizeof(Md5Context));
    //Failed to allocate memory?
    if(md5Context == NULL)
    {
@@ -92,12 +92,13 @@ error_t sslExpandKey(const uint8_t *secret, size_t secretLen,
    }
 
    //Allocate a memory buffer to hold the SHA-1 context
-   sha1Context = tlsAllocMem(sizeof(Sha1Context));
+   sha1Context = tlsAllocObject(TLS_MEM_CLASS_HASH_CONTEXT,
+      sizeof(Sha1Context));
    //Failed to allocate memory?
    if(sha1Context == NULL)
    {
       //Clean up side effects
-      tlsFreeMem(md5Context);
+      tlsFreeObject(TLS_MEM_CLASS_HASH_CONTEXT, md5Context);
       //Report an error
       return ERROR_OUT_OF_MEMORY;
    }
@@ -133,8 +134,8 @@ error_t sslExpandKey(const uint8_t *secret, size_t secretLen,
    }
 
    //Release previously allocated resources
-   tlsFreeMem(md5Context);
-   tlsFreeMem(sha1Context);
+   tlsFreeObject(TLS_MEM_CLASS_HASH_CONTEXT, md5Context);
+   tlsFreeObject(TLS_MEM_CLASS_HASH_CONTEXT, sha1Context);
 
    //Successful processing
    return NO_ERROR;
@@ -42,13 +42,30 @@
 #include <ctype.h>
 #include "tls.h"
 #include "tls_handshake.h"
+#include "tls_arena.h"
 #include "tls_common.h"
 #include "tls_certificate.h"
+#include "tls_credential.h"
+#include "tls_trust_store.h"
+#include "tls_cert_store.h"
+#include "tls_cert_stream.h"
+#include "tls_ocsp.h"
+#include "tls_stats.h"
+#include "tls_shared_config.h"
+#include "tls_buffer.h"
+#include "tls_offload.h"
+#include "tls_signature.h"
+#include "tls_sign_engine.h"
 #include "tls_transcript_hash.h"
+#include "tls_extensions.h"
+#include "tls_key_material.h"
 #include "tls_record.h"
 #include "tls_misc.h"
 #include "tls13_client_misc.h"
+#include "tls13_server.h"
 #include "dtls_record.h"
+#include "dtls_listener.h"
+#include "dtls_timer.h"
 #include "pkix/pem_import.h"
 #include "pkix/x509_cert_parse.h"
 #include "debug.h"
@@ -64,6 +81,7 @@
 
 TlsContext *tlsInit(void)
 {
+   error_t error;
    TlsContext *context;
 
    //Allocate a memory buffer to hold the TLS context
@@ -72,111 +90,333 @@ TlsContext *tlsInit(void)
    //Successful memory allocation?
    if(context != NULL)
    {
-      //Clear TLS context
-      memset(context, 0, sizeof(TlsContext));
+      //Initialize TLS context with default settings
+      error = tlsInitContext(context);
+
+      //Any error to report?
+      if(error)
+      {
+         //Clean up side effects
+         tlsFreeMem(context);
+         context = NULL;
+      }
+   }
+
+   //Return a pointer to the freshly created TLS context
+   return context;
+}
+
+
+/**
+ * @brief TLS context initialization in caller-supplied memory
+ *
+ * The TLS context, its TX and RX buffers, the handshake key material, the
+ * per-handshake arena and the cipher, HMAC and GCM contexts of the record
+ * layer are all placed in the specified memory block, whose size can be
+ * computed at compile time with TLS_STATIC_MEM_SIZE(). The transcript hash,
+ * the handshake message log, the temporary hash and HMAC contexts of the key
+ * schedule and the buffers of the incremental Certificate parser come from
+ * the arena, and the handshake fails rather than falling back to the heap
+ * when the arena is exhausted (with TLS 1.2, the handshake message log alone
+ * takes TLS_TRANSCRIPT_LOG_SIZE bytes). The memory block must be suitably
+ * aligned and must remain valid until tlsFree() is called
+ *
+ * The following allocations are still made from the heap (or from the
+ * memory pools):
+ * - MPI temporaries and key objects inside the crypto library
+ * - The HMAC contexts of tlsPrf(), tls12Prf(), tls13HkdfExpandLabel() and
+ *   tls13DeriveTrafficKeys(), which are not bound to a TLS context
+ * - Key derivations performed while no handshake is in progress (TLS 1.3
+ *   KeyUpdate, keying material exporters)
+ * - Per-connection strings and blobs (server name, selected ALPN protocol,
+ *   cookie, session tickets, certificate request context, result of the
+ *   external session cache lookup)
+ * - The state of a crypto provider that claims an encryption engine
+ *
+ * @param[in] buffer Memory block provided by the caller
+ * @param[in] size Size of the memory block, in bytes
+ * @param[in] profile Sizes of the TX and RX buffers and of the arena
+ * @return Handle referencing the fully initialized TLS context
+ **/
+
+TlsContext *tlsInitStatic(void *buffer, size_t size,
+   const TlsStaticProfile *profile)
+{
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   error_t error;
+   uint8_t *p;
+   TlsContext *context;
+
+   //Check parameters
+   if(buffer == NULL || profile == NULL)
+      return NULL;
+
+   //Check the size of the TX and RX buffers
+   if(profile->txBufferSize < TLS_MIN_RECORD_LENGTH ||
+      profile->rxBufferSize < TLS_MIN_RECORD_LENGTH)
+   {
+      return NULL;
+   }
+
+   //Make sure the memory block is large enough
+   if(size < TLS_STATIC_MEM_SIZE(profile->txBufferSize,
+      profile->rxBufferSize, profile->handshakeArenaSize))
+   {
+      return NULL;
+   }
+
+   //The TLS context is placed at the beginning of the memory block
+   context = (TlsContext *) buffer;
+
+   //Initialize TLS context with default settings
+   error = tlsInitContext(context);
+   //Any error to report?
+   if(error)
+      return NULL;
+
+   //Set the size of the TX and RX buffers
+   tlsSetBufferSize(context, profile->txBufferSize, profile->rxBufferSize);
+
+   //The context lives in memory supplied by the caller
+   context->staticMem = TRUE;
+
+   //Point to the memory following the TLS context
+   p = (uint8_t *) buffer + TLS_ARENA_ALIGN(sizeof(TlsContext));
+
+   //TX buffer
+   context->staticTxBuffer = p;
+   context->staticTxBufferSize = TLS_STATIC_BUFFER_SIZE(profile->txBufferSize);
+   p += context->staticTxBufferSize;
+
+   //RX buffer
+   context->staticRxBuffer = p;
+   context->staticRxBufferSize = TLS_STATIC_BUFFER_SIZE(profile->rxBufferSize);
+   p += context->staticRxBufferSize;
+
+   //Handshake key material, immediately followed by the arena
+   context->staticHandshake = (TlsHandshakeContext *) p;
+   context->staticArenaSize = TLS_ARENA_ALIGN(profile->handshakeArenaSize);
+   p += TLS_ARENA_ALIGN(sizeof(TlsHandshakeContext)) + context->staticArenaSize;
+
+   //Size of the per-handshake arena
+   context->handshakeArenaSize = context->staticArenaSize;
+
+   //Cipher, HMAC and GCM contexts of the encryption engines
+   context->staticEngines = (TlsStaticEngineMem *) p;
+   memset(p, 0, TLS_STATIC_NUM_ENGINES * sizeof(TlsStaticEngineMem));
+
+   //Return a pointer to the freshly created TLS context
+   return context;
+#else
+   //Static operating mode is not implemented
+   return NULL;
+#endif
+}
+
+
+/**
+ * @brief Initialize a TLS context with default settings
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsInitContext(TlsContext *context)
+{
+   //Clear TLS context
+   memset(context, 0, sizeof(TlsContext));
+
+#if (TLS_FULL_DUPLEX_SUPPORT == ENABLED)
+   //Create the mutex serializing the sending side
+   if(!osCreateMutex(&context->txMutex))
+   {
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Create the mutex serializing the receiving side
+   if(!osCreateMutex(&context->rxMutex))
+   {
+      //Clean up side effects
+      osDeleteMutex(&context->txMutex);
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+#endif
+
+   //Default state
+   context->state = TLS_STATE_INIT;
+   //Default transport protocol
+   context->transportProtocol = TLS_TRANSPORT_PROTOCOL_STREAM;
+   //Default operation mode
+   context->entity = TLS_CONNECTION_END_CLIENT;
+   //Default client authentication mode
+   context->clientAuthMode = TLS_CLIENT_AUTH_NONE;
+
+#if (TLS_STATS_SUPPORT == ENABLED)
+   //Bind the context to a shard of the global statistics
+   tlsInitContextStats(context);
+#endif
 
-      //Default state
-      context->state = TLS_STATE_INIT;
-      //Default transport protocol
-      context->transportProtocol = TLS_TRANSPORT_PROTOCOL_STREAM;
-      //Default operation mode
-      context->entity = TLS_CONNECTION_END_CLIENT;
-      //Default client authentication mode
-      context->clientAuthMode = TLS_CLIENT_AUTH_NONE;
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+   //No state has been reported to the trace callback yet
+   context->traceState = TLS_STATE_CLOSED;
+#endif
 
-      //Minimum and maximum versions accepted by the implementation
-      context->versionMin = TLS_MIN_VERSION;
-      context->versionMax = TLS_MAX_VERSION;
+   //Minimum and maximum versions accepted by the implementation
+   context->versionMin = TLS_MIN_VERSION;
+   context->versionMax = TLS_MAX_VERSION;
 
-      //Default record layer version number
-      context->version = TLS_MIN_VERSION;
-      context->encryptionEngine.version = TLS_MIN_VERSION;
+   //Default record layer version number
+   context->version = TLS_MIN_VERSION;
+   context->encryptionEngine.version = TLS_MIN_VERSION;
 
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
-      //Select default named group
-      if(tls13IsGroupSupported(context, TLS_GROUP_ECDH_X25519))
-      {
-         context->preferredGroup = TLS_GROUP_ECDH_X25519;
-      }
-      else if(tls13IsGroupSupported(context, TLS_GROUP_SECP256R1))
-      {
-         context->preferredGroup = TLS_GROUP_SECP256R1;
-      }
-      else
-      {
-         context->preferredGroup = TLS_GROUP_NONE;
-      }
+   //Select default named group
+   if(tls13IsGroupSupported(context, TLS_GROUP_ECDH_X25519))
+   {
+      context->preferredGroup = TLS_GROUP_ECDH_X25519;
+   }
+   else if(tls13IsGroupSupported(context, TLS_GROUP_SECP256R1))
+   {
+      context->preferredGroup = TLS_GROUP_SECP256R1;
+   }
+   else
+   {
+      context->preferredGroup = TLS_GROUP_NONE;
+   }
+
+   //Number of NewSessionTicket messages sent by the server
+   context->newSessionTicketLimit = TLS13_NEW_SESSION_TICKET_COUNT;
 #endif
 
 #if (DTLS_SUPPORT == ENABLED)
-      //Default PMTU
-      context->pmtu = DTLS_DEFAULT_PMTU;
-      //Default timeout
-      context->timeout = INFINITE_DELAY;
+   //Default PMTU
+   context->pmtu = DTLS_DEFAULT_PMTU;
+   //Default timeout
+   context->timeout = INFINITE_DELAY;
 #endif
 
 #if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
-      //Anti-replay mechanism is enabled by default
-      context->replayDetectionEnabled = TRUE;
+   //Anti-replay mechanism is enabled by default
+   context->replayDetectionEnabled = TRUE;
+
+   //Default sliding window
+   context->replayWindowSize = DTLS_REPLAY_WINDOW_SIZE;
+   context->replayWindowWords = dtlsComputeReplayWindowWords(DTLS_REPLAY_WINDOW_SIZE);
+   context->replayWindow = context->replayWindowBuffer;
 #endif
 
 #if (TLS_DH_SUPPORT == ENABLED)
-      //Initialize Diffie-Hellman context
-      dhInit(&context->dhContext);
+   //Initialize Diffie-Hellman context
+   dhInit(&context->dhContext);
 #endif
 
 #if (TLS_ECDH_SUPPORT == ENABLED)
-      //Initialize ECDH context
-      ecdhInit(&context->ecdhContext);
+   //Initialize ECDH context
+   ecdhInit(&context->ecdhContext);
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   ecdhInit(&context->speculativeEcdhContext);
+#endif
 #endif
 
 #if (TLS_RSA_SUPPORT == ENABLED)
-      //Initialize peer's RSA public key
-      rsaInitPublicKey(&context->peerRsaPublicKey);
+   //Initialize peer's RSA public key
+   rsaInitPublicKey(&context->peerRsaPublicKey);
 #endif
 
 #if (TLS_DSA_SIGN_SUPPORT == ENABLED)
-      //Initialize peer's DSA public key
-      dsaInitPublicKey(&context->peerDsaPublicKey);
+   //Initialize peer's DSA public key
+   dsaInitPublicKey(&context->peerDsaPublicKey);
 #endif
 
 #if (TLS_ECDSA_SIGN_SUPPORT == ENABLED || TLS_EDDSA_SIGN_SUPPORT == ENABLED)
-      //Initialize peer's EC domain parameters
-      ecInitDomainParameters(&context->peerEcParams);
-      //Initialize peer's EC public key
-      ecInit(&context->peerEcPublicKey);
+   //Initialize peer's EC domain parameters
+   ecInitDomainParameters(&context->peerEcParams);
+   //Initialize peer's EC public key
+   ecInit(&context->peerEcPublicKey);
 #endif
 
-      //Maximum number of plaintext data the TX and RX buffers can hold
-      context->txBufferMaxLen = TLS_MAX_RECORD_LENGTH;
-      context->rxBufferMaxLen = TLS_MAX_RECORD_LENGTH;
+   //Maximum number of plaintext data the TX and RX buffers can hold
+   context->txBufferMaxLen = TLS_MAX_RECORD_LENGTH;
+   context->rxBufferMaxLen = TLS_MAX_RECORD_LENGTH;
+
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+   //Size of the per-handshake arena
+   context->handshakeArenaSize = TLS_HANDSHAKE_ARENA_SIZE;
+#endif
 
 #if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
-      //Maximum fragment length
-      context->maxFragLen = TLS_MAX_RECORD_LENGTH;
+   //Maximum fragment length
+   context->maxFragLen = TLS_MAX_RECORD_LENGTH;
 #endif
 #if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
-      //Maximum record size the peer is willing to receive
-      context->recordSizeLimit = TLS_MAX_RECORD_LENGTH;
+   //Maximum record size the peer is willing to receive
+   context->recordSizeLimit = TLS_MAX_RECORD_LENGTH;
 #endif
 
 #if (DTLS_SUPPORT == ENABLED)
-      //Calculate the required size for the TX buffer
-      context->txBufferSize = context->txBufferMaxLen + sizeof(DtlsRecord) +
-         TLS_MAX_RECORD_OVERHEAD;
+   //Calculate the required size for the TX buffer
+   context->txBufferSize = context->txBufferMaxLen + sizeof(DtlsRecord) +
+      TLS_MAX_RECORD_OVERHEAD;
 
-      //Calculate the required size for the RX buffer
-      context->rxBufferSize = context->rxBufferMaxLen + sizeof(DtlsRecord) +
-         TLS_MAX_RECORD_OVERHEAD;
+   //Calculate the required size for the RX buffer
+   context->rxBufferSize = context->rxBufferMaxLen + sizeof(DtlsRecord) +
+      TLS_MAX_RECORD_OVERHEAD;
 #else
-      //Calculate the required size for the TX buffer
-      context->txBufferSize = context->txBufferMaxLen + sizeof(TlsRecord) +
-         TLS_MAX_RECORD_OVERHEAD;
+   //Calculate the required size for the TX buffer
+   context->txBufferSize = context->txBufferMaxLen + sizeof(TlsRecord) +
+      TLS_MAX_RECORD_OVERHEAD;
 
-      //Calculate the required size for the RX buffer
-      context->rxBufferSize = context->rxBufferMaxLen + sizeof(TlsRecord) +
-         TLS_MAX_RECORD_OVERHEAD;
+   //Calculate the required size for the RX buffer
+   context->rxBufferSize = context->rxBufferMaxLen + sizeof(TlsRecord) +
+      TLS_MAX_RECORD_OVERHEAD;
 #endif
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief TLS context initialization from a shared configuration
+ *
+ * The TLS context is a full context, copy-initialized from the settings
+ * held by the configuration (refer to tlsCopyConfig). The data that are
+ * costly to build (cipher suite lists and table, credentials, trusted CA
+ * store, ALPN list, etc.) are referenced rather than duplicated, but
+ * scalar settings are copied, so the context can be tuned afterwards with
+ * the tlsSetXxx() functions. The configuration is frozen by this call and
+ * the context holds its own reference to it
+ *
+ * @param[in] config Shared configuration created by tlsInitConfig()
+ * @return Handle referencing the fully initialized TLS context
+ **/
+
+TlsContext *tlsInitFromConfig(TlsConfig *config)
+{
+   error_t error;
+   TlsContext *context;
+
+   //Check parameters
+   if(config == NULL)
+      return NULL;
+
+   //Initialize TLS context with default settings
+   context = tlsInit();
+
+   //Successful initialization?
+   if(context != NULL)
+   {
+      //Copy the settings of the configuration into the TLS context
+      error = tlsCopyConfig(context, config);
+
+      //Any error to report?
+      if(error)
+      {
+         //Clean up side effects
+         tlsFree(context);
+         context = NULL;
+      }
    }
 
    //Return a pointer to the freshly created TLS context
@@ -184,6 +424,40 @@ TlsContext *tlsInit(void)
 }
 
 
+/**
+ * @brief TLS context initialization from a configuration slot
+ *
+ * The TLS context is bound to the configuration currently published in the
+ * slot. It keeps a reference to that configuration (and to the credentials
+ * it holds) until it is released, even if a newer configuration is
+ * published in the meantime
+ *
+ * @param[in] slot Configuration slot created by tlsInitConfigSlot()
+ * @return Pointer to the TLS context
+ **/
+
+TlsContext *tlsInitFromConfigSlot(TlsConfigSlot *slot)
+{
+   TlsConfig *config;
+   TlsContext *context;
+
+   //Get the configuration currently published in the slot
+   config = tlsAcquireConfig(slot);
+   //No configuration published yet?
+   if(config == NULL)
+      return NULL;
+
+   //Initialize the TLS context from the configuration
+   context = tlsInitFromConfig(config);
+
+   //The TLS context holds its own reference to the configuration
+   tlsFreeConfig(config);
+
+   //Return a pointer to the freshly created TLS context
+   return context;
+}
+
+
 /**
  * @brief Retrieve current state
  * @param[in] context Pointer to the TLS context
@@ -238,6 +512,185 @@ error_t tlsSetSocketCallbacks(TlsContext *context,
 }
 
 
+/**
+ * @brief Set socket send batch callback (for DTLS only)
+ *
+ * When registered, the datagrams of a flight and the application data
+ * datagrams completed within a single write are handed over together,
+ * so that they can be sent with a single sendmmsg call. The callback is
+ * invoked with the same socket handle as the send callback
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] socketSendBatchCallback Send batch callback function (NULL to
+ *   send one datagram at a time)
+ * @return Error code
+ **/
+
+error_t tlsSetSocketSendBatchCallback(TlsContext *context,
+   TlsSocketSendBatchCallback socketSendBatchCallback)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The callback cannot be changed while datagrams are waiting in the batch
+   if(context->txBatchCount > 0)
+      return ERROR_WRONG_STATE;
+
+   //Save send batch callback function
+   context->socketSendBatchCallback = socketSendBatchCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set socket submit callbacks (completion-based transport)
+ *
+ * With a completion-based transport (io_uring, IOCP, RDMA), the record layer
+ * does not call the send and receive callbacks. It posts requests instead,
+ * asking the transport to send bytes directly from the TX buffer, or to fill
+ * the RX buffer with up to a given number of bytes, and returns
+ * ERROR_WOULD_BLOCK. Once the transport has completed a request, the
+ * application reports the outcome with tlsCompleteSend or tlsCompleteReceive
+ * and calls the interrupted TLS function again. At most one send request and
+ * one receive request are in progress at any time.
+ *
+ * The buffers referenced by a request are not released or resized until the
+ * request has completed. Combined with a pool created by
+ * tlsInitRegisteredBufferPool, the TX and RX buffers can be registered with
+ * the transport ahead of time. A read-ahead buffer (tlsSetReceiveBatchSize)
+ * is recommended, so that each receive request can cover several records.
+ * The socket callbacks registered with tlsSetSocketCallbacks are only used
+ * by an offloaded record layer. The requests in progress must have completed,
+ * or have been cancelled, before the context is released
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] socketSubmitSendCallback Submit send callback function
+ * @param[in] socketSubmitReceiveCallback Submit receive callback function
+ * @return Error code
+ **/
+
+error_t tlsSetSocketSubmitCallbacks(TlsContext *context,
+   TlsSocketSubmitSendCallback socketSubmitSendCallback,
+   TlsSocketSubmitReceiveCallback socketSubmitReceiveCallback)
+{
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Both callbacks must be provided (or none to restore the default mode)
+   if((socketSubmitSendCallback == NULL) !=
+      (socketSubmitReceiveCallback == NULL))
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //The completion-based transport is not applicable to DTLS
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+      return ERROR_INVALID_PARAMETER;
+
+   //The callbacks cannot be changed while requests are in progress
+   if(context->txIoRequest.posted || context->rxIoRequest.posted)
+      return ERROR_WRONG_STATE;
+
+   //Save submit callback functions
+   context->socketSubmitSendCallback = socketSubmitSendCallback;
+   context->socketSubmitReceiveCallback = socketSubmitReceiveCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Completion-based transport is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Report the completion of a send request
+ * @param[in] context Pointer to the TLS context
+ * @param[in] status Completion status (NO_ERROR on success, or the error
+ *   reported by the transport)
+ * @param[in] written Number of bytes the transport has sent
+ * @return Error code
+ **/
+
+error_t tlsCompleteSend(TlsContext *context, error_t status, size_t written)
+{
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //No send request in progress?
+   if(!context->txIoRequest.posted || context->txIoRequest.completed)
+      return ERROR_WRONG_STATE;
+
+   //The transport cannot send more bytes than requested
+   if(written > context->txIoRequest.length)
+      return ERROR_INVALID_LENGTH;
+
+   //Save the outcome of the request
+   context->txIoRequest.count = written;
+   context->txIoRequest.status = status;
+   context->txIoRequest.completed = TRUE;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Completion-based transport is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Report the completion of a receive request
+ * @param[in] context Pointer to the TLS context
+ * @param[in] status Completion status (NO_ERROR on success, or the error
+ *   reported by the transport)
+ * @param[in] received Number of bytes the transport has stored in the buffer
+ * @return Error code
+ **/
+
+error_t tlsCompleteReceive(TlsContext *context, error_t status,
+   size_t received)
+{
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //No receive request in progress?
+   if(!context->rxIoRequest.posted || context->rxIoRequest.completed)
+      return ERROR_WRONG_STATE;
+
+   //The transport cannot store more bytes than requested
+   if(received > context->rxIoRequest.length)
+      return ERROR_INVALID_LENGTH;
+
+   //Save the outcome of the request
+   context->rxIoRequest.count = received;
+   context->rxIoRequest.status = status;
+   context->rxIoRequest.completed = TRUE;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Completion-based transport is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Set minimum and maximum versions permitted
  * @param[in] context Pointer to the TLS context
@@ -450,20 +903,20 @@ error_t tlsSetCache(TlsContext *context, TlsCache *cache)
 
 
 /**
- * @brief Set client authentication mode (for servers only)
+ * @brief Set client-side session store (for clients only)
  * @param[in] context Pointer to the TLS context
- * @param[in] mode Client authentication mode
+ * @param[in] store Session store created by tlsInitSessionStore()
  * @return Error code
  **/
 
-error_t tlsSetClientAuthMode(TlsContext *context, TlsClientAuthMode mode)
+error_t tlsSetSessionStore(TlsContext *context, TlsSessionStore *store)
 {
-   //Invalid TLS context?
+   //Check parameters
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save client authentication mode
-   context->clientAuthMode = mode;
+   //The store will be used to save and offer sessions automatically
+   context->sessionStore = store;
 
    //Successful processing
    return NO_ERROR;
@@ -471,24 +924,70 @@ error_t tlsSetClientAuthMode(TlsContext *context, TlsClientAuthMode mode)
 
 
 /**
- * @brief Set TLS buffer size
+ * @brief Set the port number of the server (for clients only)
+ *
+ * The port number, together with the server name and the list of ALPN
+ * protocols, identifies the entries of the client-side session store
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] txBufferSize TX buffer size
- * @param[in] rxBufferSize RX buffer size
+ * @param[in] port Port number of the server
  * @return Error code
  **/
 
-error_t tlsSetBufferSize(TlsContext *context, size_t txBufferSize,
-   size_t rxBufferSize)
+error_t tlsSetServerPort(TlsContext *context, uint16_t port)
 {
-   //Invalid TLS context?
+   //Check parameters
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Check parameters
-   if(txBufferSize < TLS_MIN_RECORD_LENGTH ||
-      rxBufferSize < TLS_MIN_RECORD_LENGTH)
-   {
+   //Save the port number
+   context->serverPort = port;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set client authentication mode (for servers only)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] mode Client authentication mode
+ * @return Error code
+ **/
+
+error_t tlsSetClientAuthMode(TlsContext *context, TlsClientAuthMode mode)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save client authentication mode
+   context->clientAuthMode = mode;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set TLS buffer size
+ * @param[in] context Pointer to the TLS context
+ * @param[in] txBufferSize TX buffer size
+ * @param[in] rxBufferSize RX buffer size
+ * @return Error code
+ **/
+
+error_t tlsSetBufferSize(TlsContext *context, size_t txBufferSize,
+   size_t rxBufferSize)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(txBufferSize < TLS_MIN_RECORD_LENGTH ||
+      rxBufferSize < TLS_MIN_RECORD_LENGTH)
+   {
       return ERROR_INVALID_PARAMETER;
    }
 
@@ -520,61 +1019,64 @@ error_t tlsSetBufferSize(TlsContext *context, size_t txBufferSize,
 
 
 /**
- * @brief Set maximum fragment length
+ * @brief Set the size of the per-handshake arena
+ *
+ * Handshake-scoped objects (certificate structures, DER buffers, temporary
+ * hash contexts) are carved out of an arena that is allocated together with
+ * the handshake key material and released in one shot when the handshake
+ * completes. Objects that do not fit fall back to the regular allocator.
+ * The new size applies to the next handshake
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] maxFragLen Maximum fragment length
+ * @param[in] size Size of the arena, in bytes (0 to disable the arena)
  * @return Error code
  **/
 
-error_t tlsSetMaxFragmentLength(TlsContext *context, size_t maxFragLen)
+error_t tlsSetHandshakeArenaSize(TlsContext *context, size_t size)
 {
-#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Make sure the specified value is acceptable (ref to RFC 6066, section 4)
-   if(maxFragLen != 512 && maxFragLen != 1024 &&
-      maxFragLen != 2048 && maxFragLen != 4096 &&
-      maxFragLen != 16384)
-   {
-      return ERROR_INVALID_PARAMETER;
-   }
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   //In static operating mode, the arena cannot exceed the memory reserved
+   //by tlsInitStatic()
+   if(context->staticMem && size > context->staticArenaSize)
+      return ERROR_INVALID_LENGTH;
+#endif
 
-   //Set maximum fragment length
-   context->maxFragLen = maxFragLen;
+   //Save the size of the arena
+   context->handshakeArenaSize = size;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //Not implemented
+   //Per-handshake arena is not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Specify the list of allowed cipher suites
+ * @brief Set the pool the TX and RX buffers are taken from
  * @param[in] context Pointer to the TLS context
- * @param[in] cipherSuites List of allowed cipher suites (most preferred first)
- * @param[in] length Number of cipher suites in the list
+ * @param[in] bufferPool Pool created by tlsInitBufferPool()
  * @return Error code
  **/
 
-error_t tlsSetCipherSuites(TlsContext *context, const uint16_t *cipherSuites,
-   uint_t length)
+error_t tlsSetBufferPool(TlsContext *context, TlsBufferPool *bufferPool)
 {
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Check parameters
-   if(cipherSuites == NULL && length != 0)
-      return ERROR_INVALID_PARAMETER;
+   //The pool cannot be changed while buffers are allocated
+   if(context->txBuffer != NULL || context->rxBuffer != NULL)
+      return ERROR_WRONG_STATE;
 
-   //Restrict the cipher suites that can be used
-   context->cipherSuites = cipherSuites;
-   context->numCipherSuites = length;
+   //Save the pool
+   context->bufferPool = bufferPool;
 
    //Successful processing
    return NO_ERROR;
@@ -582,27 +1084,20 @@ error_t tlsSetCipherSuites(TlsContext *context, const uint16_t *cipherSuites,
 
 
 /**
- * @brief Specify the list of allowed ECDHE and FFDHE groups
+ * @brief Set the pool the ephemeral key pairs are taken from
  * @param[in] context Pointer to the TLS context
- * @param[in] groups List of named groups
- * @param[in] length Number of named groups in the list
+ * @param[in] keyPairPool Pool created by tlsInitKeyPairPool()
  * @return Error code
  **/
 
-error_t tlsSetSupportedGroups(TlsContext *context, const uint16_t *groups,
-   uint_t length)
+error_t tlsSetKeyPairPool(TlsContext *context, TlsKeyPairPool *keyPairPool)
 {
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Check parameters
-   if(groups == NULL && length != 0)
-      return ERROR_INVALID_PARAMETER;
-
-   //Restrict the named groups that can be used
-   context->supportedGroups = groups;
-   context->numSupportedGroups = length;
+   //Save the pool
+   context->keyPairPool = keyPairPool;
 
    //Successful processing
    return NO_ERROR;
@@ -610,418 +1105,499 @@ error_t tlsSetSupportedGroups(TlsContext *context, const uint16_t *groups,
 
 
 /**
- * @brief Specify the preferred ECDHE or FFDHE group
+ * @brief Release the TX/RX buffers of idle connections
+ *
+ * When enabled, the TX and RX buffers are released as soon as they do not
+ * hold any pending data, and re-acquired (from the buffer pool, if any)
+ * when data needs to be sent or received. This considerably reduces the
+ * memory footprint of idle keep-alive connections
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] group Preferred ECDHE or FFDHE named group
+ * @param[in] enabled Specifies whether idle buffers are released
  * @return Error code
  **/
 
-error_t tlsSetPreferredGroup(TlsContext *context, uint16_t group)
+error_t tlsEnableBufferRelease(TlsContext *context, bool_t enabled)
 {
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save the preferred named group
-   context->preferredGroup = group;
+   //Enable or disable buffer release mode
+   context->bufferReleaseEnabled = enabled;
 
    //Successful processing
    return NO_ERROR;
-#else
-   //Not implemented
-   return ERROR_NOT_IMPLEMENTED;
-#endif
 }
 
 
 /**
- * @brief Import Diffie-Hellman parameters
+ * @brief Shrink the TX/RX buffers to the negotiated record size
+ *
+ * When enabled, the TX and RX buffers are reallocated (or given back to
+ * the buffer pool) once the handshake is complete, so that they are only
+ * large enough to hold the records allowed by the negotiated
+ * MaxFragmentLength and RecordSizeLimit extensions. A buffer that holds
+ * pending data is shrunk as soon as it becomes idle. Post-handshake
+ * messages must fit in the shrunk buffers
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] params PEM structure that holds Diffie-Hellman parameters
- * @param[in] length Total length of the DER structure
+ * @param[in] enabled Specifies whether the buffers are shrunk
  * @return Error code
  **/
 
-error_t tlsSetDhParameters(TlsContext *context, const char_t *params,
-   size_t length)
+error_t tlsEnableBufferShrink(TlsContext *context, bool_t enabled)
 {
-#if (TLS_DH_SUPPORT == ENABLED)
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Check parameters
-   if(params == NULL && length != 0)
-      return ERROR_INVALID_PARAMETER;
+   //Enable or disable buffer shrinking
+   context->bufferShrinkEnabled = enabled;
 
-   //Decode the PEM structure that holds Diffie-Hellman parameters
-   return pemImportDhParameters(params, length, &context->dhContext.params);
-#else
-   //Diffie-Hellman is not implemented
-   return ERROR_NOT_IMPLEMENTED;
-#endif
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Register ECDH key agreement callback function
+ * @brief Set the size of the read-ahead buffer (batched receive)
+ *
+ * When a read-ahead buffer is configured, each call to the receive callback
+ * fetches as many bytes as the socket can deliver, and consecutive TLS
+ * records are then parsed from the read-ahead buffer, thus reducing the
+ * number of calls per record. A size of zero disables the feature
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] ecdhCallback ECDH callback function
+ * @param[in] size Size of the read-ahead buffer
  * @return Error code
  **/
 
-error_t tlsSetEcdhCallback(TlsContext *context, TlsEcdhCallback ecdhCallback)
+error_t tlsSetReceiveBatchSize(TlsContext *context, size_t size)
 {
-#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
-   //Check parameters
-   if(context == NULL || ecdhCallback == NULL)
+   //Invalid TLS context?
+   if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save the ECDH key agreement callback function
-   context->ecdhCallback = ecdhCallback;
+   //Batched receive is not applicable to DTLS
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM &&
+      size != 0)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
 
-   //Successful processing
-   return NO_ERROR;
-#else
-   //PSK key exchange is not implemented
-   return ERROR_NOT_IMPLEMENTED;
+   //Data pending in the read-ahead buffer would be lost
+   if(context->rxAheadLen != 0)
+      return ERROR_WRONG_STATE;
+
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //The transport may still be filling the read-ahead buffer
+   if(context->rxIoRequest.posted)
+      return ERROR_WRONG_STATE;
 #endif
-}
 
+   //Release the previous read-ahead buffer, if any
+   if(context->rxAheadBuffer != NULL)
+   {
+      tlsFreeMem(context->rxAheadBuffer);
+      context->rxAheadBuffer = NULL;
+      context->rxAheadSize = 0;
+   }
 
-/**
- * @brief ECDSA signature generation callback function
- * @param[in] context Pointer to the TLS context
- * @param[in] ecdsaSignCallback ECDSA signature generation callback function
- * @return Error code
- **/
+   //Batched receive requested?
+   if(size != 0)
+   {
+      //Allocate the read-ahead buffer
+      context->rxAheadBuffer = tlsAllocMem(size);
+      //Failed to allocate memory?
+      if(context->rxAheadBuffer == NULL)
+         return ERROR_OUT_OF_MEMORY;
 
-error_t tlsSetEcdsaSignCallback(TlsContext *context,
-   TlsEcdsaSignCallback ecdsaSignCallback)
-{
-#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
-   //Check parameters
-   if(context == NULL || ecdsaSignCallback == NULL)
-      return ERROR_INVALID_PARAMETER;
+      //Save the size of the read-ahead buffer
+      context->rxAheadSize = size;
+   }
 
-   //Save the ECDSA signature generation callback function
-   context->ecdsaSignCallback = ecdsaSignCallback;
+   //Rewind to the beginning of the buffer
+   context->rxAheadPos = 0;
 
    //Successful processing
    return NO_ERROR;
-#else
-   //PSK key exchange is not implemented
-   return ERROR_NOT_IMPLEMENTED;
-#endif
 }
 
 
 /**
- * @brief Register ECDSA signature verification callback function
+ * @brief Set the size of the bulk send buffer
+ *
+ * When a bulk send buffer is configured, large writes are split into
+ * several TLS records which are encrypted back to back into this buffer and
+ * then handed to the send callback in a single call. The buffer must be
+ * able to hold at least two full-sized records. A size of zero disables the
+ * feature
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] ecdsaVerifyCallback ECDSA signature verification callback function
+ * @param[in] size Size of the bulk send buffer
  * @return Error code
  **/
 
-error_t tlsSetEcdsaVerifyCallback(TlsContext *context,
-   TlsEcdsaVerifyCallback ecdsaVerifyCallback)
+error_t tlsSetBulkSendSize(TlsContext *context, size_t size)
 {
-#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
-   //Check parameters
-   if(context == NULL || ecdsaVerifyCallback == NULL)
+   //Invalid TLS context?
+   if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save the ECDSA signature verification callback function
-   context->ecdsaVerifyCallback = ecdsaVerifyCallback;
+   //Bulk send is not applicable to DTLS
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM &&
+      size != 0)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //The buffer must be able to hold at least two full-sized records
+   if(size != 0 && size < (2 * (sizeof(TlsRecord) + TLS_MAX_RECORD_LENGTH +
+      TLS_MAX_RECORD_OVERHEAD)))
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Encrypted records are still waiting for transmission?
+   if(context->txBulkPos < context->txBulkLen)
+      return ERROR_WRONG_STATE;
+
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //The transport may still be reading the bulk send buffer
+   if(context->txIoRequest.posted)
+      return ERROR_WRONG_STATE;
+#endif
+
+   //Release the previous bulk send buffer, if any
+   if(context->txBulkBuffer != NULL)
+   {
+      tlsFreeMem(context->txBulkBuffer);
+      context->txBulkBuffer = NULL;
+      context->txBulkSize = 0;
+   }
+
+   //Bulk send requested?
+   if(size != 0)
+   {
+      //Allocate the bulk send buffer
+      context->txBulkBuffer = tlsAllocMem(size);
+      //Failed to allocate memory?
+      if(context->txBulkBuffer == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Save the size of the bulk send buffer
+      context->txBulkSize = size;
+   }
+
+   //The buffer is empty
+   context->txBulkLen = 0;
+   context->txBulkPos = 0;
 
    //Successful processing
    return NO_ERROR;
-#else
-   //PSK key exchange is not implemented
-   return ERROR_NOT_IMPLEMENTED;
-#endif
 }
 
 
 /**
- * @brief Register key logging callback function (for debugging purpose only)
+ * @brief Configure dynamic record sizing
+ *
+ * At the start of the connection, and again after an idle period,
+ * application data are sent in records small enough to fit in a single
+ * transport segment, so that the peer can decrypt the first bytes as soon
+ * as they arrive. Full-sized records are used once the specified number of
+ * bytes have been sent
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] keyLogCallback Key logging callback function
+ * @param[in] segmentSize Size of a transport segment, typically the TCP MSS
+ *   (0 to disable dynamic record sizing)
+ * @param[in] rampThreshold Number of application bytes to send in small
+ *   records before switching to full-sized records
+ * @param[in] idleTimeout Idle period, in milliseconds, after which small
+ *   records are used again (0 to never go back to small records)
  * @return Error code
  **/
 
-error_t tlsSetKeyLogCallback(TlsContext *context,
-   TlsKeyLogCallback keyLogCallback)
+error_t tlsSetDynamicRecordSizing(TlsContext *context, size_t segmentSize,
+   size_t rampThreshold, systime_t idleTimeout)
 {
-#if (TLS_KEY_LOG_SUPPORT == ENABLED)
-   //Check parameters
-   if(context == NULL || keyLogCallback == NULL)
+#if (TLS_DYNAMIC_RECORD_SIZING_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save the key logging callback function
-   context->keyLogCallback = keyLogCallback;
+   //Dynamic record sizing is not applicable to DTLS
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM &&
+      segmentSize != 0)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //The segment must be able to hold a record header and some payload
+   if(segmentSize != 0 && segmentSize <= (sizeof(TlsRecord) +
+      TLS_MAX_RECORD_OVERHEAD))
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Save the parameters of the policy
+   context->drsSegmentSize = segmentSize;
+   context->drsRampThreshold = rampThreshold;
+   context->drsIdleTimeout = idleTimeout;
+
+   //Start again with small records
+   context->drsBytesSent = 0;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //Key logging is not implemented
+   //Dynamic record sizing is not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Allow unknown ALPN protocols
+ * @brief Set maximum fragment length
  * @param[in] context Pointer to the TLS context
- * @param[in] allowed Specifies whether unknown ALPN protocols are allowed
+ * @param[in] maxFragLen Maximum fragment length
  * @return Error code
  **/
 
-error_t tlsAllowUnknownAlpnProtocols(TlsContext *context, bool_t allowed)
+error_t tlsSetMaxFragmentLength(TlsContext *context, size_t maxFragLen)
 {
-#if (TLS_ALPN_SUPPORT == ENABLED)
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Allow or disallow unknown ALPN protocols
-   context->unknownProtocolsAllowed = allowed;
+   //Make sure the specified value is acceptable (ref to RFC 6066, section 4)
+   if(maxFragLen != 512 && maxFragLen != 1024 &&
+      maxFragLen != 2048 && maxFragLen != 4096 &&
+      maxFragLen != 16384)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Set maximum fragment length
+   context->maxFragLen = maxFragLen;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //ALPN is not implemented
+   //Not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Set the list of supported ALPN protocols
+ * @brief Specify the list of allowed cipher suites
  * @param[in] context Pointer to the TLS context
- * @param[in] protocolList Comma-delimited list of supported protocols
+ * @param[in] cipherSuites List of allowed cipher suites (most preferred first)
+ * @param[in] length Number of cipher suites in the list
  * @return Error code
  **/
 
-error_t tlsSetAlpnProtocolList(TlsContext *context, const char_t *protocolList)
+error_t tlsSetCipherSuites(TlsContext *context, const uint16_t *cipherSuites,
+   uint_t length)
 {
-#if (TLS_ALPN_SUPPORT == ENABLED)
-   size_t length;
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
 
    //Check parameters
-   if(context == NULL || protocolList == NULL)
+   if(cipherSuites == NULL && length != 0)
       return ERROR_INVALID_PARAMETER;
 
-   //Retrieve the length of the list
-   length = strlen(protocolList);
-
-   //Check whether the list of supported protocols has already been configured
-   if(context->protocolList != NULL)
-   {
-      //Release memory
-      tlsFreeMem(context->protocolList);
-      context->protocolList = NULL;
-   }
-
-   //Check whether the list of protocols is valid
-   if(length > 0)
-   {
-      //Allocate a memory block to hold the list
-      context->protocolList = tlsAllocMem(length + 1);
-      //Failed to allocate memory?
-      if(context->protocolList == NULL)
-         return ERROR_OUT_OF_MEMORY;
+   //Restrict the cipher suites that can be used
+   context->cipherSuites = cipherSuites;
+   context->numCipherSuites = length;
 
-      //Save the list of supported protocols
-      strcpy(context->protocolList, protocolList);
-   }
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+   //The negotiation table is rebuilt on next use
+   tlsReleaseCipherSuiteTable(context);
+#endif
 
    //Successful processing
    return NO_ERROR;
-#else
-   //ALPN is not implemented
-   return ERROR_NOT_IMPLEMENTED;
-#endif
 }
 
 
 /**
- * @brief Get the name of the selected ALPN protocol
+ * @brief Define equal-preference groups in the list of allowed cipher suites
+ *
+ * When the server enforces its own preferences, the cipher suites that belong
+ * to the same group are ranked equally and the client's order decides among
+ * them. For instance, AES-GCM and ChaCha20Poly1305 can be grouped together so
+ * that clients without AES hardware get ChaCha20Poly1305 by listing it first
+ *
  * @param[in] context Pointer to the TLS context
- * @return Pointer to the protocol name
+ * @param[in] groups Array of flags, one per allowed cipher suite. A non-zero
+ *   value indicates that the cipher suite has the same preference as the
+ *   previous entry of the list
+ * @param[in] length Number of flags in the array
+ * @return Error code
  **/
 
-const char_t *tlsGetAlpnProtocol(TlsContext *context)
+error_t tlsSetCipherSuiteGroups(TlsContext *context, const uint8_t *groups,
+   uint_t length)
 {
-   static const char_t defaultProtocolName[] = "";
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
 
-#if (TLS_ALPN_SUPPORT == ENABLED)
-   //Valid protocol name?
-   if(context != NULL && context->selectedProtocol != NULL)
-   {
-      //Return the name of the selected protocol
-      return context->selectedProtocol;
-   }
-   else
+   //Check parameters
+   if(groups == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save equal-preference groups
+   context->cipherSuiteGroups = groups;
+   context->numCipherSuiteGroups = length;
+
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+   //The negotiation table is rebuilt on next use
+   tlsReleaseCipherSuiteTable(context);
 #endif
-   {
-      //Return an empty string
-      return defaultProtocolName;
-   }
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Set the pre-shared key to be used
+ * @brief Specify the list of allowed ECDHE and FFDHE groups
  * @param[in] context Pointer to the TLS context
- * @param[in] psk Pointer to the pre-shared key
- * @param[in] length Length of the pre-shared key, in bytes
+ * @param[in] groups List of named groups
+ * @param[in] length Number of named groups in the list
  * @return Error code
  **/
 
-error_t tlsSetPsk(TlsContext *context, const uint8_t *psk, size_t length)
+error_t tlsSetSupportedGroups(TlsContext *context, const uint16_t *groups,
+   uint_t length)
 {
-#if (TLS_PSK_SUPPORT == ENABLED)
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
    //Check parameters
-   if(psk == NULL && length != 0)
+   if(groups == NULL && length != 0)
       return ERROR_INVALID_PARAMETER;
 
-   //Check whether the pre-shared key has already been configured
-   if(context->psk != NULL)
-   {
-      //Release memory
-      memset(context->psk, 0, context->pskLen);
-      tlsFreeMem(context->psk);
-      context->psk = NULL;
-      context->pskLen = 0;
-   }
+   //Restrict the named groups that can be used
+   context->supportedGroups = groups;
+   context->numSupportedGroups = length;
 
-   //Valid PSK?
-   if(length > 0)
-   {
-      //Allocate a memory block to hold the pre-shared key
-      context->psk = tlsAllocMem(length);
-      //Failed to allocate memory?
-      if(context->psk == NULL)
-         return ERROR_OUT_OF_MEMORY;
+   //Successful processing
+   return NO_ERROR;
+}
 
-      //Save the pre-shared key
-      memcpy(context->psk, psk, length);
-      //Save the length of the key
-      context->pskLen = length;
-   }
 
+/**
+ * @brief Specify the preferred ECDHE or FFDHE group
+ * @param[in] context Pointer to the TLS context
+ * @param[in] group Preferred ECDHE or FFDHE named group
+ * @return Error code
+ **/
+
+error_t tlsSetPreferredGroup(TlsContext *context, uint16_t group)
+{
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
-   //For externally established PSKs, the hash algorithm must be set when the
-   //PSK is established, or default to SHA-256 if no such algorithm is defined
-   context->pskHashAlgo = TLS_HASH_ALGO_SHA256;
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
 
-   //The cipher suite must be provisioned along with the key
-   context->pskCipherSuite = 0;
-#endif
+   //Save the preferred named group
+   context->preferredGroup = group;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //PSK key exchange is not implemented
+   //Not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Set the PSK identity to be used by the client
+ * @brief Specify the ECDHE group of the speculative key share
+ *
+ * The client offers a second key share for this group, alongside the one
+ * for the preferred group, when a pre-generated key pair is available in
+ * the key pair pool. A server whose preferences differ can then complete
+ * the handshake without a HelloRetryRequest
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] pskIdentity NULL-terminated string that contains the PSK identity
+ * @param[in] group ECDHE named group (TLS_GROUP_NONE to disable the
+ *   speculative key share)
  * @return Error code
  **/
 
-error_t tlsSetPskIdentity(TlsContext *context, const char_t *pskIdentity)
+error_t tlsSetSpeculativeGroup(TlsContext *context, uint16_t group)
 {
-#if (TLS_PSK_SUPPORT == ENABLED)
-   size_t length;
-
-   //Check parameters
-   if(context == NULL || pskIdentity == NULL)
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid TLS context?
+   if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Retrieve the length of the PSK identity
-   length = strlen(pskIdentity);
-
-   //Check whether the PSK identity has already been configured
-   if(context->pskIdentity != NULL)
-   {
-      //Release memory
-      tlsFreeMem(context->pskIdentity);
-      context->pskIdentity = NULL;
-   }
-
-   //Valid PSK identity?
-   if(length > 0)
-   {
-      //Allocate a memory block to hold the PSK identity
-      context->pskIdentity = tlsAllocMem(length + 1);
-      //Failed to allocate memory?
-      if(context->pskIdentity == NULL)
-         return ERROR_OUT_OF_MEMORY;
-
-      //Save the PSK identity
-      strcpy(context->pskIdentity, pskIdentity);
-   }
+   //Save the named group of the speculative key share
+   context->speculativeGroup = group;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //PSK key exchange is not implemented
+   //Not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Set the PSK identity hint to be used by the server
+ * @brief Import Diffie-Hellman parameters
  * @param[in] context Pointer to the TLS context
- * @param[in] pskIdentityHint NULL-terminated string that contains the PSK identity hint
+ * @param[in] params PEM structure that holds Diffie-Hellman parameters
+ * @param[in] length Total length of the DER structure
  * @return Error code
  **/
 
-error_t tlsSetPskIdentityHint(TlsContext *context, const char_t *pskIdentityHint)
+error_t tlsSetDhParameters(TlsContext *context, const char_t *params,
+   size_t length)
 {
-#if (TLS_PSK_SUPPORT == ENABLED)
-   size_t length;
+#if (TLS_DH_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
 
    //Check parameters
-   if(context == NULL || pskIdentityHint == NULL)
+   if(params == NULL && length != 0)
       return ERROR_INVALID_PARAMETER;
 
-   //Retrieve the length of the PSK identity hint
-   length = strlen(pskIdentityHint);
+   //Decode the PEM structure that holds Diffie-Hellman parameters
+   TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+   return pemImportDhParameters(params, length, &context->dhContext.params);
+#else
+   //Diffie-Hellman is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
 
-   //Check whether the PSK identity hint has already been configured
-   if(context->pskIdentityHint != NULL)
-   {
-      //Release memory
-      tlsFreeMem(context->pskIdentityHint);
-      context->pskIdentityHint = NULL;
-   }
 
-   //Valid PSK identity hint?
-   if(length > 0)
-   {
-      //Allocate a memory block to hold the PSK identity hint
-      context->pskIdentityHint = tlsAllocMem(length + 1);
-      //Failed to allocate memory?
-      if(context->pskIdentityHint == NULL)
-         return ERROR_OUT_OF_MEMORY;
+/**
+ * @brief Register ECDH key agreement callback function
+ * @param[in] context Pointer to the TLS context
+ * @param[in] ecdhCallback ECDH callback function
+ * @return Error code
+ **/
 
-      //Save the PSK identity hint
-      strcpy(context->pskIdentityHint, pskIdentityHint);
-   }
+error_t tlsSetEcdhCallback(TlsContext *context, TlsEcdhCallback ecdhCallback)
+{
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || ecdhCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the ECDH key agreement callback function
+   context->ecdhCallback = ecdhCallback;
 
    //Successful processing
    return NO_ERROR;
@@ -1033,21 +1609,22 @@ error_t tlsSetPskIdentityHint(TlsContext *context, const char_t *pskIdentityHint
 
 
 /**
- * @brief Register the PSK callback function
+ * @brief ECDSA signature generation callback function
  * @param[in] context Pointer to the TLS context
- * @param[in] pskCallback PSK callback function
+ * @param[in] ecdsaSignCallback ECDSA signature generation callback function
  * @return Error code
  **/
 
-error_t tlsSetPskCallback(TlsContext *context, TlsPskCallback pskCallback)
+error_t tlsSetEcdsaSignCallback(TlsContext *context,
+   TlsEcdsaSignCallback ecdsaSignCallback)
 {
-#if (TLS_PSK_SUPPORT == ENABLED)
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
    //Check parameters
-   if(context == NULL || pskCallback == NULL)
+   if(context == NULL || ecdsaSignCallback == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save the PSK callback function
-   context->pskCallback = pskCallback;
+   //Save the ECDSA signature generation callback function
+   context->ecdsaSignCallback = ecdsaSignCallback;
 
    //Successful processing
    return NO_ERROR;
@@ -1059,459 +1636,2733 @@ error_t tlsSetPskCallback(TlsContext *context, TlsPskCallback pskCallback)
 
 
 /**
- * @brief Register the raw public key verification callback function
+ * @brief Register ECDSA signature verification callback function
  * @param[in] context Pointer to the TLS context
- * @param[in] rpkVerifyCallback RPK verification callback function
+ * @param[in] ecdsaVerifyCallback ECDSA signature verification callback function
  * @return Error code
  **/
 
-error_t tlsSetRpkVerifyCallback(TlsContext *context,
-   TlsRpkVerifyCallback rpkVerifyCallback)
+error_t tlsSetEcdsaVerifyCallback(TlsContext *context,
+   TlsEcdsaVerifyCallback ecdsaVerifyCallback)
 {
-#if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
    //Check parameters
-   if(context == NULL || rpkVerifyCallback == NULL)
+   if(context == NULL || ecdsaVerifyCallback == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save the raw public key verification callback function
-   context->rpkVerifyCallback = rpkVerifyCallback;
+   //Save the ECDSA signature verification callback function
+   context->ecdsaVerifyCallback = ecdsaVerifyCallback;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //Raw public keys are not implemented
+   //PSK key exchange is not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Import a trusted CA list
+ * @brief Register asynchronous signature generation callback function
+ *
+ * When a callback is registered, the private key operations required to
+ * sign the ServerKeyExchange message (TLS 1.2 and earlier) and the
+ * CertificateVerify message (TLS 1.3) are delegated to the application.
+ * The callback receives the unhashed content covered by the signature. It
+ * may either post the result immediately using tlsPostAsyncSignResult or
+ * return ERROR_WOULD_BLOCK, in which case the handshake is suspended and
+ * tlsConnect returns ERROR_WOULD_BLOCK until the result is posted
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] trustedCaList List of trusted CA (PEM format)
- * @param[in] length Total length of the list
+ * @param[in] asyncSignCallback Asynchronous signature generation callback function
+ * @param[in] param An opaque pointer passed to the callback function
  * @return Error code
  **/
 
-error_t tlsSetTrustedCaList(TlsContext *context,
-   const char_t *trustedCaList, size_t length)
+error_t tlsSetAsyncSignCallback(TlsContext *context,
+   TlsAsyncSignCallback asyncSignCallback, void *param)
 {
-   //Invalid TLS context?
-   if(context == NULL)
-      return ERROR_INVALID_PARAMETER;
-
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
    //Check parameters
-   if(trustedCaList == NULL && length != 0)
+   if(context == NULL || asyncSignCallback == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save the list of trusted CA
-   context->trustedCaList = trustedCaList;
-   context->trustedCaListLen = length;
+   //Save the asynchronous signature generation callback function
+   context->asyncSignCallback = asyncSignCallback;
+   context->asyncSignParam = param;
 
    //Successful processing
    return NO_ERROR;
+#else
+   //Asynchronous private key operations are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Import a certificate and the corresponding private key
+ * @brief Post the result of an asynchronous signature operation
+ *
+ * The signature must be formatted as it appears on the wire (DER-encoded
+ * for DSA and ECDSA). The application shall then call tlsConnect again to
+ * resume the handshake. This function must not be called concurrently with
+ * any other function operating on the same TLS context
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] certChain Certificate chain (PEM format)
- * @param[in] certChainLen Total length of the certificate chain
- * @param[in] privateKey Private key (PEM format)
- * @param[in] privateKeyLen Total length of the private key
+ * @param[in] status Status of the signature operation
+ * @param[in] signature Pointer to the resulting signature
+ * @param[in] length Length of the signature, in bytes
  * @return Error code
  **/
 
-error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
-   size_t certChainLen, const char_t *privateKey, size_t privateKeyLen)
+error_t tlsPostAsyncSignResult(TlsContext *context, error_t status,
+   const uint8_t *signature, size_t length)
 {
-   error_t error;
-   uint8_t *derCert;
-   size_t derCertLen;
-   X509CertificateInfo *certInfo;
-   TlsCertificateType certType;
-   TlsSignatureAlgo certSignAlgo;
-   TlsHashAlgo certHashAlgo;
-   TlsNamedGroup namedCurve;
-
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Check whether the certificate chain is valid
-   if(certChain == NULL || certChainLen == 0)
-      return ERROR_INVALID_PARAMETER;
-
-   //The private key is optional
-   if(privateKey == NULL && privateKeyLen != 0)
-      return ERROR_INVALID_PARAMETER;
-
-   //Make sure there is enough room to add the certificate
-   if(context->numCerts >= TLS_MAX_CERTIFICATES)
-      return ERROR_OUT_OF_RESOURCES;
-
-   //Initialize variables
-   derCert = NULL;
-   certInfo = NULL;
+   //Make sure a signature operation is pending
+   if(context->asyncSignState != TLS_ASYNC_SIGN_STATE_PENDING)
+      return ERROR_WRONG_STATE;
 
-   //Start of exception handling block
-   do
+   //Successful signature operation?
+   if(status == NO_ERROR)
    {
-      //The first pass calculates the length of the DER-encoded certificate
-      error = pemImportCertificate(certChain, certChainLen, NULL, &derCertLen,
-         NULL);
-      //Any error to report?
-      if(error)
-         break;
-
-      //Allocate a memory buffer to hold the DER-encoded certificate
-      derCert = tlsAllocMem(derCertLen);
-      //Failed to allocate memory?
-      if(derCert == NULL)
-      {
-         error = ERROR_OUT_OF_MEMORY;
-         break;
-      }
+      //Check parameters
+      if(signature == NULL || length == 0)
+         return ERROR_INVALID_PARAMETER;
 
-      //The second pass decodes the PEM certificate
-      error = pemImportCertificate(certChain, certChainLen, derCert,
-         &derCertLen, NULL);
-      //Any error to report?
-      if(error)
-         break;
+      //The signature cannot exceed the size of the largest supported key
+      if(length > (TLS_MAX_RSA_MODULUS_SIZE / 8))
+         return ERROR_INVALID_LENGTH;
 
-      //Allocate a memory buffer to store X.509 certificate info
-      certInfo = tlsAllocMem(sizeof(X509CertificateInfo));
+      //Allocate a memory buffer to hold the signature
+      context->asyncSignResult = tlsAllocMem(length);
       //Failed to allocate memory?
-      if(certInfo == NULL)
-      {
-         error = ERROR_OUT_OF_MEMORY;
-         break;
-      }
-
-      //Parse X.509 certificate
-      error = x509ParseCertificate(derCert, derCertLen, certInfo);
-      //Failed to parse the X.509 certificate?
-      if(error)
-         break;
-
-      //Retrieve the signature algorithm that has been used to sign the
-      //certificate
-      error = tlsGetCertificateType(certInfo, &certType, &certSignAlgo,
-         &certHashAlgo, &namedCurve);
-      //The specified signature algorithm is not supported?
-      if(error)
-         break;
-
-      //End of exception handling block
-   } while(0);
-
-   //Valid certificate?
-   if(!error)
-   {
-      //Point to the structure that describes the certificate
-      TlsCertDesc *cert = &context->certs[context->numCerts];
-
-      //Save the certificate chain and the corresponding private key
-      cert->certChain = certChain;
-      cert->certChainLen = certChainLen;
-      cert->privateKey = privateKey;
-      cert->privateKeyLen = privateKeyLen;
-      cert->type = certType;
-      cert->signAlgo = certSignAlgo;
-      cert->hashAlgo = certHashAlgo;
-      cert->namedCurve = namedCurve;
+      if(context->asyncSignResult == NULL)
+         return ERROR_OUT_OF_MEMORY;
 
-      //Update the number of certificates
-      context->numCerts++;
+      //Save the signature
+      memcpy(context->asyncSignResult, signature, length);
+      context->asyncSignResultLen = length;
    }
 
-   //Release previously allocated memory
-   tlsFreeMem(derCert);
-   tlsFreeMem(certInfo);
+   //Save the status code. The handshake will resume on the next call to
+   //tlsConnect
+   context->asyncSignStatus = status;
+   context->asyncSignState = TLS_ASYNC_SIGN_STATE_DONE;
 
-   //Return status code
-   return error;
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Asynchronous private key operations are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Set certificate verification callback
+ * @brief Specify the crypto providers to be used by a TLS context
+ *
+ * The providers are considered along with the ones registered globally
+ * using tlsRegisterCryptoProvider, highest priority first
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] certVerifyCallback Certificate verification callback
- * @param[in] param An opaque pointer passed to the callback function
+ * @param[in] providers List of crypto providers
+ * @param[in] numProviders Number of crypto providers in the list
  * @return Error code
  **/
 
-error_t tlsSetCertificateVerifyCallback(TlsContext *context,
-   TlsCertVerifyCallback certVerifyCallback, void *param)
+error_t tlsSetCryptoProviders(TlsContext *context,
+   const TlsCryptoProvider *const *providers, uint_t numProviders)
 {
-   //Invalid TLS context?
-   if(context == NULL)
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Check parameters
+   if(context == NULL || (providers == NULL && numProviders != 0))
       return ERROR_INVALID_PARAMETER;
 
-   //Save certificate verification callback
-   context->certVerifyCallback = certVerifyCallback;
+   //Make sure the list is not too long
+   if(numProviders > TLS_MAX_CRYPTO_PROVIDERS)
+      return ERROR_INVALID_PARAMETER;
 
-   //This opaque pointer will be directly passed to the callback function
-   context->certVerifyParam = param;
+   //Save the list of crypto providers
+   for(i = 0; i < numProviders; i++)
+   {
+      context->cryptoProviders[i] = providers[i];
+   }
+
+   //Save the number of crypto providers
+   context->numCryptoProviders = numProviders;
 
    //Successful processing
    return NO_ERROR;
+#else
+   //Crypto providers are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Enable secure renegotiation
+ * @brief Register key logging callback function (for debugging purpose only)
  * @param[in] context Pointer to the TLS context
- * @param[in] enabled Specifies whether secure renegotiation is allowed
+ * @param[in] keyLogCallback Key logging callback function
  * @return Error code
  **/
 
-error_t tlsEnableSecureRenegotiation(TlsContext *context, bool_t enabled)
+error_t tlsSetKeyLogCallback(TlsContext *context,
+   TlsKeyLogCallback keyLogCallback)
 {
-#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
-   //Invalid TLS context?
-   if(context == NULL)
+#if (TLS_KEY_LOG_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || keyLogCallback == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Enable or disable secure renegotiation
-   context->secureRenegoEnabled = enabled;
+   //Save the key logging callback function
+   context->keyLogCallback = keyLogCallback;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //Secure renegotiation is not implemented
+   //Key logging is not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Perform fallback retry (for clients only)
+ * @brief Register handshake trace callback function
  * @param[in] context Pointer to the TLS context
- * @param[in] enabled Specifies whether FALLBACK_SCSV is enabled
+ * @param[in] traceCallback Callback invoked on each state transition and
+ *   around expensive handshake operations
+ * @param[in] param An opaque pointer passed to the callback function
  * @return Error code
  **/
 
-error_t tlsEnableFallbackScsv(TlsContext *context, bool_t enabled)
+error_t tlsSetHandshakeTraceCallback(TlsContext *context,
+   TlsHandshakeTraceCallback traceCallback, void *param)
 {
-#if (TLS_FALLBACK_SCSV_SUPPORT == ENABLED)
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Enable or disable support for FALLBACK_SCSV
-   context->fallbackScsvEnabled = enabled;
+   //Save the trace callback function
+   context->traceCallback = traceCallback;
+   //This opaque pointer will be directly passed to the callback function
+   context->traceParam = param;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //Not implemented
+   //Handshake tracing is not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Set ticket encryption/decryption callbacks
+ * @brief Allow unknown ALPN protocols
  * @param[in] context Pointer to the TLS context
- * @param[in] ticketEncryptCallback Ticket encryption callback function
- * @param[in] ticketDecryptCallback Ticket decryption callback function
- * @param[in] param An opaque pointer passed to the callback functions
+ * @param[in] allowed Specifies whether unknown ALPN protocols are allowed
  * @return Error code
  **/
 
-error_t tlsSetTicketCallbacks(TlsContext *context,
-   TlsTicketEncryptCallback ticketEncryptCallback,
-   TlsTicketDecryptCallback ticketDecryptCallback, void *param)
+error_t tlsAllowUnknownAlpnProtocols(TlsContext *context, bool_t allowed)
 {
-#if (TLS_TICKET_SUPPORT == ENABLED)
+#if (TLS_ALPN_SUPPORT == ENABLED)
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save ticket encryption/decryption callback functions
-   context->ticketEncryptCallback = ticketEncryptCallback;
-   context->ticketDecryptCallback = ticketDecryptCallback;
-
-   //This opaque pointer will be directly passed to the callback functions
-   context->ticketParam = param;
+   //Allow or disallow unknown ALPN protocols
+   context->unknownProtocolsAllowed = allowed;
 
    //Successful processing
    return NO_ERROR;
 #else
-   //Session ticket mechanism is not implemented
+   //ALPN is not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Set PMTU value (for DTLS only)
+ * @brief Set the list of supported ALPN protocols
  * @param[in] context Pointer to the TLS context
- * @param[in] pmtu PMTU value
+ * @param[in] protocolList Comma-delimited list of supported protocols
  * @return Error code
  **/
 
-error_t tlsSetPmtu(TlsContext *context, size_t pmtu)
+error_t tlsSetAlpnProtocolList(TlsContext *context, const char_t *protocolList)
 {
-#if (DTLS_SUPPORT == ENABLED)
-   //Invalid TLS context?
-   if(context == NULL)
-      return ERROR_INVALID_PARAMETER;
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   error_t error;
 
-   //Make sure the PMTU value is acceptable
-   if(pmtu < DTLS_MIN_PMTU)
+   //Check parameters
+   if(context == NULL || protocolList == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Save PMTU value
-   context->pmtu = pmtu;
+   //Check whether the list of supported protocols has already been configured
+   if(context->alpnList != NULL)
+   {
+      //The list may be owned by the shared configuration
+      if(context->config == NULL ||
+         context->alpnList != context->config->alpnList)
+      {
+         //Release memory
+         tlsFreeAlpnList(context->alpnList);
+      }
+
+      context->alpnList = NULL;
+      context->protocolList = NULL;
+   }
+
+   //Check whether the list of protocols is valid
+   if(protocolList[0] != '\0')
+   {
+      //Compile the list of supported protocols
+      error = tlsCompileAlpnList(protocolList, &context->alpnList);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //The compiled list holds a copy of the comma-delimited list
+      context->protocolList = context->alpnList->protocolList;
+   }
 
    //Successful processing
    return NO_ERROR;
 #else
-   //DTLS is not implemented
+   //ALPN is not implemented
    return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Set timeout for blocking calls (for DTLS only)
+ * @brief Get the name of the selected ALPN protocol
  * @param[in] context Pointer to the TLS context
- * @param[in] timeout Maximum time to wait
- * @return Error code
+ * @return Pointer to the protocol name
  **/
 
-error_t tlsSetTimeout(TlsContext *context, systime_t timeout)
+const char_t *tlsGetAlpnProtocol(TlsContext *context)
 {
-#if (DTLS_SUPPORT == ENABLED)
-   //Invalid TLS context?
-   if(context == NULL)
-      return ERROR_INVALID_PARAMETER;
-
-   //Save timeout value
-   context->timeout = timeout;
+   static const char_t defaultProtocolName[] = "";
 
-   //Successful processing
-   return NO_ERROR;
-#else
-   //DTLS is not implemented
-   return ERROR_NOT_IMPLEMENTED;
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //Valid protocol name?
+   if(context != NULL && context->selectedProtocol != NULL)
+   {
+      //Return the name of the selected protocol
+      return context->selectedProtocol;
+   }
+   else
 #endif
+   {
+      //Return an empty string
+      return defaultProtocolName;
+   }
 }
 
 
 /**
- * @brief Set cookie generation/verification callbacks (for DTLS only)
+ * @brief Set the pre-shared key to be used
  * @param[in] context Pointer to the TLS context
- * @param[in] cookieGenerateCallback Cookie generation callback function
+ * @param[in] psk Pointer to the pre-shared key
+ * @param[in] length Length of the pre-shared key, in bytes
+ * @return Error code
+ **/
+
+error_t tlsSetPsk(TlsContext *context, const uint8_t *psk, size_t length)
+{
+#if (TLS_PSK_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(psk == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check whether the pre-shared key has already been configured
+   if(context->psk != NULL)
+   {
+      //Release memory
+      memset(context->psk, 0, context->pskLen);
+      tlsFreeMem(context->psk);
+      context->psk = NULL;
+      context->pskLen = 0;
+   }
+
+   //Valid PSK?
+   if(length > 0)
+   {
+      //Allocate a memory block to hold the pre-shared key
+      context->psk = tlsAllocMem(length);
+      //Failed to allocate memory?
+      if(context->psk == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Save the pre-shared key
+      memcpy(context->psk, psk, length);
+      //Save the length of the key
+      context->pskLen = length;
+   }
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //For externally established PSKs, the hash algorithm must be set when the
+   //PSK is established, or default to SHA-256 if no such algorithm is defined
+   context->pskHashAlgo = TLS_HASH_ALGO_SHA256;
+
+   //The cipher suite must be provisioned along with the key
+   context->pskCipherSuite = 0;
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //PSK key exchange is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the PSK identity to be used by the client
+ * @param[in] context Pointer to the TLS context
+ * @param[in] pskIdentity NULL-terminated string that contains the PSK identity
+ * @return Error code
+ **/
+
+error_t tlsSetPskIdentity(TlsContext *context, const char_t *pskIdentity)
+{
+#if (TLS_PSK_SUPPORT == ENABLED)
+   size_t length;
+
+   //Check parameters
+   if(context == NULL || pskIdentity == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Retrieve the length of the PSK identity
+   length = strlen(pskIdentity);
+
+   //Check whether the PSK identity has already been configured
+   if(context->pskIdentity != NULL)
+   {
+      //Release memory
+      tlsFreeMem(context->pskIdentity);
+      context->pskIdentity = NULL;
+   }
+
+   //Valid PSK identity?
+   if(length > 0)
+   {
+      //Allocate a memory block to hold the PSK identity
+      context->pskIdentity = tlsAllocMem(length + 1);
+      //Failed to allocate memory?
+      if(context->pskIdentity == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Save the PSK identity
+      strcpy(context->pskIdentity, pskIdentity);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //PSK key exchange is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the PSK identity hint to be used by the server
+ * @param[in] context Pointer to the TLS context
+ * @param[in] pskIdentityHint NULL-terminated string that contains the PSK identity hint
+ * @return Error code
+ **/
+
+error_t tlsSetPskIdentityHint(TlsContext *context, const char_t *pskIdentityHint)
+{
+#if (TLS_PSK_SUPPORT == ENABLED)
+   size_t length;
+
+   //Check parameters
+   if(context == NULL || pskIdentityHint == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Retrieve the length of the PSK identity hint
+   length = strlen(pskIdentityHint);
+
+   //Check whether the PSK identity hint has already been configured
+   if(context->pskIdentityHint != NULL)
+   {
+      //The PSK identity hint may be owned by the shared configuration
+      if(context->config == NULL ||
+         context->pskIdentityHint != context->config->pskIdentityHint)
+      {
+         //Release memory
+         tlsFreeMem(context->pskIdentityHint);
+      }
+
+      context->pskIdentityHint = NULL;
+   }
+
+   //Valid PSK identity hint?
+   if(length > 0)
+   {
+      //Allocate a memory block to hold the PSK identity hint
+      context->pskIdentityHint = tlsAllocMem(length + 1);
+      //Failed to allocate memory?
+      if(context->pskIdentityHint == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Save the PSK identity hint
+      strcpy(context->pskIdentityHint, pskIdentityHint);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //PSK key exchange is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register the PSK callback function
+ * @param[in] context Pointer to the TLS context
+ * @param[in] pskCallback PSK callback function
+ * @return Error code
+ **/
+
+error_t tlsSetPskCallback(TlsContext *context, TlsPskCallback pskCallback)
+{
+#if (TLS_PSK_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || pskCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the PSK callback function
+   context->pskCallback = pskCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //PSK key exchange is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register the raw public key verification callback function
+ * @param[in] context Pointer to the TLS context
+ * @param[in] rpkVerifyCallback RPK verification callback function
+ * @return Error code
+ **/
+
+error_t tlsSetRpkVerifyCallback(TlsContext *context,
+   TlsRpkVerifyCallback rpkVerifyCallback)
+{
+#if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || rpkVerifyCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the raw public key verification callback function
+   context->rpkVerifyCallback = rpkVerifyCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Raw public keys are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Import a trusted CA list
+ * @param[in] context Pointer to the TLS context
+ * @param[in] trustedCaList List of trusted CA (PEM format)
+ * @param[in] length Total length of the list
+ * @return Error code
+ **/
+
+error_t tlsSetTrustedCaList(TlsContext *context,
+   const char_t *trustedCaList, size_t length)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(trustedCaList == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the list of trusted CA
+   context->trustedCaList = trustedCaList;
+   context->trustedCaListLen = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Attach a pre-decoded trusted CA store to a TLS context
+ *
+ * The store can be shared by any number of TLS contexts. When a store is
+ * attached, it takes precedence over the PEM list set by tlsSetTrustedCaList()
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] trustStore Trusted CA store created by tlsInitTrustStore()
+ *   (NULL to detach the current store)
+ * @return Error code
+ **/
+
+error_t tlsSetTrustStore(TlsContext *context, TlsTrustStore *trustStore)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Release the previous store, if any
+   tlsFreeTrustStore(context->trustStore);
+
+   //Save the trusted CA store
+   context->trustStore = tlsReferenceTrustStore(trustStore);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Attach a certificate verification cache to a TLS context
+ *
+ * The cache can be shared by any number of TLS contexts. It must remain
+ * valid as long as it is attached to a context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] certVerifyCache Cache created by tlsInitCertVerifyCache()
+ *   (NULL to detach the current cache)
+ * @return Error code
+ **/
+
+error_t tlsSetCertVerifyCache(TlsContext *context,
+   TlsCertVerifyCache *certVerifyCache)
+{
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the certificate verification cache
+   context->certVerifyCache = certVerifyCache;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Certificate verification cache is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Attach a verification worker pool to a TLS context
+ *
+ * The signature checks of the peer certificate chain are then run in
+ * parallel by the worker threads of the pool. The pool can be shared by any
+ * number of TLS contexts and must remain valid as long as it is attached to
+ * a context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] verifyPool Pool created by tlsInitVerifyPool()
+ *   (NULL to verify the chain on the handshake thread only)
+ * @return Error code
+ **/
+
+error_t tlsSetVerifyPool(TlsContext *context, TlsVerifyPool *verifyPool)
+{
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the verification worker pool
+   context->verifyPool = verifyPool;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Parallel chain verification is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Attach an OCSP response cache to a TLS context
+ *
+ * When the client requests the status of the server certificate, the server
+ * staples the OCSP response found in the cache, if any. The cache can be
+ * shared by any number of TLS contexts. It must remain valid as long as it
+ * is attached to a context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] ocspCache Cache created by tlsInitOcspCache() (NULL to detach
+ *   the current cache)
+ * @return Error code
+ **/
+
+error_t tlsSetOcspCache(TlsContext *context, TlsOcspCache *ocspCache)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The cache cannot be replaced while a response is referenced
+   if(context->ocspResponse != NULL)
+      return ERROR_WRONG_STATE;
+
+   //Save the OCSP response cache
+   context->ocspCache = ocspCache;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //OCSP stapling is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Request the status of the server certificate (OCSP stapling)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether the client sends a StatusRequest
+ *   extension in its ClientHello
+ * @return Error code
+ **/
+
+error_t tlsEnableOcspStapling(TlsContext *context, bool_t enabled)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable OCSP stapling
+   context->ocspStaplingEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //OCSP stapling is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register the stapled OCSP response callback function
+ *
+ * The callback is invoked by the client with the DER-encoded OCSP response
+ * stapled by the server. It returns an error code if the response is not
+ * acceptable, in which case the handshake is aborted
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] ocspResponseCallback Stapled OCSP response callback function
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsSetOcspResponseCallback(TlsContext *context,
+   TlsOcspResponseCallback ocspResponseCallback, void *param)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the callback function
+   context->ocspResponseCallback = ocspResponseCallback;
+   //This opaque pointer will be directly passed to the callback function
+   context->ocspResponseParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //OCSP stapling is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable TLS False Start
+ *
+ * With False Start (RFC 7918), a client performing a full TLS 1.2 handshake
+ * sends application data right behind its Finished message, instead of
+ * waiting for the server's Finished message. tlsConnect returns as soon as
+ * the client flight is out, and the server's final flight is processed by
+ * the next call to tlsRead. False Start is only used with forward-secret,
+ * authenticated key exchanges, AEAD ciphers and groups of sufficient size
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether the client may send application data
+ *   before the server's Finished message has been received
+ * @return Error code
+ **/
+
+error_t tlsEnableFalseStart(TlsContext *context, bool_t enabled)
+{
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable False Start
+   context->falseStartEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //False Start is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable TCP Fast Open integration
+ *
+ * The first data handed to the transport by the client, namely the
+ * ClientHello, carry the TLS_FLAG_FAST_OPEN flag. The socket send callback
+ * can then open the connection with the data (sendto with MSG_FASTOPEN, or
+ * connect followed by the data where the stack defers the SYN). When 0-RTT
+ * data are written with tlsWriteEarlyData and a bulk send buffer has been
+ * set with tlsSetBulkSendSize, the ClientHello and the 0-RTT records are
+ * gathered and handed to the transport with a single call, so that the
+ * request travels with the SYN segment
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether TCP Fast Open integration is enabled
+ * @return Error code
+ **/
+
+error_t tlsEnableFastOpen(TlsContext *context, bool_t enabled)
+{
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //TCP Fast Open is not applicable to DTLS
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable TCP Fast Open integration
+   context->fastOpenEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //TCP Fast Open integration is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Attach an SNI-indexed certificate store to a TLS context
+ *
+ * When the client provides a server name, the credentials associated with
+ * that name in the store take precedence over the certificates attached to
+ * the context. The store can be shared by any number of TLS contexts. It
+ * must remain valid as long as it is attached to a context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] certStore Store created by tlsInitCertStore() (NULL to detach
+ *   the current store)
+ * @return Error code
+ **/
+
+error_t tlsSetCertStore(TlsContext *context, TlsCertStore *certStore)
+{
+#if (TLS_CERT_STORE_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the certificate store
+   context->certStore = certStore;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //SNI-indexed certificate store is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Import a certificate and the corresponding private key
+ * @param[in] context Pointer to the TLS context
+ * @param[in] certChain Certificate chain (PEM format)
+ * @param[in] certChainLen Total length of the certificate chain
+ * @param[in] privateKey Private key (PEM format)
+ * @param[in] privateKeyLen Total length of the private key
+ * @return Error code
+ **/
+
+error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
+   size_t certChainLen, const char_t *privateKey, size_t privateKeyLen)
+{
+   error_t error;
+   uint8_t *derCert;
+   size_t derCertLen;
+   X509CertificateInfo *certInfo;
+   TlsCertificateType certType;
+   TlsSignatureAlgo certSignAlgo;
+   TlsHashAlgo certHashAlgo;
+   TlsNamedGroup namedCurve;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check whether the certificate chain is valid
+   if(certChain == NULL || certChainLen == 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //The private key is optional
+   if(privateKey == NULL && privateKeyLen != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure there is enough room to add the certificate
+   if(context->numCerts >= TLS_MAX_CERTIFICATES)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Initialize variables
+   derCert = NULL;
+   certInfo = NULL;
+
+   //Start of exception handling block
+   do
+   {
+      //The first pass calculates the length of the DER-encoded certificate
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+      error = pemImportCertificate(certChain, certChainLen, NULL, &derCertLen,
+         NULL);
+      //Any error to report?
+      if(error)
+         break;
+
+      //Allocate a memory buffer to hold the DER-encoded certificate
+      derCert = tlsAllocObject(TLS_MEM_CLASS_DER_CERT, derCertLen);
+      //Failed to allocate memory?
+      if(derCert == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //The second pass decodes the PEM certificate
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+      error = pemImportCertificate(certChain, certChainLen, derCert,
+         &derCertLen, NULL);
+      //Any error to report?
+      if(error)
+         break;
+
+      //Allocate a memory buffer to store X.509 certificate info
+      certInfo = tlsAllocObject(TLS_MEM_CLASS_CERT_INFO,
+         sizeof(X509CertificateInfo));
+      //Failed to allocate memory?
+      if(certInfo == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //Parse X.509 certificate
+      TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
+      error = x509ParseCertificate(derCert, derCertLen, certInfo);
+      //Failed to parse the X.509 certificate?
+      if(error)
+         break;
+
+      //Retrieve the signature algorithm that has been used to sign the
+      //certificate
+      error = tlsGetCertificateType(certInfo, &certType, &certSignAlgo,
+         &certHashAlgo, &namedCurve);
+      //The specified signature algorithm is not supported?
+      if(error)
+         break;
+
+      //End of exception handling block
+   } while(0);
+
+   //Valid certificate?
+   if(!error)
+   {
+      //Point to the structure that describes the certificate
+      TlsCertDesc *cert = &context->certs[context->numCerts];
+
+      //Save the certificate chain and the corresponding private key
+      cert->certChain = certChain;
+      cert->certChainLen = certChainLen;
+      cert->privateKey = privateKey;
+      cert->privateKeyLen = privateKeyLen;
+      cert->credential = NULL;
+      cert->type = certType;
+      cert->signAlgo = certSignAlgo;
+      cert->hashAlgo = certHashAlgo;
+      cert->namedCurve = namedCurve;
+
+      //Update the number of certificates
+      context->numCerts++;
+   }
+
+   //Release previously allocated memory
+   tlsFreeObject(TLS_MEM_CLASS_DER_CERT, derCert);
+   tlsFreeObject(TLS_MEM_CLASS_CERT_INFO, certInfo);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Attach a pre-parsed credential to a TLS context
+ *
+ * The credential can be shared by any number of TLS contexts. A new
+ * reference is acquired and released when the context is disposed
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] credential Credential created by tlsInitCredential()
+ * @return Error code
+ **/
+
+error_t tlsAddCredential(TlsContext *context, TlsCredential *credential)
+{
+   TlsCertDesc *cert;
+
+   //Check parameters
+   if(context == NULL || credential == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure there is enough room to add the certificate
+   if(context->numCerts >= TLS_MAX_CERTIFICATES)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Point to the structure that describes the certificate
+   cert = &context->certs[context->numCerts];
+
+   //The certificate chain and the private key have already been parsed
+   cert->certChain = NULL;
+   cert->certChainLen = 0;
+   cert->privateKey = NULL;
+   cert->privateKeyLen = 0;
+   cert->credential = tlsReferenceCredential(credential);
+   cert->type = credential->type;
+   cert->signAlgo = credential->signAlgo;
+   cert->hashAlgo = credential->hashAlgo;
+   cert->namedCurve = credential->namedCurve;
+
+   //Update the number of certificates
+   context->numCerts++;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set certificate verification callback
+ * @param[in] context Pointer to the TLS context
+ * @param[in] certVerifyCallback Certificate verification callback
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsSetCertificateVerifyCallback(TlsContext *context,
+   TlsCertVerifyCallback certVerifyCallback, void *param)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save certificate verification callback
+   context->certVerifyCallback = certVerifyCallback;
+
+   //This opaque pointer will be directly passed to the callback function
+   context->certVerifyParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Enable secure renegotiation
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether secure renegotiation is allowed
+ * @return Error code
+ **/
+
+error_t tlsEnableSecureRenegotiation(TlsContext *context, bool_t enabled)
+{
+#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable secure renegotiation
+   context->secureRenegoEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Secure renegotiation is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Perform fallback retry (for clients only)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether FALLBACK_SCSV is enabled
+ * @return Error code
+ **/
+
+error_t tlsEnableFallbackScsv(TlsContext *context, bool_t enabled)
+{
+#if (TLS_FALLBACK_SCSV_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable support for FALLBACK_SCSV
+   context->fallbackScsvEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set ticket encryption/decryption callbacks
+ * @param[in] context Pointer to the TLS context
+ * @param[in] ticketEncryptCallback Ticket encryption callback function
+ * @param[in] ticketDecryptCallback Ticket decryption callback function
+ * @param[in] param An opaque pointer passed to the callback functions
+ * @return Error code
+ **/
+
+error_t tlsSetTicketCallbacks(TlsContext *context,
+   TlsTicketEncryptCallback ticketEncryptCallback,
+   TlsTicketDecryptCallback ticketDecryptCallback, void *param)
+{
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save ticket encryption/decryption callback functions
+   context->ticketEncryptCallback = ticketEncryptCallback;
+   context->ticketDecryptCallback = ticketDecryptCallback;
+
+   //This opaque pointer will be directly passed to the callback functions
+   context->ticketParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session ticket mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Offer the SessionTicket extension (TLS 1.2)
+ *
+ * The client asks the server for a ticket (refer to RFC 5077) and presents
+ * the ticket of the restored session, if any, in its ClientHello. On the
+ * server side, tickets are issued whenever ticket callbacks are registered
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether session tickets are requested
+ * @return Error code
+ **/
+
+error_t tlsEnableSessionTickets(TlsContext *context, bool_t enabled)
+{
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable session tickets
+   context->sessionTicketEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session ticket mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register a certificate compression algorithm (RFC 8879)
+ *
+ * The compression callback is used to compress the Certificate message sent
+ * to a peer that supports the algorithm, while the decompression callback
+ * allows the algorithm to be offered to the peer. Either callback may be
+ * omitted. The algorithms are offered in the order they are registered.
+ * Certificate compression only applies to TLS 1.3
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] algorithm Compression algorithm (zlib, brotli or zstd)
+ * @param[in] compressCallback Compression callback function
+ * @param[in] decompressCallback Decompression callback function
+ * @param[in] param An opaque pointer passed to the callback functions
+ * @return Error code
+ **/
+
+error_t tlsAddCertCompressionAlgo(TlsContext *context,
+   TlsCertCompressionAlgo algorithm, TlsCertCompressCallback compressCallback,
+   TlsCertDecompressCallback decompressCallback, void *param)
+{
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   uint_t i;
+   TlsCertCompressionCodec *codec;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(algorithm == TLS_CERT_COMPRESSION_NONE)
+      return ERROR_INVALID_PARAMETER;
+   if(compressCallback == NULL && decompressCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Loop through the registered codecs
+   for(i = 0; i < context->numCertCompressionCodecs; i++)
+   {
+      //Algorithm already registered?
+      if(context->certCompressionCodecs[i].algorithm == algorithm)
+         break;
+   }
+
+   //Make sure there is enough room to add the codec
+   if(i >= TLS_MAX_CERT_COMPRESSION_ALGOS)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Point to the codec
+   codec = &context->certCompressionCodecs[i];
+
+   //Save compression/decompression callback functions
+   codec->algorithm = algorithm;
+   codec->compressCallback = compressCallback;
+   codec->decompressCallback = decompressCallback;
+
+   //This opaque pointer will be directly passed to the callback functions
+   codec->param = param;
+
+   //New entry?
+   if(i >= context->numCertCompressionCodecs)
+      context->numCertCompressionCodecs++;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Certificate compression is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register external session cache callbacks (for servers only)
+ *
+ * The external session cache (memcached, Redis...) is consulted whenever
+ * a session ID offered by a client cannot be found in the in-process
+ * session cache. The lookup callback may either post the result immediately
+ * using tlsPostExtCacheResult or return ERROR_WOULD_BLOCK, in which case
+ * the ClientHello is parked and tlsConnect returns ERROR_WOULD_BLOCK until
+ * the result is posted
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] getCallback Lookup callback function
+ * @param[in] putCallback Insertion callback function
+ * @param[in] deleteCallback Removal callback function
+ * @param[in] param An opaque pointer passed to the callback functions
+ * @return Error code
+ **/
+
+error_t tlsSetExtCacheCallbacks(TlsContext *context,
+   TlsExtCacheGetCallback getCallback, TlsExtCachePutCallback putCallback,
+   TlsExtCacheDeleteCallback deleteCallback, void *param)
+{
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save external session cache callback functions
+   context->extCacheGetCallback = getCallback;
+   context->extCachePutCallback = putCallback;
+   context->extCacheDeleteCallback = deleteCallback;
+
+   //This opaque pointer will be directly passed to the callback functions
+   context->extCacheParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session resumption is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Post the result of an external session cache lookup
+ *
+ * The data must be the serialized session state previously passed to the
+ * insertion callback. A status code other than NO_ERROR (typically
+ * ERROR_NOT_FOUND) makes the server proceed with a full handshake. This
+ * function must not be called concurrently with any other function
+ * operating on the same TLS context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] status Status of the lookup
+ * @param[in] data Serialized session state
+ * @param[in] length Length of the serialized session state, in bytes
+ * @return Error code
+ **/
+
+error_t tlsPostExtCacheResult(TlsContext *context, error_t status,
+   const uint8_t *data, size_t length)
+{
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure a lookup is pending
+   if(context->extCacheState != TLS_EXT_CACHE_STATE_PENDING)
+      return ERROR_WRONG_STATE;
+
+   //Matching session found?
+   if(status == NO_ERROR)
+   {
+      //Check parameters
+      if(data == NULL || length == 0)
+         return ERROR_INVALID_PARAMETER;
+
+      //Check the length of the serialized session state
+      if(length > TLS_MAX_SERIALIZED_SESSION_SIZE)
+         return ERROR_INVALID_LENGTH;
+
+      //Allocate a memory buffer to hold the serialized session state
+      context->extCacheResult = tlsAllocMem(length);
+      //Failed to allocate memory?
+      if(context->extCacheResult == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Save the serialized session state
+      memcpy(context->extCacheResult, data, length);
+      context->extCacheResultLen = length;
+   }
+
+   //Save the status code. The handshake will resume on the next call to
+   //tlsConnect
+   context->extCacheStatus = status;
+   context->extCacheState = TLS_EXT_CACHE_STATE_DONE;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session resumption is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set PMTU value (for DTLS only)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] pmtu PMTU value
+ * @return Error code
+ **/
+
+error_t tlsSetPmtu(TlsContext *context, size_t pmtu)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure the PMTU value is acceptable
+   if(pmtu < DTLS_MIN_PMTU)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save PMTU value
+   context->pmtu = pmtu;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Pack application data records into datagrams (for DTLS only)
+ *
+ * When enabled, the records written with the TLS_FLAG_CORK flag are held
+ * back and packed back-to-back into a single datagram, up to the PMTU. The
+ * datagram is sent by the next write without the TLS_FLAG_CORK flag, by
+ * the next read, or as soon as the next record would not fit in it
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether record packing is enabled
+ * @return Error code
+ **/
+
+error_t tlsEnableRecordPacking(TlsContext *context, bool_t enabled)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable record packing
+   context->recordPackingEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set timeout for blocking calls (for DTLS only)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] timeout Maximum time to wait
+ * @return Error code
+ **/
+
+error_t tlsSetTimeout(TlsContext *context, systime_t timeout)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save timeout value
+   context->timeout = timeout;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set cookie generation/verification callbacks (for DTLS only)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] cookieGenerateCallback Cookie generation callback function
  * @param[in] cookieVerifyCallback Cookie verification callback function
  * @param[in] param An opaque pointer passed to the callback functions
  * @return Error code
  **/
 
-error_t tlsSetCookieCallbacks(TlsContext *context,
-   DtlsCookieGenerateCallback cookieGenerateCallback,
-   DtlsCookieVerifyCallback cookieVerifyCallback, void *param)
+error_t tlsSetCookieCallbacks(TlsContext *context,
+   DtlsCookieGenerateCallback cookieGenerateCallback,
+   DtlsCookieVerifyCallback cookieVerifyCallback, void *param)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(cookieGenerateCallback == NULL || cookieVerifyCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save cookie generation/verification callback functions
+   context->cookieGenerateCallback = cookieGenerateCallback;
+   context->cookieVerifyCallback = cookieVerifyCallback;
+
+   //This opaque pointer will be directly passed to the callback functions
+   context->cookieParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable anti-replay mechanism (for DTLS only)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether anti-replay protection is enabled
+ * @return Error code
+ **/
+
+error_t tlsEnableReplayDetection(TlsContext *context, bool_t enabled)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable anti-replay mechanism
+   context->replayDetectionEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Anti-replay mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the size of the sliding window used for replay detection (for DTLS only)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] size Number of records covered by the window
+ * @return Error code
+ **/
+
+error_t tlsSetReplayWindowSize(TlsContext *context, uint_t size)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   uint_t n;
+   uint64_t *window;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the size of the window
+   if(size < 1 || size > DTLS_MAX_REPLAY_WINDOW_SIZE)
+      return ERROR_INVALID_PARAMETER;
+
+   //The window cannot be resized once the connection is established
+   if(context->state != TLS_STATE_INIT)
+      return ERROR_WRONG_STATE;
+
+   //Number of 64-bit words needed to hold the ring bitmap
+   n = dtlsComputeReplayWindowWords(size);
+
+   //Small windows are held in the context itself
+   if(n <= DTLS_REPLAY_WINDOW_BUFFER_SIZE)
+   {
+      window = context->replayWindowBuffer;
+   }
+   else
+   {
+      //Allocate a memory buffer to hold the ring bitmap
+      window = tlsAllocMem(n * sizeof(uint64_t));
+      //Failed to allocate memory?
+      if(window == NULL)
+         return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Release the previous ring bitmap, if any
+   if(context->replayWindow != context->replayWindowBuffer)
+   {
+      tlsFreeMem(context->replayWindow);
+   }
+
+   //Save the new window
+   context->replayWindowSize = size;
+   context->replayWindowWords = n;
+   context->replayWindow = window;
+
+   //Clear the bitmap window
+   dtlsInitReplayWindow(context);
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Anti-replay mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable the ConnectionId extension (for DTLS only)
+ *
+ * The CID is the identifier the peer will put in the records it sends.
+ * A zero-length CID indicates support for the extension without asking
+ * the peer to use one (refer to RFC 9146, section 3)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] cid Connection ID to be used by the peer
+ * @param[in] length Length of the connection ID
+ * @return Error code
+ **/
+
+error_t tlsSetConnectionId(TlsContext *context, const uint8_t *cid,
+   size_t length)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(cid == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the length of the connection ID
+   if(length > DTLS_MAX_CID_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //The CID cannot be changed once the handshake has started
+   if(context->state != TLS_STATE_INIT)
+      return ERROR_WRONG_STATE;
+
+   //Save the connection ID
+   if(length > 0)
+   {
+      memcpy(context->localCid, cid, length);
+   }
+
+   //Save the length of the connection ID
+   context->localCidLen = length;
+   //Offer or accept the ConnectionId extension
+   context->cidEnabled = TRUE;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Connection ID is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the SRTP protection profiles (for DTLS only)
+ *
+ * Setting at least one profile enables the UseSrtp extension. The profiles
+ * are listed in order of preference (refer to RFC 5764, section 4.1.1)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] profiles List of SRTP protection profiles
+ * @param[in] numProfiles Number of profiles in the list
+ * @return Error code
+ **/
+
+error_t tlsSetSrtpProfiles(TlsContext *context, const uint16_t *profiles,
+   uint_t numProfiles)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+   uint_t i;
+   size_t keyLen;
+   size_t saltLen;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(profiles == NULL && numProfiles != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the number of protection profiles
+   if(numProfiles > DTLS_MAX_SRTP_PROFILES)
+      return ERROR_INVALID_LENGTH;
+
+   //The profiles cannot be changed once the handshake has started
+   if(context->state != TLS_STATE_INIT)
+      return ERROR_WRONG_STATE;
+
+   //Make sure the keying material of each profile can be exported
+   for(i = 0; i < numProfiles; i++)
+   {
+      if(dtlsGetSrtpKeyLengths(profiles[i], &keyLen, &saltLen))
+         return ERROR_INVALID_PARAMETER;
+   }
+
+   //Save the list of protection profiles
+   for(i = 0; i < numProfiles; i++)
+   {
+      context->srtpProfiles[i] = profiles[i];
+   }
+
+   //Save the number of protection profiles
+   context->numSrtpProfiles = numProfiles;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS-SRTP is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the SRTP master key identifier (for DTLS only)
+ *
+ * The MKI is only meaningful on the client side. The server echoes the
+ * value offered by the client
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] mki Master key identifier
+ * @param[in] length Length of the MKI
+ * @return Error code
+ **/
+
+error_t tlsSetSrtpMki(TlsContext *context, const uint8_t *mki,
+   size_t length)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(mki == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the length of the MKI
+   if(length > DTLS_MAX_SRTP_MKI_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //The MKI cannot be changed once the handshake has started
+   if(context->state != TLS_STATE_INIT)
+      return ERROR_WRONG_STATE;
+
+   //Save the MKI
+   if(length > 0)
+   {
+      memcpy(context->srtpMki, mki, length);
+   }
+
+   //Save the length of the MKI
+   context->srtpMkiLen = length;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS-SRTP is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register the SRTP packet callback (for DTLS only)
+ *
+ * Datagrams whose first byte does not fall in the DTLS range are handed
+ * over to the callback instead of the record layer, so that SRTP, SRTCP
+ * and STUN packets can share the socket (refer to RFC 7983, section 7)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] callback SRTP packet callback function
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsSetSrtpCallback(TlsContext *context, DtlsSrtpCallback callback,
+   void *param)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the SRTP packet callback function
+   context->srtpCallback = callback;
+   //This opaque pointer will be directly passed to the callback function
+   context->srtpParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS-SRTP is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Get the negotiated SRTP protection profile (for DTLS only)
+ * @param[in] context Pointer to the TLS context
+ * @return SRTP protection profile (DTLS_SRTP_PROFILE_NONE if the UseSrtp
+ *   extension has not been negotiated)
+ **/
+
+uint16_t tlsGetSrtpProfile(TlsContext *context)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+   //Valid TLS context?
+   if(context != NULL)
+   {
+      //Return the negotiated protection profile
+      return context->srtpProfile;
+   }
+   else
+#endif
+   {
+      //The UseSrtp extension has not been negotiated
+      return DTLS_SRTP_PROFILE_NONE;
+   }
+}
+
+
+/**
+ * @brief Export the SRTP master keys and salts (for DTLS only)
+ *
+ * The keying material is derived with the "EXTRACTOR-dtls_srtp" exporter
+ * and split into client key, server key, client salt and server salt
+ * (refer to RFC 5764, section 4.2)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] keys SRTP keying material
+ * @return Error code
+ **/
+
+error_t tlsExportSrtpKeys(TlsContext *context, DtlsSrtpKeys *keys)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+   uint8_t *p;
+   uint8_t buffer[2 * (DTLS_MAX_SRTP_KEY_SIZE + DTLS_MAX_SRTP_SALT_SIZE)];
+
+   //Check parameters
+   if(context == NULL || keys == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The handshake must be complete
+   if(context->state != TLS_STATE_APPLICATION_DATA)
+      return ERROR_NOT_CONNECTED;
+
+   //Clear keying material
+   memset(keys, 0, sizeof(DtlsSrtpKeys));
+
+   //Retrieve the lengths of the master key and salt
+   error = dtlsGetSrtpKeyLengths(context->srtpProfile, &keys->keyLen,
+      &keys->saltLen);
+   //The UseSrtp extension has not been negotiated?
+   if(error)
+      return ERROR_WRONG_STATE;
+
+   //Save the negotiated protection profile
+   keys->profile = context->srtpProfile;
+
+   //Total length of the keying material
+   n = 2 * (keys->keyLen + keys->saltLen);
+
+   //Derive the keying material
+   error = tlsExportKeyingMaterial(context, "EXTRACTOR-dtls_srtp", FALSE,
+      NULL, 0, buffer, n);
+
+   //Check status code
+   if(!error)
+   {
+      //Point to the keying material
+      p = buffer;
+
+      //client_write_SRTP_master_key
+      memcpy(keys->clientKey, p, keys->keyLen);
+      p += keys->keyLen;
+      //server_write_SRTP_master_key
+      memcpy(keys->serverKey, p, keys->keyLen);
+      p += keys->keyLen;
+      //client_write_SRTP_master_salt
+      memcpy(keys->clientSalt, p, keys->saltLen);
+      p += keys->saltLen;
+      //server_write_SRTP_master_salt
+      memcpy(keys->serverSalt, p, keys->saltLen);
+   }
+
+   //Erase the temporary buffer
+   memset(buffer, 0, sizeof(buffer));
+
+   //Return status code
+   return error;
+#else
+   //DTLS-SRTP is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Drive the retransmission timer from a shared timer wheel (for DTLS only)
+ *
+ * The application no longer needs to poll the context: dtlsPollTimerWheel()
+ * returns it once its retransmission timer has expired
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] timerWheel Pointer to the timer wheel
+ * @return Error code
+ **/
+
+error_t tlsSetTimerWheel(TlsContext *context, DtlsTimerWheel *timerWheel)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || timerWheel == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The timer wheel cannot be changed once the handshake has started
+   if(context->state != TLS_STATE_INIT)
+      return ERROR_WRONG_STATE;
+
+   //Save the timer wheel
+   context->timerWheel = timerWheel;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Send the maximum amount of 0-RTT data the server can accept
+ * @param[in] context Pointer to the TLS context
+ * @param[in] maxEarlyDataSize Maximum amount of 0-RTT data that the client
+ *   is allowed to send
+ * @return Error code
+ **/
+
+
+error_t tlsSetMaxEarlyDataSize(TlsContext *context, size_t maxEarlyDataSize)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the maximum amount of 0-RTT data that the client is allowed to send
+   context->maxEarlyDataSize = maxEarlyDataSize;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the 0-RTT anti-replay store (for servers only)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] antiReplay Anti-replay store created by tlsInitAntiReplay()
+ * @return Error code
+ **/
+
+error_t tlsSetAntiReplay(TlsContext *context, TlsAntiReplay *antiReplay)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the anti-replay store
+   context->antiReplay = antiReplay;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the number of session tickets issued per connection
+ * @param[in] context Pointer to the TLS context
+ * @param[in] count Number of NewSessionTicket messages sent by the server
+ *   after the handshake (0 to disable the issuance of tickets)
+ * @return Error code
+ **/
+
+error_t tlsSetNewSessionTicketCount(TlsContext *context, uint_t count)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the number of NewSessionTicket messages to be sent
+   context->newSessionTicketLimit = count;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Defer the issuance of session tickets
+ *
+ * When enabled, the server does not send its NewSessionTicket messages right
+ * after the handshake. They are generated once the first application data
+ * have been sent, so that the encryption of the tickets does not delay the
+ * first response
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether the tickets are deferred
+ * @return Error code
+ **/
+
+error_t tlsEnableDeferredTickets(TlsContext *context, bool_t enabled)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enable or disable the deferred issuance of tickets
+   context->deferredTicketsEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Send early data to the remote TLS server
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t tlsWriteEarlyData(TlsContext *context, const void *data,
+   size_t length, size_t *written, uint_t flags)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
+   TLS_CLIENT_SUPPORT == ENABLED && TLS13_EARLY_DATA_SUPPORT == ENABLED)
+   size_t n;
+   error_t error;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(data == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check operation mode
+   if(context->entity != TLS_CONNECTION_END_CLIENT)
+      return ERROR_FAILURE;
+
+   //Make sure TLS 1.3 is supported by the client
+   if(context->versionMax < TLS_VERSION_1_3)
+      return ERROR_FAILURE;
+
+   //Check transport protocol
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+      return ERROR_FAILURE;
+
+   //Ensure the send/receive functions are properly registered
+   if(context->socketSendCallback == NULL || context->socketReceiveCallback == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //Verify that the PRNG is properly set
+   if(context->prngAlgo == NULL || context->prngContext == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+#if (DTLS_SUPPORT == ENABLED)
+   //Save current time
+   context->startTime = osGetSystemTime();
+#endif
+
+   //Send 0-RTT data
+   error = tls13SendEarlyData(context, data, length, &n);
+
+   //Total number of data that have been written
+   if(written != NULL)
+      *written = n;
+
+   //Return status code
+   return error;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Initiate the TLS handshake
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsConnect(TlsContext *context)
+{
+   error_t error;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Ensure the send/receive functions are properly registered
+   if(context->socketSendCallback == NULL || context->socketReceiveCallback == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //Verify that the PRNG is properly set
+   if(context->prngAlgo == NULL || context->prngContext == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+#if (DTLS_SUPPORT == ENABLED)
+   //Save current time
+   context->startTime = osGetSystemTime();
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
+   TLS_CLIENT_SUPPORT == ENABLED && TLS13_EARLY_DATA_SUPPORT == ENABLED)
+   //Any 0-RTT data sent by the client?
+   if(context->entity == TLS_CONNECTION_END_CLIENT &&
+      context->state == TLS_STATE_EARLY_DATA)
+   {
+      //Save current sequence number
+      context->earlyDataSeqNum = context->encryptionEngine.seqNum;
+      //Wait for a ServerHello message
+      context->state = TLS_STATE_SERVER_HELLO_3;
+   }
+#endif
+
+   //Perform TLS handshake
+   error = tlsPerformHandshake(context);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Perform one non-blocking step of the handshake
+ *
+ * The handshake progresses as far as possible without blocking. When it
+ * cannot go any further, the function reports what it is waiting for, so
+ * that an event loop (epoll, kqueue...) can arm exactly the right interest
+ * and call the function again once the event occurs
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] events Set of events the handshake is waiting for (see
+ *   TlsWaitEvent). TLS_WAIT_NONE is returned once the handshake is complete
+ * @param[out] timeout Time remaining before the retransmission timer
+ *   expires, valid if TLS_WAIT_TIMER is set (optional parameter)
+ * @return NO_ERROR if the handshake is complete, ERROR_WOULD_BLOCK if it
+ *   waits for an event, or another error code if it has failed
+ **/
+
+error_t tlsHandshakeStep(TlsContext *context, uint_t *events,
+   systime_t *timeout)
+{
+   error_t error;
+
+   //Check parameters
+   if(context == NULL || events == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Progress as far as possible
+   error = tlsConnect(context);
+
+   //Check status code
+   if(error == ERROR_WOULD_BLOCK)
+   {
+      //Determine what the handshake is waiting for
+      tlsGetWaitEvents(context, events, timeout);
+   }
+   else
+   {
+      //The handshake is complete or has failed
+      *events = TLS_WAIT_NONE;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check whether the server has accepted or rejected the early data
+ * @param[in] context Pointer to the TLS context
+ * @return TLS_EARLY_DATA_ACCEPTED if the early data was accepted, else
+ *   TLS_EARLY_DATA_REJECT if the early data was rejected
+ **/
+
+TlsEarlyDataStatus tlsGetEarlyDataStatus(TlsContext *context)
+{
+   TlsEarlyDataStatus status;
+
+   //Initialize early data status
+   status = TLS_EARLY_DATA_REJECTED;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
+   TLS_CLIENT_SUPPORT == ENABLED && TLS13_EARLY_DATA_SUPPORT == ENABLED)
+   //Make sure the TLS context is valid
+   if(context != NULL)
+   {
+      //Client mode?
+      if(context->entity == TLS_CONNECTION_END_CLIENT)
+      {
+         //Any 0-RTT data sent by the client?
+         if(context->earlyDataEnabled)
+         {
+            //Check whether the server has accepted or rejected the early data
+            if(context->earlyDataExtReceived && !context->earlyDataRejected)
+            {
+               status = TLS_EARLY_DATA_ACCEPTED;
+            }
+         }
+      }
+   }
+#endif
+
+   //Return early data status
+   return status;
+}
+
+
+/**
+ * @brief Send application data to the remote host using TLS
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t tlsWrite(TlsContext *context, const void *data,
+   size_t length, size_t *written, uint_t flags)
 {
+   error_t error;
+   size_t n;
+   size_t totalLength;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(data == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Ensure the send/receive functions are properly registered
+   if(context->socketSendCallback == NULL || context->socketReceiveCallback == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //Record layer offloaded to the transport?
+   if(context->offloaded)
+      return tlsOffloadWrite(context, data, length, written, flags);
+
+   //Acquire exclusive access to the sending side. The pending data are
+   //also updated by the reader when it sends an alert or a KeyUpdate
+   TLS_LOCK_TX(context);
+
+   //Application data must be accumulated in the TX buffer?
+   if(((flags & TLS_FLAG_CORK) != 0 || context->txPendingLen > 0 ||
+      context->txDataAccepted) && !tlsIsRecordPackingEnabled(context))
+   {
+      TlsIoVec iov;
+
+      //Release exclusive access to the sending side
+      TLS_UNLOCK_TX(context);
+
+      //Describe the data segment
+      iov.data = data;
+      iov.length = length;
+
+      //Preserve the ordering of the data that are already pending. The
+      //gathering path copes with any state the TX buffer is left in
+      return tlsWritev(context, &iov, 1, written, flags);
+   }
+
+#if (DTLS_SUPPORT == ENABLED)
+   //Save current time
+   context->startTime = osGetSystemTime();
+#endif
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Actual number of bytes written
+   totalLength = 0;
+
+   //Send as much data as possible
+   while(totalLength < length)
+   {
+      //Check current state
+      if(context->state < TLS_STATE_APPLICATION_DATA &&
+         !tlsIsFalseStartState(context))
+      {
+         //Perform TLS handshake
+         error = tlsPerformWriterHandshake(context);
+      }
+      else if(context->state == TLS_STATE_APPLICATION_DATA ||
+         tlsIsFalseStartState(context))
+      {
+#if (DTLS_SUPPORT == ENABLED)
+         //DTLS protocol?
+         if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+         {
+            //Length of the payload data
+            n = length;
+
+            //Send a datagram
+            error = dtlsWriteProtocolData(context, data, n,
+               TLS_TYPE_APPLICATION_DATA);
+
+            //Send the packed records, unless more data is about to follow
+            if(!error && (flags & TLS_FLAG_CORK) == 0)
+            {
+               error = dtlsFlushDatagram(context);
+            }
+         }
+         else
+#endif
+         //TLS protocol?
+         {
+            //Calculate the number of bytes to write at a time
+            n = MIN(length - totalLength, tlsGetAppDataFragmentLimit(context));
+
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_0)
+            //The 1/n-1 record splitting technique is a workaround for the
+            //BEAST attack
+            if(context->version <= TLS_VERSION_1_0 &&
+               context->cipherSuite.cipherMode == CIPHER_MODE_CBC &&
+               context->txLastRecordLen != 1 &&
+               totalLength == 0)
+            {
+               n = 1;
+            }
+#endif
+            //Large amount of data to send?
+            if(context->txBulkBuffer != NULL && context->txBufferLen == 0 &&
+               n == tlsGetTxFragmentLimit(context) && (length - totalLength) > n)
+            {
+               //Encrypt several records at once and send them together
+               error = tlsWriteBulkData(context, data, length - totalLength, &n);
+            }
+            else
+            {
+               //Send application data
+               error = tlsWriteProtocolData(context, data, n,
+                  TLS_TYPE_APPLICATION_DATA);
+            }
+         }
+
+         //Check status code
+         if(!error)
+         {
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_0)
+            //Save the length of the TLS record
+            context->txLastRecordLen = n;
+#endif
+            //Update the state of the dynamic record sizing policy
+            tlsUpdateDynamicRecordSizing(context, n);
+
+            //Advance data pointer
+            data = (uint8_t *) data + n;
+            //Update byte counter
+            totalLength += n;
+         }
+         else
+         {
+            //Send an alert message to the peer, if applicable
+            tlsProcessError(context, error);
+         }
+      }
+      else
+      {
+         //The connection has not yet been established
+         error = ERROR_NOT_CONNECTED;
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+   }
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
+   TLS_SERVER_SUPPORT == ENABLED)
+   //The deferred session tickets are issued once the first response has left
+   if(!error && (flags & TLS_FLAG_CORK) == 0)
+   {
+      error = tls13SendDeferredTickets(context);
+   }
+#endif
+
 #if (DTLS_SUPPORT == ENABLED)
+   //A write of zero bytes sends the records that are held back
+   if(!error && length == 0 && (flags & TLS_FLAG_CORK) == 0 &&
+      context->state == TLS_STATE_APPLICATION_DATA &&
+      tlsIsRecordPackingEnabled(context))
+   {
+      error = dtlsFlushDatagram(context);
+   }
+#endif
+
+   //Total number of data that have been written
+   if(written != NULL)
+      *written = totalLength;
+
+#if (TLS_FULL_DUPLEX_SUPPORT == DISABLED)
+   //Give back the TX/RX buffers if the connection is idle
+   tlsReleaseIdleBuffers(context);
+#endif
+
+   //Release the sending side
+   TLS_UNLOCK_TX(context);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send application data from multiple buffers using TLS
+ *
+ * Small segments are coalesced into full-sized TLS records. If the
+ * TLS_FLAG_CORK flag is set, the trailing partial record is held back
+ * until a subsequent write without this flag, a read, or the shutdown of
+ * the connection flushes it
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] iov List of data segments to be transmitted
+ * @param[in] iovCount Number of data segments
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t tlsWritev(TlsContext *context, const TlsIoVec *iov, uint_t iovCount,
+   size_t *written, uint_t flags)
+{
+   error_t error;
+   bool_t gather;
+   uint_t i;
+   size_t n;
+   size_t totalLength;
+
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
    //Check parameters
-   if(cookieGenerateCallback == NULL || cookieVerifyCallback == NULL)
+   if(iov == NULL && iovCount != 0)
       return ERROR_INVALID_PARAMETER;
 
-   //Save cookie generation/verification callback functions
-   context->cookieGenerateCallback = cookieGenerateCallback;
-   context->cookieVerifyCallback = cookieVerifyCallback;
+   //Ensure the send/receive functions are properly registered
+   if(context->socketSendCallback == NULL || context->socketReceiveCallback == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //Acquire exclusive access to the sending side
+   TLS_LOCK_TX(context);
+
+#if (DTLS_SUPPORT == ENABLED)
+   //Save current time
+   context->startTime = osGetSystemTime();
+#endif
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Actual number of bytes written
+   totalLength = 0;
+
+   //Wait for the connection to be established
+   while(!error)
+   {
+      //Check current state
+      if(context->state < TLS_STATE_APPLICATION_DATA &&
+         !tlsIsFalseStartState(context))
+      {
+         //Perform TLS handshake
+         error = tlsPerformWriterHandshake(context);
+      }
+      else if(context->state == TLS_STATE_APPLICATION_DATA ||
+         tlsIsFalseStartState(context))
+      {
+         //The connection is established
+         break;
+      }
+      else
+      {
+         //The connection has not yet been established
+         error = ERROR_NOT_CONNECTED;
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Segments are coalesced by default, unless the record layer has been
+      //offloaded to the transport
+      gather = !context->offloaded;
+
+#if (DTLS_SUPPORT == ENABLED)
+      //Each segment is sent as a separate datagram when using DTLS
+      if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+         gather = FALSE;
+#endif
+
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_0)
+      //The 1/n-1 record splitting technique is applied by tlsWrite
+      if(context->version <= TLS_VERSION_1_0 &&
+         context->cipherSuite.cipherMode == CIPHER_MODE_CBC)
+      {
+         gather = FALSE;
+      }
+#endif
+
+      //Coalesce small segments into full-sized records?
+      if(gather)
+      {
+         //Send application data
+         error = tlsWriteGatheredData(context, iov, iovCount, &totalLength,
+            flags);
+
+         //Any error to report?
+         if(error)
+         {
+            //Send an alert message to the peer, if applicable
+            tlsProcessError(context, error);
+         }
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
+   TLS_SERVER_SUPPORT == ENABLED)
+         else if((flags & TLS_FLAG_CORK) == 0)
+         {
+            //Issue the deferred session tickets
+            error = tls13SendDeferredTickets(context);
+         }
+#endif
+      }
+      else
+      {
+         //tlsWrite acquires the TX lock on its own
+         TLS_UNLOCK_TX(context);
+
+         //Send the segments one at a time
+         for(i = 0; i < iovCount && !error; i++)
+         {
+            //Records are packed into as few datagrams as possible when
+            //record packing is enabled
+            if(tlsIsRecordPackingEnabled(context) && (i + 1) < iovCount)
+            {
+               //Write the current segment
+               error = tlsWrite(context, iov[i].data, iov[i].length, &n,
+                  flags | TLS_FLAG_CORK);
+            }
+            else if(tlsIsRecordPackingEnabled(context))
+            {
+               //Write the last segment
+               error = tlsWrite(context, iov[i].data, iov[i].length, &n,
+                  flags);
+            }
+            else
+            {
+               //Write the current segment
+               error = tlsWrite(context, iov[i].data, iov[i].length, &n,
+                  flags & ~TLS_FLAG_CORK);
+            }
+
+            //Update byte counter
+            totalLength += n;
+         }
 
-   //This opaque pointer will be directly passed to the callback functions
-   context->cookieParam = param;
+         //Reacquire the TX lock
+         TLS_LOCK_TX(context);
+      }
+   }
 
-   //Successful processing
-   return NO_ERROR;
-#else
-   //DTLS is not implemented
-   return ERROR_NOT_IMPLEMENTED;
+   //Total number of data that have been written
+   if(written != NULL)
+      *written = totalLength;
+
+#if (TLS_FULL_DUPLEX_SUPPORT == DISABLED)
+   //Give back the TX/RX buffers if the connection is idle
+   tlsReleaseIdleBuffers(context);
 #endif
+
+   //Release the sending side
+   TLS_UNLOCK_TX(context);
+
+   //Return status code
+   return error;
 }
 
 
 /**
- * @brief Enable anti-replay mechanism (for DTLS only)
+ * @brief Offload the record layer to the transport (kernel TLS)
+ *
+ * Once the handshake is complete, the traffic keys and sequence numbers are
+ * passed to the callback, which is responsible for installing them in the
+ * transport layer (e.g. TLS_TX and TLS_RX socket options of Linux kTLS).
+ * tlsWrite and tlsRead then pass the application data straight through the
+ * socket callbacks. Alerts and post-handshake messages (such as KeyUpdate)
+ * must be handled through the control path of the transport layer
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] enabled Specifies whether anti-replay protection is enabled
+ * @param[in] callback Function that installs the traffic keys
+ * @param[in] param An opaque pointer passed to the callback function
  * @return Error code
  **/
 
-error_t tlsEnableReplayDetection(TlsContext *context, bool_t enabled)
+error_t tlsEnableOffload(TlsContext *context, TlsOffloadCallback callback,
+   void *param)
 {
-#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
-   //Invalid TLS context?
-   if(context == NULL)
+   error_t error;
+   TlsOffloadKeys txKeys;
+   TlsOffloadKeys rxKeys;
+
+   //Check parameters
+   if(context == NULL || callback == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Enable or disable anti-replay mechanism
-   context->replayDetectionEnabled = enabled;
+   //Both sides of the connection are handed over to the transport
+   TLS_LOCK_RX(context);
+   TLS_LOCK_TX(context);
 
-   //Successful processing
-   return NO_ERROR;
-#else
-   //Anti-replay mechanism is not implemented
-   return ERROR_NOT_IMPLEMENTED;
-#endif
-}
+   //The handshake must be complete
+   if(context->state != TLS_STATE_APPLICATION_DATA)
+   {
+      error = ERROR_NOT_CONNECTED;
+   }
+   //The record layer has already been offloaded?
+   else if(context->offloaded)
+   {
+      error = ERROR_WRONG_STATE;
+   }
+   //DTLS is not supported
+   else if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+   {
+      error = ERROR_NOT_IMPLEMENTED;
+   }
+   //Only AEAD ciphers can be offloaded
+   else if(context->encryptionEngine.cipherMode != CIPHER_MODE_CCM &&
+      context->encryptionEngine.cipherMode != CIPHER_MODE_GCM &&
+      context->encryptionEngine.cipherMode != CIPHER_MODE_CHACHA20_POLY1305)
+   {
+      error = ERROR_UNSUPPORTED_CIPHER_MODE;
+   }
+   //Records that have already been received must be consumed first
+   else if(context->rxBufferLen != 0 || context->rxRecordPos != 0 ||
+      context->rxAheadLen != 0)
+   {
+      error = ERROR_WRONG_STATE;
+   }
+   else
+   {
+      //Complete the transmission of any pending data
+      error = tlsWriteProtocolData(context, NULL, 0, TLS_TYPE_NONE);
+   }
 
+   //Check status code
+   if(!error)
+   {
+      //Export the current state of the encryption and decryption engines
+      tlsExportOffloadKeys(context, &context->encryptionEngine, &txKeys);
+      tlsExportOffloadKeys(context, &context->decryptionEngine, &rxKeys);
 
-/**
- * @brief Send the maximum amount of 0-RTT data the server can accept
- * @param[in] context Pointer to the TLS context
- * @param[in] maxEarlyDataSize Maximum amount of 0-RTT data that the client
- *   is allowed to send
- * @return Error code
- **/
+      //Install the traffic keys in the transport layer
+      error = callback(context, context->socketHandle, &txKeys, &rxKeys,
+         param);
+   }
 
+   //Check status code
+   if(!error)
+   {
+      //tlsWrite and tlsRead now act as pass-throughs
+      context->offloaded = TRUE;
 
-error_t tlsSetMaxEarlyDataSize(TlsContext *context, size_t maxEarlyDataSize)
-{
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
-   //Invalid TLS context?
-   if(context == NULL)
-      return ERROR_INVALID_PARAMETER;
+      //The TX and RX buffers are no longer needed
+      tlsReleaseTxBuffer(context);
+      tlsReleaseRxBuffer(context);
+   }
 
-   //Save the maximum amount of 0-RTT data that the client is allowed to send
-   context->maxEarlyDataSize = maxEarlyDataSize;
+   //Release both sides of the connection
+   TLS_UNLOCK_TX(context);
+   TLS_UNLOCK_RX(context);
 
-   //Successful processing
-   return NO_ERROR;
-#else
-   //Not implemented
-   return ERROR_NOT_IMPLEMENTED;
-#endif
+   //Return status code
+   return error;
 }
 
 
 /**
- * @brief Send early data to the remote TLS server
+ * @brief Get a buffer where to write application data directly
+ *
+ * The returned buffer lies within the TX buffer, at the payload offset of
+ * the next TLS record. The application serializes its data into it and then
+ * calls tlsCommitWriteBuffer, which protects the record in place and sends
+ * it. No other function can be called on the TLS context in between
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] data Pointer to a buffer containing the data to be transmitted
- * @param[in] length Number of bytes to be transmitted
- * @param[out] written Actual number of bytes written (optional parameter)
- * @param[in] flags Set of flags that influences the behavior of this function
+ * @param[out] buffer Pointer to the buffer where to write application data
+ * @param[out] size Maximum number of bytes that can be written
  * @return Error code
  **/
 
-error_t tlsWriteEarlyData(TlsContext *context, const void *data,
-   size_t length, size_t *written, uint_t flags)
+error_t tlsGetWriteBuffer(TlsContext *context, uint8_t **buffer, size_t *size)
 {
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
-   TLS_CLIENT_SUPPORT == ENABLED && TLS13_EARLY_DATA_SUPPORT == ENABLED)
-   size_t n;
    error_t error;
 
    //Invalid TLS context?
@@ -1519,57 +4370,58 @@ error_t tlsWriteEarlyData(TlsContext *context, const void *data,
       return ERROR_INVALID_PARAMETER;
 
    //Check parameters
-   if(data == NULL && length != 0)
+   if(buffer == NULL || size == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Check operation mode
-   if(context->entity != TLS_CONNECTION_END_CLIENT)
-      return ERROR_FAILURE;
-
-   //Make sure TLS 1.3 is supported by the client
-   if(context->versionMax < TLS_VERSION_1_3)
-      return ERROR_FAILURE;
-
-   //Check transport protocol
-   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
-      return ERROR_FAILURE;
-
    //Ensure the send/receive functions are properly registered
    if(context->socketSendCallback == NULL || context->socketReceiveCallback == NULL)
       return ERROR_NOT_CONFIGURED;
 
-   //Verify that the PRNG is properly set
-   if(context->prngAlgo == NULL || context->prngContext == NULL)
-      return ERROR_NOT_CONFIGURED;
+   //Records are protected by the transport layer
+   if(context->offloaded)
+      return ERROR_WRONG_STATE;
 
 #if (DTLS_SUPPORT == ENABLED)
    //Save current time
    context->startTime = osGetSystemTime();
 #endif
 
-   //Send 0-RTT data
-   error = tls13SendEarlyData(context, data, length, &n);
+   //Acquire exclusive access to the sending side
+   TLS_LOCK_TX(context);
 
-   //Total number of data that have been written
-   if(written != NULL)
-      *written = n;
+   //Wait for the connection to be established
+   error = tlsPrepareZeroCopyWrite(context);
+
+   //Check status code
+   if(!error)
+   {
+      //Reserve the payload area of the next TLS record
+      error = tlsReserveTxPayload(context, buffer, size);
+
+      //Any error to report?
+      if(error)
+      {
+         //Send an alert message to the peer, if applicable
+         tlsProcessError(context, error);
+      }
+   }
+
+   //Release the sending side
+   TLS_UNLOCK_TX(context);
 
    //Return status code
    return error;
-#else
-   //Not implemented
-   return ERROR_NOT_IMPLEMENTED;
-#endif
 }
 
 
 /**
- * @brief Initiate the TLS handshake
+ * @brief Send the application data written in the buffer
  * @param[in] context Pointer to the TLS context
+ * @param[in] length Number of bytes written by the application
  * @return Error code
  **/
 
-error_t tlsConnect(TlsContext *context)
+error_t tlsCommitWriteBuffer(TlsContext *context, size_t length)
 {
    error_t error;
 
@@ -1577,112 +4429,114 @@ error_t tlsConnect(TlsContext *context)
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Ensure the send/receive functions are properly registered
-   if(context->socketSendCallback == NULL || context->socketReceiveCallback == NULL)
-      return ERROR_NOT_CONFIGURED;
-
-   //Verify that the PRNG is properly set
-   if(context->prngAlgo == NULL || context->prngContext == NULL)
-      return ERROR_NOT_CONFIGURED;
-
-#if (DTLS_SUPPORT == ENABLED)
-   //Save current time
-   context->startTime = osGetSystemTime();
-#endif
+   //Acquire exclusive access to the sending side
+   TLS_LOCK_TX(context);
 
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
-   TLS_CLIENT_SUPPORT == ENABLED && TLS13_EARLY_DATA_SUPPORT == ENABLED)
-   //Any 0-RTT data sent by the client?
-   if(context->entity == TLS_CONNECTION_END_CLIENT &&
-      context->state == TLS_STATE_EARLY_DATA)
+   //Make sure the connection is established
+   if(context->state != TLS_STATE_APPLICATION_DATA)
    {
-      //Save current sequence number
-      context->earlyDataSeqNum = context->encryptionEngine.seqNum;
-      //Wait for a ServerHello message
-      context->state = TLS_STATE_SERVER_HELLO_3;
+      error = ERROR_NOT_CONNECTED;
+   }
+   //The buffer must have been obtained using tlsGetWriteBuffer
+   else if(!context->txZeroCopy)
+   {
+      error = ERROR_WRONG_STATE;
+   }
+   //Check the length of the application data
+   else if(length > tlsGetTxFragmentLimit(context))
+   {
+      error = ERROR_INVALID_LENGTH;
    }
+   else
+   {
+      //Protect the TLS record in place and send it
+      error = tlsWriteReservedRecord(context, length);
+
+      //Any error to report?
+      if(error)
+      {
+         //Send an alert message to the peer, if applicable
+         tlsProcessError(context, error);
+      }
+
+#if (TLS_FULL_DUPLEX_SUPPORT == DISABLED)
+      //Give back the TX/RX buffers if the connection is idle
+      tlsReleaseIdleBuffers(context);
 #endif
+   }
+
+   //Release the sending side
+   TLS_UNLOCK_TX(context);
 
-   //Perform TLS handshake
-   error = tlsPerformHandshake(context);
    //Return status code
    return error;
 }
 
 
 /**
- * @brief Check whether the server has accepted or rejected the early data
+ * @brief Register the send file callback of the transport layer
+ *
+ * The callback is used by tlsSendFile once the record layer has been
+ * offloaded to the transport (refer to tlsEnableOffload), so that file data
+ * can be sent and encrypted without leaving the kernel
+ *
  * @param[in] context Pointer to the TLS context
- * @return TLS_EARLY_DATA_ACCEPTED if the early data was accepted, else
- *   TLS_EARLY_DATA_REJECT if the early data was rejected
+ * @param[in] socketSendFileCallback Send file callback function
+ * @return Error code
  **/
 
-TlsEarlyDataStatus tlsGetEarlyDataStatus(TlsContext *context)
+error_t tlsSetSocketSendFileCallback(TlsContext *context,
+   TlsSocketSendFileCallback socketSendFileCallback)
 {
-   TlsEarlyDataStatus status;
-
-   //Initialize early data status
-   status = TLS_EARLY_DATA_REJECTED;
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
 
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
-   TLS_CLIENT_SUPPORT == ENABLED && TLS13_EARLY_DATA_SUPPORT == ENABLED)
-   //Make sure the TLS context is valid
-   if(context != NULL)
-   {
-      //Client mode?
-      if(context->entity == TLS_CONNECTION_END_CLIENT)
-      {
-         //Any 0-RTT data sent by the client?
-         if(context->earlyDataEnabled)
-         {
-            //Check whether the server has accepted or rejected the early data
-            if(context->earlyDataExtReceived && !context->earlyDataRejected)
-            {
-               status = TLS_EARLY_DATA_ACCEPTED;
-            }
-         }
-      }
-   }
-#endif
+   //Save send file callback function
+   context->socketSendFileCallback = socketSendFileCallback;
 
-   //Return early data status
-   return status;
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Send application data to the remote host using TLS
+ * @brief Send a range of a file using TLS
+ *
+ * The file data are read directly into the payload area of the TX record
+ * buffer, protected in place and sent, so that each byte is copied only
+ * once. When the record layer has been offloaded to the transport, the
+ * send file callback is used instead, if registered
+ *
  * @param[in] context Pointer to the TLS context
- * @param[in] data Pointer to a buffer containing the data to be transmitted
- * @param[in] length Number of bytes to be transmitted
+ * @param[in] file Opaque file handle passed to the callback functions
+ * @param[in] readCallback Function that reads data from the file
+ * @param[in] offset Offset of the first byte to send
+ * @param[in] length Number of bytes to send
  * @param[out] written Actual number of bytes written (optional parameter)
- * @param[in] flags Set of flags that influences the behavior of this function
  * @return Error code
  **/
 
-error_t tlsWrite(TlsContext *context, const void *data,
-   size_t length, size_t *written, uint_t flags)
+error_t tlsSendFile(TlsContext *context, void *file,
+   TlsFileReadCallback readCallback, uint64_t offset, size_t length,
+   size_t *written)
 {
    error_t error;
    size_t n;
+   size_t size;
    size_t totalLength;
+   uint8_t *p;
 
    //Invalid TLS context?
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
    //Check parameters
-   if(data == NULL && length != 0)
+   if(readCallback == NULL)
       return ERROR_INVALID_PARAMETER;
 
-   //Ensure the send/receive functions are properly registered
-   if(context->socketSendCallback == NULL || context->socketReceiveCallback == NULL)
-      return ERROR_NOT_CONFIGURED;
-
-#if (DTLS_SUPPORT == ENABLED)
-   //Save current time
-   context->startTime = osGetSystemTime();
-#endif
+   //Acquire exclusive access to the sending side
+   TLS_LOCK_TX(context);
 
    //Initialize status code
    error = NO_ERROR;
@@ -1690,96 +4544,128 @@ error_t tlsWrite(TlsContext *context, const void *data,
    //Actual number of bytes written
    totalLength = 0;
 
-   //Send as much data as possible
-   while(totalLength < length)
+   //Offloaded record layer?
+   if(context->offloaded)
    {
-      //Check current state
-      if(context->state < TLS_STATE_APPLICATION_DATA)
+      //Send as much data as possible
+      while(totalLength < length && !error)
       {
-         //Perform TLS handshake
-         error = tlsConnect(context);
-      }
-      else if(context->state == TLS_STATE_APPLICATION_DATA)
-      {
-#if (DTLS_SUPPORT == ENABLED)
-         //DTLS protocol?
-         if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
-         {
-            //Length of the payload data
-            n = length;
+         //Total number of bytes that have been written
+         n = 0;
 
-            //Send a datagram
-            error = dtlsWriteProtocolData(context, data, n,
-               TLS_TYPE_APPLICATION_DATA);
+         //Transport layer capable of sending files?
+         if(context->socketSendFileCallback != NULL)
+         {
+            //The file data are encrypted by the transport layer
+            error = context->socketSendFileCallback(context->socketHandle,
+               file, offset + totalLength, length - totalLength, &n);
          }
          else
-#endif
-         //TLS protocol?
          {
-            //Calculate the number of bytes to write at a time
-            n = MIN(length - totalLength, context->txBufferMaxLen);
-            //The record length must not exceed 16384 bytes
-            n = MIN(n, TLS_MAX_RECORD_LENGTH);
-
-#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
-            //Do not exceed the negotiated maximum fragment length
-            n = MIN(n, context->maxFragLen);
-#endif
+            //The TX buffer is used as an intermediate buffer
+            error = tlsAcquireTxBuffer(context);
 
-#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
-            //Maximum record size the peer is willing to receive
-            n = MIN(n, context->recordSizeLimit);
-#endif
+            //Check status code
+            if(!error)
+            {
+               //Read file data
+               error = readCallback(file, offset + totalLength,
+                  context->txBuffer, MIN(length - totalLength,
+                  context->txBufferSize), &size);
+
+               //Unexpected end of file?
+               if(!error && size == 0)
+                  error = ERROR_END_OF_STREAM;
+            }
 
-#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_0)
-            //The 1/n-1 record splitting technique is a workaround for the
-            //BEAST attack
-            if(context->version <= TLS_VERSION_1_0 &&
-               context->cipherSuite.cipherMode == CIPHER_MODE_CBC &&
-               context->txLastRecordLen != 1 &&
-               totalLength == 0)
+            //Check status code
+            if(!error)
             {
-               n = 1;
+               //Send the data through the transport layer
+               error = tlsOffloadWrite(context, context->txBuffer, size, &n,
+                  0);
             }
-#endif
-            //Send application data
-            error = tlsWriteProtocolData(context, data, n,
-               TLS_TYPE_APPLICATION_DATA);
          }
 
+         //Update byte counter
+         totalLength += n;
+      }
+   }
+   else
+   {
+      //Send as much data as possible
+      while(totalLength < length && !error)
+      {
+         //Wait for the connection to be established
+         error = tlsPrepareZeroCopyWrite(context);
+
          //Check status code
          if(!error)
          {
-#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_0)
-            //Save the length of the TLS record
-            context->txLastRecordLen = n;
-#endif
-            //Advance data pointer
-            data = (uint8_t *) data + n;
-            //Update byte counter
-            totalLength += n;
+            //Get the payload area of the next TLS record
+            error = tlsReserveTxPayload(context, &p, &size);
+
+            //Any error to report?
+            if(error)
+            {
+               //Send an alert message to the peer, if applicable
+               tlsProcessError(context, error);
+            }
          }
-         else
+
+         //Check status code
+         if(!error)
          {
-            //Send an alert message to the peer, if applicable
-            tlsProcessError(context, error);
+            //Read file data straight into the TLS record
+            error = readCallback(file, offset + totalLength, p,
+               MIN(length - totalLength, size), &n);
+
+            //Unexpected end of file?
+            if(!error && n == 0)
+               error = ERROR_END_OF_STREAM;
+
+            //Check status code
+            if(!error)
+            {
+               //Protect the TLS record in place and send it
+               error = tlsWriteReservedRecord(context, n);
+
+               //The record is accepted even if it cannot be sent immediately
+               if(error == NO_ERROR || error == ERROR_WOULD_BLOCK ||
+                  error == ERROR_TIMEOUT)
+               {
+                  //Update byte counter
+                  totalLength += n;
+               }
+
+               //Any error to report?
+               if(error)
+               {
+                  //Send an alert message to the peer, if applicable
+                  tlsProcessError(context, error);
+               }
+            }
+            else
+            {
+               //Give back the payload area
+               tlsWriteReservedRecord(context, 0);
+            }
          }
       }
-      else
-      {
-         //The connection has not yet been established
-         error = ERROR_NOT_CONNECTED;
-      }
-
-      //Any error to report?
-      if(error)
-         break;
    }
 
    //Total number of data that have been written
    if(written != NULL)
       *written = totalLength;
 
+#if (TLS_FULL_DUPLEX_SUPPORT == DISABLED)
+   //Give back the TX/RX buffers if the connection is idle
+   tlsReleaseIdleBuffers(context);
+#endif
+
+   //Release the sending side
+   TLS_UNLOCK_TX(context);
+
    //Return status code
    return error;
 }
@@ -1824,17 +4710,61 @@ error_t tlsRead(TlsContext *context, void *data,
    //Initialize status code
    error = NO_ERROR;
 
+   //Record layer offloaded to the transport?
+   if(context->offloaded)
+      return tlsOffloadRead(context, data, size, received, flags);
+
+   //Acquire exclusive access to the receiving side
+   TLS_LOCK_RX(context);
+
+#if (DTLS_SUPPORT == ENABLED)
+   //A DTLS endpoint may have to retransmit its last flight at any time, so
+   //the sending side is locked for the whole operation
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      TLS_LOCK_TX(context);
+   }
+#endif
+
+   //Any data lent by tlsReadBorrow are no longer referenced
+   context->rxBorrowedLen = 0;
+
    //No data has been read yet
    *received = 0;
 
+   //Data held back by the TLS_FLAG_CORK flag must reach the peer before
+   //waiting for its response
+   if(context->state == TLS_STATE_APPLICATION_DATA)
+   {
+      //The pending data are owned by the sending side
+      TLS_LOCK_STREAM_TX(context);
+
+      //Send the pending data
+      error = tlsFlushCorkedData(context);
+
+      //Any error to report?
+      if(error)
+      {
+         //Send an alert message to the peer, if applicable
+         tlsProcessError(context, error);
+      }
+
+      //Release the sending side
+      TLS_UNLOCK_STREAM_TX(context);
+   }
+
    //Read as much data as possible
-   while(*received < size)
+   while(!error && *received < size)
    {
       //Check current state
       if(context->state < TLS_STATE_APPLICATION_DATA)
       {
+         //The handshake involves both sides of the connection
+         TLS_LOCK_STREAM_TX(context);
          //Perform TLS handshake
          error = tlsConnect(context);
+         //Release the sending side
+         TLS_UNLOCK_STREAM_TX(context);
       }
       else if(context->state == TLS_STATE_APPLICATION_DATA)
       {
@@ -1953,8 +4883,13 @@ error_t tlsRead(TlsContext *context, void *data,
                //Number of bytes still pending in the receive buffer
                context->rxBufferLen -= n;
 
+               //Post-handshake messages may update the state of the sending
+               //side (KeyUpdate, renegotiation)
+               TLS_LOCK_STREAM_TX(context);
                //Parse handshake message
                error = tlsParseHandshakeMessage(context, p, n);
+               //Release the sending side
+               TLS_UNLOCK_STREAM_TX(context);
             }
             //Alert message received?
             else if(contentType == TLS_TYPE_ALERT)
@@ -1964,8 +4899,12 @@ error_t tlsRead(TlsContext *context, void *data,
                //Number of bytes still pending in the receive buffer
                context->rxBufferLen -= n;
 
+               //Alert messages affect both sides of the connection
+               TLS_LOCK_STREAM_TX(context);
                //Parse Alert message
                error = tlsParseAlert(context, (TlsAlert *) p, n);
+               //Release the sending side
+               TLS_UNLOCK_STREAM_TX(context);
             }
             //An inappropriate message was received?
             else
@@ -1978,8 +4917,12 @@ error_t tlsRead(TlsContext *context, void *data,
          //Any error to report?
          if(error)
          {
+            //The alert is sent on the sending side
+            TLS_LOCK_STREAM_TX(context);
             //Send an alert message to the peer, if applicable
             tlsProcessError(context, error);
+            //Release the sending side
+            TLS_UNLOCK_STREAM_TX(context);
          }
       }
       else if(context->state == TLS_STATE_CLOSING ||
@@ -2014,13 +4957,329 @@ error_t tlsRead(TlsContext *context, void *data,
          error = ERROR_NOT_CONNECTED;
       }
 
-      //Any error to report?
-      if(error)
-         break;
+      //Any error to report?
+      if(error)
+         break;
+   }
+
+   //Both buffers are examined
+   TLS_LOCK_STREAM_TX(context);
+   //Give back the TX/RX buffers if the connection is idle
+   tlsReleaseIdleBuffers(context);
+   //Release the sending side
+   TLS_UNLOCK_STREAM_TX(context);
+
+#if (DTLS_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      TLS_UNLOCK_TX(context);
+   }
+#endif
+
+   //Release the receiving side
+   TLS_UNLOCK_RX(context);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Access the application data received from the remote host in place
+ *
+ * The function returns a pointer to the decrypted data within the RX buffer.
+ * The data remain valid until tlsReadRelease is called
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] data Pointer to the received data
+ * @param[out] length Number of bytes available
+ * @return Error code
+ **/
+
+error_t tlsReadBorrow(TlsContext *context, const uint8_t **data,
+   size_t *length)
+{
+   error_t error;
+   size_t n;
+   uint8_t *p;
+   TlsContentType contentType;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check parameters
+   if(data == NULL || length == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Ensure the send/receive functions are properly registered
+   if(context->socketSendCallback == NULL || context->socketReceiveCallback == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //The decrypted data are not available in user space
+   if(context->offloaded)
+      return ERROR_WRONG_STATE;
+
+#if (DTLS_SUPPORT == ENABLED)
+   //Save current time
+   context->startTime = osGetSystemTime();
+#endif
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Acquire exclusive access to the receiving side
+   TLS_LOCK_RX(context);
+
+#if (DTLS_SUPPORT == ENABLED)
+   //A DTLS endpoint may have to retransmit its last flight at any time, so
+   //the sending side is locked for the whole operation
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      TLS_LOCK_TX(context);
+   }
+#endif
+
+   //No data is available yet
+   *data = NULL;
+   *length = 0;
+
+   //Data held back by the TLS_FLAG_CORK flag must reach the peer before
+   //waiting for its response
+   if(context->state == TLS_STATE_APPLICATION_DATA)
+   {
+      //The pending data are owned by the sending side
+      TLS_LOCK_STREAM_TX(context);
+
+      //Send the pending data
+      error = tlsFlushCorkedData(context);
+
+      //Any error to report?
+      if(error)
+      {
+         //Send an alert message to the peer, if applicable
+         tlsProcessError(context, error);
+      }
+
+      //Release the sending side
+      TLS_UNLOCK_STREAM_TX(context);
+   }
+
+   //Wait for application data
+   while(!error)
+   {
+      //Check current state
+      if(context->state < TLS_STATE_APPLICATION_DATA)
+      {
+         //The handshake involves both sides of the connection
+         TLS_LOCK_STREAM_TX(context);
+         //Perform TLS handshake
+         error = tlsConnect(context);
+         //Release the sending side
+         TLS_UNLOCK_STREAM_TX(context);
+      }
+      else if(context->state == TLS_STATE_APPLICATION_DATA)
+      {
+#if (DTLS_SUPPORT == ENABLED)
+         //DTLS protocol?
+         if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+         {
+            //Receive a datagram
+            error = dtlsReadProtocolData(context, &p, &n, &contentType);
+         }
+         else
+#endif
+         //TLS protocol?
+         {
+            //The record layer receives uninterpreted data from higher layers
+            error = tlsReadProtocolData(context, &p, &n, &contentType);
+         }
+
+         //Check status code
+         if(!error)
+         {
+            //Application data received?
+            if(contentType == TLS_TYPE_APPLICATION_DATA)
+            {
+               //The data are not removed from the receive buffer until they
+               //are released by the application
+               context->rxBorrowedLen = n;
+
+               //Return a pointer to the decrypted data
+               *data = p;
+               *length = n;
+
+               //We are done
+               break;
+            }
+            //Handshake message received?
+            else if(contentType == TLS_TYPE_HANDSHAKE)
+            {
+               //Advance data pointer
+               context->rxBufferPos += n;
+               //Number of bytes still pending in the receive buffer
+               context->rxBufferLen -= n;
+
+               //Post-handshake messages may update the state of the sending
+               //side (KeyUpdate, renegotiation)
+               TLS_LOCK_STREAM_TX(context);
+               //Parse handshake message
+               error = tlsParseHandshakeMessage(context, p, n);
+               //Release the sending side
+               TLS_UNLOCK_STREAM_TX(context);
+            }
+            //Alert message received?
+            else if(contentType == TLS_TYPE_ALERT)
+            {
+               //Advance data pointer
+               context->rxBufferPos += n;
+               //Number of bytes still pending in the receive buffer
+               context->rxBufferLen -= n;
+
+               //Alert messages affect both sides of the connection
+               TLS_LOCK_STREAM_TX(context);
+               //Parse Alert message
+               error = tlsParseAlert(context, (TlsAlert *) p, n);
+               //Release the sending side
+               TLS_UNLOCK_STREAM_TX(context);
+            }
+            //An inappropriate message was received?
+            else
+            {
+               //Report an error
+               error = ERROR_UNEXPECTED_MESSAGE;
+            }
+         }
+
+         //Any error to report?
+         if(error)
+         {
+            //The alert is sent on the sending side
+            TLS_LOCK_STREAM_TX(context);
+            //Send an alert message to the peer, if applicable
+            tlsProcessError(context, error);
+            //Release the sending side
+            TLS_UNLOCK_STREAM_TX(context);
+         }
+      }
+      else if(context->state == TLS_STATE_CLOSING ||
+         context->state == TLS_STATE_CLOSED)
+      {
+         //Check whether a fatal alert message has been sent or received
+         if(context->fatalAlertSent || context->fatalAlertReceived)
+         {
+            //Alert messages with a level of fatal result in the immediate
+            //termination of the connection
+            error = ERROR_FAILURE;
+         }
+         else
+         {
+            //The receive buffer is empty
+            error = ERROR_END_OF_STREAM;
+         }
+      }
+      else
+      {
+         //The connection has not yet been established
+         error = ERROR_NOT_CONNECTED;
+      }
+   }
+
+   //Both buffers are examined
+   TLS_LOCK_STREAM_TX(context);
+   //Give back the TX/RX buffers if the connection is idle
+   tlsReleaseIdleBuffers(context);
+   //Release the sending side
+   TLS_UNLOCK_STREAM_TX(context);
+
+#if (DTLS_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      TLS_UNLOCK_TX(context);
+   }
+#endif
+
+   //Release the receiving side
+   TLS_UNLOCK_RX(context);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Give back application data obtained with tlsReadBorrow
+ * @param[in] context Pointer to the TLS context
+ * @param[in] consumed Number of bytes that have been processed by the
+ *   application
+ * @return Error code
+ **/
+
+error_t tlsReadRelease(TlsContext *context, size_t consumed)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the receiving side
+   TLS_LOCK_RX(context);
+
+   //The application cannot release more data than it has borrowed
+   if(consumed > context->rxBorrowedLen)
+   {
+      //Release the receiving side
+      TLS_UNLOCK_RX(context);
+      //Report an error
+      return ERROR_INVALID_LENGTH;
    }
 
-   //Return status code
-   return error;
+#if (DTLS_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      //A DTLS endpoint may have to retransmit its last flight at any time,
+      //so the sending side is locked for the rest of the operation
+      TLS_LOCK_TX(context);
+
+      //Datagrams are consumed in one piece
+      context->rxBufferPos = 0;
+      context->rxBufferLen = 0;
+   }
+   else
+#endif
+   //TLS protocol?
+   {
+      //Advance data pointer
+      context->rxBufferPos += consumed;
+      //Number of bytes still pending in the receive buffer
+      context->rxBufferLen -= consumed;
+   }
+
+   //The borrowed data are no longer referenced by the application
+   context->rxBorrowedLen = 0;
+
+   //Both buffers are examined
+   TLS_LOCK_STREAM_TX(context);
+   //Give back the TX/RX buffers if the connection is idle
+   tlsReleaseIdleBuffers(context);
+   //Release the sending side
+   TLS_UNLOCK_STREAM_TX(context);
+
+#if (DTLS_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      TLS_UNLOCK_TX(context);
+   }
+#endif
+
+   //Release the receiving side
+   TLS_UNLOCK_RX(context);
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
@@ -2045,7 +5304,8 @@ bool_t tlsIsTxReady(TlsContext *context)
       if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_STREAM)
       {
          //Check whether some data is pending in the transmit buffer
-         if(context->txBufferPos < context->txBufferLen)
+         if(context->txBufferPos < context->txBufferLen ||
+            context->txBulkPos < context->txBulkLen)
          {
             ready = TRUE;
          }
@@ -2091,7 +5351,7 @@ bool_t tlsIsRxReady(TlsContext *context)
       //TLS protocol?
       {
          //Check whether some data is pending in the receive buffer
-         if(context->rxBufferLen > 0)
+         if(context->rxBufferLen > 0 || context->rxAheadLen > 0)
          {
             ready = TRUE;
          }
@@ -2142,6 +5402,26 @@ error_t tlsShutdownEx(TlsContext *context, bool_t waitForCloseNotify)
    context->startTime = osGetSystemTime();
 #endif
 
+   //Record layer offloaded to the transport?
+   if(context->offloaded)
+   {
+      //The close_notify alert must be sent through the control path of the
+      //transport layer
+      context->state = TLS_STATE_CLOSED;
+      //Successful processing
+      return NO_ERROR;
+   }
+
+   //Waiting for the responding close_notify alert involves the receiving
+   //side as well
+   if(waitForCloseNotify)
+   {
+      TLS_LOCK_RX(context);
+   }
+
+   //Acquire exclusive access to the sending side
+   TLS_LOCK_TX(context);
+
    //Initialize status code
    error = NO_ERROR;
 
@@ -2259,6 +5539,15 @@ error_t tlsShutdownEx(TlsContext *context, bool_t waitForCloseNotify)
          break;
    }
 
+   //Release the sending side
+   TLS_UNLOCK_TX(context);
+
+   //Release the receiving side
+   if(waitForCloseNotify)
+   {
+      TLS_UNLOCK_RX(context);
+   }
+
    //Return status code
    return error;
 }
@@ -2271,9 +5560,56 @@ error_t tlsShutdownEx(TlsContext *context, bool_t waitForCloseNotify)
 
 void tlsFree(TlsContext *context)
 {
+   uint_t i;
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   bool_t staticMem;
+#endif
+
    //Valid TLS context?
    if(context != NULL)
    {
+#if (DTLS_SUPPORT == ENABLED && TLS_SERVER_SUPPORT == ENABLED)
+      //Unbind the context from its DTLS listener, if any
+      if(context->listener != NULL)
+      {
+         dtlsDetachListenerContext(context);
+      }
+#endif
+
+#if (DTLS_SUPPORT == ENABLED)
+      //Cancel the retransmission timer, if any
+      dtlsDisarmTimer(context);
+#endif
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_FLIGHT_CACHE_SUPPORT == ENABLED)
+      //Release the flight cache
+      dtlsFreeFlightCache(context);
+#endif
+
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+      //Release the cipher suite negotiation table
+      tlsReleaseCipherSuiteTable(context);
+#endif
+
+      //Release the credentials attached to the context
+      for(i = 0; i < context->numCerts; i++)
+      {
+         tlsFreeCredential(context->certs[i].credential);
+      }
+
+#if (TLS_CERT_STORE_SUPPORT == ENABLED && TLS_SNI_SUPPORT == ENABLED)
+      //Release the credentials selected from the certificate store
+      tlsReleaseCertStoreCredentials(context);
+#endif
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+      //Release the stapled OCSP response
+      tlsReleaseStapledOcspResponse(context);
+#endif
+
+      //Release the trusted CA store
+      tlsFreeTrustStore(context->trustStore);
+
       //Release server name
       if(context->serverName != NULL)
       {
@@ -2288,27 +5624,90 @@ void tlsFree(TlsContext *context)
       }
 
       //Release send buffer
-      if(context->txBuffer != NULL)
+      tlsReleaseTxBuffer(context);
+      //Release receive buffer
+      tlsReleaseRxBuffer(context);
+
+      //Release read-ahead buffer
+      if(context->rxAheadBuffer != NULL)
       {
-         memset(context->txBuffer, 0, context->txBufferSize);
-         tlsFreeMem(context->txBuffer);
+         tlsFreeMem(context->rxAheadBuffer);
       }
 
-      //Release receive buffer
-      if(context->rxBuffer != NULL)
+      //Release bulk send buffer
+      if(context->txBulkBuffer != NULL)
       {
-         memset(context->rxBuffer, 0, context->rxBufferSize);
-         tlsFreeMem(context->rxBuffer);
+         memset(context->txBulkBuffer, 0, context->txBulkSize);
+         tlsFreeMem(context->txBulkBuffer);
       }
 
+#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+      //Release the sliding window, unless it is held in the context
+      if(context->replayWindow != NULL &&
+         context->replayWindow != context->replayWindowBuffer)
+      {
+         tlsFreeMem(context->replayWindow);
+      }
+#endif
+
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+      //Withdraw the requests queued to the signing engine, if any
+      if(context->asyncSignCallback == tlsSignEngineCallback)
+      {
+         tlsCancelSignRequests(context->asyncSignParam, context);
+      }
+
+      //Release the state of the asynchronous signature operation
+      tlsFreeAsyncSign(context);
+#endif
+
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+      //Release the result of the external session cache lookup, if any
+      if(context->extCacheResult != NULL)
+      {
+         memset(context->extCacheResult, 0, context->extCacheResultLen);
+         tlsFreeMem(context->extCacheResult);
+      }
+#endif
+
       //Release transcript hash context
       tlsFreeTranscriptHash(context);
 
+#if (TLS_CERT_STREAM_SUPPORT == ENABLED)
+      //Release the state of the incremental Certificate message parser
+      tlsFreeCertStream(context);
+#endif
+
+      //Release the handshake key material
+      if(context->handshake != NULL)
+      {
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+         tlsClearArena(context->handshake);
+#endif
+         memset(context->handshake, 0, sizeof(TlsHandshakeContext));
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+         //The memory supplied by the application is never freed
+         if(context->handshake != context->staticHandshake)
+#endif
+         {
+            tlsFreeMem(context->handshake);
+         }
+      }
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //Release session ticket (TLS 1.2)
+      if(context->sessionTicket != NULL)
+      {
+         tlsFreeObject(TLS_MEM_CLASS_TICKET, context->sessionTicket);
+      }
+#endif
+
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
       //Release session ticket (TLS 1.3)
       if(context->ticket != NULL)
       {
-         tlsFreeMem(context->ticket);
+         tlsFreeObject(TLS_MEM_CLASS_TICKET, context->ticket);
       }
 
       //Release the ALPN protocol associated with the ticket
@@ -2326,6 +5725,9 @@ void tlsFree(TlsContext *context)
 #if (TLS_ECDH_SUPPORT == ENABLED)
       //Release ECDH context
       ecdhFree(&context->ecdhContext);
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      ecdhFree(&context->speculativeEcdhContext);
+#endif
 #endif
 
 #if (TLS_RSA_SUPPORT == ENABLED)
@@ -2359,18 +5761,21 @@ void tlsFree(TlsContext *context)
          tlsFreeMem(context->pskIdentity);
       }
 
-      //Release the PSK identity hint
-      if(context->pskIdentityHint != NULL)
+      //Release the PSK identity hint (unless owned by the configuration)
+      if(context->pskIdentityHint != NULL && (context->config == NULL ||
+         context->pskIdentityHint != context->config->pskIdentityHint))
       {
          tlsFreeMem(context->pskIdentityHint);
       }
 #endif
 
 #if (TLS_ALPN_SUPPORT == ENABLED)
-      //Release the list of supported ALPN protocols
-      if(context->protocolList != NULL)
+      //Release the list of supported ALPN protocols (unless owned by the
+      //configuration)
+      if(context->alpnList != NULL && (context->config == NULL ||
+         context->alpnList != context->config->alpnList))
       {
-         tlsFreeMem(context->protocolList);
+         tlsFreeAlpnList(context->alpnList);
       }
 
       //Release the selected ALPN protocol
@@ -2390,9 +5795,30 @@ void tlsFree(TlsContext *context)
       tlsFreeEncryptionEngine(&context->prevEncryptionEngine);
 #endif
 
+      //Release the shared configuration
+      tlsFreeConfig(context->config);
+
+#if (TLS_FULL_DUPLEX_SUPPORT == ENABLED)
+      //Release the mutexes serializing each side of the connection
+      osDeleteMutex(&context->txMutex);
+      osDeleteMutex(&context->rxMutex);
+#endif
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //Check whether the context lives in memory supplied by the application
+      staticMem = context->staticMem;
+#endif
+
       //Clear the TLS context before freeing memory
       memset(context, 0, sizeof(TlsContext));
-      tlsFreeMem(context);
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //The memory supplied by the application is never freed
+      if(!staticMem)
+#endif
+      {
+         tlsFreeMem(context);
+      }
    }
 }
 
@@ -2442,6 +5868,24 @@ error_t tlsSaveSessionState(const TlsContext *context,
       if(context->cipherSuite.identifier != 0 &&
          context->sessionIdLen > 0)
       {
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+         //Any session ticket received from the server?
+         if(context->sessionTicketLen > 0)
+         {
+            //Allocate a memory block to hold the ticket
+            session->ticket = tlsAllocObject(TLS_MEM_CLASS_TICKET,
+               context->sessionTicketLen);
+            //Failed to allocate memory?
+            if(session->ticket == NULL)
+               return ERROR_OUT_OF_MEMORY;
+
+            //Copy session ticket
+            memcpy(session->ticket, context->sessionTicket,
+               context->sessionTicketLen);
+            session->ticketLen = context->sessionTicketLen;
+         }
+#endif
+
          //Get current time
          session->timestamp = osGetSystemTime();
 
@@ -2505,7 +5949,8 @@ error_t tlsSaveSessionState(const TlsContext *context,
          hashAlgo = context->cipherSuite.prfHashAlgo;
 
          //Allocate a memory block to hold the ticket
-         session->ticket = tlsAllocMem(context->ticketLen);
+         session->ticket = tlsAllocObject(TLS_MEM_CLASS_TICKET,
+            context->ticketLen);
          //Failed to allocate memory?
          if(session->ticket == NULL)
             return ERROR_OUT_OF_MEMORY;
@@ -2611,6 +6056,32 @@ error_t tlsRestoreSessionState(TlsContext *context,
          //Extended master secret computation
          context->extendedMasterSecretExtReceived = session->extendedMasterSecret;
 #endif
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+         //Release existing session ticket, if any
+         if(context->sessionTicket != NULL)
+         {
+            tlsFreeObject(TLS_MEM_CLASS_TICKET, context->sessionTicket);
+            context->sessionTicket = NULL;
+            context->sessionTicketLen = 0;
+         }
+
+         //Any session ticket associated with the session?
+         if(session->ticketLen > 0)
+         {
+            //Allocate a memory block to hold the ticket
+            context->sessionTicket = tlsAllocObject(TLS_MEM_CLASS_TICKET,
+               session->ticketLen);
+            //Failed to allocate memory?
+            if(context->sessionTicket == NULL)
+               return ERROR_OUT_OF_MEMORY;
+
+            //Copy session ticket
+            memcpy(context->sessionTicket, session->ticket,
+               session->ticketLen);
+            context->sessionTicketLen = session->ticketLen;
+         }
+#endif
       }
    }
    else
@@ -2636,13 +6107,14 @@ error_t tlsRestoreSessionState(TlsContext *context,
          if(context->ticket != NULL)
          {
             memset(context->ticket, 0, context->ticketLen);
-            tlsFreeMem(context->ticket);
+            tlsFreeObject(TLS_MEM_CLASS_TICKET, context->ticket);
             context->ticket = NULL;
             context->ticketLen = 0;
          }
 
          //Allocate a memory block to hold the ticket
-         context->ticket = tlsAllocMem(session->ticketLen);
+         context->ticket = tlsAllocObject(TLS_MEM_CLASS_TICKET,
+            session->ticketLen);
          //Failed to allocate memory?
          if(context->ticket == NULL)
             return ERROR_OUT_OF_MEMORY;
@@ -2703,6 +6175,346 @@ error_t tlsRestoreSessionState(TlsContext *context,
 }
 
 
+/**
+ * @brief Export a session state
+ *
+ * The session state is encoded as a single contiguous buffer, using a
+ * versioned binary format. Time stamps are encoded as ages relative to the
+ * current time, so that the resulting buffer remains valid across a process
+ * restart. The buffer contains the master secret (or ticket PSK) in the
+ * clear and must be protected accordingly
+ *
+ * @param[in] session Pointer to the session state
+ * @param[out] output Output buffer. If this parameter is NULL, the function
+ *   only computes the length of the encoded session state
+ * @param[out] length Length of the encoded session state, in bytes
+ * @return Error code
+ **/
+
+error_t tlsExportSessionState(const TlsSessionState *session, uint8_t *output,
+   size_t *length)
+{
+   uint8_t flags;
+   size_t n;
+   size_t sessionIdLen;
+   size_t ticketLen;
+   size_t alpnLen;
+   size_t serverNameLen;
+   systime_t time;
+   uint32_t age;
+   uint32_t ticketAge;
+   uint8_t *p;
+
+   //Check parameters
+   if(session == NULL || length == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Initialize variables
+   flags = 0;
+   sessionIdLen = 0;
+   ticketLen = 0;
+   ticketAge = 0;
+   alpnLen = 0;
+   serverNameLen = 0;
+
+   //Age of the session, in milliseconds
+   age = (uint32_t) MIN(time - session->timestamp, 0xFFFFFFFF);
+
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //Session identifier
+   sessionIdLen = MIN(session->sessionIdLen, 32);
+
+   //Extended master secret computation
+   if(session->extendedMasterSecret)
+      flags |= TLS_SESSION_EXPORT_FLAG_EMS;
+#endif
+
+#if ((TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3) || \
+   TLS12_TICKET_SUPPORT == ENABLED)
+   //Session ticket
+   if(session->ticket != NULL)
+      ticketLen = session->ticketLen;
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Age of the ticket
+   if(session->ticket != NULL)
+      ticketAge = (uint32_t) MIN(time - session->ticketTimestamp, 0xFFFFFFFF);
+
+   //ALPN protocol associated with the ticket
+   if(session->ticketAlpn != NULL)
+      alpnLen = strlen(session->ticketAlpn);
+#endif
+
+#if (TLS_SNI_SUPPORT == ENABLED)
+   //Server name
+   if(session->serverName != NULL)
+      serverNameLen = strlen(session->serverName);
+#endif
+
+   //Check the length of the variable-length fields
+   if(ticketLen > 0xFFFF || alpnLen > 0xFF || serverNameLen > 0xFFFF)
+      return ERROR_INVALID_LENGTH;
+
+   //Calculate the length of the encoded session state
+   n = TLS_SESSION_EXPORT_HEADER_SIZE + sessionIdLen + ticketLen + alpnLen +
+      serverNameLen;
+
+   //Encode the session state, if requested
+   if(output != NULL)
+   {
+      //Point to the output buffer
+      p = output;
+
+      //Format version and flags
+      p[0] = TLS_SESSION_EXPORT_FORMAT;
+      p[1] = flags;
+
+      //Protocol version and cipher suite
+      STORE16BE(session->version, p + 2);
+      STORE16BE(session->cipherSuite, p + 4);
+
+      //Age of the session
+      STORE32BE(age, p + 6);
+
+      //Master secret (TLS 1.2) or ticket PSK (TLS 1.3)
+      memcpy(p + 10, session->secret, 48);
+      p += 58;
+
+      //Session identifier
+      p[0] = (uint8_t) sessionIdLen;
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+      memcpy(p + 1, session->sessionId, sessionIdLen);
+#endif
+      p += 1 + sessionIdLen;
+
+      //Session ticket
+      STORE16BE(ticketLen, p);
+#if ((TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3) || \
+   TLS12_TICKET_SUPPORT == ENABLED)
+      memcpy(p + 2, session->ticket, ticketLen);
+#endif
+      p += 2 + ticketLen;
+
+      //Ticket parameters
+      STORE32BE(ticketAge, p);
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      STORE32BE(session->ticketLifetime, p + 4);
+      STORE32BE(session->ticketAgeAdd, p + 8);
+      p[12] = (uint8_t) session->ticketHashAlgo;
+      STORE32BE(session->maxEarlyDataSize, p + 13);
+#else
+      memset(p + 4, 0, 13);
+#endif
+      p += 17;
+
+      //ALPN protocol associated with the ticket
+      p[0] = (uint8_t) alpnLen;
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      memcpy(p + 1, session->ticketAlpn, alpnLen);
+#endif
+      p += 1 + alpnLen;
+
+      //Server name
+      STORE16BE(serverNameLen, p);
+#if (TLS_SNI_SUPPORT == ENABLED)
+      memcpy(p + 2, session->serverName, serverNameLen);
+#endif
+   }
+
+   //Length of the encoded session state
+   *length = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Import a session state
+ * @param[in] input Encoded session state (refer to tlsExportSessionState)
+ * @param[in] length Length of the encoded session state, in bytes
+ * @param[out] session Pointer to the session state
+ * @return Error code
+ **/
+
+error_t tlsImportSessionState(const uint8_t *input, size_t length,
+   TlsSessionState *session)
+{
+   size_t n;
+   size_t sessionIdLen;
+   size_t ticketLen;
+   size_t alpnLen;
+   size_t serverNameLen;
+   systime_t time;
+   const uint8_t *sessionId;
+   const uint8_t *ticket;
+   const uint8_t *ticketParams;
+   const uint8_t *alpn;
+   const uint8_t *serverName;
+
+   //Check parameters
+   if(input == NULL || session == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Malformed input?
+   if(length < TLS_SESSION_EXPORT_HEADER_SIZE)
+      return ERROR_DECODING_FAILED;
+
+   //Unknown format version?
+   if(input[0] != TLS_SESSION_EXPORT_FORMAT)
+      return ERROR_INVALID_VERSION;
+
+   //Session identifier
+   n = 58;
+   sessionIdLen = input[n];
+   sessionId = input + n + 1;
+   n += 1 + sessionIdLen;
+
+   //Malformed input?
+   if(sessionIdLen > 32 || length < (n + 2))
+      return ERROR_DECODING_FAILED;
+
+   //Session ticket
+   ticketLen = LOAD16BE(input + n);
+   ticket = input + n + 2;
+   n += 2 + ticketLen;
+
+   //Malformed input?
+   if(length < (n + 18))
+      return ERROR_DECODING_FAILED;
+
+   //Ticket parameters
+   ticketParams = input + n;
+   n += 17;
+
+   //ALPN protocol associated with the ticket
+   alpnLen = input[n];
+   alpn = input + n + 1;
+   n += 1 + alpnLen;
+
+   //Malformed input?
+   if(length < (n + 2))
+      return ERROR_DECODING_FAILED;
+
+   //Server name
+   serverNameLen = LOAD16BE(input + n);
+   serverName = input + n + 2;
+   n += 2 + serverNameLen;
+
+   //The length of the input must match exactly
+   if(length != n)
+      return ERROR_DECODING_FAILED;
+
+   //Release previous session state
+   tlsFreeSessionState(session);
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Protocol version and cipher suite
+   session->version = LOAD16BE(input + 2);
+   session->cipherSuite = LOAD16BE(input + 4);
+
+   //Time stamps are rebuilt from the encoded ages
+   session->timestamp = time - LOAD32BE(input + 6);
+
+   //Master secret (TLS 1.2) or ticket PSK (TLS 1.3)
+   memcpy(session->secret, input + 10, 48);
+
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //Session identifier
+   memcpy(session->sessionId, sessionId, sessionIdLen);
+   session->sessionIdLen = sessionIdLen;
+
+   //Extended master secret computation
+   session->extendedMasterSecret =
+      (input[1] & TLS_SESSION_EXPORT_FLAG_EMS) ? TRUE : FALSE;
+#endif
+
+#if ((TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3) || \
+   TLS12_TICKET_SUPPORT == ENABLED)
+   //Session ticket
+   if(ticketLen > 0)
+   {
+      //Allocate a memory block to hold the ticket
+      session->ticket = tlsAllocObject(TLS_MEM_CLASS_TICKET, ticketLen);
+      //Failed to allocate memory?
+      if(session->ticket == NULL)
+      {
+         tlsFreeSessionState(session);
+         return ERROR_OUT_OF_MEMORY;
+      }
+
+      //Copy session ticket
+      memcpy(session->ticket, ticket, ticketLen);
+      session->ticketLen = ticketLen;
+   }
+#else
+   //Session tickets are not supported
+   (void) ticket;
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Ticket parameters
+   session->ticketTimestamp = time - LOAD32BE(ticketParams);
+   session->ticketLifetime = LOAD32BE(ticketParams + 4);
+   session->ticketAgeAdd = LOAD32BE(ticketParams + 8);
+   session->ticketHashAlgo = (TlsHashAlgo) ticketParams[12];
+   session->maxEarlyDataSize = LOAD32BE(ticketParams + 13);
+
+   //ALPN protocol associated with the ticket
+   if(alpnLen > 0)
+   {
+      //Allocate a memory block to hold the ALPN protocol
+      session->ticketAlpn = tlsAllocMem(alpnLen + 1);
+      //Failed to allocate memory?
+      if(session->ticketAlpn == NULL)
+      {
+         tlsFreeSessionState(session);
+         return ERROR_OUT_OF_MEMORY;
+      }
+
+      //Copy the ALPN protocol
+      memcpy(session->ticketAlpn, alpn, alpnLen);
+      session->ticketAlpn[alpnLen] = '\0';
+   }
+#else
+   //TLS 1.3 tickets are not supported
+   (void) ticketParams;
+   (void) alpn;
+#endif
+
+#if (TLS_SNI_SUPPORT == ENABLED)
+   //Server name
+   if(serverNameLen > 0)
+   {
+      //Allocate a memory block to hold the server name
+      session->serverName = tlsAllocMem(serverNameLen + 1);
+      //Failed to allocate memory?
+      if(session->serverName == NULL)
+      {
+         tlsFreeSessionState(session);
+         return ERROR_OUT_OF_MEMORY;
+      }
+
+      //Copy the server name
+      memcpy(session->serverName, serverName, serverNameLen);
+      session->serverName[serverNameLen] = '\0';
+   }
+#else
+   //The ServerName extension is not supported
+   (void) serverName;
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Properly dispose a session state
  * @param[in] session Pointer to the session state to be released
@@ -2713,13 +6525,16 @@ void tlsFreeSessionState(TlsSessionState *session)
    //Make sure the session state is valid
    if(session != NULL)
    {
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+#if ((TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3) || \
+   TLS12_TICKET_SUPPORT == ENABLED)
       //Release session ticket
       if(session->ticket != NULL)
       {
-         tlsFreeMem(session->ticket);
+         tlsFreeObject(TLS_MEM_CLASS_TICKET, session->ticket);
       }
+#endif
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
       //Release the ALPN protocol associated with the ticket
       if(session->ticketAlpn != NULL)
       {
@@ -46,6 +46,7 @@ struct _TlsContext;
 #include "pkc/rsa.h"
 #include "pkc/dsa.h"
 #include "ecc/ecdsa.h"
+#include "ecc/eddsa.h"
 #include "pkc/dh.h"
 #include "ecc/ecdh.h"
 #include "aead/gcm.h"
@@ -157,6 +158,14 @@ struct _TlsContext;
    #error TLS_TICKET_LIFETIME parameter is not valid
 #endif
 
+//Session tickets for TLS 1.2 and earlier versions (RFC 5077)
+#if (TLS_TICKET_SUPPORT == ENABLED && TLS_SESSION_RESUME_SUPPORT == ENABLED && \
+   TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   #define TLS12_TICKET_SUPPORT ENABLED
+#else
+   #define TLS12_TICKET_SUPPORT DISABLED
+#endif
+
 //SNI (Server Name Indication) extension
 #ifndef TLS_SNI_SUPPORT
    #define TLS_SNI_SUPPORT ENABLED
@@ -199,6 +208,223 @@ struct _TlsContext;
    #error TLS_CLIENT_HELLO_PADDING_SUPPORT parameter is not valid
 #endif
 
+//Pre-encoded ClientHello templates
+#ifndef TLS_CLIENT_HELLO_TEMPLATE_SUPPORT
+   #define TLS_CLIENT_HELLO_TEMPLATE_SUPPORT ENABLED
+#elif (TLS_CLIENT_HELLO_TEMPLATE_SUPPORT != ENABLED && TLS_CLIENT_HELLO_TEMPLATE_SUPPORT != DISABLED)
+   #error TLS_CLIENT_HELLO_TEMPLATE_SUPPORT parameter is not valid
+#endif
+
+//Coalescing of the server handshake flights
+#ifndef TLS_FLIGHT_COALESCING_SUPPORT
+   #define TLS_FLIGHT_COALESCING_SUPPORT ENABLED
+#elif (TLS_FLIGHT_COALESCING_SUPPORT != ENABLED && TLS_FLIGHT_COALESCING_SUPPORT != DISABLED)
+   #error TLS_FLIGHT_COALESCING_SUPPORT parameter is not valid
+#endif
+
+//Dynamic record sizing
+#ifndef TLS_DYNAMIC_RECORD_SIZING_SUPPORT
+   #define TLS_DYNAMIC_RECORD_SIZING_SUPPORT ENABLED
+#elif (TLS_DYNAMIC_RECORD_SIZING_SUPPORT != ENABLED && TLS_DYNAMIC_RECORD_SIZING_SUPPORT != DISABLED)
+   #error TLS_DYNAMIC_RECORD_SIZING_SUPPORT parameter is not valid
+#endif
+
+//Handshake latency tracing
+#ifndef TLS_HANDSHAKE_TRACE_SUPPORT
+   #define TLS_HANDSHAKE_TRACE_SUPPORT DISABLED
+#elif (TLS_HANDSHAKE_TRACE_SUPPORT != ENABLED && TLS_HANDSHAKE_TRACE_SUPPORT != DISABLED)
+   #error TLS_HANDSHAKE_TRACE_SUPPORT parameter is not valid
+#endif
+
+//Concurrent tlsRead and tlsWrite calls on a single context
+#ifndef TLS_FULL_DUPLEX_SUPPORT
+   #define TLS_FULL_DUPLEX_SUPPORT DISABLED
+#elif (TLS_FULL_DUPLEX_SUPPORT != ENABLED && TLS_FULL_DUPLEX_SUPPORT != DISABLED)
+   #error TLS_FULL_DUPLEX_SUPPORT parameter is not valid
+#endif
+
+//Statistics
+#ifndef TLS_STATS_SUPPORT
+   #define TLS_STATS_SUPPORT DISABLED
+#elif (TLS_STATS_SUPPORT != ENABLED && TLS_STATS_SUPPORT != DISABLED)
+   #error TLS_STATS_SUPPORT parameter is not valid
+#endif
+
+//Number of shards of the global statistics
+#ifndef TLS_STATS_NUM_SHARDS
+   #define TLS_STATS_NUM_SHARDS 4
+#elif (TLS_STATS_NUM_SHARDS < 1)
+   #error TLS_STATS_NUM_SHARDS parameter is not valid
+#endif
+
+//Number of cipher suites tracked by the global statistics
+#ifndef TLS_STATS_MAX_CIPHER_SUITES
+   #define TLS_STATS_MAX_CIPHER_SUITES 16
+#elif (TLS_STATS_MAX_CIPHER_SUITES < 1)
+   #error TLS_STATS_MAX_CIPHER_SUITES parameter is not valid
+#endif
+
+//Number of named groups tracked by the global statistics
+#ifndef TLS_STATS_MAX_GROUPS
+   #define TLS_STATS_MAX_GROUPS 8
+#elif (TLS_STATS_MAX_GROUPS < 1)
+   #error TLS_STATS_MAX_GROUPS parameter is not valid
+#endif
+
+//Per-handshake accounting of allocations and crypto operations
+#ifndef TLS_HANDSHAKE_ACCOUNTING_SUPPORT
+   #define TLS_HANDSHAKE_ACCOUNTING_SUPPORT DISABLED
+#elif (TLS_HANDSHAKE_ACCOUNTING_SUPPORT != ENABLED && TLS_HANDSHAKE_ACCOUNTING_SUPPORT != DISABLED)
+   #error TLS_HANDSHAKE_ACCOUNTING_SUPPORT parameter is not valid
+#elif (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED && TLS_STATS_SUPPORT != ENABLED)
+   #error TLS_HANDSHAKE_ACCOUNTING_SUPPORT requires TLS_STATS_SUPPORT
+#endif
+
+//Thread-local storage class specifier (handshake accounting)
+#ifndef TLS_THREAD_LOCAL
+   #define TLS_THREAD_LOCAL _Thread_local
+#endif
+
+//Certificate compression (RFC 8879)
+#ifndef TLS_CERT_COMPRESSION_SUPPORT
+   #define TLS_CERT_COMPRESSION_SUPPORT DISABLED
+#elif (TLS_CERT_COMPRESSION_SUPPORT != ENABLED && TLS_CERT_COMPRESSION_SUPPORT != DISABLED)
+   #error TLS_CERT_COMPRESSION_SUPPORT parameter is not valid
+#endif
+
+//Maximum number of certificate compression algorithms
+#ifndef TLS_MAX_CERT_COMPRESSION_ALGOS
+   #define TLS_MAX_CERT_COMPRESSION_ALGOS 3
+#elif (TLS_MAX_CERT_COMPRESSION_ALGOS < 1)
+   #error TLS_MAX_CERT_COMPRESSION_ALGOS parameter is not valid
+#endif
+
+//Cache of verified certificate signatures
+#ifndef TLS_CERT_VERIFY_CACHE_SUPPORT
+   #define TLS_CERT_VERIFY_CACHE_SUPPORT DISABLED
+#elif (TLS_CERT_VERIFY_CACHE_SUPPORT != ENABLED && TLS_CERT_VERIFY_CACHE_SUPPORT != DISABLED)
+   #error TLS_CERT_VERIFY_CACHE_SUPPORT parameter is not valid
+#endif
+
+//Lifetime of certificate verification cache entries
+#ifndef TLS_CERT_VERIFY_CACHE_LIFETIME
+   #define TLS_CERT_VERIFY_CACHE_LIFETIME 3600000
+#elif (TLS_CERT_VERIFY_CACHE_LIFETIME < 1000)
+   #error TLS_CERT_VERIFY_CACHE_LIFETIME parameter is not valid
+#endif
+
+//Parallel verification of the peer certificate chain
+#ifndef TLS_VERIFY_POOL_SUPPORT
+   #define TLS_VERIFY_POOL_SUPPORT DISABLED
+#elif (TLS_VERIFY_POOL_SUPPORT != ENABLED && TLS_VERIFY_POOL_SUPPORT != DISABLED)
+   #error TLS_VERIFY_POOL_SUPPORT parameter is not valid
+#endif
+
+//Handshake executor running the handshake steps on worker threads
+#ifndef TLS_HANDSHAKE_EXECUTOR_SUPPORT
+   #define TLS_HANDSHAKE_EXECUTOR_SUPPORT DISABLED
+#elif (TLS_HANDSHAKE_EXECUTOR_SUPPORT != ENABLED && TLS_HANDSHAKE_EXECUTOR_SUPPORT != DISABLED)
+   #error TLS_HANDSHAKE_EXECUTOR_SUPPORT parameter is not valid
+#endif
+
+//OCSP stapling support
+#ifndef TLS_OCSP_STAPLING_SUPPORT
+   #define TLS_OCSP_STAPLING_SUPPORT DISABLED
+#elif (TLS_OCSP_STAPLING_SUPPORT != ENABLED && TLS_OCSP_STAPLING_SUPPORT != DISABLED)
+   #error TLS_OCSP_STAPLING_SUPPORT parameter is not valid
+#endif
+
+//Maximum size of a stapled OCSP response
+#ifndef TLS_OCSP_MAX_RESPONSE_SIZE
+   #define TLS_OCSP_MAX_RESPONSE_SIZE 4096
+#elif (TLS_OCSP_MAX_RESPONSE_SIZE < 1)
+   #error TLS_OCSP_MAX_RESPONSE_SIZE parameter is not valid
+#endif
+
+//Time before expiry at which OCSP responses are refreshed
+#ifndef TLS_OCSP_REFRESH_MARGIN
+   #define TLS_OCSP_REFRESH_MARGIN 3600000
+#elif (TLS_OCSP_REFRESH_MARGIN < 1000)
+   #error TLS_OCSP_REFRESH_MARGIN parameter is not valid
+#endif
+
+//TLS False Start support (client side)
+#ifndef TLS_FALSE_START_SUPPORT
+   #define TLS_FALSE_START_SUPPORT DISABLED
+#elif (TLS_FALSE_START_SUPPORT != ENABLED && TLS_FALSE_START_SUPPORT != DISABLED)
+   #error TLS_FALSE_START_SUPPORT parameter is not valid
+#endif
+
+//TCP Fast Open integration (client side)
+#ifndef TLS_FAST_OPEN_SUPPORT
+   #define TLS_FAST_OPEN_SUPPORT DISABLED
+#elif (TLS_FAST_OPEN_SUPPORT != ENABLED && TLS_FAST_OPEN_SUPPORT != DISABLED)
+   #error TLS_FAST_OPEN_SUPPORT parameter is not valid
+#endif
+
+//Export and import of established connections
+#ifndef TLS_CONNECTION_EXPORT_SUPPORT
+   #define TLS_CONNECTION_EXPORT_SUPPORT DISABLED
+#elif (TLS_CONNECTION_EXPORT_SUPPORT != ENABLED && TLS_CONNECTION_EXPORT_SUPPORT != DISABLED)
+   #error TLS_CONNECTION_EXPORT_SUPPORT parameter is not valid
+#endif
+
+//Completion-based transport interface
+#ifndef TLS_COMPLETION_IO_SUPPORT
+   #define TLS_COMPLETION_IO_SUPPORT DISABLED
+#elif (TLS_COMPLETION_IO_SUPPORT != ENABLED && TLS_COMPLETION_IO_SUPPORT != DISABLED)
+   #error TLS_COMPLETION_IO_SUPPORT parameter is not valid
+#endif
+
+//Minimum size of the DH modulus for False Start
+#ifndef TLS_FALSE_START_MIN_DH_MODULUS_SIZE
+   #define TLS_FALSE_START_MIN_DH_MODULUS_SIZE 2048
+#elif (TLS_FALSE_START_MIN_DH_MODULUS_SIZE < 1024)
+   #error TLS_FALSE_START_MIN_DH_MODULUS_SIZE parameter is not valid
+#endif
+
+//Minimum size of the EC field for False Start
+#ifndef TLS_FALSE_START_MIN_EC_FIELD_SIZE
+   #define TLS_FALSE_START_MIN_EC_FIELD_SIZE 255
+#elif (TLS_FALSE_START_MIN_EC_FIELD_SIZE < 160)
+   #error TLS_FALSE_START_MIN_EC_FIELD_SIZE parameter is not valid
+#endif
+
+//SNI-indexed certificate store
+#ifndef TLS_CERT_STORE_SUPPORT
+   #define TLS_CERT_STORE_SUPPORT DISABLED
+#elif (TLS_CERT_STORE_SUPPORT != ENABLED && TLS_CERT_STORE_SUPPORT != DISABLED)
+   #error TLS_CERT_STORE_SUPPORT parameter is not valid
+#endif
+
+//Number of entries per set of the certificate store
+#ifndef TLS_CERT_STORE_WAYS
+   #define TLS_CERT_STORE_WAYS 4
+#elif (TLS_CERT_STORE_WAYS < 1)
+   #error TLS_CERT_STORE_WAYS parameter is not valid
+#endif
+
+//Maximum number of credentials per name in the certificate store
+#ifndef TLS_CERT_STORE_MAX_CREDENTIALS
+   #define TLS_CERT_STORE_MAX_CREDENTIALS 3
+#elif (TLS_CERT_STORE_MAX_CREDENTIALS < 1)
+   #error TLS_CERT_STORE_MAX_CREDENTIALS parameter is not valid
+#endif
+
+//Incremental parsing of Certificate messages
+#ifndef TLS_CERT_STREAM_SUPPORT
+   #define TLS_CERT_STREAM_SUPPORT DISABLED
+#elif (TLS_CERT_STREAM_SUPPORT != ENABLED && TLS_CERT_STREAM_SUPPORT != DISABLED)
+   #error TLS_CERT_STREAM_SUPPORT parameter is not valid
+#endif
+
+//Maximum size of a certificate received by the incremental parser
+#ifndef TLS_CERT_STREAM_MAX_CERT_SIZE
+   #define TLS_CERT_STREAM_MAX_CERT_SIZE 16384
+#elif (TLS_CERT_STREAM_MAX_CERT_SIZE < 256)
+   #error TLS_CERT_STREAM_MAX_CERT_SIZE parameter is not valid
+#endif
+
 //Signature Algorithms Certificate extension
 #ifndef TLS_SIGN_ALGOS_CERT_SUPPORT
    #define TLS_SIGN_ALGOS_CERT_SUPPORT DISABLED
@@ -234,6 +460,55 @@ struct _TlsContext;
    #error TLS_ECC_CALLBACK_SUPPORT parameter is not valid
 #endif
 
+//Asynchronous private key operations
+#ifndef TLS_ASYNC_SIGN_SUPPORT
+   #define TLS_ASYNC_SIGN_SUPPORT DISABLED
+#elif (TLS_ASYNC_SIGN_SUPPORT != ENABLED && TLS_ASYNC_SIGN_SUPPORT != DISABLED)
+   #error TLS_ASYNC_SIGN_SUPPORT parameter is not valid
+#endif
+
+//Pluggable crypto providers
+#ifndef TLS_CRYPTO_PROVIDER_SUPPORT
+   #define TLS_CRYPTO_PROVIDER_SUPPORT DISABLED
+#elif (TLS_CRYPTO_PROVIDER_SUPPORT != ENABLED && TLS_CRYPTO_PROVIDER_SUPPORT != DISABLED)
+   #error TLS_CRYPTO_PROVIDER_SUPPORT parameter is not valid
+#endif
+
+//Maximum number of crypto providers (global registry or per context)
+#ifndef TLS_MAX_CRYPTO_PROVIDERS
+   #define TLS_MAX_CRYPTO_PROVIDERS 4
+#elif (TLS_MAX_CRYPTO_PROVIDERS < 1)
+   #error TLS_MAX_CRYPTO_PROVIDERS parameter is not valid
+#endif
+
+//Precompiled cipher suite negotiation table
+#ifndef TLS_CIPHER_SUITE_TABLE_SUPPORT
+   #define TLS_CIPHER_SUITE_TABLE_SUPPORT ENABLED
+#elif (TLS_CIPHER_SUITE_TABLE_SUPPORT != ENABLED && TLS_CIPHER_SUITE_TABLE_SUPPORT != DISABLED)
+   #error TLS_CIPHER_SUITE_TABLE_SUPPORT parameter is not valid
+#endif
+
+//Size of the log holding the handshake messages not yet digested with SHA-1
+#ifndef TLS_TRANSCRIPT_LOG_SIZE
+   #define TLS_TRANSCRIPT_LOG_SIZE 8192
+#elif (TLS_TRANSCRIPT_LOG_SIZE < 0)
+   #error TLS_TRANSCRIPT_LOG_SIZE parameter is not valid
+#endif
+
+//Size of the hash table used to detect duplicate extensions and key shares
+#ifndef TLS_TYPE_SET_HASH_SIZE
+   #define TLS_TYPE_SET_HASH_SIZE 32
+#elif (TLS_TYPE_SET_HASH_SIZE < 1)
+   #error TLS_TYPE_SET_HASH_SIZE parameter is not valid
+#endif
+
+//Maximum number of named groups managed by a key pair pool
+#ifndef TLS_KEY_PAIR_POOL_MAX_GROUPS
+   #define TLS_KEY_PAIR_POOL_MAX_GROUPS 4
+#elif (TLS_KEY_PAIR_POOL_MAX_GROUPS < 1)
+   #error TLS_KEY_PAIR_POOL_MAX_GROUPS parameter is not valid
+#endif
+
 //Maximum number of certificates the end entity can load
 #ifndef TLS_MAX_CERTIFICATES
    #define TLS_MAX_CERTIFICATES 3
@@ -374,6 +649,27 @@ struct _TlsContext;
    #error TLS_CBC_CIPHER_SUPPORT parameter is not valid
 #endif
 
+//Fused CBC decryption and MAC verification
+#ifndef TLS_CBC_FUSED_DECRYPTION_SUPPORT
+   #define TLS_CBC_FUSED_DECRYPTION_SUPPORT DISABLED
+#elif (TLS_CBC_FUSED_DECRYPTION_SUPPORT != ENABLED && TLS_CBC_FUSED_DECRYPTION_SUPPORT != DISABLED)
+   #error TLS_CBC_FUSED_DECRYPTION_SUPPORT parameter is not valid
+#endif
+
+//Number of bytes decrypted per pass by the fused CBC decryption path
+#ifndef TLS_CBC_DECRYPTION_CHUNK_SIZE
+   #define TLS_CBC_DECRYPTION_CHUNK_SIZE 512
+#elif (TLS_CBC_DECRYPTION_CHUNK_SIZE < 64 || (TLS_CBC_DECRYPTION_CHUNK_SIZE % 16) != 0)
+   #error TLS_CBC_DECRYPTION_CHUNK_SIZE parameter is not valid
+#endif
+
+//Explicit nonces and IVs derived from the record sequence number
+#ifndef TLS_SEQUENCE_NUMBER_NONCE_SUPPORT
+   #define TLS_SEQUENCE_NUMBER_NONCE_SUPPORT ENABLED
+#elif (TLS_SEQUENCE_NUMBER_NONCE_SUPPORT != ENABLED && TLS_SEQUENCE_NUMBER_NONCE_SUPPORT != DISABLED)
+   #error TLS_SEQUENCE_NUMBER_NONCE_SUPPORT parameter is not valid
+#endif
+
 //CCM AEAD support
 #ifndef TLS_CCM_CIPHER_SUPPORT
    #define TLS_CCM_CIPHER_SUPPORT DISABLED
@@ -668,6 +964,50 @@ struct _TlsContext;
    #error TLS_KEY_LOG_SUPPORT parameter is not valid
 #endif
 
+//Memory pools for short-lived objects
+#ifndef TLS_MEM_POOL_SUPPORT
+   #define TLS_MEM_POOL_SUPPORT DISABLED
+#elif (TLS_MEM_POOL_SUPPORT != ENABLED && TLS_MEM_POOL_SUPPORT != DISABLED)
+   #error TLS_MEM_POOL_SUPPORT parameter is not valid
+#endif
+
+//Default number of idle objects kept in each memory pool
+#ifndef TLS_MEM_POOL_MAX_FREE_OBJECTS
+   #define TLS_MEM_POOL_MAX_FREE_OBJECTS 64
+#elif (TLS_MEM_POOL_MAX_FREE_OBJECTS < 0)
+   #error TLS_MEM_POOL_MAX_FREE_OBJECTS parameter is not valid
+#endif
+
+//Per-handshake arena allocator
+#ifndef TLS_HANDSHAKE_ARENA_SUPPORT
+   #define TLS_HANDSHAKE_ARENA_SUPPORT DISABLED
+#elif (TLS_HANDSHAKE_ARENA_SUPPORT != ENABLED && TLS_HANDSHAKE_ARENA_SUPPORT != DISABLED)
+   #error TLS_HANDSHAKE_ARENA_SUPPORT parameter is not valid
+#endif
+
+//Default size of the per-handshake arena
+#ifndef TLS_HANDSHAKE_ARENA_SIZE
+   #define TLS_HANDSHAKE_ARENA_SIZE 8192
+#elif (TLS_HANDSHAKE_ARENA_SIZE < 0)
+   #error TLS_HANDSHAKE_ARENA_SIZE parameter is not valid
+#endif
+
+//Static operating mode (caller-supplied memory)
+#ifndef TLS_STATIC_MEM_SUPPORT
+   #define TLS_STATIC_MEM_SUPPORT DISABLED
+#elif (TLS_STATIC_MEM_SUPPORT != ENABLED && TLS_STATIC_MEM_SUPPORT != DISABLED)
+   #error TLS_STATIC_MEM_SUPPORT parameter is not valid
+#elif (TLS_STATIC_MEM_SUPPORT == ENABLED && TLS_HANDSHAKE_ARENA_SUPPORT != ENABLED)
+   #error TLS_STATIC_MEM_SUPPORT requires TLS_HANDSHAKE_ARENA_SUPPORT
+#endif
+
+//Size reserved for the cipher context of each encryption engine (static mode)
+#ifndef TLS_STATIC_CIPHER_CONTEXT_SIZE
+   #define TLS_STATIC_CIPHER_CONTEXT_SIZE 1024
+#elif (TLS_STATIC_CIPHER_CONTEXT_SIZE < 1)
+   #error TLS_STATIC_CIPHER_CONTEXT_SIZE parameter is not valid
+#endif
+
 //Maximum acceptable length for server names
 #ifndef TLS_MAX_SERVER_NAME_LEN
    #define TLS_MAX_SERVER_NAME_LEN 255
@@ -754,7 +1094,11 @@ struct _TlsContext;
 
 //Memory allocation
 #ifndef tlsAllocMem
-   #define tlsAllocMem(size) osAllocMem(size)
+   #if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+      #define tlsAllocMem(size) tlsStatsAllocMem(size)
+   #else
+      #define tlsAllocMem(size) osAllocMem(size)
+   #endif
 #endif
 
 //Memory deallocation
@@ -762,6 +1106,41 @@ struct _TlsContext;
    #define tlsFreeMem(p) osFreeMem(p)
 #endif
 
+//Allocation of short-lived objects
+#ifndef tlsAllocObject
+   #if (TLS_MEM_POOL_SUPPORT == ENABLED)
+      #define tlsAllocObject(objClass, size) tlsMemPoolAlloc(objClass, size)
+   #else
+      #define tlsAllocObject(objClass, size) tlsAllocMem(size)
+   #endif
+#endif
+
+//Deallocation of short-lived objects
+#ifndef tlsFreeObject
+   #if (TLS_MEM_POOL_SUPPORT == ENABLED)
+      #define tlsFreeObject(objClass, p) tlsMemPoolFree(objClass, p)
+   #else
+      #define tlsFreeObject(objClass, p) tlsFreeMem(p)
+   #endif
+#endif
+
+//Allocation of handshake-scoped objects
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+   #define tlsAllocHandshakeObject(context, objClass, size) \
+      tlsArenaAllocObject(context, objClass, size)
+   #define tlsFreeHandshakeObject(context, objClass, p) \
+      tlsArenaFreeObject(context, objClass, p)
+   #define tlsAllocHandshakeMem(context, size) tlsArenaAllocMem(context, size)
+   #define tlsFreeHandshakeMem(context, p) tlsArenaFreeMem(context, p)
+#else
+   #define tlsAllocHandshakeObject(context, objClass, size) \
+      tlsAllocObject(objClass, size)
+   #define tlsFreeHandshakeObject(context, objClass, p) \
+      tlsFreeObject(objClass, p)
+   #define tlsAllocHandshakeMem(context, size) tlsAllocMem(size)
+   #define tlsFreeHandshakeMem(context, p) tlsFreeMem(p)
+#endif
+
 //Support for Diffie-Hellman?
 #if ((TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2) && \
    (TLS_DH_ANON_KE_SUPPORT == ENABLED || TLS_DHE_RSA_KE_SUPPORT == ENABLED || \
@@ -830,10 +1209,54 @@ struct _TlsContext;
 #define TLS_MAX_RECORD_LENGTH 16384
 //Data overhead caused by record encryption
 #define TLS_MAX_RECORD_OVERHEAD 512
+//Maximum size of a record header (DTLS)
+#define TLS_MAX_RECORD_HEADER_SIZE 13
+//Round a size up to the alignment of arena and static allocations
+#define TLS_ARENA_ALIGN(n) (((n) + 7) & ~((size_t) 7))
+
+//Size of the memory block required by tlsInitStatic()
+#define TLS_STATIC_MEM_SIZE(txBufferSize, rxBufferSize, arenaSize) \
+   (TLS_ARENA_ALIGN(sizeof(TlsContext)) + \
+   TLS_STATIC_BUFFER_SIZE(txBufferSize) + \
+   TLS_STATIC_BUFFER_SIZE(rxBufferSize) + \
+   TLS_ARENA_ALIGN(sizeof(TlsHandshakeContext)) + TLS_ARENA_ALIGN(arenaSize) + \
+   TLS_ARENA_ALIGN(TLS_STATIC_NUM_ENGINES * sizeof(TlsStaticEngineMem)))
+
+//Size of a TX or RX buffer placed in caller-supplied memory
+#define TLS_STATIC_BUFFER_SIZE(n) \
+   TLS_ARENA_ALIGN((n) + TLS_MAX_RECORD_HEADER_SIZE + TLS_MAX_RECORD_OVERHEAD)
+
+//Number of encryption engines placed in caller-supplied memory
+#if (DTLS_SUPPORT == ENABLED)
+   #define TLS_STATIC_NUM_ENGINES 3
+#else
+   #define TLS_STATIC_NUM_ENGINES 2
+#endif
+
 //Size of client and server random values
 #define TLS_RANDOM_SIZE 32
 //Master secret size
 #define TLS_MASTER_SECRET_SIZE 48
+//Maximum size of EdDSA private and public keys (Ed448)
+#define TLS_MAX_EDDSA_KEY_LEN 57
+//Number of length buckets of a compiled ALPN protocol list
+#define TLS_ALPN_NUM_BUCKETS 16
+//Maximum size of a serialized session state (external session cache)
+#define TLS_MAX_SERIALIZED_SESSION_SIZE (88 + TLS_MAX_SERVER_NAME_LEN)
+//Version of the session state export format
+#define TLS_SESSION_EXPORT_FORMAT 1
+//Size of the fixed part of an exported session state
+#define TLS_SESSION_EXPORT_HEADER_SIZE 81
+//Exported session uses the extended master secret
+#define TLS_SESSION_EXPORT_FLAG_EMS 0x01
+//Version of the connection state export format
+#define TLS_CONNECTION_EXPORT_FORMAT 1
+//Size of the fixed part of an exported connection state
+#define TLS_CONNECTION_EXPORT_HEADER_SIZE 464
+//Flags of an exported connection state
+#define TLS_CONNECTION_EXPORT_FLAG_SECURE_RENEGO     0x01
+#define TLS_CONNECTION_EXPORT_FLAG_MAX_FRAG_LEN      0x02
+#define TLS_CONNECTION_EXPORT_FLAG_RECORD_SIZE_LIMIT 0x04
 
 //C++ guard
 #ifdef __cplusplus
@@ -898,7 +1321,9 @@ typedef enum
    TLS_FLAG_BREAK_CRLF = 0x100A,
    TLS_FLAG_WAIT_ACK   = 0x2000,
    TLS_FLAG_NO_DELAY   = 0x4000,
-   TLS_FLAG_DELAY      = 0x8000
+   TLS_FLAG_DELAY      = 0x8000,
+   TLS_FLAG_FAST_OPEN  = 0x10000,
+   TLS_FLAG_CORK       = 0x20000
 } TlsFlags;
 
 
@@ -907,6 +1332,20 @@ typedef enum
 #define TLS_FLAG_BREAK(c) (TLS_FLAG_BREAK_CHAR | LSB(c))
 
 
+/**
+ * @brief Events a non-blocking handshake is waiting for
+ **/
+
+typedef enum
+{
+   TLS_WAIT_NONE  = 0x00, ///<The handshake is complete
+   TLS_WAIT_READ  = 0x01, ///<The socket must become readable
+   TLS_WAIT_WRITE = 0x02, ///<The socket must become writable
+   TLS_WAIT_TIMER = 0x04, ///<The retransmission timer must expire (DTLS)
+   TLS_WAIT_ASYNC = 0x08  ///<An asynchronous operation must complete
+} TlsWaitEvent;
+
+
 /**
  * @brief Content type
  **/
@@ -919,6 +1358,7 @@ typedef enum
    TLS_TYPE_HANDSHAKE          = 22,
    TLS_TYPE_APPLICATION_DATA   = 23,
    TLS_TYPE_HEARTBEAT          = 24,
+   TLS_TYPE_TLS12_CID          = 25, //RFC 9146
    TLS_TYPE_ACK                = 25  //RFC draft
 } TlsContentType;
 
@@ -948,6 +1388,7 @@ typedef enum
    TLS_TYPE_CERTIFICATE_STATUS   = 22,
    TLS_TYPE_SUPPLEMENTAL_DATA    = 23,
    TLS_TYPE_KEY_UPDATE           = 24,
+   TLS_TYPE_COMPRESSED_CERTIFICATE = 25,
    TLS_TYPE_MESSAGE_HASH         = 254
 } TlsMessageType;
 
@@ -1085,6 +1526,30 @@ typedef enum
 } TlsCertificateType;
 
 
+/**
+ * @brief Certificate status types
+ **/
+
+typedef enum
+{
+   TLS_CERT_STATUS_TYPE_OCSP       = 1,
+   TLS_CERT_STATUS_TYPE_OCSP_MULTI = 2
+} TlsCertStatusType;
+
+
+/**
+ * @brief Certificate compression algorithms
+ **/
+
+typedef enum
+{
+   TLS_CERT_COMPRESSION_NONE   = 0,
+   TLS_CERT_COMPRESSION_ZLIB   = 1,
+   TLS_CERT_COMPRESSION_BROTLI = 2,
+   TLS_CERT_COMPRESSION_ZSTD   = 3
+} TlsCertCompressionAlgo;
+
+
 /**
  * @brief Hash algorithms
  **/
@@ -1159,6 +1624,7 @@ typedef enum
    TLS_EXT_ENCRYPT_THEN_MAC          = 22,
    TLS_EXT_EXTENDED_MASTER_SECRET    = 23,
    TLS_EXT_CACHED_INFO               = 25,
+   TLS_EXT_COMPRESS_CERTIFICATE      = 27,
    TLS_EXT_RECORD_SIZE_LIMIT         = 28,
    TLS_EXT_SESSION_TICKET            = 35,
    TLS_EXT_PRE_SHARED_KEY            = 41,
@@ -1171,6 +1637,7 @@ typedef enum
    TLS_EXT_POST_HANDSHAKE_AUTH       = 49,
    TLS_EXT_SIGNATURE_ALGORITHMS_CERT = 50,
    TLS_EXT_KEY_SHARE                 = 51,
+   TLS_EXT_CONNECTION_ID             = 54,
    TLS_EXT_RENEGOTIATION_INFO        = 65281
 } TlsExtensionType;
 
@@ -1298,30 +1765,89 @@ typedef enum
    TLS_STATE_HANDSHAKE_TRAFFIC_KEYS      = 9,
    TLS_STATE_ENCRYPTED_EXTENSIONS        = 10,
    TLS_STATE_SERVER_CERTIFICATE          = 11,
-   TLS_STATE_SERVER_KEY_EXCHANGE         = 12,
-   TLS_STATE_SERVER_CERTIFICATE_VERIFY   = 13,
-   TLS_STATE_CERTIFICATE_REQUEST         = 14,
-   TLS_STATE_SERVER_HELLO_DONE           = 15,
-   TLS_STATE_CLIENT_CERTIFICATE          = 16,
-   TLS_STATE_CLIENT_KEY_EXCHANGE         = 17,
-   TLS_STATE_CLIENT_CERTIFICATE_VERIFY   = 18,
-   TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC   = 19,
-   TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC_2 = 20,
-   TLS_STATE_CLIENT_FINISHED             = 21,
-   TLS_STATE_CLIENT_APP_TRAFFIC_KEYS     = 22,
-   TLS_STATE_SERVER_CHANGE_CIPHER_SPEC   = 23,
-   TLS_STATE_SERVER_CHANGE_CIPHER_SPEC_2 = 24,
-   TLS_STATE_SERVER_FINISHED             = 25,
-   TLS_STATE_END_OF_EARLY_DATA           = 26,
-   TLS_STATE_SERVER_APP_TRAFFIC_KEYS     = 27,
-   TLS_STATE_NEW_SESSION_TICKET          = 28,
-   TLS_STATE_KEY_UPDATE                  = 29,
-   TLS_STATE_APPLICATION_DATA            = 30,
-   TLS_STATE_CLOSING                     = 31,
-   TLS_STATE_CLOSED                      = 32
+   TLS_STATE_SERVER_CERTIFICATE_STATUS   = 12,
+   TLS_STATE_SERVER_KEY_EXCHANGE         = 13,
+   TLS_STATE_SERVER_CERTIFICATE_VERIFY   = 14,
+   TLS_STATE_CERTIFICATE_REQUEST         = 15,
+   TLS_STATE_SERVER_HELLO_DONE           = 16,
+   TLS_STATE_CLIENT_CERTIFICATE          = 17,
+   TLS_STATE_CLIENT_KEY_EXCHANGE         = 18,
+   TLS_STATE_CLIENT_CERTIFICATE_VERIFY   = 19,
+   TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC   = 20,
+   TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC_2 = 21,
+   TLS_STATE_CLIENT_FINISHED             = 22,
+   TLS_STATE_CLIENT_APP_TRAFFIC_KEYS     = 23,
+   TLS_STATE_SERVER_CHANGE_CIPHER_SPEC   = 24,
+   TLS_STATE_SERVER_CHANGE_CIPHER_SPEC_2 = 25,
+   TLS_STATE_SERVER_FINISHED             = 26,
+   TLS_STATE_END_OF_EARLY_DATA           = 27,
+   TLS_STATE_SERVER_APP_TRAFFIC_KEYS     = 28,
+   TLS_STATE_NEW_SESSION_TICKET          = 29,
+   TLS_STATE_KEY_UPDATE                  = 30,
+   TLS_STATE_APPLICATION_DATA            = 31,
+   TLS_STATE_CLOSING                     = 32,
+   TLS_STATE_CLOSED                      = 33
 } TlsState;
 
 
+/**
+ * @brief Handshake trace events
+ **/
+
+typedef enum
+{
+   TLS_TRACE_EVENT_STATE_CHANGE          = 0,
+   TLS_TRACE_EVENT_SIGN_START            = 1,
+   TLS_TRACE_EVENT_SIGN_END              = 2,
+   TLS_TRACE_EVENT_VERIFY_START          = 3,
+   TLS_TRACE_EVENT_VERIFY_END            = 4,
+   TLS_TRACE_EVENT_CERT_PARSING_START    = 5,
+   TLS_TRACE_EVENT_CERT_PARSING_END      = 6,
+   TLS_TRACE_EVENT_KEY_EXCHANGE_START    = 7,
+   TLS_TRACE_EVENT_KEY_EXCHANGE_END      = 8,
+   TLS_TRACE_EVENT_CACHE_LOOKUP_START    = 9,
+   TLS_TRACE_EVENT_CACHE_LOOKUP_END      = 10,
+   TLS_TRACE_EVENT_TICKET_DECRYPT_START  = 11,
+   TLS_TRACE_EVENT_TICKET_DECRYPT_END    = 12
+} TlsTraceEvent;
+
+
+/**
+ * @brief Asynchronous signature state
+ **/
+
+typedef enum
+{
+   TLS_ASYNC_SIGN_STATE_IDLE    = 0,
+   TLS_ASYNC_SIGN_STATE_PENDING = 1,
+   TLS_ASYNC_SIGN_STATE_DONE    = 2
+} TlsAsyncSignState;
+
+
+/**
+ * @brief State of a handshake step handed to the executor
+ **/
+
+typedef enum
+{
+   TLS_EXECUTOR_STATE_IDLE    = 0,
+   TLS_EXECUTOR_STATE_QUEUED  = 1,
+   TLS_EXECUTOR_STATE_RUNNING = 2
+} TlsExecutorState;
+
+
+/**
+ * @brief External session cache lookup state
+ **/
+
+typedef enum
+{
+   TLS_EXT_CACHE_STATE_IDLE    = 0,
+   TLS_EXT_CACHE_STATE_PENDING = 1,
+   TLS_EXT_CACHE_STATE_DONE    = 2
+} TlsExtCacheState;
+
+
 //CodeWarrior or Win32 compiler?
 #if defined(__CWCC__) || defined(_WIN32)
    #pragma pack(push, 1)
@@ -1393,6 +1919,30 @@ typedef __start_packed struct
 } __end_packed TlsCertificateList;
 
 
+/**
+ * @brief List of certificate compression algorithms
+ **/
+
+typedef __start_packed struct
+{
+   uint8_t length;     //0
+   uint16_t value[];   //1
+} __end_packed TlsCertCompressionAlgos;
+
+
+/**
+ * @brief CompressedCertificate message
+ **/
+
+typedef __start_packed struct
+{
+   uint16_t algorithm;            //0-1
+   uint8_t uncompressedLength[3]; //2-4
+   uint8_t length[3];             //5-7
+   uint8_t value[];               //8
+} __end_packed TlsCompressedCertificate;
+
+
 /**
  * @brief List of certificate authorities
  **/
@@ -1683,6 +2233,56 @@ typedef void TlsCertificateVerify;
 typedef void TlsFinished;
 
 
+/**
+ * @brief NewSessionTicket message (TLS 1.2)
+ **/
+
+typedef __start_packed struct
+{
+   uint32_t ticketLifetimeHint; //0-3
+   uint16_t ticketLen;          //4-5
+   uint8_t ticket[];            //6
+} __end_packed TlsNewSessionTicket;
+
+
+/**
+ * @brief Session state carried by a session ticket (TLS 1.2)
+ **/
+
+typedef __start_packed struct
+{
+   uint16_t version;                    ///<Protocol version
+   uint16_t cipherSuite;                ///<Cipher suite identifier
+   systime_t ticketTimestamp;           ///<Timestamp to manage ticket lifetime
+   uint32_t ticketLifetime;             ///<Lifetime of the ticket
+   uint8_t extendedMasterSecret;        ///<Extended master secret computation
+   uint8_t secret[48];                  ///<Master secret
+} __end_packed TlsTicketState;
+
+
+/**
+ * @brief CertificateStatusRequest structure
+ **/
+
+typedef __start_packed struct
+{
+   uint8_t statusType; //0
+   uint8_t request[];  //1
+} __end_packed TlsCertStatusRequest;
+
+
+/**
+ * @brief CertificateStatus message
+ **/
+
+typedef __start_packed struct
+{
+   uint8_t statusType;     //0
+   uint8_t responseLen[3]; //1-3
+   uint8_t response[];     //4
+} __end_packed TlsCertificateStatus;
+
+
 /**
  * @brief ChangeCipherSpec message
  **/
@@ -1733,6 +2333,52 @@ typedef error_t (*TlsSocketReceiveCallback)(TlsSocketHandle handle,
    void *data, size_t size, size_t *received, uint_t flags);
 
 
+/**
+ * @brief Socket send file callback function
+ **/
+
+typedef error_t (*TlsSocketSendFileCallback)(TlsSocketHandle handle,
+   void *file, uint64_t offset, size_t length, size_t *written);
+
+
+/**
+ * @brief Socket submit send callback function (completion-based transport)
+ **/
+
+typedef error_t (*TlsSocketSubmitSendCallback)(TlsSocketHandle handle,
+   const void *data, size_t length, uint_t flags);
+
+
+/**
+ * @brief Socket submit receive callback function (completion-based transport)
+ **/
+
+typedef error_t (*TlsSocketSubmitReceiveCallback)(TlsSocketHandle handle,
+   void *data, size_t size, uint_t flags);
+
+
+/**
+ * @brief I/O request posted to a completion-based transport
+ **/
+
+typedef struct
+{
+   bool_t posted;    ///<The request has been handed to the transport
+   bool_t completed; ///<The transport has reported the completion of the request
+   size_t length;    ///<Number of bytes requested
+   size_t count;     ///<Number of bytes actually transferred
+   error_t status;   ///<Completion status
+} TlsIoRequest;
+
+
+/**
+ * @brief File read callback function
+ **/
+
+typedef error_t (*TlsFileReadCallback)(void *file, uint64_t offset,
+   uint8_t *data, size_t size, size_t *length);
+
+
 /**
  * @brief Pre-shared key callback function
  **/
@@ -1757,6 +2403,14 @@ typedef error_t (*TlsRpkVerifyCallback)(TlsContext *context,
    const uint8_t *rawPublicKey, size_t rawPublicKeyLen);
 
 
+/**
+ * @brief Stapled OCSP response callback function
+ **/
+
+typedef error_t (*TlsOcspResponseCallback)(TlsContext *context,
+   const uint8_t *response, size_t length, void *param);
+
+
 /**
  * @brief Ticket encryption callback function
  **/
@@ -1775,6 +2429,49 @@ typedef error_t (*TlsTicketDecryptCallback)(TlsContext *context,
    size_t *plaintextLen, void *param);
 
 
+/**
+ * @brief Certificate compression callback function
+ **/
+
+typedef error_t (*TlsCertCompressCallback)(TlsContext *context,
+   const uint8_t *input, size_t inputLen, uint8_t *output, size_t outputSize,
+   size_t *outputLen, void *param);
+
+
+/**
+ * @brief Certificate decompression callback function
+ **/
+
+typedef error_t (*TlsCertDecompressCallback)(TlsContext *context,
+   const uint8_t *input, size_t inputLen, uint8_t *output, size_t outputSize,
+   size_t *outputLen, void *param);
+
+
+/**
+ * @brief External session cache lookup callback function
+ **/
+
+typedef error_t (*TlsExtCacheGetCallback)(TlsContext *context,
+   const uint8_t *sessionId, size_t sessionIdLen, void *param);
+
+
+/**
+ * @brief External session cache insertion callback function
+ **/
+
+typedef error_t (*TlsExtCachePutCallback)(TlsContext *context,
+   const uint8_t *sessionId, size_t sessionIdLen, const uint8_t *data,
+   size_t length, void *param);
+
+
+/**
+ * @brief External session cache removal callback function
+ **/
+
+typedef error_t (*TlsExtCacheDeleteCallback)(TlsContext *context,
+   const uint8_t *sessionId, size_t sessionIdLen, void *param);
+
+
 /**
  * @brief ECDH key agreement callback function
  **/
@@ -1806,12 +2503,29 @@ typedef void (*TlsKeyLogCallback)(TlsContext *context, const char_t *key);
 
 
 /**
- * @brief Structure describing a cipher suite
+ * @brief Handshake trace callback function
  **/
 
-typedef struct
-{
-   uint16_t identifier;
+typedef void (*TlsHandshakeTraceCallback)(TlsContext *context,
+   TlsTraceEvent event, TlsState state, systime_t timestamp, void *param);
+
+
+/**
+ * @brief Asynchronous signature generation callback function
+ **/
+
+typedef error_t (*TlsAsyncSignCallback)(TlsContext *context,
+   TlsSignatureAlgo signAlgo, TlsHashAlgo hashAlgo, const uint8_t *data,
+   size_t length, void *param);
+
+
+/**
+ * @brief Structure describing a cipher suite
+ **/
+
+typedef struct
+{
+   uint16_t identifier;
    const char_t *name;
    TlsKeyExchMethod keyExchMethod;
    const CipherAlgo *cipherAlgo;
@@ -1828,46 +2542,772 @@ typedef struct
 
 
 /**
- * @brief TLS session state
+ * @brief Cipher suite negotiation table
+ **/
+
+typedef struct _TlsCipherSuiteTable TlsCipherSuiteTable;
+
+
+/**
+ * @brief Crypto provider
+ **/
+
+typedef struct _TlsCryptoProvider TlsCryptoProvider;
+
+
+/**
+ * @brief Traffic keys exported for record layer offload
+ **/
+
+typedef struct
+{
+   uint16_t version;              ///<Negotiated TLS version
+   uint16_t cipherSuite;          ///<Negotiated cipher suite
+   CipherMode cipherMode;         ///<Cipher mode of operation
+   const uint8_t *key;            ///<Traffic key
+   size_t keyLen;                 ///<Length of the traffic key
+   const uint8_t *iv;             ///<Implicit part of the nonce (salt or static IV)
+   size_t ivLen;                  ///<Length of the implicit part of the nonce
+   size_t authTagLen;             ///<Length of the authentication tag
+   TlsSequenceNumber seqNum;      ///<Sequence number of the next record
+} TlsOffloadKeys;
+
+
+/**
+ * @brief Record layer offload callback
+ **/
+
+typedef error_t (*TlsOffloadCallback)(TlsContext *context,
+   TlsSocketHandle handle, const TlsOffloadKeys *txKeys,
+   const TlsOffloadKeys *rxKeys, void *param);
+
+
+/**
+ * @brief Protocol of a compiled ALPN list
+ **/
+
+typedef struct
+{
+   uint16_t offset; ///<Offset of the protocol name in the pre-encoded list
+   uint8_t length;  ///<Length of the protocol name
+   uint8_t next;    ///<Next protocol of the same length bucket (1-based index, 0 if none)
+} TlsAlpnProtocol;
+
+
+/**
+ * @brief Compiled ALPN protocol list
+ **/
+
+typedef struct
+{
+   char_t *protocolList;                  ///<Comma-delimited list of protocols
+   uint_t numProtocols;                   ///<Number of protocols
+   TlsAlpnProtocol *protocols;            ///<Protocols, in descending order of preference
+   uint8_t buckets[TLS_ALPN_NUM_BUCKETS]; ///<First protocol of each length bucket (1-based index, 0 if none)
+   size_t encodedLen;                     ///<Length of the pre-encoded ProtocolNameList
+   uint8_t *encoded;                      ///<Pre-encoded ProtocolNameList
+} TlsAlpnList;
+
+
+/**
+ * @brief TLS session state
+ **/
+
+typedef struct
+{
+   uint16_t version;            ///<TLS protocol version
+   uint16_t cipherSuite;        ///<Cipher suite identifier
+   systime_t timestamp;         ///<Time stamp to manage entry lifetime
+   uint8_t secret[48];          ///<Master secret (TLS 1.2) or ticket PSK (TLS 1.3)
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   uint8_t sessionId[32];       ///<Session identifier
+   size_t sessionIdLen;         ///<Length of the session identifier
+   bool_t extendedMasterSecret; ///<Extended master secret computation
+#endif
+#if ((TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3) || \
+   TLS12_TICKET_SUPPORT == ENABLED)
+   uint8_t *ticket;             ///<Session ticket
+   size_t ticketLen;            ///<Length of the session ticket
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   systime_t ticketTimestamp;   ///<Timestamp to manage ticket lifetime
+   uint32_t ticketLifetime;     ///<Lifetime of the ticket
+   uint32_t ticketAgeAdd;       ///<Random value used to obscure the age of the ticket
+   TlsHashAlgo ticketHashAlgo;  ///<Hash algorithm associated with the ticket
+   char_t *ticketAlpn;          ///<ALPN protocol associated with the ticket
+   uint32_t maxEarlyDataSize;   ///<Maximum amount of 0-RTT data that the client is allowed to send
+#endif
+#if (TLS_SNI_SUPPORT == ENABLED)
+   char_t *serverName;          ///<ServerName extension
+#endif
+} TlsSessionState;
+
+
+/**
+ * @brief Session cache shard
+ **/
+
+typedef struct
+{
+   OsMutex mutex;    ///<Mutex preventing simultaneous access to the shard
+   uint_t first;     ///<Index of the first cache entry owned by the shard
+   uint_t size;      ///<Number of cache entries owned by the shard
+   uint_t freeList;  ///<Index of the first free entry
+   uint_t victim;    ///<CLOCK hand (next candidate for eviction)
+   uint_t *buckets;  ///<Hash buckets (index of the first entry of each chain)
+} TlsCacheShard;
+
+
+/**
+ * @brief Session cache entry
+ *
+ * The session state is stored inline, in its serialized form, so that
+ * inserting a session does not require any memory allocation
+ *
+ **/
+
+typedef struct
+{
+   systime_t timestamp;      ///<Time stamp to manage entry lifetime
+   uint16_t length;          ///<Length of the serialized session state (0 if the entry is free)
+   uint8_t referenced;       ///<CLOCK reference bit
+   uint8_t data[TLS_MAX_SERIALIZED_SESSION_SIZE]; ///<Serialized session state
+} TlsCacheEntry;
+
+
+/**
+ * @brief Session cache
+ **/
+
+typedef struct
+{
+   uint_t size;                ///<Maximum number of entries
+   uint_t numShards;           ///<Number of independently locked shards
+   uint_t numBuckets;          ///<Number of hash buckets per shard
+   systime_t lifetime;         ///<Lifetime of cache entries
+   TlsCacheShard *shards;      ///<Cache shards
+   uint_t *next;               ///<Next entry in the hash chain or in the free list
+   TlsCacheEntry entries[];    ///<Cache entries
+} TlsCache;
+
+
+/**
+ * @brief Client-side session store entry
+ **/
+
+typedef struct
+{
+   uint32_t hash;           ///<Hash of the (server name, port, ALPN) key
+   uint16_t port;           ///<Port number of the server
+   char_t *serverName;      ///<Fully qualified DNS hostname of the server
+   char_t *protocolList;    ///<List of ALPN protocols offered by the client
+   TlsSessionState session; ///<Session ID (TLS 1.2) or single-use ticket (TLS 1.3)
+} TlsSessionStoreEntry;
+
+
+/**
+ * @brief Named group selected by a server
+ **/
+
+typedef struct
+{
+   uint32_t hash;        ///<Hash of the (server name, port) key
+   systime_t timestamp;  ///<Time at which the server selected the group
+   uint16_t namedGroup;  ///<Named group selected by the server (TLS_GROUP_NONE if the hint is free)
+} TlsGroupHint;
+
+
+/**
+ * @brief Client-side session store
+ **/
+
+typedef struct
+{
+   OsMutex mutex;                   ///<Mutex preventing simultaneous access to the store
+   uint_t size;                     ///<Maximum number of entries
+   uint_t maxTickets;               ///<Maximum number of TLS 1.3 tickets kept per server
+   systime_t maxAge;                ///<Maximum age of an entry
+   uint_t hitCount;                 ///<Number of handshakes that offered a stored session
+   uint_t missCount;                ///<Number of handshakes that found no stored session
+   TlsGroupHint *groupHints;        ///<Named groups selected by the servers (one hint per entry)
+   TlsSessionStoreEntry entries[];  ///<Store entries
+} TlsSessionStore;
+
+
+/**
+ * @brief 0-RTT anti-replay shard
+ **/
+
+typedef struct
+{
+   OsMutex mutex;       ///<Mutex preventing simultaneous access to the shard
+   systime_t timestamp; ///<Start of the current time window
+   uint8_t *current;    ///<Bloom filter for the current time window
+   uint8_t *previous;   ///<Bloom filter for the previous time window
+   uint_t replayCount;  ///<Number of replayed ClientHello messages detected
+} TlsAntiReplayShard;
+
+
+/**
+ * @brief 0-RTT anti-replay store (rotating Bloom filters)
+ **/
+
+typedef struct
+{
+   uint_t numShards;           ///<Number of independently locked shards
+   size_t filterSize;          ///<Size of each Bloom filter, in bytes
+   systime_t window;           ///<Duration of a time window
+   TlsAntiReplayShard *shards; ///<Shards
+} TlsAntiReplay;
+
+
+/**
+ * @brief Peer address (DTLS listener)
+ *
+ * Opaque to the library. The listener socket fixes the local address, the
+ * local port and the transport protocol, so the peer address and port
+ * complete the 5-tuple
+ **/
+
+typedef struct
+{
+   size_t length;                          ///<Length of the address, in bytes
+   uint8_t value[DTLS_MAX_PEER_ADDR_SIZE]; ///<Address and port of the peer
+} DtlsPeerAddr;
+
+
+/**
+ * @brief Datagram descriptor (batched datagram I/O)
+ **/
+
+typedef struct
+{
+   void *data;            ///<Pointer to the datagram
+   size_t size;           ///<Size of the buffer (receive only)
+   size_t length;         ///<Length of the datagram
+   DtlsPeerAddr *peerAddr; ///<Address of the peer (NULL for a connected socket)
+} DtlsDatagram;
+
+
+/**
+ * @brief Socket send batch callback function (sendmmsg)
+ **/
+
+typedef error_t (*TlsSocketSendBatchCallback)(TlsSocketHandle handle,
+   const DtlsDatagram *datagrams, uint_t count, uint_t *sent, uint_t flags);
+
+
+/**
+ * @brief DTLS listener
+ **/
+
+typedef struct _DtlsListener DtlsListener;
+
+
+/**
+ * @brief Retransmission timer wheel
+ **/
+
+typedef struct _DtlsTimerWheel DtlsTimerWheel;
+
+
+/**
+ * @brief Listener send callback function (sendto)
+ **/
+
+typedef error_t (*DtlsListenerSendCallback)(TlsSocketHandle handle,
+   const void *data, size_t length, const DtlsPeerAddr *peerAddr);
+
+
+/**
+ * @brief Listener receive callback function (recvfrom)
+ **/
+
+typedef error_t (*DtlsListenerReceiveCallback)(TlsSocketHandle handle,
+   void *data, size_t size, size_t *received, DtlsPeerAddr *peerAddr,
+   uint_t flags);
+
+
+/**
+ * @brief Listener send batch callback function (sendmmsg)
+ **/
+
+typedef error_t (*DtlsListenerSendBatchCallback)(TlsSocketHandle handle,
+   const DtlsDatagram *datagrams, uint_t count, uint_t *sent);
+
+
+/**
+ * @brief Listener receive batch callback function (recvmmsg)
+ **/
+
+typedef error_t (*DtlsListenerReceiveBatchCallback)(TlsSocketHandle handle,
+   DtlsDatagram *datagrams, uint_t count, uint_t *received, uint_t flags);
+
+
+/**
+ * @brief Listener accept callback function
+ **/
+
+typedef TlsContext *(*DtlsListenerAcceptCallback)(DtlsListener *listener,
+   const DtlsPeerAddr *peerAddr, void *param);
+
+
+/**
+ * @brief DTLS listener (many DTLS sessions on a single UDP socket)
+ **/
+
+struct _DtlsListener
+{
+   OsMutex mutex;                                     ///<Mutex preventing simultaneous access to the listener
+   TlsSocketHandle socketHandle;                      ///<Handle of the shared UDP socket
+   DtlsListenerSendCallback sendCallback;             ///<Send callback function
+   DtlsListenerReceiveCallback receiveCallback;       ///<Receive callback function
+   DtlsCookieGenerateCallback cookieGenerateCallback; ///<Cookie generation callback function
+   DtlsCookieVerifyCallback cookieVerifyCallback;     ///<Cookie verification callback function
+   void *cookieParam;                                 ///<Opaque pointer passed to the cookie callbacks
+   DtlsListenerAcceptCallback acceptCallback;         ///<Callback creating the context of a new peer
+   void *acceptParam;                                 ///<Opaque pointer passed to the accept callback
+   uint_t numBuckets;                                 ///<Size of the hash table (power of two)
+   TlsContext **buckets;                              ///<Hash table keyed by peer address
+   size_t cidLen;                                     ///<Length of the CIDs assigned to the peers (0 if none)
+   TlsContext **cidBuckets;                           ///<Hash table keyed by connection ID
+   uint_t numContexts;                                ///<Number of bound contexts
+   TlsContext *pendingContext;                        ///<Context the waiting datagram belongs to
+   uint8_t *buffer;                                   ///<Datagrams received from unknown peers
+   size_t bufferSize;                                 ///<Size of the buffer
+   size_t bufferLen;                                  ///<Length of the ClientHello awaiting delivery
+   DtlsListenerSendBatchCallback sendBatchCallback;   ///<Send batch callback function
+   DtlsListenerReceiveBatchCallback receiveBatchCallback; ///<Receive batch callback function
+   uint_t batchSize;                                  ///<Maximum number of datagrams per batch
+   DtlsDatagram *rxBatch;                             ///<Datagrams received in the last batch
+   uint_t rxBatchCount;                               ///<Number of datagrams in the last batch
+   uint_t rxBatchPos;                                 ///<Next datagram to be dispatched
+   uint_t helloVerifyCount;                           ///<Number of HelloVerifyRequest messages sent
+   uint_t dropCount;                                  ///<Number of datagrams dropped
+};
+
+
+/**
+ * @brief Retransmission timer wheel (shared by many DTLS contexts)
+ **/
+
+struct _DtlsTimerWheel
+{
+   OsMutex mutex;                           ///<Mutex preventing simultaneous access to the timer wheel
+   systime_t resolution;                    ///<Duration of a tick, in milliseconds
+   systime_t tickTime;                      ///<Time at which the current tick started
+   uint32_t currentTick;                    ///<Current tick
+   uint_t numTimers;                        ///<Number of armed timers
+   TlsContext *slots[DTLS_TIMER_WHEEL_LEVELS][DTLS_TIMER_WHEEL_SLOTS]; ///<Timers, per level and slot
+   TlsContext *expired;                     ///<Timers that have expired
+};
+
+
+/**
+ * @brief Certificate compression codec
+ **/
+
+typedef struct
+{
+   TlsCertCompressionAlgo algorithm;             ///<Compression algorithm
+   TlsCertCompressCallback compressCallback;     ///<Compression callback function
+   TlsCertDecompressCallback decompressCallback; ///<Decompression callback function
+   void *param;                                  ///<Opaque pointer passed to the callback functions
+} TlsCertCompressionCodec;
+
+
+/**
+ * @brief Compressed Certificate message (cached per credential)
+ **/
+
+typedef struct _TlsCompressedCert TlsCompressedCert;
+
+struct _TlsCompressedCert
+{
+   TlsCompressedCert *next;          ///<Next entry
+   TlsCertCompressionAlgo algorithm; ///<Compression algorithm
+   size_t length;                    ///<Length of the CompressedCertificate message (zero if not worthwhile)
+   uint8_t message[];                ///<CompressedCertificate message
+};
+
+
+/**
+ * @brief Credential (pre-parsed certificate chain and private key)
+ **/
+
+typedef struct
+{
+   OsMutex mutex;                  ///<Mutex protecting the reference counter
+   uint_t refCount;                ///<Reference counter
+   uint8_t *certList;              ///<Certificate chain (TLS wire format)
+   size_t certListLen;             ///<Length of the certificate chain
+   const uint8_t *rawPublicKey;    ///<Raw public key of the end entity certificate
+   size_t rawPublicKeyLen;         ///<Length of the raw public key
+   bool_t hasPrivateKey;           ///<The private key is available
+   TlsCertificateType type;        ///<End entity certificate type
+   TlsSignatureAlgo signAlgo;      ///<Signature algorithm used to sign the end entity certificate
+   TlsHashAlgo hashAlgo;           ///<Hash algorithm used to sign the end entity certificate
+   TlsNamedGroup namedCurve;       ///<Named curve used to generate the EC public key
+#if (TLS_RSA_SUPPORT == ENABLED)
+   RsaPrivateKey rsaPrivateKey;    ///<RSA private key
+#endif
+#if (TLS_DSA_SIGN_SUPPORT == ENABLED)
+   DsaPrivateKey dsaPrivateKey;    ///<DSA private key
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+   EcDomainParameters ecParams;    ///<EC domain parameters
+   Mpi ecPrivateKey;               ///<EC private key
+#endif
+#if (TLS_EDDSA_SIGN_SUPPORT == ENABLED)
+   EddsaPrivateKey eddsaPrivateKey; ///<EdDSA private key
+   uint8_t eddsaSecretKey[TLS_MAX_EDDSA_KEY_LEN]; ///<EdDSA private key (octet string)
+   uint8_t eddsaPublicKey[TLS_MAX_EDDSA_KEY_LEN]; ///<EdDSA public key derived from the private key
+   size_t eddsaKeyLen;             ///<Length of the precomputed EdDSA keys (0 if not available)
+#endif
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   TlsCompressedCert *compressedCerts; ///<Compressed forms of the Certificate message
+#endif
+} TlsCredential;
+
+
+/**
+ * @brief Trusted CA certificate
+ **/
+
+typedef struct
+{
+   X509CertificateInfo certInfo; ///<Pre-parsed CA certificate
+   uint_t nextBySubject;         ///<Next entry with the same subject name hash
+   uint_t nextByKeyId;           ///<Next entry with the same subject key identifier hash
+} TlsTrustedCa;
+
+
+/**
+ * @brief Trusted CA store (pre-decoded and indexed)
+ **/
+
+typedef struct
+{
+   OsMutex mutex;             ///<Mutex protecting the reference counter
+   uint_t refCount;           ///<Reference counter
+   uint8_t *derCerts;         ///<DER-encoded CA certificates
+   size_t derCertsLen;        ///<Total length of the DER-encoded CA certificates
+   uint8_t *certAuthorities;  ///<Distinguished names of the CAs (CertificateRequest format)
+   size_t certAuthoritiesLen; ///<Length of the list of distinguished names
+   uint_t numBuckets;         ///<Number of hash buckets
+   uint_t *subjectBuckets;    ///<Index by subject name
+   uint_t *keyIdBuckets;      ///<Index by subject key identifier
+   uint_t numCerts;           ///<Number of trusted CA certificates
+   TlsTrustedCa cas[];        ///<Trusted CA certificates
+} TlsTrustStore;
+
+
+/**
+ * @brief Certificate verification cache entry
+ **/
+
+typedef struct
+{
+   bool_t valid;              ///<Valid entry
+   uint8_t certDigest[32];    ///<Digest of the verified certificate
+   uint8_t issuerDigest[32];  ///<Digest of the issuer certificate
+   uint_t pathLen;            ///<Certificate path length
+   systime_t timestamp;       ///<Time at which the entry was created
+   uint32_t notBefore;        ///<Start of the common validity period (Unix time)
+   uint32_t notAfter;         ///<End of the common validity period (Unix time)
+} TlsCertVerifyCacheEntry;
+
+
+/**
+ * @brief Certificate verification cache
+ **/
+
+typedef struct
+{
+   OsMutex mutex;                      ///<Mutex preventing simultaneous access to the cache
+   uint_t size;                        ///<Maximum number of entries
+   uint_t victim;                      ///<Index of the next entry to be evicted
+   TlsCertVerifyCacheEntry entries[];  ///<Cache entries
+} TlsCertVerifyCache;
+
+
+/**
+ * @brief Completion callback of the handshake executor
+ **/
+
+typedef void (*TlsHandshakeStepCallback)(TlsContext *context, error_t error,
+   uint_t events, systime_t timeout, void *param);
+
+
+/**
+ * @brief Worker of the handshake executor
+ **/
+
+typedef struct
+{
+   OsMutex mutex;             ///<Mutex preventing simultaneous access to the queue
+   OsEvent event;             ///<Event signaling that handshake steps are queued
+   TlsContext **queue;        ///<Circular queue of pending handshake steps
+   uint_t head;               ///<Index of the oldest pending step
+   uint_t count;              ///<Number of pending steps
+   bool_t busy;               ///<The worker is running a handshake step
+   uint_t stepCount;          ///<Handshake steps run by the worker
+   uint_t stealCount;         ///<Handshake steps taken from another worker
+} TlsHandshakeWorker;
+
+
+/**
+ * @brief Handshake executor shared by several TLS contexts
+ **/
+
+typedef struct
+{
+   OsMutex mutex;             ///<Mutex protecting the submission index and the executor state of the contexts
+   uint_t numWorkers;         ///<Number of workers
+   uint_t queueSize;          ///<Capacity of the queue of each worker
+   uint_t nextWorker;         ///<Worker the next step is queued to
+   TlsHandshakeStepCallback callback; ///<Completion callback
+   void *param;               ///<Opaque pointer passed to the completion callback
+   TlsHandshakeWorker workers[]; ///<Workers
+} TlsHandshakeExecutor;
+
+
+/**
+ * @brief OCSP response fetch callback
+ **/
+
+typedef error_t (*TlsOcspFetchCallback)(const void *certId,
+   uint8_t *response, size_t *length, size_t maxLength, systime_t *lifetime,
+   void *param);
+
+
+/**
+ * @brief Stapled OCSP response
+ **/
+
+typedef struct
+{
+   uint_t refCount;   ///<Number of references to the response
+   systime_t expiry;  ///<Time at which the response expires
+   size_t length;     ///<Length of the DER-encoded OCSP response
+   uint8_t data[];    ///<DER-encoded OCSP response
+} TlsOcspResponse;
+
+
+/**
+ * @brief OCSP response cache entry
+ **/
+
+typedef struct
+{
+   const void *certId;        ///<Certificate chain or credential
+   TlsOcspResponse *response; ///<Current OCSP response
+   bool_t refreshing;         ///<A refresh is in progress
+} TlsOcspCacheEntry;
+
+
+/**
+ * @brief OCSP response cache
+ **/
+
+typedef struct
+{
+   OsMutex mutex;                      ///<Mutex preventing simultaneous access to the cache
+   TlsOcspFetchCallback fetchCallback; ///<OCSP response fetch callback
+   void *fetchParam;                   ///<Opaque pointer passed to the fetch callback
+   uint_t size;                        ///<Maximum number of entries
+   TlsOcspCacheEntry entries[];        ///<Cache entries
+} TlsOcspCache;
+
+
+/**
+ * @brief Certificate store load callback
+ **/
+
+typedef error_t (*TlsCertStoreLoadCallback)(const char_t *name,
+   TlsCredential **credentials, uint_t *numCredentials, void *param);
+
+
+/**
+ * @brief Certificate store entry
+ **/
+
+typedef struct
+{
+   bool_t valid;                ///<Valid entry
+   bool_t pinned;               ///<Entry added explicitly (never evicted)
+   uint32_t hash;               ///<Hash of the name
+   systime_t timestamp;         ///<Time at which the entry was last used
+   char_t name[TLS_MAX_SERVER_NAME_LEN + 1]; ///<Host name or wildcard name
+   TlsCredential *credentials[TLS_CERT_STORE_MAX_CREDENTIALS]; ///<Credentials associated with the name
+   uint_t numCredentials;       ///<Number of credentials (0 for an unknown name)
+} TlsCertStoreEntry;
+
+
+/**
+ * @brief SNI-indexed certificate store
+ **/
+
+typedef struct
+{
+   OsMutex mutex;                         ///<Mutex preventing simultaneous access to the store
+   uint_t numSets;                        ///<Number of sets
+   systime_t idleTimeout;                 ///<Time after which an unused entry is evicted
+   TlsCertStoreLoadCallback loadCallback; ///<Callback that loads the credentials for a name
+   void *loadParam;                       ///<Opaque pointer passed to the load callback
+   TlsCertStoreEntry entries[];           ///<Store entries
+} TlsCertStore;
+
+
+/**
+ * @brief Session resumption type
+ **/
+
+typedef enum
+{
+   TLS_RESUMPTION_NONE       = 0, ///<Full handshake
+   TLS_RESUMPTION_SESSION_ID = 1, ///<Session resumed using a session ID
+   TLS_RESUMPTION_TICKET     = 2, ///<Session resumed using a session ticket
+   TLS_RESUMPTION_PSK        = 3  ///<PSK-based handshake (TLS 1.3)
+} TlsResumptionType;
+
+
+/**
+ * @brief Handshake type (accounting breakdown)
+ **/
+
+typedef enum
+{
+   TLS_HANDSHAKE_TYPE_FULL    = 0, ///<Full handshake
+   TLS_HANDSHAKE_TYPE_RESUMED = 1, ///<Session resumed using a session ID or a ticket
+   TLS_HANDSHAKE_TYPE_PSK     = 2, ///<PSK-based handshake (TLS 1.3)
+   TLS_HANDSHAKE_TYPE_HRR     = 3  ///<Handshake that required a HelloRetryRequest
+} TlsHandshakeType;
+
+
+/**
+ * @brief Resources used by a handshake
  **/
 
 typedef struct
 {
-   uint16_t version;            ///<TLS protocol version
-   uint16_t cipherSuite;        ///<Cipher suite identifier
-   systime_t timestamp;         ///<Time stamp to manage entry lifetime
-   uint8_t secret[48];          ///<Master secret (TLS 1.2) or ticket PSK (TLS 1.3)
-#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
-   uint8_t sessionId[32];       ///<Session identifier
-   size_t sessionIdLen;         ///<Length of the session identifier
-   bool_t extendedMasterSecret; ///<Extended master secret computation
+   uint32_t allocCount;   ///<Number of tlsAllocMem calls
+   uint64_t allocBytes;   ///<Number of bytes requested from tlsAllocMem
+   uint32_t hashOps;      ///<Transcript hash updates and digests
+   uint32_t hmacOps;      ///<PRF, HKDF and HMAC computations
+   uint32_t publicKeyOps; ///<Signatures, signature verifications and key exchange operations
+   uint32_t pemImports;   ///<Calls to the pemImport functions
+   uint32_t x509Parses;   ///<Calls to the x509Parse functions
+} TlsHandshakeCounters;
+
+
+/**
+ * @brief Signature check queued to the verification worker pool
+ **/
+
+typedef struct _TlsVerifyJob
+{
+   struct _TlsVerifyJob *next;         ///<Next job in the queue of the pool
+   struct _TlsVerifyJob *batchNext;    ///<Next job of the same chain
+   struct _TlsVerifyBatch *batch;      ///<Chain the job belongs to
+   X509CertificateInfo certInfo;       ///<Certificate to be verified
+   X509CertificateInfo issuerCertInfo; ///<Issuer certificate
+   uint_t pathLen;                     ///<Certificate path length
+   bool_t done;                        ///<The signature check has completed
+   error_t status;                     ///<Result of the signature check
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   TlsHandshakeCounters counters;      ///<Resources used by the signature check
 #endif
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
-   uint8_t *ticket;             ///<Session ticket
-   size_t ticketLen;            ///<Length of the session ticket
-   systime_t ticketTimestamp;   ///<Timestamp to manage ticket lifetime
-   uint32_t ticketLifetime;     ///<Lifetime of the ticket
-   uint32_t ticketAgeAdd;       ///<Random value used to obscure the age of the ticket
-   TlsHashAlgo ticketHashAlgo;  ///<Hash algorithm associated with the ticket
-   char_t *ticketAlpn;          ///<ALPN protocol associated with the ticket
-   uint32_t maxEarlyDataSize;   ///<Maximum amount of 0-RTT data that the client is allowed to send
+} TlsVerifyJob;
+
+
+/**
+ * @brief Verification worker pool shared by several TLS contexts
+ **/
+
+typedef struct
+{
+   OsMutex mutex;             ///<Mutex preventing simultaneous access to the pool
+   OsEvent event;             ///<Event signaling that jobs are queued
+   TlsVerifyJob *queue;       ///<Jobs waiting for a worker thread
+   uint_t jobCount;           ///<Signature checks run by the worker threads
+   uint_t inlineCount;        ///<Signature checks run by the handshake threads
+} TlsVerifyPool;
+
+
+/**
+ * @brief Signature checks of a certificate chain
+ **/
+
+typedef struct _TlsVerifyBatch
+{
+   TlsVerifyPool *pool;       ///<Verification worker pool
+   TlsCertVerifyCache *cache; ///<Cache of verified certificate signatures
+   OsEvent event;             ///<Event signaling the completion of a job
+   TlsVerifyJob *jobs;        ///<Jobs of the chain, in chain order
+   uint_t numPending;         ///<Number of jobs that have not completed yet
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   TlsHandshakeCounters *counters; ///<Counters of the handshake that parses the chain
 #endif
-#if (TLS_SNI_SUPPORT == ENABLED)
-   char_t *serverName;          ///<ServerName extension
+} TlsVerifyBatch;
+
+
+/**
+ * @brief Per-context statistics
+ **/
+
+typedef struct
+{
+   uint64_t recordsOut;                ///<Number of records sent
+   uint64_t bytesOut;                  ///<Number of bytes sent (protected records)
+   uint64_t recordsIn;                 ///<Number of records received
+   uint64_t bytesIn;                   ///<Number of bytes received (protected records)
+   systime_t handshakeStart;           ///<Time at which the handshake started
+   systime_t handshakeDuration;        ///<Duration of the last handshake, in milliseconds
+   TlsResumptionType resumptionType;   ///<Resumption type of the last handshake
+   bool_t helloRetry;                  ///<The last handshake required a HelloRetryRequest
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   TlsHandshakeCounters handshakeCounters; ///<Resources used by the last handshake
 #endif
-} TlsSessionState;
+} TlsContextStats;
 
 
 /**
- * @brief Session cache
+ * @brief Counter keyed by a 16-bit identifier
  **/
 
 typedef struct
 {
-   OsMutex mutex;              ///<Mutex preventing simultaneous access to the cache
-   uint_t size;                ///<Maximum number of entries
-   TlsSessionState sessions[]; ///<Cache entries
-} TlsCache;
+   uint16_t id;    ///<Cipher suite or named group
+   uint32_t count; ///<Number of occurrences
+} TlsStatsEntry;
+
+
+/**
+ * @brief Global statistics (one instance per shard)
+ **/
+
+typedef struct
+{
+   uint32_t handshakes;                ///<Number of successful handshakes
+   uint32_t handshakesByVersion[5];    ///<Handshakes by version (SSL 3.0 to TLS 1.3)
+   uint32_t handshakesByResumption[4]; ///<Handshakes by resumption type
+   TlsStatsEntry handshakesByCipherSuite[TLS_STATS_MAX_CIPHER_SUITES]; ///<Handshakes by cipher suite
+   uint32_t otherCipherSuites;         ///<Handshakes with a cipher suite that could not be tracked
+   TlsStatsEntry handshakesByGroup[TLS_STATS_MAX_GROUPS]; ///<Handshakes by named group
+   uint32_t otherGroups;               ///<Handshakes with a named group that could not be tracked
+   uint32_t cacheHits;                 ///<Session cache hits
+   uint32_t cacheMisses;               ///<Session cache misses
+   uint32_t ticketDecryptSuccesses;    ///<Session tickets successfully decrypted
+   uint32_t ticketDecryptFailures;     ///<Session tickets that could not be decrypted
+   uint32_t alertsSent[256];           ///<Alerts sent, by description
+   uint32_t alertsReceived[256];       ///<Alerts received, by description
+   uint32_t dtlsRetransmissions;       ///<DTLS flight retransmissions
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   uint32_t handshakesByType[4];       ///<Handshakes by handshake type
+   TlsHandshakeCounters countersByType[4]; ///<Resources used by the handshakes, by handshake type
+#endif
+} TlsGlobalStats;
 
 
 /**
@@ -1880,6 +3320,7 @@ typedef struct
    size_t certChainLen;       ///<Length of the certificate chain
    const char_t *privateKey;  ///<Private key (PEM format)
    size_t privateKeyLen;      ///<Length of the private key
+   TlsCredential *credential; ///<Pre-parsed certificate chain and private key
    TlsCertificateType type;   ///<End entity certificate type
    TlsSignatureAlgo signAlgo; ///<Signature algorithm used to sign the end entity certificate
    TlsHashAlgo hashAlgo;      ///<Hash algorithm used to sign the end entity certificate
@@ -1887,6 +3328,370 @@ typedef struct
 } TlsCertDesc;
 
 
+/**
+ * @brief Data segment (scatter/gather I/O)
+ **/
+
+typedef struct
+{
+   const void *data; ///<Pointer to the data segment
+   size_t length;    ///<Length of the data segment
+} TlsIoVec;
+
+
+/**
+ * @brief Classes of short-lived objects
+ **/
+
+typedef enum
+{
+   TLS_MEM_CLASS_CERT_INFO      = 0, ///<X509CertificateInfo structures
+   TLS_MEM_CLASS_DER_CERT       = 1, ///<DER-encoded certificates
+   TLS_MEM_CLASS_CIPHER_CONTEXT = 2, ///<Cipher contexts
+   TLS_MEM_CLASS_GCM_CONTEXT    = 3, ///<GCM contexts
+   TLS_MEM_CLASS_HMAC_CONTEXT   = 4, ///<HMAC contexts
+   TLS_MEM_CLASS_HASH_CONTEXT   = 5, ///<Hash contexts
+   TLS_MEM_CLASS_TICKET         = 6, ///<Session tickets
+   TLS_MEM_CLASS_COUNT          = 7
+} TlsMemClass;
+
+
+/**
+ * @brief Memory pool statistics
+ **/
+
+typedef struct
+{
+   size_t slotSize;       ///<Size of the slots handed out by the pool
+   size_t maxRequestSize; ///<Largest size requested so far
+   uint_t allocCount;     ///<Total number of allocations
+   uint_t freeCount;      ///<Total number of deallocations
+   uint_t hitCount;       ///<Allocations served from the list of idle objects
+   uint_t missCount;      ///<Allocations that required a call to the memory allocator
+   uint_t inUse;          ///<Number of objects currently allocated
+   uint_t peakInUse;      ///<Highest number of objects allocated at the same time
+   uint_t numFreeObjects; ///<Number of idle objects kept in the pool
+} TlsMemPoolStats;
+
+
+/**
+ * @brief Pool of TX/RX buffers shared by several TLS contexts
+ **/
+
+typedef struct
+{
+   OsMutex mutex;            ///<Mutex preventing simultaneous access to the pool
+   size_t bufferSize;        ///<Size of the buffers managed by the pool
+   uint_t maxFreeBuffers;    ///<Maximum number of idle buffers kept in the pool
+   uint_t numFreeBuffers;    ///<Number of idle buffers currently in the pool
+   void *freeList;           ///<List of idle buffers
+   uint8_t *region;          ///<Contiguous region holding the registered buffers
+   uint_t numBuffers;        ///<Number of buffers in the region
+} TlsBufferPool;
+
+
+/**
+ * @brief Pre-generated ephemeral key pair
+ **/
+
+typedef struct _TlsKeyPair
+{
+   struct _TlsKeyPair *next; ///<Next key pair in the list
+   Mpi privateKey;           ///<Private key (ECDHE) or private value (FFDHE)
+   EcPoint publicKey;        ///<Public key (ECDHE)
+   Mpi publicValue;          ///<Public value (FFDHE)
+} TlsKeyPair;
+
+
+/**
+ * @brief Key pairs pre-generated for a given named group
+ **/
+
+typedef struct
+{
+   uint16_t namedGroup;      ///<Named group
+   uint_t lowWatermark;      ///<The group is refilled when it falls below this level
+   uint_t highWatermark;     ///<Number of key pairs the group is refilled to
+   uint_t numKeyPairs;       ///<Number of key pairs currently available
+   TlsKeyPair *list;         ///<List of available key pairs
+} TlsKeyPairGroup;
+
+
+/**
+ * @brief Pool of pre-generated ephemeral key pairs
+ **/
+
+typedef struct
+{
+   OsMutex mutex;            ///<Mutex preventing simultaneous access to the pool
+   OsEvent event;            ///<Event signaling that a group needs to be refilled
+   const PrngAlgo *prngAlgo; ///<Pseudo-random number generator used to generate the key pairs
+   void *prngContext;        ///<Pseudo-random number generator context
+   TlsKeyPairGroup groups[TLS_KEY_PAIR_POOL_MAX_GROUPS]; ///<Named groups managed by the pool
+   uint_t numGroups;         ///<Number of named groups
+   uint_t hitCount;          ///<Key pairs served from the pool
+   uint_t missCount;         ///<Key pairs generated on the handshake path
+} TlsKeyPairPool;
+
+
+/**
+ * @brief Pre-encoded ClientHello message
+ *
+ * Only the client random, the session ID and the KeyShare extension vary
+ * from one connection to another. They are patched at the recorded offsets
+ *
+ **/
+
+typedef struct
+{
+   size_t length;                            ///<Length of the ClientHello message
+   size_t sessionIdLen;                      ///<Length of the session ID
+   size_t keyShareOffset;                    ///<Offset of the KeyShare extension
+   size_t keyShareLen;                       ///<Length of the KeyShare extension (0 if none)
+   uint16_t namedGroup;                      ///<Named group of the key share
+   char_t *serverName;                       ///<Server name the template was built for
+   uint8_t *data;                            ///<Encoded ClientHello message
+} TlsClientHelloTemplate;
+
+
+/**
+ * @brief Completion notification callback of the signing engine
+ **/
+
+typedef void (*TlsSignEngineNotifyCallback)(TlsContext *context, void *param);
+
+
+/**
+ * @brief Signature request queued by the signing engine
+ **/
+
+typedef struct
+{
+   TlsContext *context;            ///<TLS context that issued the request
+   TlsCredential *credential;      ///<Credential holding the private key
+   TlsSignatureAlgo signAlgo;      ///<Signature algorithm
+   TlsHashAlgo hashAlgo;           ///<Hash algorithm
+   uint8_t *data;                  ///<Content covered by the signature
+   size_t length;                  ///<Length of the content
+   systime_t timestamp;            ///<Time at which the request was queued
+} TlsSignRequest;
+
+
+/**
+ * @brief Signing engine shared by several TLS contexts
+ **/
+
+typedef struct
+{
+   OsMutex mutex;                  ///<Mutex preventing simultaneous access to the queue
+   const PrngAlgo *prngAlgo;       ///<Pseudo-random number generator to be used
+   void *prngContext;              ///<Pseudo-random number generator context
+   uint_t batchSize;               ///<Number of requests that triggers the processing of a batch
+   systime_t maxLatency;           ///<Maximum time a request may wait in the queue
+   TlsSignRequest *queue;          ///<Pending signature requests
+   uint_t queueLen;                ///<Number of pending requests
+   TlsSignEngineNotifyCallback notifyCallback; ///<Completion notification callback
+   void *notifyParam;              ///<Opaque pointer passed to the notification callback
+} TlsSignEngine;
+
+
+/**
+ * @brief Shared TLS configuration
+ **/
+
+typedef struct
+{
+   OsMutex mutex;                            ///<Mutex protecting the reference counter
+   uint_t refCount;                          ///<Reference counter
+   bool_t frozen;                            ///<The configuration can no longer be modified
+   TlsTransportProtocol transportProtocol;   ///<Transport protocol (stream or datagram)
+   TlsConnectionEnd entity;                  ///<Client or server operation
+   const PrngAlgo *prngAlgo;                 ///<Pseudo-random number generator to be used
+   void *prngContext;                        ///<Pseudo-random number generator context
+   uint16_t versionMin;                      ///<Minimum version accepted by the implementation
+   uint16_t versionMax;                      ///<Maximum version accepted by the implementation
+   const uint16_t *cipherSuites;             ///<List of supported cipher suites
+   uint_t numCipherSuites;                   ///<Number of cipher suites in the list
+   const uint8_t *cipherSuiteGroups;         ///<Equal-preference group flags
+   uint_t numCipherSuiteGroups;              ///<Number of flags in the list
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+   TlsCipherSuiteTable *cipherSuiteTable;    ///<Cipher suite negotiation table
+#endif
+   const uint16_t *supportedGroups;          ///<List of supported named groups
+   uint_t numSupportedGroups;                ///<Number of named groups in the list
+   TlsClientAuthMode clientAuthMode;         ///<Client authentication mode
+   TlsCache *cache;                          ///<TLS session cache
+   TlsSessionStore *sessionStore;            ///<Client-side session store
+   TlsBufferPool *bufferPool;                ///<Pool the TX and RX buffers are taken from
+   TlsKeyPairPool *keyPairPool;              ///<Pool of pre-generated ephemeral key pairs
+   bool_t bufferReleaseEnabled;              ///<Release the TX and RX buffers when idle
+   bool_t bufferShrinkEnabled;               ///<Shrink the TX and RX buffers to the negotiated record size
+#if (TLS_CLIENT_SUPPORT == ENABLED && TLS_CLIENT_HELLO_TEMPLATE_SUPPORT == ENABLED)
+   bool_t clientHelloTemplateEnabled;        ///<Template mode for the ClientHello message
+   TlsClientHelloTemplate *clientHelloTemplate; ///<Pre-encoded ClientHello message
+#endif
+   size_t txBufferMaxLen;                    ///<Maximum number of plaintext data the TX buffer can hold
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+   size_t handshakeArenaSize;                ///<Size of the per-handshake arena
+#endif
+   size_t rxBufferMaxLen;                    ///<Maximum number of plaintext data the RX buffer can hold
+   TlsCredential *credentials[TLS_MAX_CERTIFICATES]; ///<End entity credentials
+   uint_t numCredentials;                    ///<Number of credentials available
+   const char_t *trustedCaList;              ///<List of trusted CA (PEM format)
+   size_t trustedCaListLen;                  ///<Number of trusted CA in the list
+   TlsTrustStore *trustStore;                ///<Pre-decoded trusted CA store
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   TlsCertVerifyCache *certVerifyCache;      ///<Cache of verified certificate signatures
+#endif
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+   TlsVerifyPool *verifyPool;                ///<Verification worker pool
+#endif
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   TlsOcspCache *ocspCache;                  ///<Cache of OCSP responses to be stapled
+   bool_t ocspStaplingEnabled;               ///<Request a stapled OCSP response from the server
+   TlsOcspResponseCallback ocspResponseCallback; ///<Stapled OCSP response callback function
+   void *ocspResponseParam;                  ///<Opaque pointer passed to the stapled OCSP response callback
+#endif
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   bool_t falseStartEnabled;                 ///<Send application data before the server's Finished message
+#endif
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED)
+   bool_t fastOpenEnabled;                   ///<Open the connection with the first flight (TCP Fast Open)
+#endif
+#if (TLS_CERT_STORE_SUPPORT == ENABLED)
+   TlsCertStore *certStore;                  ///<SNI-indexed certificate store
+#endif
+   TlsCertVerifyCallback certVerifyCallback; ///<Certificate verification callback function
+   void *certVerifyParam;                    ///<Opaque pointer passed to the certificate verification callback
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
+   TlsEcdhCallback ecdhCallback;
+   TlsEcdsaSignCallback ecdsaSignCallback;
+   TlsEcdsaVerifyCallback ecdsaVerifyCallback;
+#endif
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   TlsAsyncSignCallback asyncSignCallback;   ///<Asynchronous signature generation callback
+   void *asyncSignParam;                     ///<Opaque pointer passed to the asynchronous signature callback
+#endif
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   const TlsCryptoProvider *cryptoProviders[TLS_MAX_CRYPTO_PROVIDERS]; ///<Crypto providers
+   uint_t numCryptoProviders;                ///<Number of crypto providers
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   uint16_t preferredGroup;                  ///<Preferred ECDHE or FFDHE named group
+   uint16_t speculativeGroup;                ///<ECDHE group of the speculative key share
+   size_t maxEarlyDataSize;                  ///<Maximum amount of 0-RTT data that the client is allowed to send
+   TlsAntiReplay *antiReplay;                ///<0-RTT anti-replay store
+   uint_t newSessionTicketLimit;             ///<Number of NewSessionTicket messages to be sent
+   bool_t deferredTicketsEnabled;            ///<Issue the tickets after the first application data
+#endif
+#if (TLS_DH_SUPPORT == ENABLED)
+   DhParameters dhParams;                    ///<Diffie-Hellman parameters (decoded once)
+#endif
+#if (TLS_PSK_SUPPORT == ENABLED)
+   char_t *pskIdentityHint;                  ///<PSK identity hint
+   TlsPskCallback pskCallback;               ///<PSK callback function
+#endif
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   size_t maxFragLen;                        ///<Maximum plaintext fragment length
+#endif
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   bool_t unknownProtocolsAllowed;           ///<Unknown ALPN protocols allowed
+   char_t *protocolList;                     ///<List of supported ALPN protocols
+   TlsAlpnList *alpnList;                    ///<Compiled list of supported ALPN protocols
+#endif
+#if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+   TlsRpkVerifyCallback rpkVerifyCallback;   ///<Raw public key verification callback function
+#endif
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   TlsTicketEncryptCallback ticketEncryptCallback; ///<Ticket encryption callback function
+   TlsTicketDecryptCallback ticketDecryptCallback; ///<Ticket decryption callback function
+   void *ticketParam;                        ///<Opaque pointer passed to the ticket callbacks
+#endif
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   bool_t sessionTicketEnabled;              ///<SessionTicket extension enabled (TLS 1.2)
+#endif
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   TlsCertCompressionCodec certCompressionCodecs[TLS_MAX_CERT_COMPRESSION_ALGOS]; ///<Certificate compression codecs
+   uint_t numCertCompressionCodecs;          ///<Number of certificate compression codecs
+#endif
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   TlsExtCacheGetCallback extCacheGetCallback;       ///<External session cache lookup callback
+   TlsExtCachePutCallback extCachePutCallback;       ///<External session cache insertion callback
+   TlsExtCacheDeleteCallback extCacheDeleteCallback; ///<External session cache removal callback
+   void *extCacheParam;                      ///<Opaque pointer passed to the external session cache callbacks
+#endif
+#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+   bool_t secureRenegoEnabled;               ///<Secure renegotiation enabled
+#endif
+#if (TLS_FALLBACK_SCSV_SUPPORT == ENABLED)
+   bool_t fallbackScsvEnabled;               ///<Support for FALLBACK_SCSV
+#endif
+#if (TLS_KEY_LOG_SUPPORT == ENABLED)
+   TlsKeyLogCallback keyLogCallback;         ///<Key logging callback (for debugging purpose only)
+#endif
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+   TlsHandshakeTraceCallback traceCallback;  ///<Handshake trace callback
+   void *traceParam;                         ///<Opaque pointer passed to the trace callback
+#endif
+#if (DTLS_SUPPORT == ENABLED)
+   size_t pmtu;                              ///<PMTU value
+   systime_t timeout;                        ///<Timeout for blocking calls
+   bool_t recordPackingEnabled;              ///<Pack application data records into datagrams
+   DtlsCookieGenerateCallback cookieGenerateCallback; ///<Cookie generation callback function
+   DtlsCookieVerifyCallback cookieVerifyCallback;     ///<Cookie verification callback function
+   void *cookieParam;                        ///<Opaque pointer passed to the cookie callbacks
+#endif
+#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   bool_t replayDetectionEnabled;            ///<Anti-replay mechanism enabled
+   uint_t replayWindowSize;                  ///<Size of the sliding window, in records
+#endif
+} TlsConfig;
+
+
+/**
+ * @brief Publication point for shared configurations
+ **/
+
+typedef struct
+{
+   OsMutex mutex;     ///<Mutex protecting the published configuration
+   TlsConfig *config; ///<Currently published configuration
+   uint_t generation; ///<Number of configurations published so far
+} TlsConfigSlot;
+
+
+/**
+ * @brief Memory profile of a TLS context created by tlsInitStatic()
+ **/
+
+typedef struct
+{
+   size_t txBufferSize;       ///<Maximum number of plaintext data the TX buffer can hold
+   size_t rxBufferSize;       ///<Maximum number of plaintext data the RX buffer can hold
+   size_t handshakeArenaSize; ///<Size of the per-handshake arena
+} TlsStaticProfile;
+
+
+/**
+ * @brief Incremental Certificate message parser
+ **/
+
+typedef struct
+{
+   uint_t state;                         ///<Parsing state
+   size_t remaining;                     ///<Number of bytes of the message left to parse
+   size_t fieldLen;                      ///<Length of the field being received
+   size_t fieldPos;                      ///<Number of bytes of the field received so far
+   uint8_t header[3];                    ///<Length field being received
+   uint8_t *field;                       ///<Certificate or extensions being received
+   uint8_t *prevCert;                    ///<DER encoding referenced by certInfo
+   uint_t numCerts;                      ///<Number of certificates parsed so far
+   error_t certValidResult;              ///<Result of the chain validation so far
+   X509CertificateInfo *certInfo;        ///<Last certificate of the path
+   X509CertificateInfo *issuerCertInfo;  ///<Parent of the last certificate
+} TlsCertStream;
+
+
 /**
  * @brief Hello extensions
  **/
@@ -1900,6 +3705,9 @@ typedef struct
    const TlsEcPointFormatList *ecPointFormatList;       ///<EcPointFormats extension
    const TlsSignHashAlgos *signAlgoList;                ///<SignatureAlgorithms extension
    const TlsSignHashAlgos *certSignAlgoList;            ///<SignatureAlgorithmsCert extension
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   const TlsCertCompressionAlgos *certCompressionAlgoList; ///<CompressCertificate extension
+#endif
 #if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
    const uint8_t *maxFragLen;                           ///<MaxFragmentLength extension
 #endif
@@ -1921,6 +3729,20 @@ typedef struct
 #if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
    const TlsRenegoInfo *renegoInfo;                     ///<RenegotiationInfo extension
 #endif
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   const uint8_t *sessionTicket;                        ///<SessionTicket extension
+   size_t sessionTicketLen;
+#endif
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   const uint8_t *statusRequest;                        ///<StatusRequest extension
+   size_t statusRequestLen;
+#endif
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   const DtlsConnectionId *connectionId;                ///<ConnectionId extension
+#endif
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+   const DtlsSrtpProtectionProfiles *useSrtp;           ///<UseSrtp extension
+#endif
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
    const Tls13Cookie *cookie;                           ///<Cookie extension
    const Tls13KeyShareList *keyShareList;               ///<KeyShare extension (ClientHello)
@@ -1932,14 +3754,42 @@ typedef struct
    const uint8_t *selectedIdentity;                     ///<PreSharedKey extension (ServerHello)
    const uint8_t *earlyDataIndication;                  ///<EarlyData extension
 #endif
-} TlsHelloExtensions;
+} TlsHelloExtensions;
+
+
+//Forward declaration of TlsEncryptionEngine structure
+struct _TlsEncryptionEngine;
+
+
+/**
+ * @brief Contexts of an encryption engine placed in caller-supplied memory
+ **/
+
+typedef struct
+{
+   uint64_t cipherContext[(TLS_STATIC_CIPHER_CONTEXT_SIZE + 7) / 8]; ///<Cipher context
+   HmacContext hmacContext;       ///<HMAC context
+   HmacContext hmacKeyContext;    ///<HMAC context keyed with the MAC key
+#if (TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   GcmContext gcmContext;         ///<GCM context
+#endif
+   bool_t used;                   ///<The contexts are owned by an encryption engine
+} TlsStaticEngineMem;
+
+
+/**
+ * @brief Record protection function
+ **/
+
+typedef error_t (*TlsRecordProtectFunc)(TlsContext *context,
+   struct _TlsEncryptionEngine *encryptionEngine, void *record);
 
 
 /**
  * @brief Encryption engine
  **/
 
-typedef struct
+typedef struct _TlsEncryptionEngine
 {
    uint16_t version;              ///<Negotiated TLS version
    uint8_t macKey[48];            ///<MAC key
@@ -1955,6 +3805,7 @@ typedef struct
    CipherMode cipherMode;         ///<Cipher mode of operation
    const HashAlgo *hashAlgo;      ///<Hash algorithm for MAC operations
    HmacContext *hmacContext;      ///<HMAC context
+   HmacContext *hmacKeyContext;   ///<HMAC context keyed with the MAC key
 #if (TLS_GCM_CIPHER_SUPPORT == ENABLED)
    GcmContext *gcmContext;        ///<GCM context
 #endif
@@ -1963,12 +3814,112 @@ typedef struct
    uint16_t epoch;                ///<Counter value incremented on every cipher state change
    DtlsSequenceNumber dtlsSeqNum; ///<Record sequence number
 #endif
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   uint8_t cid[DTLS_MAX_CID_SIZE]; ///<Connection ID carried by the records
+   size_t cidLen;                 ///<Length of the connection ID (0 if not used)
+#endif
 #if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
    size_t recordSizeLimit;        ///<Maximum size of record in octets
+#endif
+   TlsRecordProtectFunc encryptRecord; ///<Record encryption routine
+   TlsRecordProtectFunc decryptRecord; ///<Record decryption routine
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   const TlsCryptoProvider *provider; ///<Crypto provider that has claimed the engine
+   void *providerContext;         ///<Provider-specific state (key schedule, device handle)
+#endif
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   TlsStaticEngineMem *staticMem; ///<Contexts placed in caller-supplied memory
 #endif
 } TlsEncryptionEngine;
 
 
+/**
+ * @brief Encryption engine initialization callback (crypto provider)
+ **/
+
+typedef error_t (*TlsProviderInitEngineCallback)(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, void **providerContext);
+
+
+/**
+ * @brief Encryption engine release callback (crypto provider)
+ **/
+
+typedef void (*TlsProviderFreeEngineCallback)(
+   TlsEncryptionEngine *encryptionEngine, void *providerContext);
+
+
+/**
+ * @brief Hash algorithm selection callback (crypto provider)
+ **/
+
+typedef const HashAlgo *(*TlsProviderHashAlgoCallback)(
+   const HashAlgo *hashAlgo);
+
+
+/**
+ * @brief Crypto provider
+ *
+ * A provider supplies alternative implementations of the primitives used by
+ * the record layer and the handshake (hardware accelerators, CPU-specific
+ * code). Any callback may be left NULL, in which case the built-in
+ * implementation is used
+ *
+ **/
+
+struct _TlsCryptoProvider
+{
+   const char_t *name;                         ///<Name of the provider
+   uint_t priority;                            ///<Priority (the highest value is preferred)
+   TlsProviderInitEngineCallback initEngine;   ///<Claim an encryption engine for the negotiated cipher suite
+   TlsRecordProtectFunc encryptRecord;         ///<Record encryption (AEAD seal or MAC-then-encrypt)
+   TlsRecordProtectFunc decryptRecord;         ///<Record decryption (AEAD open or decrypt-then-verify)
+   TlsProviderFreeEngineCallback freeEngine;   ///<Release provider-specific engine state
+   TlsProviderHashAlgoCallback getHashAlgo;    ///<Hash implementation used for record MACs
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
+   TlsEcdhCallback ecdhCallback;               ///<ECDH key pair generation and shared secret computation
+   TlsEcdsaSignCallback ecdsaSignCallback;     ///<ECDSA signature generation
+   TlsEcdsaVerifyCallback ecdsaVerifyCallback; ///<ECDSA signature verification
+#endif
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   TlsAsyncSignCallback signCallback;          ///<RSA, DSA, ECDSA and EdDSA signature generation
+   void *signParam;                            ///<Opaque pointer passed to the signature callback
+#endif
+};
+
+
+/**
+ * @brief Handshake key material
+ *
+ * Secrets that are only needed while the handshake is in progress. The
+ * structure is allocated when the handshake starts and wiped and released
+ * as soon as the connection enters the application data phase
+ *
+ **/
+
+typedef struct
+{
+   uint8_t premasterSecret[TLS_PREMASTER_SECRET_SIZE]; ///<Premaster secret
+   size_t premasterSecretLen;                ///<Length of the premaster secret
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   uint8_t keyBlock[192];                    ///<Key material
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   uint8_t secret[TLS_MAX_HKDF_DIGEST_SIZE];
+   uint8_t clientEarlyTrafficSecret[TLS_MAX_HKDF_DIGEST_SIZE];
+   uint8_t clientHsTrafficSecret[TLS_MAX_HKDF_DIGEST_SIZE];
+   uint8_t serverHsTrafficSecret[TLS_MAX_HKDF_DIGEST_SIZE];
+#endif
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+   uint8_t *arena;                           ///<Arena for handshake-scoped allocations
+   size_t arenaSize;                         ///<Size of the arena
+   size_t arenaUsed;                         ///<Number of bytes currently allocated
+   size_t arenaLast;                         ///<Offset of the most recent allocation
+   size_t arenaPeak;                         ///<Highest number of bytes allocated
+#endif
+} TlsHandshakeContext;
+
+
 /**
  * @brief TLS context
  *
@@ -1981,37 +3932,104 @@ struct _TlsContext
    TlsState state;                           ///<TLS handshake finite state machine
    TlsTransportProtocol transportProtocol;   ///<Transport protocol (stream or datagram)
    TlsConnectionEnd entity;                  ///<Client or server operation
+   TlsConfig *config;                        ///<Shared configuration the context was created from
+
+#if (TLS_FULL_DUPLEX_SUPPORT == ENABLED)
+   OsMutex txMutex;                          ///<Mutex serializing the sending side
+   OsMutex rxMutex;                          ///<Mutex serializing the receiving side
+#endif
 
    TlsSocketHandle socketHandle;             ///<Socket handle
    TlsSocketSendCallback socketSendCallback;       ///<Socket send callback function
    TlsSocketReceiveCallback socketReceiveCallback; ///<Socket receive callback function
+   TlsSocketSendFileCallback socketSendFileCallback; ///<Socket send file callback function (offloaded record layer)
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   TlsSocketSubmitSendCallback socketSubmitSendCallback;       ///<Post a send request (completion-based transport)
+   TlsSocketSubmitReceiveCallback socketSubmitReceiveCallback; ///<Post a receive request (completion-based transport)
+   TlsIoRequest txIoRequest;                 ///<Send request in progress
+   TlsIoRequest rxIoRequest;                 ///<Receive request in progress
+#endif
 
    const PrngAlgo *prngAlgo;                 ///<Pseudo-random number generator to be used
    void *prngContext;                        ///<Pseudo-random number generator context
 
    const uint16_t *cipherSuites;             ///<List of supported cipher suites
    uint_t numCipherSuites;                   ///<Number of cipher suites in the list
+   const uint8_t *cipherSuiteGroups;         ///<Equal-preference group flags
+   uint_t numCipherSuiteGroups;              ///<Number of flags in the list
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+   TlsCipherSuiteTable *cipherSuiteTable;    ///<Cipher suite negotiation table
+#endif
 
    const uint16_t *supportedGroups;          ///<List of supported named groups
    uint_t numSupportedGroups;                ///<Number of named groups in the list
 
    char_t *serverName;                       ///<Fully qualified DNS hostname of the server
+   uint16_t serverPort;                      ///<Port number of the server (session store key)
 
 #if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
    TlsEcdhCallback ecdhCallback;
    TlsEcdsaSignCallback ecdsaSignCallback;
    TlsEcdsaVerifyCallback ecdsaVerifyCallback;
 #endif
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   TlsAsyncSignCallback asyncSignCallback;   ///<Asynchronous signature generation callback
+   void *asyncSignParam;                     ///<Opaque pointer passed to the asynchronous signature callback
+   TlsAsyncSignState asyncSignState;         ///<State of the pending signature operation
+   error_t asyncSignStatus;                  ///<Status code posted by the application
+   uint8_t *asyncSignResult;                 ///<Signature posted by the application
+   size_t asyncSignResultLen;                ///<Length of the posted signature
+   uint8_t *asyncSignMessage;                ///<Handshake message saved while the signature is pending
+   size_t asyncSignMessageLen;               ///<Length of the saved handshake message
+#endif
+#if (TLS_HANDSHAKE_EXECUTOR_SUPPORT == ENABLED)
+   TlsExecutorState executorState;           ///<State of the handshake step handed to the executor
+#endif
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   const TlsCryptoProvider *cryptoProviders[TLS_MAX_CRYPTO_PROVIDERS]; ///<Crypto providers
+   uint_t numCryptoProviders;                ///<Number of crypto providers
+#endif
 
    TlsCertDesc certs[TLS_MAX_CERTIFICATES];  ///<End entity certificates (PEM format)
    uint_t numCerts;                          ///<Number of certificates available
    const char_t *trustedCaList;              ///<List of trusted CA (PEM format)
    size_t trustedCaListLen;                  ///<Number of trusted CA in the list
+   TlsTrustStore *trustStore;                ///<Pre-decoded trusted CA store
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   TlsCertVerifyCache *certVerifyCache;      ///<Cache of verified certificate signatures
+#endif
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+   TlsVerifyPool *verifyPool;                ///<Verification worker pool
+   TlsVerifyBatch *verifyBatch;              ///<Signature checks of the chain being parsed
+#endif
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   TlsOcspCache *ocspCache;                  ///<Cache of OCSP responses to be stapled
+   bool_t ocspStaplingEnabled;               ///<Request a stapled OCSP response from the server
+   TlsOcspResponseCallback ocspResponseCallback; ///<Stapled OCSP response callback function
+   void *ocspResponseParam;                  ///<Opaque pointer passed to the stapled OCSP response callback
+   TlsOcspResponse *ocspResponse;            ///<OCSP response stapled to the Certificate message
+   bool_t certStatusNegotiated;              ///<A CertificateStatus message is expected (TLS 1.2)
+#endif
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   bool_t falseStartEnabled;                 ///<Send application data before the server's Finished message
+   bool_t falseStarted;                      ///<The client flight has been sent under False Start conditions
+#endif
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED)
+   bool_t fastOpenEnabled;                   ///<Open the connection with the first flight (TCP Fast Open)
+   bool_t fastOpenPending;                   ///<No data has been handed to the transport yet
+   bool_t fastOpenFlight;                    ///<The ClientHello and the 0-RTT data are being gathered
+#endif
+#if (TLS_CERT_STORE_SUPPORT == ENABLED)
+   TlsCertStore *certStore;                  ///<SNI-indexed certificate store
+   TlsCertDesc storeCerts[TLS_CERT_STORE_MAX_CREDENTIALS]; ///<Certificates selected from the store
+   uint_t numStoreCerts;                     ///<Number of certificates selected from the store
+#endif
    TlsCertVerifyCallback certVerifyCallback; ///<Certificate verification callback function
    void *certVerifyParam;                    ///<Opaque pointer passed to the certificate verification callback
    TlsCertDesc *cert;                        ///<Pointer to the currently selected certificate
 
    TlsCache *cache;                          ///<TLS session cache
+   TlsSessionStore *sessionStore;            ///<Client-side session store
 
    uint8_t sessionId[32];                    ///<Session identifier
    size_t sessionIdLen;                      ///<Length of the session identifier
@@ -2048,6 +4066,29 @@ struct _TlsContext
    size_t txBufferPos;                       ///<Current position in TX buffer
    size_t txRecordLen;                       ///<Length of the TLS record
    size_t txRecordPos;                       ///<Current position in the TLS record
+   size_t txPendingLen;                      ///<Number of application bytes accumulated but not yet sent
+   bool_t txDataAccepted;                    ///<The record in flight has already been reported as written
+   bool_t txZeroCopy;                        ///<The payload area of the TX buffer is lent to the application
+   bool_t offloaded;                         ///<The record layer has been offloaded to the transport
+   uint8_t *txBulkBuffer;                    ///<Buffer holding a batch of encrypted records (bulk send)
+   size_t txBulkSize;                        ///<Size of the bulk send buffer
+   size_t txBulkLen;                         ///<Number of bytes in the bulk send buffer
+   size_t txBulkPos;                         ///<Current position in the bulk send buffer
+#if (TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   bool_t txFlightActive;                    ///<A flight of handshake messages is being built
+   size_t txFlightLen;                       ///<Number of handshake bytes not yet packed into records
+#endif
+#if (TLS_DYNAMIC_RECORD_SIZING_SUPPORT == ENABLED)
+   size_t drsSegmentSize;                    ///<Size of a transport segment (0 if dynamic record sizing is disabled)
+   size_t drsRampThreshold;                  ///<Number of bytes sent in small records before using full-sized ones
+   systime_t drsIdleTimeout;                 ///<Idle period after which small records are used again
+   size_t drsBytesSent;                      ///<Number of application bytes sent since the last reset
+   systime_t drsTimestamp;                   ///<Time at which application data were last sent
+#endif
+#if (TLS_STATS_SUPPORT == ENABLED)
+   TlsContextStats stats;                    ///<Per-context statistics
+   TlsGlobalStats *statsShard;               ///<Shard of the global statistics updated by the context
+#endif
 
    uint8_t *rxBuffer;                        ///<RX buffer
    size_t rxBufferSize;                      ///<RX buffer size
@@ -2057,11 +4098,39 @@ struct _TlsContext
    size_t rxBufferPos;                       ///<Current position in RX buffer
    size_t rxRecordLen;                       ///<Length of the TLS record
    size_t rxRecordPos;                       ///<Current position in the TLS record
+   size_t rxBorrowedLen;                     ///<Number of bytes lent to the application by tlsReadBorrow
+   uint8_t *rxAheadBuffer;                   ///<Read-ahead buffer (batched receive)
+   size_t rxAheadSize;                       ///<Size of the read-ahead buffer
+   size_t rxAheadPos;                        ///<Current position in the read-ahead buffer
+   size_t rxAheadLen;                        ///<Number of bytes pending in the read-ahead buffer
+#if (TLS_CERT_STREAM_SUPPORT == ENABLED)
+   size_t rxStreamLen;                       ///<Length of the handshake message being streamed
+   size_t rxStreamPos;                       ///<Number of bytes of the message passed to the parser
+   TlsCertStream certStream;                 ///<Incremental Certificate message parser
+#endif
+
+   TlsBufferPool *bufferPool;                ///<Pool the TX and RX buffers are taken from
+   TlsKeyPairPool *keyPairPool;              ///<Pool of pre-generated ephemeral key pairs
+   bool_t bufferReleaseEnabled;              ///<Release the TX and RX buffers when idle
+   bool_t bufferShrinkEnabled;               ///<Shrink the TX and RX buffers to the negotiated record size
+   bool_t bufferShrinkPending;               ///<The TX and RX buffers have not been shrunk yet
 
    uint8_t clientRandom[TLS_RANDOM_SIZE];    ///<Client random value
    uint8_t serverRandom[TLS_RANDOM_SIZE];    ///<Server random value
-   uint8_t premasterSecret[TLS_PREMASTER_SECRET_SIZE]; ///<Premaster secret
-   size_t premasterSecretLen;                ///<Length of the premaster secret
+   TlsHandshakeContext *handshake;           ///<Handshake key material (handshake only)
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+   size_t handshakeArenaSize;                ///<Size of the per-handshake arena
+#endif
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   bool_t staticMem;                         ///<The context lives in memory supplied by the caller
+   uint8_t *staticTxBuffer;                  ///<TX buffer placed in caller-supplied memory
+   size_t staticTxBufferSize;                ///<Size of the static TX buffer
+   uint8_t *staticRxBuffer;                  ///<RX buffer placed in caller-supplied memory
+   size_t staticRxBufferSize;                ///<Size of the static RX buffer
+   TlsHandshakeContext *staticHandshake;     ///<Handshake context placed in caller-supplied memory
+   size_t staticArenaSize;                   ///<Size of the static handshake arena
+   TlsStaticEngineMem *staticEngines;        ///<Contexts of the encryption engines placed in caller-supplied memory
+#endif
    uint8_t clientVerifyData[64];             ///<Client verify data
    size_t clientVerifyDataLen;               ///<Length of the client verify data
    uint8_t serverVerifyData[64];             ///<Server verify data
@@ -2080,33 +4149,38 @@ struct _TlsContext
 
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
    uint8_t masterSecret[TLS_MASTER_SECRET_SIZE]; ///<Master secret
-   uint8_t keyBlock[192];                    ///<Key material
-   HmacContext hmacContext;                  ///<HMAC context
    Sha1Context *transcriptSha1Context;       ///<SHA-1 context used to compute verify data
 #endif
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_TRANSCRIPT_LOG_SIZE > 0)
+   uint8_t *transcriptLog;                   ///<Handshake messages not yet digested with SHA-1
+   size_t transcriptLogLen;                  ///<Length of the handshake message log
+#endif
+
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
    HashContext *transcriptHashContext;       ///<Hash context used to compute verify data
 #endif
 
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
    uint16_t preferredGroup;                  ///<Preferred ECDHE or FFDHE named group
+   uint16_t speculativeGroup;                ///<ECDHE group of the speculative key share
+   uint16_t speculativeShareGroup;           ///<Group of the speculative key share actually offered
    systime_t timestamp;                      ///<Time at which the ClientHello message was sent
    bool_t updatedClientHelloReceived;        ///<An updated ClientHello message has been received
    uint8_t *certRequestContext;              ///<Certificate request context
    size_t certRequestContextLen;             ///<Length of the certificate request context
    int_t selectedIdentity;                   ///<Selected PSK identity
 
-   uint8_t secret[TLS_MAX_HKDF_DIGEST_SIZE];
-   uint8_t clientEarlyTrafficSecret[TLS_MAX_HKDF_DIGEST_SIZE];
-   uint8_t clientHsTrafficSecret[TLS_MAX_HKDF_DIGEST_SIZE];
-   uint8_t serverHsTrafficSecret[TLS_MAX_HKDF_DIGEST_SIZE];
    uint8_t clientAppTrafficSecret[TLS_MAX_HKDF_DIGEST_SIZE];
    uint8_t serverAppTrafficSecret[TLS_MAX_HKDF_DIGEST_SIZE];
    uint8_t exporterMasterSecret[TLS_MAX_HKDF_DIGEST_SIZE];
    uint8_t resumptionMasterSecret[TLS_MAX_HKDF_DIGEST_SIZE];
 
    uint_t newSessionTicketCount;             ///<Number of NewSessionTicket messages that have been sent
+   uint_t newSessionTicketLimit;             ///<Number of NewSessionTicket messages to be sent
+   bool_t deferredTicketsEnabled;            ///<Issue the tickets after the first application data
+   bool_t deferredTicketsPending;            ///<Deferred NewSessionTicket messages have to be sent
 
    uint8_t *ticket;                          ///<Session ticket
    size_t ticketLen;                         ///<Length of the session ticket
@@ -2121,6 +4195,7 @@ struct _TlsContext
    char_t *ticketAlpn;                       ///<ALPN protocol associated with the ticket
 
    size_t maxEarlyDataSize;                  ///<Maximum amount of 0-RTT data that the client is allowed to send
+   TlsAntiReplay *antiReplay;                ///<0-RTT anti-replay store
    size_t earlyDataLen;                      ///<Total amount of 0-RTT data that have been sent by the client
    bool_t earlyDataEnabled;                  ///<EarlyData is enabled
    bool_t earlyDataRejected;                 ///<The 0-RTT data have been rejected by the server
@@ -2135,6 +4210,9 @@ struct _TlsContext
 #if (TLS_ECDH_SUPPORT == ENABLED)
    EcdhContext ecdhContext;                  ///<ECDH context
    bool_t ecPointFormatsExtReceived;         ///<The EcPointFormats extension has been received
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   EcdhContext speculativeEcdhContext;       ///<ECDH context of the speculative key share
+#endif
 #endif
 
 #if (TLS_RSA_SUPPORT == ENABLED)
@@ -2173,6 +4251,7 @@ struct _TlsContext
 #if (TLS_ALPN_SUPPORT == ENABLED)
    bool_t unknownProtocolsAllowed;           ///<Unknown ALPN protocols allowed
    char_t *protocolList;                     ///<List of supported ALPN protocols
+   TlsAlpnList *alpnList;                    ///<Compiled list of supported ALPN protocols
    char_t *selectedProtocol;                 ///<Selected ALPN protocol
 #endif
 
@@ -2194,6 +4273,31 @@ struct _TlsContext
    void *ticketParam;                        ///<Opaque pointer passed to the ticket callbacks
 #endif
 
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   bool_t sessionTicketEnabled;              ///<SessionTicket extension enabled (TLS 1.2)
+   bool_t sessionTicketNegotiated;           ///<A NewSessionTicket message is expected (TLS 1.2)
+   bool_t ticketResume;                      ///<The session has been resumed from a ticket
+   uint8_t *sessionTicket;                   ///<Session ticket (TLS 1.2)
+   size_t sessionTicketLen;                  ///<Length of the session ticket
+#endif
+
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   TlsCertCompressionCodec certCompressionCodecs[TLS_MAX_CERT_COMPRESSION_ALGOS]; ///<Certificate compression codecs
+   uint_t numCertCompressionCodecs;          ///<Number of certificate compression codecs
+   TlsCertCompressionAlgo certCompressionAlgo; ///<Algorithm used to compress the Certificate message sent to the peer
+#endif
+
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   TlsExtCacheGetCallback extCacheGetCallback;       ///<External session cache lookup callback
+   TlsExtCachePutCallback extCachePutCallback;       ///<External session cache insertion callback
+   TlsExtCacheDeleteCallback extCacheDeleteCallback; ///<External session cache removal callback
+   void *extCacheParam;                      ///<Opaque pointer passed to the external session cache callbacks
+   TlsExtCacheState extCacheState;           ///<State of the pending lookup
+   error_t extCacheStatus;                   ///<Status code posted by the application
+   uint8_t *extCacheResult;                  ///<Serialized session state posted by the application
+   size_t extCacheResultLen;                 ///<Length of the serialized session state
+#endif
+
 #if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
    bool_t secureRenegoEnabled;               ///<Secure renegotiation enabled
    bool_t secureRenegoFlag;                  ///<Secure renegotiation flag
@@ -2207,6 +4311,12 @@ struct _TlsContext
    TlsKeyLogCallback keyLogCallback;         ///<Key logging callback (for debugging purpose only)
 #endif
 
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+   TlsHandshakeTraceCallback traceCallback;  ///<Handshake trace callback
+   void *traceParam;                         ///<Opaque pointer passed to the trace callback
+   TlsState traceState;                      ///<Last state reported to the trace callback
+#endif
+
 #if (TLS_MAX_WARNING_ALERTS > 0)
    uint_t alertCount;                        ///<Count of consecutive warning alerts
 #endif
@@ -2227,6 +4337,7 @@ struct _TlsContext
    size_t pmtu;                              ///<PMTU value
    systime_t timeout;                        ///<Timeout for blocking calls
    systime_t startTime;
+   bool_t recordPackingEnabled;              ///<Pack application data records into datagrams
 
    DtlsCookieGenerateCallback cookieGenerateCallback; ///<Cookie generation callback function
    DtlsCookieVerifyCallback cookieVerifyCallback;     ///<Cookie verification callback function
@@ -2238,6 +4349,20 @@ struct _TlsContext
 
    uint16_t txMsgSeq;                        ///<Send sequence number
    size_t txDatagramLen;                     ///<Length of the outgoing datagram, in bytes
+   TlsSocketSendBatchCallback socketSendBatchCallback; ///<Socket send batch callback function
+   size_t txBatchLen;                        ///<Length of the datagrams waiting in the batch
+   uint_t txBatchCount;                      ///<Number of datagrams waiting in the batch
+   uint16_t txBatchLengths[DTLS_MAX_BATCH_SIZE]; ///<Length of each datagram of the batch
+#if (DTLS_FLIGHT_CACHE_SUPPORT == ENABLED)
+   uint8_t *txFlightCache;                   ///<Records of the flight, as laid out in datagrams
+   size_t txFlightCacheSize;                 ///<Size of the flight cache
+   size_t txFlightCacheLen;                  ///<Number of bytes held in the flight cache
+#endif
+
+   DtlsTimerWheel *timerWheel;               ///<Timer wheel driving the retransmission timer
+   uint32_t timerExpiry;                     ///<Tick at which the retransmission timer expires
+   TlsContext *timerNext;                    ///<Next timer in the same slot
+   TlsContext **timerPrev;                   ///<Link pointing to this timer (NULL if not armed)
 
    uint16_t rxMsgSeq;                        ///<Next receive sequence number
    size_t rxFragQueueLen;                    ///<Length of the reassembly queue
@@ -2247,22 +4372,75 @@ struct _TlsContext
 
 #if (DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
    bool_t replayDetectionEnabled;           ///<Anti-replay mechanism enabled
-   uint32_t replayWindow[(DTLS_REPLAY_WINDOW_SIZE + 31) / 32];
+   uint_t replayWindowSize;                 ///<Size of the sliding window, in records
+   uint_t replayWindowWords;                ///<Number of words in the ring bitmap (power of two)
+   uint64_t *replayWindow;                  ///<Ring bitmap indexed by sequence number
+   uint64_t replayWindowBuffer[DTLS_REPLAY_WINDOW_BUFFER_SIZE]; ///<Storage for the default window
 #endif
 
    TlsEncryptionEngine prevEncryptionEngine;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   bool_t cidEnabled;                       ///<ConnectionId extension enabled
+   bool_t cidNegotiated;                    ///<ConnectionId extension negotiated
+   uint8_t localCid[DTLS_MAX_CID_SIZE];     ///<CID the peer puts in the records it sends
+   size_t localCidLen;                      ///<Length of the local CID
+   uint8_t peerCid[DTLS_MAX_CID_SIZE];      ///<CID to put in the records sent to the peer
+   size_t peerCidLen;                       ///<Length of the peer CID
+#endif
+
+#if (DTLS_SRTP_SUPPORT == ENABLED)
+   uint16_t srtpProfiles[DTLS_MAX_SRTP_PROFILES]; ///<SRTP protection profiles (preference order)
+   uint_t numSrtpProfiles;                  ///<Number of SRTP protection profiles
+   uint8_t srtpMki[DTLS_MAX_SRTP_MKI_SIZE]; ///<SRTP master key identifier
+   size_t srtpMkiLen;                       ///<Length of the SRTP MKI
+   uint16_t srtpProfile;                    ///<Negotiated SRTP protection profile
+   DtlsSrtpCallback srtpCallback;           ///<Callback invoked for non-DTLS datagrams
+   void *srtpParam;                         ///<Opaque pointer passed to the SRTP callback
+#endif
+
+#if (TLS_SERVER_SUPPORT == ENABLED)
+   DtlsListener *listener;                  ///<Listener the context is bound to
+   DtlsPeerAddr peerAddr;                   ///<Address of the peer
+   uint32_t peerAddrHash;                   ///<Hash of the peer address
+   TlsContext *listenerNext;                ///<Next context in the same hash bucket
+#if (DTLS_CID_SUPPORT == ENABLED)
+   uint32_t localCidHash;                   ///<Hash of the local CID
+   TlsContext *cidNext;                     ///<Next context in the same CID bucket
+   DtlsPeerAddr rxPeerAddr;                 ///<Source of the last datagram routed by CID
+   bool_t rxPeerAddrChanged;                ///<The last datagram came from a new address
+#endif
+#endif
 #endif
 };
 
 
 //TLS application programming interface (API)
 TlsContext *tlsInit(void);
+error_t tlsInitContext(TlsContext *context);
+
+TlsContext *tlsInitStatic(void *buffer, size_t size,
+   const TlsStaticProfile *profile);
+
+TlsContext *tlsInitFromConfig(TlsConfig *config);
+TlsContext *tlsInitFromConfigSlot(TlsConfigSlot *slot);
 TlsState tlsGetState(TlsContext *context);
 
 error_t tlsSetSocketCallbacks(TlsContext *context,
    TlsSocketSendCallback socketSendCallback,
    TlsSocketReceiveCallback socketReceiveCallback, TlsSocketHandle handle);
 
+error_t tlsSetSocketSendBatchCallback(TlsContext *context,
+   TlsSocketSendBatchCallback socketSendBatchCallback);
+
+error_t tlsSetSocketSubmitCallbacks(TlsContext *context,
+   TlsSocketSubmitSendCallback socketSubmitSendCallback,
+   TlsSocketSubmitReceiveCallback socketSubmitReceiveCallback);
+
+error_t tlsCompleteSend(TlsContext *context, error_t status, size_t written);
+error_t tlsCompleteReceive(TlsContext *context, error_t status,
+   size_t received);
+
 error_t tlsSetVersion(TlsContext *context, uint16_t versionMin,
    uint16_t versionMax);
 
@@ -2276,20 +4454,36 @@ error_t tlsSetServerName(TlsContext *context, const char_t *serverName);
 const char_t *tlsGetServerName(TlsContext *context);
 
 error_t tlsSetCache(TlsContext *context, TlsCache *cache);
+error_t tlsSetSessionStore(TlsContext *context, TlsSessionStore *store);
+error_t tlsSetServerPort(TlsContext *context, uint16_t port);
 error_t tlsSetClientAuthMode(TlsContext *context, TlsClientAuthMode mode);
 
 error_t tlsSetBufferSize(TlsContext *context, size_t txBufferSize,
    size_t rxBufferSize);
 
+error_t tlsSetBufferPool(TlsContext *context, TlsBufferPool *bufferPool);
+error_t tlsSetKeyPairPool(TlsContext *context, TlsKeyPairPool *keyPairPool);
+error_t tlsEnableBufferRelease(TlsContext *context, bool_t enabled);
+error_t tlsEnableBufferShrink(TlsContext *context, bool_t enabled);
+error_t tlsSetReceiveBatchSize(TlsContext *context, size_t size);
+error_t tlsSetBulkSendSize(TlsContext *context, size_t size);
+
+error_t tlsSetDynamicRecordSizing(TlsContext *context, size_t segmentSize,
+   size_t rampThreshold, systime_t idleTimeout);
+
 error_t tlsSetMaxFragmentLength(TlsContext *context, size_t maxFragLen);
 
 error_t tlsSetCipherSuites(TlsContext *context, const uint16_t *cipherSuites,
    uint_t length);
 
+error_t tlsSetCipherSuiteGroups(TlsContext *context, const uint8_t *groups,
+   uint_t length);
+
 error_t tlsSetSupportedGroups(TlsContext *context, const uint16_t *groups,
    uint_t length);
 
 error_t tlsSetPreferredGroup(TlsContext *context, uint16_t group);
+error_t tlsSetSpeculativeGroup(TlsContext *context, uint16_t group);
 
 error_t tlsSetDhParameters(TlsContext *context, const char_t *params,
    size_t length);
@@ -2302,9 +4496,21 @@ error_t tlsSetEcdsaSignCallback(TlsContext *context,
 error_t tlsSetEcdsaVerifyCallback(TlsContext *context,
    TlsEcdsaVerifyCallback ecdsaVerifyCallback);
 
+error_t tlsSetAsyncSignCallback(TlsContext *context,
+   TlsAsyncSignCallback asyncSignCallback, void *param);
+
+error_t tlsPostAsyncSignResult(TlsContext *context, error_t status,
+   const uint8_t *signature, size_t length);
+
+error_t tlsSetCryptoProviders(TlsContext *context,
+   const TlsCryptoProvider *const *providers, uint_t numProviders);
+
 error_t tlsSetKeyLogCallback(TlsContext *context,
    TlsKeyLogCallback keyLogCallback);
 
+error_t tlsSetHandshakeTraceCallback(TlsContext *context,
+   TlsHandshakeTraceCallback traceCallback, void *param);
+
 error_t tlsAllowUnknownAlpnProtocols(TlsContext *context, bool_t allowed);
 error_t tlsSetAlpnProtocolList(TlsContext *context, const char_t *protocolList);
 const char_t *tlsGetAlpnProtocol(TlsContext *context);
@@ -2320,9 +4526,29 @@ error_t tlsSetRpkVerifyCallback(TlsContext *context,
 error_t tlsSetTrustedCaList(TlsContext *context,
    const char_t *trustedCaList, size_t length);
 
+error_t tlsSetTrustStore(TlsContext *context, TlsTrustStore *trustStore);
+
+error_t tlsSetCertVerifyCache(TlsContext *context,
+   TlsCertVerifyCache *certVerifyCache);
+
+error_t tlsSetVerifyPool(TlsContext *context, TlsVerifyPool *verifyPool);
+
+error_t tlsSetOcspCache(TlsContext *context, TlsOcspCache *ocspCache);
+error_t tlsEnableOcspStapling(TlsContext *context, bool_t enabled);
+
+error_t tlsSetOcspResponseCallback(TlsContext *context,
+   TlsOcspResponseCallback ocspResponseCallback, void *param);
+
+error_t tlsEnableFalseStart(TlsContext *context, bool_t enabled);
+error_t tlsEnableFastOpen(TlsContext *context, bool_t enabled);
+
+error_t tlsSetCertStore(TlsContext *context, TlsCertStore *certStore);
+
 error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
    size_t certChainLen, const char_t *privateKey, size_t privateKeyLen);
 
+error_t tlsAddCredential(TlsContext *context, TlsCredential *credential);
+
 error_t tlsSetCertificateVerifyCallback(TlsContext *context,
    TlsCertVerifyCallback certVerifyCallback, void *param);
 
@@ -2333,7 +4559,21 @@ error_t tlsSetTicketCallbacks(TlsContext *context,
    TlsTicketEncryptCallback ticketEncryptCallback,
    TlsTicketDecryptCallback ticketDecryptCallback, void *param);
 
+error_t tlsEnableSessionTickets(TlsContext *context, bool_t enabled);
+
+error_t tlsAddCertCompressionAlgo(TlsContext *context,
+   TlsCertCompressionAlgo algorithm, TlsCertCompressCallback compressCallback,
+   TlsCertDecompressCallback decompressCallback, void *param);
+
+error_t tlsSetExtCacheCallbacks(TlsContext *context,
+   TlsExtCacheGetCallback getCallback, TlsExtCachePutCallback putCallback,
+   TlsExtCacheDeleteCallback deleteCallback, void *param);
+
+error_t tlsPostExtCacheResult(TlsContext *context, error_t status,
+   const uint8_t *data, size_t length);
+
 error_t tlsSetPmtu(TlsContext *context, size_t pmtu);
+error_t tlsEnableRecordPacking(TlsContext *context, bool_t enabled);
 error_t tlsSetTimeout(TlsContext *context, systime_t timeout);
 
 error_t tlsSetCookieCallbacks(TlsContext *context,
@@ -2341,8 +4581,29 @@ error_t tlsSetCookieCallbacks(TlsContext *context,
    DtlsCookieVerifyCallback cookieVerifyCallback, void *param);
 
 error_t tlsEnableReplayDetection(TlsContext *context, bool_t enabled);
+error_t tlsSetReplayWindowSize(TlsContext *context, uint_t size);
+
+error_t tlsSetConnectionId(TlsContext *context, const uint8_t *cid,
+   size_t length);
+
+error_t tlsSetSrtpProfiles(TlsContext *context, const uint16_t *profiles,
+   uint_t numProfiles);
+
+error_t tlsSetSrtpMki(TlsContext *context, const uint8_t *mki,
+   size_t length);
+
+error_t tlsSetSrtpCallback(TlsContext *context, DtlsSrtpCallback callback,
+   void *param);
+
+uint16_t tlsGetSrtpProfile(TlsContext *context);
+error_t tlsExportSrtpKeys(TlsContext *context, DtlsSrtpKeys *keys);
+
+error_t tlsSetTimerWheel(TlsContext *context, DtlsTimerWheel *timerWheel);
 
 error_t tlsSetMaxEarlyDataSize(TlsContext *context, size_t maxEarlyDataSize);
+error_t tlsSetAntiReplay(TlsContext *context, TlsAntiReplay *antiReplay);
+error_t tlsSetNewSessionTicketCount(TlsContext *context, uint_t count);
+error_t tlsEnableDeferredTickets(TlsContext *context, bool_t enabled);
 
 error_t tlsWriteEarlyData(TlsContext *context, const void *data,
    size_t length, size_t *written, uint_t flags);
@@ -2354,9 +4615,33 @@ TlsEarlyDataStatus tlsGetEarlyDataStatus(TlsContext *context);
 error_t tlsWrite(TlsContext *context, const void *data,
    size_t length, size_t *written, uint_t flags);
 
+error_t tlsWritev(TlsContext *context, const TlsIoVec *iov, uint_t iovCount,
+   size_t *written, uint_t flags);
+
+error_t tlsEnableOffload(TlsContext *context, TlsOffloadCallback callback,
+   void *param);
+
+error_t tlsGetWriteBuffer(TlsContext *context, uint8_t **buffer, size_t *size);
+error_t tlsCommitWriteBuffer(TlsContext *context, size_t length);
+
+error_t tlsSetSocketSendFileCallback(TlsContext *context,
+   TlsSocketSendFileCallback socketSendFileCallback);
+
+error_t tlsSendFile(TlsContext *context, void *file,
+   TlsFileReadCallback readCallback, uint64_t offset, size_t length,
+   size_t *written);
+
 error_t tlsRead(TlsContext *context, void *data,
    size_t size, size_t *received, uint_t flags);
 
+error_t tlsReadBorrow(TlsContext *context, const uint8_t **data,
+   size_t *length);
+
+error_t tlsReadRelease(TlsContext *context, size_t consumed);
+
+error_t tlsHandshakeStep(TlsContext *context, uint_t *events,
+   systime_t *timeout);
+
 bool_t tlsIsTxReady(TlsContext *context);
 bool_t tlsIsRxReady(TlsContext *context);
 
@@ -2373,11 +4658,299 @@ error_t tlsSaveSessionState(const TlsContext *context,
 error_t tlsRestoreSessionState(TlsContext *context,
    const TlsSessionState *session);
 
+error_t tlsExportSessionState(const TlsSessionState *session, uint8_t *output,
+   size_t *length);
+
+error_t tlsImportSessionState(const uint8_t *input, size_t length,
+   TlsSessionState *session);
+
+error_t tlsExportConnectionState(TlsContext *context, uint8_t *output,
+   size_t *length);
+
+error_t tlsImportConnectionState(TlsContext *context, const uint8_t *input,
+   size_t length);
+
 void tlsFreeSessionState(TlsSessionState *session);
 
+TlsCredential *tlsInitCredential(const char_t *certChain,
+   size_t certChainLen, const char_t *privateKey, size_t privateKeyLen);
+
+void tlsFreeCredential(TlsCredential *credential);
+
+TlsTrustStore *tlsInitTrustStore(const char_t *trustedCaList, size_t length);
+void tlsFreeTrustStore(TlsTrustStore *trustStore);
+
+TlsCertVerifyCache *tlsInitCertVerifyCache(uint_t size);
+void tlsFreeCertVerifyCache(TlsCertVerifyCache *cache);
+
+TlsVerifyPool *tlsInitVerifyPool(void);
+error_t tlsRunVerifyPool(TlsVerifyPool *verifyPool, systime_t timeout);
+void tlsFreeVerifyPool(TlsVerifyPool *verifyPool);
+
+TlsHandshakeExecutor *tlsInitHandshakeExecutor(uint_t numWorkers,
+   uint_t queueSize);
+
+error_t tlsSetHandshakeExecutorCallback(TlsHandshakeExecutor *executor,
+   TlsHandshakeStepCallback callback, void *param);
+
+error_t tlsSubmitHandshakeStep(TlsHandshakeExecutor *executor,
+   TlsContext *context);
+
+error_t tlsRunHandshakeExecutor(TlsHandshakeExecutor *executor,
+   uint_t index, systime_t timeout);
+
+void tlsFreeHandshakeExecutor(TlsHandshakeExecutor *executor);
+
+TlsOcspCache *tlsInitOcspCache(uint_t size,
+   TlsOcspFetchCallback fetchCallback, void *param);
+
+error_t tlsAddOcspCacheEntry(TlsOcspCache *cache, const void *certId);
+
+error_t tlsSetOcspResponse(TlsOcspCache *cache, const void *certId,
+   const uint8_t *response, size_t length, systime_t lifetime);
+
+error_t tlsRefreshOcspCache(TlsOcspCache *cache);
+void tlsFreeOcspCache(TlsOcspCache *cache);
+
+TlsCertStore *tlsInitCertStore(uint_t size, systime_t idleTimeout,
+   TlsCertStoreLoadCallback loadCallback, void *param);
+
+error_t tlsAddCertStoreEntry(TlsCertStore *store, const char_t *name,
+   TlsCredential *const *credentials, uint_t numCredentials);
+
+error_t tlsRemoveCertStoreEntry(TlsCertStore *store, const char_t *name);
+void tlsFreeCertStore(TlsCertStore *store);
+
+error_t tlsGetContextStats(TlsContext *context, TlsContextStats *stats);
+error_t tlsGetGlobalStats(TlsGlobalStats *stats);
+void tlsResetGlobalStats(void);
+
+TlsConfig *tlsInitConfig(void);
+
+error_t tlsConfigSetTransportProtocol(TlsConfig *config,
+   TlsTransportProtocol transportProtocol);
+
+error_t tlsConfigSetConnectionEnd(TlsConfig *config, TlsConnectionEnd entity);
+
+error_t tlsConfigSetPrng(TlsConfig *config, const PrngAlgo *prngAlgo,
+   void *prngContext);
+
+error_t tlsConfigSetVersion(TlsConfig *config, uint16_t versionMin,
+   uint16_t versionMax);
+
+error_t tlsConfigSetCipherSuites(TlsConfig *config,
+   const uint16_t *cipherSuites, uint_t length);
+
+error_t tlsConfigSetCipherSuiteGroups(TlsConfig *config,
+   const uint8_t *groups, uint_t length);
+
+error_t tlsConfigSetSupportedGroups(TlsConfig *config,
+   const uint16_t *groups, uint_t length);
+
+error_t tlsConfigSetPreferredGroup(TlsConfig *config, uint16_t group);
+error_t tlsConfigSetSpeculativeGroup(TlsConfig *config, uint16_t group);
+
+error_t tlsConfigSetDhParameters(TlsConfig *config, const char_t *params,
+   size_t length);
+
+error_t tlsConfigSetClientAuthMode(TlsConfig *config, TlsClientAuthMode mode);
+error_t tlsConfigSetCache(TlsConfig *config, TlsCache *cache);
+error_t tlsConfigSetSessionStore(TlsConfig *config, TlsSessionStore *store);
+
+error_t tlsConfigSetBufferSize(TlsConfig *config, size_t txBufferSize,
+   size_t rxBufferSize);
+
+error_t tlsConfigSetBufferPool(TlsConfig *config, TlsBufferPool *bufferPool);
+error_t tlsConfigSetKeyPairPool(TlsConfig *config, TlsKeyPairPool *keyPairPool);
+error_t tlsConfigEnableBufferRelease(TlsConfig *config, bool_t enabled);
+error_t tlsConfigEnableBufferShrink(TlsConfig *config, bool_t enabled);
+error_t tlsConfigEnableClientHelloTemplate(TlsConfig *config, bool_t enabled);
+
+error_t tlsConfigSetMaxFragmentLength(TlsConfig *config, size_t maxFragLen);
+
+error_t tlsConfigSetEcdhCallback(TlsConfig *config,
+   TlsEcdhCallback ecdhCallback);
+
+error_t tlsConfigSetEcdsaSignCallback(TlsConfig *config,
+   TlsEcdsaSignCallback ecdsaSignCallback);
+
+error_t tlsConfigSetEcdsaVerifyCallback(TlsConfig *config,
+   TlsEcdsaVerifyCallback ecdsaVerifyCallback);
+
+error_t tlsConfigSetAsyncSignCallback(TlsConfig *config,
+   TlsAsyncSignCallback asyncSignCallback, void *param);
+
+error_t tlsConfigSetCryptoProviders(TlsConfig *config,
+   const TlsCryptoProvider *const *providers, uint_t numProviders);
+
+error_t tlsConfigSetKeyLogCallback(TlsConfig *config,
+   TlsKeyLogCallback keyLogCallback);
+
+error_t tlsConfigSetHandshakeTraceCallback(TlsConfig *config,
+   TlsHandshakeTraceCallback traceCallback, void *param);
+
+error_t tlsConfigAllowUnknownAlpnProtocols(TlsConfig *config, bool_t allowed);
+
+error_t tlsConfigSetAlpnProtocolList(TlsConfig *config,
+   const char_t *protocolList);
+
+error_t tlsConfigSetPskIdentityHint(TlsConfig *config,
+   const char_t *pskIdentityHint);
+
+error_t tlsConfigSetPskCallback(TlsConfig *config, TlsPskCallback pskCallback);
+
+error_t tlsConfigSetRpkVerifyCallback(TlsConfig *config,
+   TlsRpkVerifyCallback rpkVerifyCallback);
+
+error_t tlsConfigSetTrustedCaList(TlsConfig *config,
+   const char_t *trustedCaList, size_t length);
+
+error_t tlsConfigSetTrustStore(TlsConfig *config, TlsTrustStore *trustStore);
+
+error_t tlsConfigSetCertVerifyCache(TlsConfig *config,
+   TlsCertVerifyCache *certVerifyCache);
+
+error_t tlsConfigSetVerifyPool(TlsConfig *config, TlsVerifyPool *verifyPool);
+
+error_t tlsConfigSetOcspCache(TlsConfig *config, TlsOcspCache *ocspCache);
+error_t tlsConfigEnableOcspStapling(TlsConfig *config, bool_t enabled);
+
+error_t tlsConfigSetOcspResponseCallback(TlsConfig *config,
+   TlsOcspResponseCallback ocspResponseCallback, void *param);
+
+error_t tlsConfigEnableFalseStart(TlsConfig *config, bool_t enabled);
+error_t tlsConfigEnableFastOpen(TlsConfig *config, bool_t enabled);
+
+error_t tlsConfigSetCertStore(TlsConfig *config, TlsCertStore *certStore);
+error_t tlsConfigAddCredential(TlsConfig *config, TlsCredential *credential);
+
+error_t tlsConfigSetCertificateVerifyCallback(TlsConfig *config,
+   TlsCertVerifyCallback certVerifyCallback, void *param);
+
+error_t tlsConfigEnableSecureRenegotiation(TlsConfig *config, bool_t enabled);
+error_t tlsConfigEnableFallbackScsv(TlsConfig *config, bool_t enabled);
+
+error_t tlsConfigSetTicketCallbacks(TlsConfig *config,
+   TlsTicketEncryptCallback ticketEncryptCallback,
+   TlsTicketDecryptCallback ticketDecryptCallback, void *param);
+
+error_t tlsConfigEnableSessionTickets(TlsConfig *config, bool_t enabled);
+
+error_t tlsConfigAddCertCompressionAlgo(TlsConfig *config,
+   TlsCertCompressionAlgo algorithm, TlsCertCompressCallback compressCallback,
+   TlsCertDecompressCallback decompressCallback, void *param);
+
+error_t tlsConfigSetExtCacheCallbacks(TlsConfig *config,
+   TlsExtCacheGetCallback getCallback, TlsExtCachePutCallback putCallback,
+   TlsExtCacheDeleteCallback deleteCallback, void *param);
+
+error_t tlsConfigSetPmtu(TlsConfig *config, size_t pmtu);
+error_t tlsConfigEnableRecordPacking(TlsConfig *config, bool_t enabled);
+error_t tlsConfigSetTimeout(TlsConfig *config, systime_t timeout);
+
+error_t tlsConfigSetCookieCallbacks(TlsConfig *config,
+   DtlsCookieGenerateCallback cookieGenerateCallback,
+   DtlsCookieVerifyCallback cookieVerifyCallback, void *param);
+
+error_t tlsConfigEnableReplayDetection(TlsConfig *config, bool_t enabled);
+error_t tlsConfigSetReplayWindowSize(TlsConfig *config, uint_t size);
+
+error_t tlsConfigSetMaxEarlyDataSize(TlsConfig *config,
+   size_t maxEarlyDataSize);
+
+error_t tlsConfigSetAntiReplay(TlsConfig *config, TlsAntiReplay *antiReplay);
+error_t tlsConfigSetNewSessionTicketCount(TlsConfig *config, uint_t count);
+error_t tlsConfigEnableDeferredTickets(TlsConfig *config, bool_t enabled);
+
+error_t tlsFreezeConfig(TlsConfig *config);
+void tlsFreeConfig(TlsConfig *config);
+
+TlsConfigSlot *tlsInitConfigSlot(TlsConfig *config);
+error_t tlsPublishConfig(TlsConfigSlot *slot, TlsConfig *config);
+TlsConfig *tlsAcquireConfig(TlsConfigSlot *slot);
+uint_t tlsGetConfigGeneration(TlsConfigSlot *slot);
+void tlsFreeConfigSlot(TlsConfigSlot *slot);
+
+error_t tlsInitMemPool(void);
+
+error_t tlsConfigureMemPool(TlsMemClass objClass, size_t slotSize,
+   uint_t maxFreeObjects);
+
+error_t tlsGetMemPoolStats(TlsMemClass objClass, TlsMemPoolStats *stats);
+void *tlsMemPoolAlloc(TlsMemClass objClass, size_t size);
+void *tlsStatsAllocMem(size_t size);
+void tlsMemPoolFree(TlsMemClass objClass, void *p);
+void tlsFreeMemPool(void);
+
+error_t tlsSetHandshakeArenaSize(TlsContext *context, size_t size);
+error_t tlsConfigSetHandshakeArenaSize(TlsConfig *config, size_t size);
+
+void *tlsArenaAllocObject(TlsContext *context, TlsMemClass objClass,
+   size_t size);
+
+void tlsArenaFreeObject(TlsContext *context, TlsMemClass objClass, void *p);
+
+void *tlsArenaAllocMem(TlsContext *context, size_t size);
+void tlsArenaFreeMem(TlsContext *context, void *p);
+
+TlsBufferPool *tlsInitBufferPool(size_t bufferSize, uint_t maxFreeBuffers);
+TlsBufferPool *tlsInitRegisteredBufferPool(size_t bufferSize,
+   uint_t numBuffers);
+error_t tlsGetBufferPoolRegion(TlsBufferPool *bufferPool, uint8_t **region,
+   size_t *bufferSize, uint_t *numBuffers);
+int_t tlsGetRegisteredBufferIndex(TlsBufferPool *bufferPool,
+   const void *data);
+void tlsFreeBufferPool(TlsBufferPool *bufferPool);
+
+TlsKeyPairPool *tlsInitKeyPairPool(const PrngAlgo *prngAlgo, void *prngContext);
+
+error_t tlsAddKeyPairPoolGroup(TlsKeyPairPool *keyPairPool,
+   uint16_t namedGroup, uint_t lowWatermark, uint_t highWatermark);
+
+error_t tlsRefillKeyPairPool(TlsKeyPairPool *keyPairPool, systime_t timeout);
+void tlsFreeKeyPairPool(TlsKeyPairPool *keyPairPool);
+
 TlsCache *tlsInitCache(uint_t size);
+TlsCache *tlsInitCacheEx(uint_t size, uint_t numShards, uint_t numBuckets);
+TlsCache *tlsInitCacheBudget(size_t budget, uint_t numShards);
+error_t tlsSetCacheLifetime(TlsCache *cache, systime_t lifetime);
 void tlsFreeCache(TlsCache *cache);
 
+TlsSessionStore *tlsInitSessionStore(uint_t size, uint_t maxTickets,
+   systime_t maxAge);
+
+void tlsFreeSessionStore(TlsSessionStore *store);
+
+TlsAntiReplay *tlsInitAntiReplay(size_t filterSize, uint_t numShards,
+   systime_t window);
+
+void tlsFreeAntiReplay(TlsAntiReplay *antiReplay);
+
+DtlsListener *dtlsInitListener(TlsSocketHandle socketHandle,
+   DtlsListenerSendCallback sendCallback,
+   DtlsListenerReceiveCallback receiveCallback, size_t bufferSize,
+   uint_t numBuckets);
+
+error_t dtlsSetListenerCookieCallbacks(DtlsListener *listener,
+   DtlsCookieGenerateCallback cookieGenerateCallback,
+   DtlsCookieVerifyCallback cookieVerifyCallback, void *param);
+
+error_t dtlsSetListenerAcceptCallback(DtlsListener *listener,
+   DtlsListenerAcceptCallback acceptCallback, void *param);
+
+error_t dtlsSetListenerCidLength(DtlsListener *listener, size_t length);
+
+error_t dtlsSetListenerBatchCallbacks(DtlsListener *listener,
+   DtlsListenerSendBatchCallback sendBatchCallback,
+   DtlsListenerReceiveBatchCallback receiveBatchCallback, uint_t batchSize);
+
+error_t dtlsPollListener(DtlsListener *listener, TlsContext **context);
+void dtlsFreeListener(DtlsListener *listener);
+
+DtlsTimerWheel *dtlsInitTimerWheel(systime_t resolution);
+error_t dtlsPollTimerWheel(DtlsTimerWheel *timerWheel, TlsContext **context);
+void dtlsFreeTimerWheel(DtlsTimerWheel *timerWheel);
+
 //C++ guard
 #ifdef __cplusplus
 }
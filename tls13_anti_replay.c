@@ -0,0 +1,270 @@
+/**
+ * @file tls13_anti_replay.c
+ * @brief 0-RTT anti-replay protection
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls13_anti_replay.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_SERVER_SUPPORT == ENABLED && \
+   TLS_MAX_VERSION >= TLS_VERSION_1_3)
+
+
+/**
+ * @brief Anti-replay store initialization
+ *
+ * The server records the PSK binder of every ClientHello that carries early
+ * data (refer to RFC 8446, section 8.2). Binders are HMAC values, so their
+ * bytes are used directly as Bloom filter indices. Each shard maintains two
+ * filters that rotate every time window, which bounds the memory footprint
+ * regardless of the connection rate. A false positive merely causes 0-RTT to
+ * be rejected
+ *
+ * @param[in] filterSize Size of each Bloom filter, in bytes
+ * @param[in] numShards Number of independently locked shards
+ * @param[in] window Duration of a time window, in milliseconds. It must not
+ *   be shorter than the ticket age tolerance
+ * @return Handle referencing the fully initialized anti-replay store
+ **/
+
+TlsAntiReplay *tlsInitAntiReplay(size_t filterSize, uint_t numShards,
+   systime_t window)
+{
+   uint_t i;
+   size_t n;
+   uint8_t *p;
+   systime_t time;
+   TlsAntiReplay *antiReplay;
+
+   //Make sure the parameters are acceptable
+   if(filterSize < 1 || numShards < 1 || window < TLS13_TICKET_AGE_TOLERANCE)
+      return NULL;
+
+   //Size of the memory required
+   n = sizeof(TlsAntiReplay) + numShards * (sizeof(TlsAntiReplayShard) +
+      2 * filterSize);
+
+   //Allocate a memory buffer to hold the anti-replay store
+   antiReplay = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(antiReplay == NULL)
+      return NULL;
+
+   //Clear memory
+   memset(antiReplay, 0, n);
+
+   //Save parameters
+   antiReplay->numShards = numShards;
+   antiReplay->filterSize = filterSize;
+   antiReplay->window = window;
+
+   //The shard descriptors are located after the store descriptor
+   antiReplay->shards = (TlsAntiReplayShard *) (antiReplay + 1);
+   //The Bloom filters are located after the shard descriptors
+   p = (uint8_t *) (antiReplay->shards + numShards);
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Loop through the shards
+   for(i = 0; i < numShards; i++)
+   {
+      //Create a mutex to prevent simultaneous access to the shard
+      if(!osCreateMutex(&antiReplay->shards[i].mutex))
+      {
+         //Clean up side effects
+         while(i-- > 0)
+         {
+            osDeleteMutex(&antiReplay->shards[i].mutex);
+         }
+
+         //Release previously allocated memory
+         tlsFreeMem(antiReplay);
+         //Report an error
+         return NULL;
+      }
+
+      //Assign the Bloom filters of the shard
+      antiReplay->shards[i].current = p;
+      antiReplay->shards[i].previous = p + filterSize;
+      antiReplay->shards[i].timestamp = time;
+
+      //Point to the next pair of filters
+      p += 2 * filterSize;
+   }
+
+   //Return a pointer to the newly created anti-replay store
+   return antiReplay;
+}
+
+
+/**
+ * @brief Record a ClientHello and check whether it has already been seen
+ * @param[in] antiReplay Pointer to the anti-replay store
+ * @param[in] binderList List of PSK binders offered by the client
+ * @return TRUE if the ClientHello is fresh, FALSE if it may be a replay
+ **/
+
+bool_t tls13CheckAntiReplay(TlsAntiReplay *antiReplay,
+   const Tls13PskBinderList *binderList)
+{
+   uint_t i;
+   uint32_t k;
+   uint32_t numBits;
+   bool_t fresh;
+   bool_t inCurrent;
+   bool_t inPrevious;
+   uint8_t *filter;
+   systime_t time;
+   TlsAntiReplayShard *shard;
+   const Tls13PskBinder *binder;
+
+   //Point to the binder of the first PSK offered by the client
+   binder = (const Tls13PskBinder *) binderList->value;
+
+   //The binder must provide enough bytes to derive the Bloom filter indices
+   if(ntohs(binderList->length) < (sizeof(Tls13PskBinder) + binder->length) ||
+      binder->length < (4 * (TLS13_ANTI_REPLAY_NUM_HASHES + 1)))
+   {
+      return FALSE;
+   }
+
+   //Select the relevant shard
+   shard = &antiReplay->shards[LOAD32BE(binder->value) % antiReplay->numShards];
+   //Number of bits in each Bloom filter
+   numBits = (uint32_t) antiReplay->filterSize * 8;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Acquire exclusive access to the shard
+   osAcquireMutex(&shard->mutex);
+
+   //Both time windows have elapsed?
+   if((time - shard->timestamp) >= (2 * antiReplay->window))
+   {
+      //Clear both filters
+      memset(shard->current, 0, antiReplay->filterSize);
+      memset(shard->previous, 0, antiReplay->filterSize);
+      shard->timestamp = time;
+   }
+   else if((time - shard->timestamp) >= antiReplay->window)
+   {
+      //Rotate the filters
+      filter = shard->previous;
+      shard->previous = shard->current;
+      shard->current = filter;
+
+      //Start a new time window
+      memset(shard->current, 0, antiReplay->filterSize);
+      shard->timestamp += antiReplay->window;
+   }
+
+   //Initialize flags
+   inCurrent = TRUE;
+   inPrevious = TRUE;
+
+   //Check whether the binder is present in the filters
+   for(i = 1; i <= TLS13_ANTI_REPLAY_NUM_HASHES; i++)
+   {
+      //Derive the index of the bit from the binder value
+      k = LOAD32BE(binder->value + 4 * i) % numBits;
+
+      //Test the corresponding bits
+      if((shard->current[k / 8] & (1 << (k % 8))) == 0)
+         inCurrent = FALSE;
+      if((shard->previous[k / 8] & (1 << (k % 8))) == 0)
+         inPrevious = FALSE;
+   }
+
+   //The ClientHello has not been seen during the last two time windows?
+   fresh = (!inCurrent && !inPrevious) ? TRUE : FALSE;
+
+   //Check whether the ClientHello is fresh
+   if(fresh)
+   {
+      //Record the binder value in the current filter
+      for(i = 1; i <= TLS13_ANTI_REPLAY_NUM_HASHES; i++)
+      {
+         k = LOAD32BE(binder->value + 4 * i) % numBits;
+         shard->current[k / 8] |= (uint8_t) (1 << (k % 8));
+      }
+   }
+   else
+   {
+      //Update statistics
+      shard->replayCount++;
+   }
+
+   //Release exclusive access to the shard
+   osReleaseMutex(&shard->mutex);
+
+   //Debug message
+   if(!fresh)
+   {
+      TRACE_INFO("Possible 0-RTT replay detected!\r\n");
+   }
+
+   //Return TRUE if the ClientHello is fresh
+   return fresh;
+}
+
+
+/**
+ * @brief Properly dispose an anti-replay store
+ * @param[in] antiReplay Pointer to the anti-replay store
+ **/
+
+void tlsFreeAntiReplay(TlsAntiReplay *antiReplay)
+{
+   uint_t i;
+
+   //Valid anti-replay store?
+   if(antiReplay != NULL)
+   {
+      //Loop through the shards
+      for(i = 0; i < antiReplay->numShards; i++)
+      {
+         //Release mutex object
+         osDeleteMutex(&antiReplay->shards[i].mutex);
+      }
+
+      //Properly dispose the anti-replay store
+      tlsFreeMem(antiReplay);
+   }
+}
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @file tls13_anti_replay.h
+ * @brief 0-RTT anti-replay protection
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS13_ANTI_REPLAY_H
+#define _TLS13_ANTI_REPLAY_H
+
+//Dependencies
+#include "tls.h"
+#include "tls13_misc.h"
+
+//Number of bits set in the Bloom filters for each ClientHello
+#ifndef TLS13_ANTI_REPLAY_NUM_HASHES
+   #define TLS13_ANTI_REPLAY_NUM_HASHES 4
+#elif (TLS13_ANTI_REPLAY_NUM_HASHES < 1 || TLS13_ANTI_REPLAY_NUM_HASHES > 7)
+   #error TLS13_ANTI_REPLAY_NUM_HASHES parameter is not valid
+#endif
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//0-RTT anti-replay related functions
+bool_t tls13CheckAntiReplay(TlsAntiReplay *antiReplay,
+   const Tls13PskBinderList *binderList);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
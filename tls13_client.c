@@ -41,6 +41,7 @@
 #include "tls_extensions.h"
 #include "tls_transcript_hash.h"
 #include "tls_misc.h"
+#include "tls_session_store.h"
 #include "tls13_client.h"
 #include "tls13_client_extensions.h"
 #include "tls13_key_material.h"
@@ -98,7 +99,7 @@ error_t tls13SendEndOfEarlyData(TlsContext *context)
 
       //Calculate client handshake traffic keys
       error = tlsInitEncryptionEngine(context, &context->encryptionEngine,
-         TLS_CONNECTION_END_CLIENT, context->clientHsTrafficSecret);
+         TLS_CONNECTION_END_CLIENT, context->handshake->clientHsTrafficSecret);
 
       //Handshake traffic keys successfully calculated?
       if(!error)
@@ -546,7 +547,8 @@ error_t tls13ParseEncryptedExtensions(TlsContext *context,
 
       //Calculate client early traffic keys
       error = tlsInitEncryptionEngine(context, &context->encryptionEngine,
-         TLS_CONNECTION_END_CLIENT, context->clientEarlyTrafficSecret);
+         TLS_CONNECTION_END_CLIENT,
+         context->handshake->clientEarlyTrafficSecret);
       //Any error to report?
       if(error)
          return error;
@@ -676,13 +678,13 @@ error_t tls13ParseNewSessionTicket(TlsContext *context,
          {
             //Release memory
             memset(context->ticket, 0, context->ticketLen);
-            tlsFreeMem(context->ticket);
+            tlsFreeObject(TLS_MEM_CLASS_TICKET, context->ticket);
             context->ticket = NULL;
             context->ticketLen = 0;
          }
 
          //Allocate a memory block to hold the ticket
-         context->ticket = tlsAllocMem(n);
+         context->ticket = tlsAllocObject(TLS_MEM_CLASS_TICKET, n);
          //Failed to allocate memory?
          if(context->ticket == NULL)
             return ERROR_OUT_OF_MEMORY;
@@ -734,6 +736,12 @@ error_t tls13ParseNewSessionTicket(TlsContext *context,
          //Debug message
          TRACE_DEBUG("Ticket PSK:\r\n");
          TRACE_DEBUG_ARRAY("  ", context->ticketPsk, context->ticketPskLen);
+
+         //Each ticket is kept separately in the session store, if any
+         error = tlsSaveToSessionStore(context);
+         //Any error to report?
+         if(error)
+            return error;
       }
    }
 
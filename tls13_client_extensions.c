@@ -186,6 +186,33 @@ error_t tls13FormatClientKeyShareExtension(TlsContext *context,
       //selection from the server, at the cost of an additional round trip
    }
 
+#if (TLS13_ECDHE_KE_SUPPORT == ENABLED || TLS13_PSK_ECDHE_KE_SUPPORT == ENABLED)
+   //Any speculative key share?
+   if(n > 0 && context->speculativeShareGroup != TLS_GROUP_NONE)
+   {
+      size_t k;
+
+      //Point to the next KeyShareEntry
+      keyShareEntry = (Tls13KeyShareEntry *) (keyShareList->value + n);
+      //Specify the named group for the key being exchanged
+      keyShareEntry->group = htons(context->speculativeShareGroup);
+
+      //ECDHE parameters are encoded in the opaque key_exchange field of
+      //the KeyShareEntry
+      error = ecExport(&context->speculativeEcdhContext.params,
+         &context->speculativeEcdhContext.qa, keyShareEntry->keyExchange, &k);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Set the length of the key_exchange field
+      keyShareEntry->length = htons(k);
+
+      //Adjust the length of the list
+      n += sizeof(Tls13KeyShareEntry) + k;
+   }
+#endif
+
    //Fix the length of the list of offered key shares
    keyShareList->length = htons(n);
 
@@ -586,6 +613,17 @@ error_t tls13ParseSelectedGroupExtension(TlsContext *context,
       //intends to negotiate
       namedGroup = LOAD16BE(selectedGroup);
 
+      //The selected group must not correspond to a group for which a key
+      //share has already been sent (refer to RFC 8446, section 4.2.8)
+      if(context->speculativeShareGroup != TLS_GROUP_NONE &&
+         namedGroup == context->speculativeShareGroup)
+      {
+         return ERROR_ILLEGAL_PARAMETER;
+      }
+
+      //The updated ClientHello carries a single key share
+      tls13FreeSpeculativeKeyShare(context);
+
       //Check whether the server has selected a different ECDHE or FFDHE group
       if(namedGroup != context->namedGroup)
       {
@@ -651,6 +689,27 @@ error_t tls13ParseServerKeyShareExtension(TlsContext *context,
          return ERROR_ILLEGAL_PARAMETER;
       }
 
+#if (TLS13_ECDHE_KE_SUPPORT == ENABLED || TLS13_PSK_ECDHE_KE_SUPPORT == ENABLED)
+      //The server may have picked the speculative key share
+      if(namedGroup != context->namedGroup &&
+         namedGroup == context->speculativeShareGroup)
+      {
+         EcdhContext ecdhContext;
+
+         //Swap the ECDH contexts so that the shared secret is computed using
+         //the speculative key pair
+         ecdhContext = context->ecdhContext;
+         context->ecdhContext = context->speculativeEcdhContext;
+         context->speculativeEcdhContext = ecdhContext;
+
+         //Save the named group selected by the server
+         context->namedGroup = namedGroup;
+      }
+
+      //The unused key share is no longer needed
+      tls13FreeSpeculativeKeyShare(context);
+#endif
+
       //The client must verify that the selected NamedGroup in the ServerHello
       //is the same as that in the HelloRetryRequest
       if(namedGroup != context->namedGroup)
@@ -34,6 +34,7 @@
 //Dependencies
 #include <string.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_handshake.h"
 #include "tls_client.h"
 #include "tls_common.h"
@@ -103,8 +104,11 @@ error_t tls13ComputePskBinders(TlsContext *context, const void *clientHello,
    size_t truncatedClientHelloLen;
    uint8_t *q;
    const uint8_t *p;
+   const HashAlgo *hash;
    Tls13PskBinder *binder;
    const Tls13PskIdentity *identity;
+   uint8_t key[TLS_MAX_HKDF_DIGEST_SIZE];
+   uint8_t digest[TLS_MAX_HKDF_DIGEST_SIZE];
 
    //Initialize status code
    error = NO_ERROR;
@@ -128,17 +132,43 @@ error_t tls13ComputePskBinders(TlsContext *context, const void *clientHello,
       //hash containing a partial ClientHello up to the binders list itself
       truncatedClientHelloLen = (uint8_t *) binderList - (uint8_t *) clientHello;
 
+      //The hash function used by HKDF is the cipher suite hash algorithm
+      hash = context->cipherSuite.prfHashAlgo;
+      //Make sure the hash algorithm is valid
+      if(hash == NULL)
+         return ERROR_FAILURE;
+
+      //The transcript hash is shared by all the binders, so the partial
+      //ClientHello is only digested once
+      error = tls13DigestPartialClientHello(context, clientHello,
+         clientHelloLen, truncatedClientHelloLen, digest);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Derive the binder key once for all the binders
+      error = tls13ComputeBinderKey(context, key);
+      //Any error to report?
+      if(error)
+         return error;
+
       //Loop through the list of PSK identities
-      while(n > 0)
+      while(n > 0 && !error)
       {
          //Point to the current PskIdentity entry
          identity = (Tls13PskIdentity *) p;
 
          //Malformed PreSharedKey extension?
          if(n < sizeof(TlsPskIdentity))
-            return ERROR_DECODING_FAILED;
+         {
+            error = ERROR_DECODING_FAILED;
+            break;
+         }
          if(n < (sizeof(TlsPskIdentity) + ntohs(identity->length)))
-            return ERROR_DECODING_FAILED;
+         {
+            error = ERROR_DECODING_FAILED;
+            break;
+         }
 
          //Point to the obfuscated_ticket_age field
          p += sizeof(TlsPskIdentity) + ntohs(identity->length);
@@ -146,7 +176,10 @@ error_t tls13ComputePskBinders(TlsContext *context, const void *clientHello,
 
          //The obfuscated_ticket_age field is a 32-bit unsigned integer
          if(n < sizeof(uint32_t))
-            return ERROR_DECODING_FAILED;
+         {
+            error = ERROR_DECODING_FAILED;
+            break;
+         }
 
          //Point to the next PskIdentity entry
          p += sizeof(uint32_t);
@@ -157,21 +190,36 @@ error_t tls13ComputePskBinders(TlsContext *context, const void *clientHello,
 
          //Malformed PreSharedKey extension?
          if(m < sizeof(Tls13PskBinder))
-            return ERROR_DECODING_FAILED;
+         {
+            error = ERROR_DECODING_FAILED;
+            break;
+         }
          if(m < (sizeof(Tls13PskBinder) + binder->length))
-            return ERROR_DECODING_FAILED;
+         {
+            error = ERROR_DECODING_FAILED;
+            break;
+         }
 
          //Point to the next PskBinderEntry
          q += sizeof(Tls13PskBinder) + binder->length;
          m -= sizeof(Tls13PskBinder) + binder->length;
 
-         //Fix the value of the PSK binder
-         error = tls13ComputePskBinder(context, clientHello, clientHelloLen,
-            truncatedClientHelloLen, identity, binder->value, binder->length);
-         //Any error to report?
-         if(error)
-            break;
+         //Check the length of the PSK binder
+         if(binder->length != hash->digestSize)
+         {
+            error = ERROR_INVALID_LENGTH;
+         }
+         else
+         {
+            //Fix the value of the PSK binder
+            TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+            error = hmacCompute(hash, key, hash->digestSize, digest,
+               hash->digestSize, binder->value);
+         }
       }
+
+      //Clear the binder key
+      memset(key, 0, TLS_MAX_HKDF_DIGEST_SIZE);
    }
 #endif
 
@@ -221,6 +269,19 @@ error_t tls13SendEarlyData(TlsContext *context, const void *data,
    //Initialize status code
    error = NO_ERROR;
 
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED && TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   //The ClientHello and the 0-RTT data can be handed to the transport with a
+   //single call, so that they travel with the SYN segment
+   if(context->fastOpenEnabled && context->txBulkBuffer != NULL &&
+      (context->state == TLS_STATE_INIT ||
+      context->state == TLS_STATE_CLIENT_HELLO))
+   {
+      //Gather the records of the first flight in the bulk send buffer
+      context->txFlightActive = TRUE;
+      context->fastOpenFlight = TRUE;
+   }
+#endif
+
    //TLS 1.3 allows clients to send data on the first flight
    while(!error)
    {
@@ -326,6 +387,28 @@ error_t tls13SendEarlyData(TlsContext *context, const void *data,
       }
    }
 
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED && TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   //End of the first flight?
+   if(context->fastOpenFlight)
+   {
+      //The records are no longer gathered
+      context->fastOpenFlight = FALSE;
+      context->txFlightActive = FALSE;
+
+      //Check status code
+      if(!error)
+      {
+         //Send the ClientHello along with the 0-RTT data
+         error = tlsSendBulkData(context);
+
+         //The records are accepted even if the transport layer cannot send
+         //them immediately
+         if(error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+            error = NO_ERROR;
+      }
+   }
+#endif
+
    //Check status code
    if(error == NO_ERROR && length != 0 && *written == 0)
    {
@@ -36,6 +36,7 @@
 #include "tls.h"
 #include "tls_handshake.h"
 #include "tls_misc.h"
+#include "tls_buffer.h"
 #include "tls13_common.h"
 #include "tls13_key_material.h"
 #include "debug.h"
@@ -66,6 +67,12 @@ error_t tls13SendKeyUpdate(TlsContext *context)
    //Initialize pointer
    appTrafficSecret = NULL;
 
+   //The TX buffer may have been released while the connection was idle
+   error = tlsAcquireTxBuffer(context);
+   //Any error to report?
+   if(error)
+      return error;
+
    //Point to the buffer where to format the message
    message = (Tls13KeyUpdate *) (context->txBuffer + context->txBufferLen);
 
@@ -34,6 +34,7 @@
 //Dependencies
 #include <string.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_misc.h"
 #include "tls_key_material.h"
 #include "tls_transcript_hash.h"
@@ -63,9 +64,68 @@ error_t tls13HkdfExpandLabel(const HashAlgo *hash, const uint8_t *secret,
    size_t contextLen, uint8_t *output, size_t outputLen)
 {
    error_t error;
+   HmacContext *hmacContext;
+
+   //Allocate a memory buffer to hold the HMAC contexts
+   hmacContext = tlsAllocObject(TLS_MEM_CLASS_HMAC_CONTEXT,
+      2 * sizeof(HmacContext));
+
+   //Successful memory allocation?
+   if(hmacContext != NULL)
+   {
+      //Key HMAC with the secret
+      error = hmacInit(hmacContext, hash, secret, secretLen);
+
+      //Check status code
+      if(!error)
+      {
+         //Compute HKDF-Expand(Secret, HkdfLabel, Length)
+         error = tls13HkdfExpandLabelKeyed(hmacContext, hmacContext + 1,
+            label, context, contextLen, output, outputLen);
+      }
+
+      //Release previously allocated memory
+      tlsFreeObject(TLS_MEM_CLASS_HMAC_CONTEXT, hmacContext);
+   }
+   else
+   {
+      //Failed to allocate memory
+      error = ERROR_OUT_OF_MEMORY;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief HKDF-Expand-Label function using an HMAC state keyed once
+ *
+ * The HkdfLabel structure is fed to HMAC piecewise, so that it does not need
+ * to be formatted in a separate buffer. Every label derived from the same
+ * secret starts from a copy of the keyed state instead of keying HMAC again
+ *
+ * @param[in] keyedContext HMAC context keyed with the secret
+ * @param[in] hmacContext Working HMAC context
+ * @param[in] label Identifying label (NULL-terminated string)
+ * @param[in] context Pointer to the upper-layer context
+ * @param[in] contextLen Length of the upper-layer context
+ * @param[out] output Pointer to the output
+ * @param[in] outputLen Desired output length
+ * @return Error code
+ **/
+
+error_t tls13HkdfExpandLabelKeyed(const HmacContext *keyedContext,
+   HmacContext *hmacContext, const char_t *label, const uint8_t *context,
+   size_t contextLen, uint8_t *output, size_t outputLen)
+{
    size_t n;
    size_t labelLen;
-   uint8_t *hkdfLabel;
+   uint8_t i;
+   uint8_t header[3];
+   uint8_t contextLenByte;
+   uint8_t t[MAX_HASH_DIGEST_SIZE];
+   const HashAlgo *hash;
 
    //Check parameters
    if(label == NULL)
@@ -73,6 +133,12 @@ error_t tls13HkdfExpandLabel(const HashAlgo *hash, const uint8_t *secret,
    if(context == NULL && contextLen != 0)
       return ERROR_INVALID_PARAMETER;
 
+   //Account for the HMAC-based derivation
+   TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+
+   //Hash function used by HKDF
+   hash = keyedContext->hash;
+
    //Retrieve the length of the label
    labelLen = strlen(label);
 
@@ -80,41 +146,49 @@ error_t tls13HkdfExpandLabel(const HashAlgo *hash, const uint8_t *secret,
    if(labelLen > (255 - 6) || contextLen > 255)
       return ERROR_INVALID_LENGTH;
 
-   //Compute the length of the HkdfLabel structure
-   n = labelLen + contextLen + 10;
-   //Allocate a memory buffer to hold the HkdfLabel structure
-   hkdfLabel = tlsAllocMem(n);
-
-   //Successful memory allocation?
-   if(hkdfLabel != NULL)
-   {
-      //Format the HkdfLabel structure
-      hkdfLabel[0] = MSB(outputLen);
-      hkdfLabel[1] = LSB(outputLen);
-      hkdfLabel[2] = (uint8_t) (labelLen + 6);
-      memcpy(hkdfLabel + 3, "tls13 ", 6);
-      memcpy(hkdfLabel + 9, label, labelLen);
-      hkdfLabel[labelLen + 9] = (uint8_t) contextLen;
-      memcpy(hkdfLabel + labelLen + 10, context, contextLen);
-
-      //Debug message
-      TRACE_DEBUG("HkdfLabel (%" PRIuSIZE " bytes):\r\n", n);
-      TRACE_DEBUG_ARRAY("  ", hkdfLabel, n);
+   //The output length is limited to 255 times the digest size
+   if(outputLen > (255 * hash->digestSize))
+      return ERROR_INVALID_LENGTH;
 
-      //Compute HKDF-Expand(Secret, HkdfLabel, Length)
-      error = hkdfExpand(hash, secret, secretLen, hkdfLabel, n, output, outputLen);
+   //The HkdfLabel structure starts with the length of the output and the
+   //length of the full label
+   header[0] = MSB(outputLen);
+   header[1] = LSB(outputLen);
+   header[2] = (uint8_t) (labelLen + 6);
+   //The length of the context precedes the context itself
+   contextLenByte = (uint8_t) contextLen;
 
-      //Release previously allocated memory
-      tlsFreeMem(hkdfLabel);
-   }
-   else
+   //T(0) is an empty string
+   for(i = 1; outputLen > 0; i++)
    {
-      //Failed to allocate memory
-      error = ERROR_OUT_OF_MEMORY;
+      //Start from the keyed HMAC state
+      memcpy(hmacContext, keyedContext, sizeof(HmacContext));
+
+      //Compute T(i) = HMAC-Hash(PRK, T(i-1) | HkdfLabel | i)
+      if(i > 1)
+         hmacUpdate(hmacContext, t, hash->digestSize);
+
+      hmacUpdate(hmacContext, header, sizeof(header));
+      hmacUpdate(hmacContext, TLS13_LABEL_PREFIX, 6);
+      hmacUpdate(hmacContext, label, labelLen);
+      hmacUpdate(hmacContext, &contextLenByte, sizeof(uint8_t));
+      hmacUpdate(hmacContext, context, contextLen);
+      hmacUpdate(hmacContext, &i, sizeof(uint8_t));
+      hmacFinal(hmacContext, t);
+
+      //Calculate the number of bytes to copy
+      n = MIN(outputLen, hash->digestSize);
+      //Copy the resulting block
+      memcpy(output, t, n);
+
+      //Advance data pointer
+      output += n;
+      //Decrement byte counter
+      outputLen -= n;
    }
 
-   //Return status code
-   return error;
+   //Successful processing
+   return NO_ERROR;
 }
 
 
@@ -182,6 +256,137 @@ error_t tls13DeriveSecret(TlsContext *context, const uint8_t *secret,
 }
 
 
+/**
+ * @brief Derive the client and server secrets of an epoch
+ *
+ * The transcript hash is computed once and HMAC is keyed once with the
+ * secret, then both labels are expanded from copies of the keyed state
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] secret Pointer to the secret
+ * @param[in] secretLen Length of the secret
+ * @param[in] clientLabel Label of the client secret (NULL-terminated string)
+ * @param[out] clientSecret Client secret (Hash.length bytes)
+ * @param[in] serverLabel Label of the server secret (NULL-terminated string)
+ * @param[out] serverSecret Server secret (Hash.length bytes)
+ * @return Error code
+ **/
+
+error_t tls13DeriveSecretPair(TlsContext *context, const uint8_t *secret,
+   size_t secretLen, const char_t *clientLabel, uint8_t *clientSecret,
+   const char_t *serverLabel, uint8_t *serverSecret)
+{
+   error_t error;
+   const HashAlgo *hash;
+   HmacContext *hmacContext;
+   uint8_t digest[TLS_MAX_HKDF_DIGEST_SIZE];
+
+   //The hash function used by HKDF is the cipher suite hash algorithm
+   hash = context->cipherSuite.prfHashAlgo;
+   //Make sure the hash algorithm is valid
+   if(hash == NULL)
+      return ERROR_FAILURE;
+
+   //Compute Transcript-Hash(Messages)
+   error = tlsFinalizeTranscriptHash(context, hash,
+      context->transcriptHashContext, "", digest);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Debug message
+   TRACE_DEBUG("Transcript hash (%" PRIuSIZE " bytes):\r\n", hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", digest, hash->digestSize);
+
+   //Allocate a memory buffer to hold the HMAC contexts
+   hmacContext = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_HMAC_CONTEXT,
+      2 * sizeof(HmacContext));
+   //Failed to allocate memory?
+   if(hmacContext == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Key HMAC once with the secret
+   error = hmacInit(hmacContext, hash, secret, secretLen);
+
+   //Check status code
+   if(!error)
+   {
+      //Compute HKDF-Expand-Label(Secret, ClientLabel, Transcript-Hash,
+      //Hash.length)
+      error = tls13HkdfExpandLabelKeyed(hmacContext, hmacContext + 1,
+         clientLabel, digest, hash->digestSize, clientSecret,
+         hash->digestSize);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Compute HKDF-Expand-Label(Secret, ServerLabel, Transcript-Hash,
+      //Hash.length)
+      error = tls13HkdfExpandLabelKeyed(hmacContext, hmacContext + 1,
+         serverLabel, digest, hash->digestSize, serverSecret,
+         hash->digestSize);
+   }
+
+   //Release previously allocated memory
+   tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HMAC_CONTEXT, hmacContext);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Derive the write key and IV from a traffic secret
+ * @param[in] hash Hash function used by HKDF
+ * @param[in] secret Traffic secret (Hash.length bytes)
+ * @param[out] key Write key
+ * @param[in] keyLen Length of the write key
+ * @param[out] iv Write IV
+ * @param[in] ivLen Length of the write IV
+ * @return Error code
+ **/
+
+error_t tls13DeriveTrafficKeys(const HashAlgo *hash, const uint8_t *secret,
+   uint8_t *key, size_t keyLen, uint8_t *iv, size_t ivLen)
+{
+   error_t error;
+   HmacContext *hmacContext;
+
+   //Allocate a memory buffer to hold the HMAC contexts
+   hmacContext = tlsAllocObject(TLS_MEM_CLASS_HMAC_CONTEXT,
+      2 * sizeof(HmacContext));
+   //Failed to allocate memory?
+   if(hmacContext == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Key HMAC once with the traffic secret
+   error = hmacInit(hmacContext, hash, secret, hash->digestSize);
+
+   //Check status code
+   if(!error)
+   {
+      //Calculate the write key
+      error = tls13HkdfExpandLabelKeyed(hmacContext, hmacContext + 1,
+         "key", NULL, 0, key, keyLen);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Calculate the write IV
+      error = tls13HkdfExpandLabelKeyed(hmacContext, hmacContext + 1,
+         "iv", NULL, 0, iv, ivLen);
+   }
+
+   //Release previously allocated memory
+   tlsFreeObject(TLS_MEM_CLASS_HMAC_CONTEXT, hmacContext);
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Compute early traffic keys
  * @param[in] context Pointer to the TLS context
@@ -223,33 +428,36 @@ error_t tls13GenerateEarlyTrafficKeys(TlsContext *context)
    }
 
    //Calculate early secret
-   error = hkdfExtract(hash, ikm, ikmLen, NULL, 0, context->secret);
+   TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+   error = hkdfExtract(hash, ikm, ikmLen, NULL, 0, context->handshake->secret);
    //Any error to report?
    if(error)
       return error;
 
    //Debug message
    TRACE_DEBUG("Early secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->secret, hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", context->handshake->secret, hash->digestSize);
 
    //Calculate client early traffic secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "c e traffic", NULL, 0, context->clientEarlyTrafficSecret,
-      hash->digestSize);
+   error = tls13DeriveSecret(context, context->handshake->secret,
+      hash->digestSize, "c e traffic", NULL, 0,
+      context->handshake->clientEarlyTrafficSecret, hash->digestSize);
    //Any error to report?
    if(error)
       return error;
 
    //Debug message
    TRACE_DEBUG("Client early secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->clientEarlyTrafficSecret, hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", context->handshake->clientEarlyTrafficSecret,
+      hash->digestSize);
 
    //The traffic keying material is generated from the traffic secret value
    if(context->entity == TLS_CONNECTION_END_CLIENT)
    {
       //Calculate client early traffic keys
       error = tlsInitEncryptionEngine(context, &context->encryptionEngine,
-         TLS_CONNECTION_END_CLIENT, context->clientEarlyTrafficSecret);
+         TLS_CONNECTION_END_CLIENT,
+         context->handshake->clientEarlyTrafficSecret);
    }
    else
    {
@@ -258,7 +466,8 @@ error_t tls13GenerateEarlyTrafficKeys(TlsContext *context)
       {
          //Calculate client early traffic keys
          error = tlsInitEncryptionEngine(context, &context->decryptionEngine,
-            TLS_CONNECTION_END_CLIENT, context->clientEarlyTrafficSecret);
+            TLS_CONNECTION_END_CLIENT,
+            context->handshake->clientEarlyTrafficSecret);
       }
       else
       {
@@ -272,8 +481,9 @@ error_t tls13GenerateEarlyTrafficKeys(TlsContext *context)
       return error;
 
    //Calculate early exporter master secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "e exp master", NULL, 0, context->exporterMasterSecret, hash->digestSize);
+   error = tls13DeriveSecret(context, context->handshake->secret,
+      hash->digestSize, "e exp master", NULL, 0, context->exporterMasterSecret,
+      hash->digestSize);
    //Any error to report?
    if(error)
       return error;
@@ -285,7 +495,7 @@ error_t tls13GenerateEarlyTrafficKeys(TlsContext *context)
 #if (TLS_KEY_LOG_SUPPORT == ENABLED)
    //Log client early traffic secret
    tlsDumpSecret(context, "CLIENT_EARLY_TRAFFIC_SECRET",
-      context->clientEarlyTrafficSecret, hash->digestSize);
+      context->handshake->clientEarlyTrafficSecret, hash->digestSize);
 
    //Log early exporter master secret
    tlsDumpSecret(context, "EARLY_EXPORTER_SECRET",
@@ -326,10 +536,10 @@ error_t tls13GenerateHandshakeTrafficKeys(TlsContext *context)
       context->keyExchMethod == TLS13_KEY_EXCH_ECDHE)
    {
       //If PSK is not in use, IKM is a string of Hash-lengths bytes set to 0
-      memset(context->secret, 0, hash->digestSize);
+      memset(context->handshake->secret, 0, hash->digestSize);
 
       //Point to the IKM argument
-      ikm = context->secret;
+      ikm = context->handshake->secret;
       ikmLen = hash->digestSize;
    }
    else
@@ -371,70 +581,68 @@ error_t tls13GenerateHandshakeTrafficKeys(TlsContext *context)
    }
 
    //Calculate early secret
-   error = hkdfExtract(hash, ikm, ikmLen, NULL, 0, context->secret);
+   TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+   error = hkdfExtract(hash, ikm, ikmLen, NULL, 0, context->handshake->secret);
    //Any error to report?
    if(error)
       return error;
 
    //Debug message
    TRACE_DEBUG("Early secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->secret, hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", context->handshake->secret, hash->digestSize);
 
    //Derive early secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "derived", "", 0, context->secret, hash->digestSize);
+   error = tls13DeriveSecret(context, context->handshake->secret,
+      hash->digestSize, "derived", "", 0, context->handshake->secret,
+      hash->digestSize);
    //Any error to report?
    if(error)
       return error;
 
    //Debug message
    TRACE_DEBUG("Derived secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->secret, hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", context->handshake->secret, hash->digestSize);
 
    //PSK-only key exchange method?
    if(context->keyExchMethod == TLS13_KEY_EXCH_PSK)
    {
       //If the (EC)DHE shared secret is not available, then the 0-value
       //consisting of a string of Hash.length bytes set to zeros is used
-      memset(context->premasterSecret, 0, hash->digestSize);
-      context->premasterSecretLen = hash->digestSize;
+      memset(context->handshake->premasterSecret, 0, hash->digestSize);
+      context->handshake->premasterSecretLen = hash->digestSize;
    }
 
    //Calculate handshake secret
-   error = hkdfExtract(hash, context->premasterSecret,
-      context->premasterSecretLen, context->secret, hash->digestSize,
-      context->secret);
+   TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+   error = hkdfExtract(hash, context->handshake->premasterSecret,
+      context->handshake->premasterSecretLen, context->handshake->secret,
+      hash->digestSize, context->handshake->secret);
    //Any error to report?
    if(error)
       return error;
 
    //Debug message
    TRACE_DEBUG("Handshake secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->secret, hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", context->handshake->secret, hash->digestSize);
 
-   //Calculate client handshake traffic secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "c hs traffic", NULL, 0, context->clientHsTrafficSecret,
-      hash->digestSize);
+   //Calculate client and server handshake traffic secrets
+   error = tls13DeriveSecretPair(context, context->handshake->secret,
+      hash->digestSize, "c hs traffic",
+      context->handshake->clientHsTrafficSecret, "s hs traffic",
+      context->handshake->serverHsTrafficSecret);
    //Any error to report?
    if(error)
       return error;
 
    //Debug message
    TRACE_DEBUG("Client handshake secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->clientHsTrafficSecret, hash->digestSize);
-
-   //Calculate server handshake traffic secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "s hs traffic", NULL, 0, context->serverHsTrafficSecret,
+   TRACE_DEBUG_ARRAY("  ", context->handshake->clientHsTrafficSecret,
       hash->digestSize);
-   //Any error to report?
-   if(error)
-      return error;
 
    //Debug message
    TRACE_DEBUG("Server handshake secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->serverHsTrafficSecret, hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", context->handshake->serverHsTrafficSecret,
+      hash->digestSize);
 
    //The implementation must verify that its receive buffer is empty before
    //switching to encrypted handshake
@@ -449,14 +657,15 @@ error_t tls13GenerateHandshakeTrafficKeys(TlsContext *context)
 
       //Calculate client handshake traffic keys
       error = tlsInitEncryptionEngine(context, &context->encryptionEngine,
-         TLS_CONNECTION_END_CLIENT, context->clientHsTrafficSecret);
+         TLS_CONNECTION_END_CLIENT, context->handshake->clientHsTrafficSecret);
 
       //Check status code
       if(!error)
       {
          //Calculate server handshake traffic keys
          error = tlsInitEncryptionEngine(context, &context->decryptionEngine,
-            TLS_CONNECTION_END_SERVER, context->serverHsTrafficSecret);
+            TLS_CONNECTION_END_SERVER,
+            context->handshake->serverHsTrafficSecret);
       }
    }
    else
@@ -466,14 +675,15 @@ error_t tls13GenerateHandshakeTrafficKeys(TlsContext *context)
 
       //Calculate client handshake traffic keys
       error = tlsInitEncryptionEngine(context, &context->decryptionEngine,
-         TLS_CONNECTION_END_CLIENT, context->clientHsTrafficSecret);
+         TLS_CONNECTION_END_CLIENT, context->handshake->clientHsTrafficSecret);
 
       //Check status code
       if(!error)
       {
          //Calculate server handshake traffic keys
          error = tlsInitEncryptionEngine(context, &context->encryptionEngine,
-            TLS_CONNECTION_END_SERVER, context->serverHsTrafficSecret);
+            TLS_CONNECTION_END_SERVER,
+            context->handshake->serverHsTrafficSecret);
       }
    }
 
@@ -484,11 +694,11 @@ error_t tls13GenerateHandshakeTrafficKeys(TlsContext *context)
 #if (TLS_KEY_LOG_SUPPORT == ENABLED)
    //Log client handshake traffic secret
    tlsDumpSecret(context, "CLIENT_HANDSHAKE_TRAFFIC_SECRET",
-      context->clientHsTrafficSecret, hash->digestSize);
+      context->handshake->clientHsTrafficSecret, hash->digestSize);
 
    //Log server handshake traffic secret
    tlsDumpSecret(context, "SERVER_HANDSHAKE_TRAFFIC_SECRET",
-      context->serverHsTrafficSecret, hash->digestSize);
+      context->handshake->serverHsTrafficSecret, hash->digestSize);
 #endif
 
    //In all handshakes, the server must send the EncryptedExtensions message
@@ -519,34 +729,36 @@ error_t tls13GenerateServerAppTrafficKeys(TlsContext *context)
       return ERROR_FAILURE;
 
    //Derive handshake secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "derived", "", 0, context->secret, hash->digestSize);
+   error = tls13DeriveSecret(context, context->handshake->secret,
+      hash->digestSize, "derived", "", 0, context->handshake->secret,
+      hash->digestSize);
    //Any error to report?
    if(error)
       return error;
 
    //Debug message
    TRACE_DEBUG("Derived secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->secret, hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", context->handshake->secret, hash->digestSize);
 
    //IKM is a string of Hash-lengths bytes set to 0
    memset(ikm, 0, hash->digestSize);
 
    //Calculate master secret
-   error = hkdfExtract(hash, ikm, hash->digestSize, context->secret,
-      hash->digestSize, context->secret);
+   TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+   error = hkdfExtract(hash, ikm, hash->digestSize, context->handshake->secret,
+      hash->digestSize, context->handshake->secret);
    //Any error to report?
    if(error)
       return error;
 
    //Debug message
    TRACE_DEBUG("Master secret:\r\n");
-   TRACE_DEBUG_ARRAY("  ", context->secret, hash->digestSize);
+   TRACE_DEBUG_ARRAY("  ", context->handshake->secret, hash->digestSize);
 
-   //Calculate client application traffic secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "c ap traffic", NULL, 0, context->clientAppTrafficSecret,
-      hash->digestSize);
+   //Calculate client and server application traffic secrets
+   error = tls13DeriveSecretPair(context, context->handshake->secret,
+      hash->digestSize, "c ap traffic", context->clientAppTrafficSecret,
+      "s ap traffic", context->serverAppTrafficSecret);
    //Any error to report?
    if(error)
       return error;
@@ -555,14 +767,6 @@ error_t tls13GenerateServerAppTrafficKeys(TlsContext *context)
    TRACE_DEBUG("Client application secret:\r\n");
    TRACE_DEBUG_ARRAY("  ", context->clientAppTrafficSecret, hash->digestSize);
 
-   //Calculate server application traffic secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "s ap traffic", NULL, 0, context->serverAppTrafficSecret,
-      hash->digestSize);
-   //Any error to report?
-   if(error)
-      return error;
-
    //Debug message
    TRACE_DEBUG("Server application secret:\r\n");
    TRACE_DEBUG_ARRAY("  ", context->serverAppTrafficSecret, hash->digestSize);
@@ -605,8 +809,9 @@ error_t tls13GenerateServerAppTrafficKeys(TlsContext *context)
       return error;
 
    //Calculate exporter master secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "exp master", NULL, 0, context->exporterMasterSecret, hash->digestSize);
+   error = tls13DeriveSecret(context, context->handshake->secret,
+      hash->digestSize, "exp master", NULL, 0, context->exporterMasterSecret,
+      hash->digestSize);
    //Any error to report?
    if(error)
       return error;
@@ -737,8 +942,9 @@ error_t tls13GenerateClientAppTrafficKeys(TlsContext *context)
       return error;
 
    //Calculate resumption master secret
-   error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-      "res master", NULL, 0, context->resumptionMasterSecret, hash->digestSize);
+   error = tls13DeriveSecret(context, context->handshake->secret,
+      hash->digestSize, "res master", NULL, 0, context->resumptionMasterSecret,
+      hash->digestSize);
    //Any error to report?
    if(error)
       return error;
@@ -749,19 +955,34 @@ error_t tls13GenerateClientAppTrafficKeys(TlsContext *context)
 
    //Once all the values which are to be derived from a given secret have been
    //computed, that secret should be erased
-   memset(context->secret, 0, TLS13_MAX_HKDF_DIGEST_SIZE);
-   memset(context->clientEarlyTrafficSecret, 0, TLS13_MAX_HKDF_DIGEST_SIZE);
-   memset(context->clientHsTrafficSecret, 0, TLS13_MAX_HKDF_DIGEST_SIZE);
-   memset(context->serverHsTrafficSecret, 0, TLS13_MAX_HKDF_DIGEST_SIZE);
+   memset(context->handshake->secret, 0, TLS13_MAX_HKDF_DIGEST_SIZE);
+   memset(context->handshake->clientEarlyTrafficSecret, 0,
+      TLS13_MAX_HKDF_DIGEST_SIZE);
+   memset(context->handshake->clientHsTrafficSecret, 0,
+      TLS13_MAX_HKDF_DIGEST_SIZE);
+   memset(context->handshake->serverHsTrafficSecret, 0,
+      TLS13_MAX_HKDF_DIGEST_SIZE);
 
 #if (TLS_TICKET_SUPPORT == ENABLED)
    //Check whether session ticket mechanism is enabled
    if(context->entity == TLS_CONNECTION_END_SERVER &&
-      context->ticketEncryptCallback != NULL)
+      context->ticketEncryptCallback != NULL &&
+      context->newSessionTicketLimit > 0)
    {
-      //At any time after the server has received the client Finished message,
-      //it may send a NewSessionTicket message
-      context->state = TLS_STATE_NEW_SESSION_TICKET;
+      //Deferred issuance of tickets?
+      if(context->deferredTicketsEnabled)
+      {
+         //The tickets are sent after the first application data, so that
+         //their encryption does not delay the response of the server
+         context->deferredTicketsPending = TRUE;
+         context->state = TLS_STATE_APPLICATION_DATA;
+      }
+      else
+      {
+         //At any time after the server has received the client Finished
+         //message, it may send a NewSessionTicket message
+         context->state = TLS_STATE_NEW_SESSION_TICKET;
+      }
    }
    else
 #endif
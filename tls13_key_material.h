@@ -39,15 +39,29 @@
 extern "C" {
 #endif
 
+//Prefix of all the HKDF labels used by TLS 1.3
+#define TLS13_LABEL_PREFIX "tls13 "
+
 //TLS 1.3 related functions
 error_t tls13HkdfExpandLabel(const HashAlgo *hash, const uint8_t *secret,
    size_t secretLen, const char_t *label, const uint8_t *context,
    size_t contextLen, uint8_t *output, size_t outputLen);
 
+error_t tls13HkdfExpandLabelKeyed(const HmacContext *keyedContext,
+   HmacContext *hmacContext, const char_t *label, const uint8_t *context,
+   size_t contextLen, uint8_t *output, size_t outputLen);
+
 error_t tls13DeriveSecret(TlsContext *context, const uint8_t *secret,
    size_t secretLen, const char_t *label, const char_t *message,
    size_t messageLen, uint8_t *output, size_t outputLen);
 
+error_t tls13DeriveSecretPair(TlsContext *context, const uint8_t *secret,
+   size_t secretLen, const char_t *clientLabel, uint8_t *clientSecret,
+   const char_t *serverLabel, uint8_t *serverSecret);
+
+error_t tls13DeriveTrafficKeys(const HashAlgo *hash, const uint8_t *secret,
+   uint8_t *key, size_t keyLen, uint8_t *iv, size_t ivLen);
+
 error_t tls13GenerateEarlyTrafficKeys(TlsContext *context);
 error_t tls13GenerateHandshakeTrafficKeys(TlsContext *context);
 error_t tls13GenerateServerAppTrafficKeys(TlsContext *context);
@@ -34,12 +34,16 @@
 //Dependencies
 #include <string.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_extensions.h"
 #include "tls_certificate.h"
 #include "tls_signature.h"
 #include "tls_transcript_hash.h"
 #include "tls_ffdhe.h"
+#include "tls_credential.h"
+#include "tls_key_pool.h"
 #include "tls_misc.h"
+#include "tls_ocsp.h"
 #include "tls13_misc.h"
 #include "tls13_key_material.h"
 #include "pkix/pem_import.h"
@@ -89,14 +93,9 @@ error_t tls13ComputePskBinder(TlsContext *context, const void *clientHello,
 {
    error_t error;
    const HashAlgo *hash;
-   uint8_t *hashContext;
    uint8_t key[TLS_MAX_HKDF_DIGEST_SIZE];
    uint8_t digest[TLS_MAX_HKDF_DIGEST_SIZE];
 
-   //Check parameters
-   if(truncatedClientHelloLen >= clientHelloLen)
-      return ERROR_INVALID_PARAMETER;
-
    //The hash function used by HKDF is the cipher suite hash algorithm
    hash = context->cipherSuite.prfHashAlgo;
    //Make sure the hash algorithm is valid
@@ -107,8 +106,76 @@ error_t tls13ComputePskBinder(TlsContext *context, const void *clientHello,
    if(binderLen != hash->digestSize)
       return ERROR_INVALID_LENGTH;
 
+   //Calculate the transcript hash over the partial ClientHello
+   error = tls13DigestPartialClientHello(context, clientHello,
+      clientHelloLen, truncatedClientHelloLen, digest);
+
+   //Check status code
+   if(!error)
+   {
+      //Derive the key used to compute the PSK binder
+      error = tls13ComputeBinderKey(context, key);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Compute PSK binder
+      TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+      error = hmacCompute(hash, key, hash->digestSize, digest,
+         hash->digestSize, binder);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Debug message
+      TRACE_DEBUG("PSK binder:\r\n");
+      TRACE_DEBUG_ARRAY("  ", binder, binderLen);
+   }
+
+   //Clear the binder key
+   memset(key, 0, TLS_MAX_HKDF_DIGEST_SIZE);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Calculate the transcript hash over a partial ClientHello
+ *
+ * The transcript hash is the same for all the binders of a ClientHello, so
+ * that it only needs to be computed once
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] clientHello Pointer to the ClientHello message
+ * @param[in] clientHelloLen Length of the ClientHello message
+ * @param[in] truncatedClientHelloLen Length of the partial ClientHello message
+ * @param[out] digest Resulting transcript hash
+ * @return Error code
+ **/
+
+error_t tls13DigestPartialClientHello(TlsContext *context,
+   const void *clientHello, size_t clientHelloLen,
+   size_t truncatedClientHelloLen, uint8_t *digest)
+{
+   const HashAlgo *hash;
+   uint8_t *hashContext;
+
+   //Check parameters
+   if(truncatedClientHelloLen >= clientHelloLen)
+      return ERROR_INVALID_PARAMETER;
+
+   //The hash function used by HKDF is the cipher suite hash algorithm
+   hash = context->cipherSuite.prfHashAlgo;
+   //Make sure the hash algorithm is valid
+   if(hash == NULL)
+      return ERROR_FAILURE;
+
    //Allocate a memory buffer to hold the hash context
-   hashContext = tlsAllocMem(hash->contextSize);
+   hashContext = tlsAllocHandshakeObject(context,
+      TLS_MEM_CLASS_HASH_CONTEXT, hash->contextSize);
    //Failed to allocate memory?
    if(hashContext == NULL)
       return ERROR_OUT_OF_MEMORY;
@@ -160,30 +227,58 @@ error_t tls13ComputePskBinder(TlsContext *context, const void *clientHello,
    hash->final(hashContext, digest);
 
    //Release previously allocated memory
-   tlsFreeMem(hashContext);
+   tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT, hashContext);
 
    //Debug message
    TRACE_DEBUG("Transcript hash (partial ClientHello):\r\n");
    TRACE_DEBUG_ARRAY("  ", digest, hash->digestSize);
 
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Derive the key used to compute PSK binders
+ *
+ * The early secret is extracted from the PSK, then the binder key is expanded
+ * into a finished key (refer to RFC 8446, section 4.2.11.2)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] key Resulting finished key
+ * @return Error code
+ **/
+
+error_t tls13ComputeBinderKey(TlsContext *context, uint8_t *key)
+{
+   error_t error;
+   const HashAlgo *hash;
+
+   //The hash function used by HKDF is the cipher suite hash algorithm
+   hash = context->cipherSuite.prfHashAlgo;
+   //Make sure the hash algorithm is valid
+   if(hash == NULL)
+      return ERROR_FAILURE;
+
    //Although PSKs can be established out of band, PSKs can also be established
    //in a previous connection
    if(tls13IsPskValid(context))
    {
       //Calculate early secret
+      TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
       error = hkdfExtract(hash, context->psk, context->pskLen, NULL, 0,
-         context->secret);
+         context->handshake->secret);
       //Any error to report?
       if(error)
          return error;
 
       //Debug message
       TRACE_DEBUG("Early secret:\r\n");
-      TRACE_DEBUG_ARRAY("  ", context->secret, hash->digestSize);
+      TRACE_DEBUG_ARRAY("  ", context->handshake->secret, hash->digestSize);
 
       //Calculate binder key
-      error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-         "ext binder", "", 0, key, hash->digestSize);
+      error = tls13DeriveSecret(context, context->handshake->secret,
+         hash->digestSize, "ext binder", "", 0, key, hash->digestSize);
       //Any error to report?
       if(error)
          return error;
@@ -191,19 +286,20 @@ error_t tls13ComputePskBinder(TlsContext *context, const void *clientHello,
    else if(tls13IsTicketValid(context))
    {
       //Calculate early secret
+      TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
       error = hkdfExtract(hash, context->ticketPsk, context->ticketPskLen,
-         NULL, 0, context->secret);
+         NULL, 0, context->handshake->secret);
       //Any error to report?
       if(error)
          return error;
 
       //Debug message
       TRACE_DEBUG("Early secret:\r\n");
-      TRACE_DEBUG_ARRAY("  ", context->secret, hash->digestSize);
+      TRACE_DEBUG_ARRAY("  ", context->handshake->secret, hash->digestSize);
 
       //Calculate binder key
-      error = tls13DeriveSecret(context, context->secret, hash->digestSize,
-         "res binder", "", 0, key, hash->digestSize);
+      error = tls13DeriveSecret(context, context->handshake->secret,
+         hash->digestSize, "res binder", "", 0, key, hash->digestSize);
       //Any error to report?
       if(error)
          return error;
@@ -230,17 +326,6 @@ error_t tls13ComputePskBinder(TlsContext *context, const void *clientHello,
    TRACE_DEBUG("Finished key:\r\n");
    TRACE_DEBUG_ARRAY("  ", key, hash->digestSize);
 
-   //Compute PSK binder
-   error = hmacCompute(hash, key, hash->digestSize, digest, hash->digestSize,
-      binder);
-   //Any error to report?
-   if(error)
-      return error;
-
-   //Debug message
-   TRACE_DEBUG("PSK binder:\r\n");
-   TRACE_DEBUG_ARRAY("  ", binder, binderLen);
-
    //Successful processing
    return NO_ERROR;
 }
@@ -277,10 +362,20 @@ error_t tls13GenerateKeyShare(TlsContext *context, uint16_t namedGroup)
 
          //Check status code
          if(!error)
+         {
+            //Take a pre-generated key pair from the pool, if any
+            error = tlsTakeKeyPair(context, namedGroup);
+         }
+
+         //No key pair available?
+         if(error == ERROR_NOT_FOUND)
          {
             //Generate an ephemeral key pair
+            TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_START);
+            TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
             error = ecdhGenerateKeyPair(&context->ecdhContext, context->prngAlgo,
                context->prngContext);
+            TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_END);
          }
       }
       else
@@ -312,8 +407,16 @@ error_t tls13GenerateKeyShare(TlsContext *context, uint16_t namedGroup)
 
          //Check status code
          if(!error)
+         {
+            //Take a pre-generated key pair from the pool, if any
+            error = tlsTakeKeyPair(context, namedGroup);
+         }
+
+         //No key pair available?
+         if(error == ERROR_NOT_FOUND)
          {
             //Generate an ephemeral key pair
+            TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
             error = dhGenerateKeyPair(&context->dhContext, context->prngAlgo,
                context->prngContext);
          }
@@ -338,6 +441,90 @@ error_t tls13GenerateKeyShare(TlsContext *context, uint16_t namedGroup)
 }
 
 
+/**
+ * @brief Speculative key share generation
+ *
+ * The speculative key share is offered alongside the key share for the
+ * preferred group. It is only used when a pre-generated key pair can be
+ * taken from the pool, so that it never adds to the cost of the ClientHello
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13GenerateSpeculativeKeyShare(TlsContext *context)
+{
+   error_t error;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+#if (TLS13_ECDHE_KE_SUPPORT == ENABLED || TLS13_PSK_ECDHE_KE_SUPPORT == ENABLED)
+   //No speculative key share offered so far
+   context->speculativeShareGroup = TLS_GROUP_NONE;
+
+   //The speculative key share must use a distinct elliptic curve group
+   if(context->speculativeGroup != context->namedGroup &&
+      tls13IsEcdheGroupSupported(context, context->speculativeGroup))
+   {
+      const EcCurveInfo *curveInfo;
+
+      //Retrieve the elliptic curve to be used
+      curveInfo = tlsGetCurveInfo(context, context->speculativeGroup);
+
+      //Valid elliptic curve?
+      if(curveInfo != NULL)
+      {
+         //Load EC domain parameters
+         error = ecLoadDomainParameters(&context->speculativeEcdhContext.params,
+            curveInfo);
+
+         //Check status code
+         if(!error)
+         {
+            //Take a pre-generated key pair from the pool, if any
+            error = tlsTakeSpeculativeKeyPair(context,
+               context->speculativeGroup);
+         }
+
+         //Check status code
+         if(!error)
+         {
+            //The speculative key share is ready
+            context->speculativeShareGroup = context->speculativeGroup;
+         }
+         else if(error == ERROR_NOT_FOUND)
+         {
+            //Never generate a key pair inline for the speculative key share
+            error = NO_ERROR;
+         }
+      }
+   }
+#endif
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release the speculative key share
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tls13FreeSpeculativeKeyShare(TlsContext *context)
+{
+#if (TLS13_ECDHE_KE_SUPPORT == ENABLED || TLS13_PSK_ECDHE_KE_SUPPORT == ENABLED)
+   //Release the ephemeral ECDH key pair
+   ecdhFree(&context->speculativeEcdhContext);
+   ecdhInit(&context->speculativeEcdhContext);
+
+   //The speculative key share is no longer available
+   context->speculativeShareGroup = TLS_GROUP_NONE;
+#endif
+}
+
+
 /**
  * @brief (EC)DHE shared secret generation
  * @param[in] context Pointer to the TLS context
@@ -372,9 +559,12 @@ error_t tls13GenerateSharedSecret(TlsContext *context, const uint8_t *keyShare,
       {
          //ECDH shared secret calculation is performed according to IEEE Std
          //1363-2000 (refer to RFC 8446, section 7.4.2)
+         TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_START);
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
          error = ecdhComputeSharedSecret(&context->ecdhContext,
-            context->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
-            &context->premasterSecretLen);
+            context->handshake->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
+            &context->handshake->premasterSecretLen);
+         TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_END);
       }
    }
    else
@@ -402,9 +592,10 @@ error_t tls13GenerateSharedSecret(TlsContext *context, const uint8_t *keyShare,
          //The negotiated key (Z) is converted to a byte string by encoding in
          //big-endian and left padded with zeros up to the size of the prime
          //(refer to RFC 8446, section 7.4.1)
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
          error = dhComputeSharedSecret(&context->dhContext,
-            context->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
-            &context->premasterSecretLen);
+            context->handshake->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
+            &context->handshake->premasterSecretLen);
       }
 #else
       //The specified FFDHE group is not supported
@@ -441,6 +632,9 @@ error_t tls13GenerateSignature(TlsContext *context, uint8_t *p,
    Tls13DigitalSignature *signature;
    const HashAlgo *hashAlgo;
 
+   //Account for the public key operation
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+
    //Point to the digitally-signed element
    signature = (Tls13DigitalSignature *) p;
 
@@ -454,7 +648,7 @@ error_t tls13GenerateSignature(TlsContext *context, uint8_t *p,
    n = hashAlgo->digestSize + 98;
 
    //Allocate a memory buffer
-   buffer = tlsAllocMem(n);
+   buffer = tlsAllocHandshakeMem(context, n);
    //Failed to allocate memory?
    if(buffer == NULL)
       return ERROR_OUT_OF_MEMORY;
@@ -480,6 +674,18 @@ error_t tls13GenerateSignature(TlsContext *context, uint8_t *p,
    //Check status code
    if(!error)
    {
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+      //The private key operation is delegated to the application?
+      if(context->asyncSignCallback != NULL)
+      {
+         //The signature scheme code is made of the hash algorithm followed
+         //by the signature algorithm
+         error = tlsGenerateAsyncSignature(context, buffer, n,
+            (TlsSignHashAlgo *) &signature->algorithm, signature->value,
+            length);
+      }
+      else
+#endif
 #if (TLS_RSA_PSS_SIGN_SUPPORT == ENABLED)
       //RSA-PSS signature scheme?
       if(context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256 ||
@@ -490,6 +696,7 @@ error_t tls13GenerateSignature(TlsContext *context, uint8_t *p,
          context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA512)
       {
          RsaPrivateKey privateKey;
+         const RsaPrivateKey *rsaPrivateKey;
 
          //Initialize RSA private key
          rsaInitPrivateKey(&privateKey);
@@ -553,8 +760,8 @@ error_t tls13GenerateSignature(TlsContext *context, uint8_t *p,
          {
             //Retrieve the RSA private key corresponding to the certificate sent
             //in the previous message
-            error = pemImportRsaPrivateKey(context->cert->privateKey,
-               context->cert->privateKeyLen, &privateKey);
+            error = tlsGetRsaPrivateKey(context->cert, &privateKey,
+               &rsaPrivateKey);
          }
 
          //Check status code
@@ -563,7 +770,7 @@ error_t tls13GenerateSignature(TlsContext *context, uint8_t *p,
             //RSA signatures must use an RSASSA-PSS algorithm, regardless of
             //whether RSASSA-PKCS1-v1_5 algorithms appear in SignatureAlgorithms
             error = rsassaPssSign(context->prngAlgo, context->prngContext,
-               &privateKey, hashAlgo, hashAlgo->digestSize,
+               rsaPrivateKey, hashAlgo, hashAlgo->digestSize,
                context->clientVerifyData, signature->value, length);
          }
 
@@ -665,7 +872,7 @@ error_t tls13GenerateSignature(TlsContext *context, uint8_t *p,
    }
 
    //Release memory buffer
-   tlsFreeMem(buffer);
+   tlsFreeHandshakeMem(context, buffer);
 
    //Check status code
    if(!error)
@@ -699,6 +906,9 @@ error_t tls13VerifySignature(TlsContext *context, const uint8_t *p,
    const Tls13DigitalSignature *signature;
    const HashAlgo *hashAlgo;
 
+   //Account for the public key operation
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+
    //Point to the digitally-signed element
    signature = (Tls13DigitalSignature *) p;
 
@@ -718,7 +928,7 @@ error_t tls13VerifySignature(TlsContext *context, const uint8_t *p,
    n = hashAlgo->digestSize + 98;
 
    //Allocate a memory buffer
-   buffer = tlsAllocMem(n);
+   buffer = tlsAllocHandshakeMem(context, n);
    //Failed to allocate memory?
    if(buffer == NULL)
       return ERROR_OUT_OF_MEMORY;
@@ -911,7 +1121,7 @@ error_t tls13VerifySignature(TlsContext *context, const uint8_t *p,
    }
 
    //Release memory buffer
-   tlsFreeMem(buffer);
+   tlsFreeHandshakeMem(context, buffer);
 
    //Return status code
    return error;
@@ -929,6 +1139,11 @@ error_t tls13DigestClientHello1(TlsContext *context)
    TlsHandshake *message;
    const HashAlgo *hash;
 
+#if (TLS_STATS_SUPPORT == ENABLED)
+   //The handshake requires a HelloRetryRequest
+   context->stats.helloRetry = TRUE;
+#endif
+
    //Invalid hash context?
    if(context->transcriptHashContext == NULL)
       return ERROR_FAILURE;
@@ -1192,15 +1407,49 @@ error_t tls13CheckDuplicateKeyShare(uint16_t namedGroup, const uint8_t *p,
 }
 
 
+/**
+ * @brief Get the length of the certificate extensions
+ * @param[in] context Pointer to the TLS context
+ * @param[in] endEntity The extensions apply to the end-entity certificate
+ * @return Number of bytes tls13FormatCertExtensions will write
+ **/
+
+size_t tls13GetCertExtensionsLength(TlsContext *context, bool_t endEntity)
+{
+   size_t n;
+
+   //The list of extensions is preceded by a 2-byte length field
+   n = sizeof(TlsExtensionList);
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //The server staples the OCSP response of its end-entity certificate
+   if(context->entity == TLS_CONNECTION_END_SERVER && endEntity &&
+      context->ocspResponse != NULL)
+   {
+      //StatusRequest extension carrying a CertificateStatus structure
+      n += sizeof(TlsExtension) + sizeof(TlsCertificateStatus) +
+         context->ocspResponse->length;
+   }
+#endif
+
+   //Return the length of the certificate extensions
+   return n;
+}
+
+
 /**
  * @brief Format certificate extensions
+ * @param[in] context Pointer to the TLS context
+ * @param[in] endEntity The extensions apply to the end-entity certificate
  * @param[in] p Output stream where to write the list of extensions
  * @param[out] written Total number of bytes that have been written
  * @return Error code
  **/
 
-error_t tls13FormatCertExtensions(uint8_t *p, size_t *written)
+error_t tls13FormatCertExtensions(TlsContext *context, bool_t endEntity,
+   uint8_t *p, size_t *written)
 {
+   size_t n;
    TlsExtensionList *extensionList;
 
    //Point to the list of extensions
@@ -1210,10 +1459,49 @@ error_t tls13FormatCertExtensions(uint8_t *p, size_t *written)
    //ones from the ClientHello message. Extensions in the Certificate message
    //from the client must correspond to extensions in the CertificateRequest
    //message from the server
-   extensionList->length = HTONS(0);
+   extensionList->length = 0;
+
+   //Point to the first extension of the list
+   p += sizeof(TlsExtensionList);
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //The server staples the OCSP response of its end-entity certificate in
+   //a StatusRequest extension (refer to RFC 8446, section 4.4.2.1)
+   if(context->entity == TLS_CONNECTION_END_SERVER && endEntity &&
+      context->ocspResponse != NULL)
+   {
+      error_t error;
+      TlsExtension *extension;
+
+      //Add the StatusRequest extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_STATUS_REQUEST);
+
+      //The extension data field contains a CertificateStatus structure
+      error = tlsFormatCertStatus(context,
+         (TlsCertificateStatus *) extension->value, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Fix the length of the extension
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the StatusRequest extension
+      n += sizeof(TlsExtension);
+
+      //Fix the length of the extension list
+      extensionList->length += (uint16_t) n;
+   }
+#endif
+
+   //Convert the length of the extension list to network byte order
+   n = extensionList->length;
+   extensionList->length = htons(n);
 
    //Total number of bytes that have been written
-   *written = sizeof(TlsExtensionList);
+   *written = sizeof(TlsExtensionList) + n;
 
    //Successful processing
    return NO_ERROR;
@@ -1222,13 +1510,15 @@ error_t tls13FormatCertExtensions(uint8_t *p, size_t *written)
 
 /**
  * @brief Parse certificate extensions
+ * @param[in] context Pointer to the TLS context
+ * @param[in] endEntity The extensions apply to the end-entity certificate
  * @param[in] p Input stream where to read the list of extensions
  * @param[in] length Number of bytes available in the input stream
  * @return Error code
  **/
 
-error_t tls13ParseCertExtensions(const uint8_t *p, size_t length,
-   size_t *consumed)
+error_t tls13ParseCertExtensions(TlsContext *context, bool_t endEntity,
+   const uint8_t *p, size_t length, size_t *consumed)
 {
    error_t error;
    size_t n;
@@ -1263,6 +1553,27 @@ error_t tls13ParseCertExtensions(const uint8_t *p, size_t length,
    if(error)
       return error;
 
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //StatusRequest extension attached to the end-entity certificate?
+   if(extensions.statusRequest != NULL && endEntity)
+   {
+      //The server must not staple a response unless the client asked for it
+      if(context->entity != TLS_CONNECTION_END_CLIENT ||
+         !context->ocspStaplingEnabled)
+      {
+         return ERROR_UNSUPPORTED_EXTENSION;
+      }
+
+      //Check the OCSP response against the server certificate
+      error = tlsCheckCertStatus(context,
+         (const TlsCertificateStatus *) extensions.statusRequest,
+         extensions.statusRequestLen);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+#endif
+
    //Total number of bytes that have been consumed
    *consumed = n;
 
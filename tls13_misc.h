@@ -115,6 +115,13 @@
    #error TLS13_NEW_SESSION_TICKET_COUNT parameter is not valid
 #endif
 
+//Compact encoding of the session state carried by tickets
+#ifndef TLS13_COMPACT_TICKET_SUPPORT
+   #define TLS13_COMPACT_TICKET_SUPPORT DISABLED
+#elif (TLS13_COMPACT_TICKET_SUPPORT != ENABLED && TLS13_COMPACT_TICKET_SUPPORT != DISABLED)
+   #error TLS13_COMPACT_TICKET_SUPPORT parameter is not valid
+#endif
+
 //Maximum size for HKDF digests
 #if (TLS_SHA384_SUPPORT == ENABLED)
    #define TLS13_MAX_HKDF_DIGEST_SIZE 48
@@ -395,7 +402,15 @@ error_t tls13ComputePskBinder(TlsContext *context, const void *clientHello,
    size_t clientHelloLen, size_t truncatedClientHelloLen,
    const Tls13PskIdentity *identity, uint8_t *binder, size_t binderLen);
 
+error_t tls13DigestPartialClientHello(TlsContext *context,
+   const void *clientHello, size_t clientHelloLen,
+   size_t truncatedClientHelloLen, uint8_t *digest);
+
+error_t tls13ComputeBinderKey(TlsContext *context, uint8_t *key);
+
 error_t tls13GenerateKeyShare(TlsContext *context, uint16_t namedGroup);
+error_t tls13GenerateSpeculativeKeyShare(TlsContext *context);
+void tls13FreeSpeculativeKeyShare(TlsContext *context);
 
 error_t tls13GenerateSharedSecret(TlsContext *context, const uint8_t *keyShare,
    size_t length);
@@ -418,10 +433,13 @@ bool_t tls13IsFfdheGroupSupported(TlsContext *context, uint16_t namedGroup);
 error_t tls13CheckDuplicateKeyShare(uint16_t namedGroup, const uint8_t *p,
    size_t length);
 
-error_t tls13FormatCertExtensions(uint8_t *p, size_t *written);
+size_t tls13GetCertExtensionsLength(TlsContext *context, bool_t endEntity);
+
+error_t tls13FormatCertExtensions(TlsContext *context, bool_t endEntity,
+   uint8_t *p, size_t *written);
 
-error_t tls13ParseCertExtensions(const uint8_t *p, size_t length,
-   size_t *consumed);
+error_t tls13ParseCertExtensions(TlsContext *context, bool_t endEntity,
+   const uint8_t *p, size_t length, size_t *consumed);
 
 //C++ guard
 #ifdef __cplusplus
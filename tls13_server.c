@@ -195,7 +195,7 @@ error_t tls13SendNewSessionTicket(TlsContext *context)
    error = NO_ERROR;
 
    //Send as many NewSessionTicket messages as requested
-   if(context->newSessionTicketCount < TLS13_NEW_SESSION_TICKET_COUNT)
+   if(context->newSessionTicketCount < context->newSessionTicketLimit)
    {
       //Point to the buffer where to format the message
       message = (Tls13NewSessionTicket *) (context->txBuffer + context->txBufferLen);
@@ -220,6 +220,8 @@ error_t tls13SendNewSessionTicket(TlsContext *context)
    }
    else
    {
+      //All the tickets have been issued
+      context->deferredTicketsPending = FALSE;
       //The client and server can now exchange application-layer data
       context->state = TLS_STATE_APPLICATION_DATA;
    }
@@ -229,6 +231,54 @@ error_t tls13SendNewSessionTicket(TlsContext *context)
 }
 
 
+/**
+ * @brief Send the NewSessionTicket messages deferred by the handshake
+ *
+ * The tickets are issued once the first application data have been sent. The
+ * state machine is resumed on the sending side only, like for a KeyUpdate
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendDeferredTickets(TlsContext *context)
+{
+   error_t error;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Any NewSessionTicket message pending?
+   if(context->deferredTicketsPending &&
+      context->state == TLS_STATE_APPLICATION_DATA)
+   {
+      //Post-handshake messages cannot be sent once the record layer has been
+      //offloaded to the transport
+      if(context->offloaded)
+      {
+         //Give up issuing tickets on this connection
+         context->deferredTicketsPending = FALSE;
+      }
+      else
+      {
+         //Resume the state machine
+         context->state = TLS_STATE_NEW_SESSION_TICKET;
+
+         //Send the tickets
+         error = tlsPerformWriterHandshake(context);
+
+         //The remaining messages are sent by the next call to tlsWrite or
+         //tlsRead, without failing the current one
+         if(error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+            error = NO_ERROR;
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Format HelloRetryRequest message
  * @param[in] context Pointer to the TLS context
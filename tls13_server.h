@@ -43,6 +43,7 @@ extern "C" {
 error_t tls13SendHelloRetryRequest(TlsContext *context);
 error_t tls13SendEncryptedExtensions(TlsContext *context);
 error_t tls13SendNewSessionTicket(TlsContext *context);
+error_t tls13SendDeferredTickets(TlsContext *context);
 
 error_t tls13FormatHelloRetryRequest(TlsContext *context,
    Tls13HelloRetryRequest *message, size_t *length);
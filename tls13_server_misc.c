@@ -38,9 +38,11 @@
 #include "tls_transcript_hash.h"
 #include "tls_ffdhe.h"
 #include "tls_misc.h"
+#include "tls_stats.h"
 #include "tls13_server_extensions.h"
 #include "tls13_server_misc.h"
 #include "tls13_key_material.h"
+#include "tls13_anti_replay.h"
 #include "debug.h"
 
 //Check TLS library configuration
@@ -174,6 +176,19 @@ error_t tls13NegotiateCipherSuite(TlsContext *context, const void *clientHello,
          //If this value does not validate, the server must abort the handshake
          if(error)
             return error;
+
+         //The same ClientHello must not be accepted twice with 0-RTT (refer
+         //to RFC 8446, section 8.2)
+         if(context->earlyDataExtReceived && !context->earlyDataRejected &&
+            context->antiReplay != NULL)
+         {
+            //Record the binder value of the selected PSK
+            if(!tls13CheckAntiReplay(context->antiReplay, extensions->binderList))
+            {
+               //Proceed with a 1-RTT handshake
+               context->earlyDataRejected = TRUE;
+            }
+         }
       }
       else
       {
@@ -496,8 +511,33 @@ error_t tls13GenerateTicket(TlsContext *context,
    //Save the length of the ticket PSK
    state->ticketPskLen = hashAlgo->digestSize;
 
+#if (TLS13_COMPACT_TICKET_SUPPORT == ENABLED)
+   {
+      uint8_t buffer[sizeof(Tls13SessionState)];
+
+      //Encode the session state in a compact form, so as to keep the
+      //PreSharedKey extension of the resumed ClientHello short
+      error = tls13FormatCompactSessionState(state, buffer, &n);
+
+      //Check status code
+      if(!error)
+      {
+         //The encoded state replaces the structure itself
+         memcpy(ticket, buffer, n);
+         memset(ticket + n, 0, sizeof(Tls13SessionState) - n);
+      }
+
+      //Clear the temporary copy of the ticket PSK
+      memset(buffer, 0, sizeof(buffer));
+
+      //Any error to report?
+      if(error)
+         return error;
+   }
+#else
    //Compute the length of the session state
    n = sizeof(Tls13SessionState);
+#endif
 
    //Make sure a valid callback has been registered
    if(context->ticketEncryptCallback == NULL)
@@ -549,8 +589,15 @@ error_t tls13VerifyTicket(TlsContext *context, const uint8_t *ticket,
    if(length == 0)
       return ERROR_DECRYPTION_FAILED;
 
+#if (TLS13_COMPACT_TICKET_SUPPORT == ENABLED)
+   //Allocate a buffer to store the decrypted state information. The buffer
+   //must also be able to hold the decoded form of a compact session state
+   state = tlsAllocHandshakeMem(context, MAX(length,
+      sizeof(Tls13SessionState)));
+#else
    //Allocate a buffer to store the decrypted state information
-   state = tlsAllocMem(length);
+   state = tlsAllocHandshakeMem(context, length);
+#endif
    //Failed to allocate memory?
    if(state == NULL)
       return ERROR_OUT_OF_MEMORY;
@@ -559,11 +606,56 @@ error_t tls13VerifyTicket(TlsContext *context, const uint8_t *ticket,
    do
    {
       //Decrypt the received ticket
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_TICKET_DECRYPT_START);
       error = context->ticketDecryptCallback(context, ticket, length,
          (uint8_t *) state, &length, context->ticketParam);
-      //Any error to report?
-      if(error)
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_TICKET_DECRYPT_END);
+
+      //Check status code
+      if(!error)
+      {
+         //Update statistics
+         TLS_GLOBAL_STATS_INC(context, ticketDecryptSuccesses);
+      }
+      else
+      {
+         //Update statistics
+         TLS_GLOBAL_STATS_INC(context, ticketDecryptFailures);
+         //Report an error
          break;
+      }
+
+#if (TLS13_COMPACT_TICKET_SUPPORT == ENABLED)
+      //Compact encoding of the session state? (tickets issued before the
+      //compact encoding was enabled are still accepted)
+      if(length != sizeof(Tls13SessionState))
+      {
+         Tls13SessionState decodedState;
+
+         //Decode the session state
+         error = tls13ParseCompactSessionState((uint8_t *) state, length,
+            &decodedState);
+
+         //Check status code
+         if(!error)
+         {
+            //Replace the encoded state with the decoded structure
+            memcpy(state, &decodedState, sizeof(Tls13SessionState));
+            length = sizeof(Tls13SessionState);
+         }
+
+         //Clear the temporary copy of the ticket PSK
+         memset(&decodedState, 0, sizeof(Tls13SessionState));
+
+         //Any error to report?
+         if(error)
+         {
+            //The ticket is malformed
+            error = ERROR_INVALID_TICKET;
+            break;
+         }
+      }
+#endif
 
       //Check the length of the decrypted ticket
       if(length != sizeof(Tls13SessionState))
@@ -658,7 +750,7 @@ error_t tls13VerifyTicket(TlsContext *context, const uint8_t *ticket,
 
    //Release state information
    memset(state, 0, length);
-   tlsFreeMem(state);
+   tlsFreeHandshakeMem(context, state);
 
    //Return status code
    return error;
@@ -668,4 +760,139 @@ error_t tls13VerifyTicket(TlsContext *context, const uint8_t *ticket,
 #endif
 }
 
+
+/**
+ * @brief Encode session state information in a compact form
+ *
+ * The protocol version is implied, the cipher suite is reduced to the low
+ * byte of its TLS 1.3 identifier, timestamps are encoded as variable-length
+ * integers and the length of the ticket PSK is given by the cipher suite
+ *
+ * @param[in] state Session state information
+ * @param[out] p Output stream where to write the encoded session state
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tls13FormatCompactSessionState(const Tls13SessionState *state,
+   uint8_t *p, size_t *written)
+{
+   size_t n;
+
+   //Only TLS 1.3 cipher suites can be encoded on a single byte
+   if(state->version != TLS_VERSION_1_3 || (state->cipherSuite >> 8) != 0x13)
+      return ERROR_FAILURE;
+
+   //Check the length of the ticket PSK
+   if(state->ticketPskLen == 0 ||
+      state->ticketPskLen > TLS13_MAX_HKDF_DIGEST_SIZE)
+   {
+      return ERROR_FAILURE;
+   }
+
+   //Cipher suite
+   p[0] = state->cipherSuite & 0xFF;
+   n = 1;
+
+   //Time at which the ticket was issued
+   n += tlsFormatVarInt((uint32_t) state->ticketTimestamp, p + n);
+   //Lifetime of the ticket, in seconds
+   n += tlsFormatVarInt(state->ticketLifetime, p + n);
+
+   //The ticket_age_add field is a random value
+   STORE32BE(state->ticketAgeAdd, p + n);
+   n += sizeof(uint32_t);
+
+   //The ticket PSK occupies the rest of the encoding
+   memcpy(p + n, state->ticketPsk, state->ticketPskLen);
+   n += state->ticketPskLen;
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode session state information encoded in a compact form
+ * @param[in] p Input stream where to read the encoded session state
+ * @param[in] length Number of bytes available in the input stream
+ * @param[out] state Decoded session state information
+ * @return Error code
+ **/
+
+error_t tls13ParseCompactSessionState(const uint8_t *p, size_t length,
+   Tls13SessionState *state)
+{
+   error_t error;
+   size_t n;
+   uint32_t value;
+
+   //Clear the structure
+   memset(state, 0, sizeof(Tls13SessionState));
+
+   //Malformed session state?
+   if(length < 1)
+      return ERROR_DECODING_FAILED;
+
+   //The protocol version is implied
+   state->version = TLS_VERSION_1_3;
+   //Retrieve the cipher suite
+   state->cipherSuite = 0x1300 | p[0];
+
+   //Point to the next field
+   p += 1;
+   length -= 1;
+
+   //Parse the time at which the ticket was issued
+   error = tlsParseVarInt(p, length, &value, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Save the timestamp
+   state->ticketTimestamp = (systime_t) value;
+
+   //Point to the next field
+   p += n;
+   length -= n;
+
+   //Parse the lifetime of the ticket
+   error = tlsParseVarInt(p, length, &value, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Save the lifetime
+   state->ticketLifetime = value;
+
+   //Point to the next field
+   p += n;
+   length -= n;
+
+   //Malformed session state?
+   if(length < sizeof(uint32_t))
+      return ERROR_DECODING_FAILED;
+
+   //Retrieve the ticket_age_add field
+   state->ticketAgeAdd = LOAD32BE(p);
+
+   //Point to the next field
+   p += sizeof(uint32_t);
+   length -= sizeof(uint32_t);
+
+   //Check the length of the ticket PSK
+   if(length == 0 || length > TLS13_MAX_HKDF_DIGEST_SIZE)
+      return ERROR_DECODING_FAILED;
+
+   //Retrieve the ticket PSK
+   memcpy(state->ticketPsk, p, length);
+   state->ticketPskLen = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
 #endif
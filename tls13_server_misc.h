@@ -60,6 +60,12 @@ error_t tls13GenerateTicket(TlsContext *context,
 error_t tls13VerifyTicket(TlsContext *context, const uint8_t *ticket,
    size_t length, uint32_t obfuscatedTicketAge);
 
+error_t tls13FormatCompactSessionState(const Tls13SessionState *state,
+   uint8_t *p, size_t *written);
+
+error_t tls13ParseCompactSessionState(const uint8_t *p, size_t length,
+   Tls13SessionState *state);
+
 //C++ guard
 #ifdef __cplusplus
 }
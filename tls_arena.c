@@ -0,0 +1,252 @@
+/**
+ * @file tls_arena.c
+ * @brief Per-handshake arena allocator
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_arena.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Allocate a block from the handshake arena
+ *
+ * Blocks are carved out of the arena with a bump pointer. Each block is
+ * preceded by a small header holding the offset of the previous block, so
+ * that blocks released in reverse order of allocation (which is the usual
+ * pattern of the parsing and signature functions) are reclaimed at once.
+ * Any other block is only reclaimed when the handshake completes
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] size Number of bytes to allocate
+ * @return Pointer to the allocated block, or NULL if the arena is not
+ *   available or exhausted
+ **/
+
+void *tlsArenaAlloc(TlsContext *context, size_t size)
+{
+   size_t n;
+   size_t offset;
+   TlsHandshakeContext *handshake;
+
+   //Point to the handshake context
+   handshake = context->handshake;
+
+   //No handshake in progress or no arena?
+   if(handshake == NULL || handshake->arena == NULL)
+      return NULL;
+
+   //Size of the block, including the header
+   n = TLS_ARENA_HEADER_SIZE + TLS_ARENA_ALIGN(size);
+   //Offset of the block
+   offset = handshake->arenaUsed;
+
+   //Not enough room in the arena?
+   if(size > handshake->arenaSize || n > (handshake->arenaSize - offset))
+      return NULL;
+
+   //Link the block to the previous one
+   *((size_t *) (handshake->arena + offset)) = handshake->arenaLast;
+
+   //Update the state of the arena
+   handshake->arenaLast = offset;
+   handshake->arenaUsed += n;
+
+   //Keep track of the highest number of bytes allocated
+   if(handshake->arenaUsed > handshake->arenaPeak)
+      handshake->arenaPeak = handshake->arenaUsed;
+
+   //Return a pointer to the block
+   return handshake->arena + offset + TLS_ARENA_HEADER_SIZE;
+}
+
+
+/**
+ * @brief Release a block allocated from the handshake arena
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Pointer to the block
+ * @return TRUE if the block belongs to the arena, else FALSE
+ **/
+
+bool_t tlsArenaFree(TlsContext *context, void *p)
+{
+   uint8_t *block;
+   TlsHandshakeContext *handshake;
+
+   //Point to the handshake context
+   handshake = context->handshake;
+
+   //No handshake in progress or no arena?
+   if(handshake == NULL || handshake->arena == NULL || p == NULL)
+      return FALSE;
+
+   //Point to the block
+   block = (uint8_t *) p;
+
+   //The block does not belong to the arena?
+   if(block < handshake->arena ||
+      block >= (handshake->arena + handshake->arenaSize))
+   {
+      return FALSE;
+   }
+
+   //Most recent allocation?
+   if(handshake->arenaUsed > 0 && block == (handshake->arena +
+      handshake->arenaLast + TLS_ARENA_HEADER_SIZE))
+   {
+      //Reclaim the block
+      handshake->arenaUsed = handshake->arenaLast;
+      handshake->arenaLast = *((size_t *) (handshake->arena +
+         handshake->arenaLast));
+   }
+
+   //The block belongs to the arena
+   return TRUE;
+}
+
+
+/**
+ * @brief Clear the part of the arena that has been used
+ * @param[in] handshake Pointer to the handshake context
+ **/
+
+void tlsClearArena(TlsHandshakeContext *handshake)
+{
+   //Certificates and temporary buffers may hold sensitive data
+   if(handshake->arena != NULL)
+      memset(handshake->arena, 0, handshake->arenaPeak);
+}
+
+
+/**
+ * @brief Allocate a handshake-scoped object
+ *
+ * The object is allocated from the arena of the current handshake. The
+ * memory pool of the object class (or the heap) is used as a fallback when
+ * no handshake is in progress or the arena is exhausted (except in static
+ * operating mode, where the allocation fails when the arena is exhausted)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] objClass Object class
+ * @param[in] size Size of the object
+ * @return Pointer to the allocated object
+ **/
+
+void *tlsArenaAllocObject(TlsContext *context, TlsMemClass objClass,
+   size_t size)
+{
+   void *p;
+
+   //Allocate the object from the arena
+   p = tlsArenaAlloc(context, size);
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   //In static operating mode, the memory footprint of the handshake is
+   //bounded by the size of the arena
+   if(context->staticMem && context->handshake != NULL)
+      return p;
+#endif
+
+   //Fall back to the regular allocator if necessary
+   if(p == NULL)
+      p = tlsAllocObject(objClass, size);
+
+   //Return a pointer to the allocated object
+   return p;
+}
+
+
+/**
+ * @brief Release a handshake-scoped object
+ * @param[in] context Pointer to the TLS context
+ * @param[in] objClass Object class
+ * @param[in] p Pointer to the object
+ **/
+
+void tlsArenaFreeObject(TlsContext *context, TlsMemClass objClass, void *p)
+{
+   //Objects that do not belong to the arena are released individually
+   if(!tlsArenaFree(context, p))
+      tlsFreeObject(objClass, p);
+}
+
+
+/**
+ * @brief Allocate a handshake-scoped memory block
+ * @param[in] context Pointer to the TLS context
+ * @param[in] size Number of bytes to allocate
+ * @return Pointer to the allocated memory block
+ **/
+
+void *tlsArenaAllocMem(TlsContext *context, size_t size)
+{
+   void *p;
+
+   //Allocate the memory block from the arena
+   p = tlsArenaAlloc(context, size);
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   //In static operating mode, the memory footprint of the handshake is
+   //bounded by the size of the arena
+   if(context->staticMem && context->handshake != NULL)
+      return p;
+#endif
+
+   //Fall back to the heap if necessary
+   if(p == NULL)
+      p = tlsAllocMem(size);
+
+   //Return a pointer to the allocated memory block
+   return p;
+}
+
+
+/**
+ * @brief Release a handshake-scoped memory block
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Pointer to the memory block
+ **/
+
+void tlsArenaFreeMem(TlsContext *context, void *p)
+{
+   //Memory blocks that do not belong to the arena are released individually
+   if(!tlsArenaFree(context, p))
+      tlsFreeMem(p);
+}
+
+#endif
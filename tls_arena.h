@@ -0,0 +1,55 @@
+/**
+ * @file tls_arena.h
+ * @brief Per-handshake arena allocator
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_ARENA_H
+#define _TLS_ARENA_H
+
+//Dependencies
+#include "tls.h"
+
+//Size of the header preceding each arena allocation
+#define TLS_ARENA_HEADER_SIZE TLS_ARENA_ALIGN(sizeof(size_t))
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Per-handshake arena allocator
+void *tlsArenaAlloc(TlsContext *context, size_t size);
+bool_t tlsArenaFree(TlsContext *context, void *p);
+void tlsClearArena(TlsHandshakeContext *handshake);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,681 @@
+/**
+ * @file tls_buffer.c
+ * @brief TX/RX buffer management
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_buffer.h"
+#include "tls_record.h"
+#include "tls_misc.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a pool of TX/RX buffers
+ *
+ * The pool keeps released buffers around so that idle connections can give
+ * their buffers back and get them again when traffic resumes, without going
+ * through the memory allocator. The pool must outlive the TLS contexts that
+ * use it
+ *
+ * @param[in] bufferSize Size of the buffers, in bytes. Connections requiring
+ *   larger buffers transparently fall back to the memory allocator
+ * @param[in] maxFreeBuffers Maximum number of idle buffers kept in the pool
+ * @return Handle referencing the newly created pool
+ **/
+
+TlsBufferPool *tlsInitBufferPool(size_t bufferSize, uint_t maxFreeBuffers)
+{
+   TlsBufferPool *bufferPool;
+
+   //Each idle buffer stores a pointer to the next one
+   if(bufferSize < sizeof(void *))
+      return NULL;
+
+   //Allocate a memory buffer to hold the pool
+   bufferPool = tlsAllocMem(sizeof(TlsBufferPool));
+   //Failed to allocate memory?
+   if(bufferPool == NULL)
+      return NULL;
+
+   //Clear the pool
+   memset(bufferPool, 0, sizeof(TlsBufferPool));
+
+   //Create a mutex to prevent simultaneous access to the pool
+   if(!osCreateMutex(&bufferPool->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(bufferPool);
+      //Report an error
+      return NULL;
+   }
+
+   //Save parameters
+   bufferPool->bufferSize = bufferSize;
+   bufferPool->maxFreeBuffers = maxFreeBuffers;
+
+   //Return a pointer to the newly created pool
+   return bufferPool;
+}
+
+
+/**
+ * @brief Create a pool of registered TX/RX buffers
+ *
+ * The buffers are carved out of a single contiguous region allocated once,
+ * so that the application can register them with a completion-based
+ * transport (io_uring fixed buffers, RDMA memory regions) before any
+ * connection is opened. Registered buffers are never given back to the
+ * memory allocator. When all of them are in use, the connections
+ * transparently fall back to buffers that are not registered
+ *
+ * @param[in] bufferSize Size of the buffers, in bytes
+ * @param[in] numBuffers Number of buffers in the region
+ * @return Handle referencing the newly created pool
+ **/
+
+TlsBufferPool *tlsInitRegisteredBufferPool(size_t bufferSize,
+   uint_t numBuffers)
+{
+   uint_t i;
+   uint8_t *buffer;
+   TlsBufferPool *bufferPool;
+
+   //The region must hold at least one buffer
+   if(numBuffers == 0)
+      return NULL;
+
+   //Create a pool with room for all the registered buffers
+   bufferPool = tlsInitBufferPool(bufferSize, numBuffers);
+   //Failed to create the pool?
+   if(bufferPool == NULL)
+      return NULL;
+
+   //Allocate the region holding the buffers
+   bufferPool->region = tlsAllocMem(bufferSize * numBuffers);
+   //Failed to allocate memory?
+   if(bufferPool->region == NULL)
+   {
+      //Clean up side effects
+      tlsFreeBufferPool(bufferPool);
+      //Report an error
+      return NULL;
+   }
+
+   //Clear the region
+   memset(bufferPool->region, 0, bufferSize * numBuffers);
+   //Save the number of buffers
+   bufferPool->numBuffers = numBuffers;
+
+   //All the buffers are initially idle
+   for(i = numBuffers; i > 0; i--)
+   {
+      //Point to the current buffer
+      buffer = bufferPool->region + (i - 1) * bufferSize;
+
+      //Add the buffer to the list
+      *((void **) buffer) = bufferPool->freeList;
+      bufferPool->freeList = buffer;
+   }
+
+   //Number of idle buffers
+   bufferPool->numFreeBuffers = numBuffers;
+
+   //Return a pointer to the newly created pool
+   return bufferPool;
+}
+
+
+/**
+ * @brief Retrieve the region holding the registered buffers of a pool
+ *
+ * The buffer with index i starts at region + i * bufferSize. The region
+ * remains valid until the pool is released
+ *
+ * @param[in] bufferPool Pool created by tlsInitRegisteredBufferPool()
+ * @param[out] region Start of the region
+ * @param[out] bufferSize Size of each buffer, in bytes
+ * @param[out] numBuffers Number of buffers in the region
+ * @return Error code
+ **/
+
+error_t tlsGetBufferPoolRegion(TlsBufferPool *bufferPool, uint8_t **region,
+   size_t *bufferSize, uint_t *numBuffers)
+{
+   //Check parameters
+   if(bufferPool == NULL || region == NULL || bufferSize == NULL ||
+      numBuffers == NULL)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //The pool does not hold registered buffers?
+   if(bufferPool->region == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //Return the layout of the region
+   *region = bufferPool->region;
+   *bufferSize = bufferPool->bufferSize;
+   *numBuffers = bufferPool->numBuffers;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get the index of the registered buffer holding a given address
+ *
+ * The transport calls this function from its submit callbacks to select
+ * the fixed buffer to be used by the request
+ *
+ * @param[in] bufferPool Pool created by tlsInitRegisteredBufferPool()
+ * @param[in] data Address located inside a TX/RX buffer
+ * @return Index of the registered buffer, or -1 if the address does not
+ *   belong to the region
+ **/
+
+int_t tlsGetRegisteredBufferIndex(TlsBufferPool *bufferPool,
+   const void *data)
+{
+   size_t offset;
+
+   //The pool does not hold registered buffers?
+   if(bufferPool == NULL || bufferPool->region == NULL)
+      return -1;
+
+   //The address must be located inside the region
+   if((const uint8_t *) data < bufferPool->region)
+      return -1;
+
+   //Offset of the address from the start of the region
+   offset = (const uint8_t *) data - bufferPool->region;
+
+   //Out of range?
+   if(offset >= (bufferPool->bufferSize * bufferPool->numBuffers))
+      return -1;
+
+   //Return the index of the buffer
+   return (int_t) (offset / bufferPool->bufferSize);
+}
+
+
+/**
+ * @brief Allocate a TX/RX buffer
+ * @param[in] bufferPool Pool the buffer is taken from (optional parameter)
+ * @param[in] size Required size, in bytes
+ * @return Pointer to the buffer (zero-filled)
+ **/
+
+uint8_t *tlsAllocBuffer(TlsBufferPool *bufferPool, size_t size)
+{
+   uint8_t *buffer;
+
+   //Initialize pointer
+   buffer = NULL;
+
+   //Can the buffer be taken from the pool?
+   if(bufferPool != NULL && size <= bufferPool->bufferSize)
+   {
+      //Acquire exclusive access to the pool
+      osAcquireMutex(&bufferPool->mutex);
+
+      //Any idle buffer available?
+      if(bufferPool->freeList != NULL)
+      {
+         //Remove the first buffer from the list
+         buffer = bufferPool->freeList;
+         bufferPool->freeList = *((void **) buffer);
+         bufferPool->numFreeBuffers--;
+      }
+
+      //Release exclusive access to the pool
+      osReleaseMutex(&bufferPool->mutex);
+
+      //Idle buffers are cleared when they are returned to the pool, except
+      //for the link to the next buffer
+      if(buffer != NULL)
+      {
+         memset(buffer, 0, sizeof(void *));
+      }
+      else
+      {
+         //All the buffers of the pool have the same size
+         size = bufferPool->bufferSize;
+      }
+   }
+
+   //The pool is empty or unsuitable?
+   if(buffer == NULL)
+   {
+      //Allocate a new buffer
+      buffer = tlsAllocMem(size);
+
+      //Successful memory allocation?
+      if(buffer != NULL)
+      {
+         memset(buffer, 0, size);
+      }
+   }
+
+   //Return a pointer to the buffer
+   return buffer;
+}
+
+
+/**
+ * @brief Release a TX/RX buffer
+ * @param[in] bufferPool Pool the buffer was taken from (optional parameter)
+ * @param[in] buffer Pointer to the buffer
+ * @param[in] size Size of the buffer, as passed to tlsAllocBuffer()
+ **/
+
+void tlsFreeBuffer(TlsBufferPool *bufferPool, uint8_t *buffer, size_t size)
+{
+   //Valid buffer?
+   if(buffer != NULL)
+   {
+      //Do not leave plaintext or key material behind
+      memset(buffer, 0, size);
+
+      //Can the buffer be returned to the pool?
+      if(bufferPool != NULL && size <= bufferPool->bufferSize)
+      {
+         //Acquire exclusive access to the pool
+         osAcquireMutex(&bufferPool->mutex);
+
+         //The number of idle buffers is bounded, and a pool of registered
+         //buffers only keeps the buffers of its region
+         if(bufferPool->numFreeBuffers < bufferPool->maxFreeBuffers &&
+            (bufferPool->region == NULL ||
+            tlsGetRegisteredBufferIndex(bufferPool, buffer) >= 0))
+         {
+            //Add the buffer to the list
+            *((void **) buffer) = bufferPool->freeList;
+            bufferPool->freeList = buffer;
+            bufferPool->numFreeBuffers++;
+
+            //The buffer is now owned by the pool
+            buffer = NULL;
+         }
+
+         //Release exclusive access to the pool
+         osReleaseMutex(&bufferPool->mutex);
+      }
+
+      //The pool is full or unsuitable?
+      if(buffer != NULL)
+      {
+         tlsFreeMem(buffer);
+      }
+   }
+}
+
+
+/**
+ * @brief Make sure the TX buffer is allocated
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsAcquireTxBuffer(TlsContext *context)
+{
+   //Allocate send buffer if necessary
+   if(context->txBuffer == NULL)
+   {
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //Static operating mode?
+      if(context->staticMem)
+      {
+         //The TX buffer cannot be enlarged
+         if(context->txBufferSize > context->staticTxBufferSize)
+            return ERROR_BUFFER_OVERFLOW;
+
+         //Use the buffer supplied by the application
+         context->txBuffer = context->staticTxBuffer;
+         //Successful processing
+         return NO_ERROR;
+      }
+#endif
+
+      //Allocate TX buffer
+      context->txBuffer = tlsAllocBuffer(context->bufferPool,
+         context->txBufferSize);
+
+      //Failed to allocate memory?
+      if(context->txBuffer == NULL)
+         return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Make sure the RX buffer is allocated
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsAcquireRxBuffer(TlsContext *context)
+{
+   //Allocate receive buffer if necessary
+   if(context->rxBuffer == NULL)
+   {
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //Static operating mode?
+      if(context->staticMem)
+      {
+         //The RX buffer cannot be enlarged
+         if(context->rxBufferSize > context->staticRxBufferSize)
+            return ERROR_BUFFER_OVERFLOW;
+
+         //Use the buffer supplied by the application
+         context->rxBuffer = context->staticRxBuffer;
+         //Successful processing
+         return NO_ERROR;
+      }
+#endif
+
+      //Allocate RX buffer
+      context->rxBuffer = tlsAllocBuffer(context->bufferPool,
+         context->rxBufferSize);
+
+      //Failed to allocate memory?
+      if(context->rxBuffer == NULL)
+         return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release the TX buffer
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsReleaseTxBuffer(TlsContext *context)
+{
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   //The buffer supplied by the application is never freed
+   if(context->txBuffer != context->staticTxBuffer)
+#endif
+   {
+      //Release send buffer
+      tlsFreeBuffer(context->bufferPool, context->txBuffer,
+         context->txBufferSize);
+   }
+
+   context->txBuffer = NULL;
+}
+
+
+/**
+ * @brief Release the RX buffer
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsReleaseRxBuffer(TlsContext *context)
+{
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   //The buffer supplied by the application is never freed
+   if(context->rxBuffer != context->staticRxBuffer)
+#endif
+   {
+      //Release receive buffer
+      tlsFreeBuffer(context->bufferPool, context->rxBuffer,
+         context->rxBufferSize);
+   }
+
+   context->rxBuffer = NULL;
+}
+
+
+/**
+ * @brief Give back the TX/RX buffers that do not hold any pending data
+ *
+ * This function has no effect unless the buffer release mode has been
+ * enabled with tlsEnableBufferRelease(). Buffers are only released once
+ * the connection is established, and never while a record is partially
+ * sent or received
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsReleaseIdleBuffers(TlsContext *context)
+{
+   //Buffers that were busy when the handshake completed are shrunk as soon
+   //as they become idle
+   if(context->bufferShrinkPending)
+      tlsShrinkBuffers(context);
+
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //The transport may still be accessing the buffers
+   if(context->txIoRequest.posted || context->rxIoRequest.posted)
+      return;
+#endif
+
+   //Buffer release mode enabled?
+   if(context->bufferReleaseEnabled &&
+      context->transportProtocol == TLS_TRANSPORT_PROTOCOL_STREAM &&
+      context->state == TLS_STATE_APPLICATION_DATA)
+   {
+      //No data pending in the TX buffer?
+      if(context->txBuffer != NULL && context->txBufferLen == 0 &&
+         context->txRecordLen == 0 && context->txPendingLen == 0 &&
+         !context->txZeroCopy)
+      {
+         //Release send buffer
+         tlsReleaseTxBuffer(context);
+      }
+
+      //No data pending in the RX buffer?
+      if(context->rxBuffer != NULL && context->rxBufferLen == 0 &&
+         context->rxRecordPos == 0)
+      {
+         //Release receive buffer
+         tlsReleaseRxBuffer(context);
+      }
+   }
+}
+
+
+/**
+ * @brief Shrink the TX/RX buffers to the negotiated record size
+ *
+ * The buffers are released and their size is reduced so that they can only
+ * hold the records allowed by the negotiated MaxFragmentLength and
+ * RecordSizeLimit extensions. They are allocated again, with the new size,
+ * the next time data is sent or received. A buffer that holds pending data
+ * is left untouched until it becomes idle
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsShrinkBuffers(TlsContext *context)
+{
+   size_t n;
+   size_t size;
+
+   //The buffers are shrunk once the connection is established
+   if(context->state != TLS_STATE_APPLICATION_DATA)
+      return;
+
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //The transport may still be accessing the buffers
+   if(context->txIoRequest.posted || context->rxIoRequest.posted)
+   {
+      //Try again once the requests have completed
+      context->bufferShrinkPending = TRUE;
+      return;
+   }
+#endif
+
+   //The operation is complete unless one of the buffers is busy
+   context->bufferShrinkPending = FALSE;
+
+   //DTLS records are already bounded by the PMTU
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+      return;
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   //The buffers supplied by the application cannot be resized
+   if(context->staticMem)
+      return;
+#endif
+
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+   //A renegotiation would require the buffers to hold whole handshake
+   //messages again
+   if(context->version <= TLS_VERSION_1_2 && context->secureRenegoEnabled)
+      return;
+#endif
+
+   //Largest record sent to the peer (post-handshake messages must still fit
+   //in the TX buffer)
+   n = tlsGetTxFragmentLimit(context);
+   n = MAX(n, TLS_MIN_RECORD_LENGTH);
+   n = MIN(n, context->txBufferMaxLen);
+
+   //Worst-case expansion of the record (including the inner content type
+   //of TLS 1.3)
+   size = n + sizeof(TlsRecord) + tlsComputeEncryptionOverhead(
+      &context->encryptionEngine, n) + 1;
+
+   //Can the TX buffer be shrunk?
+   if(size < context->txBufferSize)
+   {
+      //No data pending in the TX buffer?
+      if(context->txBuffer == NULL || (context->txBufferLen == 0 &&
+         context->txRecordLen == 0 && context->txPendingLen == 0 &&
+         !context->txZeroCopy))
+      {
+         //The buffer is released with its current size
+         if(context->txBuffer != NULL)
+            tlsReleaseTxBuffer(context);
+
+         //Size of the TX buffer allocated next time data is sent
+         context->txBufferMaxLen = n;
+         context->txBufferSize = size;
+      }
+      else
+      {
+         //Try again once the TX buffer is idle
+         context->bufferShrinkPending = TRUE;
+      }
+   }
+
+   //Largest record the peer is allowed to send
+   n = context->rxBufferMaxLen;
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   //The negotiated maximum fragment length applies to both directions
+   if(context->maxFragLenExtReceived)
+      n = MIN(n, context->maxFragLen);
+#endif
+
+   //Worst-case expansion of the record (including the inner content type
+   //of TLS 1.3)
+   size = n + sizeof(TlsRecord) + tlsComputeEncryptionOverhead(
+      &context->decryptionEngine, n) + 1;
+
+   //The peer may add up to 255 bytes of padding to CBC records
+   if(context->decryptionEngine.cipherMode == CIPHER_MODE_CBC)
+      size += 255;
+
+   //Can the RX buffer be shrunk?
+   if(size < context->rxBufferSize)
+   {
+      //No data pending in the RX buffer?
+      if(context->rxBuffer == NULL || (context->rxBufferLen == 0 &&
+         context->rxRecordPos == 0))
+      {
+         //The buffer is released with its current size
+         if(context->rxBuffer != NULL)
+            tlsReleaseRxBuffer(context);
+
+         //Size of the RX buffer allocated next time data is received
+         context->rxBufferSize = size;
+      }
+      else
+      {
+         //Try again once the RX buffer is idle
+         context->bufferShrinkPending = TRUE;
+      }
+   }
+}
+
+
+/**
+ * @brief Release a pool of TX/RX buffers
+ * @param[in] bufferPool Pointer to the pool
+ **/
+
+void tlsFreeBufferPool(TlsBufferPool *bufferPool)
+{
+   void *buffer;
+
+   //Valid pool?
+   if(bufferPool != NULL)
+   {
+      //Release the idle buffers
+      while(bufferPool->freeList != NULL)
+      {
+         buffer = bufferPool->freeList;
+         bufferPool->freeList = *((void **) buffer);
+
+         //Registered buffers are released together with the region
+         if(bufferPool->region == NULL)
+            tlsFreeMem(buffer);
+      }
+
+      //Release the region holding the registered buffers
+      if(bufferPool->region != NULL)
+         tlsFreeMem(bufferPool->region);
+
+      //Release mutex object
+      osDeleteMutex(&bufferPool->mutex);
+
+      //Properly dispose the pool
+      tlsFreeMem(bufferPool);
+   }
+}
+
+#endif
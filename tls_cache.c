@@ -35,6 +35,7 @@
 #include <string.h>
 #include "tls.h"
 #include "tls_cache.h"
+#include "tls_misc.h"
 #include "debug.h"
 
 //Check TLS library configuration
@@ -49,15 +50,41 @@
 
 TlsCache *tlsInitCache(uint_t size)
 {
+   //Use a single shard with one hash bucket per cache entry
+   return tlsInitCacheEx(size, 1, size);
+}
+
+
+/**
+ * @brief Session cache initialization (sharded mode)
+ *
+ * Cache entries are indexed by a hash of the session ID and split into
+ * several independently locked shards, so that concurrent lookups from
+ * different connections seldom contend for the same mutex
+ *
+ * @param[in] size Maximum number of cache entries
+ * @param[in] numShards Number of independently locked shards
+ * @param[in] numBuckets Number of hash buckets per shard
+ * @return Handle referencing the fully initialized session cache
+ **/
+
+TlsCache *tlsInitCacheEx(uint_t size, uint_t numShards, uint_t numBuckets)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
    size_t n;
    TlsCache *cache;
+   TlsCacheShard *shard;
 
-   //Make sure the parameter is acceptable
-   if(size < 1)
+   //Make sure the parameters are acceptable
+   if(size < 1 || numShards < 1 || numShards > size || numBuckets < 1)
       return NULL;
 
    //Size of the memory required
-   n = sizeof(TlsCache) + size * sizeof(TlsSessionState);
+   n = sizeof(TlsCache) + size * sizeof(TlsCacheEntry) +
+      numShards * sizeof(TlsCacheShard) +
+      (numShards * numBuckets + size) * sizeof(uint_t);
 
    //Allocate a memory buffer to hold the session cache
    cache = tlsAllocMem(n);
@@ -68,17 +95,76 @@ TlsCache *tlsInitCache(uint_t size)
    //Clear memory
    memset(cache, 0, n);
 
-   //Create a mutex to prevent simultaneous access to the cache
-   if(!osCreateMutex(&cache->mutex))
-   {
-      //Clean up side effects
-      tlsFreeMem(cache);
-      //Report an error
-      return NULL;
-   }
-
    //Save the maximum number of cache entries
    cache->size = size;
+   //Save the number of shards and the number of hash buckets per shard
+   cache->numShards = numShards;
+   cache->numBuckets = numBuckets;
+   //Default lifetime of cache entries
+   cache->lifetime = TLS_SESSION_CACHE_LIFETIME;
+
+   //The shard descriptors are located after the cache entries
+   cache->shards = (TlsCacheShard *) (cache->entries + size);
+   //The hash chains are located after the shard descriptors
+   cache->next = (uint_t *) (cache->shards + numShards);
+
+   //Loop through the shards
+   for(k = 0, i = 0; i < numShards; i++)
+   {
+      //Point to the current shard
+      shard = &cache->shards[i];
+
+      //Create a mutex to prevent simultaneous access to the shard
+      if(!osCreateMutex(&shard->mutex))
+      {
+         //Clean up side effects
+         while(i-- > 0)
+         {
+            osDeleteMutex(&cache->shards[i].mutex);
+         }
+
+         //Release previously allocated memory
+         tlsFreeMem(cache);
+         //Report an error
+         return NULL;
+      }
+
+      //Distribute the cache entries evenly among the shards
+      shard->first = k;
+      shard->size = size / numShards;
+
+      //The remaining entries are assigned to the first shards
+      if(i < (size % numShards))
+      {
+         shard->size++;
+      }
+
+      //Each shard has its own set of hash buckets
+      shard->buckets = cache->next + size + i * numBuckets;
+
+      //All the hash chains are initially empty
+      for(j = 0; j < numBuckets; j++)
+      {
+         shard->buckets[j] = TLS_CACHE_INVALID_INDEX;
+      }
+
+      //All the entries owned by the shard are initially free
+      for(j = 0; j < shard->size; j++)
+      {
+         if((j + 1) < shard->size)
+            cache->next[k + j] = k + j + 1;
+         else
+            cache->next[k + j] = TLS_CACHE_INVALID_INDEX;
+      }
+
+      //Initialize the free list
+      shard->freeList = k;
+      //The CLOCK hand starts at the first entry of the shard
+      shard->victim = k;
+
+      //Index of the first entry owned by the next shard
+      k += shard->size;
+   }
 
    //Return a pointer to the newly created cache
    return cache;
@@ -86,77 +172,217 @@ TlsCache *tlsInitCache(uint_t size)
 
 
 /**
- * @brief Search the session cache for a given session ID
+ * @brief Session cache initialization (memory budget)
+ *
+ * The number of entries is derived from the amount of memory the cache may
+ * use, including the shard descriptors and the hash chains. One hash bucket
+ * is provided per cache entry
+ *
+ * @param[in] budget Maximum amount of memory, in bytes
+ * @param[in] numShards Number of independently locked shards
+ * @return Handle referencing the fully initialized session cache
+ **/
+
+TlsCache *tlsInitCacheBudget(size_t budget, uint_t numShards)
+{
+   size_t n;
+   uint_t size;
+
+   //Fixed overhead
+   n = sizeof(TlsCache) + numShards * sizeof(TlsCacheShard);
+
+   //Make sure the budget is acceptable
+   if(numShards < 1 || budget <= n)
+      return NULL;
+
+   //Each entry costs its slot, its link and its hash bucket
+   size = (budget - n) / (sizeof(TlsCacheEntry) + 2 * sizeof(uint_t));
+
+   //Round the number of entries down to a multiple of the number of shards
+   size -= size % numShards;
+
+   //The budget must allow at least one entry per shard
+   if(size < numShards)
+      return NULL;
+
+   //Initialize the session cache
+   return tlsInitCacheEx(size, numShards, size / numShards);
+}
+
+
+/**
+ * @brief Set the lifetime of the entries of a session cache
  * @param[in] cache Pointer to the session cache
+ * @param[in] lifetime Lifetime of cache entries, in milliseconds
+ * @return Error code
+ **/
+
+error_t tlsSetCacheLifetime(TlsCache *cache, systime_t lifetime)
+{
+   //Check parameters
+   if(cache == NULL || lifetime == 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the lifetime of cache entries
+   cache->lifetime = lifetime;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Check whether a cache entry matches a given session ID
+ * @param[in] entry Pointer to the cache entry
  * @param[in] sessionId Expected session ID
  * @param[in] sessionIdLen Length of the session ID
- * @return A pointer to the matching session is returned. NULL is returned
- *   if the specified ID could not be found in the session cache
+ * @return TRUE if the entry holds the specified session, else FALSE
  **/
 
-TlsSessionState *tlsFindCache(TlsCache *cache, const uint8_t *sessionId,
+bool_t tlsMatchCacheEntry(const TlsCacheEntry *entry, const uint8_t *sessionId,
    size_t sessionIdLen)
+{
+   //The session ID is located right after the version and the cipher suite
+   //in the serialized session state
+   if(entry->length != 0 && entry->data[4] == sessionIdLen &&
+      !memcmp(entry->data + 5, sessionId, sessionIdLen))
+   {
+      return TRUE;
+   }
+   else
+   {
+      return FALSE;
+   }
+}
+
+
+/**
+ * @brief Search the session cache for a given session ID
+ *
+ * The entry is copied out while the shard is locked, and decoded once the
+ * lock has been released
+ *
+ * @param[in] cache Pointer to the session cache
+ * @param[in] sessionId Expected session ID
+ * @param[in] sessionIdLen Length of the session ID
+ * @param[out] session Copy of the matching session state
+ * @return Error code (ERROR_NOT_FOUND if the specified ID could not be found
+ *   in the session cache)
+ **/
+
+error_t tlsFindCache(TlsCache *cache, const uint8_t *sessionId,
+   size_t sessionIdLen, TlsSessionState *session)
 {
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   error_t error;
    uint_t i;
+   uint32_t h;
+   uint_t *prev;
+   size_t length;
    systime_t time;
-   TlsSessionState *session;
+   systime_t timestamp;
+   TlsCacheShard *shard;
+   uint8_t buffer[TLS_MAX_SERIALIZED_SESSION_SIZE];
 
    //Check parameters
-   if(cache == NULL || sessionId == NULL || sessionIdLen == 0)
-      return NULL;
+   if(cache == NULL || sessionId == NULL || sessionIdLen == 0 ||
+      session == NULL)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
 
-   //Initialize session state
-   session = NULL;
+   //Initialize variables
+   length = 0;
+   timestamp = 0;
+
+   //Hash the session ID
+   h = tlsComputeIndexHash(sessionId, sessionIdLen);
+   //Select the relevant shard
+   shard = &cache->shards[h % cache->numShards];
 
    //Get current time
    time = osGetSystemTime();
 
-   //Acquire exclusive access to the session cache
-   osAcquireMutex(&cache->mutex);
+   //Acquire exclusive access to the shard
+   osAcquireMutex(&shard->mutex);
 
-   //Flush expired entries
-   for(i = 0; i < cache->size; i++)
+   //Point to the head of the relevant hash chain
+   prev = &shard->buckets[(h / cache->numShards) % cache->numBuckets];
+
+   //Walk through the hash chain
+   while(*prev != TLS_CACHE_INVALID_INDEX)
    {
-      //Skip unused entries
-      if(cache->sessions[i].sessionIdLen != 0)
+      //Index of the current entry
+      i = *prev;
+
+      //Outdated entry?
+      if((time - cache->entries[i].timestamp) >= cache->lifetime)
       {
-         //Outdated entry?
-         if((time - cache->sessions[i].timestamp) >= TLS_SESSION_CACHE_LIFETIME)
+         //Expired entries are flushed lazily, as the hash chain is traversed
+         *prev = cache->next[i];
+
+         //This session is no more valid and should be removed from the cache
+         memset(&cache->entries[i], 0, sizeof(TlsCacheEntry));
+
+         //Return the entry to the free list
+         cache->next[i] = shard->freeList;
+         shard->freeList = i;
+      }
+      else
+      {
+         //Check whether the current entry matches the specified session ID
+         if(tlsMatchCacheEntry(&cache->entries[i], sessionId, sessionIdLen))
          {
-            //This session is no more valid and should be removed from the cache
-            tlsFreeSessionState(&cache->sessions[i]);
+            //The entry has been used recently
+            cache->entries[i].referenced = TRUE;
+
+            //Copy the serialized session state
+            length = cache->entries[i].length;
+            memcpy(buffer, cache->entries[i].data, length);
+            timestamp = cache->entries[i].timestamp;
+            break;
          }
+
+         //Point to the next entry in the hash chain
+         prev = &cache->next[i];
       }
    }
 
-   //Search the cache for the specified session ID
-   for(i = 0; i < cache->size; i++)
+   //Release exclusive access to the shard
+   osReleaseMutex(&shard->mutex);
+
+   //Matching session found?
+   if(length > 0)
    {
-      //Check whether the current identifier matches the specified session ID
-      if(cache->sessions[i].sessionIdLen == sessionIdLen &&
-         !memcmp(cache->sessions[i].sessionId, sessionId, sessionIdLen))
-      {
-         //A matching session has been found
-         session = &cache->sessions[i];
-         break;
-      }
-   }
+      //Decode the session state
+      error = tlsDeserializeSessionState(session, buffer, length);
+      //Restore the time stamp of the entry
+      session->timestamp = timestamp;
 
-   //Release exclusive access to the session cache
-   osReleaseMutex(&cache->mutex);
+      //Clear the copy of the master secret
+      memset(buffer, 0, length);
+   }
+   else
+   {
+      //The specified ID could not be found in the session cache
+      error = ERROR_NOT_FOUND;
+   }
 
-   //Return a pointer to the matching session, if any
-   return session;
+   //Return status code
+   return error;
 #else
    //Not implemented
-   return NULL;
+   return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
  * @brief Save current session in cache
+ *
+ * The session state is serialized before the shard is locked. Entries are
+ * evicted using the CLOCK algorithm, hence no memory allocation takes place
+ *
  * @param[in] context TLS context
  * @return Error code
  **/
@@ -166,87 +392,148 @@ error_t tlsSaveToCache(TlsContext *context)
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
    error_t error;
    uint_t i;
-   systime_t time;
-   TlsSessionState *session;
-   TlsSessionState *firstFreeEntry;
-   TlsSessionState *oldestEntry;
+   uint_t *head;
+   uint32_t h;
+   size_t length;
+   TlsCache *cache;
+   TlsCacheShard *shard;
+   TlsSessionState session;
+   uint8_t buffer[TLS_MAX_SERIALIZED_SESSION_SIZE];
 
    //Check parameters
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //The state of a session resumed via a ticket is held by the client. The
+   //session ID merely echoes the value chosen by the client
+   if(context->ticketResume)
+      return NO_ERROR;
+#endif
+
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   //Forward the session to the external session cache, if any
+   tlsSaveToExtCache(context);
+#endif
+
    //Check whether session caching is supported
    if(context->cache == NULL)
       return ERROR_FAILURE;
 
    //Ensure the session ID is valid
-   if(context->sessionIdLen == 0)
+   if(context->sessionIdLen == 0 || context->cipherSuite.identifier == 0)
       return NO_ERROR;
 
-   //Acquire exclusive access to the session cache
-   osAcquireMutex(&context->cache->mutex);
+   //Point to the session cache
+   cache = context->cache;
 
-   //Get current time
-   time = osGetSystemTime();
+   //The session state references the fields of the TLS context, so that no
+   //memory allocation is required
+   memset(&session, 0, sizeof(TlsSessionState));
+   session.version = context->version;
+   session.cipherSuite = context->cipherSuite.identifier;
+   memcpy(session.sessionId, context->sessionId, context->sessionIdLen);
+   session.sessionIdLen = context->sessionIdLen;
+   memcpy(session.secret, context->masterSecret, TLS_MASTER_SECRET_SIZE);
+#if (TLS_EXT_MASTER_SECRET_SUPPORT == ENABLED)
+   session.extendedMasterSecret = context->extendedMasterSecretExtReceived;
+#endif
+#if (TLS_SNI_SUPPORT == ENABLED)
+   session.serverName = context->serverName;
+#endif
 
-   //Keep track of the first free entry
-   firstFreeEntry = NULL;
-   //Keep track of the oldest entry
-   oldestEntry = NULL;
+   //Serialize the session state
+   error = tlsSerializeSessionState(&session, buffer, &length);
+   //Clear the copy of the master secret
+   memset(&session, 0, sizeof(TlsSessionState));
 
-   //Search the cache for the specified session ID
-   for(i = 0; i < context->cache->size; i++)
+   //Sessions that cannot be serialized are not cached
+   if(error)
    {
-      //Point to the current entry
-      session = &context->cache->sessions[i];
+      memset(buffer, 0, sizeof(buffer));
+      return NO_ERROR;
+   }
+
+   //Hash the session ID
+   h = tlsComputeIndexHash(context->sessionId, context->sessionIdLen);
+   //Select the relevant shard
+   shard = &cache->shards[h % cache->numShards];
+
+   //Acquire exclusive access to the shard
+   osAcquireMutex(&shard->mutex);
 
+   //Point to the head of the relevant hash chain
+   head = &shard->buckets[(h / cache->numShards) % cache->numBuckets];
+
+   //Search the hash chain for the specified session ID
+   for(i = *head; i != TLS_CACHE_INVALID_INDEX; i = cache->next[i])
+   {
       //If the session ID already exists, we are done
-      if(session->sessionIdLen == context->sessionIdLen &&
-         !memcmp(session->sessionId, context->sessionId, session->sessionIdLen))
+      if(tlsMatchCacheEntry(&cache->entries[i], context->sessionId,
+         context->sessionIdLen))
       {
-         //Do not write to session cache
-         firstFreeEntry = NULL;
-         oldestEntry = NULL;
-         //Exit immediately
          break;
       }
+   }
 
-      //Check whether current entry is free
-      if(session->sessionIdLen == 0)
+   //Do not write to session cache if the session ID already exists
+   if(i == TLS_CACHE_INVALID_INDEX)
+   {
+      //Any free entry available?
+      if(shard->freeList != TLS_CACHE_INVALID_INDEX)
       {
-         //Keep track of the first free entry
-         if(!firstFreeEntry)
-         {
-            firstFreeEntry = session;
-         }
+         //Take the first entry from the free list
+         i = shard->freeList;
+         shard->freeList = cache->next[i];
       }
       else
       {
-         //Keep track of the oldest entry in the table
-         if(oldestEntry == NULL)
+         //The CLOCK hand skips the entries that have been used since its
+         //last pass, clearing their reference bit
+         while(cache->entries[shard->victim].referenced)
          {
-            oldestEntry = session;
-         }
-         else if((time - session->timestamp) > (time - oldestEntry->timestamp))
-         {
-            oldestEntry = session;
+            //Give the entry a second chance
+            cache->entries[shard->victim].referenced = FALSE;
+
+            //Advance the CLOCK hand
+            if((shard->victim + 1) < (shard->first + shard->size))
+               shard->victim++;
+            else
+               shard->victim = shard->first;
          }
+
+         //Evict the entry under the CLOCK hand
+         i = shard->victim;
+
+         //Advance the CLOCK hand
+         if((shard->victim + 1) < (shard->first + shard->size))
+            shard->victim++;
+         else
+            shard->victim = shard->first;
+
+         //Remove the victim from its hash chain
+         tlsUnlinkCacheEntry(cache, shard, i);
       }
+
+      //Save current session
+      memcpy(cache->entries[i].data, buffer, length);
+      cache->entries[i].length = (uint16_t) length;
+      cache->entries[i].timestamp = osGetSystemTime();
+      cache->entries[i].referenced = FALSE;
+
+      //Insert the entry at the head of the hash chain
+      cache->next[i] = *head;
+      *head = i;
    }
 
-   //Add current session to cache if necessary
-   if(firstFreeEntry != NULL)
-      error = tlsSaveSessionState(context, firstFreeEntry);
-   else if(oldestEntry != NULL)
-      error = tlsSaveSessionState(context, oldestEntry);
-   else
-      error = NO_ERROR;
+   //Release exclusive access to the shard
+   osReleaseMutex(&shard->mutex);
 
-   //Release exclusive access to the session cache
-   osReleaseMutex(&context->cache->mutex);
+   //Clear the copy of the master secret
+   memset(buffer, 0, sizeof(buffer));
 
-   //Return status code
-   return error;
+   //Successful processing
+   return NO_ERROR;
 #else
    //Not implemented
    return ERROR_NOT_IMPLEMENTED;
@@ -264,12 +551,20 @@ error_t tlsRemoveFromCache(TlsContext *context)
 {
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
    uint_t i;
-   TlsSessionState *session;
+   uint_t *prev;
+   uint32_t h;
+   TlsCache *cache;
+   TlsCacheShard *shard;
 
    //Check parameters
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   //Remove the session from the external session cache, if any
+   tlsRemoveFromExtCache(context);
+#endif
+
    //Check whether session caching is supported
    if(context->cache == NULL)
       return ERROR_FAILURE;
@@ -278,26 +573,49 @@ error_t tlsRemoveFromCache(TlsContext *context)
    if(context->sessionIdLen == 0)
       return NO_ERROR;
 
-   //Acquire exclusive access to the session cache
-   osAcquireMutex(&context->cache->mutex);
+   //Point to the session cache
+   cache = context->cache;
+
+   //Hash the session ID
+   h = tlsComputeIndexHash(context->sessionId, context->sessionIdLen);
+   //Select the relevant shard
+   shard = &cache->shards[h % cache->numShards];
 
-   //Search the cache for the specified session ID
-   for(i = 0; i < context->cache->size; i++)
+   //Acquire exclusive access to the shard
+   osAcquireMutex(&shard->mutex);
+
+   //Point to the head of the relevant hash chain
+   prev = &shard->buckets[(h / cache->numShards) % cache->numBuckets];
+
+   //Search the hash chain for the specified session ID
+   while(*prev != TLS_CACHE_INVALID_INDEX)
    {
-      //Point to the current entry
-      session = &context->cache->sessions[i];
+      //Index of the current entry
+      i = *prev;
 
-      //Check whether the current identifier matches the specified session ID
-      if(session->sessionIdLen == context->sessionIdLen &&
-         !memcmp(session->sessionId, context->sessionId, session->sessionIdLen))
+      //Check whether the current entry matches the specified session ID
+      if(tlsMatchCacheEntry(&cache->entries[i], context->sessionId,
+         context->sessionIdLen))
       {
+         //Remove the entry from the hash chain
+         *prev = cache->next[i];
+
          //Drop current entry
-         tlsFreeSessionState(session);
+         memset(&cache->entries[i], 0, sizeof(TlsCacheEntry));
+
+         //Return the entry to the free list
+         cache->next[i] = shard->freeList;
+         shard->freeList = i;
+      }
+      else
+      {
+         //Point to the next entry in the hash chain
+         prev = &cache->next[i];
       }
    }
 
-   //Release exclusive access to the session cache
-   osReleaseMutex(&context->cache->mutex);
+   //Release exclusive access to the shard
+   osReleaseMutex(&shard->mutex);
 #endif
 
    //Successful processing
@@ -305,6 +623,403 @@ error_t tlsRemoveFromCache(TlsContext *context)
 }
 
 
+/**
+ * @brief Remove a given entry from its hash chain
+ * @param[in] cache Pointer to the session cache
+ * @param[in] shard Shard that owns the entry
+ * @param[in] index Index of the entry to be removed
+ **/
+
+void tlsUnlinkCacheEntry(TlsCache *cache, TlsCacheShard *shard, uint_t index)
+{
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   uint_t *prev;
+   uint32_t h;
+   TlsCacheEntry *entry;
+
+   //Point to the cache entry
+   entry = &cache->entries[index];
+
+   //Valid entry?
+   if(entry->length != 0)
+   {
+      //Retrieve the hash chain the entry belongs to
+      h = tlsComputeIndexHash(entry->data + 5, entry->data[4]);
+      prev = &shard->buckets[(h / cache->numShards) % cache->numBuckets];
+
+      //Walk through the hash chain
+      while(*prev != TLS_CACHE_INVALID_INDEX)
+      {
+         //Matching entry?
+         if(*prev == index)
+         {
+            //Remove the entry from the hash chain
+            *prev = cache->next[index];
+            break;
+         }
+
+         //Point to the next entry in the hash chain
+         prev = &cache->next[*prev];
+      }
+
+      //Clear the session state
+      memset(entry, 0, sizeof(TlsCacheEntry));
+   }
+#endif
+}
+
+
+/**
+ * @brief Serialize a TLS 1.2 session state
+ *
+ * The compact format is made of the version, the cipher suite, the session
+ * ID, the master secret, a flags byte and the server name. It is meant to be
+ * stored in an external session cache shared by several server processes
+ *
+ * @param[in] session Pointer to the session state
+ * @param[out] p Output buffer (TLS_MAX_SERIALIZED_SESSION_SIZE bytes)
+ * @param[out] written Length of the serialized session state
+ * @return Error code
+ **/
+
+error_t tlsSerializeSessionState(const TlsSessionState *session, uint8_t *p,
+   size_t *written)
+{
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   size_t n;
+
+   //Only sessions established with TLS 1.2 or earlier can be serialized
+   if(session->version > TLS_VERSION_1_2 || session->sessionIdLen == 0 ||
+      session->sessionIdLen > 32)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Version and cipher suite
+   STORE16BE(session->version, p);
+   STORE16BE(session->cipherSuite, p + 2);
+
+   //Session identifier
+   p[4] = (uint8_t) session->sessionIdLen;
+   memcpy(p + 5, session->sessionId, session->sessionIdLen);
+   n = 5 + session->sessionIdLen;
+
+   //Master secret
+   memcpy(p + n, session->secret, TLS_MASTER_SECRET_SIZE);
+   n += TLS_MASTER_SECRET_SIZE;
+
+   //Flags
+   p[n++] = session->extendedMasterSecret ? 0x01 : 0x00;
+
+#if (TLS_SNI_SUPPORT == ENABLED)
+   //Server name
+   if(session->serverName != NULL)
+   {
+      size_t m;
+
+      //Retrieve the length of the server name
+      m = strlen(session->serverName);
+
+      //Check the length of the server name
+      if(m > TLS_MAX_SERVER_NAME_LEN)
+         return ERROR_INVALID_LENGTH;
+
+      //Copy the server name
+      STORE16BE(m, p + n);
+      memcpy(p + n + 2, session->serverName, m);
+      n += 2 + m;
+   }
+   else
+#endif
+   {
+      //No server name
+      STORE16BE(0, p + n);
+      n += 2;
+   }
+
+   //Length of the serialized session state
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Deserialize a TLS 1.2 session state
+ * @param[out] session Pointer to the session state
+ * @param[in] p Serialized session state
+ * @param[in] length Length of the serialized session state
+ * @return Error code
+ **/
+
+error_t tlsDeserializeSessionState(TlsSessionState *session, const uint8_t *p,
+   size_t length)
+{
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   size_t m;
+   size_t n;
+
+   //Release previous session state
+   tlsFreeSessionState(session);
+
+   //Malformed session state?
+   if(length < 5 || p[4] == 0 || p[4] > 32)
+      return ERROR_DECODING_FAILED;
+
+   //Retrieve the length of the session identifier
+   n = 5 + p[4];
+
+   //Malformed session state?
+   if(length < (n + TLS_MASTER_SECRET_SIZE + 3))
+      return ERROR_DECODING_FAILED;
+
+   //Retrieve the length of the server name
+   m = LOAD16BE(p + n + TLS_MASTER_SECRET_SIZE + 1);
+
+   //Malformed session state?
+   if(length != (n + TLS_MASTER_SECRET_SIZE + 3 + m))
+      return ERROR_DECODING_FAILED;
+
+   //Version and cipher suite
+   session->version = LOAD16BE(p);
+   session->cipherSuite = LOAD16BE(p + 2);
+
+   //Only sessions established with TLS 1.2 or earlier can be deserialized
+   if(session->version > TLS_VERSION_1_2)
+   {
+      tlsFreeSessionState(session);
+      return ERROR_DECODING_FAILED;
+   }
+
+   //Session identifier
+   session->sessionIdLen = p[4];
+   memcpy(session->sessionId, p + 5, session->sessionIdLen);
+
+   //Master secret
+   memcpy(session->secret, p + n, TLS_MASTER_SECRET_SIZE);
+   n += TLS_MASTER_SECRET_SIZE;
+
+   //Flags
+   session->extendedMasterSecret = (p[n] & 0x01) ? TRUE : FALSE;
+   n += 3;
+
+#if (TLS_SNI_SUPPORT == ENABLED)
+   //Server name
+   if(m > 0)
+   {
+      //Allocate a memory block to hold the server name
+      session->serverName = tlsAllocMem(m + 1);
+      //Failed to allocate memory?
+      if(session->serverName == NULL)
+      {
+         //Clean up side effects
+         tlsFreeSessionState(session);
+         //Report an error
+         return ERROR_OUT_OF_MEMORY;
+      }
+
+      //Copy the server name
+      memcpy(session->serverName, p + n, m);
+      session->serverName[m] = '\0';
+   }
+#endif
+
+   //The lifetime of the entry is managed by the external session cache
+   session->timestamp = osGetSystemTime();
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Search the external session cache for a given session ID
+ *
+ * The first call starts the lookup. If the result is not available yet,
+ * ERROR_WOULD_BLOCK is returned and the ClientHello is parked until the
+ * application posts the result with tlsPostExtCacheResult
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] sessionId Session ID offered by the client
+ * @param[in] sessionIdLen Length of the session ID, in bytes
+ * @param[out] session Session state retrieved from the external cache
+ * @return Error code
+ **/
+
+error_t tlsFindExtCache(TlsContext *context, const uint8_t *sessionId,
+   size_t sessionIdLen, TlsSessionState *session)
+{
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED && \
+   TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   error_t error;
+
+   //External session cache not used?
+   if(context->extCacheGetCallback == NULL || sessionIdLen == 0)
+      return ERROR_NOT_FOUND;
+
+   //A parked ClientHello is re-parsed from the TLS receive buffer. Renegotiation
+   //and DTLS are not supported
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM ||
+      context->state != TLS_STATE_CLIENT_HELLO)
+   {
+      return ERROR_NOT_FOUND;
+   }
+
+   //Start a new lookup?
+   if(context->extCacheState == TLS_EXT_CACHE_STATE_IDLE)
+   {
+      //The lookup is now pending
+      context->extCacheState = TLS_EXT_CACHE_STATE_PENDING;
+
+      //Invoke user-defined callback
+      error = context->extCacheGetCallback(context, sessionId, sessionIdLen,
+         context->extCacheParam);
+
+      //The lookup could not be started?
+      if(error != NO_ERROR && error != ERROR_WOULD_BLOCK &&
+         context->extCacheState == TLS_EXT_CACHE_STATE_PENDING)
+      {
+         //Proceed with a full handshake
+         context->extCacheState = TLS_EXT_CACHE_STATE_IDLE;
+         return ERROR_NOT_FOUND;
+      }
+   }
+
+   //The result has not been posted yet?
+   if(context->extCacheState == TLS_EXT_CACHE_STATE_PENDING)
+      return ERROR_WOULD_BLOCK;
+
+   //Matching session found?
+   if(context->extCacheStatus == NO_ERROR && context->extCacheResult != NULL)
+   {
+      //Decode the serialized session state
+      error = tlsDeserializeSessionState(session, context->extCacheResult,
+         context->extCacheResultLen);
+
+      //Make sure the session ID matches the one offered by the client
+      if(!error && (session->sessionIdLen != sessionIdLen ||
+         memcmp(session->sessionId, sessionId, sessionIdLen)))
+      {
+         tlsFreeSessionState(session);
+         error = ERROR_NOT_FOUND;
+      }
+   }
+   else
+   {
+      //No matching session
+      error = ERROR_NOT_FOUND;
+   }
+
+   //Release the posted result
+   if(context->extCacheResult != NULL)
+   {
+      memset(context->extCacheResult, 0, context->extCacheResultLen);
+      tlsFreeMem(context->extCacheResult);
+      context->extCacheResult = NULL;
+      context->extCacheResultLen = 0;
+   }
+
+   //The lookup is complete
+   context->extCacheState = TLS_EXT_CACHE_STATE_IDLE;
+
+   //Return status code
+   return error;
+#else
+   //Not implemented
+   return ERROR_NOT_FOUND;
+#endif
+}
+
+
+/**
+ * @brief Save current session in the external session cache
+ * @param[in] context TLS context
+ * @return Error code
+ **/
+
+error_t tlsSaveToExtCache(TlsContext *context)
+{
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED && \
+   TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   error_t error;
+   size_t n;
+   TlsSessionState session;
+   uint8_t buffer[TLS_MAX_SERIALIZED_SESSION_SIZE];
+
+   //External session cache not used?
+   if(context->extCachePutCallback == NULL)
+      return NO_ERROR;
+
+   //Resumed sessions are already present in the external session cache
+   if(context->resume || context->sessionIdLen == 0)
+      return NO_ERROR;
+
+   //Initialize session state
+   tlsInitSessionState(&session);
+
+   //Save current session
+   error = tlsSaveSessionState(context, &session);
+
+   //Check status code
+   if(!error)
+   {
+      //Serialize the session state
+      error = tlsSerializeSessionState(&session, buffer, &n);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Invoke user-defined callback
+      error = context->extCachePutCallback(context, context->sessionId,
+         context->sessionIdLen, buffer, n, context->extCacheParam);
+   }
+
+   //Erase the master secret
+   memset(buffer, 0, sizeof(buffer));
+   tlsFreeSessionState(&session);
+
+   //Return status code
+   return error;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Remove current session from the external session cache
+ * @param[in] context TLS context
+ * @return Error code
+ **/
+
+error_t tlsRemoveFromExtCache(TlsContext *context)
+{
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   //External session cache not used?
+   if(context->extCacheDeleteCallback == NULL || context->sessionIdLen == 0)
+      return NO_ERROR;
+
+   //Invoke user-defined callback
+   return context->extCacheDeleteCallback(context, context->sessionId,
+      context->sessionIdLen, context->extCacheParam);
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Properly dispose a session cache
  * @param[in] cache Pointer to the session cache to be released
@@ -317,16 +1032,16 @@ void tlsFreeCache(TlsCache *cache)
    //Valid session cache?
    if(cache != NULL)
    {
-      //Loop through the session cache
-      for(i = 0; i < cache->size; i++)
+      //Clear the cached master secrets
+      memset(cache->entries, 0, cache->size * sizeof(TlsCacheEntry));
+
+      //Loop through the shards
+      for(i = 0; i < cache->numShards; i++)
       {
-         //Release current entry
-         tlsFreeSessionState(&cache->sessions[i]);
+         //Release mutex object
+         osDeleteMutex(&cache->shards[i].mutex);
       }
 
-      //Release mutex object
-      osDeleteMutex(&cache->mutex);
-
       //Properly dispose the session cache
       tlsFreeMem(cache);
    }
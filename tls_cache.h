@@ -34,6 +34,9 @@
 //Dependencies
 #include "tls.h"
 
+//Invalid index in hash chains
+#define TLS_CACHE_INVALID_INDEX ((uint_t) -1)
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
@@ -41,12 +44,33 @@ extern "C" {
 
 //Session cache management
 TlsCache *tlsInitCache(uint_t size);
+TlsCache *tlsInitCacheEx(uint_t size, uint_t numShards, uint_t numBuckets);
+TlsCache *tlsInitCacheBudget(size_t budget, uint_t numShards);
+error_t tlsSetCacheLifetime(TlsCache *cache, systime_t lifetime);
 
-TlsSessionState *tlsFindCache(TlsCache *cache, const uint8_t *sessionId,
+bool_t tlsMatchCacheEntry(const TlsCacheEntry *entry, const uint8_t *sessionId,
    size_t sessionIdLen);
 
+error_t tlsFindCache(TlsCache *cache, const uint8_t *sessionId,
+   size_t sessionIdLen, TlsSessionState *session);
+
 error_t tlsSaveToCache(TlsContext *context);
 error_t tlsRemoveFromCache(TlsContext *context);
+
+void tlsUnlinkCacheEntry(TlsCache *cache, TlsCacheShard *shard, uint_t index);
+
+error_t tlsSerializeSessionState(const TlsSessionState *session, uint8_t *p,
+   size_t *written);
+
+error_t tlsDeserializeSessionState(TlsSessionState *session, const uint8_t *p,
+   size_t length);
+
+error_t tlsFindExtCache(TlsContext *context, const uint8_t *sessionId,
+   size_t sessionIdLen, TlsSessionState *session);
+
+error_t tlsSaveToExtCache(TlsContext *context);
+error_t tlsRemoveFromExtCache(TlsContext *context);
+
 void tlsFreeCache(TlsCache *cache);
 
 //C++ guard
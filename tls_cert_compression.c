@@ -0,0 +1,437 @@
+/**
+ * @file tls_cert_compression.c
+ * @brief Certificate compression (RFC 8879)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_common.h"
+#include "tls_cert_compression.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Retrieve the codec that implements a given compression algorithm
+ * @param[in] context Pointer to the TLS context
+ * @param[in] algorithm Compression algorithm
+ * @return Pointer to the matching codec, if any
+ **/
+
+const TlsCertCompressionCodec *tlsGetCertCompressionCodec(TlsContext *context,
+   uint16_t algorithm)
+{
+   uint_t i;
+   const TlsCertCompressionCodec *codec;
+
+   //Initialize pointer
+   codec = NULL;
+
+   //Loop through the registered codecs
+   for(i = 0; i < context->numCertCompressionCodecs; i++)
+   {
+      //Matching algorithm?
+      if(context->certCompressionCodecs[i].algorithm == algorithm)
+      {
+         codec = &context->certCompressionCodecs[i];
+         break;
+      }
+   }
+
+   //Return a pointer to the codec
+   return codec;
+}
+
+
+/**
+ * @brief Format Certificate or CompressedCertificate message
+ *
+ * When the peer has advertised a compression algorithm that is supported
+ * by a registered codec, the Certificate message is replaced by a
+ * CompressedCertificate message, unless compression does not reduce its
+ * size. The outcome is cached per credential, so that the chain of the
+ * server is compressed once for all
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] p Buffer where to format the message
+ * @param[out] length Length of the resulting message, in bytes
+ * @param[out] type Type of the resulting message
+ * @return Error code
+ **/
+
+error_t tlsFormatCompressedCertificate(TlsContext *context, uint8_t *p,
+   size_t *length, TlsMessageType *type)
+{
+   error_t error;
+   size_t m;
+   size_t n;
+   uint8_t *buffer;
+   TlsCredential *credential;
+   TlsCompressedCert *entry;
+   TlsCompressedCertificate *message;
+   const TlsCertCompressionCodec *codec;
+
+   //Default message type
+   *type = TLS_TYPE_CERTIFICATE;
+
+   //Select the codec that implements the algorithm chosen for the peer
+   codec = tlsGetCertCompressionCodec(context, context->certCompressionAlgo);
+
+   //Certificate compression only applies to TLS 1.3
+   if(context->version != TLS_VERSION_1_3 || codec == NULL ||
+      codec->compressCallback == NULL)
+   {
+      //Format Certificate message
+      return tlsFormatCertificate(context, (TlsCertificate *) p, length);
+   }
+
+   //Initialize pointer
+   credential = NULL;
+
+   //The Certificate message of the server only depends on its certificate
+   //chain, hence its compressed form can be shared by all the handshakes
+   if(context->entity == TLS_CONNECTION_END_SERVER &&
+      context->cert != NULL && context->cert->credential != NULL)
+   {
+#if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+      //X.509 certificate chain?
+      if(context->certFormat == TLS_CERT_FORMAT_X509)
+#endif
+      {
+         credential = context->cert->credential;
+      }
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+      //A stapled OCSP response makes the message specific to the handshake
+      if(context->ocspResponse != NULL)
+         credential = NULL;
+#endif
+   }
+
+   //Search the cache for a previous outcome
+   entry = tlsFindCompressedCert(credential, codec->algorithm);
+
+   //Cache hit?
+   if(entry != NULL)
+   {
+      //Compression is worthwhile for this certificate chain?
+      if(entry->length > 0 && entry->length <= context->txBufferMaxLen)
+      {
+         //Copy the CompressedCertificate message
+         memcpy(p, entry->message, entry->length);
+
+         //Length of the message
+         *length = entry->length;
+         //The message is a CompressedCertificate message
+         *type = TLS_TYPE_COMPRESSED_CERTIFICATE;
+
+         //Successful processing
+         return NO_ERROR;
+      }
+      else
+      {
+         //Format Certificate message
+         return tlsFormatCertificate(context, (TlsCertificate *) p, length);
+      }
+   }
+
+   //Format Certificate message
+   error = tlsFormatCertificate(context, (TlsCertificate *) p, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //The uncompressed message is sent if compression cannot be performed
+   *length = n;
+
+   //The compressed form is only worthwhile if it is shorter
+   buffer = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(buffer == NULL)
+      return NO_ERROR;
+
+   //Compress the Certificate message
+   error = codec->compressCallback(context, p, n, buffer, n, &m,
+      codec->param);
+
+   //Check status code
+   if(!error && m > 0 && (sizeof(TlsCompressedCertificate) + m) < n)
+   {
+      //Point to the CompressedCertificate message
+      message = (TlsCompressedCertificate *) p;
+
+      //The algorithm field indicates the compression algorithm
+      message->algorithm = htons(codec->algorithm);
+      //Length of the Certificate message once it is decompressed
+      STORE24BE(n, message->uncompressedLength);
+      //The compressed certificate message is preceded by a 3-byte length
+      STORE24BE(m, message->length);
+
+      //Copy the compressed Certificate message
+      memcpy(message->value, buffer, m);
+
+      //Length of the CompressedCertificate message
+      *length = sizeof(TlsCompressedCertificate) + m;
+      //The message is a CompressedCertificate message
+      *type = TLS_TYPE_COMPRESSED_CERTIFICATE;
+
+      //Save the CompressedCertificate message
+      tlsSaveCompressedCert(credential, codec->algorithm, p, *length);
+   }
+   else if(!error || error == ERROR_BUFFER_OVERFLOW)
+   {
+      //Compression does not reduce the size of this certificate chain
+      tlsSaveCompressedCert(credential, codec->algorithm, NULL, 0);
+   }
+
+   //Release previously allocated memory
+   tlsFreeMem(buffer);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse CompressedCertificate message
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming CompressedCertificate message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tlsParseCompressedCertificate(TlsContext *context,
+   const TlsCompressedCertificate *message, size_t length)
+{
+   error_t error;
+   size_t k;
+   size_t m;
+   size_t n;
+   uint8_t *buffer;
+   const TlsCertCompressionCodec *codec;
+
+   //Debug message
+   TRACE_INFO("CompressedCertificate message received (%" PRIuSIZE " bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //The CompressedCertificate message is only defined for TLS 1.3
+   if(context->version != TLS_VERSION_1_3)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Malformed CompressedCertificate message?
+   if(length < sizeof(TlsCompressedCertificate))
+      return ERROR_DECODING_FAILED;
+
+   //Get the length of the compressed data
+   m = LOAD24BE(message->length);
+   //Get the length of the Certificate message once decompressed
+   n = LOAD24BE(message->uncompressedLength);
+
+   //Malformed CompressedCertificate message?
+   if(length != (sizeof(TlsCompressedCertificate) + m) || m == 0)
+      return ERROR_DECODING_FAILED;
+
+   //The algorithm must be one of the algorithms offered to the peer
+   codec = tlsGetCertCompressionCodec(context, ntohs(message->algorithm));
+
+   //If the received CompressedCertificate message cannot be decompressed,
+   //the connection must be terminated with a bad_certificate alert (refer
+   //to RFC 8879, section 4)
+   if(codec == NULL || codec->decompressCallback == NULL)
+      return ERROR_BAD_CERTIFICATE;
+
+   //The decompressed message cannot exceed the size the peer could have
+   //sent without compression
+   if(n == 0 || n > context->rxBufferMaxLen)
+      return ERROR_BAD_CERTIFICATE;
+
+   //Allocate a buffer to hold the Certificate message
+   buffer = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(buffer == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Decompress the Certificate message
+   error = codec->decompressCallback(context, message->value, m, buffer, n,
+      &k, codec->param);
+
+   //The length of the decompressed data must match the uncompressed_length
+   //field
+   if(error || k != n)
+   {
+      //Report an error
+      error = ERROR_BAD_CERTIFICATE;
+   }
+   else
+   {
+      //Parse the Certificate message
+      error = tlsParseCertificate(context, (TlsCertificate *) buffer, n);
+   }
+
+   //Release previously allocated memory
+   tlsFreeMem(buffer);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Search a credential for a cached CompressedCertificate message
+ * @param[in] credential Pointer to the credential
+ * @param[in] algorithm Compression algorithm
+ * @return Pointer to the cached entry, if any
+ **/
+
+TlsCompressedCert *tlsFindCompressedCert(TlsCredential *credential,
+   uint16_t algorithm)
+{
+   TlsCompressedCert *entry;
+
+   //Initialize pointer
+   entry = NULL;
+
+   //Valid credential?
+   if(credential != NULL)
+   {
+      //Acquire exclusive access to the credential
+      osAcquireMutex(&credential->mutex);
+
+      //Loop through the cached entries
+      for(entry = credential->compressedCerts; entry != NULL;
+         entry = entry->next)
+      {
+         //Matching algorithm?
+         if(entry->algorithm == algorithm)
+            break;
+      }
+
+      //Release exclusive access to the credential
+      osReleaseMutex(&credential->mutex);
+   }
+
+   //Entries are only released with the credential itself
+   return entry;
+}
+
+
+/**
+ * @brief Cache a CompressedCertificate message in a credential
+ * @param[in] credential Pointer to the credential
+ * @param[in] algorithm Compression algorithm
+ * @param[in] message Pointer to the CompressedCertificate message (NULL if
+ *   compression is not worthwhile)
+ * @param[in] length Length of the CompressedCertificate message
+ **/
+
+void tlsSaveCompressedCert(TlsCredential *credential, uint16_t algorithm,
+   const uint8_t *message, size_t length)
+{
+   TlsCompressedCert *entry;
+   TlsCompressedCert *newEntry;
+
+   //Valid credential?
+   if(credential != NULL)
+   {
+      //Allocate a new entry
+      newEntry = tlsAllocMem(sizeof(TlsCompressedCert) + length);
+
+      //Successful memory allocation?
+      if(newEntry != NULL)
+      {
+         //Save the CompressedCertificate message
+         newEntry->algorithm = (TlsCertCompressionAlgo) algorithm;
+         newEntry->length = length;
+
+         //Copy the message, if any
+         if(length > 0)
+            memcpy(newEntry->message, message, length);
+
+         //Acquire exclusive access to the credential
+         osAcquireMutex(&credential->mutex);
+
+         //Another handshake may have filled the cache in the meantime
+         for(entry = credential->compressedCerts; entry != NULL;
+            entry = entry->next)
+         {
+            //Matching algorithm?
+            if(entry->algorithm == algorithm)
+               break;
+         }
+
+         //No matching entry?
+         if(entry == NULL)
+         {
+            //Insert the new entry at the head of the list
+            newEntry->next = credential->compressedCerts;
+            credential->compressedCerts = newEntry;
+            newEntry = NULL;
+         }
+
+         //Release exclusive access to the credential
+         osReleaseMutex(&credential->mutex);
+
+         //Release the entry if it has not been inserted
+         if(newEntry != NULL)
+            tlsFreeMem(newEntry);
+      }
+   }
+}
+
+
+/**
+ * @brief Release the CompressedCertificate messages cached in a credential
+ * @param[in] credential Pointer to the credential
+ **/
+
+void tlsFreeCompressedCerts(TlsCredential *credential)
+{
+   TlsCompressedCert *entry;
+   TlsCompressedCert *next;
+
+   //Loop through the cached entries
+   for(entry = credential->compressedCerts; entry != NULL; entry = next)
+   {
+      //Save the pointer to the next entry
+      next = entry->next;
+      //Release current entry
+      tlsFreeMem(entry);
+   }
+
+   //The cache is now empty
+   credential->compressedCerts = NULL;
+}
+
+#endif
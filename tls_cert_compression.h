@@ -0,0 +1,65 @@
+/**
+ * @file tls_cert_compression.h
+ * @brief Certificate compression (RFC 8879)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_CERT_COMPRESSION_H
+#define _TLS_CERT_COMPRESSION_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Certificate compression related functions
+const TlsCertCompressionCodec *tlsGetCertCompressionCodec(TlsContext *context,
+   uint16_t algorithm);
+
+error_t tlsFormatCompressedCertificate(TlsContext *context, uint8_t *p,
+   size_t *length, TlsMessageType *type);
+
+error_t tlsParseCompressedCertificate(TlsContext *context,
+   const TlsCompressedCertificate *message, size_t length);
+
+TlsCompressedCert *tlsFindCompressedCert(TlsCredential *credential,
+   uint16_t algorithm);
+
+void tlsSaveCompressedCert(TlsCredential *credential, uint16_t algorithm,
+   const uint8_t *message, size_t length);
+
+void tlsFreeCompressedCerts(TlsCredential *credential);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
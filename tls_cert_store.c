@@ -0,0 +1,731 @@
+/**
+ * @file tls_cert_store.c
+ * @brief SNI-indexed certificate store
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include <ctype.h>
+#include "tls.h"
+#include "tls_cert_store.h"
+#include "tls_credential.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CERT_STORE_SUPPORT == ENABLED && \
+   TLS_SNI_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create an SNI-indexed certificate store
+ *
+ * The store maps host names to the credentials a server presents for them.
+ * Names are either exact host names or wildcard names of the form
+ * "*.example.com". Each name may be associated with several credentials
+ * (typically one RSA and one ECDSA certificate). Entries are either added
+ * explicitly with tlsAddCertStoreEntry() or loaded on demand through the
+ * load callback the first time a client asks for a given name. Entries
+ * loaded on demand are evicted once they have not been used for the
+ * specified amount of time, or when their slot is needed for another name
+ *
+ * The store is organized as a set-associative table, so that the cost of a
+ * lookup does not depend on the number of names. It can be shared by any
+ * number of TLS contexts and shared configurations
+ *
+ * @param[in] size Maximum number of entries
+ * @param[in] idleTimeout Time after which an unused entry is evicted, in
+ *   milliseconds (0 if entries loaded on demand never expire)
+ * @param[in] loadCallback Callback that loads the credentials for a given
+ *   name (optional parameter)
+ * @param[in] param An opaque pointer passed to the load callback
+ * @return Handle referencing the fully initialized certificate store
+ **/
+
+TlsCertStore *tlsInitCertStore(uint_t size, systime_t idleTimeout,
+   TlsCertStoreLoadCallback loadCallback, void *param)
+{
+   size_t n;
+   uint_t numSets;
+   TlsCertStore *store;
+
+   //Make sure the parameter is acceptable
+   if(size < 1)
+      return NULL;
+
+   //Number of sets
+   numSets = (size + TLS_CERT_STORE_WAYS - 1) / TLS_CERT_STORE_WAYS;
+
+   //Size of the memory required
+   n = sizeof(TlsCertStore) + numSets * TLS_CERT_STORE_WAYS *
+      sizeof(TlsCertStoreEntry);
+
+   //Allocate a memory buffer to hold the certificate store
+   store = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(store == NULL)
+      return NULL;
+
+   //Clear memory
+   memset(store, 0, n);
+
+   //Create a mutex to prevent simultaneous access to the store
+   if(!osCreateMutex(&store->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(store);
+      //Report an error
+      return NULL;
+   }
+
+   //Save parameters
+   store->numSets = numSets;
+   store->idleTimeout = idleTimeout;
+   store->loadCallback = loadCallback;
+   store->loadParam = param;
+
+   //Return a pointer to the newly created certificate store
+   return store;
+}
+
+
+/**
+ * @brief Add credentials to the certificate store
+ *
+ * Entries added by this function replace any existing entry for the same
+ * name and are never evicted. They remain in the store until they are
+ * explicitly removed with tlsRemoveCertStoreEntry()
+ *
+ * @param[in] store Pointer to the certificate store
+ * @param[in] name Host name or wildcard name (such as "*.example.com")
+ * @param[in] credentials Credentials associated with the name
+ * @param[in] numCredentials Number of credentials
+ * @return Error code
+ **/
+
+error_t tlsAddCertStoreEntry(TlsCertStore *store, const char_t *name,
+   TlsCredential *const *credentials, uint_t numCredentials)
+{
+   error_t error;
+   uint_t i;
+   uint32_t hash;
+   TlsCertStoreEntry *entry;
+   char_t buffer[TLS_MAX_SERVER_NAME_LEN + 1];
+
+   //Check parameters
+   if(store == NULL || name == NULL || credentials == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the number of credentials
+   if(numCredentials < 1 || numCredentials > TLS_CERT_STORE_MAX_CREDENTIALS)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure the credentials are valid
+   for(i = 0; i < numCredentials; i++)
+   {
+      if(credentials[i] == NULL)
+         return ERROR_INVALID_PARAMETER;
+   }
+
+   //Host names are case-insensitive
+   error = tlsNormalizeCertStoreName(name, buffer);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Compute the hash of the name
+   hash = tlsComputeCertStoreHash(buffer);
+
+   //Acquire exclusive access to the certificate store
+   osAcquireMutex(&store->mutex);
+
+   //Search the store for an existing entry
+   entry = tlsFindCertStoreEntry(store, hash, buffer);
+
+   //Replace the existing entry, if any
+   if(entry != NULL)
+      tlsFreeCertStoreEntry(entry);
+   else
+      entry = tlsAllocCertStoreEntry(store, hash);
+
+   //Any entry available?
+   if(entry != NULL)
+   {
+      //Save the name
+      entry->valid = TRUE;
+      entry->pinned = TRUE;
+      entry->hash = hash;
+      entry->timestamp = osGetSystemTime();
+      strcpy(entry->name, buffer);
+
+      //Save the credentials
+      for(i = 0; i < numCredentials; i++)
+      {
+         entry->credentials[i] = tlsReferenceCredential(credentials[i]);
+      }
+
+      //Save the number of credentials
+      entry->numCredentials = numCredentials;
+
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //All the entries of the set are pinned
+      error = ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Release exclusive access to the certificate store
+   osReleaseMutex(&store->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Remove an entry from the certificate store
+ *
+ * Contexts that have already selected the credentials of the entry keep
+ * on using them until the end of the handshake
+ *
+ * @param[in] store Pointer to the certificate store
+ * @param[in] name Host name or wildcard name
+ * @return Error code
+ **/
+
+error_t tlsRemoveCertStoreEntry(TlsCertStore *store, const char_t *name)
+{
+   error_t error;
+   uint32_t hash;
+   TlsCertStoreEntry *entry;
+   char_t buffer[TLS_MAX_SERVER_NAME_LEN + 1];
+
+   //Check parameters
+   if(store == NULL || name == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Host names are case-insensitive
+   error = tlsNormalizeCertStoreName(name, buffer);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Compute the hash of the name
+   hash = tlsComputeCertStoreHash(buffer);
+
+   //Acquire exclusive access to the certificate store
+   osAcquireMutex(&store->mutex);
+
+   //Search the store for the specified name
+   entry = tlsFindCertStoreEntry(store, hash, buffer);
+
+   //Matching entry found?
+   if(entry != NULL)
+   {
+      //Release the credentials
+      tlsFreeCertStoreEntry(entry);
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //The name is not in the store
+      error = ERROR_NOT_FOUND;
+   }
+
+   //Release exclusive access to the certificate store
+   osReleaseMutex(&store->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Convert a name to the form used as a key in the store
+ * @param[in] name Host name or wildcard name
+ * @param[out] buffer Output buffer (TLS_MAX_SERVER_NAME_LEN + 1 bytes)
+ * @return Error code
+ **/
+
+error_t tlsNormalizeCertStoreName(const char_t *name, char_t *buffer)
+{
+   size_t i;
+   size_t n;
+
+   //Retrieve the length of the name
+   n = strlen(name);
+
+   //A fully qualified name may end with a dot
+   if(n > 0 && name[n - 1] == '.')
+      n--;
+
+   //Check the length of the name
+   if(n < 1 || n > TLS_MAX_SERVER_NAME_LEN)
+      return ERROR_INVALID_LENGTH;
+
+   //Convert the name to lower case
+   for(i = 0; i < n; i++)
+   {
+      buffer[i] = tolower((uint8_t) name[i]);
+   }
+
+   //Properly terminate the string with a NULL character
+   buffer[n] = '\0';
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the hash of a name
+ * @param[in] name Normalized host name or wildcard name
+ * @return Hash value (FNV-1a)
+ **/
+
+uint32_t tlsComputeCertStoreHash(const char_t *name)
+{
+   uint32_t h;
+
+   //Offset basis
+   h = 2166136261U;
+
+   //Digest the name
+   while(*name != '\0')
+   {
+      h = (h ^ (uint8_t) *(name++)) * 16777619U;
+   }
+
+   //Return the resulting hash value
+   return h;
+}
+
+
+/**
+ * @brief Search the certificate store for a given name
+ *
+ * The caller must hold the mutex of the store
+ *
+ * @param[in] store Pointer to the certificate store
+ * @param[in] hash Hash of the name
+ * @param[in] name Normalized host name or wildcard name
+ * @return Pointer to the matching entry, if any
+ **/
+
+TlsCertStoreEntry *tlsFindCertStoreEntry(TlsCertStore *store, uint32_t hash,
+   const char_t *name)
+{
+   uint_t i;
+   TlsCertStoreEntry *entry;
+
+   //Point to the first entry of the set
+   entry = &store->entries[(hash % store->numSets) * TLS_CERT_STORE_WAYS];
+
+   //Loop through the entries of the set
+   for(i = 0; i < TLS_CERT_STORE_WAYS; i++, entry++)
+   {
+      //Compare hash values first
+      if(entry->valid && entry->hash == hash && !strcmp(entry->name, name))
+         return entry;
+   }
+
+   //No matching entry
+   return NULL;
+}
+
+
+/**
+ * @brief Get a free entry in the set a name maps to
+ *
+ * The least recently used entry of the set is evicted if necessary. Pinned
+ * entries are never evicted. The caller must hold the mutex of the store
+ *
+ * @param[in] store Pointer to the certificate store
+ * @param[in] hash Hash of the name
+ * @return Pointer to the free entry (NULL if all the entries are pinned)
+ **/
+
+TlsCertStoreEntry *tlsAllocCertStoreEntry(TlsCertStore *store, uint32_t hash)
+{
+   uint_t i;
+   TlsCertStoreEntry *entry;
+   TlsCertStoreEntry *victim;
+
+   //Initialize pointer
+   victim = NULL;
+
+   //Point to the first entry of the set
+   entry = &store->entries[(hash % store->numSets) * TLS_CERT_STORE_WAYS];
+
+   //Loop through the entries of the set
+   for(i = 0; i < TLS_CERT_STORE_WAYS; i++, entry++)
+   {
+      //Free entry?
+      if(!entry->valid)
+         return entry;
+
+      //Keep track of the least recently used entry
+      if(!entry->pinned)
+      {
+         if(victim == NULL ||
+            timeCompare(entry->timestamp, victim->timestamp) < 0)
+         {
+            victim = entry;
+         }
+      }
+   }
+
+   //Evict the least recently used entry
+   if(victim != NULL)
+      tlsFreeCertStoreEntry(victim);
+
+   //Return a pointer to the entry
+   return victim;
+}
+
+
+/**
+ * @brief Get the credentials associated with a name
+ *
+ * The load callback is invoked when the name is not in the store yet. It
+ * runs outside the critical section, so that a slow credential source does
+ * not stall the handshakes served from the store. Names for which the
+ * callback reports ERROR_NOT_FOUND are remembered as well, so that unknown
+ * names do not trigger a load on every handshake
+ *
+ * @param[in] store Pointer to the certificate store
+ * @param[in] name Normalized host name or wildcard name
+ * @param[out] credentials Array receiving one reference per credential
+ * @param[out] numCredentials Number of credentials
+ * @return Error code
+ **/
+
+error_t tlsGetCertStoreCredentials(TlsCertStore *store, const char_t *name,
+   TlsCredential **credentials, uint_t *numCredentials)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint32_t hash;
+   systime_t time;
+   TlsCertStoreEntry *entry;
+
+   //Initialize the number of credentials
+   n = 0;
+
+   //Compute the hash of the name
+   hash = tlsComputeCertStoreHash(name);
+   //Get current time
+   time = osGetSystemTime();
+
+   //Acquire exclusive access to the certificate store
+   osAcquireMutex(&store->mutex);
+
+   //Search the store for the specified name
+   entry = tlsFindCertStoreEntry(store, hash, name);
+
+   //Entries loaded on demand are evicted once unused for too long
+   if(entry != NULL && !entry->pinned && store->idleTimeout != 0)
+   {
+      if(timeCompare(time, entry->timestamp + store->idleTimeout) >= 0)
+      {
+         tlsFreeCertStoreEntry(entry);
+         entry = NULL;
+      }
+   }
+
+   //Matching entry found?
+   if(entry != NULL)
+   {
+      //Reference the credentials
+      for(i = 0; i < entry->numCredentials; i++)
+      {
+         credentials[i] = tlsReferenceCredential(entry->credentials[i]);
+      }
+
+      //Save the number of credentials
+      n = entry->numCredentials;
+      //Update the time at which the entry was last used
+      entry->timestamp = time;
+   }
+
+   //Release exclusive access to the certificate store
+   osReleaseMutex(&store->mutex);
+
+   //Matching entry found?
+   if(entry != NULL)
+   {
+      //Return the number of credentials
+      *numCredentials = n;
+      //An entry without credentials remembers that the name is unknown
+      return (n > 0) ? NO_ERROR : ERROR_NOT_FOUND;
+   }
+
+   //No load callback registered?
+   if(store->loadCallback == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Invoke the load callback
+   error = store->loadCallback(name, credentials, &n, store->loadParam);
+
+   //Unknown name?
+   if(error == ERROR_NOT_FOUND)
+   {
+      //The entry will remember that the name is unknown
+      n = 0;
+   }
+   else if(error)
+   {
+      //Failures other than unknown names are not remembered
+      return error;
+   }
+   else if(n > TLS_CERT_STORE_MAX_CREDENTIALS)
+   {
+      //The callback does not behave properly
+      return ERROR_INVALID_LENGTH;
+   }
+   else
+   {
+      //Successful processing
+   }
+
+   //Acquire exclusive access to the certificate store
+   osAcquireMutex(&store->mutex);
+
+   //Another handshake may have loaded the same name in the meantime
+   if(tlsFindCertStoreEntry(store, hash, name) == NULL)
+   {
+      //Get a free entry
+      entry = tlsAllocCertStoreEntry(store, hash);
+
+      //Any entry available?
+      if(entry != NULL)
+      {
+         //Save the name
+         entry->valid = TRUE;
+         entry->pinned = FALSE;
+         entry->hash = hash;
+         entry->timestamp = time;
+         strcpy(entry->name, name);
+
+         //The store keeps its own reference to the credentials
+         for(i = 0; i < n; i++)
+         {
+            entry->credentials[i] = tlsReferenceCredential(credentials[i]);
+         }
+
+         //Save the number of credentials
+         entry->numCredentials = n;
+      }
+   }
+
+   //Release exclusive access to the certificate store
+   osReleaseMutex(&store->mutex);
+
+   //The references returned by the callback are handed over to the caller
+   *numCredentials = n;
+
+   //Return status code
+   return (n > 0) ? NO_ERROR : ERROR_NOT_FOUND;
+}
+
+
+/**
+ * @brief Select the credentials matching the ServerName extension
+ *
+ * The exact host name is looked up first. The wildcard name covering it is
+ * tried next. When neither is known, the certificates attached to the
+ * context are used as usual
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsSelectCertStoreCredentials(TlsContext *context)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   char_t *p;
+   TlsCertDesc *cert;
+   TlsCredential *credentials[TLS_CERT_STORE_MAX_CREDENTIALS];
+   char_t name[TLS_MAX_SERVER_NAME_LEN + 1];
+
+   //Release the credentials previously selected from the store
+   tlsReleaseCertStoreCredentials(context);
+
+   //The store is only consulted when the client has provided a server name
+   if(context->certStore == NULL || context->serverName == NULL)
+      return NO_ERROR;
+
+   //Host names are case-insensitive
+   error = tlsNormalizeCertStoreName(context->serverName, name);
+   //Any error to report?
+   if(error)
+      return NO_ERROR;
+
+   //Look up the exact host name
+   error = tlsGetCertStoreCredentials(context->certStore, name, credentials,
+      &n);
+
+   //Unknown host name?
+   if(error == ERROR_NOT_FOUND)
+   {
+      //A wildcard only matches the left-most label of the host name
+      p = strchr(name, '.');
+
+      //The wildcard name must contain at least two labels
+      if(p != NULL && p != name && strchr(p + 1, '.') != NULL)
+      {
+         //Substitute the left-most label with a wildcard
+         name[0] = '*';
+         memmove(name + 1, p, strlen(p) + 1);
+
+         //Look up the wildcard name
+         error = tlsGetCertStoreCredentials(context->certStore, name,
+            credentials, &n);
+      }
+   }
+
+   //Unknown name?
+   if(error == ERROR_NOT_FOUND)
+      return NO_ERROR;
+
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Loop through the credentials
+   for(i = 0; i < n; i++)
+   {
+      //Point to the structure that describes the certificate
+      cert = &context->storeCerts[i];
+
+      //The certificate chain and the private key have already been parsed
+      cert->certChain = NULL;
+      cert->certChainLen = 0;
+      cert->privateKey = NULL;
+      cert->privateKeyLen = 0;
+      cert->credential = credentials[i];
+      cert->type = credentials[i]->type;
+      cert->signAlgo = credentials[i]->signAlgo;
+      cert->hashAlgo = credentials[i]->hashAlgo;
+      cert->namedCurve = credentials[i]->namedCurve;
+   }
+
+   //Save the number of certificates
+   context->numStoreCerts = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release the credentials selected from the certificate store
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsReleaseCertStoreCredentials(TlsContext *context)
+{
+   uint_t i;
+
+   //Loop through the credentials
+   for(i = 0; i < context->numStoreCerts; i++)
+   {
+      //The currently selected certificate is no longer available
+      if(context->cert == &context->storeCerts[i])
+         context->cert = NULL;
+
+      //Release the reference to the credential
+      tlsFreeCredential(context->storeCerts[i].credential);
+      context->storeCerts[i].credential = NULL;
+   }
+
+   //No credentials selected
+   context->numStoreCerts = 0;
+}
+
+
+/**
+ * @brief Release a certificate store entry
+ * @param[in] entry Pointer to the entry
+ **/
+
+void tlsFreeCertStoreEntry(TlsCertStoreEntry *entry)
+{
+   uint_t i;
+
+   //Release the credentials
+   for(i = 0; i < entry->numCredentials; i++)
+   {
+      tlsFreeCredential(entry->credentials[i]);
+   }
+
+   //Mark the entry as free
+   memset(entry, 0, sizeof(TlsCertStoreEntry));
+}
+
+
+/**
+ * @brief Release certificate store
+ * @param[in] store Pointer to the certificate store
+ **/
+
+void tlsFreeCertStore(TlsCertStore *store)
+{
+   uint_t i;
+
+   //Valid certificate store?
+   if(store != NULL)
+   {
+      //Loop through the entries
+      for(i = 0; i < store->numSets * TLS_CERT_STORE_WAYS; i++)
+      {
+         //Release the credentials
+         tlsFreeCertStoreEntry(&store->entries[i]);
+      }
+
+      //Release previously allocated resources
+      osDeleteMutex(&store->mutex);
+
+      //Clear certificate store
+      memset(store, 0, sizeof(TlsCertStore));
+      //Release memory
+      tlsFreeMem(store);
+   }
+}
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file tls_cert_store.h
+ * @brief SNI-indexed certificate store
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_CERT_STORE_H
+#define _TLS_CERT_STORE_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//SNI-indexed certificate store
+error_t tlsNormalizeCertStoreName(const char_t *name, char_t *buffer);
+uint32_t tlsComputeCertStoreHash(const char_t *name);
+
+TlsCertStoreEntry *tlsFindCertStoreEntry(TlsCertStore *store, uint32_t hash,
+   const char_t *name);
+
+TlsCertStoreEntry *tlsAllocCertStoreEntry(TlsCertStore *store, uint32_t hash);
+
+error_t tlsGetCertStoreCredentials(TlsCertStore *store, const char_t *name,
+   TlsCredential **credentials, uint_t *numCredentials);
+
+error_t tlsSelectCertStoreCredentials(TlsContext *context);
+void tlsReleaseCertStoreCredentials(TlsContext *context);
+
+void tlsFreeCertStoreEntry(TlsCertStoreEntry *entry);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,569 @@
+/**
+ * @file tls_cert_stream.c
+ * @brief Incremental parsing of Certificate messages
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_cert_stream.h"
+#include "tls_certificate.h"
+#include "tls_common.h"
+#include "tls_misc.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CERT_STREAM_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Check whether a handshake message can be parsed incrementally
+ *
+ * Certificate messages are parsed as the records arrive, so that the RX
+ * buffer does not need to hold the whole certificate chain. Each
+ * certificate is parsed and validated as soon as it has been received,
+ * and only the DER encoding of the last certificate of the path is kept
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] msgType Handshake message type
+ * @return TRUE if the message can be parsed incrementally, else FALSE
+ **/
+
+bool_t tlsIsCertStreamAllowed(TlsContext *context, uint8_t msgType)
+{
+   //Only Certificate messages are parsed incrementally
+   if(msgType != TLS_TYPE_CERTIFICATE)
+      return FALSE;
+
+   //DTLS handshake messages are reassembled from fragments
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+      return FALSE;
+
+#if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+   //Raw public keys are parsed as a whole
+   if(context->peerCertFormat == TLS_CERT_FORMAT_RAW_PUBLIC_KEY)
+      return FALSE;
+#endif
+
+   //Unexpected messages are reassembled and rejected by the regular parser
+   if(tlsCheckCertificateState(context))
+      return FALSE;
+
+   //The message can be parsed incrementally
+   return TRUE;
+}
+
+
+/**
+ * @brief Prepare the incremental parsing of a Certificate message
+ * @param[in] context Pointer to the TLS context
+ * @param[in] length Length of the message body
+ * @return Error code
+ **/
+
+error_t tlsStartCertStream(TlsContext *context, size_t length)
+{
+   error_t error;
+   TlsCertStream *stream;
+
+   //Check current state
+   error = tlsCheckCertificateState(context);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Discard the state of any previous message
+   tlsFreeCertStream(context);
+
+   //Point to the incremental parser
+   stream = &context->certStream;
+
+   //Allocate a memory buffer to store X.509 certificate info
+   stream->certInfo = tlsAllocHandshakeObject(context,
+      TLS_MEM_CLASS_CERT_INFO, sizeof(X509CertificateInfo));
+   //Failed to allocate memory?
+   if(stream->certInfo == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Allocate a memory buffer to store the parent certificate
+   stream->issuerCertInfo = tlsAllocHandshakeObject(context,
+      TLS_MEM_CLASS_CERT_INFO, sizeof(X509CertificateInfo));
+   //Failed to allocate memory?
+   if(stream->issuerCertInfo == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Number of bytes of the message body left to parse
+   stream->remaining = length;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //TLS 1.3 currently selected?
+   if(context->version == TLS_VERSION_1_3)
+   {
+      //The message begins with the certificate request context
+      stream->state = TLS_CERT_STREAM_STATE_CONTEXT_LEN;
+      stream->fieldLen = sizeof(Tls13CertRequestContext);
+   }
+   else
+#endif
+   {
+      //The message begins with the certificate list
+      stream->state = TLS_CERT_STREAM_STATE_LIST_LEN;
+      stream->fieldLen = sizeof(TlsCertificateList);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse a fragment of a Certificate message
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to the fragment
+ * @param[in] length Length of the fragment
+ * @return Error code
+ **/
+
+error_t tlsParseCertStream(TlsContext *context, const uint8_t *data,
+   size_t length)
+{
+   error_t error;
+   size_t n;
+   TlsCertStream *stream;
+
+   //Point to the incremental parser
+   stream = &context->certStream;
+
+   //Malformed Certificate message?
+   if(length > stream->remaining)
+      return ERROR_DECODING_FAILED;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Process the incoming data
+   while(length > 0 && !error)
+   {
+      //Number of bytes of the current field available in the fragment
+      n = MIN(length, stream->fieldLen - stream->fieldPos);
+
+      //Certificates and extensions are copied to a dedicated buffer, length
+      //fields to a small buffer, and the certificate request context is
+      //discarded
+      if(stream->state == TLS_CERT_STREAM_STATE_ENTRY ||
+         stream->state == TLS_CERT_STREAM_STATE_EXT)
+      {
+         memcpy(stream->field + stream->fieldPos, data, n);
+      }
+      else if(stream->state != TLS_CERT_STREAM_STATE_CONTEXT)
+      {
+         memcpy(stream->header + stream->fieldPos, data, n);
+      }
+
+      //Advance data pointer
+      data += n;
+      length -= n;
+
+      //Update the number of bytes received so far
+      stream->fieldPos += n;
+      stream->remaining -= n;
+
+      //Complete field received?
+      if(stream->fieldPos == stream->fieldLen)
+      {
+         //Process the field and move to the next one
+         error = tlsProcessCertStreamField(context);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process a complete field of a Certificate message
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsProcessCertStreamField(TlsContext *context)
+{
+   error_t error;
+   size_t n;
+   TlsCertStream *stream;
+
+   //Point to the incremental parser
+   stream = &context->certStream;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Check parsing state
+   switch(stream->state)
+   {
+   //Length of the certificate request context?
+   case TLS_CERT_STREAM_STATE_CONTEXT_LEN:
+      //Get the length of the certificate request context
+      n = stream->header[0];
+
+      //Malformed Certificate message?
+      if(n > stream->remaining)
+      {
+         error = ERROR_DECODING_FAILED;
+      }
+      else if(n > 0)
+      {
+         //Skip the certificate request context
+         stream->state = TLS_CERT_STREAM_STATE_CONTEXT;
+         stream->fieldLen = n;
+      }
+      else
+      {
+         //The certificate list follows
+         stream->state = TLS_CERT_STREAM_STATE_LIST_LEN;
+         stream->fieldLen = sizeof(TlsCertificateList);
+      }
+      break;
+
+   //Certificate request context?
+   case TLS_CERT_STREAM_STATE_CONTEXT:
+      //The certificate list follows
+      stream->state = TLS_CERT_STREAM_STATE_LIST_LEN;
+      stream->fieldLen = sizeof(TlsCertificateList);
+      break;
+
+   //Length of the certificate list?
+   case TLS_CERT_STREAM_STATE_LIST_LEN:
+      //The certificate list must extend to the end of the message
+      if(LOAD24BE(stream->header) != stream->remaining)
+      {
+         error = ERROR_DECODING_FAILED;
+      }
+      else
+      {
+         //Non-empty certificate list?
+         if(stream->remaining > 0)
+         {
+            //Certificate chain parsing and validation is about to start
+            TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_CERT_PARSING_START);
+         }
+
+         //Each certificate is preceded by a 3-byte length field
+         stream->state = TLS_CERT_STREAM_STATE_ENTRY_LEN;
+         stream->fieldLen = 3;
+      }
+      break;
+
+   //Length of a certificate?
+   case TLS_CERT_STREAM_STATE_ENTRY_LEN:
+      //Get the size occupied by the certificate
+      n = LOAD24BE(stream->header);
+
+      //Malformed Certificate message?
+      if(n == 0 || n > stream->remaining)
+      {
+         error = ERROR_DECODING_FAILED;
+      }
+      else if(n > TLS_CERT_STREAM_MAX_CERT_SIZE)
+      {
+         //The certificate is too large to be buffered
+         error = ERROR_BAD_CERTIFICATE;
+      }
+      else
+      {
+         //Allocate a memory buffer to hold the DER-encoded certificate
+         stream->field = tlsAllocHandshakeMem(context, n);
+
+         //Successful memory allocation?
+         if(stream->field != NULL)
+         {
+            //Receive the certificate
+            stream->state = TLS_CERT_STREAM_STATE_ENTRY;
+            stream->fieldLen = n;
+         }
+         else
+         {
+            //Report an error
+            error = ERROR_OUT_OF_MEMORY;
+         }
+      }
+      break;
+
+   //Certificate?
+   case TLS_CERT_STREAM_STATE_ENTRY:
+      //Parse and validate the certificate
+      error = tlsProcessCertStreamEntry(context);
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //TLS 1.3 currently selected?
+      if(context->version == TLS_VERSION_1_3)
+      {
+         //Each certificate is followed by a list of extensions
+         stream->state = TLS_CERT_STREAM_STATE_EXT_LEN;
+         stream->fieldLen = sizeof(uint16_t);
+      }
+      else
+#endif
+      {
+         //Next certificate
+         stream->state = TLS_CERT_STREAM_STATE_ENTRY_LEN;
+         stream->fieldLen = 3;
+      }
+      break;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Length of the list of extensions?
+   case TLS_CERT_STREAM_STATE_EXT_LEN:
+      //Get the length of the list of extensions
+      n = LOAD16BE(stream->header);
+
+      //Malformed Certificate message?
+      if(n > stream->remaining)
+      {
+         error = ERROR_DECODING_FAILED;
+      }
+      else if(n > 0)
+      {
+         //Allocate a memory buffer to hold the list of extensions
+         stream->field = tlsAllocHandshakeMem(context, sizeof(uint16_t) + n);
+
+         //Successful memory allocation?
+         if(stream->field != NULL)
+         {
+            //The list of extensions is parsed together with its length field
+            memcpy(stream->field, stream->header, sizeof(uint16_t));
+
+            //Receive the list of extensions
+            stream->state = TLS_CERT_STREAM_STATE_EXT;
+            stream->fieldLen = sizeof(uint16_t) + n;
+            stream->fieldPos = sizeof(uint16_t);
+            //The field position must not be reset
+            return NO_ERROR;
+         }
+         else
+         {
+            //Report an error
+            error = ERROR_OUT_OF_MEMORY;
+         }
+      }
+      else
+      {
+         //Parse the empty list of extensions
+         error = tls13ParseCertExtensions(context, stream->numCerts == 1,
+            stream->header, sizeof(uint16_t), &n);
+
+         //Next certificate
+         stream->state = TLS_CERT_STREAM_STATE_ENTRY_LEN;
+         stream->fieldLen = 3;
+      }
+      break;
+
+   //List of extensions?
+   case TLS_CERT_STREAM_STATE_EXT:
+      //Parse the list of extensions for the current CertificateEntry. The
+      //first entry of the list carries the end-entity certificate
+      error = tls13ParseCertExtensions(context, stream->numCerts == 1,
+         stream->field, stream->fieldLen, &n);
+
+      //Release the list of extensions
+      tlsFreeHandshakeMem(context, stream->field);
+      stream->field = NULL;
+
+      //Next certificate
+      stream->state = TLS_CERT_STREAM_STATE_ENTRY_LEN;
+      stream->fieldLen = 3;
+      break;
+#endif
+
+   //Invalid state?
+   default:
+      //Report an error
+      error = ERROR_WRONG_STATE;
+      break;
+   }
+
+   //Start receiving the next field
+   stream->fieldPos = 0;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Parse and validate a certificate of the chain
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsProcessCertStreamEntry(TlsContext *context)
+{
+   error_t error;
+   TlsCertStream *stream;
+
+   //Point to the incremental parser
+   stream = &context->certStream;
+
+   //End-user certificate?
+   if(stream->numCerts == 0)
+   {
+      //Parse and check the end-user certificate
+      error = tlsParseEndEntityCertificate(context, stream->field,
+         stream->fieldLen, stream->certInfo, &stream->certValidResult);
+   }
+   else
+   {
+      //Parse the intermediate certificate and validate the current one
+      error = tlsParseIssuerCertificate(context, stream->field,
+         stream->fieldLen, stream->numCerts - 1, stream->certInfo,
+         stream->issuerCertInfo, &stream->certValidResult);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //The previous certificate is no longer referenced by certInfo
+      if(stream->prevCert != NULL)
+         tlsFreeHandshakeMem(context, stream->prevCert);
+
+      //Keep the DER encoding of the last certificate of the path
+      stream->prevCert = stream->field;
+      stream->field = NULL;
+
+      //Update the number of certificates parsed so far
+      stream->numCerts++;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Complete the incremental parsing of a Certificate message
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsCompleteCertStream(TlsContext *context)
+{
+   error_t error;
+   TlsCertStream *stream;
+
+   //Point to the incremental parser
+   stream = &context->certStream;
+
+   //The message must end on a certificate boundary
+   if(stream->state != TLS_CERT_STREAM_STATE_ENTRY_LEN ||
+      stream->fieldPos != 0 || stream->remaining != 0)
+   {
+      error = ERROR_DECODING_FAILED;
+   }
+   else if(stream->numCerts == 0)
+   {
+      //The peer did not send any certificates
+      error = tlsParseEmptyCertificateList(context);
+   }
+   else
+   {
+      //Certificate chain parsing and validation is complete
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_CERT_PARSING_END);
+
+      //Certificate chain validation failed?
+      if(stream->certValidResult != NO_ERROR)
+      {
+         //A valid certificate chain or partial chain was received, but the
+         //certificate was not accepted because the CA certificate could not
+         //be matched with a known, trusted CA
+         error = ERROR_UNKNOWN_CA;
+      }
+      else
+      {
+         //The certificate chain is valid
+         error = NO_ERROR;
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Update the state of the handshake
+      tlsCompleteCertificate(context);
+   }
+
+   //Release the state of the parser
+   tlsFreeCertStream(context);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release the state of the incremental Certificate message parser
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsFreeCertStream(TlsContext *context)
+{
+   TlsCertStream *stream;
+
+   //Point to the incremental parser
+   stream = &context->certStream;
+
+   //Release the certificate or the extensions being received
+   if(stream->field != NULL)
+      tlsFreeHandshakeMem(context, stream->field);
+
+   //Release the DER encoding of the last certificate of the path
+   if(stream->prevCert != NULL)
+      tlsFreeHandshakeMem(context, stream->prevCert);
+
+   //Release X.509 certificates (in reverse order of allocation)
+   if(stream->issuerCertInfo != NULL)
+   {
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO,
+         stream->issuerCertInfo);
+   }
+
+   if(stream->certInfo != NULL)
+   {
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO,
+         stream->certInfo);
+   }
+
+   //Clear the state of the parser
+   memset(stream, 0, sizeof(TlsCertStream));
+}
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file tls_cert_stream.h
+ * @brief Incremental parsing of Certificate messages
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_CERT_STREAM_H
+#define _TLS_CERT_STREAM_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Parsing states of the incremental Certificate message parser
+ **/
+
+typedef enum
+{
+   TLS_CERT_STREAM_STATE_CONTEXT_LEN = 0,
+   TLS_CERT_STREAM_STATE_CONTEXT     = 1,
+   TLS_CERT_STREAM_STATE_LIST_LEN    = 2,
+   TLS_CERT_STREAM_STATE_ENTRY_LEN   = 3,
+   TLS_CERT_STREAM_STATE_ENTRY       = 4,
+   TLS_CERT_STREAM_STATE_EXT_LEN     = 5,
+   TLS_CERT_STREAM_STATE_EXT         = 6
+} TlsCertStreamState;
+
+
+//Incremental parsing of Certificate messages
+bool_t tlsIsCertStreamAllowed(TlsContext *context, uint8_t msgType);
+
+error_t tlsStartCertStream(TlsContext *context, size_t length);
+
+error_t tlsParseCertStream(TlsContext *context, const uint8_t *data,
+   size_t length);
+
+error_t tlsProcessCertStreamField(TlsContext *context);
+error_t tlsProcessCertStreamEntry(TlsContext *context);
+
+error_t tlsCompleteCertStream(TlsContext *context);
+void tlsFreeCertStream(TlsContext *context);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,265 @@
+/**
+ * @file tls_cert_verify_cache.c
+ * @brief Cache of verified certificate signatures
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_stats.h"
+#include "tls_cert_verify_cache.h"
+#include "hash/sha256.h"
+#include "pkix/x509_cert_validate.h"
+#include "date_time.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a certificate verification cache
+ *
+ * The cache remembers which certificates have already been successfully
+ * validated against a given issuer, so that the costly signature check can
+ * be skipped when the same chain is received again. It can be shared by any
+ * number of TLS contexts and shared configurations
+ *
+ * @param[in] size Maximum number of cache entries
+ * @return Handle referencing the fully initialized cache
+ **/
+
+TlsCertVerifyCache *tlsInitCertVerifyCache(uint_t size)
+{
+   size_t n;
+   TlsCertVerifyCache *cache;
+
+   //Make sure the parameter is acceptable
+   if(size < 1)
+      return NULL;
+
+   //Size of the memory required
+   n = sizeof(TlsCertVerifyCache) + size * sizeof(TlsCertVerifyCacheEntry);
+
+   //Allocate a memory buffer to hold the cache
+   cache = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(cache == NULL)
+      return NULL;
+
+   //Clear memory
+   memset(cache, 0, n);
+
+   //Create a mutex to prevent simultaneous access to the cache
+   if(!osCreateMutex(&cache->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(cache);
+      //Report an error
+      return NULL;
+   }
+
+   //Save the maximum number of cache entries
+   cache->size = size;
+
+   //Return a pointer to the newly created cache
+   return cache;
+}
+
+
+/**
+ * @brief Validate a certificate, using the verification cache if possible
+ *
+ * The outcome of x509ValidateCertificate() only depends on the certificate,
+ * its issuer, the path length and the current time. A successful result is
+ * therefore remembered under a digest of both certificates and replayed as
+ * long as the current time lies within the validity period of the
+ * certificate and the entry has not expired. Failures are never cached
+ *
+ * @param[in] cache Certificate verification cache (optional parameter)
+ * @param[in] certInfo Certificate to be verified
+ * @param[in] issuerCertInfo Issuer certificate
+ * @param[in] pathLen Certificate path length
+ * @return Error code
+ **/
+
+error_t tlsValidateCertificateCached(TlsCertVerifyCache *cache,
+   const X509CertificateInfo *certInfo,
+   const X509CertificateInfo *issuerCertInfo, uint_t pathLen)
+{
+   error_t error;
+   uint_t i;
+   bool_t found;
+   systime_t time;
+   uint32_t currentTime;
+   TlsCertVerifyCacheEntry *entry;
+   uint8_t certDigest[SHA256_DIGEST_SIZE];
+   uint8_t issuerDigest[SHA256_DIGEST_SIZE];
+
+   //No cache attached?
+   if(cache == NULL)
+   {
+      TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+      return x509ValidateCertificate(certInfo, issuerCertInfo, pathLen);
+   }
+
+   //Compute the digest of the certificate and of its issuer
+   tlsComputeCertVerifyDigest(certInfo, certDigest);
+   tlsComputeCertVerifyDigest(issuerCertInfo, issuerDigest);
+
+   //Get current time
+   time = osGetSystemTime();
+   currentTime = getCurrentUnixTime();
+
+   //Initialize flag
+   found = FALSE;
+
+   //Acquire exclusive access to the cache
+   osAcquireMutex(&cache->mutex);
+
+   //Loop through the cache entries
+   for(i = 0; i < cache->size && !found; i++)
+   {
+      //Point to the current entry
+      entry = &cache->entries[i];
+
+      //Matching entry?
+      if(entry->valid && entry->pathLen == pathLen &&
+         !memcmp(entry->certDigest, certDigest, SHA256_DIGEST_SIZE) &&
+         !memcmp(entry->issuerDigest, issuerDigest, SHA256_DIGEST_SIZE))
+      {
+         //Check whether the entry is still usable
+         if((time - entry->timestamp) < TLS_CERT_VERIFY_CACHE_LIFETIME &&
+            (currentTime == 0 || (currentTime >= entry->notBefore &&
+            currentTime <= entry->notAfter)))
+         {
+            //The certificate has already been verified by this issuer
+            found = TRUE;
+         }
+         else
+         {
+            //Drop the stale entry and perform a full validation
+            entry->valid = FALSE;
+         }
+      }
+   }
+
+   //Release exclusive access to the cache
+   osReleaseMutex(&cache->mutex);
+
+   //Cache hit?
+   if(found)
+   {
+      //Debug message
+      TRACE_DEBUG("Certificate signature found in verification cache\r\n");
+      //The signature does not need to be checked again
+      return NO_ERROR;
+   }
+
+   //Perform a full validation of the certificate
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+   error = x509ValidateCertificate(certInfo, issuerCertInfo, pathLen);
+
+   //Successful validation?
+   if(!error)
+   {
+      //Acquire exclusive access to the cache
+      osAcquireMutex(&cache->mutex);
+
+      //Select the entry to be evicted (round-robin policy)
+      entry = &cache->entries[cache->victim];
+      cache->victim = (cache->victim + 1) % cache->size;
+
+      //Save the validation result
+      memcpy(entry->certDigest, certDigest, SHA256_DIGEST_SIZE);
+      memcpy(entry->issuerDigest, issuerDigest, SHA256_DIGEST_SIZE);
+      entry->pathLen = pathLen;
+      entry->timestamp = time;
+
+      //The entry cannot outlive the validity period of the certificate
+      entry->notBefore = convertDateToUnixTime(
+         &certInfo->tbsCert.validity.notBefore);
+      entry->notAfter = convertDateToUnixTime(
+         &certInfo->tbsCert.validity.notAfter);
+
+      //The entry is now valid
+      entry->valid = TRUE;
+
+      //Release exclusive access to the cache
+      osReleaseMutex(&cache->mutex);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Compute the digest identifying a certificate in the cache
+ * @param[in] certInfo X.509 certificate
+ * @param[out] digest SHA-256 digest of the certificate
+ **/
+
+void tlsComputeCertVerifyDigest(const X509CertificateInfo *certInfo,
+   uint8_t *digest)
+{
+   Sha256Context sha256Context;
+
+   //The TBSCertificate and the signature value uniquely identify the
+   //certificate
+   sha256Init(&sha256Context);
+   sha256Update(&sha256Context, certInfo->tbsCert.rawData,
+      certInfo->tbsCert.rawDataLen);
+   sha256Update(&sha256Context, certInfo->signatureValue.data,
+      certInfo->signatureValue.length);
+   sha256Final(&sha256Context, digest);
+}
+
+
+/**
+ * @brief Release certificate verification cache
+ * @param[in] cache Certificate verification cache to be released
+ **/
+
+void tlsFreeCertVerifyCache(TlsCertVerifyCache *cache)
+{
+   //Valid cache?
+   if(cache != NULL)
+   {
+      //Release previously allocated resources
+      osDeleteMutex(&cache->mutex);
+      //Free previously allocated memory
+      tlsFreeMem(cache);
+   }
+}
+
+#endif
@@ -35,7 +35,11 @@
 #include <string.h>
 #include <ctype.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_certificate.h"
+#include "tls_trust_store.h"
+#include "tls_cert_verify_cache.h"
+#include "tls_verify_pool.h"
 #include "tls_misc.h"
 #include "encoding/asn1.h"
 #include "encoding/oid.h"
@@ -72,6 +76,14 @@ error_t tlsFormatCertificateList(TlsContext *context, uint8_t *p,
    //Length of the certificate list in bytes
    *written = 0;
 
+   //Pre-parsed credential?
+   if(context->cert != NULL && context->cert->credential != NULL)
+   {
+      //The certificate chain is already in TLS wire format
+      return tlsFormatCredentialCertList(context, context->cert->credential,
+         p, written);
+   }
+
    //Check whether a certificate is available
    if(context->cert != NULL)
    {
@@ -92,6 +104,7 @@ error_t tlsFormatCertificateList(TlsContext *context, uint8_t *p,
    while(certChainLen > 0)
    {
       //The first pass calculates the length of the DER-encoded certificate
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
       error = pemImportCertificate(certChain, certChainLen, NULL, &n, NULL);
 
       //End of file detected?
@@ -114,6 +127,7 @@ error_t tlsFormatCertificateList(TlsContext *context, uint8_t *p,
       STORE24BE(n, p);
 
       //The second pass decodes the PEM certificate
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
       error = pemImportCertificate(certChain, certChainLen, p + 3, &n, &m);
       //Any error to report?
       if(error)
@@ -131,8 +145,78 @@ error_t tlsFormatCertificateList(TlsContext *context, uint8_t *p,
       //TLS 1.3 currently selected?
       if(context->version == TLS_VERSION_1_3)
       {
+         //The end-entity certificate is the first entry of the list
+         error = tls13FormatCertExtensions(context, *written == (n + 3), p,
+            &n);
+         //Any error to report?
+         if(error)
+            break;
+
+         //Advance write pointer
+         p += n;
+         *written += n;
+      }
+#endif
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Format certificate chain from a pre-parsed credential
+ * @param[in] context Pointer to the TLS context
+ * @param[in] credential Pre-parsed certificate chain
+ * @param[in] p Output stream where to write the certificate chain
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tlsFormatCredentialCertList(TlsContext *context,
+   const TlsCredential *credential, uint8_t *p, size_t *written)
+{
+   error_t error;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Length of the certificate list in bytes
+   *written = 0;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //TLS 1.3 currently selected?
+   if(context->version == TLS_VERSION_1_3)
+   {
+      size_t i;
+      size_t m;
+      size_t n;
+
+      //Loop through the certificates
+      for(i = 0; i < credential->certListLen; i += m)
+      {
+         //Each certificate is preceded by a 3-byte length field
+         m = LOAD24BE(credential->certList + i) + 3;
+         //Each CertificateEntry also carries a list of extensions
+         n = tls13GetCertExtensionsLength(context, i == 0);
+
+         //Buffer overflow?
+         if((*written + m + n) > context->txBufferMaxLen)
+         {
+            //Report an error
+            error = ERROR_MESSAGE_TOO_LONG;
+            break;
+         }
+
+         //Copy the current certificate
+         memcpy(p, credential->certList + i, m);
+
+         //Advance write pointer
+         p += m;
+         *written += m;
+
          //Format the list of extensions for the current CertificateEntry
-         error = tls13FormatCertExtensions(p, &n);
+         error = tls13FormatCertExtensions(context, i == 0, p, &n);
          //Any error to report?
          if(error)
             break;
@@ -141,7 +225,23 @@ error_t tlsFormatCertificateList(TlsContext *context, uint8_t *p,
          p += n;
          *written += n;
       }
+   }
+   else
 #endif
+   {
+      //Buffer overflow?
+      if(credential->certListLen > context->txBufferMaxLen)
+      {
+         //Report an error
+         error = ERROR_MESSAGE_TOO_LONG;
+      }
+      else
+      {
+         //The certificate list can be copied as is
+         memcpy(p, credential->certList, credential->certListLen);
+         //Total number of bytes that have been written
+         *written = credential->certListLen;
+      }
    }
 
    //Return status code
@@ -169,8 +269,48 @@ error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
    *written = 0;
 
 #if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+   //Pre-parsed credential?
+   if(context->cert != NULL && context->cert->credential != NULL)
+   {
+      size_t n;
+      const TlsCredential *credential;
+
+      //Point to the credential
+      credential = context->cert->credential;
+      //Retrieve the length of the raw public key
+      n = credential->rawPublicKeyLen;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //TLS 1.3 currently selected?
+      if(context->version == TLS_VERSION_1_3)
+      {
+         //The raw public key is preceded by a 3-byte length field
+         STORE24BE(n, p);
+         //Copy the raw public key
+         memcpy(p + 3, credential->rawPublicKey, n);
+
+         //Advance data pointer
+         p += n + 3;
+         //Adjust the length of the certificate list
+         *written += n + 3;
+
+         //Format the list of extensions for the current CertificateEntry
+         error = tls13FormatCertExtensions(context, FALSE, p, &n);
+
+         //Adjust the length of the certificate list
+         *written += n;
+      }
+      else
+#endif
+      {
+         //Copy the raw public key
+         memcpy(p, credential->rawPublicKey, n);
+         //Adjust the length of the certificate list
+         *written += n;
+      }
+   }
    //Check whether a certificate is available
-   if(context->cert != NULL)
+   else if(context->cert != NULL)
    {
       size_t n;
       uint8_t *derCert;
@@ -185,6 +325,7 @@ error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
       do
       {
          //The first pass calculates the length of the DER-encoded certificate
+         TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
          error = pemImportCertificate(context->cert->certChain,
             context->cert->certChainLen, NULL, &derCertLen, NULL);
          //Any error to report?
@@ -192,7 +333,8 @@ error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
             break;
 
          //Allocate a memory buffer to hold the DER-encoded certificate
-         derCert = tlsAllocMem(derCertLen);
+         derCert = tlsAllocHandshakeObject(context,
+            TLS_MEM_CLASS_DER_CERT, derCertLen);
          //Failed to allocate memory?
          if(derCert == NULL)
          {
@@ -201,6 +343,7 @@ error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
          }
 
          //The second pass decodes the PEM certificate
+         TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
          error = pemImportCertificate(context->cert->certChain,
             context->cert->certChainLen, derCert, &derCertLen, NULL);
          //Any error to report?
@@ -208,7 +351,8 @@ error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
             break;
 
          //Allocate a memory buffer to store X.509 certificate info
-         certInfo = tlsAllocMem(sizeof(X509CertificateInfo));
+         certInfo = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO,
+            sizeof(X509CertificateInfo));
          //Failed to allocate memory?
          if(certInfo == NULL)
          {
@@ -217,6 +361,7 @@ error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
          }
 
          //Parse X.509 certificate
+         TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
          error = x509ParseCertificate(derCert, derCertLen, certInfo);
          //Failed to parse the X.509 certificate?
          if(error)
@@ -240,7 +385,7 @@ error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
             *written += n + 3;
 
             //Format the list of extensions for the current CertificateEntry
-            error = tls13FormatCertExtensions(p, &n);
+            error = tls13FormatCertExtensions(context, FALSE, p, &n);
             //Any error to report?
             if(error)
                break;
@@ -266,8 +411,8 @@ error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
       } while(0);
 
       //Release previously allocated memory
-      tlsFreeMem(derCert);
-      tlsFreeMem(certInfo);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_DER_CERT, derCert);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO, certInfo);
    }
 #endif
 
@@ -289,11 +434,16 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
 {
    error_t error;
    error_t certValidResult;
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+   error_t certValidError;
+#endif
    uint_t i;
    size_t n;
-   const char_t *subjectName;
    X509CertificateInfo *certInfo;
    X509CertificateInfo *issuerCertInfo;
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+   TlsVerifyBatch verifyBatch;
+#endif
 
    //Initialize X.509 certificates
    certInfo = NULL;
@@ -303,7 +453,8 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
    do
    {
       //Allocate a memory buffer to store X.509 certificate info
-      certInfo = tlsAllocMem(sizeof(X509CertificateInfo));
+      certInfo = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO,
+         sizeof(X509CertificateInfo));
       //Failed to allocate memory?
       if(certInfo == NULL)
       {
@@ -313,7 +464,8 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
       }
 
       //Allocate a memory buffer to store the parent certificate
-      issuerCertInfo = tlsAllocMem(sizeof(X509CertificateInfo));
+      issuerCertInfo = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO,
+         sizeof(X509CertificateInfo));
       //Failed to allocate memory?
       if(issuerCertInfo == NULL)
       {
@@ -344,104 +496,13 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
          break;
       }
 
-      //Display ASN.1 structure
-      error = asn1DumpObject(p, n, 0);
-      //Any error to report?
-      if(error)
-         break;
-
-      //Parse end-user certificate
-      error = x509ParseCertificate(p, n, certInfo);
-      //Failed to parse the X.509 certificate?
-      if(error)
-      {
-         //Report an error
-         error = ERROR_DECODING_FAILED;
-         break;
-      }
-
-      //Check certificate key usage
-      error = tlsCheckKeyUsage(certInfo, context->entity,
-         context->keyExchMethod);
+      //Parse and check the end-user certificate
+      error = tlsParseEndEntityCertificate(context, p, n, certInfo,
+         &certValidResult);
       //Any error to report?
       if(error)
          break;
 
-      //Extract the public key from the end-user certificate
-      error = tlsReadSubjectPublicKey(context,
-         &certInfo->tbsCert.subjectPublicKeyInfo);
-      //Any error to report?
-      if(error)
-         break;
-
-#if (TLS_CLIENT_SUPPORT == ENABLED)
-      //Client mode?
-      if(context->entity == TLS_CONNECTION_END_CLIENT)
-      {
-         TlsCertificateType certType;
-         TlsSignatureAlgo certSignAlgo;
-         TlsHashAlgo certHashAlgo;
-         TlsNamedGroup namedCurve;
-
-         //Retrieve the type of the X.509 certificate
-         error = tlsGetCertificateType(certInfo, &certType, &certSignAlgo,
-            &certHashAlgo, &namedCurve);
-         //Unsupported certificate?
-         if(error)
-            break;
-
-         //Version of TLS prior to TLS 1.3?
-         if(context->version <= TLS_VERSION_1_2)
-         {
-            //ECDSA certificate?
-            if(certType == TLS_CERT_ECDSA_SIGN)
-            {
-               //Make sure the elliptic curve is supported
-               if(tlsGetCurveInfo(context, namedCurve) == NULL)
-               {
-                  error = ERROR_BAD_CERTIFICATE;
-                  break;
-               }
-            }
-         }
-
-         //Point to the subject name
-         subjectName = context->serverName;
-
-         //Check the subject name in the server certificate against the actual
-         //FQDN name that is being requested
-         error = x509CheckSubjectName(certInfo, subjectName);
-         //Any error to report?
-         if(error)
-         {
-            //Debug message
-            TRACE_WARNING("Server name mismatch!\r\n");
-
-            //Report an error
-            error = ERROR_BAD_CERTIFICATE;
-            break;
-         }
-      }
-      else
-#endif
-      //Server mode?
-      {
-         //Do not check name constraints
-         subjectName = NULL;
-      }
-
-      //Check if the end-user certificate can be matched with a trusted CA
-      certValidResult = tlsValidateCertificate(context, certInfo, 0,
-         subjectName);
-
-      //Check validation result
-      if(certValidResult != NO_ERROR && certValidResult != ERROR_UNKNOWN_CA)
-      {
-         //Report an error
-         error = ERROR_BAD_CERTIFICATE;
-         break;
-      }
-
       //Next certificate
       p += n;
       length -= n;
@@ -451,7 +512,7 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
       if(context->version == TLS_VERSION_1_3)
       {
          //Parse the list of extensions for the current CertificateEntry
-         error = tls13ParseCertExtensions(p, length, &n);
+         error = tls13ParseCertExtensions(context, TRUE, p, length, &n);
          //Any error to report?
          if(error)
             break;
@@ -463,6 +524,15 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
       }
 #endif
 
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+      //When a verification worker pool is attached, the signature checks of
+      //the chain run in parallel while the chain is being parsed
+      if(!tlsInitVerifyBatch(context, &verifyBatch))
+      {
+         context->verifyBatch = &verifyBatch;
+      }
+#endif
+
       //PKIX path validation
       for(i = 0; length > 0; i++)
       {
@@ -489,64 +559,13 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
             break;
          }
 
-         //Display ASN.1 structure
-         error = asn1DumpObject(p, n, 0);
+         //Parse the intermediate certificate and validate the current one
+         error = tlsParseIssuerCertificate(context, p, n, i, certInfo,
+            issuerCertInfo, &certValidResult);
          //Any error to report?
          if(error)
             break;
 
-         //Parse intermediate certificate
-         error = x509ParseCertificate(p, n, issuerCertInfo);
-         //Failed to parse the X.509 certificate?
-         if(error)
-         {
-            //Report an error
-            error = ERROR_DECODING_FAILED;
-            break;
-         }
-
-         //Certificate chain validation in progress?
-         if(certValidResult == ERROR_UNKNOWN_CA)
-         {
-            //Validate current certificate
-            error = x509ValidateCertificate(certInfo, issuerCertInfo, i);
-            //Certificate validation failed?
-            if(error)
-               break;
-
-            //Check name constraints
-            error = x509CheckNameConstraints(subjectName, issuerCertInfo);
-            //Should the application reject the certificate?
-            if(error)
-               return ERROR_BAD_CERTIFICATE;
-
-            //Check the version of the certificate
-            if(issuerCertInfo->tbsCert.version < X509_VERSION_3)
-            {
-               //Conforming implementations may choose to reject all version 1
-               //and version 2 intermediate certificates (refer to RFC 5280,
-               //section 6.1.4)
-               error = ERROR_BAD_CERTIFICATE;
-               break;
-            }
-
-            //Check if the intermediate certificate can be matched with a
-            //trusted CA
-            certValidResult = tlsValidateCertificate(context, issuerCertInfo,
-               i, subjectName);
-
-            //Check validation result
-            if(certValidResult != NO_ERROR && certValidResult != ERROR_UNKNOWN_CA)
-            {
-               //Report an error
-               error = ERROR_BAD_CERTIFICATE;
-               break;
-            }
-         }
-
-         //Keep track of the issuer certificate
-         *certInfo = *issuerCertInfo;
-
          //Next certificate
          p += n;
          length -= n;
@@ -556,7 +575,7 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
          if(context->version == TLS_VERSION_1_3)
          {
             //Parse the list of extensions for the current CertificateEntry
-            error = tls13ParseCertExtensions(p, length, &n);
+            error = tls13ParseCertExtensions(context, FALSE, p, length, &n);
             //Any error to report?
             if(error)
                break;
@@ -569,6 +588,21 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
 #endif
       }
 
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+      //Parallel verification in progress?
+      if(context->verifyBatch != NULL)
+      {
+         //Wait for the outstanding signature checks. A failed check takes
+         //precedence, since it comes first in chain order
+         certValidError = tlsCompleteVerifyBatch(context->verifyBatch);
+         context->verifyBatch = NULL;
+
+         //Any signature check failed?
+         if(certValidError)
+            error = certValidError;
+      }
+#endif
+
       //Certificate chain validation failed?
       if(error == NO_ERROR && certValidResult != NO_ERROR)
       {
@@ -582,14 +616,229 @@ error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
    } while(0);
 
    //Free previously allocated memory
-   tlsFreeMem(certInfo);
-   tlsFreeMem(issuerCertInfo);
+   tlsFreeHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO, certInfo);
+   tlsFreeHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO, issuerCertInfo);
 
    //Return status code
    return error;
 }
 
 
+/**
+ * @brief Parse and check the end-user certificate of a chain
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Pointer to the DER-encoded certificate
+ * @param[in] length Length of the DER-encoded certificate
+ * @param[out] certInfo Information resulting from the certificate parsing
+ * @param[out] certValidResult Result of the chain validation so far
+ * @return Error code
+ **/
+
+error_t tlsParseEndEntityCertificate(TlsContext *context, const uint8_t *p,
+   size_t length, X509CertificateInfo *certInfo, error_t *certValidResult)
+{
+   error_t error;
+   const char_t *subjectName;
+
+   //Display ASN.1 structure
+   error = asn1DumpObject(p, length, 0);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Parse end-user certificate
+   TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
+   error = x509ParseCertificate(p, length, certInfo);
+   //Failed to parse the X.509 certificate?
+   if(error)
+      return ERROR_DECODING_FAILED;
+
+   //Check certificate key usage
+   error = tlsCheckKeyUsage(certInfo, context->entity,
+      context->keyExchMethod);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Extract the public key from the end-user certificate
+   error = tlsReadSubjectPublicKey(context,
+      &certInfo->tbsCert.subjectPublicKeyInfo);
+   //Any error to report?
+   if(error)
+      return error;
+
+#if (TLS_CLIENT_SUPPORT == ENABLED)
+   //Client mode?
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      TlsCertificateType certType;
+      TlsSignatureAlgo certSignAlgo;
+      TlsHashAlgo certHashAlgo;
+      TlsNamedGroup namedCurve;
+
+      //Retrieve the type of the X.509 certificate
+      error = tlsGetCertificateType(certInfo, &certType, &certSignAlgo,
+         &certHashAlgo, &namedCurve);
+      //Unsupported certificate?
+      if(error)
+         return error;
+
+      //Version of TLS prior to TLS 1.3?
+      if(context->version <= TLS_VERSION_1_2)
+      {
+         //ECDSA certificate?
+         if(certType == TLS_CERT_ECDSA_SIGN)
+         {
+            //Make sure the elliptic curve is supported
+            if(tlsGetCurveInfo(context, namedCurve) == NULL)
+               return ERROR_BAD_CERTIFICATE;
+         }
+      }
+
+      //Point to the subject name
+      subjectName = context->serverName;
+
+      //Check the subject name in the server certificate against the actual
+      //FQDN name that is being requested
+      error = x509CheckSubjectName(certInfo, subjectName);
+      //Any error to report?
+      if(error)
+      {
+         //Debug message
+         TRACE_WARNING("Server name mismatch!\r\n");
+
+         //Report an error
+         return ERROR_BAD_CERTIFICATE;
+      }
+   }
+   else
+#endif
+   //Server mode?
+   {
+      //Do not check name constraints
+      subjectName = NULL;
+   }
+
+   //Check if the end-user certificate can be matched with a trusted CA
+   *certValidResult = tlsValidateCertificate(context, certInfo, 0,
+      subjectName);
+
+   //Check validation result
+   if(*certValidResult != NO_ERROR && *certValidResult != ERROR_UNKNOWN_CA)
+      return ERROR_BAD_CERTIFICATE;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse an intermediate certificate of a chain
+ *
+ * The last certificate of the path is validated against its parent. On
+ * return, the parent becomes the last certificate of the path (certInfo
+ * then references the DER encoding of the parent)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Pointer to the DER-encoded certificate
+ * @param[in] length Length of the DER-encoded certificate
+ * @param[in] pathLen Number of intermediate certificates processed so far
+ * @param[in,out] certInfo Last certificate of the path
+ * @param[out] issuerCertInfo Information resulting from the certificate parsing
+ * @param[in,out] certValidResult Result of the chain validation so far
+ * @return Error code
+ **/
+
+error_t tlsParseIssuerCertificate(TlsContext *context, const uint8_t *p,
+   size_t length, uint_t pathLen, X509CertificateInfo *certInfo,
+   X509CertificateInfo *issuerCertInfo, error_t *certValidResult)
+{
+   error_t error;
+   const char_t *subjectName;
+
+   //Name constraints are only checked by the client
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+      subjectName = context->serverName;
+   else
+      subjectName = NULL;
+
+   //Display ASN.1 structure
+   error = asn1DumpObject(p, length, 0);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Parse intermediate certificate
+   TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
+   error = x509ParseCertificate(p, length, issuerCertInfo);
+   //Failed to parse the X.509 certificate?
+   if(error)
+      return ERROR_DECODING_FAILED;
+
+   //Certificate chain validation in progress?
+   if(*certValidResult == ERROR_UNKNOWN_CA)
+   {
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+      //Parallel verification in progress?
+      if(context->verifyBatch != NULL)
+      {
+         //Queue the signature check to the verification worker pool. The
+         //name and constraint checks below stay on the handshake thread
+         error = tlsSubmitVerifyJob(context->verifyBatch, certInfo,
+            issuerCertInfo, pathLen);
+      }
+      else
+#endif
+      {
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+         //Validate current certificate (the signature is not checked again
+         //if the pair is found in the verification cache)
+         error = tlsValidateCertificateCached(context->certVerifyCache,
+            certInfo, issuerCertInfo, pathLen);
+#else
+         //Validate current certificate
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+         error = x509ValidateCertificate(certInfo, issuerCertInfo, pathLen);
+#endif
+      }
+
+      //Certificate validation failed?
+      if(error)
+         return error;
+
+      //Check name constraints
+      error = x509CheckNameConstraints(subjectName, issuerCertInfo);
+      //Should the application reject the certificate?
+      if(error)
+         return ERROR_BAD_CERTIFICATE;
+
+      //Check the version of the certificate
+      if(issuerCertInfo->tbsCert.version < X509_VERSION_3)
+      {
+         //Conforming implementations may choose to reject all version 1 and
+         //version 2 intermediate certificates (refer to RFC 5280, section
+         //6.1.4)
+         return ERROR_BAD_CERTIFICATE;
+      }
+
+      //Check if the intermediate certificate can be matched with a trusted
+      //CA
+      *certValidResult = tlsValidateCertificate(context, issuerCertInfo,
+         pathLen, subjectName);
+
+      //Check validation result
+      if(*certValidResult != NO_ERROR && *certValidResult != ERROR_UNKNOWN_CA)
+         return ERROR_BAD_CERTIFICATE;
+   }
+
+   //Keep track of the issuer certificate
+   *certInfo = *issuerCertInfo;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Parse raw public key
  * @param[in] context Pointer to the TLS context
@@ -643,6 +892,7 @@ error_t tlsParseRawPublicKey(TlsContext *context, const uint8_t *p,
       rawPublicKey = p;
 
       //Decode the SubjectPublicKeyInfo structure
+      TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
       error = x509ParseSubjectPublicKeyInfo(rawPublicKey, rawPublicKeyLen, &n,
          &subjectPublicKeyInfo);
       //Any error to report?
@@ -659,7 +909,7 @@ error_t tlsParseRawPublicKey(TlsContext *context, const uint8_t *p,
       if(context->version == TLS_VERSION_1_3)
       {
          //Parse the list of extensions for the current CertificateEntry
-         error = tls13ParseCertExtensions(p, length, &n);
+         error = tls13ParseCertExtensions(context, FALSE, p, length, &n);
          //Any error to report?
          if(error)
             return error;
@@ -729,8 +979,11 @@ bool_t tlsIsCertificateAcceptable(TlsContext *context, const TlsCertDesc *cert,
    bool_t acceptable;
 
    //Make sure that a valid certificate has been loaded
-   if(cert->certChain == NULL || cert->certChainLen == 0)
+   if(cert->credential == NULL &&
+      (cert->certChain == NULL || cert->certChainLen == 0))
+   {
       return FALSE;
+   }
 
 #if (TLS_RSA_SIGN_SUPPORT == ENABLED || TLS_RSA_PSS_SIGN_SUPPORT == ENABLED)
    //RSA certificate?
@@ -1167,16 +1420,45 @@ bool_t tlsIsCertificateAcceptable(TlsContext *context, const TlsCertDesc *cert,
          certChainLen = cert->certChainLen;
 
          //Allocate a memory buffer to store X.509 certificate info
-         certInfo = tlsAllocMem(sizeof(X509CertificateInfo));
+         certInfo = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO,
+            sizeof(X509CertificateInfo));
 
+         //Pre-parsed credential?
+         if(certInfo != NULL && cert->credential != NULL)
+         {
+            //The certificates are already DER-encoded
+            for(i = 0; i < cert->credential->certListLen && !acceptable;
+               i += derCertLen + 3)
+            {
+               //Each certificate is preceded by a 3-byte length field
+               derCertLen = LOAD24BE(cert->credential->certList + i);
+
+               //Parse X.509 certificate
+               TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
+               error = x509ParseCertificate(cert->credential->certList + i + 3,
+                  derCertLen, certInfo);
+
+               //Check status code
+               if(!error)
+               {
+                  //Check whether the issuer is a trusted CA
+                  acceptable = tlsMatchCertAuthorities(certAuthorities,
+                     &certInfo->tbsCert.issuer);
+               }
+            }
+
+            //Free previously allocated memory
+            tlsFreeHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO, certInfo);
+         }
          //Successful memory allocation?
-         if(certInfo != NULL)
+         else if(certInfo != NULL)
          {
             //Parse the certificate chain
             while(certChainLen > 0 && !acceptable)
             {
                //The first pass calculates the length of the DER-encoded
                //certificate
+               TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
                error = pemImportCertificate(certChain, certChainLen, NULL,
                   &derCertLen, &pemCertLen);
 
@@ -1184,12 +1466,14 @@ bool_t tlsIsCertificateAcceptable(TlsContext *context, const TlsCertDesc *cert,
                if(!error)
                {
                   //Allocate a memory buffer to hold the DER-encoded certificate
-                  derCert = tlsAllocMem(derCertLen);
+                  derCert = tlsAllocHandshakeObject(context,
+                     TLS_MEM_CLASS_DER_CERT, derCertLen);
 
                   //Successful memory allocation?
                   if(derCert != NULL)
                   {
                      //The second pass decodes the PEM certificate
+                     TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
                      error = pemImportCertificate(certChain, certChainLen,
                         derCert, &derCertLen, NULL);
 
@@ -1197,6 +1481,7 @@ bool_t tlsIsCertificateAcceptable(TlsContext *context, const TlsCertDesc *cert,
                      if(!error)
                      {
                         //Parse X.509 certificate
+                        TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
                         error = x509ParseCertificate(derCert, derCertLen,
                            certInfo);
                      }
@@ -1204,34 +1489,14 @@ bool_t tlsIsCertificateAcceptable(TlsContext *context, const TlsCertDesc *cert,
                      //Check status code
                      if(!error)
                      {
-                        //Parse each distinguished name of the list
-                        for(i = 0; i < length; i += n + 2)
-                        {
-                           //Sanity check
-                           if((i + 2) > length)
-                              break;
-
-                           //Each distinguished name is preceded by a 2-byte
-                           //length field
-                           n = LOAD16BE(certAuthorities->value + i);
-
-                           //Make sure the length field is valid
-                           if((i + n + 2) > length)
-                              break;
-
-                           //Check if the distinguished name matches the root CA
-                           if(x509CompareName(certAuthorities->value + i + 2, n,
-                              certInfo->tbsCert.issuer.rawData,
-                              certInfo->tbsCert.issuer.rawDataLen))
-                           {
-                              acceptable = TRUE;
-                              break;
-                           }
-                        }
+                        //Check whether the issuer is a trusted CA
+                        acceptable = tlsMatchCertAuthorities(certAuthorities,
+                           &certInfo->tbsCert.issuer);
                      }
 
                      //Free previously allocated memory
-                     tlsFreeMem(derCert);
+                     tlsFreeHandshakeObject(context,
+                        TLS_MEM_CLASS_DER_CERT, derCert);
                   }
 
                   //Advance read pointer
@@ -1246,7 +1511,7 @@ bool_t tlsIsCertificateAcceptable(TlsContext *context, const TlsCertDesc *cert,
             }
 
             //Free previously allocated memory
-            tlsFreeMem(certInfo);
+            tlsFreeHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO, certInfo);
          }
       }
    }
@@ -1256,6 +1521,50 @@ bool_t tlsIsCertificateAcceptable(TlsContext *context, const TlsCertDesc *cert,
 }
 
 
+/**
+ * @brief Check whether an issuer is listed in the certificate authorities
+ * @param[in] certAuthorities List of trusted CA
+ * @param[in] issuer Distinguished name of the certificate issuer
+ * @return TRUE if the issuer matches one of the distinguished names, else FALSE
+ **/
+
+bool_t tlsMatchCertAuthorities(const TlsCertAuthorities *certAuthorities,
+   const X509Name *issuer)
+{
+   size_t i;
+   size_t n;
+   size_t length;
+
+   //Retrieve the length of the list
+   length = ntohs(certAuthorities->length);
+
+   //Parse each distinguished name of the list
+   for(i = 0; i < length; i += n + 2)
+   {
+      //Sanity check
+      if((i + 2) > length)
+         break;
+
+      //Each distinguished name is preceded by a 2-byte length field
+      n = LOAD16BE(certAuthorities->value + i);
+
+      //Make sure the length field is valid
+      if((i + n + 2) > length)
+         break;
+
+      //Check if the distinguished name matches the root CA
+      if(x509CompareName(certAuthorities->value + i + 2, n, issuer->rawData,
+         issuer->rawDataLen))
+      {
+         return TRUE;
+      }
+   }
+
+   //The issuer is not a trusted CA
+   return FALSE;
+}
+
+
 /**
  * @brief Verify certificate against root CAs
  * @param[in] context Pointer to the TLS context
@@ -1276,10 +1585,19 @@ error_t tlsValidateCertificate(TlsContext *context,
    uint8_t *derCert;
    size_t derCertLen;
    X509CertificateInfo *caCertInfo;
+   TlsCertVerifyCache *cache;
 
    //Initialize status code
    error = ERROR_UNKNOWN_CA;
 
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   //Cache of verified certificate signatures
+   cache = context->certVerifyCache;
+#else
+   //No verification cache
+   cache = NULL;
+#endif
+
    //Any registered callback?
    if(context->certVerifyCallback != NULL)
    {
@@ -1291,8 +1609,15 @@ error_t tlsValidateCertificate(TlsContext *context,
    //Unknown certification authority?
    if(error == ERROR_UNKNOWN_CA)
    {
+      //Pre-decoded trusted CA store?
+      if(context->trustStore != NULL)
+      {
+         //Look up the issuer in the trusted CA store
+         error = tlsValidateWithTrustStore(context->trustStore, cache,
+            certInfo, pathLen, subjectName);
+      }
       //Check whether the certificate should be checked against root CAs
-      if(context->trustedCaListLen > 0)
+      else if(context->trustedCaListLen > 0)
       {
          //Point to the first trusted CA certificate
          trustedCaList = context->trustedCaList;
@@ -1300,7 +1625,8 @@ error_t tlsValidateCertificate(TlsContext *context,
          trustedCaListLen = context->trustedCaListLen;
 
          //Allocate a memory buffer to store X.509 certificate info
-         caCertInfo = tlsAllocMem(sizeof(X509CertificateInfo));
+         caCertInfo = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO,
+            sizeof(X509CertificateInfo));
 
          //Successful memory allocation?
          if(caCertInfo != NULL)
@@ -1310,6 +1636,7 @@ error_t tlsValidateCertificate(TlsContext *context,
             {
                //The first pass calculates the length of the DER-encoded
                //certificate
+               TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
                error = pemImportCertificate(trustedCaList, trustedCaListLen,
                   NULL, &derCertLen, &pemCertLen);
 
@@ -1317,12 +1644,14 @@ error_t tlsValidateCertificate(TlsContext *context,
                if(!error)
                {
                   //Allocate a memory buffer to hold the DER-encoded certificate
-                  derCert = tlsAllocMem(derCertLen);
+                  derCert = tlsAllocHandshakeObject(context,
+                     TLS_MEM_CLASS_DER_CERT, derCertLen);
 
                   //Successful memory allocation?
                   if(derCert != NULL)
                   {
                      //The second pass decodes the PEM certificate
+                     TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
                      error = pemImportCertificate(trustedCaList,
                         trustedCaListLen, derCert, &derCertLen, NULL);
 
@@ -1330,6 +1659,7 @@ error_t tlsValidateCertificate(TlsContext *context,
                      if(!error)
                      {
                         //Parse X.509 certificate
+                        TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
                         error = x509ParseCertificate(derCert, derCertLen,
                            caCertInfo);
                      }
@@ -1338,22 +1668,8 @@ error_t tlsValidateCertificate(TlsContext *context,
                      if(!error)
                      {
                         //Validate the certificate with the current CA
-                        error = x509ValidateCertificate(certInfo, caCertInfo,
-                           pathLen);
-                     }
-
-                     //Check status code
-                     if(!error)
-                     {
-                        //Check name constraints
-                        error = x509CheckNameConstraints(subjectName, caCertInfo);
-                     }
-
-                     //Check status code
-                     if(!error)
-                     {
-                        //The certificate is issued by a trusted CA
-                        error = NO_ERROR;
+                        error = tlsCheckTrustedCa(cache, caCertInfo, certInfo,
+                           pathLen, subjectName);
                      }
                      else
                      {
@@ -1362,7 +1678,8 @@ error_t tlsValidateCertificate(TlsContext *context,
                      }
 
                      //Free previously allocated memory
-                     tlsFreeMem(derCert);
+                     tlsFreeHandshakeObject(context,
+                        TLS_MEM_CLASS_DER_CERT, derCert);
                   }
                   else
                   {
@@ -1383,7 +1700,8 @@ error_t tlsValidateCertificate(TlsContext *context,
             }
 
             //Free previously allocated memory
-            tlsFreeMem(caCertInfo);
+            tlsFreeHandshakeObject(context,
+               TLS_MEM_CLASS_CERT_INFO, caCertInfo);
          }
          else
          {
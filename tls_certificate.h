@@ -44,12 +44,22 @@ extern "C" {
 error_t tlsFormatCertificateList(TlsContext *context, uint8_t *p,
    size_t *written);
 
+error_t tlsFormatCredentialCertList(TlsContext *context,
+   const TlsCredential *credential, uint8_t *p, size_t *written);
+
 error_t tlsFormatRawPublicKey(TlsContext *context, uint8_t *p,
    size_t *written);
 
 error_t tlsParseCertificateList(TlsContext *context, const uint8_t *p,
    size_t length);
 
+error_t tlsParseEndEntityCertificate(TlsContext *context, const uint8_t *p,
+   size_t length, X509CertificateInfo *certInfo, error_t *certValidResult);
+
+error_t tlsParseIssuerCertificate(TlsContext *context, const uint8_t *p,
+   size_t length, uint_t pathLen, X509CertificateInfo *certInfo,
+   X509CertificateInfo *issuerCertInfo, error_t *certValidResult);
+
 error_t tlsParseRawPublicKey(TlsContext *context, const uint8_t *p,
    size_t length);
 
@@ -58,6 +68,9 @@ bool_t tlsIsCertificateAcceptable(TlsContext *context, const TlsCertDesc *cert,
    const TlsSignHashAlgos *certSignHashAlgos, const TlsSupportedGroupList *curveList,
    const TlsCertAuthorities *certAuthorities);
 
+bool_t tlsMatchCertAuthorities(const TlsCertAuthorities *certAuthorities,
+   const X509Name *issuer);
+
 error_t tlsValidateCertificate(TlsContext *context,
    const X509CertificateInfo *certInfo, uint_t pathLen,
    const char_t *subjectName);
@@ -32,6 +32,7 @@
 #define TRACE_LEVEL TLS_TRACE_LEVEL
 
 //Dependencies
+#include <string.h>
 #include "tls.h"
 #include "tls_cipher_suites.h"
 #include "cipher/rc4.h"
@@ -1350,4 +1351,151 @@ TlsCipherSuiteType tlsGetCipherSuiteType(uint16_t identifier)
    return type;
 }
 
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+
+/**
+ * @brief Build a cipher suite negotiation table
+ * @param[in] cipherSuites List of allowed cipher suites (most preferred first)
+ * @param[in] numCipherSuites Number of cipher suites in the list. If this
+ *   value is zero, all the supported cipher suites are allowed
+ * @param[in] groups Equal-preference group flags (one per allowed cipher
+ *   suite, non-zero if the cipher suite ranks the same as the previous one)
+ * @param[in] numGroups Number of flags in the array
+ * @return Pointer to the newly created table
+ **/
+
+TlsCipherSuiteTable *tlsInitCipherSuiteTable(const uint16_t *cipherSuites,
+   uint_t numCipherSuites, const uint8_t *groups, uint_t numGroups)
+{
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   uint_t numPages;
+   uint16_t identifier;
+   uint8_t pages[256];
+   TlsCipherSuiteEntry *entry;
+   TlsCipherSuiteTable *table;
+
+   //Determine the number of supported cipher suites
+   n = arraysize(tlsSupportedCipherSuites);
+
+   //Clear the page directory
+   memset(pages, 0, sizeof(pages));
+
+   //Only a few distinct values are used for the MSB of the identifiers
+   for(numPages = 0, i = 0; i < n; i++)
+   {
+      //Allocate a new page if necessary
+      if(pages[MSB(tlsSupportedCipherSuites[i].identifier)] == 0)
+         pages[MSB(tlsSupportedCipherSuites[i].identifier)] = ++numPages;
+   }
+
+   //The pages are stored in the same memory block as the table
+   table = tlsAllocMem(sizeof(TlsCipherSuiteTable) +
+      numPages * 256 * sizeof(TlsCipherSuiteEntry));
+   //Failed to allocate memory?
+   if(table == NULL)
+      return NULL;
+
+   //Clear the table
+   memset(table, 0, sizeof(TlsCipherSuiteTable) +
+      numPages * 256 * sizeof(TlsCipherSuiteEntry));
+
+   //Initialize the page directory
+   memcpy(table->pages, pages, sizeof(pages));
+   table->numPages = numPages;
+   table->entries = (TlsCipherSuiteEntry *) (table + 1);
+
+   //Loop through the list of supported cipher suites
+   for(i = 0; i < n; i++)
+   {
+      //Get cipher suite identifier
+      identifier = tlsSupportedCipherSuites[i].identifier;
+
+      //Duplicate identifier?
+      if((table->bitmap[identifier / 32] & (1U << (identifier % 32))) != 0)
+         continue;
+
+      //Restrict the use of certain cipher suites
+      if(numCipherSuites > 0)
+      {
+         //Loop through the list of allowed cipher suites
+         for(j = 0; j < numCipherSuites; j++)
+         {
+            //Compare cipher suite identifiers
+            if(cipherSuites[j] == identifier)
+               break;
+         }
+
+         //Check whether the use of the cipher suite is restricted
+         if(j >= numCipherSuites)
+            continue;
+
+         //Cipher suites of the same equal-preference group share the rank
+         //of the first member of the group
+         while(j > 0 && j < numGroups && groups[j] != 0)
+         {
+            j--;
+         }
+      }
+      else
+      {
+         //All the cipher suites have the same rank
+         j = 0;
+      }
+
+      //Point to the corresponding entry
+      entry = &table->entries[(pages[MSB(identifier)] - 1) * 256 +
+         LSB(identifier)];
+
+      //Save the location of the cipher suite and its rank
+      entry->index = i;
+      entry->rank = j;
+
+      //The cipher suite is supported and allowed
+      table->bitmap[identifier / 32] |= 1U << (identifier % 32);
+   }
+
+   //Return a pointer to the newly created table
+   return table;
+}
+
+
+/**
+ * @brief Look up a cipher suite in the negotiation table
+ * @param[in] table Pointer to the cipher suite negotiation table
+ * @param[in] identifier Cipher suite identifier
+ * @return Pointer to the matching entry, or NULL if the cipher suite is
+ *   not supported or not allowed
+ **/
+
+const TlsCipherSuiteEntry *tlsLookupCipherSuite(
+   const TlsCipherSuiteTable *table, uint16_t identifier)
+{
+   //Unknown or restricted cipher suite?
+   if((table->bitmap[identifier / 32] & (1U << (identifier % 32))) == 0)
+      return NULL;
+
+   //Return a pointer to the matching entry
+   return &table->entries[(table->pages[MSB(identifier)] - 1) * 256 +
+      LSB(identifier)];
+}
+
+
+/**
+ * @brief Release a cipher suite negotiation table
+ * @param[in] table Pointer to the cipher suite negotiation table
+ **/
+
+void tlsFreeCipherSuiteTable(TlsCipherSuiteTable *table)
+{
+   //Valid table?
+   if(table != NULL)
+   {
+      tlsFreeMem(table);
+   }
+}
+
+#endif
+
 #endif
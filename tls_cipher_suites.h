@@ -434,6 +434,35 @@ typedef enum
 } TlsCipherSuiteType;
 
 
+/**
+ * @brief Entry of the cipher suite negotiation table
+ **/
+
+typedef struct
+{
+   uint16_t index; ///<Index in the list of supported cipher suites
+   uint16_t rank;  ///<Rank in the list of allowed cipher suites (0 = most preferred)
+} TlsCipherSuiteEntry;
+
+
+/**
+ * @brief Cipher suite negotiation table
+ *
+ * The table is built once from the list of allowed cipher suites. A bitmap
+ * tells whether a given identifier is both supported and allowed, and a
+ * two-level index maps the identifier to its TlsCipherSuiteInfo entry
+ *
+ **/
+
+struct _TlsCipherSuiteTable
+{
+   uint32_t bitmap[2048];         ///<One bit per cipher suite identifier
+   uint8_t pages[256];            ///<Page number, indexed by the MSB of the identifier (0 = none)
+   uint_t numPages;               ///<Number of pages
+   TlsCipherSuiteEntry *entries;  ///<Pages of 256 entries, indexed by the LSB of the identifier
+};
+
+
 //List of supported cipher suites
 extern const TlsCipherSuiteInfo tlsSupportedCipherSuites[];
 
@@ -447,6 +476,14 @@ bool_t tlsIsCipherSuiteAcceptable(const TlsCipherSuiteInfo *cipherSuite,
 
 TlsCipherSuiteType tlsGetCipherSuiteType(uint16_t identifier);
 
+TlsCipherSuiteTable *tlsInitCipherSuiteTable(const uint16_t *cipherSuites,
+   uint_t numCipherSuites, const uint8_t *groups, uint_t numGroups);
+
+const TlsCipherSuiteEntry *tlsLookupCipherSuite(
+   const TlsCipherSuiteTable *table, uint16_t identifier);
+
+void tlsFreeCipherSuiteTable(TlsCipherSuiteTable *table);
+
 //C++ guard
 #ifdef __cplusplus
 }
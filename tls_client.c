@@ -45,6 +45,7 @@
 #include "tls_client.h"
 #include "tls_client_extensions.h"
 #include "tls_client_misc.h"
+#include "tls_client_template.h"
 #include "tls_common.h"
 #include "tls_extensions.h"
 #include "tls_certificate.h"
@@ -53,6 +54,8 @@
 #include "tls_transcript_hash.h"
 #include "tls_record.h"
 #include "tls_misc.h"
+#include "tls_ocsp.h"
+#include "tls_session_store.h"
 #include "tls13_client.h"
 #include "tls13_client_extensions.h"
 #include "tls13_client_misc.h"
@@ -152,11 +155,31 @@ error_t tlsSendClientHello(TlsContext *context)
             //Check status code
             if(!error)
             {
+               uint16_t namedGroup;
+
+               //Lead with the group the server selected last time, if any,
+               //so that the handshake completes without a HelloRetryRequest
+               namedGroup = tlsLoadGroupHint(context);
+
+               //Check whether the group is still acceptable
+               if(tls13IsGroupSupported(context, namedGroup))
+               {
+                  context->preferredGroup = namedGroup;
+               }
+
                //Any preferred ECDHE or FFDHE group?
                if(tls13IsGroupSupported(context, context->preferredGroup))
                {
                   //Pregenerate key share using preferred named group
                   error = tls13GenerateKeyShare(context, context->preferredGroup);
+
+                  //Check status code
+                  if(!error)
+                  {
+                     //Offer a second key share if a pre-generated key pair
+                     //is readily available
+                     error = tls13GenerateSpeculativeKeyShare(context);
+                  }
                }
                else
                {
@@ -289,6 +312,11 @@ error_t tlsFormatClientHello(TlsContext *context,
    uint8_t *p;
    uint_t cipherSuiteTypes;
    TlsExtensionList *extensionList;
+#if (TLS_CLIENT_HELLO_TEMPLATE_SUPPORT == ENABLED)
+   bool_t useTemplate;
+   size_t keyShareOffset;
+   size_t keyShareLen;
+#endif
 
    //In TLS 1.3, the client indicates its version preferences in the
    //SupportedVersions extension and the legacy_version field must be
@@ -309,6 +337,26 @@ error_t tlsFormatClientHello(TlsContext *context,
    //the client
    message->clientVersion = htons(context->clientVersion);
 
+#if (TLS_CLIENT_HELLO_TEMPLATE_SUPPORT == ENABLED)
+   //Check whether the ClientHello message can be built from a template
+   useTemplate = tlsIsClientHelloTemplateUsable(context);
+
+   //No KeyShare extension so far
+   keyShareOffset = 0;
+   keyShareLen = 0;
+
+   //Template mode?
+   if(useTemplate)
+   {
+      //Copy the pre-encoded message and patch the variable fields
+      error = tlsApplyClientHelloTemplate(context, message, length);
+
+      //The message is formatted from scratch if no template matches
+      if(error != ERROR_NOT_FOUND)
+         return error;
+   }
+#endif
+
    //Client random value
    memcpy(message->random, context->clientRandom, 32);
 
@@ -420,6 +468,19 @@ error_t tlsFormatClientHello(TlsContext *context,
    p += n;
 #endif
 
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   //The client advertises the certificate compression algorithms it supports
+   error = tlsFormatClientCertCompressionExtension(context, p, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Fix the length of the extension list
+   extensionList->length += (uint16_t) n;
+   //Point to the next field
+   p += n;
+#endif
+
 #if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
    //The value of RecordSizeLimit is the maximum size of record in octets
    //that the endpoint is willing to receive
@@ -434,6 +495,32 @@ error_t tlsFormatClientHello(TlsContext *context,
    p += n;
 #endif
 
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   //A DTLS client that wishes to use CIDs includes a ConnectionId extension
+   error = dtlsFormatClientConnectionIdExtension(context, p, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Fix the length of the extension list
+   extensionList->length += (uint16_t) n;
+   //Point to the next field
+   p += n;
+#endif
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+   //A DTLS client that wishes to key SRTP includes a UseSrtp extension
+   error = dtlsFormatClientUseSrtpExtension(context, p, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Fix the length of the extension list
+   extensionList->length += (uint16_t) n;
+   //Point to the next field
+   p += n;
+#endif
+
    //A client that proposes ECC/FFDHE cipher suites in its ClientHello message
    //should send the SupportedGroups extension
    error = tlsFormatSupportedGroupsExtension(context, cipherSuiteTypes, p, &n);
@@ -539,6 +626,34 @@ error_t tlsFormatClientHello(TlsContext *context,
    p += n;
 #endif
 
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //The client presents its session ticket, or requests a new one, in the
+   //SessionTicket extension
+   error = tlsFormatClientSessionTicketExtension(context, p, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Fix the length of the extension list
+   extensionList->length += (uint16_t) n;
+   //Point to the next field
+   p += n;
+#endif
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //The client may request the server to staple an OCSP response in the
+   //handshake (refer to RFC 6066, section 8)
+   error = tlsFormatClientStatusRequestExtension(context, p, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Fix the length of the extension list
+   extensionList->length += (uint16_t) n;
+   //Point to the next field
+   p += n;
+#endif
+
 #if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
    //If the connection's secure_renegotiation flag is set to TRUE, the client
    //must include a RenegotiationInfo extension in its ClientHello message
@@ -584,6 +699,12 @@ error_t tlsFormatClientHello(TlsContext *context,
       if(error)
          return error;
 
+#if (TLS_CLIENT_HELLO_TEMPLATE_SUPPORT == ENABLED)
+      //Save the location of the KeyShare extension
+      keyShareOffset = p - (uint8_t *) message;
+      keyShareLen = n;
+#endif
+
       //Fix the length of the extension list
       extensionList->length += (uint16_t) n;
       //Point to the next field
@@ -697,6 +818,17 @@ error_t tlsFormatClientHello(TlsContext *context,
       }
    }
 
+#if (TLS_CLIENT_HELLO_TEMPLATE_SUPPORT == ENABLED)
+   //Template mode?
+   if(useTemplate)
+   {
+      //The first message formatted from scratch becomes the template. Failing
+      //to save it is not fatal
+      tlsSaveClientHelloTemplate(context, message, *length, keyShareOffset,
+         keyShareLen);
+   }
+#endif
+
    //Successful processing
    return NO_ERROR;
 }
@@ -1061,6 +1193,32 @@ error_t tlsParseServerHello(TlsContext *context,
          return error;
 #endif
 
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+      //DTLS protocol?
+      if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+      {
+         //The server returns the CID the client must use
+         error = dtlsParseServerConnectionIdExtension(context,
+            extensions.connectionId);
+         //Any error to report?
+         if(error)
+            return error;
+      }
+#endif
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+      //DTLS protocol?
+      if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+      {
+         //The server returns the selected SRTP protection profile
+         error = dtlsParseServerUseSrtpExtension(context,
+            extensions.useSrtp);
+         //Any error to report?
+         if(error)
+            return error;
+      }
+#endif
+
 #if (TLS_ECDH_ANON_KE_SUPPORT == ENABLED || TLS_ECDHE_RSA_KE_SUPPORT == ENABLED || \
    TLS_ECDHE_ECDSA_KE_SUPPORT == ENABLED || TLS_ECDHE_PSK_KE_SUPPORT == ENABLED)
       //A server that selects an ECC cipher suite in response to a ClientHello
@@ -1103,6 +1261,28 @@ error_t tlsParseServerHello(TlsContext *context,
          return error;
 #endif
 
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //Parse SessionTicket extension
+      error = tlsParseServerSessionTicketExtension(context,
+         extensions.sessionTicket);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //The server echoes the session ID when it accepts the ticket
+      context->ticketResume = context->resume &&
+         context->sessionTicketLen > 0;
+#endif
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+      //Parse StatusRequest extension
+      error = tlsParseServerStatusRequestExtension(context,
+         extensions.statusRequest);
+      //Any error to report?
+      if(error)
+         return error;
+#endif
+
 #if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
       //Use abbreviated handshake?
       if(context->resume)
@@ -1113,9 +1293,21 @@ error_t tlsParseServerHello(TlsContext *context,
          if(error)
             return error;
 
-         //At this point, both client and server must send ChangeCipherSpec
-         //messages and proceed directly to Finished messages
-         context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+         //The server may renew the ticket before its ChangeCipherSpec
+         //message (refer to RFC 5077, section 3.1)
+         if(context->sessionTicketNegotiated)
+         {
+            context->state = TLS_STATE_NEW_SESSION_TICKET;
+         }
+         else
+#endif
+         {
+            //At this point, both client and server must send
+            //ChangeCipherSpec messages and proceed directly to Finished
+            //messages
+            context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
+         }
       }
       else
 #endif
@@ -1322,6 +1514,9 @@ error_t tlsParseServerKeyExchange(TlsContext *context,
       context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
       context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
    {
+      //Signature verification is about to start
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_VERIFY_START);
+
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_1)
       //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
       if(context->version <= TLS_VERSION_1_1)
@@ -1347,6 +1542,9 @@ error_t tlsParseServerKeyExchange(TlsContext *context,
          error = ERROR_INVALID_VERSION;
       }
 
+      //Signature verification is complete
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_VERIFY_END);
+
       //Any error to report?
       if(error)
          return error;
@@ -1761,4 +1959,149 @@ error_t tlsParseServerHelloDone(TlsContext *context,
    return NO_ERROR;
 }
 
+
+/**
+ * @brief Parse CertificateStatus message
+ *
+ * The server sends a CertificateStatus message immediately after its
+ * Certificate message to staple the OCSP response of its certificate
+ * (refer to RFC 6066, section 8)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming CertificateStatus message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tlsParseCertificateStatus(TlsContext *context,
+   const TlsCertificateStatus *message, size_t length)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   error_t error;
+
+   //Debug message
+   TRACE_INFO("CertificateStatus message received (%" PRIuSIZE " bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Check TLS version
+   if(context->version > TLS_VERSION_1_2)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Check current state
+   if(context->state != TLS_STATE_SERVER_CERTIFICATE_STATUS)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Check the OCSP response against the server certificate
+   error = tlsCheckCertStatus(context, message, length);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //The CertificateStatus message has been processed
+   context->certStatusNegotiated = FALSE;
+   //Update the state of the handshake
+   tlsCompleteCertificate(context);
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //OCSP stapling is not implemented
+   return ERROR_UNEXPECTED_MESSAGE;
+#endif
+}
+
+
+/**
+ * @brief Parse NewSessionTicket message
+ *
+ * The NewSessionTicket message is sent by the server before its
+ * ChangeCipherSpec message when it included an empty SessionTicket
+ * extension in the ServerHello (refer to RFC 5077, section 3.3)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming NewSessionTicket message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tlsParseNewSessionTicket(TlsContext *context,
+   const TlsNewSessionTicket *message, size_t length)
+{
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+
+   //Debug message
+   TRACE_INFO("NewSessionTicket message received (%" PRIuSIZE " bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Check TLS version
+   if(context->version > TLS_VERSION_1_2)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Check current state
+   if(context->state != TLS_STATE_NEW_SESSION_TICKET)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Check the length of the message
+   if(length < sizeof(TlsNewSessionTicket))
+      return ERROR_DECODING_FAILED;
+
+   //Get the length of the ticket
+   n = ntohs(message->ticketLen);
+
+   //Malformed message?
+   if(length != (sizeof(TlsNewSessionTicket) + n))
+      return ERROR_DECODING_FAILED;
+
+   //Release the previous ticket, if any
+   if(context->sessionTicket != NULL)
+   {
+      tlsFreeObject(TLS_MEM_CLASS_TICKET, context->sessionTicket);
+      context->sessionTicket = NULL;
+      context->sessionTicketLen = 0;
+   }
+
+   //A server that does not wish to issue a new ticket sends a zero-length
+   //ticket in the NewSessionTicket message
+   if(n > 0)
+   {
+      //Allocate a memory block to store the ticket
+      context->sessionTicket = tlsAllocObject(TLS_MEM_CLASS_TICKET, n);
+      //Failed to allocate memory?
+      if(context->sessionTicket == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Copy the ticket
+      memcpy(context->sessionTicket, message->ticket, n);
+      context->sessionTicketLen = n;
+
+      //The server may send an empty session ID when issuing a ticket. The
+      //client generates its own session ID so that it can detect whether
+      //the ticket is accepted on resumption (refer to RFC 5077, section 3.4)
+      if(context->sessionIdLen == 0)
+      {
+         //Session ID is limited to 32 bytes
+         context->sessionIdLen = 32;
+
+         //Generate a new random ID
+         error = context->prngAlgo->read(context->prngContext,
+            context->sessionId, context->sessionIdLen);
+         //Any error to report?
+         if(error)
+            return error;
+      }
+   }
+
+   //The server then sends its ChangeCipherSpec message
+   context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session ticket mechanism is not implemented
+   return ERROR_UNEXPECTED_MESSAGE;
+#endif
+}
+
 #endif
@@ -64,6 +64,12 @@ error_t tlsParseCertificateRequest(TlsContext *context,
 error_t tlsParseServerHelloDone(TlsContext *context,
    const TlsServerHelloDone *message, size_t length);
 
+error_t tlsParseCertificateStatus(TlsContext *context,
+   const TlsCertificateStatus *message, size_t length);
+
+error_t tlsParseNewSessionTicket(TlsContext *context,
+   const TlsNewSessionTicket *message, size_t length);
+
 //C++ guard
 #ifdef __cplusplus
 }
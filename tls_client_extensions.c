@@ -301,6 +301,72 @@ error_t tlsFormatClientMaxFragLenExtension(TlsContext *context,
 }
 
 
+/**
+ * @brief Format CompressCertificate extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the CompressCertificate extension
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tlsFormatClientCertCompressionExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   size_t n = 0;
+
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   //Certificate compression only applies to TLS 1.3
+   if(context->versionMax >= TLS_VERSION_1_3)
+   {
+      uint_t i;
+      uint_t j;
+      TlsExtension *extension;
+      TlsCertCompressionAlgos *certCompressionAlgoList;
+
+      //Add the CompressCertificate extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_COMPRESS_CERTIFICATE);
+
+      //Point to the list of compression algorithms
+      certCompressionAlgoList = (TlsCertCompressionAlgos *) extension->value;
+
+      //The list contains the algorithms the client can decompress
+      for(i = 0, j = 0; i < context->numCertCompressionCodecs; i++)
+      {
+         //Decompression callback available?
+         if(context->certCompressionCodecs[i].decompressCallback != NULL)
+         {
+            certCompressionAlgoList->value[j++] =
+               htons(context->certCompressionCodecs[i].algorithm);
+         }
+      }
+
+      //Any algorithm to offer?
+      if(j > 0)
+      {
+         //Compute the length, in bytes, of the list
+         certCompressionAlgoList->length = (uint8_t) (j * sizeof(uint16_t));
+
+         //Consider the length field that precedes the list
+         n = sizeof(TlsCertCompressionAlgos) + certCompressionAlgoList->length;
+         //Fix the length of the extension
+         extension->length = htons(n);
+
+         //Compute the length, in bytes, of the CompressCertificate extension
+         n += sizeof(TlsExtension);
+      }
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Format RecordSizeLimit extension
  * @param[in] context Pointer to the TLS context
@@ -545,60 +611,20 @@ error_t tlsFormatClientAlpnExtension(TlsContext *context,
 #if (TLS_ALPN_SUPPORT == ENABLED)
    //The ALPN extension contains the list of protocols advertised by the
    //client, in descending order of preference
-   if(context->protocolList != NULL)
+   if(context->alpnList != NULL)
    {
-      uint_t i;
-      uint_t j;
       TlsExtension *extension;
-      TlsProtocolName *protocolName;
-      TlsProtocolNameList *protocolNameList;
 
       //Add ALPN (Application-Layer Protocol Negotiation) extension
       extension = (TlsExtension *) p;
       //Type of the extension
       extension->type = HTONS(TLS_EXT_ALPN);
 
-      //Point to the list of protocol names
-      protocolNameList = (TlsProtocolNameList *) extension->value;
-
-      //Move back to the beginning of the list
-      i = 0;
-      j = 0;
-      n = 0;
+      //The ProtocolNameList has been encoded once, when the list of
+      //supported protocols was configured
+      n = context->alpnList->encodedLen;
+      memcpy(extension->value, context->alpnList->encoded, n);
 
-      //Parse the list of supported protocols
-      do
-      {
-         //Delimiter character found?
-         if(context->protocolList[i] == ',' || context->protocolList[i] == '\0')
-         {
-            //Discard empty tokens
-            if((i - j) > 0)
-            {
-               //Point to the protocol name
-               protocolName = (TlsProtocolName *) (protocolNameList->value + n);
-
-               //Fill in the length field
-               protocolName->length = i - j;
-               //Copy protocol name
-               memcpy(protocolName->value, context->protocolList + j, i - j);
-
-               //Adjust the length of the list
-               n += sizeof(TlsProtocolName) + i - j;
-            }
-
-            //Move to the next token
-            j = i + 1;
-         }
-
-         //Loop until the NULL character is reached
-      } while(context->protocolList[i++] != '\0');
-
-      //Fix the length of the list
-      protocolNameList->length = htons(n);
-
-      //Consider the 2-byte length field that precedes the list
-      n += sizeof(TlsProtocolNameList);
       //Fix the length of the extension
       extension->length = htons(n);
 
@@ -776,6 +802,120 @@ error_t tlsFormatClientEmsExtension(TlsContext *context,
 }
 
 
+/**
+ * @brief Format SessionTicket extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the SessionTicket extension
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tlsFormatClientSessionTicketExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   size_t n = 0;
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //Session tickets only apply to TLS 1.2 and earlier versions
+   if(context->sessionTicketEnabled &&
+      context->versionMin <= TLS_VERSION_1_2)
+   {
+      TlsExtension *extension;
+
+      //Add the SessionTicket extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_SESSION_TICKET);
+
+      //The client presents the ticket of the session it wishes to resume.
+      //An empty extension requests a new ticket (refer to RFC 5077,
+      //section 3.2)
+      if(context->sessionTicketLen > 0 && context->sessionIdLen > 0)
+         n = context->sessionTicketLen;
+      else
+         n = 0;
+
+#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+      //Secure renegotiation?
+      if(context->secureRenegoEnabled && context->secureRenegoFlag)
+      {
+         //Do not present a ticket when renegotiating
+         n = 0;
+      }
+#endif
+
+      //Copy the session ticket
+      memcpy(extension->value, context->sessionTicket, n);
+
+      //Fix the length of the extension
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the SessionTicket extension
+      n += sizeof(TlsExtension);
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format StatusRequest extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the StatusRequest extension
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tlsFormatClientStatusRequestExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   size_t n = 0;
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Check whether the client requests the status of the server certificate
+   if(context->ocspStaplingEnabled)
+   {
+      TlsExtension *extension;
+      TlsCertStatusRequest *statusRequest;
+
+      //Add the StatusRequest extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_STATUS_REQUEST);
+
+      //Point to the CertificateStatusRequest structure
+      statusRequest = (TlsCertStatusRequest *) extension->value;
+      //The client requests an OCSP response
+      statusRequest->statusType = TLS_CERT_STATUS_TYPE_OCSP;
+
+      //The responder_id_list and request_extensions fields are empty, which
+      //means that the responders are implicitly known to the server
+      STORE16BE(0, statusRequest->request);
+      STORE16BE(0, statusRequest->request + 2);
+
+      //Compute the length of the CertificateStatusRequest structure
+      n = sizeof(TlsCertStatusRequest) + 4;
+      //Fix the length of the extension
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the StatusRequest extension
+      n += sizeof(TlsExtension);
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Format RenegotiationInfo extension
  * @param[in] context Pointer to the TLS context
@@ -971,6 +1111,14 @@ error_t tlsParseServerMaxFragLenExtension(TlsContext *context,
       //handshake with an illegal_parameter alert
       if(n != context->maxFragLen)
          return ERROR_ILLEGAL_PARAMETER;
+
+      //The maximum fragment length applies to both directions
+      context->maxFragLenExtReceived = TRUE;
+   }
+   else
+   {
+      //The server may send records of any size permitted by the protocol
+      context->maxFragLenExtReceived = FALSE;
    }
 #endif
 
@@ -1296,6 +1444,74 @@ error_t tlsParseServerEmsExtension(TlsContext *context,
 }
 
 
+/**
+ * @brief Parse SessionTicket extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] sessionTicket Pointer to the SessionTicket extension
+ * @return Error code
+ **/
+
+error_t tlsParseServerSessionTicketExtension(TlsContext *context,
+   const uint8_t *sessionTicket)
+{
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //SessionTicket extension found?
+   if(sessionTicket != NULL)
+   {
+      //The server must not send the extension unless the client offered it
+      if(!context->sessionTicketEnabled)
+         return ERROR_UNSUPPORTED_EXTENSION;
+
+      //The server will send a NewSessionTicket message before its
+      //ChangeCipherSpec message
+      context->sessionTicketNegotiated = TRUE;
+   }
+   else
+   {
+      //The server does not issue a new ticket
+      context->sessionTicketNegotiated = FALSE;
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse StatusRequest extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] statusRequest Pointer to the StatusRequest extension
+ * @return Error code
+ **/
+
+error_t tlsParseServerStatusRequestExtension(TlsContext *context,
+   const uint8_t *statusRequest)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //StatusRequest extension found?
+   if(statusRequest != NULL)
+   {
+      //The server must not send the extension unless the client offered it
+      if(!context->ocspStaplingEnabled)
+         return ERROR_UNSUPPORTED_EXTENSION;
+
+      //The server may send a CertificateStatus message immediately after
+      //its Certificate message (refer to RFC 6066, section 8)
+      context->certStatusNegotiated = TRUE;
+   }
+   else
+   {
+      //The server does not staple the status of its certificate
+      context->certStatusNegotiated = FALSE;
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Parse RenegotiationInfo extension
  * @param[in] context Pointer to the TLS context
@@ -49,6 +49,9 @@ error_t tlsFormatClientSniExtension(TlsContext *context,
 error_t tlsFormatClientMaxFragLenExtension(TlsContext *context,
    uint8_t *p, size_t *written);
 
+error_t tlsFormatClientCertCompressionExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
 error_t tlsFormatClientRecordSizeLimitExtension(TlsContext *context,
    uint8_t *p, size_t *written);
 
@@ -70,6 +73,12 @@ error_t tlsFormatServerCertTypeListExtension(TlsContext *context,
 error_t tlsFormatClientEmsExtension(TlsContext *context,
    uint8_t *p, size_t *written);
 
+error_t tlsFormatClientSessionTicketExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
+error_t tlsFormatClientStatusRequestExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
 error_t tlsFormatClientRenegoInfoExtension(TlsContext *context,
    uint8_t *p, size_t *written);
 
@@ -100,6 +109,12 @@ error_t tlsParseServerCertTypeExtension(TlsContext *context,
 error_t tlsParseServerEmsExtension(TlsContext *context,
    const uint8_t *extendedMasterSecret);
 
+error_t tlsParseServerSessionTicketExtension(TlsContext *context,
+   const uint8_t *sessionTicket);
+
+error_t tlsParseServerStatusRequestExtension(TlsContext *context,
+   const uint8_t *statusRequest);
+
 error_t tlsParseServerRenegoInfoExtension(TlsContext *context,
    const TlsHelloExtensions *extensions);
 
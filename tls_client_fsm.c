@@ -36,9 +36,12 @@
 #include "tls_handshake.h"
 #include "tls_client.h"
 #include "tls_client_fsm.h"
+#include "tls_client_misc.h"
 #include "tls_common.h"
+#include "tls_cert_compression.h"
 #include "tls_record.h"
 #include "tls_misc.h"
+#include "tls_session_store.h"
 #include "tls13_client.h"
 #include "tls13_client_misc.h"
 #include "tls13_common.h"
@@ -58,10 +61,15 @@
 error_t tlsPerformClientHandshake(TlsContext *context)
 {
    error_t error;
+   bool_t falseStart;
 
    //Initialize status code
    error = NO_ERROR;
 
+   //When the handshake is resumed after a False Start, the server's final
+   //flight must be received before returning
+   falseStart = tlsIsFalseStartState(context);
+
    //Wait for the handshake to complete
    while(!error)
    {
@@ -80,6 +88,11 @@ error_t tlsPerformClientHandshake(TlsContext *context)
          }
       }
 
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+      //Report state transitions to the trace callback
+      tlsTraceStateChange(context);
+#endif
+
       //Check whether the handshake is complete
       if(context->state == TLS_STATE_APPLICATION_DATA)
       {
@@ -88,6 +101,11 @@ error_t tlsPerformClientHandshake(TlsContext *context)
          break;
       }
 
+      //The client flight is out and application data can be sent without
+      //waiting for the server's Finished message (refer to RFC 7918)
+      if(!falseStart && tlsIsFalseStartState(context))
+         break;
+
       //The TLS handshake is implemented as a state machine representing the
       //current location in the protocol
       switch(context->state)
@@ -138,6 +156,12 @@ error_t tlsPerformClientHandshake(TlsContext *context)
          //message to verify that the key exchange and authentication processes
          //were successful
          error = tlsSendFinished(context);
+
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+         //Check whether the client may send application data right behind
+         //its Finished message
+         context->falseStarted = !error && tlsIsFalseStartAllowed(context);
+#endif
          break;
 
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
@@ -192,10 +216,12 @@ error_t tlsPerformClientHandshake(TlsContext *context)
       case TLS_STATE_SERVER_HELLO_3:
       case TLS_STATE_ENCRYPTED_EXTENSIONS:
       case TLS_STATE_SERVER_CERTIFICATE:
+      case TLS_STATE_SERVER_CERTIFICATE_STATUS:
       case TLS_STATE_SERVER_KEY_EXCHANGE:
       case TLS_STATE_SERVER_CERTIFICATE_VERIFY:
       case TLS_STATE_CERTIFICATE_REQUEST:
       case TLS_STATE_SERVER_HELLO_DONE:
+      case TLS_STATE_NEW_SESSION_TICKET:
       case TLS_STATE_SERVER_CHANGE_CIPHER_SPEC:
       case TLS_STATE_SERVER_FINISHED:
          //Receive server's message
@@ -224,8 +250,29 @@ error_t tlsPerformClientHandshake(TlsContext *context)
       }
    }
 
-   //Any error to report?
-   if(error)
+   //Successful TLS handshake?
+   if(!error)
+   {
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+      //Version of TLS prior to TLS 1.3? The session is only saved once the
+      //server's Finished message has been verified
+      if(context->version <= TLS_VERSION_1_2 &&
+         context->state == TLS_STATE_APPLICATION_DATA)
+      {
+         //Save current session in the session store for further reuse
+         tlsSaveToSessionStore(context);
+      }
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //TLS 1.3 currently selected?
+      if(context->version == TLS_VERSION_1_3)
+      {
+         //Remember the group selected by the server for the next ClientHello
+         tlsSaveGroupHint(context);
+      }
+#endif
+   }
+   else
    {
       //Send an alert message to the server, if applicable
       tlsProcessError(context, error);
@@ -250,6 +297,18 @@ error_t tlsParseServerHandshakeMessage(TlsContext *context, uint8_t msgType,
 {
    error_t error;
 
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //The server may omit the CertificateStatus message even though it sent
+   //a StatusRequest extension in its ServerHello
+   if(context->state == TLS_STATE_SERVER_CERTIFICATE_STATUS &&
+      msgType != TLS_TYPE_CERTIFICATE_STATUS)
+   {
+      //Skip the CertificateStatus message
+      context->certStatusNegotiated = FALSE;
+      tlsCompleteCertificate(context);
+   }
+#endif
+
    //Check handshake message type
    switch(msgType)
    {
@@ -290,6 +349,25 @@ error_t tlsParseServerHandshakeMessage(TlsContext *context, uint8_t msgType,
       error = tlsParseCertificate(context, message, length);
       break;
 
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   //CompressedCertificate message received?
+   case TLS_TYPE_COMPRESSED_CERTIFICATE:
+      //The CompressedCertificate message replaces the Certificate message
+      //when the server compresses its certificate chain (refer to RFC 8879,
+      //section 4)
+      error = tlsParseCompressedCertificate(context, message, length);
+      break;
+#endif
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //CertificateStatus message received?
+   case TLS_TYPE_CERTIFICATE_STATUS:
+      //The server staples the OCSP response of its certificate immediately
+      //after the Certificate message
+      error = tlsParseCertificateStatus(context, message, length);
+      break;
+#endif
+
    //CertificateRequest message received?
    case TLS_TYPE_CERTIFICATE_REQUEST:
       //A non-anonymous server can optionally request a certificate from the
@@ -306,6 +384,32 @@ error_t tlsParseServerHandshakeMessage(TlsContext *context, uint8_t msgType,
       error = tlsParseFinished(context, message, length);
       break;
 
+#if ((TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3) || \
+   TLS12_TICKET_SUPPORT == ENABLED)
+   //NewSessionTicket message received?
+   case TLS_TYPE_NEW_SESSION_TICKET:
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //Version of TLS prior to TLS 1.3?
+      if(context->version <= TLS_VERSION_1_2)
+      {
+         //The server issues the ticket before its ChangeCipherSpec message
+         error = tlsParseNewSessionTicket(context, message, length);
+      }
+      else
+#endif
+      {
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+         //At any time after the server has received the client Finished
+         //message, it may send a NewSessionTicket message
+         error = tls13ParseNewSessionTicket(context, message, length);
+#else
+         //Report an error
+         error = ERROR_UNEXPECTED_MESSAGE;
+#endif
+      }
+      break;
+#endif
+
 #if (DTLS_SUPPORT == ENABLED)
    //HelloVerifyRequest message received?
    case TLS_TYPE_HELLO_VERIFY_REQUEST:
@@ -349,13 +453,6 @@ error_t tlsParseServerHandshakeMessage(TlsContext *context, uint8_t msgType,
       error = tlsParseCertificateVerify(context, message, length);
       break;
 
-   //NewSessionTicket message received?
-   case TLS_TYPE_NEW_SESSION_TICKET:
-      //At any time after the server has received the client Finished message,
-      //it may send a NewSessionTicket message
-      error = tls13ParseNewSessionTicket(context, message, length);
-      break;
-
    //KeyUpdate message received?
    case TLS_TYPE_KEY_UPDATE:
       //The KeyUpdate handshake message is used to indicate that the server
@@ -34,6 +34,7 @@
 //Dependencies
 #include <string.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_cipher_suites.h"
 #include "tls_client.h"
 #include "tls_client_misc.h"
@@ -42,6 +43,7 @@
 #include "tls_signature.h"
 #include "tls_cache.h"
 #include "tls_ffdhe.h"
+#include "tls_key_pool.h"
 #include "tls_record.h"
 #include "tls_misc.h"
 #include "debug.h"
@@ -381,14 +383,14 @@ error_t tlsFormatClientKeyParams(TlsContext *context, uint8_t *p,
 
       //If RSA is being used for key agreement and authentication, the
       //client generates a 48-byte premaster secret
-      context->premasterSecretLen = 48;
+      context->handshake->premasterSecretLen = 48;
 
       //The first 2 bytes code the latest version supported by the client
-      STORE16BE(context->clientVersion, context->premasterSecret);
+      STORE16BE(context->clientVersion, context->handshake->premasterSecret);
 
       //The last 46 bytes contain securely-generated random bytes
       error = context->prngAlgo->read(context->prngContext,
-         context->premasterSecret + 2, 46);
+         context->handshake->premasterSecret + 2, 46);
       //Any error to report?
       if(error)
          return error;
@@ -398,8 +400,10 @@ error_t tlsFormatClientKeyParams(TlsContext *context, uint8_t *p,
       if(context->version > SSL_VERSION_3_0)
       {
          //Encrypt the premaster secret using the server public key
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
          error = rsaesPkcs1v15Encrypt(context->prngAlgo, context->prngContext,
-            &context->peerRsaPublicKey, context->premasterSecret, 48, p + 2, &n);
+            &context->peerRsaPublicKey, context->handshake->premasterSecret, 48,
+            p + 2, &n);
          //RSA encryption failed?
          if(error)
             return error;
@@ -413,8 +417,10 @@ error_t tlsFormatClientKeyParams(TlsContext *context, uint8_t *p,
       else
       {
          //Encrypt the premaster secret using the server public key
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
          error = rsaesPkcs1v15Encrypt(context->prngAlgo, context->prngContext,
-            &context->peerRsaPublicKey, context->premasterSecret, 48, p, &n);
+            &context->peerRsaPublicKey, context->handshake->premasterSecret, 48,
+            p, &n);
          //RSA encryption failed?
          if(error)
             return error;
@@ -434,6 +440,7 @@ error_t tlsFormatClientKeyParams(TlsContext *context, uint8_t *p,
       context->keyExchMethod == TLS_KEY_EXCH_DHE_PSK)
    {
       //Generate an ephemeral key pair
+      TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
       error = dhGenerateKeyPair(&context->dhContext,
          context->prngAlgo, context->prngContext);
       //Any error to report?
@@ -450,18 +457,19 @@ error_t tlsFormatClientKeyParams(TlsContext *context, uint8_t *p,
       *written = n;
 
       //Calculate the negotiated key Z
+      TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
       error = dhComputeSharedSecret(&context->dhContext,
-         context->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
-         &context->premasterSecretLen);
+         context->handshake->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
+         &context->handshake->premasterSecretLen);
       //Any error to report?
       if(error)
          return error;
 
       //Leading bytes of Z that contain all zero bits are stripped before
       //it is used as the premaster secret (RFC 4346, section 8.2.1)
-      for(n = 0; n < context->premasterSecretLen; n++)
+      for(n = 0; n < context->handshake->premasterSecretLen; n++)
       {
-         if(context->premasterSecret[n] != 0x00)
+         if(context->handshake->premasterSecret[n] != 0x00)
             break;
       }
 
@@ -469,11 +477,12 @@ error_t tlsFormatClientKeyParams(TlsContext *context, uint8_t *p,
       if(n > 0)
       {
          //Strip leading zero bytes from the negotiated key
-         memmove(context->premasterSecret, context->premasterSecret + n,
-            context->premasterSecretLen - n);
+         memmove(context->handshake->premasterSecret,
+            context->handshake->premasterSecret + n,
+            context->handshake->premasterSecretLen - n);
 
          //Adjust the length of the premaster secret
-         context->premasterSecretLen -= n;
+         context->handshake->premasterSecretLen -= n;
       }
    }
    else
@@ -503,17 +512,31 @@ error_t tlsFormatClientKeyParams(TlsContext *context, uint8_t *p,
       //Check status code
       if(error == ERROR_UNSUPPORTED_ELLIPTIC_CURVE)
       {
-         //Generate an ephemeral key pair
-         error = ecdhGenerateKeyPair(&context->ecdhContext,
-            context->prngAlgo, context->prngContext);
+         //Take a pre-generated key pair from the pool, if any
+         error = tlsTakeKeyPair(context, context->namedGroup);
+
+         //No key pair available?
+         if(error == ERROR_NOT_FOUND)
+         {
+            //Generate an ephemeral key pair
+            TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_START);
+            TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+            error = ecdhGenerateKeyPair(&context->ecdhContext,
+               context->prngAlgo, context->prngContext);
+            TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_END);
+         }
+
          //Any error to report?
          if(error)
             return error;
 
          //Calculate the negotiated key Z
+         TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_START);
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
          error = ecdhComputeSharedSecret(&context->ecdhContext,
-            context->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
-            &context->premasterSecretLen);
+            context->handshake->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
+            &context->handshake->premasterSecretLen);
+         TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_END);
          //Any error to report?
          if(error)
             return error;
@@ -866,7 +889,8 @@ error_t tlsVerifyServerKeySignature(TlsContext *context,
       Sha1Context *sha1Context;
 
       //Allocate a memory buffer to hold the MD5 context
-      md5Context = tlsAllocMem(sizeof(Md5Context));
+      md5Context = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         sizeof(Md5Context));
 
       //Successful memory allocation?
       if(md5Context != NULL)
@@ -880,7 +904,8 @@ error_t tlsVerifyServerKeySignature(TlsContext *context,
          md5Final(md5Context, context->serverVerifyData);
 
          //Release previously allocated memory
-         tlsFreeMem(md5Context);
+         tlsFreeHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, md5Context);
       }
       else
       {
@@ -892,7 +917,8 @@ error_t tlsVerifyServerKeySignature(TlsContext *context,
       if(!error)
       {
          //Allocate a memory buffer to hold the SHA-1 context
-         sha1Context = tlsAllocMem(sizeof(Sha1Context));
+         sha1Context = tlsAllocHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, sizeof(Sha1Context));
 
          //Successful memory allocation?
          if(sha1Context != NULL)
@@ -906,7 +932,8 @@ error_t tlsVerifyServerKeySignature(TlsContext *context,
             sha1Final(sha1Context, context->serverVerifyData + MD5_DIGEST_SIZE);
 
             //Release previously allocated memory
-            tlsFreeMem(sha1Context);
+            tlsFreeHandshakeObject(context,
+               TLS_MEM_CLASS_HASH_CONTEXT, sha1Context);
          }
          else
          {
@@ -932,7 +959,8 @@ error_t tlsVerifyServerKeySignature(TlsContext *context,
       Sha1Context *sha1Context;
 
       //Allocate a memory buffer to hold the SHA-1 context
-      sha1Context = tlsAllocMem(sizeof(Sha1Context));
+      sha1Context = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         sizeof(Sha1Context));
 
       //Successful memory allocation?
       if(sha1Context != NULL)
@@ -946,7 +974,8 @@ error_t tlsVerifyServerKeySignature(TlsContext *context,
          sha1Final(sha1Context, context->serverVerifyData);
 
          //Release previously allocated memory
-         tlsFreeMem(sha1Context);
+         tlsFreeHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, sha1Context);
       }
       else
       {
@@ -971,7 +1000,8 @@ error_t tlsVerifyServerKeySignature(TlsContext *context,
       Sha1Context *sha1Context;
 
       //Allocate a memory buffer to hold the SHA-1 context
-      sha1Context = tlsAllocMem(sizeof(Sha1Context));
+      sha1Context = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         sizeof(Sha1Context));
 
       //Successful memory allocation?
       if(sha1Context != NULL)
@@ -985,7 +1015,8 @@ error_t tlsVerifyServerKeySignature(TlsContext *context,
          sha1Final(sha1Context, context->serverVerifyData);
 
          //Release previously allocated memory
-         tlsFreeMem(sha1Context);
+         tlsFreeHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, sha1Context);
       }
 
       //Check status code
@@ -1097,7 +1128,8 @@ error_t tls12VerifyServerKeySignature(TlsContext *context,
       if(hashAlgo != NULL)
       {
          //Allocate a memory buffer to hold the hash context
-         hashContext = tlsAllocMem(hashAlgo->contextSize);
+         hashContext = tlsAllocHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, hashAlgo->contextSize);
 
          //Successful memory allocation?
          if(hashContext != NULL)
@@ -1197,7 +1229,8 @@ error_t tls12VerifyServerKeySignature(TlsContext *context,
             }
 
             //Release previously allocated memory
-            tlsFreeMem(hashContext);
+            tlsFreeHandshakeObject(context,
+               TLS_MEM_CLASS_HASH_CONTEXT, hashContext);
          }
          else
          {
@@ -1504,4 +1537,73 @@ error_t tlsResumeClientSession(TlsContext *context, const uint8_t *sessionId,
    return error;
 }
 
+
+
+/**
+ * @brief Check whether False Start can be used for the current handshake
+ *
+ * False Start is restricted to full TLS 1.2 handshakes that use an
+ * authenticated, forward-secret key exchange, an AEAD cipher and a group of
+ * sufficient size (refer to RFC 7918, section 4)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if the client may send application data right behind its
+ *   Finished message, else FALSE
+ **/
+
+bool_t tlsIsFalseStartAllowed(TlsContext *context)
+{
+   bool_t res;
+
+   //Initialize flag
+   res = FALSE;
+
+#if (TLS_FALSE_START_SUPPORT == ENABLED && \
+   TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //False Start enabled for a full TLS 1.2 handshake over a stream transport?
+   if(context->falseStartEnabled && !context->resume &&
+      context->version == TLS_VERSION_1_2 &&
+      context->transportProtocol == TLS_TRANSPORT_PROTOCOL_STREAM)
+   {
+      uint_t n;
+
+      //The cipher must be an AEAD cipher
+      if(context->cipherSuite.cipherMode == CIPHER_MODE_GCM ||
+         context->cipherSuite.cipherMode == CIPHER_MODE_CCM ||
+         context->cipherSuite.cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+      {
+#if (TLS_DH_SUPPORT == ENABLED)
+         //Authenticated DHE key exchange?
+         if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
+            context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS)
+         {
+            //Retrieve the length of the prime modulus
+            n = mpiGetBitLength(&context->dhContext.params.p);
+
+            //Small DH groups are not acceptable
+            if(n >= TLS_FALSE_START_MIN_DH_MODULUS_SIZE)
+               res = TRUE;
+         }
+#endif
+#if (TLS_ECDH_SUPPORT == ENABLED)
+         //Authenticated ECDHE key exchange?
+         if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
+            context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+         {
+            //Retrieve the size of the underlying field
+            n = mpiGetBitLength(&context->ecdhContext.params.p);
+
+            //Small elliptic curves are not acceptable
+            if(n >= TLS_FALSE_START_MIN_EC_FIELD_SIZE)
+               res = TRUE;
+         }
+#endif
+      }
+   }
+#endif
+
+   //Return TRUE if False Start can be used
+   return res;
+}
+
 #endif
@@ -77,6 +77,8 @@ error_t tlsSelectClientVersion(TlsContext *context,
 error_t tlsResumeClientSession(TlsContext *context, const uint8_t *sessionId,
    size_t sessionIdLen, uint16_t cipherSuite);
 
+bool_t tlsIsFalseStartAllowed(TlsContext *context);
+
 //C++ guard
 #ifdef __cplusplus
 }
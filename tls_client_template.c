@@ -0,0 +1,281 @@
+/**
+ * @file tls_client_template.c
+ * @brief Pre-encoded ClientHello templates
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_client_template.h"
+#include "tls13_client_extensions.h"
+#include "tls13_misc.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CLIENT_SUPPORT == ENABLED && \
+   TLS_CLIENT_HELLO_TEMPLATE_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Check whether the ClientHello message can be built from a template
+ *
+ * Only the initial ClientHello of a fresh TLS connection is eligible. A
+ * ClientHello that resumes a session, answers a HelloRetryRequest or starts
+ * a renegotiation is always formatted from scratch
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if template mode applies, else FALSE
+ **/
+
+bool_t tlsIsClientHelloTemplateUsable(TlsContext *context)
+{
+   //Template mode must be enabled on the shared configuration
+   if(context->config == NULL || !context->config->clientHelloTemplateEnabled)
+      return FALSE;
+
+   //DTLS ClientHello messages carry a cookie
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+      return FALSE;
+
+   //Updated ClientHello messages carry a cookie and a fresh key share
+   if(context->state != TLS_STATE_CLIENT_HELLO)
+      return FALSE;
+
+#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+   //The RenegotiationInfo extension is not empty when renegotiating
+   if(context->clientVerifyDataLen != 0)
+      return FALSE;
+#endif
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //The SessionTicket extension carries the ticket of the session
+   if(context->sessionTicketLen > 0)
+      return FALSE;
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //The PreSharedKey and EarlyData extensions are specific to the connection
+   if(tls13IsPskValid(context) || tls13IsTicketValid(context))
+      return FALSE;
+#endif
+
+   //The ClientHello message can be built from a template
+   return TRUE;
+}
+
+
+/**
+ * @brief Build a ClientHello message from the template of the configuration
+ * @param[in] context Pointer to the TLS context
+ * @param[out] message Buffer where to format the ClientHello message
+ * @param[out] length Length of the resulting ClientHello message
+ * @return NO_ERROR if the template has been used, ERROR_NOT_FOUND if no
+ *   matching template is available, or another error code
+ **/
+
+error_t tlsApplyClientHelloTemplate(TlsContext *context,
+   TlsClientHello *message, size_t *length)
+{
+   error_t error;
+   size_t n;
+   TlsConfig *config;
+   TlsClientHelloTemplate *clientHelloTemplate;
+
+   //Point to the shared configuration
+   config = context->config;
+
+   //Acquire exclusive access to the configuration
+   osAcquireMutex(&config->mutex);
+   //The template is immutable once it has been published
+   clientHelloTemplate = config->clientHelloTemplate;
+   //Release exclusive access to the configuration
+   osReleaseMutex(&config->mutex);
+
+   //No template available yet?
+   if(clientHelloTemplate == NULL)
+      return ERROR_NOT_FOUND;
+
+   //The session ID is patched in place, so its length cannot change
+   if(context->sessionIdLen != clientHelloTemplate->sessionIdLen)
+      return ERROR_NOT_FOUND;
+
+   //The ServerName extension is part of the template
+   if(context->serverName != NULL && clientHelloTemplate->serverName != NULL)
+   {
+      if(strcmp(context->serverName, clientHelloTemplate->serverName))
+         return ERROR_NOT_FOUND;
+   }
+   else if(context->serverName != NULL || clientHelloTemplate->serverName != NULL)
+   {
+      return ERROR_NOT_FOUND;
+   }
+
+   //The key share must use the same named group
+   if(clientHelloTemplate->keyShareLen > 0 &&
+      context->namedGroup != clientHelloTemplate->namedGroup)
+   {
+      return ERROR_NOT_FOUND;
+   }
+
+   //Copy the pre-encoded message
+   memcpy(message, clientHelloTemplate->data, clientHelloTemplate->length);
+
+   //Patch the client random value
+   memcpy(message->random, context->clientRandom, 32);
+   //Patch the session ID
+   memcpy(message->sessionId, context->sessionId, context->sessionIdLen);
+
+   //Any key share to patch?
+   if(clientHelloTemplate->keyShareLen > 0)
+   {
+      //Format the KeyShare extension over the pre-encoded one
+      error = tls13FormatClientKeyShareExtension(context, (uint8_t *) message +
+         clientHelloTemplate->keyShareOffset, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //The length of the key share is fixed for a given group
+      if(n != clientHelloTemplate->keyShareLen)
+         return ERROR_NOT_FOUND;
+   }
+
+   //Length of the ClientHello message
+   *length = clientHelloTemplate->length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Save a ClientHello message as the template of the configuration
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message ClientHello message formatted from scratch
+ * @param[in] length Length of the ClientHello message
+ * @param[in] keyShareOffset Offset of the KeyShare extension
+ * @param[in] keyShareLen Length of the KeyShare extension (0 if none)
+ * @return Error code
+ **/
+
+error_t tlsSaveClientHelloTemplate(TlsContext *context,
+   const TlsClientHello *message, size_t length, size_t keyShareOffset,
+   size_t keyShareLen)
+{
+   size_t n;
+   bool_t saved;
+   TlsConfig *config;
+   TlsClientHelloTemplate *clientHelloTemplate;
+
+   //Point to the shared configuration
+   config = context->config;
+
+   //Acquire exclusive access to the configuration
+   osAcquireMutex(&config->mutex);
+   //Check whether a template has already been saved
+   saved = (config->clientHelloTemplate != NULL);
+   //Release exclusive access to the configuration
+   osReleaseMutex(&config->mutex);
+
+   //Nothing to do if a template is already available
+   if(saved)
+      return NO_ERROR;
+
+   //Length of the server name, including the terminating NULL character
+   n = (context->serverName != NULL) ? strlen(context->serverName) + 1 : 0;
+
+   //The message and the server name are stored in the same memory block
+   clientHelloTemplate = tlsAllocMem(sizeof(TlsClientHelloTemplate) +
+      length + n);
+   //Failed to allocate memory?
+   if(clientHelloTemplate == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Save the variable fields
+   clientHelloTemplate->length = length;
+   clientHelloTemplate->sessionIdLen = context->sessionIdLen;
+   clientHelloTemplate->keyShareOffset = keyShareOffset;
+   clientHelloTemplate->keyShareLen = keyShareLen;
+   clientHelloTemplate->namedGroup = context->namedGroup;
+
+   //Copy the encoded message
+   clientHelloTemplate->data = (uint8_t *) (clientHelloTemplate + 1);
+   memcpy(clientHelloTemplate->data, message, length);
+
+   //Copy the server name
+   if(context->serverName != NULL)
+   {
+      clientHelloTemplate->serverName = (char_t *) clientHelloTemplate->data +
+         length;
+      strcpy(clientHelloTemplate->serverName, context->serverName);
+   }
+   else
+   {
+      clientHelloTemplate->serverName = NULL;
+   }
+
+   //Acquire exclusive access to the configuration
+   osAcquireMutex(&config->mutex);
+
+   //Another TLS context may have published a template in the meantime
+   if(config->clientHelloTemplate == NULL)
+   {
+      config->clientHelloTemplate = clientHelloTemplate;
+      clientHelloTemplate = NULL;
+   }
+
+   //Release exclusive access to the configuration
+   osReleaseMutex(&config->mutex);
+
+   //Discard the template if it has not been published
+   tlsFreeClientHelloTemplate(clientHelloTemplate);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release a ClientHello template
+ * @param[in] clientHelloTemplate Pointer to the ClientHello template
+ **/
+
+void tlsFreeClientHelloTemplate(TlsClientHelloTemplate *clientHelloTemplate)
+{
+   //Valid template?
+   if(clientHelloTemplate != NULL)
+   {
+      tlsFreeMem(clientHelloTemplate);
+   }
+}
+
+#endif
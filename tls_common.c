@@ -40,11 +40,14 @@
 #include "tls_server.h"
 #include "tls_common.h"
 #include "tls_certificate.h"
+#include "tls_cert_compression.h"
 #include "tls_signature.h"
 #include "tls_transcript_hash.h"
 #include "tls_cache.h"
 #include "tls_record.h"
+#include "tls_buffer.h"
 #include "tls_misc.h"
+#include "tls_stats.h"
 #include "dtls_record.h"
 #include "pkix/x509_common.h"
 #include "debug.h"
@@ -116,19 +119,31 @@ error_t tlsSendCertificate(TlsContext *context)
       //key exchange method uses certificates for authentication
       if(context->cert != NULL)
       {
+         TlsMessageType type;
+
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+         //The Certificate message may be replaced by a CompressedCertificate
+         //message if the client supports certificate compression
+         error = tlsFormatCompressedCertificate(context, (uint8_t *) message,
+            &length, &type);
+#else
          //Format Certificate message
          error = tlsFormatCertificate(context, message, &length);
+         //Type of the message
+         type = TLS_TYPE_CERTIFICATE;
+#endif
 
          //Check status code
          if(!error)
          {
             //Debug message
-            TRACE_INFO("Sending Certificate message (%" PRIuSIZE " bytes)...\r\n", length);
+            TRACE_INFO("Sending %s message (%" PRIuSIZE " bytes)...\r\n",
+               (type == TLS_TYPE_CERTIFICATE) ? "Certificate" :
+               "CompressedCertificate", length);
             TRACE_DEBUG_ARRAY("  ", message, length);
 
             //Send handshake message
-            error = tlsSendHandshakeMessage(context, message, length,
-               TLS_TYPE_CERTIFICATE);
+            error = tlsSendHandshakeMessage(context, message, length, type);
          }
       }
    }
@@ -148,9 +163,21 @@ error_t tlsSendCertificate(TlsContext *context)
       {
          //Check whether TLS operates as a client or a server
          if(context->entity == TLS_CONNECTION_END_CLIENT)
+         {
             context->state = TLS_STATE_CLIENT_KEY_EXCHANGE;
+         }
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+         else if(context->certStatusNegotiated)
+         {
+            //The CertificateStatus message immediately follows the
+            //Certificate message
+            context->state = TLS_STATE_SERVER_CERTIFICATE_STATUS;
+         }
+#endif
          else
+         {
             context->state = TLS_STATE_SERVER_KEY_EXCHANGE;
+         }
       }
       else
       {
@@ -230,6 +257,12 @@ error_t tlsSendCertificateVerify(TlsContext *context)
       }
    }
 
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   //The handshake remains in the current state until the signature is posted
+   if(context->asyncSignState == TLS_ASYNC_SIGN_STATE_PENDING)
+      return ERROR_WOULD_BLOCK;
+#endif
+
    //Check status code
    if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
    {
@@ -436,6 +469,10 @@ error_t tlsSendFinished(TlsContext *context)
             //Abbreviated or full handshake?
             if(context->resume)
                context->state = TLS_STATE_APPLICATION_DATA;
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+            else if(context->sessionTicketNegotiated)
+               context->state = TLS_STATE_NEW_SESSION_TICKET;
+#endif
             else
                context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
          }
@@ -483,6 +520,12 @@ error_t tlsSendAlert(TlsContext *context, uint8_t level, uint8_t description)
    size_t length;
    TlsAlert *message;
 
+   //The TX buffer may have been released while the connection was idle
+   error = tlsAcquireTxBuffer(context);
+   //Any error to report?
+   if(error)
+      return error;
+
    //Point to the buffer where to format the message
    message = (TlsAlert *) (context->txBuffer + context->txBufferLen);
 
@@ -512,6 +555,9 @@ error_t tlsSendAlert(TlsContext *context, uint8_t level, uint8_t description)
          error = tlsWriteProtocolData(context, (uint8_t *) message,
             length, TLS_TYPE_ALERT);
       }
+
+      //Update statistics
+      TLS_GLOBAL_STATS_INC(context, alertsSent[description]);
    }
 
    //Alert messages convey the severity of the message
@@ -660,6 +706,9 @@ error_t tlsFormatCertificateVerify(TlsContext *context,
    //Length of the handshake message
    *length = 0;
 
+   //Signature generation is about to start
+   TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_SIGN_START);
+
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_1)
    //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
    if(context->version <= TLS_VERSION_1_1)
@@ -698,6 +747,9 @@ error_t tlsFormatCertificateVerify(TlsContext *context,
       error = ERROR_INVALID_VERSION;
    }
 
+   //Signature generation is complete
+   TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_SIGN_END);
+
    //Return status code
    return error;
 }
@@ -1240,32 +1292,11 @@ error_t tlsParseCertificate(TlsContext *context,
    TRACE_INFO("Certificate message received (%" PRIuSIZE " bytes)...\r\n", length);
    TRACE_DEBUG_ARRAY("  ", message, length);
 
-   //Check whether TLS operates as a client or a server
-   if(context->entity == TLS_CONNECTION_END_CLIENT)
-   {
-      //Version of TLS prior to TLS 1.3?
-      if(context->version <= TLS_VERSION_1_2)
-      {
-         //Check current state
-         if(context->state != TLS_STATE_SERVER_CERTIFICATE)
-            return ERROR_UNEXPECTED_MESSAGE;
-      }
-      else
-      {
-         //The CertificateRequest message is optional
-         if(context->state != TLS_STATE_CERTIFICATE_REQUEST &&
-            context->state != TLS_STATE_SERVER_CERTIFICATE)
-         {
-            return ERROR_UNEXPECTED_MESSAGE;
-         }
-      }
-   }
-   else
-   {
-      //Check current state
-      if(context->state != TLS_STATE_CLIENT_CERTIFICATE)
-         return ERROR_UNEXPECTED_MESSAGE;
-   }
+   //Check current state
+   error = tlsCheckCertificateState(context);
+   //Any error to report?
+   if(error)
+      return error;
 
    //Point to the beginning of the handshake message
    p = message;
@@ -1321,94 +1352,122 @@ error_t tlsParseCertificate(TlsContext *context,
       else
 #endif
       {
+         //Certificate chain parsing and validation is about to start
+         TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_CERT_PARSING_START);
+
          //Parse the certificate chain
          error = tlsParseCertificateList(context, certificateList->value, n);
+
+         //Certificate chain parsing and validation is complete
+         TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_CERT_PARSING_END);
       }
    }
    else
    {
-#if (TLS_SERVER_SUPPORT == ENABLED)
-      //Server mode?
-      if(context->entity == TLS_CONNECTION_END_SERVER)
-      {
-         //Check whether client authentication is required
-         if(context->clientAuthMode == TLS_CLIENT_AUTH_REQUIRED)
-         {
-            //Version of TLS prior to TLS 1.3?
-            if(context->version <= TLS_VERSION_1_2)
-            {
-               //If the client does not send any certificates, the server
-               //responds with a fatal handshake_failure alert (refer to
-               //RFC 5246, section 7.4.6)
-               error = ERROR_HANDSHAKE_FAILED;
-            }
-            else
-            {
-               //If the client does not send any certificates, the server
-               //aborts the handshake with a certificate_required alert (refer
-               //to RFC 8446, section 4.4.2.4)
-               error = ERROR_CERTIFICATE_REQUIRED;
-            }
-         }
-         else
-         {
-            //The client did not send any certificates
-            context->peerCertType = TLS_CERT_NONE;
-            //The server may continue the handshake without client authentication
-            error = NO_ERROR;
-         }
-      }
-      else
-#endif
-      //Client mode?
-      {
-         //The server's certificate list must always be non-empty (refer to
-         //RFC 8446, section 4.4.2)
-         error = ERROR_DECODING_FAILED;
-      }
+      //The peer did not send any certificates
+      error = tlsParseEmptyCertificateList(context);
    }
 
    //Check status code
    if(!error)
+   {
+      //Update the state of the handshake
+      tlsCompleteCertificate(context);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check whether a Certificate message is expected in the current state
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsCheckCertificateState(TlsContext *context)
+{
+   //Check whether TLS operates as a client or a server
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
    {
       //Version of TLS prior to TLS 1.3?
       if(context->version <= TLS_VERSION_1_2)
       {
-         //Check whether TLS operates as a client or a server
-         if(context->entity == TLS_CONNECTION_END_CLIENT)
-         {
-            //The server does not send a ServerKeyExchange message when RSA
-            //key exchange method is used
-            if(context->keyExchMethod == TLS_KEY_EXCH_RSA)
-               context->state = TLS_STATE_CERTIFICATE_REQUEST;
-            else
-               context->state = TLS_STATE_SERVER_KEY_EXCHANGE;
-         }
-         else
+         //Check current state
+         if(context->state != TLS_STATE_SERVER_CERTIFICATE)
+            return ERROR_UNEXPECTED_MESSAGE;
+      }
+      else
+      {
+         //The CertificateRequest message is optional
+         if(context->state != TLS_STATE_CERTIFICATE_REQUEST &&
+            context->state != TLS_STATE_SERVER_CERTIFICATE)
          {
-            //Wait for a ClientKeyExchange message from the client
-            context->state = TLS_STATE_CLIENT_KEY_EXCHANGE;
+            return ERROR_UNEXPECTED_MESSAGE;
          }
       }
-      else
+   }
+   else
+   {
+      //Check current state
+      if(context->state != TLS_STATE_CLIENT_CERTIFICATE)
+         return ERROR_UNEXPECTED_MESSAGE;
+   }
+
+   //The Certificate message is expected
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process a Certificate message with an empty certificate list
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsParseEmptyCertificateList(TlsContext *context)
+{
+   error_t error;
+
+#if (TLS_SERVER_SUPPORT == ENABLED)
+   //Server mode?
+   if(context->entity == TLS_CONNECTION_END_SERVER)
+   {
+      //Check whether client authentication is required
+      if(context->clientAuthMode == TLS_CLIENT_AUTH_REQUIRED)
       {
-         //Check whether TLS operates as a client or a server
-         if(context->entity == TLS_CONNECTION_END_CLIENT)
+         //Version of TLS prior to TLS 1.3?
+         if(context->version <= TLS_VERSION_1_2)
          {
-            //The server must send a CertificateVerify message immediately
-            //after the Certificate message
-            context->state = TLS_STATE_SERVER_CERTIFICATE_VERIFY;
+            //If the client does not send any certificates, the server
+            //responds with a fatal handshake_failure alert (refer to
+            //RFC 5246, section 7.4.6)
+            error = ERROR_HANDSHAKE_FAILED;
          }
          else
          {
-            //The client must send a CertificateVerify message when the
-            //Certificate message is non-empty
-            if(context->peerCertType != TLS_CERT_NONE)
-               context->state = TLS_STATE_CLIENT_CERTIFICATE_VERIFY;
-            else
-               context->state = TLS_STATE_CLIENT_FINISHED;
+            //If the client does not send any certificates, the server
+            //aborts the handshake with a certificate_required alert (refer
+            //to RFC 8446, section 4.4.2.4)
+            error = ERROR_CERTIFICATE_REQUIRED;
          }
       }
+      else
+      {
+         //The client did not send any certificates
+         context->peerCertType = TLS_CERT_NONE;
+         //The server may continue the handshake without client authentication
+         error = NO_ERROR;
+      }
+   }
+   else
+#endif
+   //Client mode?
+   {
+      //The server's certificate list must always be non-empty (refer to
+      //RFC 8446, section 4.4.2)
+      error = ERROR_DECODING_FAILED;
    }
 
    //Return status code
@@ -1416,6 +1475,61 @@ error_t tlsParseCertificate(TlsContext *context,
 }
 
 
+/**
+ * @brief Update the state of the handshake after a valid Certificate message
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsCompleteCertificate(TlsContext *context)
+{
+   //Version of TLS prior to TLS 1.3?
+   if(context->version <= TLS_VERSION_1_2)
+   {
+      //Check whether TLS operates as a client or a server
+      if(context->entity == TLS_CONNECTION_END_CLIENT)
+      {
+         //The server does not send a ServerKeyExchange message when RSA
+         //key exchange method is used
+         if(context->keyExchMethod == TLS_KEY_EXCH_RSA)
+            context->state = TLS_STATE_CERTIFICATE_REQUEST;
+         else
+            context->state = TLS_STATE_SERVER_KEY_EXCHANGE;
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+         //The server may send a CertificateStatus message immediately after
+         //its Certificate message (refer to RFC 6066, section 8)
+         if(context->certStatusNegotiated)
+            context->state = TLS_STATE_SERVER_CERTIFICATE_STATUS;
+#endif
+      }
+      else
+      {
+         //Wait for a ClientKeyExchange message from the client
+         context->state = TLS_STATE_CLIENT_KEY_EXCHANGE;
+      }
+   }
+   else
+   {
+      //Check whether TLS operates as a client or a server
+      if(context->entity == TLS_CONNECTION_END_CLIENT)
+      {
+         //The server must send a CertificateVerify message immediately
+         //after the Certificate message
+         context->state = TLS_STATE_SERVER_CERTIFICATE_VERIFY;
+      }
+      else
+      {
+         //The client must send a CertificateVerify message when the
+         //Certificate message is non-empty
+         if(context->peerCertType != TLS_CERT_NONE)
+            context->state = TLS_STATE_CLIENT_CERTIFICATE_VERIFY;
+         else
+            context->state = TLS_STATE_CLIENT_FINISHED;
+      }
+   }
+}
+
+
 /**
  * @brief Parse CertificateVerify message
  *
@@ -1452,6 +1566,9 @@ error_t tlsParseCertificateVerify(TlsContext *context,
          return ERROR_UNEXPECTED_MESSAGE;
    }
 
+   //Signature verification is about to start
+   TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_VERIFY_START);
+
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_1)
    //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
    if(context->version <= TLS_VERSION_1_1)
@@ -1490,6 +1607,9 @@ error_t tlsParseCertificateVerify(TlsContext *context,
       error = ERROR_INVALID_VERSION;
    }
 
+   //Signature verification is complete
+   TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_VERIFY_END);
+
    //Check status code
    if(!error)
    {
@@ -1737,6 +1857,10 @@ error_t tlsParseFinished(TlsContext *context,
          //Abbreviated or full handshake?
          if(context->resume)
             context->state = TLS_STATE_APPLICATION_DATA;
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+         else if(context->sessionTicketNegotiated)
+            context->state = TLS_STATE_NEW_SESSION_TICKET;
+#endif
          else
             context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
       }
@@ -1784,6 +1908,9 @@ error_t tlsParseAlert(TlsContext *context,
    TRACE_DEBUG("  Level = %" PRIu8 "\r\n", message->level);
    TRACE_DEBUG("  Description = %" PRIu8 "\r\n", message->description);
 
+   //Update statistics
+   TLS_GLOBAL_STATS_INC(context, alertsReceived[message->description]);
+
    //Alert messages convey the severity of the message
    if(message->level == TLS_ALERT_LEVEL_WARNING)
    {
@@ -70,6 +70,10 @@ error_t tlsFormatSignatureAlgorithmsCertExtension(TlsContext *context,
 error_t tlsParseCertificate(TlsContext *context,
    const TlsCertificate *message, size_t length);
 
+error_t tlsCheckCertificateState(TlsContext *context);
+error_t tlsParseEmptyCertificateList(TlsContext *context);
+void tlsCompleteCertificate(TlsContext *context);
+
 error_t tlsParseCertificateVerify(TlsContext *context,
    const TlsCertificateVerify *message, size_t length);
 
@@ -0,0 +1,846 @@
+/**
+ * @file tls_connection_state.c
+ * @brief Export and import of an established connection
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_connection_state.h"
+#include "tls_handshake.h"
+#include "tls_buffer.h"
+#include "tls_misc.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CONNECTION_EXPORT_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Export the state of an established connection
+ *
+ * The negotiated parameters, the traffic keys, the current IVs and the
+ * sequence numbers of both directions are encoded as a single contiguous
+ * buffer, together with the TLS 1.3 secrets needed to process KeyUpdate
+ * and NewSessionTicket messages, the secure renegotiation verify data, the
+ * ALPN protocol and the server name. Another context, possibly in another
+ * process, can then take over the connection with tlsImportConnectionState,
+ * without a new handshake and without closing the underlying socket.
+ *
+ * The connection must be idle, i.e. no record may be partially sent or
+ * received. The buffer contains the traffic keys in the clear and must be
+ * protected accordingly. Once the state has been exported, the context
+ * must not be used to send or receive data anymore, and should be released
+ * with tlsFree without calling tlsShutdown
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] output Output buffer. If this parameter is NULL, the function
+ *   only computes the length of the encoded connection state
+ * @param[out] length Length of the encoded connection state, in bytes
+ * @return Error code
+ **/
+
+error_t tlsExportConnectionState(TlsContext *context, uint8_t *output,
+   size_t *length)
+{
+   uint8_t flags;
+   size_t n;
+   size_t clientVerifyDataLen;
+   size_t serverVerifyDataLen;
+   size_t alpnLen;
+   size_t serverNameLen;
+   uint8_t *p;
+
+   //Check parameters
+   if(context == NULL || length == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The connection must be established
+   if(context->state != TLS_STATE_APPLICATION_DATA)
+      return ERROR_WRONG_STATE;
+
+   //DTLS epochs and replay windows are not part of the exported state
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+      return ERROR_WRONG_STATE;
+
+   //The record layer of an offloaded connection belongs to the transport
+   if(context->offloaded)
+      return ERROR_WRONG_STATE;
+
+   //The connection is being closed?
+   if(context->closeNotifySent || context->closeNotifyReceived)
+      return ERROR_WRONG_STATE;
+
+   //Data buffered by the record layer would be lost
+   if(!tlsIsConnectionIdle(context))
+      return ERROR_WRONG_STATE;
+
+   //The state of a stream cipher cannot be rebuilt from the traffic keys
+   if(context->encryptionEngine.cipherMode == CIPHER_MODE_STREAM)
+      return ERROR_UNSUPPORTED_CIPHER_MODE;
+
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   //A crypto provider may keep part of the record protection state outside
+   //of the encryption engines
+   if(context->encryptionEngine.provider != NULL ||
+      context->decryptionEngine.provider != NULL)
+   {
+      return ERROR_UNSUPPORTED_CIPHER_MODE;
+   }
+#endif
+
+   //Initialize variables
+   flags = 0;
+   alpnLen = 0;
+   serverNameLen = 0;
+
+#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+   //Secure renegotiation flag
+   if(context->secureRenegoFlag)
+      flags |= TLS_CONNECTION_EXPORT_FLAG_SECURE_RENEGO;
+#endif
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   //Negotiated maximum fragment length
+   if(context->maxFragLenExtReceived)
+      flags |= TLS_CONNECTION_EXPORT_FLAG_MAX_FRAG_LEN;
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //Record size limit advertised by the peer
+   if(context->recordSizeLimitExtReceived)
+      flags |= TLS_CONNECTION_EXPORT_FLAG_RECORD_SIZE_LIMIT;
+#endif
+
+   //Verify data of the last handshake
+   clientVerifyDataLen = MIN(context->clientVerifyDataLen, 64);
+   serverVerifyDataLen = MIN(context->serverVerifyDataLen, 64);
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //Selected ALPN protocol
+   if(context->selectedProtocol != NULL)
+      alpnLen = strlen(context->selectedProtocol);
+#endif
+
+   //Server name
+   if(context->serverName != NULL)
+      serverNameLen = strlen(context->serverName);
+
+   //Check the length of the variable-length fields
+   if(alpnLen > 0xFF || serverNameLen > 0xFFFF)
+      return ERROR_INVALID_LENGTH;
+
+   //Calculate the length of the encoded connection state
+   n = TLS_CONNECTION_EXPORT_HEADER_SIZE + clientVerifyDataLen +
+      serverVerifyDataLen + alpnLen + serverNameLen;
+
+   //Encode the connection state, if requested
+   if(output != NULL)
+   {
+      //Point to the output buffer
+      p = output;
+
+      //The secrets that do not apply to the negotiated version are zeroed
+      memset(p, 0, TLS_CONNECTION_EXPORT_VARIABLE_OFFSET);
+
+      //Format version, flags and connection end
+      p[TLS_CONNECTION_EXPORT_FORMAT_OFFSET] = TLS_CONNECTION_EXPORT_FORMAT;
+      p[TLS_CONNECTION_EXPORT_FLAGS_OFFSET] = flags;
+      p[TLS_CONNECTION_EXPORT_ENTITY_OFFSET] = (uint8_t) context->entity;
+
+      //Protocol version and cipher suite
+      STORE16BE(context->version, p + TLS_CONNECTION_EXPORT_VERSION_OFFSET);
+      STORE16BE(context->cipherSuite.identifier,
+         p + TLS_CONNECTION_EXPORT_CIPHER_SUITE_OFFSET);
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+      //Negotiated maximum fragment length
+      STORE16BE(context->maxFragLen,
+         p + TLS_CONNECTION_EXPORT_MAX_FRAG_LEN_OFFSET);
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+      //Record size limit advertised by the peer
+      STORE16BE(context->recordSizeLimit,
+         p + TLS_CONNECTION_EXPORT_RECORD_SIZE_LIMIT_OFFSET);
+#endif
+
+      //State of the encryption and decryption engines
+      tlsExportEngineState(&context->encryptionEngine,
+         p + TLS_CONNECTION_EXPORT_TX_ENGINE_OFFSET);
+      tlsExportEngineState(&context->decryptionEngine,
+         p + TLS_CONNECTION_EXPORT_RX_ENGINE_OFFSET);
+
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+      //Master secret (TLS 1.2)
+      memcpy(p + TLS_CONNECTION_EXPORT_MASTER_SECRET_OFFSET,
+         context->masterSecret, TLS_MASTER_SECRET_SIZE);
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //Current application traffic secrets (TLS 1.3)
+      memcpy(p + TLS_CONNECTION_EXPORT_CLIENT_SECRET_OFFSET,
+         context->clientAppTrafficSecret, TLS_MAX_HKDF_DIGEST_SIZE);
+      memcpy(p + TLS_CONNECTION_EXPORT_SERVER_SECRET_OFFSET,
+         context->serverAppTrafficSecret, TLS_MAX_HKDF_DIGEST_SIZE);
+
+      //Exporter and resumption master secrets (TLS 1.3)
+      memcpy(p + TLS_CONNECTION_EXPORT_EXPORTER_SECRET_OFFSET,
+         context->exporterMasterSecret, TLS_MAX_HKDF_DIGEST_SIZE);
+      memcpy(p + TLS_CONNECTION_EXPORT_RESUMPTION_SECRET_OFFSET,
+         context->resumptionMasterSecret, TLS_MAX_HKDF_DIGEST_SIZE);
+#endif
+      p += TLS_CONNECTION_EXPORT_VARIABLE_OFFSET;
+
+      //Client verify data
+      p[0] = (uint8_t) clientVerifyDataLen;
+      memcpy(p + 1, context->clientVerifyData, clientVerifyDataLen);
+      p += 1 + clientVerifyDataLen;
+
+      //Server verify data
+      p[0] = (uint8_t) serverVerifyDataLen;
+      memcpy(p + 1, context->serverVerifyData, serverVerifyDataLen);
+      p += 1 + serverVerifyDataLen;
+
+      //Selected ALPN protocol
+      p[0] = (uint8_t) alpnLen;
+#if (TLS_ALPN_SUPPORT == ENABLED)
+      memcpy(p + 1, context->selectedProtocol, alpnLen);
+#endif
+      p += 1 + alpnLen;
+
+      //Server name
+      STORE16BE(serverNameLen, p);
+      memcpy(p + 2, context->serverName, serverNameLen);
+   }
+
+   //Length of the encoded connection state
+   *length = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Import the state of an established connection
+ *
+ * The context must have been initialized with the same connection end and
+ * configured with the same cipher suites as the exporting context, but no
+ * handshake must have been performed. The underlying socket is typically
+ * the one that carried the exported connection. On success, the context is
+ * in the application data phase and the next record sent or received uses
+ * the sequence number following the last record processed by the exporting
+ * context. All the fields are validated before the context is updated, so
+ * that the context is left untouched if the import fails
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] input Encoded connection state (refer to
+ *   tlsExportConnectionState)
+ * @param[in] length Length of the encoded connection state, in bytes
+ * @return Error code
+ **/
+
+error_t tlsImportConnectionState(TlsContext *context, const uint8_t *input,
+   size_t length)
+{
+   error_t error;
+   size_t n;
+   size_t clientVerifyDataLen;
+   size_t serverVerifyDataLen;
+   size_t alpnLen;
+   size_t serverNameLen;
+   uint8_t flags;
+   uint16_t version;
+   uint16_t cipherSuite;
+   uint16_t savedVersion;
+   TlsCipherSuiteInfo savedCipherSuite;
+   TlsKeyExchMethod savedKeyExchMethod;
+   TlsConnectionEnd peerEntity;
+   const uint8_t *clientVerifyData;
+   const uint8_t *serverVerifyData;
+   const uint8_t *alpn;
+   const uint8_t *serverName;
+   const uint8_t *txState;
+   const uint8_t *rxState;
+   const uint8_t *txSecret;
+   const uint8_t *rxSecret;
+   char_t *selectedProtocol;
+   char_t *serverNameCopy;
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   size_t maxFragLen;
+#endif
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   size_t recordSizeLimit;
+   size_t savedRecordSizeLimit;
+#endif
+
+   //Check parameters
+   if(context == NULL || input == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The context must not have been used yet
+   if(context->state != TLS_STATE_INIT)
+      return ERROR_WRONG_STATE;
+
+   //DTLS is not supported
+   if(context->transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM)
+      return ERROR_WRONG_STATE;
+
+   //Malformed input?
+   if(length < TLS_CONNECTION_EXPORT_HEADER_SIZE)
+      return ERROR_DECODING_FAILED;
+
+   //Unknown format version?
+   if(input[TLS_CONNECTION_EXPORT_FORMAT_OFFSET] !=
+      TLS_CONNECTION_EXPORT_FORMAT)
+      return ERROR_INVALID_VERSION;
+
+   //The state must be imported by the same end of the connection
+   if(input[TLS_CONNECTION_EXPORT_ENTITY_OFFSET] != (uint8_t) context->entity)
+      return ERROR_INVALID_PARAMETER;
+
+   //Client verify data
+   n = TLS_CONNECTION_EXPORT_VARIABLE_OFFSET;
+   clientVerifyDataLen = input[n];
+   clientVerifyData = input + n + 1;
+   n += 1 + clientVerifyDataLen;
+
+   //Malformed input?
+   if(clientVerifyDataLen > sizeof(context->clientVerifyData) ||
+      length < (n + 1))
+   {
+      return ERROR_DECODING_FAILED;
+   }
+
+   //Server verify data
+   serverVerifyDataLen = input[n];
+   serverVerifyData = input + n + 1;
+   n += 1 + serverVerifyDataLen;
+
+   //Malformed input?
+   if(serverVerifyDataLen > sizeof(context->serverVerifyData) ||
+      length < (n + 1))
+   {
+      return ERROR_DECODING_FAILED;
+   }
+
+   //Selected ALPN protocol
+   alpnLen = input[n];
+   alpn = input + n + 1;
+   n += 1 + alpnLen;
+
+   //Malformed input?
+   if(length < (n + 2))
+      return ERROR_DECODING_FAILED;
+
+   //Server name
+   serverNameLen = LOAD16BE(input + n);
+   serverName = input + n + 2;
+   n += 2 + serverNameLen;
+
+   //The length of the input must match exactly
+   if(length != n)
+      return ERROR_DECODING_FAILED;
+
+   //Decode the fixed-size fields
+   flags = input[TLS_CONNECTION_EXPORT_FLAGS_OFFSET];
+   version = LOAD16BE(input + TLS_CONNECTION_EXPORT_VERSION_OFFSET);
+   cipherSuite = LOAD16BE(input + TLS_CONNECTION_EXPORT_CIPHER_SUITE_OFFSET);
+
+   //The protocol version must be enabled on this context
+   if(version < context->versionMin || version > context->versionMax)
+      return ERROR_VERSION_NOT_SUPPORTED;
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   //Negotiated maximum fragment length
+   if((flags & TLS_CONNECTION_EXPORT_FLAG_MAX_FRAG_LEN) != 0)
+   {
+      maxFragLen = LOAD16BE(input + TLS_CONNECTION_EXPORT_MAX_FRAG_LEN_OFFSET);
+
+      //Only the values defined by RFC 6066 can be negotiated
+      if(maxFragLen != 512 && maxFragLen != 1024 &&
+         maxFragLen != 2048 && maxFragLen != 4096)
+      {
+         return ERROR_DECODING_FAILED;
+      }
+
+      //The records sent by the peer must fit in the RX buffer
+      if(maxFragLen > context->rxBufferMaxLen)
+         return ERROR_INVALID_LENGTH;
+   }
+   else
+   {
+      //No maximum fragment length has been negotiated
+      maxFragLen = context->maxFragLen;
+   }
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //Record size limit advertised by the peer
+   if((flags & TLS_CONNECTION_EXPORT_FLAG_RECORD_SIZE_LIMIT) != 0)
+   {
+      recordSizeLimit = LOAD16BE(input +
+         TLS_CONNECTION_EXPORT_RECORD_SIZE_LIMIT_OFFSET);
+
+      //The value cannot be smaller than 64 (the TLS 1.3 value excludes the
+      //content type) nor larger than the protocol-defined limit
+      if(recordSizeLimit < 63 || recordSizeLimit > TLS_MAX_RECORD_LENGTH)
+         return ERROR_DECODING_FAILED;
+   }
+   else
+   {
+      //The peer did not advertise any record size limit
+      recordSizeLimit = context->recordSizeLimit;
+   }
+#endif
+
+   //Initialize variables
+   selectedProtocol = NULL;
+   serverNameCopy = NULL;
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //Selected ALPN protocol
+   if(alpnLen > 0)
+   {
+      //Allocate a memory block to hold the ALPN protocol
+      selectedProtocol = tlsAllocMem(alpnLen + 1);
+      //Failed to allocate memory?
+      if(selectedProtocol == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Copy the ALPN protocol
+      memcpy(selectedProtocol, alpn, alpnLen);
+      selectedProtocol[alpnLen] = '\0';
+   }
+#else
+   //ALPN is not supported
+   (void) alpn;
+#endif
+
+   //Server name
+   if(serverNameLen > 0)
+   {
+      //Allocate a memory block to hold the server name
+      serverNameCopy = tlsAllocMem(serverNameLen + 1);
+
+      //Failed to allocate memory?
+      if(serverNameCopy == NULL)
+      {
+         //Clean up side effects
+         if(selectedProtocol != NULL)
+            tlsFreeMem(selectedProtocol);
+
+         //Report an error
+         return ERROR_OUT_OF_MEMORY;
+      }
+
+      //Copy the server name
+      memcpy(serverNameCopy, serverName, serverNameLen);
+      serverNameCopy[serverNameLen] = '\0';
+   }
+
+   //Save the parameters that are updated while the traffic keys are
+   //derived, so that they can be restored on failure
+   savedVersion = context->version;
+   savedCipherSuite = context->cipherSuite;
+   savedKeyExchMethod = context->keyExchMethod;
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   savedRecordSizeLimit = context->recordSizeLimit;
+#endif
+
+   //Restore the negotiated protocol version
+   context->version = version;
+
+   //Restore the negotiated cipher suite
+   error = tlsSelectCipherSuite(context, cipherSuite);
+
+   //Stream ciphers are not supported
+   if(!error && context->cipherSuite.cipherMode == CIPHER_MODE_STREAM)
+      error = ERROR_UNSUPPORTED_CIPHER_MODE;
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //The encryption engine honors the limit of the peer
+   context->recordSizeLimit = recordSizeLimit;
+#endif
+
+   //State of the encryption and decryption engines
+   txState = input + TLS_CONNECTION_EXPORT_TX_ENGINE_OFFSET;
+   rxState = input + TLS_CONNECTION_EXPORT_RX_ENGINE_OFFSET;
+
+   //Initialize variables
+   txSecret = NULL;
+   rxSecret = NULL;
+
+   //Check status code
+   if(!error)
+   {
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+      //SSL 3.0, TLS 1.0, TLS 1.1 or TLS 1.2 currently selected?
+      if(context->version <= TLS_VERSION_1_2)
+      {
+         //Master secret
+         memcpy(context->masterSecret,
+            input + TLS_CONNECTION_EXPORT_MASTER_SECRET_OFFSET,
+            TLS_MASTER_SECRET_SIZE);
+
+         //The encryption engines are initialized from the key block
+         error = tlsAllocHandshakeContext(context);
+
+         //Check status code
+         if(!error)
+         {
+            //Rebuild the key block from the traffic keys
+            error = tlsImportKeyBlock(context, txState, rxState);
+         }
+      }
+      else
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //TLS 1.3 currently selected?
+      if(context->version == TLS_VERSION_1_3)
+      {
+         //Current application traffic secrets
+         memcpy(context->clientAppTrafficSecret,
+            input + TLS_CONNECTION_EXPORT_CLIENT_SECRET_OFFSET,
+            TLS_MAX_HKDF_DIGEST_SIZE);
+         memcpy(context->serverAppTrafficSecret,
+            input + TLS_CONNECTION_EXPORT_SERVER_SECRET_OFFSET,
+            TLS_MAX_HKDF_DIGEST_SIZE);
+
+         //Exporter and resumption master secrets
+         memcpy(context->exporterMasterSecret,
+            input + TLS_CONNECTION_EXPORT_EXPORTER_SECRET_OFFSET,
+            TLS_MAX_HKDF_DIGEST_SIZE);
+         memcpy(context->resumptionMasterSecret,
+            input + TLS_CONNECTION_EXPORT_RESUMPTION_SECRET_OFFSET,
+            TLS_MAX_HKDF_DIGEST_SIZE);
+
+         //The traffic keys are derived from the application traffic secrets
+         if(context->entity == TLS_CONNECTION_END_CLIENT)
+         {
+            txSecret = context->clientAppTrafficSecret;
+            rxSecret = context->serverAppTrafficSecret;
+         }
+         else
+         {
+            txSecret = context->serverAppTrafficSecret;
+            rxSecret = context->clientAppTrafficSecret;
+         }
+
+         //Successful processing
+         error = NO_ERROR;
+      }
+      else
+#endif
+      //Invalid TLS version?
+      {
+         //Report an error
+         error = ERROR_INVALID_VERSION;
+      }
+   }
+
+   //The decryption engine uses the write keys of the peer
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+      peerEntity = TLS_CONNECTION_END_SERVER;
+   else
+      peerEntity = TLS_CONNECTION_END_CLIENT;
+
+   //Check status code
+   if(!error)
+   {
+      //Initialize encryption engine
+      error = tlsInitEncryptionEngine(context, &context->encryptionEngine,
+         context->entity, txSecret);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Initialize decryption engine
+      error = tlsInitEncryptionEngine(context, &context->decryptionEngine,
+         peerEntity, rxSecret);
+   }
+
+   //The key block is no longer needed
+   tlsFreeHandshakeContext(context);
+
+   //Any error to report?
+   if(error)
+   {
+      //Release the partially initialized engines
+      tlsFreeEncryptionEngine(&context->encryptionEngine);
+      tlsFreeEncryptionEngine(&context->decryptionEngine);
+
+      //Erase the imported secrets
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+      memset(context->masterSecret, 0, sizeof(context->masterSecret));
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      memset(context->clientAppTrafficSecret, 0,
+         sizeof(context->clientAppTrafficSecret));
+      memset(context->serverAppTrafficSecret, 0,
+         sizeof(context->serverAppTrafficSecret));
+      memset(context->exporterMasterSecret, 0,
+         sizeof(context->exporterMasterSecret));
+      memset(context->resumptionMasterSecret, 0,
+         sizeof(context->resumptionMasterSecret));
+#endif
+
+      //Restore the negotiated parameters of the context
+      context->version = savedVersion;
+      context->cipherSuite = savedCipherSuite;
+      context->keyExchMethod = savedKeyExchMethod;
+      context->encryptionEngine.version = savedVersion;
+      context->decryptionEngine.version = savedVersion;
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+      context->recordSizeLimit = savedRecordSizeLimit;
+#endif
+
+      //Release the decoded strings
+      if(selectedProtocol != NULL)
+         tlsFreeMem(selectedProtocol);
+      if(serverNameCopy != NULL)
+         tlsFreeMem(serverNameCopy);
+
+      //Report an error
+      return error;
+   }
+
+   //Resume the record sequence where the exporting context stopped
+   tlsImportEngineState(&context->encryptionEngine, txState);
+   tlsImportEngineState(&context->decryptionEngine, rxState);
+
+#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+   //Secure renegotiation flag
+   context->secureRenegoFlag =
+      (flags & TLS_CONNECTION_EXPORT_FLAG_SECURE_RENEGO) ? TRUE : FALSE;
+#endif
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   //Negotiated maximum fragment length
+   context->maxFragLen = maxFragLen;
+
+   //A maximum fragment length has been negotiated?
+   if((flags & TLS_CONNECTION_EXPORT_FLAG_MAX_FRAG_LEN) != 0)
+      context->maxFragLenExtReceived = TRUE;
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //The peer advertised a record size limit?
+   if((flags & TLS_CONNECTION_EXPORT_FLAG_RECORD_SIZE_LIMIT) != 0)
+      context->recordSizeLimitExtReceived = TRUE;
+#endif
+
+   //Verify data of the last handshake
+   memcpy(context->clientVerifyData, clientVerifyData, clientVerifyDataLen);
+   context->clientVerifyDataLen = clientVerifyDataLen;
+   memcpy(context->serverVerifyData, serverVerifyData, serverVerifyDataLen);
+   context->serverVerifyDataLen = serverVerifyDataLen;
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //Release the previously selected ALPN protocol, if any
+   if(context->selectedProtocol != NULL)
+      tlsFreeMem(context->selectedProtocol);
+
+   //Selected ALPN protocol
+   context->selectedProtocol = selectedProtocol;
+#endif
+
+   //Release the previously configured server name, if any
+   if(context->serverName != NULL)
+      tlsFreeMem(context->serverName);
+
+   //Server name
+   context->serverName = serverNameCopy;
+
+   //The connection is established
+   context->state = TLS_STATE_APPLICATION_DATA;
+
+   //The TX and RX buffers can now be sized to the negotiated limits
+   if(context->bufferShrinkEnabled)
+   {
+      context->bufferShrinkPending = TRUE;
+      tlsShrinkBuffers(context);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Check whether the record layer holds no pending data
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if no record is partially sent or received, else FALSE
+ **/
+
+bool_t tlsIsConnectionIdle(TlsContext *context)
+{
+   bool_t res;
+
+   //Initialize flag
+   res = TRUE;
+
+   //Outgoing data not yet handed to the transport?
+   if(context->txBufferLen > 0 || context->txPendingLen > 0 ||
+      context->txBulkLen > 0 || context->txZeroCopy)
+   {
+      res = FALSE;
+   }
+
+   //Incoming data not yet consumed by the application?
+   if(context->rxBufferLen > 0 || context->rxRecordPos > 0 ||
+      context->rxBorrowedLen > 0 || context->rxAheadPos < context->rxAheadLen)
+   {
+      res = FALSE;
+   }
+
+   //Return TRUE if the connection can be exported
+   return res;
+}
+
+
+/**
+ * @brief Encode the state of an encryption engine
+ * @param[in] encryptionEngine Pointer to the encryption/decryption engine
+ * @param[out] p Output buffer (TLS_CONNECTION_EXPORT_ENGINE_SIZE bytes)
+ **/
+
+void tlsExportEngineState(const TlsEncryptionEngine *encryptionEngine,
+   uint8_t *p)
+{
+   //Traffic keys
+   memcpy(p + TLS_CONNECTION_EXPORT_ENGINE_MAC_KEY, encryptionEngine->macKey,
+      TLS_CONNECTION_EXPORT_MAC_KEY_SIZE);
+   memcpy(p + TLS_CONNECTION_EXPORT_ENGINE_ENC_KEY, encryptionEngine->encKey,
+      TLS_CONNECTION_EXPORT_ENC_KEY_SIZE);
+
+   //Current IV (TLS 1.0 chains the CBC residue from one record to the next)
+   memcpy(p + TLS_CONNECTION_EXPORT_ENGINE_IV, encryptionEngine->iv,
+      TLS_CONNECTION_EXPORT_IV_SIZE);
+
+   //Sequence number of the next record
+   memcpy(p + TLS_CONNECTION_EXPORT_ENGINE_SEQ_NUM, encryptionEngine->seqNum.b,
+      TLS_CONNECTION_EXPORT_SEQ_NUM_SIZE);
+}
+
+
+/**
+ * @brief Restore the IV and the sequence number of an encryption engine
+ * @param[in] encryptionEngine Pointer to the encryption/decryption engine
+ * @param[in] p Encoded engine state (TLS_CONNECTION_EXPORT_ENGINE_SIZE bytes)
+ **/
+
+void tlsImportEngineState(TlsEncryptionEngine *encryptionEngine,
+   const uint8_t *p)
+{
+   //Current IV
+   memcpy(encryptionEngine->iv, p + TLS_CONNECTION_EXPORT_ENGINE_IV,
+      TLS_CONNECTION_EXPORT_IV_SIZE);
+
+   //Sequence number of the next record
+   memcpy(encryptionEngine->seqNum.b, p + TLS_CONNECTION_EXPORT_ENGINE_SEQ_NUM,
+      TLS_CONNECTION_EXPORT_SEQ_NUM_SIZE);
+}
+
+
+/**
+ * @brief Rebuild the key block from the traffic keys of both directions
+ * @param[in] context Pointer to the TLS context
+ * @param[in] txState Encoded state of the encryption engine
+ * @param[in] rxState Encoded state of the decryption engine
+ * @return Error code
+ **/
+
+error_t tlsImportKeyBlock(TlsContext *context, const uint8_t *txState,
+   const uint8_t *rxState)
+{
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   size_t macKeyLen;
+   size_t encKeyLen;
+   size_t fixedIvLen;
+   const uint8_t *clientState;
+   const uint8_t *serverState;
+   uint8_t *p;
+
+   //Length of the MAC key, encryption key and IV
+   macKeyLen = context->cipherSuite.macKeyLen;
+   encKeyLen = context->cipherSuite.encKeyLen;
+   fixedIvLen = context->cipherSuite.fixedIvLen;
+
+   //Make sure the keys fit in the encoded engine states and the key block
+   if(macKeyLen > TLS_CONNECTION_EXPORT_MAC_KEY_SIZE ||
+      encKeyLen > TLS_CONNECTION_EXPORT_ENC_KEY_SIZE ||
+      fixedIvLen > TLS_CONNECTION_EXPORT_IV_SIZE)
+      return ERROR_FAILURE;
+
+   //Check whether TLS operates as a client or a server
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      clientState = txState;
+      serverState = rxState;
+   }
+   else
+   {
+      clientState = rxState;
+      serverState = txState;
+   }
+
+   //Point to the key block
+   p = context->handshake->keyBlock;
+
+   //Client and server MAC keys
+   memcpy(p, clientState + TLS_CONNECTION_EXPORT_ENGINE_MAC_KEY, macKeyLen);
+   memcpy(p + macKeyLen, serverState + TLS_CONNECTION_EXPORT_ENGINE_MAC_KEY,
+      macKeyLen);
+   p += 2 * macKeyLen;
+
+   //Client and server encryption keys
+   memcpy(p, clientState + TLS_CONNECTION_EXPORT_ENGINE_ENC_KEY, encKeyLen);
+   memcpy(p + encKeyLen, serverState + TLS_CONNECTION_EXPORT_ENGINE_ENC_KEY,
+      encKeyLen);
+   p += 2 * encKeyLen;
+
+   //Client and server IVs
+   memcpy(p, clientState + TLS_CONNECTION_EXPORT_ENGINE_IV, fixedIvLen);
+   memcpy(p + fixedIvLen, serverState + TLS_CONNECTION_EXPORT_ENGINE_IV,
+      fixedIvLen);
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file tls_connection_state.h
+ * @brief Export and import of an established connection
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_CONNECTION_STATE_H
+#define _TLS_CONNECTION_STATE_H
+
+//Dependencies
+#include "tls.h"
+
+//Sizes of the fields of an exported encryption engine
+#define TLS_CONNECTION_EXPORT_MAC_KEY_SIZE 48
+#define TLS_CONNECTION_EXPORT_ENC_KEY_SIZE 32
+#define TLS_CONNECTION_EXPORT_IV_SIZE 16
+#define TLS_CONNECTION_EXPORT_SEQ_NUM_SIZE 8
+
+//Offsets of the fields of an exported encryption engine
+#define TLS_CONNECTION_EXPORT_ENGINE_MAC_KEY 0
+#define TLS_CONNECTION_EXPORT_ENGINE_ENC_KEY \
+   (TLS_CONNECTION_EXPORT_ENGINE_MAC_KEY + TLS_CONNECTION_EXPORT_MAC_KEY_SIZE)
+#define TLS_CONNECTION_EXPORT_ENGINE_IV \
+   (TLS_CONNECTION_EXPORT_ENGINE_ENC_KEY + TLS_CONNECTION_EXPORT_ENC_KEY_SIZE)
+#define TLS_CONNECTION_EXPORT_ENGINE_SEQ_NUM \
+   (TLS_CONNECTION_EXPORT_ENGINE_IV + TLS_CONNECTION_EXPORT_IV_SIZE)
+
+//Size of the state of an encryption engine in an exported connection
+#define TLS_CONNECTION_EXPORT_ENGINE_SIZE \
+   (TLS_CONNECTION_EXPORT_ENGINE_SEQ_NUM + TLS_CONNECTION_EXPORT_SEQ_NUM_SIZE)
+
+//Size of the slots holding the secrets of an exported connection
+#define TLS_CONNECTION_EXPORT_SECRET_SIZE 48
+
+//Offsets of the fields of the fixed part of an exported connection
+#define TLS_CONNECTION_EXPORT_FORMAT_OFFSET 0
+#define TLS_CONNECTION_EXPORT_FLAGS_OFFSET 1
+#define TLS_CONNECTION_EXPORT_ENTITY_OFFSET 2
+#define TLS_CONNECTION_EXPORT_VERSION_OFFSET 3
+#define TLS_CONNECTION_EXPORT_CIPHER_SUITE_OFFSET 5
+#define TLS_CONNECTION_EXPORT_MAX_FRAG_LEN_OFFSET 7
+#define TLS_CONNECTION_EXPORT_RECORD_SIZE_LIMIT_OFFSET 9
+#define TLS_CONNECTION_EXPORT_TX_ENGINE_OFFSET 11
+#define TLS_CONNECTION_EXPORT_RX_ENGINE_OFFSET \
+   (TLS_CONNECTION_EXPORT_TX_ENGINE_OFFSET + TLS_CONNECTION_EXPORT_ENGINE_SIZE)
+#define TLS_CONNECTION_EXPORT_MASTER_SECRET_OFFSET \
+   (TLS_CONNECTION_EXPORT_RX_ENGINE_OFFSET + TLS_CONNECTION_EXPORT_ENGINE_SIZE)
+#define TLS_CONNECTION_EXPORT_CLIENT_SECRET_OFFSET \
+   (TLS_CONNECTION_EXPORT_MASTER_SECRET_OFFSET + \
+   TLS_CONNECTION_EXPORT_SECRET_SIZE)
+#define TLS_CONNECTION_EXPORT_SERVER_SECRET_OFFSET \
+   (TLS_CONNECTION_EXPORT_CLIENT_SECRET_OFFSET + \
+   TLS_CONNECTION_EXPORT_SECRET_SIZE)
+#define TLS_CONNECTION_EXPORT_EXPORTER_SECRET_OFFSET \
+   (TLS_CONNECTION_EXPORT_SERVER_SECRET_OFFSET + \
+   TLS_CONNECTION_EXPORT_SECRET_SIZE)
+#define TLS_CONNECTION_EXPORT_RESUMPTION_SECRET_OFFSET \
+   (TLS_CONNECTION_EXPORT_EXPORTER_SECRET_OFFSET + \
+   TLS_CONNECTION_EXPORT_SECRET_SIZE)
+
+//Offset of the variable-length fields
+#define TLS_CONNECTION_EXPORT_VARIABLE_OFFSET \
+   (TLS_CONNECTION_EXPORT_RESUMPTION_SECRET_OFFSET + \
+   TLS_CONNECTION_EXPORT_SECRET_SIZE)
+
+//Length fields of the verify data, the ALPN protocol and the server name
+#define TLS_CONNECTION_EXPORT_LENGTH_FIELDS_SIZE 5
+
+//The fixed part must match the size advertised to the application
+#if ((TLS_CONNECTION_EXPORT_VARIABLE_OFFSET + TLS_CONNECTION_EXPORT_LENGTH_FIELDS_SIZE) != TLS_CONNECTION_EXPORT_HEADER_SIZE)
+   #error TLS_CONNECTION_EXPORT_HEADER_SIZE does not match the export format
+#endif
+
+//The secrets must fit in their slots
+#if (TLS_MASTER_SECRET_SIZE > TLS_CONNECTION_EXPORT_SECRET_SIZE || TLS_MAX_HKDF_DIGEST_SIZE > TLS_CONNECTION_EXPORT_SECRET_SIZE)
+   #error TLS_CONNECTION_EXPORT_SECRET_SIZE parameter is not valid
+#endif
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Connection state export related functions
+bool_t tlsIsConnectionIdle(TlsContext *context);
+
+void tlsExportEngineState(const TlsEncryptionEngine *encryptionEngine,
+   uint8_t *p);
+
+void tlsImportEngineState(TlsEncryptionEngine *encryptionEngine,
+   const uint8_t *p);
+
+error_t tlsImportKeyBlock(TlsContext *context, const uint8_t *txState,
+   const uint8_t *rxState);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,728 @@
+/**
+ * @file tls_credential.c
+ * @brief Credential management
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_stats.h"
+#include "tls_credential.h"
+#include "tls_certificate.h"
+#include "tls_cert_compression.h"
+#include "pkix/pem_import.h"
+#include "pkix/x509_cert_parse.h"
+#include "ecc/ed25519.h"
+#include "ecc/ed448.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a credential from a certificate chain and a private key
+ *
+ * The certificate chain is decoded once and stored in TLS wire format, while
+ * the private key is decoded and kept in memory. The resulting credential is
+ * immutable and can be attached to any number of TLS contexts
+ *
+ * @param[in] certChain Certificate chain (PEM format)
+ * @param[in] certChainLen Total length of the certificate chain
+ * @param[in] privateKey Private key (PEM format)
+ * @param[in] privateKeyLen Total length of the private key
+ * @return Handle referencing the newly created credential
+ **/
+
+TlsCredential *tlsInitCredential(const char_t *certChain,
+   size_t certChainLen, const char_t *privateKey, size_t privateKeyLen)
+{
+   error_t error;
+   size_t n;
+   size_t length;
+   size_t derCertLen;
+   size_t pemCertLen;
+   const char_t *p;
+   TlsCredential *credential;
+   X509CertificateInfo *certInfo;
+
+   //Check whether the certificate chain is valid
+   if(certChain == NULL || certChainLen == 0)
+      return NULL;
+
+   //The private key is optional
+   if(privateKey == NULL && privateKeyLen != 0)
+      return NULL;
+
+   //Allocate a memory buffer to hold the credential
+   credential = tlsAllocMem(sizeof(TlsCredential));
+   //Failed to allocate memory?
+   if(credential == NULL)
+      return NULL;
+
+   //Clear credential
+   memset(credential, 0, sizeof(TlsCredential));
+
+#if (TLS_RSA_SUPPORT == ENABLED)
+   //Initialize RSA private key
+   rsaInitPrivateKey(&credential->rsaPrivateKey);
+#endif
+#if (TLS_DSA_SIGN_SUPPORT == ENABLED)
+   //Initialize DSA private key
+   dsaInitPrivateKey(&credential->dsaPrivateKey);
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+   //Initialize EC domain parameters
+   ecInitDomainParameters(&credential->ecParams);
+   //Initialize EC private key
+   mpiInit(&credential->ecPrivateKey);
+#endif
+#if (TLS_EDDSA_SIGN_SUPPORT == ENABLED)
+   //Initialize EdDSA private key
+   eddsaInitPrivateKey(&credential->eddsaPrivateKey);
+#endif
+
+   //Create a mutex to protect the reference counter
+   if(!osCreateMutex(&credential->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(credential);
+      //Report an error
+      return NULL;
+   }
+
+   //The caller holds the first reference
+   credential->refCount = 1;
+
+   //Initialize variables
+   certInfo = NULL;
+
+   //Start of exception handling block
+   do
+   {
+      //Point to the certificate chain
+      p = certChain;
+      length = certChainLen;
+
+      //The first pass calculates the length of the certificate list
+      while(length > 0)
+      {
+         //Calculate the length of the DER-encoded certificate
+         TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+         error = pemImportCertificate(p, length, NULL, &derCertLen,
+            &pemCertLen);
+         //End of file detected?
+         if(error)
+            break;
+
+         //Each certificate is preceded by a 3-byte length field
+         credential->certListLen += derCertLen + 3;
+
+         //Advance read pointer
+         p += pemCertLen;
+         length -= pemCertLen;
+      }
+
+      //The certificate chain must contain at least one certificate
+      if(credential->certListLen == 0)
+      {
+         error = ERROR_INVALID_PARAMETER;
+         break;
+      }
+
+      //Allocate a memory buffer to hold the certificate list
+      credential->certList = tlsAllocMem(credential->certListLen);
+      //Failed to allocate memory?
+      if(credential->certList == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //Point to the certificate chain
+      p = certChain;
+      length = certChainLen;
+
+      //The second pass decodes the PEM certificates
+      for(n = 0; n < credential->certListLen; n += derCertLen + 3)
+      {
+         //Decode the current certificate
+         TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+         error = pemImportCertificate(p, length, credential->certList + n + 3,
+            &derCertLen, &pemCertLen);
+         //Any error to report?
+         if(error)
+            break;
+
+         //Each certificate is preceded by a 3-byte length field
+         STORE24BE(derCertLen, credential->certList + n);
+
+         //Advance read pointer
+         p += pemCertLen;
+         length -= pemCertLen;
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+
+      //Allocate a memory buffer to store X.509 certificate info
+      certInfo = tlsAllocObject(TLS_MEM_CLASS_CERT_INFO,
+         sizeof(X509CertificateInfo));
+      //Failed to allocate memory?
+      if(certInfo == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //Parse the end entity certificate
+      TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
+      error = x509ParseCertificate(credential->certList + 3,
+         LOAD24BE(credential->certList), certInfo);
+      //Failed to parse the X.509 certificate?
+      if(error)
+         break;
+
+      //Retrieve the signature algorithm that has been used to sign the
+      //certificate
+      error = tlsGetCertificateType(certInfo, &credential->type,
+         &credential->signAlgo, &credential->hashAlgo, &credential->namedCurve);
+      //The specified signature algorithm is not supported?
+      if(error)
+         break;
+
+      //The raw public key points to the certificate list, which is never
+      //modified once the credential has been created
+      credential->rawPublicKey = certInfo->tbsCert.subjectPublicKeyInfo.rawData;
+      credential->rawPublicKeyLen = certInfo->tbsCert.subjectPublicKeyInfo.rawDataLen;
+
+      //The private key is optional
+      if(privateKey != NULL)
+      {
+#if (TLS_RSA_SUPPORT == ENABLED)
+         //RSA certificate?
+         if(credential->type == TLS_CERT_RSA_SIGN ||
+            credential->type == TLS_CERT_RSA_PSS_SIGN)
+         {
+            //Decode the PEM structure that holds the RSA private key
+            TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+            error = pemImportRsaPrivateKey(privateKey, privateKeyLen,
+               &credential->rsaPrivateKey);
+         }
+         else
+#endif
+#if (TLS_DSA_SIGN_SUPPORT == ENABLED)
+         //DSA certificate?
+         if(credential->type == TLS_CERT_DSS_SIGN)
+         {
+            //Decode the PEM structure that holds the DSA private key
+            TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+            error = pemImportDsaPrivateKey(privateKey, privateKeyLen,
+               &credential->dsaPrivateKey);
+         }
+         else
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+         //ECDSA certificate?
+         if(credential->type == TLS_CERT_ECDSA_SIGN)
+         {
+            //Decode the PEM structure that holds the EC domain parameters
+            TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+            error = pemImportEcParameters(privateKey, privateKeyLen,
+               &credential->ecParams);
+
+            //Check status code
+            if(!error)
+            {
+               //Decode the PEM structure that holds the EC private key
+               TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+               error = pemImportEcPrivateKey(privateKey, privateKeyLen,
+                  &credential->ecPrivateKey);
+            }
+         }
+         else
+#endif
+#if (TLS_EDDSA_SIGN_SUPPORT == ENABLED)
+         //EdDSA certificate?
+         if(credential->type == TLS_CERT_ED25519_SIGN ||
+            credential->type == TLS_CERT_ED448_SIGN)
+         {
+            //Decode the PEM structure that holds the EdDSA private key
+            TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+            error = pemImportEddsaPrivateKey(privateKey, privateKeyLen,
+               &credential->eddsaPrivateKey);
+
+            //Check status code
+            if(!error)
+            {
+               //Precompute the signing material that is fixed per key
+               error = tlsPrecomputeEddsaKey(credential);
+            }
+         }
+         else
+#endif
+         //Unsupported certificate type?
+         {
+            //Report an error
+            error = ERROR_UNSUPPORTED_CERTIFICATE;
+         }
+
+         //Any error to report?
+         if(error)
+            break;
+
+         //The private key has been successfully decoded
+         credential->hasPrivateKey = TRUE;
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Release previously allocated memory
+   tlsFreeObject(TLS_MEM_CLASS_CERT_INFO, certInfo);
+
+   //Any error to report?
+   if(error)
+   {
+      //Clean up side effects
+      tlsFreeCredential(credential);
+      credential = NULL;
+   }
+
+   //Return a pointer to the newly created credential
+   return credential;
+}
+
+
+/**
+ * @brief Acquire a new reference to a credential
+ * @param[in] credential Pointer to the credential
+ * @return Pointer to the credential
+ **/
+
+TlsCredential *tlsReferenceCredential(TlsCredential *credential)
+{
+   //Valid credential?
+   if(credential != NULL)
+   {
+      //Acquire exclusive access to the reference counter
+      osAcquireMutex(&credential->mutex);
+      //Increment the reference counter
+      credential->refCount++;
+      //Release exclusive access to the reference counter
+      osReleaseMutex(&credential->mutex);
+   }
+
+   //Return a pointer to the credential
+   return credential;
+}
+
+
+/**
+ * @brief Release a reference to a credential
+ *
+ * The credential is disposed when the last reference is released
+ *
+ * @param[in] credential Pointer to the credential
+ **/
+
+void tlsFreeCredential(TlsCredential *credential)
+{
+   uint_t refCount;
+
+   //Valid credential?
+   if(credential != NULL)
+   {
+      //Acquire exclusive access to the reference counter
+      osAcquireMutex(&credential->mutex);
+      //Decrement the reference counter
+      refCount = --credential->refCount;
+      //Release exclusive access to the reference counter
+      osReleaseMutex(&credential->mutex);
+
+      //Last reference?
+      if(refCount == 0)
+      {
+         //Release the certificate list
+         if(credential->certList != NULL)
+         {
+            tlsFreeMem(credential->certList);
+         }
+
+#if (TLS_RSA_SUPPORT == ENABLED)
+         //Release RSA private key
+         rsaFreePrivateKey(&credential->rsaPrivateKey);
+#endif
+#if (TLS_DSA_SIGN_SUPPORT == ENABLED)
+         //Release DSA private key
+         dsaFreePrivateKey(&credential->dsaPrivateKey);
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+         //Release EC domain parameters
+         ecFreeDomainParameters(&credential->ecParams);
+         //Release EC private key
+         mpiFree(&credential->ecPrivateKey);
+#endif
+#if (TLS_EDDSA_SIGN_SUPPORT == ENABLED)
+         //Release EdDSA private key
+         eddsaFreePrivateKey(&credential->eddsaPrivateKey);
+#endif
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+         //Release the compressed forms of the Certificate message
+         tlsFreeCompressedCerts(credential);
+#endif
+
+         //Release mutex object
+         osDeleteMutex(&credential->mutex);
+
+         //Clear credential
+         memset(credential, 0, sizeof(TlsCredential));
+         //Properly dispose the credential
+         tlsFreeMem(credential);
+      }
+   }
+}
+
+
+/**
+ * @brief Retrieve the RSA private key associated with a certificate
+ * @param[in] cert Certificate descriptor
+ * @param[in] buffer RSA private key used to decode a PEM-encoded key
+ * @param[out] privateKey Pointer to the RSA private key
+ * @return Error code
+ **/
+
+error_t tlsGetRsaPrivateKey(const TlsCertDesc *cert, RsaPrivateKey *buffer,
+   const RsaPrivateKey **privateKey)
+{
+#if (TLS_RSA_SUPPORT == ENABLED)
+   error_t error;
+
+   //Point to the buffer by default
+   *privateKey = buffer;
+
+   //Pre-parsed credential?
+   if(cert->credential != NULL)
+   {
+      //Make sure the private key is available
+      if(cert->credential->hasPrivateKey)
+      {
+         //Use the pre-decoded private key
+         *privateKey = &cert->credential->rsaPrivateKey;
+         error = NO_ERROR;
+      }
+      else
+      {
+         //Report an error
+         error = ERROR_INVALID_KEY;
+      }
+   }
+   else
+   {
+      //Decode the PEM structure that holds the RSA private key
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+      error = pemImportRsaPrivateKey(cert->privateKey, cert->privateKeyLen,
+         buffer);
+   }
+
+   //Return status code
+   return error;
+#else
+   //RSA is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Retrieve the DSA private key associated with a certificate
+ * @param[in] cert Certificate descriptor
+ * @param[in] buffer DSA private key used to decode a PEM-encoded key
+ * @param[out] privateKey Pointer to the DSA private key
+ * @return Error code
+ **/
+
+error_t tlsGetDsaPrivateKey(const TlsCertDesc *cert, DsaPrivateKey *buffer,
+   const DsaPrivateKey **privateKey)
+{
+#if (TLS_DSA_SIGN_SUPPORT == ENABLED)
+   error_t error;
+
+   //Point to the buffer by default
+   *privateKey = buffer;
+
+   //Pre-parsed credential?
+   if(cert->credential != NULL)
+   {
+      //Make sure the private key is available
+      if(cert->credential->hasPrivateKey)
+      {
+         //Use the pre-decoded private key
+         *privateKey = &cert->credential->dsaPrivateKey;
+         error = NO_ERROR;
+      }
+      else
+      {
+         //Report an error
+         error = ERROR_INVALID_KEY;
+      }
+   }
+   else
+   {
+      //Decode the PEM structure that holds the DSA private key
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+      error = pemImportDsaPrivateKey(cert->privateKey, cert->privateKeyLen,
+         buffer);
+   }
+
+   //Return status code
+   return error;
+#else
+   //DSA is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Retrieve the EC private key associated with a certificate
+ * @param[in] cert Certificate descriptor
+ * @param[in] paramsBuffer EC domain parameters used to decode a PEM-encoded key
+ * @param[in] keyBuffer EC private key used to decode a PEM-encoded key
+ * @param[out] params Pointer to the EC domain parameters
+ * @param[out] privateKey Pointer to the EC private key
+ * @return Error code
+ **/
+
+error_t tlsGetEcPrivateKey(const TlsCertDesc *cert, EcDomainParameters *paramsBuffer,
+   Mpi *keyBuffer, const EcDomainParameters **params, const Mpi **privateKey)
+{
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+   error_t error;
+
+   //Point to the buffers by default
+   *params = paramsBuffer;
+   *privateKey = keyBuffer;
+
+   //Pre-parsed credential?
+   if(cert->credential != NULL)
+   {
+      //Make sure the private key is available
+      if(cert->credential->hasPrivateKey)
+      {
+         //Use the pre-decoded domain parameters and private key
+         *params = &cert->credential->ecParams;
+         *privateKey = &cert->credential->ecPrivateKey;
+         error = NO_ERROR;
+      }
+      else
+      {
+         //Report an error
+         error = ERROR_INVALID_KEY;
+      }
+   }
+   else
+   {
+      //Decode the PEM structure that holds the EC domain parameters
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+      error = pemImportEcParameters(cert->privateKey, cert->privateKeyLen,
+         paramsBuffer);
+
+      //Check status code
+      if(!error)
+      {
+         //Decode the PEM structure that holds the EC private key
+         TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+         error = pemImportEcPrivateKey(cert->privateKey, cert->privateKeyLen,
+            keyBuffer);
+      }
+   }
+
+   //Return status code
+   return error;
+#else
+   //ECDSA is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Retrieve the EdDSA private key associated with a certificate
+ * @param[in] cert Certificate descriptor
+ * @param[in] buffer EdDSA private key used to decode a PEM-encoded key
+ * @param[out] privateKey Pointer to the EdDSA private key
+ * @return Error code
+ **/
+
+error_t tlsGetEddsaPrivateKey(const TlsCertDesc *cert, EddsaPrivateKey *buffer,
+   const EddsaPrivateKey **privateKey)
+{
+#if (TLS_EDDSA_SIGN_SUPPORT == ENABLED)
+   error_t error;
+
+   //Point to the buffer by default
+   *privateKey = buffer;
+
+   //Pre-parsed credential?
+   if(cert->credential != NULL)
+   {
+      //Make sure the private key is available
+      if(cert->credential->hasPrivateKey)
+      {
+         //Use the pre-decoded private key
+         *privateKey = &cert->credential->eddsaPrivateKey;
+         error = NO_ERROR;
+      }
+      else
+      {
+         //Report an error
+         error = ERROR_INVALID_KEY;
+      }
+   }
+   else
+   {
+      //Decode the PEM structure that holds the EdDSA private key
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+      error = pemImportEddsaPrivateKey(cert->privateKey, cert->privateKeyLen,
+         buffer);
+   }
+
+   //Return status code
+   return error;
+#else
+   //EdDSA is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Precompute the EdDSA signing material of a credential
+ *
+ * The private key is exported once in octet string form and the matching
+ * public key is derived from it, so that signature generation does not need
+ * to perform an extra scalar multiplication each time
+ *
+ * @param[in] credential Pointer to the credential
+ * @return Error code
+ **/
+
+error_t tlsPrecomputeEddsaKey(TlsCredential *credential)
+{
+#if (TLS_EDDSA_SIGN_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+
+#if (TLS_ED25519_SUPPORT == ENABLED)
+   //Ed25519 certificate?
+   if(credential->type == TLS_CERT_ED25519_SIGN)
+   {
+      //Length of Ed25519 keys
+      n = ED25519_PRIVATE_KEY_LEN;
+   }
+   else
+#endif
+#if (TLS_ED448_SUPPORT == ENABLED)
+   //Ed448 certificate?
+   if(credential->type == TLS_CERT_ED448_SIGN)
+   {
+      //Length of Ed448 keys
+      n = ED448_PRIVATE_KEY_LEN;
+   }
+   else
+#endif
+   //Unsupported curve?
+   {
+      //The signing material cannot be precomputed
+      return NO_ERROR;
+   }
+
+   //Check the length of the EdDSA private key
+   if(mpiGetByteLength(&credential->eddsaPrivateKey.d) != n)
+      return ERROR_INVALID_KEY;
+
+   //Retrieve the private key
+   error = mpiExport(&credential->eddsaPrivateKey.d,
+      credential->eddsaSecretKey, n, MPI_FORMAT_LITTLE_ENDIAN);
+
+   //Check status code
+   if(!error)
+   {
+#if (TLS_ED25519_SUPPORT == ENABLED)
+      //Ed25519 certificate?
+      if(credential->type == TLS_CERT_ED25519_SIGN)
+      {
+         //Derive the Ed25519 public key
+         error = ed25519GeneratePublicKey(credential->eddsaSecretKey,
+            credential->eddsaPublicKey);
+      }
+      else
+#endif
+#if (TLS_ED448_SUPPORT == ENABLED)
+      //Ed448 certificate?
+      if(credential->type == TLS_CERT_ED448_SIGN)
+      {
+         //Derive the Ed448 public key
+         error = ed448GeneratePublicKey(credential->eddsaSecretKey,
+            credential->eddsaPublicKey);
+      }
+      else
+#endif
+      //Unsupported curve?
+      {
+         //Report an error
+         error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //The precomputed keys are now available
+      credential->eddsaKeyLen = n;
+   }
+   else
+   {
+      //Clear the private key
+      memset(credential->eddsaSecretKey, 0, TLS_MAX_EDDSA_KEY_LEN);
+   }
+
+   //Return status code
+   return error;
+#else
+   //EdDSA is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+#endif
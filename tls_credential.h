@@ -0,0 +1,68 @@
+/**
+ * @file tls_credential.h
+ * @brief Credential management
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_CREDENTIAL_H
+#define _TLS_CREDENTIAL_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Credential management
+TlsCredential *tlsInitCredential(const char_t *certChain,
+   size_t certChainLen, const char_t *privateKey, size_t privateKeyLen);
+
+TlsCredential *tlsReferenceCredential(TlsCredential *credential);
+void tlsFreeCredential(TlsCredential *credential);
+
+error_t tlsGetRsaPrivateKey(const TlsCertDesc *cert, RsaPrivateKey *buffer,
+   const RsaPrivateKey **privateKey);
+
+error_t tlsGetDsaPrivateKey(const TlsCertDesc *cert, DsaPrivateKey *buffer,
+   const DsaPrivateKey **privateKey);
+
+error_t tlsGetEcPrivateKey(const TlsCertDesc *cert, EcDomainParameters *paramsBuffer,
+   Mpi *keyBuffer, const EcDomainParameters **params, const Mpi **privateKey);
+
+error_t tlsGetEddsaPrivateKey(const TlsCertDesc *cert, EddsaPrivateKey *buffer,
+   const EddsaPrivateKey **privateKey);
+
+error_t tlsPrecomputeEddsaKey(TlsCredential *credential);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
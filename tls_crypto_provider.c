@@ -0,0 +1,395 @@
+/**
+ * @file tls_crypto_provider.c
+ * @brief Pluggable crypto providers
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_crypto_provider.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+
+//Crypto providers registered globally
+static const TlsCryptoProvider *tlsCryptoProviders[TLS_MAX_CRYPTO_PROVIDERS];
+//Number of crypto providers registered globally
+static uint_t tlsNumCryptoProviders;
+
+
+/**
+ * @brief Register a crypto provider globally
+ *
+ * The provider is made available to every TLS context. Registration is not
+ * thread-safe and is expected to take place at startup, before any TLS
+ * context is created
+ *
+ * @param[in] provider Pointer to the crypto provider
+ * @return Error code
+ **/
+
+error_t tlsRegisterCryptoProvider(const TlsCryptoProvider *provider)
+{
+   uint_t i;
+
+   //Check parameters
+   if(provider == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Loop through the registered providers
+   for(i = 0; i < tlsNumCryptoProviders; i++)
+   {
+      //The provider is already registered?
+      if(tlsCryptoProviders[i] == provider)
+         return NO_ERROR;
+   }
+
+   //Make sure the registry is not full
+   if(tlsNumCryptoProviders >= TLS_MAX_CRYPTO_PROVIDERS)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Add the provider to the registry
+   tlsCryptoProviders[tlsNumCryptoProviders++] = provider;
+
+   //Debug message
+   TRACE_INFO("Crypto provider %s registered (priority %u)\r\n",
+      (provider->name != NULL) ? provider->name : "unnamed",
+      provider->priority);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Unregister a crypto provider
+ *
+ * The provider must not be in use by any encryption engine
+ *
+ * @param[in] provider Pointer to the crypto provider
+ * @return Error code
+ **/
+
+error_t tlsUnregisterCryptoProvider(const TlsCryptoProvider *provider)
+{
+   uint_t i;
+
+   //Loop through the registered providers
+   for(i = 0; i < tlsNumCryptoProviders; i++)
+   {
+      //Matching provider?
+      if(tlsCryptoProviders[i] == provider)
+      {
+         //Remove the provider from the registry
+         tlsNumCryptoProviders--;
+         tlsCryptoProviders[i] = tlsCryptoProviders[tlsNumCryptoProviders];
+         tlsCryptoProviders[tlsNumCryptoProviders] = NULL;
+
+         //Successful processing
+         return NO_ERROR;
+      }
+   }
+
+   //The provider is not registered
+   return ERROR_NOT_FOUND;
+}
+
+
+/**
+ * @brief Get the crypto providers applicable to a TLS context
+ *
+ * The providers attached to the context (or to its shared configuration)
+ * come first, followed by the ones registered globally. The resulting list
+ * is sorted by decreasing priority, the relative order of providers with the
+ * same priority being preserved
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] providers Array where to store the providers (room for
+ *   2 * TLS_MAX_CRYPTO_PROVIDERS entries)
+ * @return Number of providers
+ **/
+
+uint_t tlsGetCryptoProviders(TlsContext *context,
+   const TlsCryptoProvider **providers)
+{
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   const TlsCryptoProvider *provider;
+
+   //Providers attached to the TLS context
+   for(n = 0, i = 0; i < context->numCryptoProviders; i++)
+   {
+      providers[n++] = context->cryptoProviders[i];
+   }
+
+   //Providers registered globally
+   for(i = 0; i < tlsNumCryptoProviders; i++)
+   {
+      //Skip providers that are already in the list
+      for(j = 0; j < n && providers[j] != tlsCryptoProviders[i]; j++)
+      {
+      }
+
+      //Add the provider to the list
+      if(j >= n)
+      {
+         providers[n++] = tlsCryptoProviders[i];
+      }
+   }
+
+   //Stable insertion sort (highest priority first)
+   for(i = 1; i < n; i++)
+   {
+      provider = providers[i];
+
+      for(j = i; j > 0 && providers[j - 1]->priority < provider->priority; j--)
+      {
+         providers[j] = providers[j - 1];
+      }
+
+      providers[j] = provider;
+   }
+
+   //Return the number of providers
+   return n;
+}
+
+
+/**
+ * @brief Let a crypto provider take over an encryption engine
+ *
+ * The providers are offered the engine in order of preference, once the
+ * traffic keys have been derived. The first provider whose initEngine
+ * callback succeeds handles the record protection for the lifetime of the
+ * engine. A provider that does not implement the negotiated cipher suite
+ * shall return ERROR_NOT_IMPLEMENTED
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] encryptionEngine Pointer to the encryption/decryption engine
+ * @return NO_ERROR if a provider has claimed the engine, ERROR_NOT_IMPLEMENTED
+ *   if the built-in implementation shall be used, else an error code
+ **/
+
+error_t tlsClaimEncryptionEngine(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   void *providerContext;
+   const TlsCryptoProvider *provider;
+   const TlsCryptoProvider *providers[2 * TLS_MAX_CRYPTO_PROVIDERS];
+
+   //Release the state left by a previous key
+   tlsReleaseEncryptionEngine(encryptionEngine);
+
+   //Get the applicable crypto providers
+   n = tlsGetCryptoProviders(context, providers);
+
+   //Loop through the providers (most preferred first)
+   for(error = ERROR_NOT_IMPLEMENTED, i = 0; i < n; i++)
+   {
+      //Point to the current provider
+      provider = providers[i];
+
+      //The provider must implement both directions of record protection
+      if(provider->initEngine == NULL || provider->encryptRecord == NULL ||
+         provider->decryptRecord == NULL)
+      {
+         continue;
+      }
+
+      //Give the provider a chance to claim the engine
+      providerContext = NULL;
+      error = provider->initEngine(context, encryptionEngine, &providerContext);
+
+      //The provider does not support the negotiated cipher suite?
+      if(error == ERROR_NOT_IMPLEMENTED)
+         continue;
+
+      //Check status code
+      if(!error)
+      {
+         //Debug message
+         TRACE_INFO("Record protection handled by crypto provider %s\r\n",
+            (provider->name != NULL) ? provider->name : "unnamed");
+
+         //The provider handles the record protection
+         encryptionEngine->provider = provider;
+         encryptionEngine->providerContext = providerContext;
+         encryptionEngine->encryptRecord = provider->encryptRecord;
+         encryptionEngine->decryptRecord = provider->decryptRecord;
+      }
+
+      //We are done
+      break;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release the provider-specific state of an encryption engine
+ * @param[in] encryptionEngine Pointer to the encryption/decryption engine
+ **/
+
+void tlsReleaseEncryptionEngine(TlsEncryptionEngine *encryptionEngine)
+{
+   //Engine claimed by a crypto provider?
+   if(encryptionEngine->provider != NULL)
+   {
+      //Release provider-specific state
+      if(encryptionEngine->provider->freeEngine != NULL)
+      {
+         encryptionEngine->provider->freeEngine(encryptionEngine,
+            encryptionEngine->providerContext);
+      }
+
+      //The engine is no longer claimed
+      encryptionEngine->provider = NULL;
+      encryptionEngine->providerContext = NULL;
+   }
+}
+
+
+/**
+ * @brief Select the hash implementation to be used for record MACs
+ * @param[in] context Pointer to the TLS context
+ * @param[in] hashAlgo Built-in hash algorithm
+ * @return Hash algorithm supplied by the most preferred provider, or the
+ *   built-in algorithm if no provider implements it
+ **/
+
+const HashAlgo *tlsGetProviderHashAlgo(TlsContext *context,
+   const HashAlgo *hashAlgo)
+{
+   uint_t i;
+   uint_t n;
+   const HashAlgo *altHashAlgo;
+   const TlsCryptoProvider *providers[2 * TLS_MAX_CRYPTO_PROVIDERS];
+
+   //Cipher suites without MAC
+   if(hashAlgo == NULL)
+      return NULL;
+
+   //Get the applicable crypto providers
+   n = tlsGetCryptoProviders(context, providers);
+
+   //Loop through the providers (most preferred first)
+   for(i = 0; i < n; i++)
+   {
+      //Hash implementation available?
+      if(providers[i]->getHashAlgo != NULL)
+      {
+         //Query the provider
+         altHashAlgo = providers[i]->getHashAlgo(hashAlgo);
+
+         //The alternative implementation must produce the same digest
+         if(altHashAlgo != NULL &&
+            altHashAlgo->digestSize == hashAlgo->digestSize &&
+            altHashAlgo->blockSize == hashAlgo->blockSize)
+         {
+            return altHashAlgo;
+         }
+      }
+   }
+
+   //Use the built-in implementation
+   return hashAlgo;
+}
+
+
+/**
+ * @brief Install the key exchange and signature callbacks of the providers
+ *
+ * Callbacks explicitly registered on the TLS context take precedence. The
+ * remaining ones are taken from the most preferred provider that
+ * implements them
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsApplyCryptoProviders(TlsContext *context)
+{
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED || TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t n;
+   const TlsCryptoProvider *provider;
+   const TlsCryptoProvider *providers[2 * TLS_MAX_CRYPTO_PROVIDERS];
+
+   //Get the applicable crypto providers
+   n = tlsGetCryptoProviders(context, providers);
+
+   //Loop through the providers (most preferred first)
+   for(i = 0; i < n; i++)
+   {
+      //Point to the current provider
+      provider = providers[i];
+
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
+      //ECDH key exchange
+      if(provider->ecdhCallback != NULL && context->ecdhCallback == NULL)
+      {
+         context->ecdhCallback = provider->ecdhCallback;
+      }
+
+      //ECDSA signature generation
+      if(provider->ecdsaSignCallback != NULL &&
+         context->ecdsaSignCallback == NULL)
+      {
+         context->ecdsaSignCallback = provider->ecdsaSignCallback;
+      }
+
+      //ECDSA signature verification
+      if(provider->ecdsaVerifyCallback != NULL &&
+         context->ecdsaVerifyCallback == NULL)
+      {
+         context->ecdsaVerifyCallback = provider->ecdsaVerifyCallback;
+      }
+#endif
+
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+      //Signature generation
+      if(provider->signCallback != NULL && context->asyncSignCallback == NULL)
+      {
+         context->asyncSignCallback = provider->signCallback;
+         context->asyncSignParam = provider->signParam;
+      }
+#endif
+   }
+#endif
+}
+
+#endif
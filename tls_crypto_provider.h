@@ -0,0 +1,64 @@
+/**
+ * @file tls_crypto_provider.h
+ * @brief Pluggable crypto providers
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_CRYPTO_PROVIDER_H
+#define _TLS_CRYPTO_PROVIDER_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Crypto provider related functions
+error_t tlsRegisterCryptoProvider(const TlsCryptoProvider *provider);
+error_t tlsUnregisterCryptoProvider(const TlsCryptoProvider *provider);
+
+uint_t tlsGetCryptoProviders(TlsContext *context,
+   const TlsCryptoProvider **providers);
+
+error_t tlsClaimEncryptionEngine(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine);
+
+void tlsReleaseEncryptionEngine(TlsEncryptionEngine *encryptionEngine);
+
+const HashAlgo *tlsGetProviderHashAlgo(TlsContext *context,
+   const HashAlgo *hashAlgo);
+
+void tlsApplyCryptoProviders(TlsContext *context);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -60,11 +60,14 @@ error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
    error_t error;
    size_t n;
    uint16_t type;
+   TlsTypeSet typeSet;
    const TlsExtension *extension;
    const TlsExtensionList *extensionList;
 
    //Initialize TLS extensions
    memset(extensions, 0, sizeof(TlsHelloExtensions));
+   //No extension has been seen so far
+   tlsInitTypeSet(&typeSet);
 
    //Check message type
    if(msgType == TLS_TYPE_CLIENT_HELLO || msgType == TLS_TYPE_SERVER_HELLO)
@@ -118,7 +121,24 @@ error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
       length -= sizeof(TlsExtension) + n;
 
       //Test if the current extension is a duplicate
-      error = tlsCheckDuplicateExtension(type, p, length);
+      error = tlsAddTypeToSet(&typeSet, type);
+
+      //Too many distinct extension types?
+      if(error == ERROR_BUFFER_OVERFLOW)
+      {
+         //Check the remaining extensions of the list
+         error = tlsCheckDuplicateExtension(type, p, length);
+      }
+      else if(error)
+      {
+         //There must not be more than one extension of the same type (refer
+         //to RFC 5246, section 7.4.1.4)
+         if(type > TLS_EXT_RENEGOTIATION_INFO)
+            error = ERROR_DECODING_FAILED;
+         else
+            error = ERROR_ILLEGAL_PARAMETER;
+      }
+
       //Duplicate extension found?
       if(error)
          return error;
@@ -283,6 +303,30 @@ error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
          //The SignatureAlgorithmsCert extension is valid
          extensions->certSignAlgoList = certSignAlgoList;
       }
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+      else if(type == TLS_EXT_COMPRESS_CERTIFICATE)
+      {
+         const TlsCertCompressionAlgos *certCompressionAlgoList;
+
+         //Point to the CompressCertificate extension
+         certCompressionAlgoList = (TlsCertCompressionAlgos *) extension->value;
+
+         //Malformed extension?
+         if(n < sizeof(TlsCertCompressionAlgos))
+            return ERROR_DECODING_FAILED;
+         if(n != (sizeof(TlsCertCompressionAlgos) + certCompressionAlgoList->length))
+            return ERROR_DECODING_FAILED;
+
+         //Check the length of the list
+         if(certCompressionAlgoList->length == 0)
+            return ERROR_DECODING_FAILED;
+         if((certCompressionAlgoList->length % 2) != 0)
+            return ERROR_DECODING_FAILED;
+
+         //The CompressCertificate extension is valid
+         extensions->certCompressionAlgoList = certCompressionAlgoList;
+      }
+#endif
 #if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
       else if(type == TLS_EXT_MAX_FRAGMENT_LENGTH)
       {
@@ -305,6 +349,59 @@ error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
          extensions->recordSizeLimit = extension->value;
       }
 #endif
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+      else if(type == TLS_EXT_CONNECTION_ID)
+      {
+         const DtlsConnectionId *connectionId;
+
+         //Point to the ConnectionId extension
+         connectionId = (DtlsConnectionId *) extension->value;
+
+         //Malformed extension?
+         if(n < sizeof(DtlsConnectionId))
+            return ERROR_DECODING_FAILED;
+         if(n != (sizeof(DtlsConnectionId) + connectionId->length))
+            return ERROR_DECODING_FAILED;
+
+         //The ConnectionId extension is valid
+         extensions->connectionId = connectionId;
+      }
+#endif
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+      else if(type == TLS_EXT_USE_SRTP)
+      {
+         size_t m;
+         const DtlsSrtpProtectionProfiles *profiles;
+
+         //Point to the UseSrtp extension
+         profiles = (DtlsSrtpProtectionProfiles *) extension->value;
+
+         //Malformed extension?
+         if(n < sizeof(DtlsSrtpProtectionProfiles))
+            return ERROR_DECODING_FAILED;
+
+         //Retrieve the length of the list of protection profiles
+         m = ntohs(profiles->length);
+
+         //The list must contain at least one 2-byte profile
+         if(m < sizeof(uint16_t) || (m % sizeof(uint16_t)) != 0)
+            return ERROR_DECODING_FAILED;
+
+         //The list is followed by the srtp_mki field
+         if(n < (sizeof(DtlsSrtpProtectionProfiles) + m + 1))
+            return ERROR_DECODING_FAILED;
+
+         //Check the length of the MKI
+         if(n != (sizeof(DtlsSrtpProtectionProfiles) + m + 1 +
+            extension->value[sizeof(DtlsSrtpProtectionProfiles) + m]))
+         {
+            return ERROR_DECODING_FAILED;
+         }
+
+         //The UseSrtp extension is valid
+         extensions->useSrtp = profiles;
+      }
+#endif
 #if (TLS_ALPN_SUPPORT == ENABLED)
       else if(type == TLS_EXT_ALPN)
       {
@@ -396,6 +493,46 @@ error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
          extensions->extendedMasterSecret = extension->value;
       }
 #endif
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      else if(type == TLS_EXT_SESSION_TICKET)
+      {
+         //The server uses a zero-length SessionTicket extension to indicate
+         //that it will send a new ticket (refer to RFC 5077, section 3.2)
+         if(msgType == TLS_TYPE_SERVER_HELLO && n != 0)
+            return ERROR_DECODING_FAILED;
+
+         //The SessionTicket extension is valid
+         extensions->sessionTicket = extension->value;
+         extensions->sessionTicketLen = n;
+      }
+#endif
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+      else if(type == TLS_EXT_STATUS_REQUEST)
+      {
+         //The extension carries a CertificateStatusRequest structure in the
+         //ClientHello and a CertificateStatus structure in a TLS 1.3
+         //Certificate message (refer to RFC 8446, section 4.4.2.1)
+         if(msgType == TLS_TYPE_CLIENT_HELLO &&
+            n < sizeof(TlsCertStatusRequest))
+         {
+            return ERROR_DECODING_FAILED;
+         }
+         else if(msgType == TLS_TYPE_CERTIFICATE &&
+            n < sizeof(TlsCertificateStatus))
+         {
+            return ERROR_DECODING_FAILED;
+         }
+         else if(msgType == TLS_TYPE_SERVER_HELLO && n != 0)
+         {
+            //The TLS 1.2 server sends an empty extension
+            return ERROR_DECODING_FAILED;
+         }
+
+         //The StatusRequest extension is valid
+         extensions->statusRequest = extension->value;
+         extensions->statusRequestLen = n;
+      }
+#endif
 #if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
       else if(type == TLS_EXT_RENEGOTIATION_INFO)
       {
@@ -442,6 +579,7 @@ error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
          {
             size_t k;
             size_t m;
+            TlsTypeSet groupSet;
             const Tls13KeyShareList *keyShareList;
             const Tls13KeyShareEntry *keyShareEntry;
 
@@ -460,6 +598,9 @@ error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
             //Retrieve the length of the list
             m = ntohs(keyShareList->length);
 
+            //No group has been seen so far
+            tlsInitTypeSet(&groupSet);
+
             //Parse the list of key share entries offered by the peer
             while(m > 0)
             {
@@ -484,8 +625,15 @@ error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
                //Clients must not offer multiple KeyShareEntry values for the
                //same group. Servers may check for violations of this rule and
                //abort the handshake with an illegal_parameter alert
-               error = tls13CheckDuplicateKeyShare(ntohs(keyShareEntry->group),
-                  p, m);
+               error = tlsAddTypeToSet(&groupSet, ntohs(keyShareEntry->group));
+
+               //Too many distinct groups?
+               if(error == ERROR_BUFFER_OVERFLOW)
+               {
+                  //Check the remaining entries of the list
+                  error = tls13CheckDuplicateKeyShare(
+                     ntohs(keyShareEntry->group), p, m);
+               }
                //Any error to report?
                if(error)
                   return ERROR_ILLEGAL_PARAMETER;
@@ -845,6 +993,20 @@ error_t tlsCheckHelloExtensions(TlsMessageType msgType, uint16_t version,
       }
 #endif
 
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+      //StatusRequest extension found?
+      if(extensions->statusRequest != NULL)
+      {
+         //The extension can only appear in CH, CR and CT messages
+         if(msgType != TLS_TYPE_CLIENT_HELLO &&
+            msgType != TLS_TYPE_CERTIFICATE_REQUEST &&
+            msgType != TLS_TYPE_CERTIFICATE)
+         {
+            error = ERROR_ILLEGAL_PARAMETER;
+         }
+      }
+#endif
+
       //Cookie extension found?
       if(extensions->cookie != NULL)
       {
@@ -1006,6 +1168,80 @@ error_t tlsCheckDuplicateExtension(uint16_t type, const uint8_t *p,
 }
 
 
+/**
+ * @brief Initialize a set of type values
+ * @param[out] set Pointer to the set
+ **/
+
+void tlsInitTypeSet(TlsTypeSet *set)
+{
+   //The set is initially empty
+   memset(set, 0, sizeof(TlsTypeSet));
+}
+
+
+/**
+ * @brief Add a type value to a set
+ *
+ * The cost of the operation does not depend on the number of values that
+ * have already been added, so that a list can be checked for duplicates in
+ * a single pass
+ *
+ * @param[in] set Pointer to the set
+ * @param[in] type Type value to be added
+ * @return NO_ERROR if the value has been added, ERROR_ILLEGAL_PARAMETER if
+ *   the value is already present, or ERROR_BUFFER_OVERFLOW if the hash
+ *   table is full
+ **/
+
+error_t tlsAddTypeToSet(TlsTypeSet *set, uint16_t type)
+{
+   uint_t i;
+   uint_t k;
+
+   //Small values are tracked by the bitmap
+   if(type < 64)
+   {
+      //Duplicate value?
+      if((set->bitmap[type / 32] & (1U << (type % 32))) != 0)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Add the value to the set
+      set->bitmap[type / 32] |= 1U << (type % 32);
+   }
+   else
+   {
+      //Spread the GREASE values (0x0A0A, 0x1A1A...) across the table
+      i = (((uint32_t) type * 40503U) >> 8) % TLS_TYPE_SET_HASH_SIZE;
+
+      //Linear probing
+      for(k = 0; k < TLS_TYPE_SET_HASH_SIZE; k++)
+      {
+         //Free slot?
+         if(set->table[i] == 0)
+            break;
+
+         //Duplicate value?
+         if(set->table[i] == type)
+            return ERROR_ILLEGAL_PARAMETER;
+
+         //Next slot
+         i = (i + 1) % TLS_TYPE_SET_HASH_SIZE;
+      }
+
+      //The hash table is full
+      if(k >= TLS_TYPE_SET_HASH_SIZE)
+         return ERROR_BUFFER_OVERFLOW;
+
+      //Add the value to the set
+      set->table[i] = type;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Check whether the specified ALPN protocol is supported
  * @param[in] context Pointer to the TLS context
@@ -1024,45 +1260,219 @@ bool_t tlsIsAlpnProtocolSupported(TlsContext *context,
 
 #if (TLS_ALPN_SUPPORT == ENABLED)
    //Sanity check
-   if(context->protocolList != NULL)
+   if(context->alpnList != NULL)
    {
-      size_t i;
-      size_t j;
+      //Search the compiled list of supported protocols
+      supported = tlsMatchAlpnList(context->alpnList,
+         (const uint8_t *) protocol, length);
+   }
+#endif
+
+   //Return TRUE if the specified protocol is supported
+   return supported;
+}
 
-      //Move back to the beginning of the list
-      i = 0;
-      j = 0;
+#if (TLS_ALPN_SUPPORT == ENABLED)
 
-      //Parse the list of supported protocols
-      do
+/**
+ * @brief Compile a list of ALPN protocols
+ *
+ * The comma-delimited list is parsed once. The resulting structure holds
+ * the ProtocolNameList in wire format, ready to be copied into the
+ * ClientHello, and a table of the protocol names hashed on their length,
+ * so that the protocols offered by a client can be checked without
+ * scanning the list. Empty tokens are discarded
+ *
+ * @param[in] protocolList Comma-delimited list of protocols
+ * @param[out] alpnList Compiled ALPN protocol list
+ * @return Error code
+ **/
+
+error_t tlsCompileAlpnList(const char_t *protocolList,
+   TlsAlpnList **alpnList)
+{
+   size_t i;
+   size_t j;
+   size_t n;
+   size_t length;
+   uint_t k;
+   uint_t numProtocols;
+   uint_t tails[TLS_ALPN_NUM_BUCKETS];
+   TlsAlpnList *list;
+   TlsAlpnProtocol *protocol;
+
+   //Retrieve the length of the comma-delimited list
+   length = strlen(protocolList);
+
+   //Move back to the beginning of the list
+   i = 0;
+   j = 0;
+   n = 0;
+   numProtocols = 0;
+
+   //Count the protocols and check their length
+   do
+   {
+      //Delimiter character found?
+      if(protocolList[i] == ',' || protocolList[i] == '\0')
       {
-         //Delimiter character found?
-         if(context->protocolList[i] == ',' || context->protocolList[i] == '\0')
+         //Discard empty tokens
+         if((i - j) > 0)
          {
-            //Check the length of the protocol name
-            if(length == (i - j))
-            {
-               //Compare protocol names
-               if(!memcmp(protocol, context->protocolList + j, i - j))
-               {
-                  //The specified protocol is supported
-                  supported = TRUE;
-                  //We are done
-                  break;
-               }
-            }
+            //Protocol names are limited to 255 bytes
+            if((i - j) > 255)
+               return ERROR_INVALID_LENGTH;
+
+            //Update the length of the encoded list
+            n += sizeof(TlsProtocolName) + i - j;
+            numProtocols++;
+         }
+
+         //Move to the next token
+         j = i + 1;
+      }
+
+      //Loop until the NULL character is reached
+   } while(protocolList[i++] != '\0');
+
+   //The list must fit in a single ProtocolNameList
+   if(numProtocols > 255 || n > 65535)
+      return ERROR_INVALID_LENGTH;
+
+   //Allocate a single memory block to hold the compiled list
+   list = tlsAllocMem(sizeof(TlsAlpnList) + numProtocols *
+      sizeof(TlsAlpnProtocol) + sizeof(TlsProtocolNameList) + n + length + 1);
+   //Failed to allocate memory?
+   if(list == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Clear the bucket heads
+   memset(list, 0, sizeof(TlsAlpnList));
+
+   //Point to the variable-length fields
+   list->protocols = (TlsAlpnProtocol *) (list + 1);
+   list->encoded = (uint8_t *) (list->protocols + numProtocols);
+   list->protocolList = (char_t *) (list->encoded +
+      sizeof(TlsProtocolNameList) + n);
+
+   //Save the comma-delimited list
+   strcpy(list->protocolList, protocolList);
 
-            //Move to the next token
-            j = i + 1;
+   //Fill in the length field of the ProtocolNameList
+   STORE16BE(n, list->encoded);
+   list->encodedLen = sizeof(TlsProtocolNameList) + n;
+
+   //Move back to the beginning of the list
+   i = 0;
+   j = 0;
+   n = sizeof(TlsProtocolNameList);
+
+   //Parse the list of protocols
+   do
+   {
+      //Delimiter character found?
+      if(protocolList[i] == ',' || protocolList[i] == '\0')
+      {
+         //Discard empty tokens
+         if((i - j) > 0)
+         {
+            //Point to the current protocol
+            protocol = &list->protocols[list->numProtocols];
+
+            //Encode the protocol name
+            list->encoded[n] = (uint8_t) (i - j);
+            memcpy(list->encoded + n + 1, protocolList + j, i - j);
+
+            //Save the location of the protocol name
+            protocol->offset = (uint16_t) (n + 1);
+            protocol->length = (uint8_t) (i - j);
+            protocol->next = 0;
+
+            //Append the protocol to its length bucket
+            k = (i - j) % TLS_ALPN_NUM_BUCKETS;
+
+            //Empty bucket?
+            if(list->buckets[k] == 0)
+               list->buckets[k] = list->numProtocols + 1;
+            else
+               list->protocols[tails[k]].next = list->numProtocols + 1;
+
+            //Keep track of the last protocol of the bucket
+            tails[k] = list->numProtocols++;
+
+            //Adjust the length of the encoded list
+            n += sizeof(TlsProtocolName) + i - j;
          }
 
-         //Loop until the NULL character is reached
-      } while(context->protocolList[i++] != '\0');
+         //Move to the next token
+         j = i + 1;
+      }
+
+      //Loop until the NULL character is reached
+   } while(protocolList[i++] != '\0');
+
+   //Return the compiled list
+   *alpnList = list;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Check whether a protocol belongs to a compiled ALPN list
+ * @param[in] alpnList Compiled ALPN protocol list
+ * @param[in] protocol Pointer to the protocol name
+ * @param[in] length Length of the protocol name, in bytes
+ * @return TRUE if the protocol belongs to the list, else FALSE
+ **/
+
+bool_t tlsMatchAlpnList(const TlsAlpnList *alpnList, const uint8_t *protocol,
+   size_t length)
+{
+   uint_t i;
+   const TlsAlpnProtocol *entry;
+
+   //Check the length of the protocol name
+   if(length < 1 || length > 255)
+      return FALSE;
+
+   //Only the protocols of the matching length bucket are compared
+   for(i = alpnList->buckets[length % TLS_ALPN_NUM_BUCKETS]; i != 0;
+      i = entry->next)
+   {
+      //Point to the current protocol
+      entry = &alpnList->protocols[i - 1];
+
+      //Compare protocol names
+      if(entry->length == length &&
+         !memcmp(alpnList->encoded + entry->offset, protocol, length))
+      {
+         //The protocol belongs to the list
+         return TRUE;
+      }
    }
-#endif
 
-   //Return TRUE if the specified protocol is supported
-   return supported;
+   //The protocol does not belong to the list
+   return FALSE;
 }
 
+
+/**
+ * @brief Release a compiled ALPN protocol list
+ * @param[in] alpnList Compiled ALPN protocol list
+ **/
+
+void tlsFreeAlpnList(TlsAlpnList *alpnList)
+{
+   //Valid list?
+   if(alpnList != NULL)
+   {
+      //Release memory
+      tlsFreeMem(alpnList);
+   }
+}
+
+#endif
+
 #endif
@@ -39,6 +39,23 @@
 extern "C" {
 #endif
 
+
+/**
+ * @brief Set of 16-bit type values (extension types, named groups)
+ *
+ * Values below 64 are tracked by a bitmap. Other values (GREASE, private
+ * or unassigned code points) are tracked by a small open-addressing hash
+ * table
+ *
+ **/
+
+typedef struct
+{
+   uint32_t bitmap[2];                     ///<Values below 64
+   uint16_t table[TLS_TYPE_SET_HASH_SIZE]; ///<Other values (0 = free slot)
+} TlsTypeSet;
+
+
 //TLS related functions
 error_t tlsParseHelloExtensions(TlsMessageType msgType, const uint8_t *p,
    size_t length, TlsHelloExtensions *extensions);
@@ -49,9 +66,20 @@ error_t tlsCheckHelloExtensions(TlsMessageType msgType, uint16_t version,
 error_t tlsCheckDuplicateExtension(uint16_t type, const uint8_t *p,
    size_t length);
 
+void tlsInitTypeSet(TlsTypeSet *set);
+error_t tlsAddTypeToSet(TlsTypeSet *set, uint16_t type);
+
 bool_t tlsIsAlpnProtocolSupported(TlsContext *context,
    const char_t *protocol, size_t length);
 
+error_t tlsCompileAlpnList(const char_t *protocolList,
+   TlsAlpnList **alpnList);
+
+bool_t tlsMatchAlpnList(const TlsAlpnList *alpnList, const uint8_t *protocol,
+   size_t length);
+
+void tlsFreeAlpnList(TlsAlpnList *alpnList);
+
 //C++ guard
 #ifdef __cplusplus
 }
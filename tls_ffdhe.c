@@ -40,6 +40,13 @@
 //Check TLS library configuration
 #if (TLS_SUPPORT == ENABLED && TLS_FFDHE_SUPPORT == ENABLED)
 
+//Decoded FFDHE parameters (one entry per supported group)
+TlsFfdheCacheEntry tlsFfdheCache[3];
+//Number of entries in the cache
+uint_t tlsFfdheCacheSize = 0;
+//The cache is ready to use
+bool_t tlsFfdheCacheReady = FALSE;
+
 #if (TLS_FFDHE2048_SUPPORT == ENABLED)
 
 /**
@@ -307,7 +314,7 @@ error_t tlsSelectFfdheGroup(TlsContext *context,
 
 /**
  * @brief Get the FFDHE parameters that match the specified named group
- * @param[in] context Pointer to the TLS context
+ * @param[in] context Pointer to the TLS context (optional parameter)
  * @param[in] namedGroup Named group
  * @return FFDHE parameters
  **/
@@ -345,7 +352,7 @@ const TlsFfdheGroup *tlsGetFfdheGroup(TlsContext *context, uint16_t namedGroup)
    }
 
    //Restrict the use of certain FFDHE groups
-   if(context->numSupportedGroups > 0)
+   if(context != NULL && context->numSupportedGroups > 0)
    {
       //Loop through the list of allowed named groups
       for(i = 0; i < context->numSupportedGroups; i++)
@@ -376,9 +383,25 @@ error_t tlsLoadFfdheParameters(DhParameters *params,
    const TlsFfdheGroup *ffdheGroup)
 {
    error_t error;
+   const DhParameters *cachedParams;
+
+   //Look for the decoded parameters in the cache
+   cachedParams = tlsGetCachedFfdheParameters(ffdheGroup);
 
-   //Make sure the FFDHE group is supported
-   if(ffdheGroup != NULL)
+   //Cache hit?
+   if(cachedParams != NULL)
+   {
+      //Copy the prime modulus
+      error = mpiCopy(&params->p, &cachedParams->p);
+
+      //Check status code
+      if(!error)
+      {
+         //Copy the generator
+         error = mpiCopy(&params->g, &cachedParams->g);
+      }
+   }
+   else if(ffdheGroup != NULL)
    {
       //Convert the prime modulus to a multiple precision integer
       error = mpiImport(&params->p, ffdheGroup->p, ffdheGroup->pLen,
@@ -401,4 +424,146 @@ error_t tlsLoadFfdheParameters(DhParameters *params,
    return error;
 }
 
+
+/**
+ * @brief Decode the supported FFDHE groups once
+ *
+ * This function may be called once, before any TLS context is created. The
+ * prime modulus and the generator of each supported group are converted to
+ * multiple precision integers, so that handshakes do not need to convert the
+ * RFC 7919 byte arrays each time an FFDHE group is negotiated
+ *
+ * @return Error code
+ **/
+
+error_t tlsInitFfdheCache(void)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   const TlsFfdheGroup *groups[3];
+
+   //Already initialized?
+   if(tlsFfdheCacheReady)
+      return NO_ERROR;
+
+   //Number of supported groups
+   n = 0;
+
+#if (TLS_FFDHE2048_SUPPORT == ENABLED)
+   groups[n++] = &ffdhe2048Group;
+#endif
+#if (TLS_FFDHE3072_SUPPORT == ENABLED)
+   groups[n++] = &ffdhe3072Group;
+#endif
+#if (TLS_FFDHE4096_SUPPORT == ENABLED)
+   groups[n++] = &ffdhe4096Group;
+#endif
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Loop through the supported groups
+   for(i = 0; i < n && !error; i++)
+   {
+      //Save the FFDHE group
+      tlsFfdheCache[i].group = groups[i];
+
+      //Initialize Diffie-Hellman parameters
+      mpiInit(&tlsFfdheCache[i].params.p);
+      mpiInit(&tlsFfdheCache[i].params.g);
+
+      //Convert the prime modulus to a multiple precision integer
+      error = mpiImport(&tlsFfdheCache[i].params.p, groups[i]->p,
+         groups[i]->pLen, MPI_FORMAT_BIG_ENDIAN);
+
+      //Check status code
+      if(!error)
+      {
+         //Convert the generator to a multiple precision integer
+         error = mpiSetValue(&tlsFfdheCache[i].params.g, groups[i]->g);
+      }
+   }
+
+   //Save the number of entries
+   tlsFfdheCacheSize = i;
+
+   //Check status code
+   if(!error)
+   {
+      //The cache is now ready to use
+      tlsFfdheCacheReady = TRUE;
+   }
+   else
+   {
+      //Clean up side effects
+      tlsFfdheCacheReady = TRUE;
+      tlsFreeFfdheCache();
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Retrieve the decoded parameters of a given FFDHE group
+ * @param[in] ffdheGroup FFDHE group
+ * @return Pointer to the decoded parameters, or NULL if the cache is not used
+ **/
+
+const DhParameters *tlsGetCachedFfdheParameters(const TlsFfdheGroup *ffdheGroup)
+{
+   uint_t i;
+   const DhParameters *params;
+
+   //Initialize pointer
+   params = NULL;
+
+   //Make sure the cache has been initialized
+   if(tlsFfdheCacheReady && ffdheGroup != NULL)
+   {
+      //Loop through the cache entries
+      for(i = 0; i < tlsFfdheCacheSize; i++)
+      {
+         //Matching group?
+         if(tlsFfdheCache[i].group == ffdheGroup)
+         {
+            //The cache entries are never modified once initialized
+            params = &tlsFfdheCache[i].params;
+            break;
+         }
+      }
+   }
+
+   //Return the decoded parameters, if any
+   return params;
+}
+
+
+/**
+ * @brief Release the decoded FFDHE parameters
+ **/
+
+void tlsFreeFfdheCache(void)
+{
+   uint_t i;
+
+   //Make sure the cache has been initialized
+   if(tlsFfdheCacheReady)
+   {
+      //Loop through the cache entries
+      for(i = 0; i < tlsFfdheCacheSize; i++)
+      {
+         //Release Diffie-Hellman parameters
+         mpiFree(&tlsFfdheCache[i].params.p);
+         mpiFree(&tlsFfdheCache[i].params.g);
+      }
+
+      //The cache can no longer be used
+      tlsFfdheCacheSize = 0;
+      tlsFfdheCacheReady = FALSE;
+   }
+}
+
 #endif
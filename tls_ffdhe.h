@@ -53,6 +53,17 @@ typedef struct
 } TlsFfdheGroup;
 
 
+/**
+ * @brief Decoded FFDHE parameters
+ **/
+
+typedef struct
+{
+   const TlsFfdheGroup *group; ///<FFDHE group
+   DhParameters params;        ///<Prime modulus and generator, decoded once
+} TlsFfdheCacheEntry;
+
+
 //TLS related functions
 error_t tlsSelectFfdheGroup(TlsContext *context,
    const TlsSupportedGroupList *groupList);
@@ -63,6 +74,10 @@ const TlsFfdheGroup *tlsGetFfdheGroup(TlsContext *context,
 error_t tlsLoadFfdheParameters(DhParameters *params,
    const TlsFfdheGroup *ffdheGroup);
 
+error_t tlsInitFfdheCache(void);
+const DhParameters *tlsGetCachedFfdheParameters(const TlsFfdheGroup *ffdheGroup);
+void tlsFreeFfdheCache(void);
+
 //C++ guard
 #ifdef __cplusplus
 }
@@ -34,11 +34,19 @@
 //Dependencies
 #include "tls.h"
 #include "tls_handshake.h"
+#include "tls_arena.h"
+#include "tls_cert_stream.h"
+#include "tls_ocsp.h"
 #include "tls_client_fsm.h"
 #include "tls_server_fsm.h"
 #include "tls_common.h"
 #include "tls_transcript_hash.h"
 #include "tls_record.h"
+#include "tls_buffer.h"
+#include "tls_misc.h"
+#include "tls_crypto_provider.h"
+#include "tls_stats.h"
+#include "tls_session_store.h"
 #include "tls13_server_misc.h"
 #include "dtls_record.h"
 #include "debug.h"
@@ -55,33 +63,30 @@
 
 error_t tlsInitHandshake(TlsContext *context)
 {
-   //Allocate send buffer if necessary
-   if(context->txBuffer == NULL)
-   {
-      //Allocate TX buffer
-      context->txBuffer = tlsAllocMem(context->txBufferSize);
-
-      //Failed to allocate memory?
-      if(context->txBuffer == NULL)
-         return ERROR_OUT_OF_MEMORY;
+   error_t error;
 
-      //Clear TX buffer
-      memset(context->txBuffer, 0, context->txBufferSize);
-   }
+   //Allocate send buffer if necessary
+   error = tlsAcquireTxBuffer(context);
+   //Any error to report?
+   if(error)
+      return error;
 
    //Allocate receive buffer if necessary
-   if(context->rxBuffer == NULL)
-   {
-      //Allocate RX buffer
-      context->rxBuffer = tlsAllocMem(context->rxBufferSize);
+   error = tlsAcquireRxBuffer(context);
+   //Any error to report?
+   if(error)
+      return error;
 
-      //Failed to allocate memory?
-      if(context->rxBuffer == NULL)
-         return ERROR_OUT_OF_MEMORY;
+   //Allocate the handshake key material
+   error = tlsAllocHandshakeContext(context);
+   //Any error to report?
+   if(error)
+      return error;
 
-      //Clear RX buffer
-      memset(context->rxBuffer, 0, context->rxBufferSize);
-   }
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   //Install the key exchange and signature callbacks of the crypto providers
+   tlsApplyCryptoProviders(context);
+#endif
 
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
    //Server mode?
@@ -92,6 +97,23 @@ error_t tlsInitHandshake(TlsContext *context)
    }
 #endif
 
+#if (TLS_CLIENT_SUPPORT == ENABLED)
+   //Client mode?
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      //Offer the freshest session or ticket available for the server
+      error = tlsLoadFromSessionStore(context);
+      //Any error to report?
+      if(error)
+         return error;
+
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED)
+      //The connection is opened by the first flight of the client
+      context->fastOpenPending = context->fastOpenEnabled;
+#endif
+   }
+#endif
+
    //The client initiates the TLS handshake by sending a ClientHello message
    //to the server
    context->state = TLS_STATE_CLIENT_HELLO;
@@ -114,6 +136,46 @@ error_t tlsInitHandshake(TlsContext *context)
 error_t tlsPerformHandshake(TlsContext *context)
 {
    error_t error;
+   bool_t postHandshake;
+   TlsState state;
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   TlsHandshakeCounters *counters;
+#endif
+
+   //Save current state
+   state = context->state;
+   //Sending a KeyUpdate or a deferred NewSessionTicket message does not
+   //involve any handshake
+   postHandshake = tlsIsPostHandshakeState(context);
+
+#if (TLS_STATS_SUPPORT == ENABLED)
+   //Beginning of the handshake?
+   if(state == TLS_STATE_INIT)
+      tlsStatsHandshakeStarted(context);
+#endif
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //Charge the allocations and crypto operations to the context
+   counters = tlsStatsEnterHandshake(context);
+#endif
+
+   //A renegotiation starts from the application data phase, after the
+   //handshake key material has been released
+   if(state != TLS_STATE_INIT && state != TLS_STATE_APPLICATION_DATA &&
+      !postHandshake)
+   {
+      //Allocate the handshake key material if necessary
+      error = tlsAllocHandshakeContext(context);
+      //Any error to report?
+      if(error)
+      {
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+         //Stop charging events to the context
+         tlsStatsLeaveHandshake(counters);
+#endif
+         return error;
+      }
+   }
 
 #if (TLS_CLIENT_SUPPORT == ENABLED)
    //Client mode?
@@ -139,11 +201,246 @@ error_t tlsPerformHandshake(TlsContext *context)
       error = ERROR_INVALID_PARAMETER;
    }
 
+   //The handshake has just completed?
+   if(state != TLS_STATE_APPLICATION_DATA && !postHandshake &&
+      context->state == TLS_STATE_APPLICATION_DATA)
+   {
+#if (TLS_STATS_SUPPORT == ENABLED)
+      //Update statistics
+      tlsStatsHandshakeCompleted(context);
+#endif
+      //The handshake key material is no longer needed
+      tlsFreeHandshakeContext(context);
+
+      //The TX and RX buffers can now be sized to the negotiated limits
+      if(context->bufferShrinkEnabled)
+      {
+         context->bufferShrinkPending = TRUE;
+         tlsShrinkBuffers(context);
+      }
+   }
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //Stop charging events to the context
+   tlsStatsLeaveHandshake(counters);
+#endif
+
    //Return status code
    return error;
 }
 
 
+/**
+ * @brief Check whether the state machine sends a post-handshake message
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if a KeyUpdate or a deferred NewSessionTicket message is
+ *   about to be sent, else FALSE
+ **/
+
+bool_t tlsIsPostHandshakeState(TlsContext *context)
+{
+   bool_t res;
+
+   //KeyUpdate message pending?
+   res = (context->state == TLS_STATE_KEY_UPDATE);
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //NewSessionTicket messages deferred until the first application data?
+   if(context->state == TLS_STATE_NEW_SESSION_TICKET &&
+      context->deferredTicketsPending)
+   {
+      res = TRUE;
+   }
+#endif
+
+   //Return TRUE if the handshake is already complete
+   return res;
+}
+
+
+/**
+ * @brief Check whether application data can be sent using False Start
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if the client flight has been sent under False Start
+ *   conditions and the server's final flight is still awaited, else FALSE
+ **/
+
+bool_t tlsIsFalseStartState(TlsContext *context)
+{
+   bool_t res;
+
+   //Initialize flag
+   res = FALSE;
+
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //False Start in progress?
+   if(context->falseStarted)
+   {
+      //Waiting for the NewSessionTicket, ChangeCipherSpec or Finished message
+      //of the server?
+      if(context->state == TLS_STATE_NEW_SESSION_TICKET ||
+         context->state == TLS_STATE_SERVER_CHANGE_CIPHER_SPEC ||
+         context->state == TLS_STATE_SERVER_FINISHED)
+      {
+         res = TRUE;
+      }
+   }
+#endif
+
+   //Return TRUE if application data can be sent
+   return res;
+}
+
+
+/**
+ * @brief Allocate the handshake key material
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsAllocHandshakeContext(TlsContext *context)
+{
+   size_t n;
+
+   //The structure is allocated once per handshake
+   if(context->handshake == NULL)
+   {
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+      //The arena immediately follows the structure, on an 8-byte boundary
+      n = TLS_ARENA_ALIGN(sizeof(TlsHandshakeContext));
+      n += context->handshakeArenaSize;
+#else
+      //Size of the structure
+      n = sizeof(TlsHandshakeContext);
+#endif
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //Static operating mode?
+      if(context->staticMem)
+      {
+         //Use the memory supplied by the application
+         context->handshake = context->staticHandshake;
+      }
+      else
+#endif
+      {
+         //Allocate a memory buffer to hold the handshake key material
+         context->handshake = tlsAllocMem(n);
+      }
+
+      //Failed to allocate memory?
+      if(context->handshake == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Initialize the structure
+      memset(context->handshake, 0, sizeof(TlsHandshakeContext));
+
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+      //Handshake-scoped objects are allocated from the arena, and released
+      //all at once when the handshake completes
+      if(context->handshakeArenaSize > 0)
+      {
+         context->handshake->arena = (uint8_t *) context->handshake +
+            TLS_ARENA_ALIGN(sizeof(TlsHandshakeContext));
+
+         context->handshake->arenaSize = context->handshakeArenaSize;
+      }
+#endif
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release the handshake-only state
+ *
+ * The secrets are wiped and released, and the ephemeral and peer keys are
+ * cleared, so that long-lived connections only keep the state required by
+ * the record layer
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsFreeHandshakeContext(TlsContext *context)
+{
+   //The transcript hash is not used once the handshake has completed, and
+   //it may have been allocated from the arena
+   tlsFreeTranscriptHash(context);
+
+#if (TLS_CERT_STREAM_SUPPORT == ENABLED)
+   //Release the state of the incremental Certificate message parser
+   tlsFreeCertStream(context);
+#endif
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Release the stapled OCSP response
+   tlsReleaseStapledOcspResponse(context);
+#endif
+
+   //Release the handshake key material
+   if(context->handshake != NULL)
+   {
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+      //Clear the part of the arena that has been used
+      tlsClearArena(context->handshake);
+#endif
+      //Clear secrets before freeing memory
+      memset(context->handshake, 0, sizeof(TlsHandshakeContext));
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //The memory supplied by the application is never freed
+      if(context->handshake != context->staticHandshake)
+#endif
+      {
+         tlsFreeMem(context->handshake);
+      }
+
+      context->handshake = NULL;
+   }
+
+#if (TLS_DH_SUPPORT == ENABLED)
+   //Release the ephemeral Diffie-Hellman values (the domain parameters are
+   //kept for subsequent handshakes)
+   mpiFree(&context->dhContext.xa);
+   mpiFree(&context->dhContext.ya);
+   mpiFree(&context->dhContext.yb);
+#endif
+
+#if (TLS_ECDH_SUPPORT == ENABLED)
+   //Release the ephemeral ECDH key pair
+   ecdhFree(&context->ecdhContext);
+   ecdhInit(&context->ecdhContext);
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Release the speculative key share, if any
+   tls13FreeSpeculativeKeyShare(context);
+#endif
+
+#if (TLS_RSA_SUPPORT == ENABLED)
+   //Release peer's RSA public key
+   rsaFreePublicKey(&context->peerRsaPublicKey);
+   rsaInitPublicKey(&context->peerRsaPublicKey);
+#endif
+
+#if (TLS_DSA_SIGN_SUPPORT == ENABLED)
+   //Release peer's DSA public key
+   dsaFreePublicKey(&context->peerDsaPublicKey);
+   dsaInitPublicKey(&context->peerDsaPublicKey);
+#endif
+
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED || TLS_EDDSA_SIGN_SUPPORT == ENABLED)
+   //Release peer's EC domain parameters and public key
+   ecFreeDomainParameters(&context->peerEcParams);
+   ecInitDomainParameters(&context->peerEcParams);
+   ecFree(&context->peerEcPublicKey);
+   ecInit(&context->peerEcPublicKey);
+#endif
+}
+
+
 /**
  * @brief Send handshake message
  * @param[in] context Pointer to the TLS context
@@ -225,6 +522,15 @@ error_t tlsSendHandshakeMessage(TlsContext *context, const void *data,
       error = dtlsWriteProtocolData(context, data, length, TLS_TYPE_HANDSHAKE);
    }
    else
+#endif
+#if (TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   //Part of a server flight?
+   if(tlsCanAppendToFlight(context))
+   {
+      //Append the handshake message to the current flight
+      error = tlsAppendToFlight(context, data, length);
+   }
+   else
 #endif
    //TLS protocol?
    {
@@ -276,8 +582,32 @@ error_t tlsReceiveHandshakeMessage(TlsContext *context)
       //Handshake message received?
       if(contentType == TLS_TYPE_HANDSHAKE)
       {
-         //Parse handshake message
-         error = tlsParseHandshakeMessage(context, data, length);
+#if (TLS_CERT_STREAM_SUPPORT == ENABLED)
+         //Fragment of a message that is parsed incrementally?
+         if(context->rxStreamLen > 0)
+         {
+            //Parse the fragment
+            error = tlsParseHandshakeFragment(context, data, length);
+         }
+         else
+#endif
+         {
+            //Parse handshake message
+            error = tlsParseHandshakeMessage(context, data, length);
+
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED && TLS_SERVER_SUPPORT == ENABLED)
+            //ClientHello parked while an external session cache lookup is
+            //pending?
+            if(error == ERROR_WOULD_BLOCK &&
+               context->extCacheState == TLS_EXT_CACHE_STATE_PENDING)
+            {
+               //Leave the message in the receive buffer so that it can be
+               //parsed again once the result of the lookup is posted
+               context->rxBufferPos -= length;
+               context->rxBufferLen += length;
+            }
+#endif
+         }
       }
       //ChangeCipherSpec message received?
       else if(contentType == TLS_TYPE_CHANGE_CIPHER_SPEC)
@@ -397,8 +727,9 @@ error_t tlsParseHandshakeMessage(TlsContext *context, const uint8_t *message,
       //Parse client's handshake message
       error = tlsParseClientHandshakeMessage(context, msgType, p, n);
 
-      //Update the hash value with the incoming handshake message
-      if(msgType != TLS_TYPE_CLIENT_KEY_EXCHANGE)
+      //Update the hash value with the incoming handshake message (a parked
+      //ClientHello will be hashed when it is parsed again)
+      if(msgType != TLS_TYPE_CLIENT_KEY_EXCHANGE && error != ERROR_WOULD_BLOCK)
       {
          tlsUpdateTranscriptHash(context, message, length);
       }
@@ -415,4 +746,325 @@ error_t tlsParseHandshakeMessage(TlsContext *context, const uint8_t *message,
    return error;
 }
 
+
+/**
+ * @brief Parse a fragment of a handshake message
+ *
+ * The message is hashed and passed to the incremental parser as the records
+ * arrive. The first fragment always holds the handshake message header
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to the fragment
+ * @param[in] length Length of the fragment
+ * @return Error code
+ **/
+
+error_t tlsParseHandshakeFragment(TlsContext *context, const uint8_t *data,
+   size_t length)
+{
+#if (TLS_CERT_STREAM_SUPPORT == ENABLED)
+   error_t error;
+   const TlsHandshake *message;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //First fragment of the message?
+   if(context->rxStreamPos == 0)
+   {
+      //Point to the handshake message header
+      message = (TlsHandshake *) data;
+
+      //Debug message
+      TRACE_INFO("Certificate message received (%" PRIuSIZE " bytes, "
+         "parsed incrementally)...\r\n", context->rxStreamLen);
+
+      //Prepare the incremental parser
+      error = tlsStartCertStream(context, LOAD24BE(message->length));
+
+      //Check status code
+      if(!error)
+      {
+         //Update the hash value with the handshake message header
+         tlsUpdateTranscriptHash(context, data, sizeof(TlsHandshake));
+
+         //Point to the body of the message
+         data += sizeof(TlsHandshake);
+         length -= sizeof(TlsHandshake);
+         context->rxStreamPos = sizeof(TlsHandshake);
+      }
+   }
+
+   //Check status code
+   if(!error && length > 0)
+   {
+      //Debug message
+      TRACE_DEBUG_ARRAY("  ", data, length);
+
+      //Update the hash value with the incoming fragment
+      tlsUpdateTranscriptHash(context, data, length);
+
+      //Parse the fragment
+      error = tlsParseCertStream(context, data, length);
+      //Number of bytes of the message processed so far
+      context->rxStreamPos += length;
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Last fragment of the message?
+      if(context->rxStreamPos >= context->rxStreamLen)
+      {
+         //Check the message and update the state of the handshake
+         error = tlsCompleteCertStream(context);
+
+         //The next handshake message is reassembled as usual
+         context->rxStreamLen = 0;
+         context->rxStreamPos = 0;
+      }
+   }
+   else
+   {
+      //Release the state of the parser
+      tlsFreeCertStream(context);
+
+      //The handshake is aborted
+      context->rxStreamLen = 0;
+      context->rxStreamPos = 0;
+   }
+
+   //Return status code
+   return error;
+#else
+   //Incremental parsing is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Check whether a handshake message can be appended to the flight
+ *
+ * The server flights (ServerHello...ServerHelloDone for TLS 1.2,
+ * EncryptedExtensions...Finished for TLS 1.3) are built in the TX buffer so
+ * that the messages protected under the same keys share as few records as
+ * possible
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if the current state sends a message of the flight, else FALSE
+ **/
+
+bool_t tlsCanAppendToFlight(TlsContext *context)
+{
+   bool_t res;
+
+   //Initialize flag
+   res = FALSE;
+
+#if (TLS_SERVER_SUPPORT == ENABLED && TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   //Flight coalescing applies to the server side of TLS connections
+   if(context->entity == TLS_CONNECTION_END_SERVER &&
+      context->transportProtocol == TLS_TRANSPORT_PROTOCOL_STREAM)
+   {
+      //Check current state
+      if(context->state == TLS_STATE_SERVER_HELLO ||
+         context->state == TLS_STATE_SERVER_HELLO_2 ||
+         context->state == TLS_STATE_SERVER_CERTIFICATE ||
+         context->state == TLS_STATE_SERVER_CERTIFICATE_STATUS ||
+         context->state == TLS_STATE_SERVER_KEY_EXCHANGE ||
+         context->state == TLS_STATE_CERTIFICATE_REQUEST ||
+         context->state == TLS_STATE_SERVER_HELLO_DONE ||
+         context->state == TLS_STATE_ENCRYPTED_EXTENSIONS ||
+         context->state == TLS_STATE_SERVER_CERTIFICATE_VERIFY ||
+         context->state == TLS_STATE_SERVER_FINISHED)
+      {
+         res = TRUE;
+      }
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //The TLS 1.2 NewSessionTicket message is coalesced with the server's
+      //ChangeCipherSpec and Finished messages
+      if(context->state == TLS_STATE_NEW_SESSION_TICKET &&
+         context->version <= TLS_VERSION_1_2)
+      {
+         res = TRUE;
+      }
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //The TLS 1.3 NewSessionTicket messages are all protected under the
+      //application traffic keys, hence they are sent as a single batch
+      if(context->state == TLS_STATE_NEW_SESSION_TICKET &&
+         context->version == TLS_VERSION_1_3)
+      {
+         res = TRUE;
+      }
+#endif
+   }
+#endif
+
+   //Return TRUE if the message belongs to the flight
+   return res;
+}
+
+
+/**
+ * @brief Check whether the server is still producing its flight
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if the flight is not complete yet, else FALSE
+ **/
+
+bool_t tlsIsFlightInProgress(TlsContext *context)
+{
+   bool_t res;
+
+   //Messages can still be appended to the flight?
+   res = tlsCanAppendToFlight(context);
+
+#if (TLS_SERVER_SUPPORT == ENABLED && TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   //The ChangeCipherSpec message and the key changes do not end the flight
+   if(!res && context->entity == TLS_CONNECTION_END_SERVER &&
+      context->transportProtocol == TLS_TRANSPORT_PROTOCOL_STREAM)
+   {
+      //Check current state
+      if(context->state == TLS_STATE_SERVER_CHANGE_CIPHER_SPEC ||
+         context->state == TLS_STATE_HANDSHAKE_TRAFFIC_KEYS ||
+         context->state == TLS_STATE_SERVER_APP_TRAFFIC_KEYS)
+      {
+         res = TRUE;
+      }
+   }
+#endif
+
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED && TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   //The ClientHello and the 0-RTT data of a client using TCP Fast Open are
+   //kept together until the last early data record has been encoded
+   if(!res && context->fastOpenFlight)
+   {
+      res = TRUE;
+   }
+#endif
+
+   //Return TRUE if the flight is not complete yet
+   return res;
+}
+
+
+/**
+ * @brief Append a handshake message to the current flight
+ *
+ * The message is left in place, right behind the messages already queued
+ * in the TX buffer. The accumulated messages are packed into records when
+ * the room left at the end of the buffer could no longer absorb the next
+ * message, or when the flight moves to other keys or ends
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to the handshake message
+ * @param[in] length Length of the handshake message
+ * @return Error code
+ **/
+
+error_t tlsAppendToFlight(TlsContext *context, const void *data,
+   size_t length)
+{
+#if (TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+   size_t limit;
+
+   //Make sure the message fits in the TX buffer
+   if(length > context->txBufferMaxLen)
+      return ERROR_MESSAGE_TOO_LONG;
+
+   //The message must immediately follow the messages of the flight
+   if((const uint8_t *) data != context->txBuffer + context->txFlightLen ||
+      context->txBufferLen != context->txFlightLen)
+   {
+      //Send the message on its own
+      return tlsWriteProtocolData(context, data, length, TLS_TYPE_HANDSHAKE);
+   }
+
+   //The records of the flight are kept together until the flight ends
+   context->txFlightActive = TRUE;
+
+   //Append the message to the flight
+   context->txFlightLen += length;
+   //The next message will be formatted behind the current one
+   context->txBufferLen = context->txFlightLen;
+
+   //Worst-case expansion of a full-sized record (including the inner content
+   //type of TLS 1.3)
+   n = sizeof(TlsRecord) + tlsComputeEncryptionOverhead(
+      &context->encryptionEngine, tlsGetTxFragmentLimit(context)) + 1;
+
+   //The next message may be as long as the TX buffer allows. The messages
+   //are kept in place only if such a message would still leave enough room
+   //to encode the whole flight into records
+   limit = context->txBufferSize - context->txBufferMaxLen;
+   limit = (limit > n) ? (limit - n) : 0;
+
+   //Check the number of bytes accumulated so far
+   if(context->txFlightLen > limit)
+   {
+      //Pack the accumulated messages into records
+      tlsPackFlight(context);
+      //Encode and send the records
+      error = tlsWriteProtocolData(context, NULL, 0, TLS_TYPE_NONE);
+   }
+   else
+   {
+      //More messages can be appended
+      error = NO_ERROR;
+   }
+
+   //Return status code
+   return error;
+#else
+   //Flight coalescing is not implemented
+   return tlsWriteProtocolData(context, data, length, TLS_TYPE_HANDSHAKE);
+#endif
+}
+
+
+/**
+ * @brief Pack the messages of the flight into records
+ *
+ * The accumulated handshake messages are handed to the record layer as a
+ * single payload, which is then split into as few records as the record
+ * size limits allow
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsPackFlight(TlsContext *context)
+{
+#if (TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   size_t n;
+
+   //Number of bytes accumulated in the TX buffer
+   n = context->txFlightLen;
+
+   //Any handshake message waiting to be packed?
+   if(n > 0)
+   {
+      //Make room for the encryption overhead
+      memmove(context->txBuffer + context->txBufferSize - n, context->txBuffer,
+         n);
+
+      //Save record type
+      context->txBufferType = TLS_TYPE_HANDSHAKE;
+      //Set the length of the buffer
+      context->txBufferLen = n;
+      //Point to the beginning of the buffer
+      context->txBufferPos = 0;
+
+      //The handshake messages have already been reported as sent
+      context->txDataAccepted = TRUE;
+      //The messages now belong to the record layer
+      context->txFlightLen = 0;
+   }
+#endif
+}
+
 #endif
@@ -43,6 +43,11 @@ extern "C" {
 error_t tlsInitHandshake(TlsContext *context);
 
 error_t tlsPerformHandshake(TlsContext *context);
+bool_t tlsIsPostHandshakeState(TlsContext *context);
+bool_t tlsIsFalseStartState(TlsContext *context);
+
+error_t tlsAllocHandshakeContext(TlsContext *context);
+void tlsFreeHandshakeContext(TlsContext *context);
 
 error_t tlsSendHandshakeMessage(TlsContext *context, const void *data,
    size_t length, TlsMessageType type);
@@ -52,6 +57,17 @@ error_t tlsReceiveHandshakeMessage(TlsContext *context);
 error_t tlsParseHandshakeMessage(TlsContext *context, const uint8_t *message,
    size_t length);
 
+error_t tlsParseHandshakeFragment(TlsContext *context, const uint8_t *data,
+   size_t length);
+
+bool_t tlsCanAppendToFlight(TlsContext *context);
+bool_t tlsIsFlightInProgress(TlsContext *context);
+
+error_t tlsAppendToFlight(TlsContext *context, const void *data,
+   size_t length);
+
+void tlsPackFlight(TlsContext *context);
+
 //C++ guard
 #ifdef __cplusplus
 }
@@ -0,0 +1,568 @@
+/**
+ * @file tls_handshake_executor.c
+ * @brief Handshake executor
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_handshake_executor.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_HANDSHAKE_EXECUTOR_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a handshake executor
+ *
+ * The executor runs the handshake steps of any number of TLS contexts on a
+ * set of worker threads, so that the CPU-bound part of the negotiation
+ * (signatures, key exchange, certificate validation, key derivation) does
+ * not delay the other connections owned by the I/O threads. The worker
+ * threads are owned by the application, each of them calling
+ * tlsRunHandshakeExecutor in a loop with its own index. One worker per core
+ * is the usual sizing
+ *
+ * @param[in] numWorkers Number of worker threads
+ * @param[in] queueSize Maximum number of steps queued to each worker
+ * @return Handle referencing the newly created executor
+ **/
+
+TlsHandshakeExecutor *tlsInitHandshakeExecutor(uint_t numWorkers,
+   uint_t queueSize)
+{
+   uint_t i;
+   size_t n;
+   TlsHandshakeExecutor *executor;
+   TlsHandshakeWorker *worker;
+
+   //Check parameters
+   if(numWorkers == 0 || queueSize == 0)
+      return NULL;
+
+   //Size of the memory required
+   n = sizeof(TlsHandshakeExecutor) + numWorkers * sizeof(TlsHandshakeWorker);
+
+   //Allocate a memory buffer to hold the executor
+   executor = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(executor == NULL)
+      return NULL;
+
+   //Clear the executor
+   memset(executor, 0, n);
+
+   //Create a mutex to protect the submission index
+   if(!osCreateMutex(&executor->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(executor);
+      //Report an error
+      return NULL;
+   }
+
+   //Save the capacity of the queues
+   executor->queueSize = queueSize;
+
+   //Initialize the workers
+   for(i = 0; i < numWorkers; i++)
+   {
+      //Point to the current worker
+      worker = &executor->workers[i];
+
+      //Allocate the queue of pending steps
+      worker->queue = tlsAllocMem(queueSize * sizeof(TlsContext *));
+      //Failed to allocate memory?
+      if(worker->queue == NULL)
+         break;
+
+      //Create a mutex to prevent simultaneous access to the queue
+      if(!osCreateMutex(&worker->mutex))
+      {
+         //Clean up side effects
+         tlsFreeMem(worker->queue);
+         break;
+      }
+
+      //Create an event object to wake up the worker thread
+      if(!osCreateEvent(&worker->event))
+      {
+         //Clean up side effects
+         osDeleteMutex(&worker->mutex);
+         tlsFreeMem(worker->queue);
+         break;
+      }
+
+      //The worker is now fully initialized
+      executor->numWorkers++;
+   }
+
+   //Failed to initialize the workers?
+   if(executor->numWorkers < numWorkers)
+   {
+      //Clean up side effects
+      tlsFreeHandshakeExecutor(executor);
+      //Report an error
+      return NULL;
+   }
+
+   //Return a pointer to the newly created executor
+   return executor;
+}
+
+
+/**
+ * @brief Register completion callback function
+ *
+ * The callback is invoked on the worker thread once a handshake step has
+ * been run. It receives the result of tlsHandshakeStep, so that the I/O
+ * thread can arm the right interest and submit the next step when the event
+ * occurs. The TLS context is handed back to the application before the
+ * callback is invoked
+ *
+ * @param[in] executor Pointer to the handshake executor
+ * @param[in] callback Completion callback function
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsSetHandshakeExecutorCallback(TlsHandshakeExecutor *executor,
+   TlsHandshakeStepCallback callback, void *param)
+{
+   //Check parameters
+   if(executor == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the executor
+   osAcquireMutex(&executor->mutex);
+
+   //Save the completion callback function
+   executor->callback = callback;
+   executor->param = param;
+
+   //Release exclusive access to the executor
+   osReleaseMutex(&executor->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Hand the next handshake step of a TLS context to the executor
+ *
+ * The step is queued to an idle worker if there is one, otherwise to the
+ * next worker with room in its queue. The application must not access the
+ * TLS context until the completion callback has been invoked
+ *
+ * @param[in] executor Pointer to the handshake executor
+ * @param[in] context Pointer to the TLS context
+ * @return Error code (ERROR_OUT_OF_RESOURCES if all the queues are full, in
+ *   which case the step can be run on the calling thread)
+ **/
+
+error_t tlsSubmitHandshakeStep(TlsHandshakeExecutor *executor,
+   TlsContext *context)
+{
+   uint_t i;
+   uint_t j;
+   uint_t start;
+   uint_t pass;
+   TlsHandshakeWorker *worker;
+
+   //Check parameters
+   if(executor == NULL || context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the executor
+   osAcquireMutex(&executor->mutex);
+
+   //A step of this context is already queued or running?
+   if(context->executorState != TLS_EXECUTOR_STATE_IDLE)
+   {
+      //Release exclusive access to the executor
+      osReleaseMutex(&executor->mutex);
+      //Report an error
+      return ERROR_WRONG_STATE;
+   }
+
+   //Nobody would be notified of the completion of the step
+   if(executor->callback == NULL)
+   {
+      //Release exclusive access to the executor
+      osReleaseMutex(&executor->mutex);
+      //Report an error
+      return ERROR_NOT_CONFIGURED;
+   }
+
+   //The context belongs to the executor from now on
+   context->executorState = TLS_EXECUTOR_STATE_QUEUED;
+
+   //Spread the steps over the workers
+   start = executor->nextWorker;
+   executor->nextWorker = (start + 1) % executor->numWorkers;
+
+   //Release exclusive access to the executor
+   osReleaseMutex(&executor->mutex);
+
+   //The first pass looks for an idle worker, the second one for a worker
+   //with room in its queue
+   for(pass = 0; pass < 2; pass++)
+   {
+      //Loop through the workers
+      for(i = 0; i < executor->numWorkers; i++)
+      {
+         //Point to the current worker
+         worker = &executor->workers[(start + i) % executor->numWorkers];
+
+         //Acquire exclusive access to the queue
+         osAcquireMutex(&worker->mutex);
+
+         //Suitable worker?
+         if((pass == 0 && !worker->busy && worker->count == 0) ||
+            (pass == 1 && worker->count < executor->queueSize))
+         {
+            //Append the step to the queue
+            j = (worker->head + worker->count) % executor->queueSize;
+            worker->queue[j] = context;
+            worker->count++;
+
+            //Wake up the worker thread
+            osSetEvent(&worker->event);
+
+            //Release exclusive access to the queue
+            osReleaseMutex(&worker->mutex);
+
+            //Successful processing
+            return NO_ERROR;
+         }
+
+         //Release exclusive access to the queue
+         osReleaseMutex(&worker->mutex);
+      }
+   }
+
+   //Acquire exclusive access to the executor
+   osAcquireMutex(&executor->mutex);
+   //The step could not be queued, so the context is handed back
+   context->executorState = TLS_EXECUTOR_STATE_IDLE;
+   //Release exclusive access to the executor
+   osReleaseMutex(&executor->mutex);
+
+   //All the queues are full
+   return ERROR_OUT_OF_RESOURCES;
+}
+
+
+/**
+ * @brief Run the handshake steps queued to a worker
+ *
+ * This function is intended to be called in a loop by each worker thread.
+ * It waits until steps are queued (or the timeout elapses), then runs them
+ * until there is nothing left, either in its own queue or in the queues of
+ * the other workers
+ *
+ * @param[in] executor Pointer to the handshake executor
+ * @param[in] index Index of the worker, from 0 to numWorkers - 1
+ * @param[in] timeout Maximum time to wait for a handshake step
+ * @return Error code
+ **/
+
+error_t tlsRunHandshakeExecutor(TlsHandshakeExecutor *executor,
+   uint_t index, systime_t timeout)
+{
+   bool_t stolen;
+   TlsContext *context;
+   TlsHandshakeWorker *worker;
+
+   //Check parameters
+   if(executor == NULL || index >= executor->numWorkers)
+      return ERROR_INVALID_PARAMETER;
+
+   //Point to the worker
+   worker = &executor->workers[index];
+
+   //Wait until a step is queued
+   osWaitForEvent(&worker->event, timeout);
+
+   //Run the pending steps
+   while(1)
+   {
+      //Take the oldest step of the worker
+      context = tlsPopHandshakeStep(executor, index);
+      stolen = FALSE;
+
+      //The queue of the worker is empty?
+      if(context == NULL)
+      {
+         //Take a step from another worker
+         context = tlsStealHandshakeStep(executor, index);
+         stolen = TRUE;
+      }
+
+      //Nothing left to do?
+      if(context == NULL)
+         break;
+
+      //Acquire exclusive access to the worker
+      osAcquireMutex(&worker->mutex);
+
+      //Update statistics
+      worker->stepCount++;
+
+      if(stolen)
+         worker->stealCount++;
+
+      //Release exclusive access to the worker
+      osReleaseMutex(&worker->mutex);
+
+      //Progress the handshake as far as possible
+      tlsRunHandshakeStep(executor, context);
+   }
+
+   //Acquire exclusive access to the worker
+   osAcquireMutex(&worker->mutex);
+   //The worker is idle again
+   worker->busy = FALSE;
+   //Release exclusive access to the worker
+   osReleaseMutex(&worker->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Remove the oldest handshake step from the queue of a worker
+ *
+ * Another worker is woken up whenever steps are left behind, so that they
+ * can be stolen while this worker is busy
+ *
+ * @param[in] executor Pointer to the handshake executor
+ * @param[in] index Index of the worker
+ * @return Pointer to the TLS context (NULL if the queue is empty)
+ **/
+
+TlsContext *tlsPopHandshakeStep(TlsHandshakeExecutor *executor,
+   uint_t index)
+{
+   uint_t count;
+   TlsContext *context;
+   TlsHandshakeWorker *worker;
+
+   //Point to the worker
+   worker = &executor->workers[index];
+
+   //Acquire exclusive access to the queue
+   osAcquireMutex(&worker->mutex);
+
+   //Any step pending?
+   if(worker->count > 0)
+   {
+      //Remove the oldest step from the queue
+      context = worker->queue[worker->head];
+      worker->head = (worker->head + 1) % executor->queueSize;
+      worker->count--;
+
+      //The worker is running a step
+      worker->busy = TRUE;
+   }
+   else
+   {
+      //The queue is empty
+      context = NULL;
+   }
+
+   //Number of steps left behind
+   count = worker->count;
+
+   //Release exclusive access to the queue
+   osReleaseMutex(&worker->mutex);
+
+   //Let another worker steal the remaining steps
+   if(count > 0 && executor->numWorkers > 1)
+   {
+      osSetEvent(&executor->workers[(index + 1) %
+         executor->numWorkers].event);
+   }
+
+   //Return a pointer to the TLS context
+   return context;
+}
+
+
+/**
+ * @brief Take the oldest handshake step queued to another worker
+ * @param[in] executor Pointer to the handshake executor
+ * @param[in] index Index of the worker looking for work
+ * @return Pointer to the TLS context (NULL if all the queues are empty)
+ **/
+
+TlsContext *tlsStealHandshakeStep(TlsHandshakeExecutor *executor,
+   uint_t index)
+{
+   uint_t i;
+   TlsContext *context;
+   TlsHandshakeWorker *worker;
+   TlsHandshakeWorker *victim;
+
+   //Point to the worker looking for work
+   worker = &executor->workers[index];
+
+   //Initialize pointer
+   context = NULL;
+
+   //Loop through the other workers
+   for(i = 1; i < executor->numWorkers && context == NULL; i++)
+   {
+      //Point to the current worker
+      victim = &executor->workers[(index + i) % executor->numWorkers];
+
+      //Acquire exclusive access to the queue
+      osAcquireMutex(&victim->mutex);
+
+      //Any step pending?
+      if(victim->count > 0)
+      {
+         //Remove the oldest step from the queue
+         context = victim->queue[victim->head];
+         victim->head = (victim->head + 1) % executor->queueSize;
+         victim->count--;
+      }
+
+      //Release exclusive access to the queue
+      osReleaseMutex(&victim->mutex);
+   }
+
+   //Any step stolen?
+   if(context != NULL)
+   {
+      //Acquire exclusive access to the worker
+      osAcquireMutex(&worker->mutex);
+      //The worker is running a step
+      worker->busy = TRUE;
+      //Release exclusive access to the worker
+      osReleaseMutex(&worker->mutex);
+   }
+
+   //Return a pointer to the TLS context
+   return context;
+}
+
+
+/**
+ * @brief Run a handshake step and report its result
+ *
+ * The socket operations performed by the handshake must be non-blocking,
+ * so that a worker never waits for the network. The context is handed back
+ * to the application before the completion callback is invoked, so that
+ * the callback can submit the next step right away
+ *
+ * @param[in] executor Pointer to the handshake executor
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsRunHandshakeStep(TlsHandshakeExecutor *executor, TlsContext *context)
+{
+   error_t error;
+   uint_t events;
+   systime_t timeout;
+   TlsHandshakeStepCallback callback;
+   void *param;
+
+   //Acquire exclusive access to the executor
+   osAcquireMutex(&executor->mutex);
+   //The step is about to run
+   context->executorState = TLS_EXECUTOR_STATE_RUNNING;
+   //Release exclusive access to the executor
+   osReleaseMutex(&executor->mutex);
+
+   //Progress the handshake as far as possible without blocking
+   error = tlsHandshakeStep(context, &events, &timeout);
+
+   //Acquire exclusive access to the executor
+   osAcquireMutex(&executor->mutex);
+
+   //Retrieve the completion callback function
+   callback = executor->callback;
+   param = executor->param;
+
+   //The context belongs to the application again
+   context->executorState = TLS_EXECUTOR_STATE_IDLE;
+
+   //Release exclusive access to the executor
+   osReleaseMutex(&executor->mutex);
+
+   //Notify the application
+   if(callback != NULL)
+   {
+      callback(context, error, events, timeout, param);
+   }
+}
+
+
+/**
+ * @brief Release handshake executor
+ *
+ * The worker threads must have been stopped and no handshake step may be
+ * pending anymore
+ *
+ * @param[in] executor Pointer to the handshake executor
+ **/
+
+void tlsFreeHandshakeExecutor(TlsHandshakeExecutor *executor)
+{
+   uint_t i;
+
+   //Valid executor?
+   if(executor != NULL)
+   {
+      //Release the workers
+      for(i = 0; i < executor->numWorkers; i++)
+      {
+         //Release previously allocated resources
+         osDeleteEvent(&executor->workers[i].event);
+         osDeleteMutex(&executor->workers[i].mutex);
+
+         //Free previously allocated memory
+         tlsFreeMem(executor->workers[i].queue);
+      }
+
+      //Release previously allocated resources
+      osDeleteMutex(&executor->mutex);
+
+      //Free previously allocated memory
+      tlsFreeMem(executor);
+   }
+}
+
+#endif
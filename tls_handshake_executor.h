@@ -0,0 +1,70 @@
+/**
+ * @file tls_handshake_executor.h
+ * @brief Handshake executor
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_HANDSHAKE_EXECUTOR_H
+#define _TLS_HANDSHAKE_EXECUTOR_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Handshake executor management
+TlsHandshakeExecutor *tlsInitHandshakeExecutor(uint_t numWorkers,
+   uint_t queueSize);
+
+error_t tlsSetHandshakeExecutorCallback(TlsHandshakeExecutor *executor,
+   TlsHandshakeStepCallback callback, void *param);
+
+error_t tlsSubmitHandshakeStep(TlsHandshakeExecutor *executor,
+   TlsContext *context);
+
+error_t tlsRunHandshakeExecutor(TlsHandshakeExecutor *executor,
+   uint_t index, systime_t timeout);
+
+TlsContext *tlsPopHandshakeStep(TlsHandshakeExecutor *executor,
+   uint_t index);
+
+TlsContext *tlsStealHandshakeStep(TlsHandshakeExecutor *executor,
+   uint_t index);
+
+void tlsRunHandshakeStep(TlsHandshakeExecutor *executor, TlsContext *context);
+
+void tlsFreeHandshakeExecutor(TlsHandshakeExecutor *executor);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
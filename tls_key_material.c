@@ -34,6 +34,7 @@
 //Dependencies
 #include <string.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_key_material.h"
 #include "tls_transcript_hash.h"
 #include "tls13_key_material.h"
@@ -65,7 +66,7 @@ error_t tlsGenerateSessionKeys(TlsContext *context)
       cipherSuite->fixedIvLen);
 
    //Make sure that the key block is large enough
-   if(keyBlockLen > sizeof(context->keyBlock))
+   if(keyBlockLen > sizeof(context->handshake->keyBlock))
       return ERROR_FAILURE;
 
    //Debug message
@@ -81,7 +82,8 @@ error_t tlsGenerateSessionKeys(TlsContext *context)
    {
       //Debug message
       TRACE_DEBUG("  Premaster secret:\r\n");
-      TRACE_DEBUG_ARRAY("    ", context->premasterSecret, context->premasterSecretLen);
+      TRACE_DEBUG_ARRAY("    ", context->handshake->premasterSecret,
+         context->handshake->premasterSecretLen);
 
 #if (TLS_EXT_MASTER_SECRET_SUPPORT == ENABLED)
       //If both the ClientHello and ServerHello contain the ExtendedMasterSecret
@@ -104,7 +106,7 @@ error_t tlsGenerateSessionKeys(TlsContext *context)
 
       //The premaster secret should be deleted from memory once the master
       //secret has been computed
-      memset(context->premasterSecret, 0, TLS_PREMASTER_SECRET_SIZE);
+      memset(context->handshake->premasterSecret, 0, TLS_PREMASTER_SECRET_SIZE);
    }
 
    //Debug message
@@ -125,7 +127,7 @@ error_t tlsGenerateSessionKeys(TlsContext *context)
 
    //Debug message
    TRACE_DEBUG("  Key block:\r\n");
-   TRACE_DEBUG_ARRAY("    ", context->keyBlock, keyBlockLen);
+   TRACE_DEBUG_ARRAY("    ", context->handshake->keyBlock, keyBlockLen);
 
    //Successful processing
    return NO_ERROR;
@@ -156,8 +158,8 @@ error_t tlsGenerateMasterSecret(TlsContext *context)
    if(context->version == SSL_VERSION_3_0)
    {
       //SSL 3.0 does not use a PRF, instead makes use abundantly of MD5
-      error = sslExpandKey(context->premasterSecret,
-         context->premasterSecretLen, random, sizeof(random),
+      error = sslExpandKey(context->handshake->premasterSecret,
+         context->handshake->premasterSecretLen, random, sizeof(random),
          context->masterSecret, TLS_MASTER_SECRET_SIZE);
    }
    else
@@ -167,7 +169,8 @@ error_t tlsGenerateMasterSecret(TlsContext *context)
    if(context->version == TLS_VERSION_1_0 || context->version == TLS_VERSION_1_1)
    {
       //TLS 1.0 and 1.1 use a PRF that combines MD5 and SHA-1
-      error = tlsPrf(context->premasterSecret, context->premasterSecretLen,
+      error = tlsPrf(context->handshake->premasterSecret,
+         context->handshake->premasterSecretLen,
          "master secret", random, sizeof(random), context->masterSecret,
          TLS_MASTER_SECRET_SIZE);
    }
@@ -180,7 +183,8 @@ error_t tlsGenerateMasterSecret(TlsContext *context)
       //TLS 1.2 PRF uses SHA-256 or a stronger hash algorithm as the core
       //function in its construction
       error = tls12Prf(context->cipherSuite.prfHashAlgo,
-         context->premasterSecret, context->premasterSecretLen,
+         context->handshake->premasterSecret,
+         context->handshake->premasterSecretLen,
          "master secret", random, sizeof(random), context->masterSecret,
          TLS_MASTER_SECRET_SIZE);
    }
@@ -232,7 +236,8 @@ error_t tlsGenerateExtendedMasterSecret(TlsContext *context)
       if(!error)
       {
          //Compute the extended master secret (refer to RFC 7627, section 4)
-         error = tlsPrf(context->premasterSecret, context->premasterSecretLen,
+         error = tlsPrf(context->handshake->premasterSecret,
+            context->handshake->premasterSecretLen,
             "extended master secret", sessionHash, sizeof(sessionHash),
             context->masterSecret, TLS_MASTER_SECRET_SIZE);
       }
@@ -250,7 +255,8 @@ error_t tlsGenerateExtendedMasterSecret(TlsContext *context)
       hashAlgo = context->cipherSuite.prfHashAlgo;
 
       //Allocate hash algorithm context
-      hashContext = tlsAllocMem(hashAlgo->contextSize);
+      hashContext = tlsAllocHandshakeObject(context,
+         TLS_MEM_CLASS_HASH_CONTEXT, hashAlgo->contextSize);
 
       //Successful memory allocation?
       if(hashContext != NULL)
@@ -263,13 +269,14 @@ error_t tlsGenerateExtendedMasterSecret(TlsContext *context)
          hashAlgo->final(hashContext, NULL);
 
          //Compute the extended master secret (refer to RFC 7627, section 4)
-         error = tls12Prf(hashAlgo, context->premasterSecret,
-            context->premasterSecretLen, "extended master secret",
+         error = tls12Prf(hashAlgo, context->handshake->premasterSecret,
+            context->handshake->premasterSecretLen, "extended master secret",
             hashContext->digest, hashAlgo->digestSize,
             context->masterSecret, TLS_MASTER_SECRET_SIZE);
 
          //Release previously allocated memory
-         tlsFreeMem(hashContext);
+         tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+            hashContext);
       }
       else
       {
@@ -320,13 +327,13 @@ error_t tlsGeneratePskPremasterSecret(TlsContext *context)
          //The premaster secret is formed as follows: if the PSK is N octets
          //long, concatenate a uint16 with the value N, N zero octets, a second
          //uint16 with the value N, and the PSK itself
-         STORE16BE(n, context->premasterSecret);
-         memset(context->premasterSecret + 2, 0, n);
-         STORE16BE(n, context->premasterSecret + n + 2);
-         memcpy(context->premasterSecret + n + 4, context->psk, n);
+         STORE16BE(n, context->handshake->premasterSecret);
+         memset(context->handshake->premasterSecret + 2, 0, n);
+         STORE16BE(n, context->handshake->premasterSecret + n + 2);
+         memcpy(context->handshake->premasterSecret + n + 4, context->psk, n);
 
          //Save the length of the premaster secret
-         context->premasterSecretLen = n * 2 + 4;
+         context->handshake->premasterSecretLen = n * 2 + 4;
 
          //Premaster secret successfully generated
          error = NO_ERROR;
@@ -346,32 +353,36 @@ error_t tlsGeneratePskPremasterSecret(TlsContext *context)
       context->keyExchMethod == TLS_KEY_EXCH_DHE_PSK ||
       context->keyExchMethod == TLS_KEY_EXCH_ECDHE_PSK)
    {
+      size_t m;
       size_t n;
+      uint8_t *p;
 
+      //Point to the premaster secret
+      p = context->handshake->premasterSecret;
+      //Length of the "other_secret" field
+      m = context->handshake->premasterSecretLen;
       //Let N be the length of pre-shared key
       n = context->pskLen;
 
       //Check whether the output buffer is large enough to hold the premaster
       //secret
-      if((context->premasterSecretLen + n + 4) <= TLS_PREMASTER_SECRET_SIZE)
+      if((m + n + 4) <= TLS_PREMASTER_SECRET_SIZE)
       {
          //The "other_secret" field comes from the Diffie-Hellman, ECDH or
          //RSA exchange (DHE_PSK, ECDH_PSK and RSA_PSK, respectively)
-         memmove(context->premasterSecret + 2, context->premasterSecret,
-            context->premasterSecretLen);
+         memmove(p + 2, p, m);
 
          //The "other_secret" field is preceded by a 2-byte length field
-         STORE16BE(context->premasterSecretLen, context->premasterSecret);
+         STORE16BE(m, p);
 
          //if the PSK is N octets long, concatenate a uint16 with the value N
-         STORE16BE(n, context->premasterSecret + context->premasterSecretLen + 2);
+         STORE16BE(n, p + m + 2);
 
          //Concatenate the PSK itself
-         memcpy(context->premasterSecret + context->premasterSecretLen + 4,
-            context->psk, n);
+         memcpy(p + m + 4, context->psk, n);
 
          //Adjust the length of the premaster secret
-         context->premasterSecretLen += n + 4;
+         context->handshake->premasterSecretLen = m + n + 4;
 
          //Premaster secret successfully generated
          error = NO_ERROR;
@@ -417,7 +428,7 @@ error_t tlsGenerateKeyBlock(TlsContext *context, size_t keyBlockLen)
    {
       //SSL 3.0 does not use a PRF, instead makes use abundantly of MD5
       error = sslExpandKey(context->masterSecret, TLS_MASTER_SECRET_SIZE,
-         random, sizeof(random), context->keyBlock, keyBlockLen);
+         random, sizeof(random), context->handshake->keyBlock, keyBlockLen);
    }
    else
 #endif
@@ -427,7 +438,7 @@ error_t tlsGenerateKeyBlock(TlsContext *context, size_t keyBlockLen)
    {
       //TLS 1.0 and 1.1 use a PRF that combines MD5 and SHA-1
       error = tlsPrf(context->masterSecret, TLS_MASTER_SECRET_SIZE,
-         "key expansion", random, sizeof(random), context->keyBlock,
+         "key expansion", random, sizeof(random), context->handshake->keyBlock,
          keyBlockLen);
    }
    else
@@ -440,7 +451,7 @@ error_t tlsGenerateKeyBlock(TlsContext *context, size_t keyBlockLen)
       //as the core function in its construction
       error = tls12Prf(context->cipherSuite.prfHashAlgo,
          context->masterSecret, TLS_MASTER_SECRET_SIZE, "key expansion",
-         random, sizeof(random), context->keyBlock, keyBlockLen);
+         random, sizeof(random), context->handshake->keyBlock, keyBlockLen);
    }
    else
 #endif
@@ -496,7 +507,7 @@ error_t tlsExportKeyingMaterial(TlsContext *context, const char_t *label,
       n += contextValueLen + 2;
 
    //Allocate a memory buffer to hold the seed
-   seed = tlsAllocMem(n);
+   seed = tlsAllocHandshakeMem(context, n);
    //Failed to allocate memory?
    if(seed == NULL)
       return ERROR_OUT_OF_RESOURCES;
@@ -594,7 +605,7 @@ error_t tlsExportKeyingMaterial(TlsContext *context, const char_t *label,
    }
 
    //Release previously allocated memory
-   tlsFreeMem(seed);
+   tlsFreeHandshakeMem(context, seed);
 
    //Return status code
    return error;
@@ -631,14 +642,22 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLen, const char_t *label,
    const uint8_t *s1;
    const uint8_t *s2;
    HmacContext *hmacContext;
+   HmacContext *keyedContext;
    uint8_t a[SHA1_DIGEST_SIZE];
 
-   //Allocate a memory buffer to hold the HMAC context
-   hmacContext = tlsAllocMem(sizeof(HmacContext));
+   //Account for the HMAC-based derivation
+   TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+
+   //Allocate a memory buffer to hold the HMAC contexts
+   hmacContext = tlsAllocObject(TLS_MEM_CLASS_HMAC_CONTEXT,
+      2 * sizeof(HmacContext));
 
    //Successful memory allocation?
    if(hmacContext != NULL)
    {
+      //The second context holds the HMAC state once keyed with the secret
+      keyedContext = hmacContext + 1;
+
       //Retrieve the length of the label
       labelLen = strlen(label);
 
@@ -650,8 +669,11 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLen, const char_t *label,
       //S2 is taken from the second half
       s2 = secret + secretLen - sLen;
 
+      //Key HMAC once with S1
+      hmacInit(keyedContext, MD5_HASH_ALGO, s1, sLen);
+
       //First compute A(1) = HMAC_MD5(S1, label + seed)
-      hmacInit(hmacContext, MD5_HASH_ALGO, s1, sLen);
+      memcpy(hmacContext, keyedContext, sizeof(HmacContext));
       hmacUpdate(hmacContext, label, labelLen);
       hmacUpdate(hmacContext, seed, seedLen);
       hmacFinal(hmacContext, a);
@@ -660,7 +682,7 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLen, const char_t *label,
       for(i = 0; i < outputLen; )
       {
          //Compute HMAC_MD5(S1, A(i) + label + seed)
-         hmacInit(hmacContext, MD5_HASH_ALGO, s1, sLen);
+         memcpy(hmacContext, keyedContext, sizeof(HmacContext));
          hmacUpdate(hmacContext, a, MD5_DIGEST_SIZE);
          hmacUpdate(hmacContext, label, labelLen);
          hmacUpdate(hmacContext, seed, seedLen);
@@ -673,13 +695,16 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLen, const char_t *label,
          }
 
          //Compute A(i + 1) = HMAC_MD5(S1, A(i))
-         hmacInit(hmacContext, MD5_HASH_ALGO, s1, sLen);
+         memcpy(hmacContext, keyedContext, sizeof(HmacContext));
          hmacUpdate(hmacContext, a, MD5_DIGEST_SIZE);
          hmacFinal(hmacContext, a);
       }
 
+      //Key HMAC once with S2
+      hmacInit(keyedContext, SHA1_HASH_ALGO, s2, sLen);
+
       //First compute A(1) = HMAC_SHA1(S2, label + seed)
-      hmacInit(hmacContext, SHA1_HASH_ALGO, s2, sLen);
+      memcpy(hmacContext, keyedContext, sizeof(HmacContext));
       hmacUpdate(hmacContext, label, labelLen);
       hmacUpdate(hmacContext, seed, seedLen);
       hmacFinal(hmacContext, a);
@@ -688,7 +713,7 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLen, const char_t *label,
       for(i = 0; i < outputLen; )
       {
          //Compute HMAC_SHA1(S2, A(i) + label + seed)
-         hmacInit(hmacContext, SHA1_HASH_ALGO, s2, sLen);
+         memcpy(hmacContext, keyedContext, sizeof(HmacContext));
          hmacUpdate(hmacContext, a, SHA1_DIGEST_SIZE);
          hmacUpdate(hmacContext, label, labelLen);
          hmacUpdate(hmacContext, seed, seedLen);
@@ -701,13 +726,13 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLen, const char_t *label,
          }
 
          //Compute A(i + 1) = HMAC_SHA1(S2, A(i))
-         hmacInit(hmacContext, SHA1_HASH_ALGO, s2, sLen);
+         memcpy(hmacContext, keyedContext, sizeof(HmacContext));
          hmacUpdate(hmacContext, a, SHA1_DIGEST_SIZE);
          hmacFinal(hmacContext, a);
       }
 
       //Free previously allocated memory
-      tlsFreeMem(hmacContext);
+      tlsFreeObject(TLS_MEM_CLASS_HMAC_CONTEXT, hmacContext);
 
       //Successful processing
       error = NO_ERROR;
@@ -755,19 +780,30 @@ error_t tls12Prf(const HashAlgo *hash, const uint8_t *secret, size_t secretLen,
    size_t n;
    size_t labelLen;
    HmacContext *hmacContext;
+   HmacContext *keyedContext;
    uint8_t a[MAX_HASH_DIGEST_SIZE];
 
-   //Allocate a memory buffer to hold the HMAC context
-   hmacContext = tlsAllocMem(sizeof(HmacContext));
+   //Account for the HMAC-based derivation
+   TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
+
+   //Allocate a memory buffer to hold the HMAC contexts
+   hmacContext = tlsAllocObject(TLS_MEM_CLASS_HMAC_CONTEXT,
+      2 * sizeof(HmacContext));
 
    //Successful memory allocation?
    if(hmacContext != NULL)
    {
+      //The second context holds the HMAC state once keyed with the secret
+      keyedContext = hmacContext + 1;
+
       //Retrieve the length of the label
       labelLen = strlen(label);
 
+      //Key HMAC once with the secret
+      hmacInit(keyedContext, hash, secret, secretLen);
+
       //First compute A(1) = HMAC_hash(secret, label + seed)
-      hmacInit(hmacContext, hash, secret, secretLen);
+      memcpy(hmacContext, keyedContext, sizeof(HmacContext));
       hmacUpdate(hmacContext, label, labelLen);
       hmacUpdate(hmacContext, seed, seedLen);
       hmacFinal(hmacContext, a);
@@ -776,7 +812,7 @@ error_t tls12Prf(const HashAlgo *hash, const uint8_t *secret, size_t secretLen,
       while(outputLen > 0)
       {
          //Compute HMAC_hash(secret, A(i) + label + seed)
-         hmacInit(hmacContext, hash, secret, secretLen);
+         memcpy(hmacContext, keyedContext, sizeof(HmacContext));
          hmacUpdate(hmacContext, a, hash->digestSize);
          hmacUpdate(hmacContext, label, labelLen);
          hmacUpdate(hmacContext, seed, seedLen);
@@ -788,7 +824,7 @@ error_t tls12Prf(const HashAlgo *hash, const uint8_t *secret, size_t secretLen,
          memcpy(output, hmacContext->digest, n);
 
          //Compute A(i + 1) = HMAC_hash(secret, A(i))
-         hmacInit(hmacContext, hash, secret, secretLen);
+         memcpy(hmacContext, keyedContext, sizeof(HmacContext));
          hmacUpdate(hmacContext, a, hash->digestSize);
          hmacFinal(hmacContext, a);
 
@@ -799,7 +835,7 @@ error_t tls12Prf(const HashAlgo *hash, const uint8_t *secret, size_t secretLen,
       }
 
       //Free previously allocated memory
-      tlsFreeMem(hmacContext);
+      tlsFreeObject(TLS_MEM_CLASS_HMAC_CONTEXT, hmacContext);
 
       //Successful processing
       error = NO_ERROR;
@@ -0,0 +1,688 @@
+/**
+ * @file tls_key_pool.c
+ * @brief Pool of pre-generated ephemeral key pairs
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_stats.h"
+#include "tls_key_pool.h"
+#include "tls_ffdhe.h"
+#include "tls_misc.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a pool of pre-generated ephemeral key pairs
+ *
+ * The key pairs are generated ahead of time by a background thread that
+ * calls tlsRefillKeyPairPool, so that the handshake does not have to pay
+ * for the key generation. Each key pair is handed out once and destroyed
+ * as soon as it has been copied to the TLS context
+ *
+ * @param[in] prngAlgo Pseudo-random number generator used to generate the key pairs
+ * @param[in] prngContext Pseudo-random number generator context
+ * @return Handle referencing the newly created pool
+ **/
+
+TlsKeyPairPool *tlsInitKeyPairPool(const PrngAlgo *prngAlgo, void *prngContext)
+{
+   TlsKeyPairPool *keyPairPool;
+
+   //Check parameters
+   if(prngAlgo == NULL || prngContext == NULL)
+      return NULL;
+
+   //Allocate a memory buffer to hold the pool
+   keyPairPool = tlsAllocMem(sizeof(TlsKeyPairPool));
+   //Failed to allocate memory?
+   if(keyPairPool == NULL)
+      return NULL;
+
+   //Clear the pool
+   memset(keyPairPool, 0, sizeof(TlsKeyPairPool));
+
+   //Create a mutex to prevent simultaneous access to the pool
+   if(!osCreateMutex(&keyPairPool->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(keyPairPool);
+      //Report an error
+      return NULL;
+   }
+
+   //Create an event object to wake up the background thread
+   if(!osCreateEvent(&keyPairPool->event))
+   {
+      //Clean up side effects
+      osDeleteMutex(&keyPairPool->mutex);
+      tlsFreeMem(keyPairPool);
+      //Report an error
+      return NULL;
+   }
+
+   //Save parameters
+   keyPairPool->prngAlgo = prngAlgo;
+   keyPairPool->prngContext = prngContext;
+
+   //Return a pointer to the newly created pool
+   return keyPairPool;
+}
+
+
+/**
+ * @brief Add a named group to the pool
+ * @param[in] keyPairPool Pointer to the pool
+ * @param[in] namedGroup ECDHE or FFDHE named group
+ * @param[in] lowWatermark The group is refilled when the number of available
+ *   key pairs falls below this level
+ * @param[in] highWatermark Number of key pairs the group is refilled to
+ * @return Error code
+ **/
+
+error_t tlsAddKeyPairPoolGroup(TlsKeyPairPool *keyPairPool,
+   uint16_t namedGroup, uint_t lowWatermark, uint_t highWatermark)
+{
+   error_t error;
+   uint_t i;
+
+   //Check parameters
+   if(keyPairPool == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The low watermark must be non-zero and cannot exceed the high watermark
+   if(lowWatermark == 0 || lowWatermark > highWatermark)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure the named group is supported
+#if (TLS_FFDHE_SUPPORT == ENABLED)
+   if(tlsGetFfdheGroup(NULL, namedGroup) != NULL)
+   {
+      error = NO_ERROR;
+   }
+   else
+#endif
+#if (TLS_ECDH_SUPPORT == ENABLED)
+   if(tlsGetCurveInfo(NULL, namedGroup) != NULL)
+   {
+      error = NO_ERROR;
+   }
+   else
+#endif
+   {
+      error = ERROR_ILLEGAL_PARAMETER;
+   }
+
+   //Unsupported named group?
+   if(error)
+      return error;
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&keyPairPool->mutex);
+
+   //Each named group can only be added once
+   for(i = 0; i < keyPairPool->numGroups; i++)
+   {
+      if(keyPairPool->groups[i].namedGroup == namedGroup)
+         break;
+   }
+
+   //Check whether the group is already present
+   if(i < keyPairPool->numGroups)
+   {
+      //Update the watermarks
+      keyPairPool->groups[i].lowWatermark = lowWatermark;
+      keyPairPool->groups[i].highWatermark = highWatermark;
+   }
+   else if(i < TLS_KEY_PAIR_POOL_MAX_GROUPS)
+   {
+      //Add a new group
+      keyPairPool->groups[i].namedGroup = namedGroup;
+      keyPairPool->groups[i].lowWatermark = lowWatermark;
+      keyPairPool->groups[i].highWatermark = highWatermark;
+      keyPairPool->groups[i].numKeyPairs = 0;
+      keyPairPool->groups[i].list = NULL;
+
+      //Update the number of groups
+      keyPairPool->numGroups++;
+   }
+   else
+   {
+      //The table is full
+      error = ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Wake up the background thread so that the group gets filled
+   if(!error)
+   {
+      osSetEvent(&keyPairPool->event);
+   }
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&keyPairPool->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Refill the named groups that fell below their low watermark
+ *
+ * This function is intended to be called in a loop by a low-priority
+ * background thread. It waits until a group falls below its low watermark
+ * (or the timeout elapses), then generates key pairs until every such group
+ * reaches its high watermark. The key pairs are generated outside of the
+ * critical section, so that handshakes are never delayed by the refill
+ *
+ * @param[in] keyPairPool Pointer to the pool
+ * @param[in] timeout Maximum time to wait for a refill request
+ * @return Error code
+ **/
+
+error_t tlsRefillKeyPairPool(TlsKeyPairPool *keyPairPool, systime_t timeout)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint16_t namedGroup;
+   TlsKeyPair *keyPair;
+
+   //Invalid pool?
+   if(keyPairPool == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Wait until a group needs to be refilled
+   osWaitForEvent(&keyPairPool->event, timeout);
+
+   //Loop through the named groups
+   for(i = 0; i < TLS_KEY_PAIR_POOL_MAX_GROUPS && !error; i++)
+   {
+      //Acquire exclusive access to the pool
+      osAcquireMutex(&keyPairPool->mutex);
+
+      //Check whether the group fell below its low watermark
+      if(i < keyPairPool->numGroups &&
+         keyPairPool->groups[i].numKeyPairs < keyPairPool->groups[i].lowWatermark)
+      {
+         //Number of key pairs to be generated
+         namedGroup = keyPairPool->groups[i].namedGroup;
+         n = keyPairPool->groups[i].highWatermark -
+            keyPairPool->groups[i].numKeyPairs;
+      }
+      else
+      {
+         //Nothing to do
+         namedGroup = TLS_GROUP_NONE;
+         n = 0;
+      }
+
+      //Release exclusive access to the pool
+      osReleaseMutex(&keyPairPool->mutex);
+
+      //Generate the missing key pairs
+      while(n > 0 && !error)
+      {
+         //Generate a new ephemeral key pair
+         error = tlsGenerateKeyPair(keyPairPool, namedGroup, &keyPair);
+
+         //Check status code
+         if(!error)
+         {
+            //Acquire exclusive access to the pool
+            osAcquireMutex(&keyPairPool->mutex);
+
+            //Add the key pair to the group
+            keyPair->next = keyPairPool->groups[i].list;
+            keyPairPool->groups[i].list = keyPair;
+            keyPairPool->groups[i].numKeyPairs++;
+
+            //Release exclusive access to the pool
+            osReleaseMutex(&keyPairPool->mutex);
+         }
+
+         //Next key pair
+         n--;
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Remove a pre-generated key pair from the pool
+ * @param[in] keyPairPool Pointer to the pool
+ * @param[in] namedGroup ECDHE or FFDHE named group
+ * @return Pointer to the key pair (NULL if no key pair is available)
+ **/
+
+TlsKeyPair *tlsPopKeyPair(TlsKeyPairPool *keyPairPool, uint16_t namedGroup)
+{
+   uint_t i;
+   TlsKeyPair *keyPair;
+
+   //Initialize pointer
+   keyPair = NULL;
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&keyPairPool->mutex);
+
+   //Loop through the named groups
+   for(i = 0; i < keyPairPool->numGroups; i++)
+   {
+      //Matching named group?
+      if(keyPairPool->groups[i].namedGroup == namedGroup)
+      {
+         //Any key pair available?
+         if(keyPairPool->groups[i].list != NULL)
+         {
+            //Remove the first key pair from the list
+            keyPair = keyPairPool->groups[i].list;
+            keyPairPool->groups[i].list = keyPair->next;
+            keyPairPool->groups[i].numKeyPairs--;
+
+            //Update statistics
+            keyPairPool->hitCount++;
+         }
+         else
+         {
+            //Update statistics
+            keyPairPool->missCount++;
+         }
+
+         //Wake up the background thread when the group runs low
+         if(keyPairPool->groups[i].numKeyPairs <
+            keyPairPool->groups[i].lowWatermark)
+         {
+            osSetEvent(&keyPairPool->event);
+         }
+
+         //We are done
+         break;
+      }
+   }
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&keyPairPool->mutex);
+
+   //Return a pointer to the key pair
+   return keyPair;
+}
+
+
+/**
+ * @brief Take a pre-generated key pair from the pool
+ *
+ * The EC domain parameters or the FFDHE parameters must have been loaded in
+ * the TLS context beforehand. The key pair is copied to the context and
+ * destroyed, so that it cannot be used twice
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] namedGroup ECDHE or FFDHE named group
+ * @return Error code (ERROR_NOT_FOUND if no key pair is available)
+ **/
+
+error_t tlsTakeKeyPair(TlsContext *context, uint16_t namedGroup)
+{
+   error_t error;
+   TlsKeyPair *keyPair;
+
+   //No pool attached to the TLS context?
+   if(context->keyPairPool == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Remove a key pair from the pool
+   keyPair = tlsPopKeyPair(context->keyPairPool, namedGroup);
+
+   //No key pair available?
+   if(keyPair == NULL)
+      return ERROR_NOT_FOUND;
+
+#if (TLS_FFDHE_SUPPORT == ENABLED)
+   //FFDHE group?
+   if(tlsGetFfdheGroup(NULL, namedGroup) != NULL)
+   {
+      //Copy the private value
+      error = mpiCopy(&context->dhContext.xa, &keyPair->privateKey);
+
+      //Check status code
+      if(!error)
+      {
+         //Copy the public value
+         error = mpiCopy(&context->dhContext.ya, &keyPair->publicValue);
+      }
+   }
+   else
+#endif
+#if (TLS_ECDH_SUPPORT == ENABLED)
+   //Elliptic curve group?
+   if(tlsGetCurveInfo(NULL, namedGroup) != NULL)
+   {
+      //Copy the key pair to the ECDH context
+      error = tlsCopyEcdhKeyPair(&context->ecdhContext, keyPair);
+   }
+   else
+#endif
+   //Unknown group?
+   {
+      //Report an error
+      error = ERROR_ILLEGAL_PARAMETER;
+   }
+
+   //The key pair is single-use
+   tlsFreeKeyPair(keyPair);
+
+   //Return status code
+   return error;
+}
+
+
+#if (TLS_ECDH_SUPPORT == ENABLED && TLS_MAX_VERSION >= TLS_VERSION_1_3 && \
+   TLS_MIN_VERSION <= TLS_VERSION_1_3)
+
+/**
+ * @brief Take a pre-generated key pair for the speculative key share
+ *
+ * Unlike tlsTakeKeyPair, no key pair is ever generated on a miss: the
+ * speculative key share is only offered when it comes for free
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] namedGroup ECDHE named group
+ * @return Error code (ERROR_NOT_FOUND if no key pair is available)
+ **/
+
+error_t tlsTakeSpeculativeKeyPair(TlsContext *context, uint16_t namedGroup)
+{
+   error_t error;
+   TlsKeyPair *keyPair;
+
+   //No pool attached to the TLS context?
+   if(context->keyPairPool == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Remove a key pair from the pool
+   keyPair = tlsPopKeyPair(context->keyPairPool, namedGroup);
+
+   //No key pair available?
+   if(keyPair == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Copy the key pair to the ECDH context of the speculative key share
+   error = tlsCopyEcdhKeyPair(&context->speculativeEcdhContext, keyPair);
+
+   //The key pair is single-use
+   tlsFreeKeyPair(keyPair);
+
+   //Return status code
+   return error;
+}
+
+#endif
+
+
+#if (TLS_ECDH_SUPPORT == ENABLED)
+
+/**
+ * @brief Copy a pre-generated ECDHE key pair to an ECDH context
+ * @param[in] ecdhContext Pointer to the ECDH context
+ * @param[in] keyPair Pointer to the key pair
+ * @return Error code
+ **/
+
+error_t tlsCopyEcdhKeyPair(EcdhContext *ecdhContext, const TlsKeyPair *keyPair)
+{
+   error_t error;
+
+   //Copy the private key
+   error = mpiCopy(&ecdhContext->da, &keyPair->privateKey);
+
+   //Check status code
+   if(!error)
+   {
+      //Copy the public key
+      error = ecCopy(&ecdhContext->qa, &keyPair->publicKey);
+   }
+
+   //Return status code
+   return error;
+}
+
+#endif
+
+
+/**
+ * @brief Generate an ephemeral key pair for a given named group
+ * @param[in] keyPairPool Pointer to the pool
+ * @param[in] namedGroup ECDHE or FFDHE named group
+ * @param[out] keyPair Newly generated key pair
+ * @return Error code
+ **/
+
+error_t tlsGenerateKeyPair(TlsKeyPairPool *keyPairPool, uint16_t namedGroup,
+   TlsKeyPair **keyPair)
+{
+   error_t error;
+   TlsKeyPair *newKeyPair;
+#if (TLS_FFDHE_SUPPORT == ENABLED)
+   const TlsFfdheGroup *ffdheGroup;
+#endif
+#if (TLS_ECDH_SUPPORT == ENABLED)
+   const EcCurveInfo *curveInfo;
+#endif
+
+   //Allocate a memory buffer to hold the key pair
+   newKeyPair = tlsAllocMem(sizeof(TlsKeyPair));
+   //Failed to allocate memory?
+   if(newKeyPair == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Initialize the key pair
+   newKeyPair->next = NULL;
+   mpiInit(&newKeyPair->privateKey);
+   ecInit(&newKeyPair->publicKey);
+   mpiInit(&newKeyPair->publicValue);
+
+#if (TLS_FFDHE_SUPPORT == ENABLED)
+   //Get the FFDHE parameters that match the specified named group
+   ffdheGroup = tlsGetFfdheGroup(NULL, namedGroup);
+#endif
+#if (TLS_ECDH_SUPPORT == ENABLED)
+   //Retrieve the elliptic curve to be used
+   curveInfo = tlsGetCurveInfo(NULL, namedGroup);
+#endif
+
+#if (TLS_FFDHE_SUPPORT == ENABLED)
+   //FFDHE group?
+   if(ffdheGroup != NULL)
+   {
+      DhContext dhContext;
+
+      //Initialize Diffie-Hellman context
+      dhInit(&dhContext);
+
+      //Load FFDHE parameters
+      error = tlsLoadFfdheParameters(&dhContext.params, ffdheGroup);
+
+      //Check status code
+      if(!error)
+      {
+         //Generate an ephemeral key pair
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+         error = dhGenerateKeyPair(&dhContext, keyPairPool->prngAlgo,
+            keyPairPool->prngContext);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Save the private value
+         error = mpiCopy(&newKeyPair->privateKey, &dhContext.xa);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Save the public value
+         error = mpiCopy(&newKeyPair->publicValue, &dhContext.ya);
+      }
+
+      //Release Diffie-Hellman context
+      dhFree(&dhContext);
+   }
+   else
+#endif
+#if (TLS_ECDH_SUPPORT == ENABLED)
+   //Elliptic curve group?
+   if(curveInfo != NULL)
+   {
+      EcdhContext ecdhContext;
+
+      //Initialize ECDH context
+      ecdhInit(&ecdhContext);
+
+      //Load EC domain parameters
+      error = ecLoadDomainParameters(&ecdhContext.params, curveInfo);
+
+      //Check status code
+      if(!error)
+      {
+         //Generate an ephemeral key pair
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+         error = ecdhGenerateKeyPair(&ecdhContext, keyPairPool->prngAlgo,
+            keyPairPool->prngContext);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Save the private key
+         error = mpiCopy(&newKeyPair->privateKey, &ecdhContext.da);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Save the public key
+         error = ecCopy(&newKeyPair->publicKey, &ecdhContext.qa);
+      }
+
+      //Release ECDH context
+      ecdhFree(&ecdhContext);
+   }
+   else
+#endif
+   //Unknown group?
+   {
+      //Report an error
+      error = ERROR_ILLEGAL_PARAMETER;
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Return the newly generated key pair
+      *keyPair = newKeyPair;
+   }
+   else
+   {
+      //Clean up side effects
+      tlsFreeKeyPair(newKeyPair);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Destroy a key pair
+ * @param[in] keyPair Pointer to the key pair
+ **/
+
+void tlsFreeKeyPair(TlsKeyPair *keyPair)
+{
+   //Release the key material
+   mpiFree(&keyPair->privateKey);
+   ecFree(&keyPair->publicKey);
+   mpiFree(&keyPair->publicValue);
+
+   //Release the key pair
+   tlsFreeMem(keyPair);
+}
+
+
+/**
+ * @brief Release a pool of pre-generated key pairs
+ * @param[in] keyPairPool Pointer to the pool
+ **/
+
+void tlsFreeKeyPairPool(TlsKeyPairPool *keyPairPool)
+{
+   uint_t i;
+   TlsKeyPair *keyPair;
+
+   //Valid pool?
+   if(keyPairPool != NULL)
+   {
+      //Loop through the named groups
+      for(i = 0; i < keyPairPool->numGroups; i++)
+      {
+         //Destroy the remaining key pairs
+         while(keyPairPool->groups[i].list != NULL)
+         {
+            keyPair = keyPairPool->groups[i].list;
+            keyPairPool->groups[i].list = keyPair->next;
+            tlsFreeKeyPair(keyPair);
+         }
+      }
+
+      //Release previously allocated resources
+      osDeleteEvent(&keyPairPool->event);
+      osDeleteMutex(&keyPairPool->mutex);
+
+      //Clear the pool
+      memset(keyPairPool, 0, sizeof(TlsKeyPairPool));
+      //Release the pool
+      tlsFreeMem(keyPairPool);
+   }
+}
+
+#endif
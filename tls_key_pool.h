@@ -0,0 +1,58 @@
+/**
+ * @file tls_key_pool.h
+ * @brief Pool of pre-generated ephemeral key pairs
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_KEY_POOL_H
+#define _TLS_KEY_POOL_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Key pair pool related functions
+TlsKeyPair *tlsPopKeyPair(TlsKeyPairPool *keyPairPool, uint16_t namedGroup);
+error_t tlsTakeKeyPair(TlsContext *context, uint16_t namedGroup);
+error_t tlsTakeSpeculativeKeyPair(TlsContext *context, uint16_t namedGroup);
+error_t tlsCopyEcdhKeyPair(EcdhContext *ecdhContext, const TlsKeyPair *keyPair);
+
+error_t tlsGenerateKeyPair(TlsKeyPairPool *keyPairPool, uint16_t namedGroup,
+   TlsKeyPair **keyPair);
+
+void tlsFreeKeyPair(TlsKeyPair *keyPair);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
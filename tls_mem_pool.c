@@ -0,0 +1,380 @@
+/**
+ * @file tls_mem_pool.c
+ * @brief Memory pools for short-lived objects
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_mem_pool.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+//Memory pools (one per object class)
+TlsMemPool tlsMemPools[TLS_MEM_CLASS_COUNT];
+//The memory pools are ready to use
+bool_t tlsMemPoolsReady = FALSE;
+
+
+/**
+ * @brief Initialize the memory pools
+ *
+ * This function must be called once, before any TLS context is created.
+ * Each class of objects has its own list of idle objects, protected by
+ * its own mutex, so that handshakes running in parallel do not contend on
+ * the global memory allocator
+ *
+ * @return Error code
+ **/
+
+error_t tlsInitMemPool(void)
+{
+   uint_t i;
+
+   //Already initialized?
+   if(tlsMemPoolsReady)
+      return NO_ERROR;
+
+   //Clear memory pools
+   memset(tlsMemPools, 0, sizeof(tlsMemPools));
+
+   //Loop through the object classes
+   for(i = 0; i < TLS_MEM_CLASS_COUNT; i++)
+   {
+      //Create a mutex to prevent simultaneous access to the pool
+      if(!osCreateMutex(&tlsMemPools[i].mutex))
+      {
+         //Clean up side effects
+         while(i-- > 0)
+         {
+            osDeleteMutex(&tlsMemPools[i].mutex);
+         }
+
+         //Report an error
+         return ERROR_OUT_OF_RESOURCES;
+      }
+
+      //Default number of idle objects kept in the pool
+      tlsMemPools[i].maxFreeObjects = TLS_MEM_POOL_MAX_FREE_OBJECTS;
+   }
+
+   //The memory pools are now ready to use
+   tlsMemPoolsReady = TRUE;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Tune a memory pool
+ *
+ * The slot size grows automatically to the largest size requested, so that
+ * idle objects can be recycled for any subsequent request. Presetting the
+ * slot size (see the maxRequestSize statistic) avoids early misses
+ *
+ * @param[in] objClass Class of objects
+ * @param[in] slotSize Minimum size of the slots handed out by the pool
+ * @param[in] maxFreeObjects Maximum number of idle objects kept in the pool
+ * @return Error code
+ **/
+
+error_t tlsConfigureMemPool(TlsMemClass objClass, size_t slotSize,
+   uint_t maxFreeObjects)
+{
+   TlsMemPool *pool;
+   TlsMemHeader *header;
+
+   //Check parameters
+   if(objClass >= TLS_MEM_CLASS_COUNT)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure the memory pools have been initialized
+   if(!tlsMemPoolsReady)
+      return ERROR_WRONG_STATE;
+
+   //Point to the relevant pool
+   pool = &tlsMemPools[objClass];
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&pool->mutex);
+
+   //Save parameters
+   pool->stats.slotSize = MAX(pool->stats.slotSize, slotSize);
+   pool->maxFreeObjects = maxFreeObjects;
+
+   //Trim the list of idle objects if necessary
+   while(pool->stats.numFreeObjects > pool->maxFreeObjects)
+   {
+      header = pool->freeList;
+      pool->freeList = header->next;
+      pool->stats.numFreeObjects--;
+      tlsFreeMem(header);
+   }
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&pool->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve the statistics of a memory pool
+ * @param[in] objClass Class of objects
+ * @param[out] stats Statistics of the pool
+ * @return Error code
+ **/
+
+error_t tlsGetMemPoolStats(TlsMemClass objClass, TlsMemPoolStats *stats)
+{
+   TlsMemPool *pool;
+
+   //Check parameters
+   if(objClass >= TLS_MEM_CLASS_COUNT || stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure the memory pools have been initialized
+   if(!tlsMemPoolsReady)
+      return ERROR_WRONG_STATE;
+
+   //Point to the relevant pool
+   pool = &tlsMemPools[objClass];
+
+   //Take a consistent snapshot of the statistics
+   osAcquireMutex(&pool->mutex);
+   *stats = pool->stats;
+   osReleaseMutex(&pool->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Allocate an object from a memory pool
+ * @param[in] objClass Class of objects
+ * @param[in] size Required size, in bytes
+ * @return Pointer to the object
+ **/
+
+void *tlsMemPoolAlloc(TlsMemClass objClass, size_t size)
+{
+   TlsMemPool *pool;
+   TlsMemHeader *header;
+   TlsMemHeader *stale;
+
+   //Initialize pointers
+   header = NULL;
+   stale = NULL;
+
+   //Memory pools available?
+   if(tlsMemPoolsReady && objClass < TLS_MEM_CLASS_COUNT)
+   {
+      //Point to the relevant pool
+      pool = &tlsMemPools[objClass];
+
+      //Acquire exclusive access to the pool
+      osAcquireMutex(&pool->mutex);
+
+      //Remove the first idle object from the list, if any
+      if(pool->freeList != NULL)
+      {
+         header = pool->freeList;
+         pool->freeList = header->next;
+         pool->stats.numFreeObjects--;
+
+         //The idle object may be too small to serve the request
+         if(header->size < size)
+         {
+            stale = header;
+            header = NULL;
+         }
+      }
+
+      //Slots are sized after the largest request
+      pool->stats.maxRequestSize = MAX(pool->stats.maxRequestSize, size);
+      pool->stats.slotSize = MAX(pool->stats.slotSize, size);
+
+      //Update statistics
+      pool->stats.allocCount++;
+      pool->stats.inUse++;
+      pool->stats.peakInUse = MAX(pool->stats.peakInUse, pool->stats.inUse);
+
+      if(header != NULL)
+         pool->stats.hitCount++;
+      else
+         pool->stats.missCount++;
+
+      //Size of the slot to be allocated
+      size = pool->stats.slotSize;
+
+      //Release exclusive access to the pool
+      osReleaseMutex(&pool->mutex);
+
+      //Release the idle object that was too small
+      if(stale != NULL)
+      {
+         tlsFreeMem(stale);
+      }
+   }
+
+   //No suitable idle object?
+   if(header == NULL)
+   {
+      //Allocate a new slot
+      header = tlsAllocMem(sizeof(TlsMemHeader) + size);
+      //Failed to allocate memory?
+      if(header == NULL)
+      {
+         //Memory pools available?
+         if(tlsMemPoolsReady && objClass < TLS_MEM_CLASS_COUNT)
+         {
+            //The allocation did not succeed
+            osAcquireMutex(&tlsMemPools[objClass].mutex);
+            tlsMemPools[objClass].stats.inUse--;
+            osReleaseMutex(&tlsMemPools[objClass].mutex);
+         }
+
+         //Report an error
+         return NULL;
+      }
+
+      //Save the usable size of the object
+      header->size = size;
+   }
+
+   //The object immediately follows the header
+   header->next = NULL;
+
+   //Return a pointer to the object
+   return header + 1;
+}
+
+
+/**
+ * @brief Return an object to its memory pool
+ * @param[in] objClass Class of objects
+ * @param[in] p Pointer to the object
+ **/
+
+void tlsMemPoolFree(TlsMemClass objClass, void *p)
+{
+   TlsMemPool *pool;
+   TlsMemHeader *header;
+
+   //Valid object?
+   if(p != NULL)
+   {
+      //Point to the header that precedes the object
+      header = (TlsMemHeader *) p - 1;
+
+      //Memory pools available?
+      if(tlsMemPoolsReady && objClass < TLS_MEM_CLASS_COUNT)
+      {
+         //Point to the relevant pool
+         pool = &tlsMemPools[objClass];
+
+         //Acquire exclusive access to the pool
+         osAcquireMutex(&pool->mutex);
+
+         //Update statistics
+         pool->stats.freeCount++;
+         pool->stats.inUse--;
+
+         //The number of idle objects is bounded
+         if(pool->stats.numFreeObjects < pool->maxFreeObjects)
+         {
+            //Add the object to the list of idle objects
+            header->next = pool->freeList;
+            pool->freeList = header;
+            pool->stats.numFreeObjects++;
+
+            //The object is now owned by the pool
+            header = NULL;
+         }
+
+         //Release exclusive access to the pool
+         osReleaseMutex(&pool->mutex);
+      }
+
+      //The pool is full or not available?
+      if(header != NULL)
+      {
+         tlsFreeMem(header);
+      }
+   }
+}
+
+
+/**
+ * @brief Release the idle objects held by the memory pools
+ **/
+
+void tlsFreeMemPool(void)
+{
+   uint_t i;
+   TlsMemPool *pool;
+   TlsMemHeader *header;
+
+   //Make sure the memory pools have been initialized
+   if(tlsMemPoolsReady)
+   {
+      //Loop through the object classes
+      for(i = 0; i < TLS_MEM_CLASS_COUNT; i++)
+      {
+         //Point to the current pool
+         pool = &tlsMemPools[i];
+
+         //Acquire exclusive access to the pool
+         osAcquireMutex(&pool->mutex);
+
+         //Release the idle objects
+         while(pool->freeList != NULL)
+         {
+            header = pool->freeList;
+            pool->freeList = header->next;
+            tlsFreeMem(header);
+         }
+
+         //The list of idle objects is now empty
+         pool->stats.numFreeObjects = 0;
+
+         //Release exclusive access to the pool
+         osReleaseMutex(&pool->mutex);
+      }
+   }
+}
+
+#endif
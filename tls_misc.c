@@ -36,8 +36,12 @@
 #include "tls.h"
 #include "tls_cipher_suites.h"
 #include "tls_common.h"
+#include "tls_handshake.h"
 #include "tls_ffdhe.h"
 #include "tls_misc.h"
+#include "tls_record_encryption.h"
+#include "tls_record_decryption.h"
+#include "tls_crypto_provider.h"
 #include "tls13_key_material.h"
 #include "encoding/oid.h"
 #include "debug.h"
@@ -137,6 +141,10 @@ void tlsProcessError(TlsContext *context, error_t errorCode)
       case ERROR_UNSUPPORTED_EXTENSION:
          tlsSendAlert(context, TLS_ALERT_LEVEL_FATAL, TLS_ALERT_UNSUPPORTED_EXTENSION);
          break;
+      //The stapled OCSP response is invalid or unacceptable
+      case ERROR_BAD_CERTIFICATE_STATUS_RESPONSE:
+         tlsSendAlert(context, TLS_ALERT_LEVEL_FATAL, TLS_ALERT_BAD_CERTIFICATE_STATUS_RESPONSE);
+         break;
       //A client certificate is desired but none was provided by the client
       case ERROR_CERTIFICATE_REQUIRED:
          tlsSendAlert(context, TLS_ALERT_LEVEL_FATAL, TLS_ALERT_CERTIFICATE_REQUIRED);
@@ -260,35 +268,54 @@ error_t tlsSelectCipherSuite(TlsContext *context, uint16_t identifier)
    //Initialize status code
    error = ERROR_HANDSHAKE_FAILED;
 
-   //Determine the number of supported cipher suites
-   n = tlsGetNumSupportedCipherSuites();
-
-   //Loop through the list of supported cipher suites
-   for(cipherSuite = NULL, i = 0; i < n; i++)
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+   //Any negotiation table available?
+   if(context->cipherSuiteTable != NULL)
    {
-      //Compare cipher suite identifiers
-      if(tlsSupportedCipherSuites[i].identifier == identifier)
-      {
-         //The cipher suite is supported
-         cipherSuite = &tlsSupportedCipherSuites[i];
-         break;
-      }
-   }
+      const TlsCipherSuiteEntry *entry;
 
-   //Restrict the use of certain cipher suites
-   if(context->numCipherSuites > 0)
+      //The table holds the supported cipher suites that are allowed
+      entry = tlsLookupCipherSuite(context->cipherSuiteTable, identifier);
+
+      //Matching entry?
+      if(entry != NULL)
+         cipherSuite = &tlsSupportedCipherSuites[entry->index];
+      else
+         cipherSuite = NULL;
+   }
+   else
+#endif
    {
-      //Loop through the list of allowed cipher suites
-      for(i = 0; i < context->numCipherSuites; i++)
+      //Determine the number of supported cipher suites
+      n = tlsGetNumSupportedCipherSuites();
+
+      //Loop through the list of supported cipher suites
+      for(cipherSuite = NULL, i = 0; i < n; i++)
       {
          //Compare cipher suite identifiers
-         if(context->cipherSuites[i] == identifier)
+         if(tlsSupportedCipherSuites[i].identifier == identifier)
+         {
+            //The cipher suite is supported
+            cipherSuite = &tlsSupportedCipherSuites[i];
             break;
+         }
       }
 
-      //Check whether the use of the cipher suite is restricted
-      if(i >= context->numCipherSuites)
-         cipherSuite = NULL;
+      //Restrict the use of certain cipher suites
+      if(context->numCipherSuites > 0)
+      {
+         //Loop through the list of allowed cipher suites
+         for(i = 0; i < context->numCipherSuites; i++)
+         {
+            //Compare cipher suite identifiers
+            if(context->cipherSuites[i] == identifier)
+               break;
+         }
+
+         //Check whether the use of the cipher suite is restricted
+         if(i >= context->numCipherSuites)
+            cipherSuite = NULL;
+      }
    }
 
    //Acceptable cipher suite?
@@ -341,6 +368,37 @@ error_t tlsSelectCipherSuite(TlsContext *context, uint16_t identifier)
 }
 
 
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+
+/**
+ * @brief Release the cipher suite negotiation table of a TLS context
+ *
+ * The table is released only if it is owned by the TLS context. A table
+ * inherited from a shared configuration is left untouched
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsReleaseCipherSuiteTable(TlsContext *context)
+{
+   //Any negotiation table?
+   if(context->cipherSuiteTable != NULL)
+   {
+      //Check whether the table belongs to the TLS context
+      if(context->config == NULL ||
+         context->cipherSuiteTable != context->config->cipherSuiteTable)
+      {
+         tlsFreeCipherSuiteTable(context->cipherSuiteTable);
+      }
+
+      //Detach the table
+      context->cipherSuiteTable = NULL;
+   }
+}
+
+#endif
+
+
 /**
  * @brief Initialize encryption engine
  * @param[in] context Pointer to the TLS context
@@ -379,6 +437,31 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
    //Sequence numbers are maintained separately for each epoch, with each
    //sequence number initially being 0 for each epoch
    memset(&encryptionEngine->dtlsSeqNum, 0, sizeof(DtlsSequenceNumber));
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+   //Once negotiated, CIDs are used from the first encrypted epoch onwards.
+   //Records are sent with the CID chosen by the peer and received with the
+   //CID chosen by the local endpoint
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM &&
+      context->cidNegotiated)
+   {
+      if(entity == context->entity)
+      {
+         memcpy(encryptionEngine->cid, context->peerCid, context->peerCidLen);
+         encryptionEngine->cidLen = context->peerCidLen;
+      }
+      else
+      {
+         memcpy(encryptionEngine->cid, context->localCid, context->localCidLen);
+         encryptionEngine->cidLen = context->localCidLen;
+      }
+   }
+   else
+   {
+      //Records do not carry any CID
+      encryptionEngine->cidLen = 0;
+   }
+#endif
 #endif
 
 #if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
@@ -413,8 +496,9 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
    encryptionEngine->cipherContext = NULL;
 
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
-   //Initialize HMAC context
-   encryptionEngine->hmacContext = &context->hmacContext;
+   //Initialize HMAC contexts
+   encryptionEngine->hmacContext = NULL;
+   encryptionEngine->hmacKeyContext = NULL;
 #endif
 
 #if (TLS_GCM_CIPHER_SUPPORT == ENABLED)
@@ -432,7 +516,7 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
       if(entity == TLS_CONNECTION_END_CLIENT)
       {
          //Point to the key material
-         p = context->keyBlock;
+         p = context->handshake->keyBlock;
          //Save MAC key
          memcpy(encryptionEngine->macKey, p, cipherSuite->macKeyLen);
 
@@ -449,7 +533,7 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
       else
       {
          //Point to the key material
-         p = context->keyBlock + cipherSuite->macKeyLen;
+         p = context->handshake->keyBlock + cipherSuite->macKeyLen;
          //Save MAC key
          memcpy(encryptionEngine->macKey, p, cipherSuite->macKeyLen);
 
@@ -481,22 +565,15 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
       //Make sure the hash algorithm is valid
       if(hashAlgo != NULL)
       {
-         //Calculate the write key
-         error = tls13HkdfExpandLabel(hashAlgo, secret, hashAlgo->digestSize,
-            "key", NULL, 0, encryptionEngine->encKey, cipherSuite->encKeyLen);
+         //Calculate the write key and IV
+         error = tls13DeriveTrafficKeys(hashAlgo, secret,
+            encryptionEngine->encKey, cipherSuite->encKeyLen,
+            encryptionEngine->iv, cipherSuite->fixedIvLen);
 
          //Debug message
          TRACE_DEBUG("Write Key:\r\n");
          TRACE_DEBUG_ARRAY("  ", encryptionEngine->encKey, cipherSuite->encKeyLen);
 
-         //Check status code
-         if(!error)
-         {
-            //Calculate the write IV
-            error = tls13HkdfExpandLabel(hashAlgo, secret, hashAlgo->digestSize,
-               "iv", NULL, 0, encryptionEngine->iv, cipherSuite->fixedIvLen);
-         }
-
          //Debug message
          TRACE_DEBUG("Write IV:\r\n");
          TRACE_DEBUG_ARRAY("  ", encryptionEngine->iv, cipherSuite->fixedIvLen);
@@ -515,6 +592,45 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
       error = ERROR_INVALID_VERSION;
    }
 
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   //Check status code
+   if(!error)
+   {
+      //Give the crypto providers a chance to take over the record protection
+      error = tlsClaimEncryptionEngine(context, encryptionEngine);
+
+      //The provider handles the whole record protection?
+      if(!error)
+         return NO_ERROR;
+
+      //No provider implements the negotiated cipher suite?
+      if(error == ERROR_NOT_IMPLEMENTED)
+      {
+         //Use the built-in implementation
+         error = NO_ERROR;
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Select the hash implementation to be used for record MACs
+      encryptionEngine->hashAlgo = tlsGetProviderHashAlgo(context,
+         cipherSuite->hashAlgo);
+   }
+#endif
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   //Check status code
+   if(!error)
+   {
+      //In static operating mode, the contexts of the engine are placed in
+      //the memory supplied by the application
+      if(context->staticMem && encryptionEngine->staticMem == NULL)
+         error = tlsAllocStaticEngineMem(context, encryptionEngine);
+   }
+#endif
+
    //Check status code
    if(!error)
    {
@@ -524,8 +640,24 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
          encryptionEngine->cipherMode == CIPHER_MODE_CCM ||
          encryptionEngine->cipherMode == CIPHER_MODE_GCM)
       {
-         //Allocate encryption context
-         encryptionEngine->cipherContext = tlsAllocMem(cipherAlgo->contextSize);
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+         //Static operating mode?
+         if(encryptionEngine->staticMem != NULL)
+         {
+            //The cipher context must fit in the reserved memory
+            if(cipherAlgo->contextSize <= TLS_STATIC_CIPHER_CONTEXT_SIZE)
+            {
+               encryptionEngine->cipherContext =
+                  encryptionEngine->staticMem->cipherContext;
+            }
+         }
+         else
+#endif
+         {
+            //Allocate encryption context
+            encryptionEngine->cipherContext = tlsAllocObject(
+               TLS_MEM_CLASS_CIPHER_CONTEXT, cipherAlgo->contextSize);
+         }
 
          //Successful memory allocation?
          if(encryptionEngine->cipherContext != NULL)
@@ -553,6 +685,58 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
       }
    }
 
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //Check status code
+   if(!error)
+   {
+      //MAC-then-encrypt cipher suite?
+      if(context->version <= TLS_VERSION_1_2 &&
+         encryptionEngine->hashAlgo != NULL)
+      {
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+         //Static operating mode?
+         if(encryptionEngine->staticMem != NULL)
+         {
+            //Use the HMAC contexts reserved in the static memory block
+            encryptionEngine->hmacContext =
+               &encryptionEngine->staticMem->hmacContext;
+            encryptionEngine->hmacKeyContext =
+               &encryptionEngine->staticMem->hmacKeyContext;
+         }
+         else
+#endif
+         {
+            //Each encryption engine has its own HMAC contexts, so that the
+            //TX and RX directions can be processed independently
+            encryptionEngine->hmacContext = tlsAllocObject(
+               TLS_MEM_CLASS_HMAC_CONTEXT, sizeof(HmacContext));
+            encryptionEngine->hmacKeyContext = tlsAllocObject(
+               TLS_MEM_CLASS_HMAC_CONTEXT, sizeof(HmacContext));
+         }
+
+         //Successful memory allocation?
+         if(encryptionEngine->hmacContext != NULL &&
+            encryptionEngine->hmacKeyContext != NULL)
+         {
+            //SSL 3.0 does not use HMAC
+            if(context->version >= TLS_VERSION_1_0)
+            {
+               //The key schedule is performed once, and each record starts
+               //from a copy of the keyed context
+               error = hmacInit(encryptionEngine->hmacKeyContext,
+                  encryptionEngine->hashAlgo, encryptionEngine->macKey,
+                  encryptionEngine->macKeyLen);
+            }
+         }
+         else
+         {
+            //Failed to allocate memory
+            error = ERROR_OUT_OF_MEMORY;
+         }
+      }
+   }
+#endif
+
 #if (TLS_GCM_CIPHER_SUPPORT == ENABLED)
    //Check status code
    if(!error)
@@ -560,8 +744,21 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
       //GCM cipher mode?
       if(encryptionEngine->cipherMode == CIPHER_MODE_GCM)
       {
-         //Allocate a memory buffer to hold the GCM context
-         encryptionEngine->gcmContext = tlsAllocMem(sizeof(GcmContext));
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+         //Static operating mode?
+         if(encryptionEngine->staticMem != NULL)
+         {
+            //Use the GCM context reserved in the static memory block
+            encryptionEngine->gcmContext =
+               &encryptionEngine->staticMem->gcmContext;
+         }
+         else
+#endif
+         {
+            //Allocate a memory buffer to hold the GCM context
+            encryptionEngine->gcmContext = tlsAllocObject(
+               TLS_MEM_CLASS_GCM_CONTEXT, sizeof(GcmContext));
+         }
 
          //Successful memory allocation?
          if(encryptionEngine->gcmContext != NULL)
@@ -579,11 +776,79 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
    }
 #endif
 
+   //Check status code
+   if(!error)
+   {
+      //Select the record protection routines
+      tlsSelectRecordProtection(context, encryptionEngine);
+   }
+
    //Return status code
    return error;
 }
 
 
+/**
+ * @brief Select the record protection routines of an encryption engine
+ *
+ * Specialized routines are used for the most common combinations of version,
+ * transport protocol and cipher mode, so that each record is processed
+ * through a single indirect call
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] encryptionEngine Pointer to the encryption/decryption engine
+ **/
+
+void tlsSelectRecordProtection(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine)
+{
+   //Generic routines
+   encryptionEngine->encryptRecord = tlsEncryptRecord;
+   encryptionEngine->decryptRecord = tlsDecryptRecord;
+
+#if (TLS_CCM_CIPHER_SUPPORT == ENABLED || TLS_CCM_8_CIPHER_SUPPORT == ENABLED || \
+   TLS_GCM_CIPHER_SUPPORT == ENABLED || TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
+   //AEAD cipher?
+   if(encryptionEngine->cipherMode == CIPHER_MODE_CCM ||
+      encryptionEngine->cipherMode == CIPHER_MODE_GCM ||
+      encryptionEngine->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+   {
+      //Skip the cipher mode dispatch
+      encryptionEngine->encryptRecord = tlsEncryptAeadRecord;
+      encryptionEngine->decryptRecord = tlsDecryptAeadRecord;
+   }
+#endif
+
+#if (TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   //GCM cipher mode over TLS transport?
+   if(encryptionEngine->cipherMode == CIPHER_MODE_GCM &&
+      context->transportProtocol == TLS_TRANSPORT_PROTOCOL_STREAM)
+   {
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+      //TLS 1.2 with a 4-byte salt and an 8-byte explicit nonce?
+      if(encryptionEngine->version == TLS_VERSION_1_2 &&
+         encryptionEngine->fixedIvLen == 4 &&
+         encryptionEngine->recordIvLen == 8)
+      {
+         encryptionEngine->encryptRecord = tlsEncryptGcmRecord;
+         encryptionEngine->decryptRecord = tlsDecryptGcmRecord;
+      }
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //TLS 1.3 with a 12-byte IV?
+      if(encryptionEngine->version == TLS_VERSION_1_3 &&
+         encryptionEngine->fixedIvLen == 12 &&
+         encryptionEngine->recordIvLen == 0)
+      {
+         encryptionEngine->encryptRecord = tls13EncryptGcmRecord;
+         encryptionEngine->decryptRecord = tls13DecryptGcmRecord;
+      }
+#endif
+   }
+#endif
+}
+
+
 /**
  * @brief Release encryption engine
  * @param[in] encryptionEngine Pointer to the encryption/decryption engine
@@ -591,6 +856,11 @@ error_t tlsInitEncryptionEngine(TlsContext *context,
 
 void tlsFreeEncryptionEngine(TlsEncryptionEngine *encryptionEngine)
 {
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   //Release the provider-specific state
+   tlsReleaseEncryptionEngine(encryptionEngine);
+#endif
+
    //Valid cipher context?
    if(encryptionEngine->cipherContext != NULL)
    {
@@ -598,11 +868,59 @@ void tlsFreeEncryptionEngine(TlsEncryptionEngine *encryptionEngine)
       memset(encryptionEngine->cipherContext, 0,
          encryptionEngine->cipherAlgo->contextSize);
 
-      //Release memory
-      tlsFreeMem(encryptionEngine->cipherContext);
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //The memory supplied by the application is never freed
+      if(encryptionEngine->staticMem == NULL)
+#endif
+      {
+         //Release memory
+         tlsFreeObject(TLS_MEM_CLASS_CIPHER_CONTEXT,
+            encryptionEngine->cipherContext);
+      }
+
       encryptionEngine->cipherContext = NULL;
    }
 
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //Valid HMAC context?
+   if(encryptionEngine->hmacContext != NULL)
+   {
+      //Erase HMAC context
+      memset(encryptionEngine->hmacContext, 0, sizeof(HmacContext));
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //The memory supplied by the application is never freed
+      if(encryptionEngine->staticMem == NULL)
+#endif
+      {
+         //Release memory
+         tlsFreeObject(TLS_MEM_CLASS_HMAC_CONTEXT,
+            encryptionEngine->hmacContext);
+      }
+
+      encryptionEngine->hmacContext = NULL;
+   }
+
+   //Valid keyed HMAC context?
+   if(encryptionEngine->hmacKeyContext != NULL)
+   {
+      //Erase keyed HMAC context
+      memset(encryptionEngine->hmacKeyContext, 0, sizeof(HmacContext));
+
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //The memory supplied by the application is never freed
+      if(encryptionEngine->staticMem == NULL)
+#endif
+      {
+         //Release memory
+         tlsFreeObject(TLS_MEM_CLASS_HMAC_CONTEXT,
+            encryptionEngine->hmacKeyContext);
+      }
+
+      encryptionEngine->hmacKeyContext = NULL;
+   }
+#endif
+
 #if (TLS_GCM_CIPHER_SUPPORT == ENABLED)
    //Valid GCM context?
    if(encryptionEngine->gcmContext != NULL)
@@ -610,16 +928,77 @@ void tlsFreeEncryptionEngine(TlsEncryptionEngine *encryptionEngine)
       //Erase GCM context
       memset(encryptionEngine->gcmContext, 0, sizeof(GcmContext));
 
-      //Release memory
-      tlsFreeMem(encryptionEngine->gcmContext);
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+      //The memory supplied by the application is never freed
+      if(encryptionEngine->staticMem == NULL)
+#endif
+      {
+         //Release memory
+         tlsFreeObject(TLS_MEM_CLASS_GCM_CONTEXT,
+            encryptionEngine->gcmContext);
+      }
+
       encryptionEngine->gcmContext = NULL;
    }
 #endif
 
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   //Give the reserved memory back to the static memory block
+   if(encryptionEngine->staticMem != NULL)
+   {
+      encryptionEngine->staticMem->used = FALSE;
+      encryptionEngine->staticMem = NULL;
+   }
+#endif
+
    //Reset encryption parameters
    encryptionEngine->cipherAlgo = NULL;
    encryptionEngine->cipherMode = CIPHER_MODE_NULL;
    encryptionEngine->hashAlgo = NULL;
+   encryptionEngine->encryptRecord = NULL;
+   encryptionEngine->decryptRecord = NULL;
+}
+
+
+/**
+ * @brief Reserve the contexts of an encryption engine in static mode
+ *
+ * The static memory block holds the contexts of as many encryption engines
+ * as a connection may use at once (TX and RX engines, plus the engine of the
+ * previous epoch with DTLS)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] encryptionEngine Pointer to the encryption/decryption engine
+ * @return Error code
+ **/
+
+error_t tlsAllocStaticEngineMem(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine)
+{
+#if (TLS_STATIC_MEM_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Loop through the engine slots of the static memory block
+   for(i = 0; i < TLS_STATIC_NUM_ENGINES; i++)
+   {
+      //Unused slot?
+      if(!context->staticEngines[i].used)
+      {
+         //The slot is now owned by the encryption engine
+         context->staticEngines[i].used = TRUE;
+         encryptionEngine->staticMem = &context->staticEngines[i];
+
+         //Successful processing
+         return NO_ERROR;
+      }
+   }
+
+   //All the slots are in use
+   return ERROR_OUT_OF_MEMORY;
+#else
+   //Static operating mode is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
@@ -882,7 +1261,7 @@ const HashAlgo *tlsGetHashAlgo(uint8_t hashAlgoId)
 
 /**
  * @brief Get the EC domain parameters that match the specified named curve
- * @param[in] context Pointer to the TLS context
+ * @param[in] context Pointer to the TLS context (optional parameter)
  * @param[in] namedCurve Elliptic curve identifier
  * @return Elliptic curve domain parameters
  **/
@@ -1006,7 +1385,7 @@ const EcCurveInfo *tlsGetCurveInfo(TlsContext *context, uint16_t namedCurve)
 #endif
 
    //Restrict the use of certain elliptic curves
-   if(context->numSupportedGroups > 0)
+   if(context != NULL && context->numSupportedGroups > 0)
    {
       //Loop through the list of allowed named groups
       for(i = 0; i < context->numSupportedGroups; i++)
@@ -1171,6 +1550,13 @@ size_t tlsComputeEncryptionOverhead(TlsEncryptionEngine *encryptionEngine,
    //Initialize variable
    n = 0;
 
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   //The real content type is appended to the payload before encryption
+   //(refer to RFC 9146, section 4)
+   if(encryptionEngine->cidLen > 0)
+      n++;
+#endif
+
    //Message authentication?
    if(encryptionEngine->hashAlgo != NULL)
       n += encryptionEngine->hashAlgo->digestSize;
@@ -1203,11 +1589,102 @@ size_t tlsComputeEncryptionOverhead(TlsEncryptionEngine *encryptionEngine,
       //Stream ciphers do not cause any overhead
    }
 
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   //The CID is carried in the clear in the record header
+   n += encryptionEngine->cidLen;
+#endif
+
    //Return the total overhead caused by encryption
    return n;
 }
 
 
+/**
+ * @brief Determine what a blocked handshake is waiting for
+ * @param[in] context Pointer to the TLS context
+ * @param[out] events Set of events the handshake is waiting for
+ * @param[out] timeout Time remaining before the retransmission timer
+ *   expires (optional parameter)
+ **/
+
+void tlsGetWaitEvents(TlsContext *context, uint_t *events, systime_t *timeout)
+{
+   //Initialize parameters
+   *events = TLS_WAIT_NONE;
+
+   if(timeout != NULL)
+      *timeout = INFINITE_DELAY;
+
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   //Signature generation pending?
+   if(context->asyncSignState == TLS_ASYNC_SIGN_STATE_PENDING)
+      *events |= TLS_WAIT_ASYNC;
+#endif
+
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   //External session cache lookup pending?
+   if(context->extCacheState == TLS_EXT_CACHE_STATE_PENDING)
+      *events |= TLS_WAIT_ASYNC;
+#endif
+
+   //The handshake does not need the socket while an asynchronous operation
+   //is pending
+   if(*events == TLS_WAIT_NONE)
+   {
+      //Any data the socket did not accept yet?
+      if(tlsIsTxReady(context))
+      {
+         *events = TLS_WAIT_WRITE;
+      }
+      else
+      {
+         //The handshake waits for the next message from the peer
+         *events = TLS_WAIT_READ;
+
+#if (DTLS_SUPPORT == ENABLED)
+         //Any flight of messages to be retransmitted on timeout?
+         if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM &&
+            context->state != TLS_STATE_APPLICATION_DATA &&
+            context->txBufferLen > 0)
+         {
+            int32_t delay;
+
+            //The retransmission timer is also armed
+            *events |= TLS_WAIT_TIMER;
+
+            //Time remaining before the timer expires
+            delay = timeCompare(context->retransmitTimestamp +
+               context->retransmitTimeout, osGetSystemTime());
+
+            //Return the delay to the caller
+            if(timeout != NULL)
+               *timeout = (delay > 0) ? (systime_t) delay : 0;
+         }
+#endif
+      }
+   }
+}
+
+
+/**
+ * @brief Check whether DTLS records are packed into datagrams
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if application data records are packed, else FALSE
+ **/
+
+bool_t tlsIsRecordPackingEnabled(TlsContext *context)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Record packing only applies to DTLS
+   return (context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM &&
+      context->recordPackingEnabled) ? TRUE : FALSE;
+#else
+   //DTLS is not implemented
+   return FALSE;
+#endif
+}
+
+
 /**
  * @brief DNS hostname verification
  * @param[in] name Pointer to the hostname
@@ -1256,4 +1733,257 @@ bool_t tlsCheckDnsHostname(const char_t *name, size_t length)
    return valid;
 }
 
+
+/**
+ * @brief Non-cryptographic hash function used by lookup tables
+ * @param[in] data Pointer to the data to be hashed
+ * @param[in] length Length of the data, in bytes
+ * @return Resulting hash value (FNV-1a)
+ **/
+
+uint32_t tlsComputeIndexHash(const uint8_t *data, size_t length)
+{
+   size_t i;
+   uint32_t h;
+
+   //FNV-1a offset basis
+   h = 2166136261U;
+
+   //Process the data
+   for(i = 0; i < length; i++)
+   {
+      h ^= data[i];
+      h *= 16777619U;
+   }
+
+   //Return the resulting hash value
+   return h;
+}
+
+
+/**
+ * @brief Encode an integer using a variable-length encoding
+ *
+ * Each byte carries 7 bits of the value, least significant group first. The
+ * most significant bit of a byte is set when more bytes follow
+ *
+ * @param[in] value Integer to encode
+ * @param[out] p Output stream where to write the encoded integer
+ * @return Number of bytes that have been written (1 to 5)
+ **/
+
+size_t tlsFormatVarInt(uint32_t value, uint8_t *p)
+{
+   size_t n;
+
+   //Write the leading 7-bit groups
+   for(n = 0; value >= 0x80; n++)
+   {
+      p[n] = (uint8_t) (value | 0x80);
+      value >>= 7;
+   }
+
+   //Write the last group
+   p[n++] = (uint8_t) value;
+
+   //Return the length of the encoded integer
+   return n;
+}
+
+
+/**
+ * @brief Decode an integer encoded with tlsFormatVarInt()
+ * @param[in] p Input stream where to read the encoded integer
+ * @param[in] length Number of bytes available in the input stream
+ * @param[out] value Decoded integer
+ * @param[out] consumed Total number of bytes that have been consumed
+ * @return Error code
+ **/
+
+error_t tlsParseVarInt(const uint8_t *p, size_t length, uint32_t *value,
+   size_t *consumed)
+{
+   size_t n;
+   uint32_t x;
+
+   //Initialize value
+   x = 0;
+
+   //A 32-bit integer spans at most 5 bytes
+   for(n = 0; n < length && n < 5; n++)
+   {
+      //The fifth byte can only hold the 4 most significant bits
+      if(n == 4 && p[n] > 0x0F)
+         break;
+
+      //Accumulate the current 7-bit group
+      x |= (uint32_t) (p[n] & 0x7F) << (7 * n);
+
+      //Last byte of the encoded integer?
+      if((p[n] & 0x80) == 0)
+      {
+         //Return the decoded integer
+         *value = x;
+         *consumed = n + 1;
+
+         //Successful processing
+         return NO_ERROR;
+      }
+   }
+
+   //The encoded integer is truncated or malformed
+   return ERROR_DECODING_FAILED;
+}
+
+
+/**
+ * @brief Resume the handshake on behalf of a writer
+ *
+ * The caller holds the TX lock. Sending a KeyUpdate or a deferred
+ * NewSessionTicket only involves the sending side of the connection. Any
+ * other handshake also reads from the peer, so the RX lock is acquired
+ * first, in order to preserve the lock ordering (RX before TX) used by
+ * readers
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsPerformWriterHandshake(TlsContext *context)
+{
+#if (TLS_FULL_DUPLEX_SUPPORT == ENABLED)
+   error_t error;
+
+   //KeyUpdate or deferred NewSessionTicket message pending?
+   if(tlsIsPostHandshakeState(context))
+   {
+      //The receiving side is not involved
+      error = tlsConnect(context);
+   }
+   else
+   {
+      //Acquire both locks in the expected order
+      TLS_UNLOCK_TX(context);
+      TLS_LOCK_RX(context);
+      TLS_LOCK_TX(context);
+
+      //Perform TLS handshake
+      error = tlsConnect(context);
+
+      //Release the receiving side
+      TLS_UNLOCK_RX(context);
+   }
+
+   //Return status code
+   return error;
+#else
+   //Perform TLS handshake
+   return tlsConnect(context);
+#endif
+}
+
+
+/**
+ * @brief Wait for the connection to be ready for zero-copy writes
+ *
+ * The caller holds the TX lock. The handshake is completed first, if
+ * necessary. Records whose payload is serialized in place cannot be used
+ * with DTLS, nor with the 1/n-1 record splitting applied to CBC ciphers
+ * in SSL 3.0 and TLS 1.0
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsPrepareZeroCopyWrite(TlsContext *context)
+{
+   error_t error;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Wait for the connection to be established
+   while(!error)
+   {
+      //Check current state
+      if(context->state < TLS_STATE_APPLICATION_DATA)
+      {
+         //Perform TLS handshake
+         error = tlsPerformWriterHandshake(context);
+      }
+      else if(context->state == TLS_STATE_APPLICATION_DATA)
+      {
+         //The connection is established
+         break;
+      }
+      else
+      {
+         //The connection has not yet been established
+         error = ERROR_NOT_CONNECTED;
+      }
+   }
+
+   //Any error to report?
+   if(error)
+      return error;
+
+#if (DTLS_SUPPORT == ENABLED)
+   //DTLS records are not supported
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+      return ERROR_NOT_IMPLEMENTED;
+#endif
+
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_0)
+   //The 1/n-1 record splitting technique cannot be applied
+   if(context->version <= TLS_VERSION_1_0 &&
+      context->cipherSuite.cipherMode == CIPHER_MODE_CBC)
+   {
+      return ERROR_NOT_IMPLEMENTED;
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Report a handshake event to the trace callback
+ * @param[in] context Pointer to the TLS context
+ * @param[in] event Handshake event
+ **/
+
+void tlsTraceHandshakeEvent(TlsContext *context, TlsTraceEvent event)
+{
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+   //Any registered callback?
+   if(context->traceCallback != NULL)
+   {
+      //Timestamps are taken from the monotonic system tick counter
+      context->traceCallback(context, event, context->state,
+         osGetSystemTime(), context->traceParam);
+   }
+#endif
+}
+
+
+/**
+ * @brief Report the current state to the trace callback if it has changed
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsTraceStateChange(TlsContext *context)
+{
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+   //State transition since the last call?
+   if(context->state != context->traceState)
+   {
+      //Save the current state
+      context->traceState = context->state;
+      //Invoke the trace callback
+      tlsTraceHandshakeEvent(context, TLS_TRACE_EVENT_STATE_CHANGE);
+   }
+#endif
+}
+
 #endif
@@ -34,6 +34,50 @@
 //Dependencies
 #include "tls.h"
 
+//Handshake tracing enabled?
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+
+//Report a handshake event to the trace callback
+#define TLS_TRACE_HANDSHAKE(context, event) tlsTraceHandshakeEvent(context, event)
+
+#else
+
+//Handshake tracing is compiled out
+#define TLS_TRACE_HANDSHAKE(context, event)
+
+#endif
+
+//Full-duplex operation enabled?
+#if (TLS_FULL_DUPLEX_SUPPORT == ENABLED)
+
+//Acquire/release the lock protecting the sending side
+#define TLS_LOCK_TX(context) osAcquireMutex(&(context)->txMutex)
+#define TLS_UNLOCK_TX(context) osReleaseMutex(&(context)->txMutex)
+//Acquire/release the lock protecting the receiving side
+#define TLS_LOCK_RX(context) osAcquireMutex(&(context)->rxMutex)
+#define TLS_UNLOCK_RX(context) osReleaseMutex(&(context)->rxMutex)
+
+//Acquire/release the TX lock from a reader (DTLS readers already hold it)
+#define TLS_LOCK_STREAM_TX(context) \
+   do { if((context)->transportProtocol == TLS_TRANSPORT_PROTOCOL_STREAM) \
+      osAcquireMutex(&(context)->txMutex); } while(0)
+
+#define TLS_UNLOCK_STREAM_TX(context) \
+   do { if((context)->transportProtocol == TLS_TRANSPORT_PROTOCOL_STREAM) \
+      osReleaseMutex(&(context)->txMutex); } while(0)
+
+#else
+
+//Locking is compiled out
+#define TLS_LOCK_TX(context)
+#define TLS_UNLOCK_TX(context)
+#define TLS_LOCK_RX(context)
+#define TLS_UNLOCK_RX(context)
+#define TLS_LOCK_STREAM_TX(context)
+#define TLS_UNLOCK_STREAM_TX(context)
+
+#endif
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
@@ -46,13 +90,20 @@ error_t tlsGenerateRandomValue(TlsContext *context, uint8_t *random);
 
 error_t tlsSelectVersion(TlsContext *context, uint16_t version);
 error_t tlsSelectCipherSuite(TlsContext *context, uint16_t identifier);
+void tlsReleaseCipherSuiteTable(TlsContext *context);
 
 error_t tlsInitEncryptionEngine(TlsContext *context,
    TlsEncryptionEngine *encryptionEngine, TlsConnectionEnd entity,
    const uint8_t *secret);
 
+void tlsSelectRecordProtection(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine);
+
 void tlsFreeEncryptionEngine(TlsEncryptionEngine *encryptionEngine);
 
+error_t tlsAllocStaticEngineMem(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine);
+
 error_t tlsWriteMpi(const Mpi *a, uint8_t *data, size_t *length);
 error_t tlsReadMpi(Mpi *a, const uint8_t *data, size_t size, size_t *length);
 
@@ -70,8 +121,24 @@ TlsNamedGroup tlsGetNamedCurve(const uint8_t *oid, size_t length);
 size_t tlsComputeEncryptionOverhead(TlsEncryptionEngine *encryptionEngine,
    size_t payloadLen);
 
+void tlsGetWaitEvents(TlsContext *context, uint_t *events, systime_t *timeout);
+bool_t tlsIsRecordPackingEnabled(TlsContext *context);
+
 bool_t tlsCheckDnsHostname(const char_t *name, size_t length);
 
+uint32_t tlsComputeIndexHash(const uint8_t *data, size_t length);
+
+size_t tlsFormatVarInt(uint32_t value, uint8_t *p);
+
+error_t tlsParseVarInt(const uint8_t *p, size_t length, uint32_t *value,
+   size_t *consumed);
+
+error_t tlsPerformWriterHandshake(TlsContext *context);
+error_t tlsPrepareZeroCopyWrite(TlsContext *context);
+
+void tlsTraceHandshakeEvent(TlsContext *context, TlsTraceEvent event);
+void tlsTraceStateChange(TlsContext *context);
+
 //C++ guard
 #ifdef __cplusplus
 }
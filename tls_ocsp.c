@@ -0,0 +1,642 @@
+/**
+ * @file tls_ocsp.c
+ * @brief OCSP stapling
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_ocsp.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create an OCSP response cache
+ *
+ * The cache holds the OCSP response that the server staples to each of its
+ * certificates. It can be shared by any number of TLS contexts and shared
+ * configurations. Responses are obtained by tlsRefreshOcspCache(), which is
+ * meant to be called periodically from a background task, so that the
+ * OCSP responder is never contacted on the handshake path
+ *
+ * @param[in] size Maximum number of cache entries
+ * @param[in] fetchCallback Callback responsible for querying the OCSP
+ *   responder (optional parameter)
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Handle referencing the fully initialized cache
+ **/
+
+TlsOcspCache *tlsInitOcspCache(uint_t size,
+   TlsOcspFetchCallback fetchCallback, void *param)
+{
+   size_t n;
+   TlsOcspCache *cache;
+
+   //Make sure the parameter is acceptable
+   if(size < 1)
+      return NULL;
+
+   //Size of the memory required
+   n = sizeof(TlsOcspCache) + size * sizeof(TlsOcspCacheEntry);
+
+   //Allocate a memory buffer to hold the cache
+   cache = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(cache == NULL)
+      return NULL;
+
+   //Clear memory
+   memset(cache, 0, n);
+
+   //Create a mutex to prevent simultaneous access to the cache
+   if(!osCreateMutex(&cache->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(cache);
+      //Report an error
+      return NULL;
+   }
+
+   //Save parameters
+   cache->size = size;
+   cache->fetchCallback = fetchCallback;
+   cache->fetchParam = param;
+
+   //Return a pointer to the newly created cache
+   return cache;
+}
+
+
+/**
+ * @brief Register a certificate whose status is to be stapled
+ * @param[in] cache Pointer to the OCSP response cache
+ * @param[in] certId Certificate chain passed to tlsAddCertificate() or
+ *   credential passed to tlsAddCredential()
+ * @return Error code
+ **/
+
+error_t tlsAddOcspCacheEntry(TlsOcspCache *cache, const void *certId)
+{
+   error_t error;
+   uint_t i;
+   TlsOcspCacheEntry *entry;
+
+   //Check parameters
+   if(cache == NULL || certId == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize pointer
+   entry = NULL;
+
+   //Acquire exclusive access to the cache
+   osAcquireMutex(&cache->mutex);
+
+   //Loop through the cache entries
+   for(i = 0; i < cache->size; i++)
+   {
+      //The certificate is already registered?
+      if(cache->entries[i].certId == certId)
+      {
+         entry = &cache->entries[i];
+         break;
+      }
+
+      //Keep track of the first free entry
+      if(cache->entries[i].certId == NULL && entry == NULL)
+         entry = &cache->entries[i];
+   }
+
+   //Any entry available?
+   if(entry != NULL)
+   {
+      //Register the certificate
+      entry->certId = certId;
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //The cache is full
+      error = ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Release exclusive access to the cache
+   osReleaseMutex(&cache->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Install the OCSP response of a certificate
+ *
+ * The response replaces the previous one atomically. Handshakes that have
+ * already selected the previous response keep a reference to it until they
+ * complete
+ *
+ * @param[in] cache Pointer to the OCSP response cache
+ * @param[in] certId Certificate identifier
+ * @param[in] response DER-encoded OCSP response
+ * @param[in] length Length of the OCSP response, in bytes
+ * @param[in] lifetime Time during which the response can be stapled, in
+ *   milliseconds (typically the time remaining until nextUpdate)
+ * @return Error code
+ **/
+
+error_t tlsSetOcspResponse(TlsOcspCache *cache, const void *certId,
+   const uint8_t *response, size_t length, systime_t lifetime)
+{
+   error_t error;
+   uint_t i;
+   TlsOcspResponse *newResponse;
+   TlsOcspResponse *oldResponse;
+
+   //Check parameters
+   if(cache == NULL || certId == NULL || response == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the length of the OCSP response
+   if(length == 0 || length > TLS_OCSP_MAX_RESPONSE_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //Make sure the certificate is registered
+   error = tlsAddOcspCacheEntry(cache, certId);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Allocate a memory block to hold the response
+   newResponse = tlsAllocMem(sizeof(TlsOcspResponse) + length);
+   //Failed to allocate memory?
+   if(newResponse == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //The cache holds the first reference to the response
+   newResponse->refCount = 1;
+   newResponse->expiry = osGetSystemTime() + lifetime;
+   newResponse->length = length;
+   memcpy(newResponse->data, response, length);
+
+   //Initialize pointer
+   oldResponse = NULL;
+
+   //Acquire exclusive access to the cache
+   osAcquireMutex(&cache->mutex);
+
+   //Loop through the cache entries
+   for(i = 0; i < cache->size; i++)
+   {
+      //Matching entry?
+      if(cache->entries[i].certId == certId)
+      {
+         //Swap the responses
+         oldResponse = cache->entries[i].response;
+         cache->entries[i].response = newResponse;
+         newResponse = NULL;
+         break;
+      }
+   }
+
+   //Release exclusive access to the cache
+   osReleaseMutex(&cache->mutex);
+
+   //Drop the reference held by the cache on the previous response
+   tlsReleaseOcspResponse(cache, oldResponse);
+
+   //The entry may have vanished in the meantime
+   if(newResponse != NULL)
+      tlsFreeMem(newResponse);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Refresh the OCSP responses that are about to expire
+ *
+ * The fetch callback is invoked, outside of any lock, for each certificate
+ * whose response is missing or expires within TLS_OCSP_REFRESH_MARGIN. If
+ * a query fails, the previous response keeps being stapled until it expires
+ *
+ * @param[in] cache Pointer to the OCSP response cache
+ * @return Error code
+ **/
+
+error_t tlsRefreshOcspCache(TlsOcspCache *cache)
+{
+   error_t error;
+   error_t status;
+   uint_t i;
+   size_t length;
+   bool_t refresh;
+   systime_t time;
+   systime_t lifetime;
+   const void *certId;
+   uint8_t *buffer;
+   TlsOcspCacheEntry *entry;
+
+   //Check parameters
+   if(cache == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure a valid callback has been registered
+   if(cache->fetchCallback == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //Allocate a buffer to receive the OCSP responses
+   buffer = tlsAllocMem(TLS_OCSP_MAX_RESPONSE_SIZE);
+   //Failed to allocate memory?
+   if(buffer == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Initialize status code
+   status = NO_ERROR;
+
+   //Loop through the cache entries
+   for(i = 0; i < cache->size; i++)
+   {
+      //Point to the current entry
+      entry = &cache->entries[i];
+
+      //Get current time
+      time = osGetSystemTime();
+      //Initialize flag
+      refresh = FALSE;
+
+      //Acquire exclusive access to the cache
+      osAcquireMutex(&cache->mutex);
+
+      //Registered certificate?
+      certId = entry->certId;
+
+      //Make sure no other task is refreshing the same entry
+      if(certId != NULL && !entry->refreshing)
+      {
+         //Missing response or response about to expire?
+         if(entry->response == NULL || timeCompare(time +
+            TLS_OCSP_REFRESH_MARGIN, entry->response->expiry) >= 0)
+         {
+            //The entry is being refreshed
+            entry->refreshing = TRUE;
+            refresh = TRUE;
+         }
+      }
+
+      //Release exclusive access to the cache
+      osReleaseMutex(&cache->mutex);
+
+      //Query the OCSP responder, if necessary
+      if(refresh)
+      {
+         //Debug message
+         TRACE_DEBUG("Refreshing OCSP response...\r\n");
+
+         //Default lifetime of the response
+         lifetime = 0;
+
+         //Invoke user-defined callback
+         error = cache->fetchCallback(certId, buffer, &length,
+            TLS_OCSP_MAX_RESPONSE_SIZE, &lifetime, cache->fetchParam);
+
+         //Check status code
+         if(!error)
+         {
+            //Install the new response
+            error = tlsSetOcspResponse(cache, certId, buffer, length,
+               lifetime);
+         }
+
+         //Any error to report?
+         if(error)
+         {
+            //Debug message
+            TRACE_WARNING("Failed to refresh OCSP response!\r\n");
+            //Save the status code
+            status = error;
+         }
+
+         //Acquire exclusive access to the cache
+         osAcquireMutex(&cache->mutex);
+         //The refresh is complete
+         entry->refreshing = FALSE;
+         //Release exclusive access to the cache
+         osReleaseMutex(&cache->mutex);
+      }
+   }
+
+   //Release previously allocated memory
+   tlsFreeMem(buffer);
+
+   //Return status code
+   return status;
+}
+
+
+/**
+ * @brief Get a reference to the current OCSP response of a certificate
+ * @param[in] cache Pointer to the OCSP response cache
+ * @param[in] certId Certificate identifier
+ * @return Pointer to the OCSP response, or NULL if no valid response is
+ *   available. The reference must be released with tlsReleaseOcspResponse()
+ **/
+
+TlsOcspResponse *tlsGetOcspResponse(TlsOcspCache *cache, const void *certId)
+{
+   uint_t i;
+   systime_t time;
+   TlsOcspResponse *response;
+
+   //Initialize pointer
+   response = NULL;
+
+   //Check parameters
+   if(cache != NULL && certId != NULL)
+   {
+      //Get current time
+      time = osGetSystemTime();
+
+      //Acquire exclusive access to the cache
+      osAcquireMutex(&cache->mutex);
+
+      //Loop through the cache entries
+      for(i = 0; i < cache->size; i++)
+      {
+         //Matching entry?
+         if(cache->entries[i].certId == certId)
+         {
+            //Point to the current response
+            response = cache->entries[i].response;
+
+            //Expired responses must not be stapled
+            if(response != NULL && timeCompare(time, response->expiry) < 0)
+               response->refCount++;
+            else
+               response = NULL;
+
+            //We are done
+            break;
+         }
+      }
+
+      //Release exclusive access to the cache
+      osReleaseMutex(&cache->mutex);
+   }
+
+   //Return a pointer to the OCSP response
+   return response;
+}
+
+
+/**
+ * @brief Release a reference to an OCSP response
+ * @param[in] cache Pointer to the OCSP response cache
+ * @param[in] response Pointer to the OCSP response
+ **/
+
+void tlsReleaseOcspResponse(TlsOcspCache *cache, TlsOcspResponse *response)
+{
+   uint_t refCount;
+
+   //Valid response?
+   if(cache != NULL && response != NULL)
+   {
+      //Acquire exclusive access to the cache
+      osAcquireMutex(&cache->mutex);
+      //Decrement reference count
+      refCount = --response->refCount;
+      //Release exclusive access to the cache
+      osReleaseMutex(&cache->mutex);
+
+      //Last reference?
+      if(refCount == 0)
+      {
+         tlsFreeMem(response);
+      }
+   }
+}
+
+
+/**
+ * @brief Release OCSP response cache
+ * @param[in] cache OCSP response cache to be released
+ **/
+
+void tlsFreeOcspCache(TlsOcspCache *cache)
+{
+   uint_t i;
+
+   //Valid cache?
+   if(cache != NULL)
+   {
+      //Drop the references held by the cache
+      for(i = 0; i < cache->size; i++)
+      {
+         tlsReleaseOcspResponse(cache, cache->entries[i].response);
+      }
+
+      //Release previously allocated resources
+      osDeleteMutex(&cache->mutex);
+      //Free previously allocated memory
+      tlsFreeMem(cache);
+   }
+}
+
+
+/**
+ * @brief Get the identifier of a certificate in the OCSP response cache
+ * @param[in] cert Pointer to the certificate descriptor
+ * @return Certificate identifier
+ **/
+
+const void *tlsGetOcspCertId(const TlsCertDesc *cert)
+{
+   const void *certId;
+
+   //Pre-parsed credentials are identified by their handle, other
+   //certificates by their PEM-encoded chain
+   if(cert == NULL)
+      certId = NULL;
+   else if(cert->credential != NULL)
+      certId = cert->credential;
+   else
+      certId = cert->certChain;
+
+   //Return the certificate identifier
+   return certId;
+}
+
+
+/**
+ * @brief Select the OCSP response to be stapled to the server certificate
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsSelectOcspResponse(TlsContext *context)
+{
+   //Release the response selected by a previous handshake, if any
+   tlsReleaseStapledOcspResponse(context);
+
+#if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+   //Raw public keys do not have any revocation status
+   if(context->certFormat != TLS_CERT_FORMAT_X509)
+      return;
+#endif
+
+   //The status of the certificate is only sent during a full handshake
+   if(!context->resume)
+   {
+      //Only responses already in the cache are stapled. The OCSP responder
+      //is never contacted on the handshake path
+      context->ocspResponse = tlsGetOcspResponse(context->ocspCache,
+         tlsGetOcspCertId(context->cert));
+   }
+
+   //The server sends a CertificateStatus message only if a valid response
+   //is available
+   context->certStatusNegotiated = (context->ocspResponse != NULL);
+}
+
+
+/**
+ * @brief Release the OCSP response stapled to the server certificate
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsReleaseStapledOcspResponse(TlsContext *context)
+{
+   //Any OCSP response selected?
+   if(context->ocspResponse != NULL)
+   {
+      //Drop the reference held by the context
+      tlsReleaseOcspResponse(context->ocspCache, context->ocspResponse);
+      context->ocspResponse = NULL;
+   }
+
+   //No CertificateStatus message is expected
+   context->certStatusNegotiated = FALSE;
+}
+
+
+/**
+ * @brief Format CertificateStatus structure
+ * @param[in] context Pointer to the TLS context
+ * @param[out] message Buffer where to format the CertificateStatus structure
+ * @param[out] length Length of the resulting CertificateStatus structure
+ * @return Error code
+ **/
+
+error_t tlsFormatCertStatus(TlsContext *context,
+   TlsCertificateStatus *message, size_t *length)
+{
+   size_t n;
+
+   //Make sure an OCSP response has been selected
+   if(context->ocspResponse == NULL)
+      return ERROR_FAILURE;
+
+   //Get the length of the OCSP response
+   n = context->ocspResponse->length;
+
+   //Buffer overflow?
+   if((sizeof(TlsCertificateStatus) + n) > context->txBufferMaxLen)
+      return ERROR_MESSAGE_TOO_LONG;
+
+   //Set status type
+   message->statusType = TLS_CERT_STATUS_TYPE_OCSP;
+   //The OCSP response is preceded by a 3-byte length field
+   STORE24BE(n, message->responseLen);
+   //Copy the DER-encoded OCSP response
+   memcpy(message->response, context->ocspResponse->data, n);
+
+   //Length of the CertificateStatus structure
+   *length = sizeof(TlsCertificateStatus) + n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Check CertificateStatus structure
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Pointer to the CertificateStatus structure
+ * @param[in] length Length of the CertificateStatus structure
+ * @return Error code
+ **/
+
+error_t tlsCheckCertStatus(TlsContext *context,
+   const TlsCertificateStatus *message, size_t length)
+{
+   error_t error;
+   size_t n;
+
+   //Malformed structure?
+   if(length < sizeof(TlsCertificateStatus))
+      return ERROR_DECODING_FAILED;
+
+   //Only OCSP responses are supported
+   if(message->statusType != TLS_CERT_STATUS_TYPE_OCSP)
+      return ERROR_DECODING_FAILED;
+
+   //Get the length of the OCSP response
+   n = LOAD24BE(message->responseLen);
+
+   //The OCSP response cannot be empty
+   if(n == 0 || length != (sizeof(TlsCertificateStatus) + n))
+      return ERROR_DECODING_FAILED;
+
+   //Debug message
+   TRACE_DEBUG("OCSP response (%" PRIuSIZE " bytes):\r\n", n);
+   TRACE_DEBUG_ARRAY("  ", message->response, n);
+
+   //The application checks the OCSP response, so that no separate query to
+   //the OCSP responder is needed
+   if(context->ocspResponseCallback != NULL)
+   {
+      //Invoke user-defined callback
+      error = context->ocspResponseCallback(context, message->response, n,
+         context->ocspResponseParam);
+
+      //An unacceptable response aborts the handshake
+      if(error)
+         return ERROR_BAD_CERTIFICATE_STATUS_RESPONSE;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * @file tls_ocsp.h
+ * @brief OCSP stapling
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_OCSP_H
+#define _TLS_OCSP_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//OCSP response cache management
+TlsOcspCache *tlsInitOcspCache(uint_t size,
+   TlsOcspFetchCallback fetchCallback, void *param);
+
+error_t tlsAddOcspCacheEntry(TlsOcspCache *cache, const void *certId);
+
+error_t tlsSetOcspResponse(TlsOcspCache *cache, const void *certId,
+   const uint8_t *response, size_t length, systime_t lifetime);
+
+error_t tlsRefreshOcspCache(TlsOcspCache *cache);
+
+TlsOcspResponse *tlsGetOcspResponse(TlsOcspCache *cache, const void *certId);
+
+void tlsReleaseOcspResponse(TlsOcspCache *cache, TlsOcspResponse *response);
+
+void tlsFreeOcspCache(TlsOcspCache *cache);
+
+//OCSP stapling
+const void *tlsGetOcspCertId(const TlsCertDesc *cert);
+
+void tlsSelectOcspResponse(TlsContext *context);
+void tlsReleaseStapledOcspResponse(TlsContext *context);
+
+error_t tlsFormatCertStatus(TlsContext *context,
+   TlsCertificateStatus *message, size_t *length);
+
+error_t tlsCheckCertStatus(TlsContext *context,
+   const TlsCertificateStatus *message, size_t length);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
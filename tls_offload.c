@@ -0,0 +1,170 @@
+/**
+ * @file tls_offload.c
+ * @brief Record layer offload (kernel TLS)
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_offload.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Export the traffic keys of an encryption engine
+ * @param[in] context Pointer to the TLS context
+ * @param[in] encryptionEngine Pointer to the encryption/decryption engine
+ * @param[out] keys Traffic keys to be installed in the transport layer
+ **/
+
+void tlsExportOffloadKeys(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, TlsOffloadKeys *keys)
+{
+   //Negotiated parameters
+   keys->version = encryptionEngine->version;
+   keys->cipherSuite = context->cipherSuite.identifier;
+   keys->cipherMode = encryptionEngine->cipherMode;
+
+   //Traffic key
+   keys->key = encryptionEngine->encKey;
+   keys->keyLen = encryptionEngine->encKeyLen;
+
+   //The implicit part of the nonce is the salt (TLS 1.2) or the static IV
+   //(TLS 1.3). The explicit part is derived from the sequence number
+   keys->iv = encryptionEngine->iv;
+   keys->ivLen = encryptionEngine->fixedIvLen;
+
+   //Length of the authentication tag
+   keys->authTagLen = encryptionEngine->authTagLen;
+
+   //The transport layer resumes the record sequence where the TLS library
+   //stopped
+   keys->seqNum = encryptionEngine->seqNum;
+}
+
+
+/**
+ * @brief Send application data over an offloaded connection
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t tlsOffloadWrite(TlsContext *context, const void *data,
+   size_t length, size_t *written, uint_t flags)
+{
+   error_t error;
+   size_t n;
+   size_t totalLength;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Actual number of bytes written
+   totalLength = 0;
+
+   //The transport layer encrypts the data on the fly
+   while(totalLength < length)
+   {
+      //Total number of bytes that have been written
+      n = 0;
+
+      //Send more data
+      error = context->socketSendCallback(context->socketHandle,
+         (const uint8_t *) data + totalLength, length - totalLength, &n, flags);
+
+      //Check status code
+      if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+      {
+         //Update byte counter
+         totalLength += n;
+      }
+      else
+      {
+         //The write operation has failed
+         error = ERROR_WRITE_FAILED;
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+   }
+
+   //Total number of data that have been written
+   if(written != NULL)
+      *written = totalLength;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Receive application data over an offloaded connection
+ * @param[in] context Pointer to the TLS context
+ * @param[out] data Buffer into which received data will be placed
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t tlsOffloadRead(TlsContext *context, void *data,
+   size_t size, size_t *received, uint_t flags)
+{
+   error_t error;
+
+   //No data has been read yet
+   *received = 0;
+
+   //The transport layer delivers decrypted data
+   error = context->socketReceiveCallback(context->socketHandle, data, size,
+      received, flags);
+
+   //Any non-recoverable error?
+   if(error != NO_ERROR && error != ERROR_WOULD_BLOCK &&
+      error != ERROR_TIMEOUT && error != ERROR_END_OF_STREAM)
+   {
+      //The read operation has failed
+      error = ERROR_READ_FAILED;
+   }
+
+   //Return status code
+   return error;
+}
+
+#endif
@@ -35,6 +35,12 @@
 #include <string.h>
 #include "tls.h"
 #include "tls_record.h"
+#include "dtls_record.h"
+#include "tls_cert_stream.h"
+#include "tls_handshake.h"
+#include "tls_buffer.h"
+#include "tls_misc.h"
+#include "tls_stats.h"
 #include "tls_record_encryption.h"
 #include "tls_record_decryption.h"
 #include "debug.h"
@@ -59,86 +65,857 @@ error_t tlsWriteProtocolData(TlsContext *context,
    size_t n;
    uint8_t *p;
 
+#if (TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   //Handshake messages of the current flight are held in the TX buffer?
+   if(context->txFlightLen > 0)
+   {
+      //The messages are kept as long as the flight can be extended under
+      //the same keys
+      if(data == NULL && length == 0 && tlsCanAppendToFlight(context))
+         return NO_ERROR;
+
+      //The accumulated messages must be encoded before any other data
+      tlsPackFlight(context);
+   }
+#endif
+
+   //The payload area lent to the application is about to be overwritten
+   context->txZeroCopy = FALSE;
+
+   //The TX buffer may have been released while the connection was idle
+   error = tlsAcquireTxBuffer(context);
+
+   //Fragmentation process
+   while(!error)
+   {
+#if (TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+      if(context->txBulkPos < context->txBulkLen && !context->txFlightActive)
+#else
+      if(context->txBulkPos < context->txBulkLen)
+#endif
+      {
+         //Records encrypted by tlsWriteBulkData must be sent first
+         error = tlsSendBulkData(context);
+      }
+      else if(context->txBufferLen == 0)
+      {
+         //Point to the application data accumulated by tlsWritev
+         p = context->txBuffer + context->txBufferSize - context->txBufferMaxLen;
+
+         //Pending application data must be sent first, since the encoding
+         //of any other record would overwrite them
+         if(context->txPendingLen > 0 && data != p)
+         {
+            //Number of bytes that have been accumulated
+            n = context->txPendingLen;
+
+            //Make room for the encryption overhead
+            memmove(context->txBuffer + context->txBufferSize - n, p, n);
+
+            //Save record type
+            context->txBufferType = TLS_TYPE_APPLICATION_DATA;
+            //Set the length of the buffer
+            context->txBufferLen = n;
+            //Point to the beginning of the buffer
+            context->txBufferPos = 0;
+
+            //The accumulated data have already been reported as written
+            context->txPendingLen = 0;
+            context->txDataAccepted = TRUE;
+         }
+         else if(length > context->txBufferMaxLen)
+         {
+            //Report an error
+            error = ERROR_MESSAGE_TOO_LONG;
+         }
+         else if(length > 0)
+         {
+            //Make room for the encryption overhead
+            memmove(context->txBuffer + context->txBufferSize - length, data,
+               length);
+
+            //Save record type
+            context->txBufferType = contentType;
+            //Set the length of the buffer
+            context->txBufferLen = length;
+            //Point to the beginning of the buffer
+            context->txBufferPos = 0;
+         }
+         else
+         {
+            //We are done
+            break;
+         }
+      }
+      else if(context->txBufferPos < context->txBufferLen)
+      {
+         //Number of bytes left to send
+         n = context->txBufferLen - context->txBufferPos;
+         //Point to the current fragment
+         p = context->txBuffer + context->txBufferSize - n;
+
+         //The record length must not exceed 16384 bytes
+         n = MIN(n, TLS_MAX_RECORD_LENGTH);
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+         //Do not exceed the negotiated maximum fragment length
+         n = MIN(n, context->maxFragLen);
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+         //The value of RecordSizeLimit is used to limit the size of records
+         //that are created when encoding application data and the protected
+         //handshake message into records
+         if(context->encryptionEngine.cipherMode != CIPHER_MODE_NULL ||
+            context->encryptionEngine.hashAlgo != NULL)
+         {
+            //An endpoint must not generate a protected record with plaintext
+            //that is larger than the RecordSizeLimit value it receives from
+            //its peer (refer to RFC 8449, section 4)
+            n = MIN(n, context->encryptionEngine.recordSizeLimit);
+         }
+#endif
+         //Send TLS record
+         error = tlsWriteRecord(context, p, n, context->txBufferType);
+
+         //Check status code
+         if(!error)
+         {
+            //Advance data pointer
+            context->txBufferPos += n;
+         }
+      }
+      else
+      {
+         //Prepare to send new protocol data
+         context->txBufferLen = 0;
+         context->txBufferPos = 0;
+
+         //The record that has just been sent does not belong to the caller
+         //if it was already reported as written
+         if(!context->txDataAccepted)
+            break;
+
+         //Proceed with the data supplied by the caller
+         context->txDataAccepted = FALSE;
+      }
+   }
+
+#if (TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+   //Check whether the flight is complete
+   if(!error && context->txFlightActive && !tlsIsFlightInProgress(context))
+   {
+      //End of the flight
+      context->txFlightActive = FALSE;
+      //The records of the flight are handed to the transport layer at once
+      error = tlsSendBulkData(context);
+   }
+#endif
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the maximum length of the plaintext fragments
+ * @param[in] context Pointer to the TLS context
+ * @return Maximum number of application bytes per TLS record
+ **/
+
+size_t tlsGetTxFragmentLimit(TlsContext *context)
+{
+   size_t n;
+
+   //The fragment must fit in the TX buffer
+   n = context->txBufferMaxLen;
+   //The record length must not exceed 16384 bytes
+   n = MIN(n, TLS_MAX_RECORD_LENGTH);
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   //Do not exceed the negotiated maximum fragment length
+   n = MIN(n, context->maxFragLen);
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //Maximum record size the peer is willing to receive
+   n = MIN(n, context->recordSizeLimit);
+#endif
+
+   //Return the maximum fragment length
+   return n;
+}
+
+
+/**
+ * @brief Get the maximum length of the application data fragments
+ *
+ * When dynamic record sizing is enabled, the fragments are kept small
+ * enough for each record to fit in a single transport segment until enough
+ * data have been sent. The small records are used again after an idle
+ * period
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Maximum number of application bytes per TLS record
+ **/
+
+size_t tlsGetAppDataFragmentLimit(TlsContext *context)
+{
+   size_t n;
+#if (TLS_DYNAMIC_RECORD_SIZING_SUPPORT == ENABLED)
+   size_t overhead;
+#endif
+
+   //Maximum number of application bytes per record
+   n = tlsGetTxFragmentLimit(context);
+
+#if (TLS_DYNAMIC_RECORD_SIZING_SUPPORT == ENABLED)
+   //Dynamic record sizing enabled?
+   if(context->drsSegmentSize != 0)
+   {
+      //Idle connection?
+      if(context->drsBytesSent > 0 && context->drsIdleTimeout != 0 &&
+         (osGetSystemTime() - context->drsTimestamp) >= context->drsIdleTimeout)
+      {
+         //The congestion window has probably been reduced, so start again
+         //with small records
+         context->drsBytesSent = 0;
+      }
+
+      //Still in the initial phase?
+      if(context->drsBytesSent < context->drsRampThreshold)
+      {
+         //Worst-case expansion of the record (including the inner content
+         //type of TLS 1.3)
+         overhead = tlsComputeEncryptionOverhead(&context->encryptionEngine,
+            context->drsSegmentSize) + 1;
+
+         //The whole record must fit in a single transport segment
+         if(context->drsSegmentSize > (sizeof(TlsRecord) + overhead))
+         {
+            n = MIN(n, context->drsSegmentSize - sizeof(TlsRecord) - overhead);
+         }
+      }
+   }
+#endif
+
+   //Return the maximum fragment length
+   return n;
+}
+
+
+/**
+ * @brief Update the state of the dynamic record sizing policy
+ * @param[in] context Pointer to the TLS context
+ * @param[in] length Number of application bytes that have been sent
+ **/
+
+void tlsUpdateDynamicRecordSizing(TlsContext *context, size_t length)
+{
+#if (TLS_DYNAMIC_RECORD_SIZING_SUPPORT == ENABLED)
+   //Dynamic record sizing enabled?
+   if(context->drsSegmentSize != 0 && length > 0)
+   {
+      //Keep track of the number of bytes sent since the last reset
+      if(context->drsBytesSent < context->drsRampThreshold)
+         context->drsBytesSent += length;
+
+      //Save the time at which application data were last sent
+      context->drsTimestamp = osGetSystemTime();
+   }
+#endif
+}
+
+
+/**
+ * @brief Write application data from multiple segments
+ *
+ * The data are accumulated in the TX buffer and a TLS record is sent each
+ * time a full fragment is available. When the TLS_FLAG_CORK flag is set,
+ * the last partial fragment is kept until more data are supplied or the
+ * connection is flushed
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] iov List of data segments
+ * @param[in] iovCount Number of data segments
+ * @param[out] written Actual number of bytes written
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t tlsWriteGatheredData(TlsContext *context, const TlsIoVec *iov,
+   uint_t iovCount, size_t *written, uint_t flags)
+{
+   error_t error;
+   bool_t accepted;
+   uint_t i;
+   size_t n;
+   size_t offset;
+   size_t skip;
+   size_t limit;
+   size_t totalLength;
+   uint8_t *p;
+   TlsContentType contentType;
+
+   //The TX buffer may have been released while the connection was idle
+   error = tlsAcquireTxBuffer(context);
+
+   //Maximum number of application bytes per record
+   limit = tlsGetAppDataFragmentLimit(context);
+
+   //Initialize variables
+   i = 0;
+   offset = 0;
+   skip = 0;
+   totalLength = 0;
+
+   //Gather process
+   while(!error)
+   {
+      if(i < iovCount && offset >= iov[i].length)
+      {
+         //Jump to the next data segment
+         i++;
+         offset = 0;
+      }
+      else if(context->txBufferLen != 0)
+      {
+         //Save the characteristics of the record in flight
+         n = context->txBufferLen;
+         accepted = context->txDataAccepted;
+         contentType = (TlsContentType) context->txBufferType;
+
+         //Complete the transmission of the record
+         error = tlsWriteProtocolData(context, NULL, 0, TLS_TYPE_NONE);
+
+         //Application data that were not reported as written by a previous
+         //call to tlsWrite are expected to be supplied again by the caller
+         if(!error && !accepted && contentType == TLS_TYPE_APPLICATION_DATA)
+         {
+            skip = n;
+         }
+      }
+      else if(i < iovCount)
+      {
+         //Number of bytes left in the current segment
+         n = iov[i].length - offset;
+
+         //Data that have already been sent?
+         if(skip > 0)
+         {
+            //Discard the corresponding bytes
+            n = MIN(n, skip);
+            skip -= n;
+         }
+         else if(context->txPendingLen < limit)
+         {
+            //The size of the record may change when a new fragment is started
+            if(context->txPendingLen == 0)
+               limit = tlsGetAppDataFragmentLimit(context);
+
+            //Point to the area where application data are accumulated
+            p = context->txBuffer + context->txBufferSize -
+               context->txBufferMaxLen;
+
+            //Copy as much data as possible
+            n = MIN(n, limit - context->txPendingLen);
+            memcpy(p + context->txPendingLen,
+               (const uint8_t *) iov[i].data + offset, n);
+
+            //Update the length of the pending data
+            context->txPendingLen += n;
+
+            //Update the state of the dynamic record sizing policy
+            tlsUpdateDynamicRecordSizing(context, n);
+         }
+         else
+         {
+            //The fragment is full
+            n = 0;
+            //Send a TLS record
+            error = tlsWriteProtocolData(context, NULL, 0, TLS_TYPE_NONE);
+         }
+
+         //Advance data pointer
+         offset += n;
+         //Update byte counter
+         totalLength += n;
+      }
+      else if(context->txPendingLen > 0 && (flags & TLS_FLAG_CORK) == 0)
+      {
+         //Send the last fragment
+         error = tlsWriteProtocolData(context, NULL, 0, TLS_TYPE_NONE);
+      }
+      else
+      {
+         //We are done
+         break;
+      }
+   }
+
+   //Total number of data that have been written
+   *written = totalLength;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the application data held back by the TLS_FLAG_CORK flag
+ *
+ * The caller holds the TX lock. The function is invoked before waiting for
+ * the response of the peer, which would otherwise never come
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsFlushCorkedData(TlsContext *context)
+{
+   error_t error;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+#if (DTLS_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      //Send the records packed into the current datagram
+      if(tlsIsRecordPackingEnabled(context))
+      {
+         error = dtlsFlushDatagram(context);
+      }
+   }
+   else
+#endif
+   //TLS protocol?
+   {
+      //Any data pending in the TX buffer?
+      if(context->txPendingLen > 0 || context->txBufferLen != 0)
+      {
+         //Send the last fragment
+         error = tlsWriteProtocolData(context, NULL, 0, TLS_TYPE_NONE);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Encrypt several TLS records at once and send them together
+ *
+ * The data are split into full-sized records which are encrypted back to
+ * back into the bulk send buffer, and then passed to the send callback in a
+ * single call. The records are reported as written as soon as they have
+ * been encrypted
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to the application data
+ * @param[in] length Number of data bytes to be written
+ * @param[out] written Actual number of bytes written
+ * @return Error code
+ **/
+
+error_t tlsWriteBulkData(TlsContext *context, const uint8_t *data,
+   size_t length, size_t *written)
+{
+   error_t error;
+   size_t n;
+   size_t limit;
+   size_t overhead;
+   size_t totalLength;
+   uint16_t legacyVersion;
+   TlsRecord *record;
+   TlsEncryptionEngine *encryptionEngine;
+
+   //The payload area lent to the application is about to be overwritten
+   context->txZeroCopy = FALSE;
+
+   //Point to the encryption engine
+   encryptionEngine = &context->encryptionEngine;
+
+   //Actual number of bytes written
+   totalLength = 0;
+
+   //Complete the transmission of the previous batch
+   error = tlsSendBulkData(context);
+
+   //Check status code
+   if(!error)
+   {
+      //Maximum number of application bytes per record
+      limit = tlsGetTxFragmentLimit(context);
+
+      //The record version must be set to 0x0303 for all records generated
+      //by a TLS 1.3 implementation other than an initial ClientHello
+      legacyVersion = MIN(context->version, TLS_VERSION_1_2);
+
+      //Encrypt as many records as the buffer can hold
+      while(totalLength < length)
+      {
+         //Length of the current fragment
+         n = MIN(length - totalLength, limit);
+
+         //Worst-case expansion of the record (including the inner content
+         //type of TLS 1.3)
+         overhead = tlsComputeEncryptionOverhead(encryptionEngine, n) + 1;
+
+         //Make sure the record fits in the buffer
+         if((context->txBulkLen + sizeof(TlsRecord) + n + overhead) >
+            context->txBulkSize)
+         {
+            break;
+         }
+
+         //Point to the current record
+         record = (TlsRecord *) (context->txBulkBuffer + context->txBulkLen);
+
+         //Format TLS record
+         record->type = TLS_TYPE_APPLICATION_DATA;
+         record->version = htons(legacyVersion);
+         record->length = htons(n);
+
+         //Copy record data
+         memcpy(record->data, data + totalLength, n);
+
+         //Protect record payload?
+         if(encryptionEngine->cipherMode != CIPHER_MODE_NULL ||
+            encryptionEngine->hashAlgo != NULL)
+         {
+            //Encrypt TLS record
+            error = encryptionEngine->encryptRecord(context, encryptionEngine,
+               record);
+            //Any error to report?
+            if(error)
+               break;
+         }
+
+         //Append the record to the batch
+         context->txBulkLen += sizeof(TlsRecord) + ntohs(record->length);
+         //Update byte counter
+         totalLength += n;
+
+         //Update statistics
+         TLS_CONTEXT_STATS_ADD(context, recordsOut, 1);
+         TLS_CONTEXT_STATS_ADD(context, bytesOut, sizeof(TlsRecord) +
+            ntohs(record->length));
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Send the whole batch
+         error = tlsSendBulkData(context);
+
+         //The encrypted records are accepted even if the transport layer
+         //cannot send them immediately
+         if(error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+            error = NO_ERROR;
+      }
+   }
+
+   //Total number of data that have been written
+   *written = totalLength;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the records pending in the bulk send buffer
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsSendBulkData(TlsContext *context)
+{
+   error_t error;
+   size_t n;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Send as much data as possible
+   while(context->txBulkPos < context->txBulkLen)
+   {
+      //Total number of bytes that have been written
+      n = 0;
+
+      //Send more data
+      error = tlsSocketSend(context, context->txBulkBuffer + context->txBulkPos,
+         context->txBulkLen - context->txBulkPos, &n);
+
+      //Check status code
+      if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+      {
+         //Advance data pointer
+         context->txBulkPos += n;
+      }
+      else
+      {
+         //The write operation has failed
+         error = ERROR_WRITE_FAILED;
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //The buffer is empty
+      context->txBulkLen = 0;
+      context->txBulkPos = 0;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Hand data to the transport layer
+ *
+ * The first data sent by a client using TCP Fast Open carry the
+ * TLS_FLAG_FAST_OPEN flag, so that the socket send callback opens the
+ * connection with them.
+ *
+ * With a completion-based transport, a send request pointing to the data is
+ * posted and ERROR_WOULD_BLOCK is returned until the application reports its
+ * completion with tlsCompleteSend. The data stay in place in the TX buffer
+ * (or the bulk send buffer) while the request is in progress, and the next
+ * call with the same data returns the outcome of the request
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to the data to be sent
+ * @param[in] length Number of bytes to be sent
+ * @param[out] written Actual number of bytes written
+ * @return Error code
+ **/
+
+error_t tlsSocketSend(TlsContext *context, const void *data, size_t length,
+   size_t *written)
+{
+   error_t error;
+   uint_t flags;
+
+   //Default flags
+   flags = 0;
+
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED)
+   //The connection has not been opened yet?
+   if(context->fastOpenPending)
+      flags |= TLS_FLAG_FAST_OPEN;
+#endif
+
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //Completion-based transport?
+   if(context->socketSubmitSendCallback != NULL)
+   {
+      //Nothing has been sent yet
+      *written = 0;
+
+      //Any request in progress?
+      if(!context->txIoRequest.posted)
+      {
+         //Ask the transport to send the data directly from the buffer
+         error = context->socketSubmitSendCallback(context->socketHandle,
+            data, length, flags);
+
+         //Check status code
+         if(!error)
+         {
+            //The request is now in progress
+            context->txIoRequest.posted = TRUE;
+            context->txIoRequest.completed = FALSE;
+            context->txIoRequest.length = length;
+
+            //Wait for the completion
+            error = ERROR_WOULD_BLOCK;
+         }
+      }
+      else if(!context->txIoRequest.completed)
+      {
+         //The request is still in progress
+         error = ERROR_WOULD_BLOCK;
+      }
+      else
+      {
+         //Report the outcome of the request
+         *written = MIN(context->txIoRequest.count, length);
+         error = context->txIoRequest.status;
+
+         //A new request can be posted
+         context->txIoRequest.posted = FALSE;
+      }
+   }
+   else
+#endif
+   {
+      //Send data
+      error = context->socketSendCallback(context->socketHandle, data, length,
+         written, flags);
+   }
+
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED)
+   //The connection is open once the transport has accepted data
+   if(error == NO_ERROR || *written > 0)
+      context->fastOpenPending = FALSE;
+#endif
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Reserve the payload area of the next TLS record
+ *
+ * The payload is located right after the record header and the explicit
+ * nonce, so that the record can be protected in place
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] payload Pointer to the payload area
+ * @param[out] size Maximum number of bytes that can be written
+ * @return Error code
+ **/
+
+error_t tlsReserveTxPayload(TlsContext *context, uint8_t **payload,
+   size_t *size)
+{
+   error_t error;
+   size_t n;
+   TlsRecord *record;
+
+   //Complete the transmission of any pending data
+   error = tlsWriteProtocolData(context, NULL, 0, TLS_TYPE_NONE);
+
+   //Check status code
+   if(!error)
+   {
+      //Point to the TLS record
+      record = (TlsRecord *) context->txBuffer;
+
+      //Offset of the payload
+      n = 0;
+
+#if (TLS_CCM_CIPHER_SUPPORT == ENABLED || TLS_CCM_8_CIPHER_SUPPORT == ENABLED || \
+   TLS_GCM_CIPHER_SUPPORT == ENABLED || TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
+      //AEAD cipher?
+      if(context->encryptionEngine.cipherMode == CIPHER_MODE_CCM ||
+         context->encryptionEngine.cipherMode == CIPHER_MODE_GCM ||
+         context->encryptionEngine.cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+      {
+         //Leave room for the explicit part of the nonce
+         n = context->encryptionEngine.recordIvLen;
+      }
+#endif
+
+      //Point to the payload area
+      *payload = record->data + n;
+      //Maximum number of application bytes per record
+      *size = tlsGetAppDataFragmentLimit(context);
+
+      //The payload area is now owned by the application
+      context->txZeroCopy = TRUE;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Protect and send the TLS record whose payload has been reserved
+ * @param[in] context Pointer to the TLS context
+ * @param[in] length Number of bytes written in the payload area
+ * @return Error code
+ **/
+
+error_t tlsWriteReservedRecord(TlsContext *context, size_t length)
+{
+   error_t error;
+   uint16_t legacyVersion;
+   TlsRecord *record;
+   TlsEncryptionEngine *encryptionEngine;
+
+   //The payload area must have been reserved beforehand
+   if(!context->txZeroCopy)
+      return ERROR_WRONG_STATE;
+
+   //Check the length of the payload
+   if(length > tlsGetTxFragmentLimit(context))
+      return ERROR_MESSAGE_TOO_LONG;
+
+   //Empty payload?
+   if(length == 0)
+   {
+      //Give back the payload area
+      context->txZeroCopy = FALSE;
+      //No record needs to be sent
+      return NO_ERROR;
+   }
+
+   //Point to the encryption engine
+   encryptionEngine = &context->encryptionEngine;
+   //Point to the TLS record
+   record = (TlsRecord *) context->txBuffer;
+
+   //The record version must be set to 0x0303 for all records generated
+   //by a TLS 1.3 implementation other than an initial ClientHello
+   legacyVersion = MIN(context->version, TLS_VERSION_1_2);
+
+   //Format TLS record
+   record->type = TLS_TYPE_APPLICATION_DATA;
+   record->version = htons(legacyVersion);
+   record->length = htons(length);
+
    //Initialize status code
    error = NO_ERROR;
 
-   //Fragmentation process
-   while(!error)
+   //Protect record payload?
+   if(encryptionEngine->cipherMode != CIPHER_MODE_NULL ||
+      encryptionEngine->hashAlgo != NULL)
    {
-      if(context->txBufferLen == 0)
-      {
-         //Check the length of the data
-         if(length > context->txBufferMaxLen)
-         {
-            //Report an error
-            error = ERROR_MESSAGE_TOO_LONG;
-         }
-         else if(length > 0)
-         {
-            //Make room for the encryption overhead
-            memmove(context->txBuffer + context->txBufferSize - length, data,
-               length);
+      //Encrypt TLS record
+      error = encryptionEngine->encryptRecord(context, encryptionEngine, record);
+   }
 
-            //Save record type
-            context->txBufferType = contentType;
-            //Set the length of the buffer
-            context->txBufferLen = length;
-            //Point to the beginning of the buffer
-            context->txBufferPos = 0;
-         }
-         else
-         {
-            //We are done
-            break;
-         }
-      }
-      else if(context->txBufferPos < context->txBufferLen)
-      {
-         //Number of bytes left to send
-         n = context->txBufferLen - context->txBufferPos;
-         //Point to the current fragment
-         p = context->txBuffer + context->txBufferSize - n;
+   //The payload area has been consumed
+   context->txZeroCopy = FALSE;
 
-         //The record length must not exceed 16384 bytes
-         n = MIN(n, TLS_MAX_RECORD_LENGTH);
+   //Check status code
+   if(!error)
+   {
+      //Actual length of the record data
+      context->txRecordLen = sizeof(TlsRecord) + ntohs(record->length);
+      //Point to the beginning of the record
+      context->txRecordPos = 0;
 
-#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
-         //Do not exceed the negotiated maximum fragment length
-         n = MIN(n, context->maxFragLen);
-#endif
+      //Update statistics
+      TLS_CONTEXT_STATS_ADD(context, recordsOut, 1);
+      TLS_CONTEXT_STATS_ADD(context, bytesOut, context->txRecordLen);
 
-#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
-         //The value of RecordSizeLimit is used to limit the size of records
-         //that are created when encoding application data and the protected
-         //handshake message into records
-         if(context->encryptionEngine.cipherMode != CIPHER_MODE_NULL ||
-            context->encryptionEngine.hashAlgo != NULL)
-         {
-            //An endpoint must not generate a protected record with plaintext
-            //that is larger than the RecordSizeLimit value it receives from
-            //its peer (refer to RFC 8449, section 4)
-            n = MIN(n, context->encryptionEngine.recordSizeLimit);
-         }
-#endif
-         //Send TLS record
-         error = tlsWriteRecord(context, p, n, context->txBufferType);
+      //The plaintext is accounted as the data in flight
+      context->txBufferType = TLS_TYPE_APPLICATION_DATA;
+      context->txBufferLen = length;
+      context->txBufferPos = 0;
 
-         //Check status code
-         if(!error)
-         {
-            //Advance data pointer
-            context->txBufferPos += n;
-         }
-      }
-      else
-      {
-         //Prepare to send new protocol data
-         context->txBufferLen = 0;
-         context->txBufferPos = 0;
+      //The application data have already been reported as written
+      context->txDataAccepted = TRUE;
 
-         //We are done
-         break;
-      }
+      //Update the state of the dynamic record sizing policy
+      tlsUpdateDynamicRecordSizing(context, length);
+
+      //Send the TLS record
+      error = tlsWriteProtocolData(context, NULL, 0, TLS_TYPE_NONE);
    }
 
    //Return status code
@@ -163,8 +940,11 @@ error_t tlsReadProtocolData(TlsContext *context,
    TlsContentType type;
    TlsHandshake *message;
 
-   //Initialize status code
-   error = NO_ERROR;
+   //The RX buffer may have been released while the connection was idle
+   error = tlsAcquireRxBuffer(context);
+   //Any error to report?
+   if(error)
+      return error;
 
    //Fragment reassembly process
    do
@@ -224,6 +1004,37 @@ error_t tlsReadProtocolData(TlsContext *context,
       //Check status code
       if(!error)
       {
+#if (TLS_CERT_STREAM_SUPPORT == ENABLED)
+         //Records of other types cannot be interleaved with the fragments of
+         //a handshake message that is being parsed incrementally
+         if(context->rxStreamLen > 0 &&
+            context->rxBufferType != TLS_TYPE_HANDSHAKE)
+         {
+            //Report an error
+            error = ERROR_UNEXPECTED_MESSAGE;
+         }
+         //Next fragment of a handshake message parsed incrementally?
+         else if(context->rxStreamLen > 0)
+         {
+            //Empty record?
+            if(context->rxBufferLen == 0)
+            {
+               //Read an additional record
+               error = ERROR_MORE_DATA_REQUIRED;
+            }
+            else
+            {
+               //Pass the available data to the higher layer, without going
+               //past the end of the message
+               n = MIN(context->rxBufferLen,
+                  context->rxStreamLen - context->rxStreamPos);
+
+               //Pass the fragment to the higher layer
+               error = NO_ERROR;
+            }
+         }
+         else
+#endif
          //Handshake message received?
          if(context->rxBufferType == TLS_TYPE_HANDSHAKE)
          {
@@ -243,8 +1054,25 @@ error_t tlsReadProtocolData(TlsContext *context,
                //A message may be fragmented across several records
                if(context->rxBufferLen < n)
                {
-                  //Read an additional record
-                  error = ERROR_MORE_DATA_REQUIRED;
+#if (TLS_CERT_STREAM_SUPPORT == ENABLED)
+                  //Certificate messages are parsed as the records arrive,
+                  //so that the RX buffer need not hold the whole chain
+                  if(tlsIsCertStreamAllowed(context, message->msgType))
+                  {
+                     //Length of the handshake message
+                     context->rxStreamLen = n;
+                     context->rxStreamPos = 0;
+
+                     //Pass the beginning of the message to the higher layer
+                     n = context->rxBufferLen;
+                     error = NO_ERROR;
+                  }
+                  else
+#endif
+                  {
+                     //Read an additional record
+                     error = ERROR_MORE_DATA_REQUIRED;
+                  }
                }
                else
                {
@@ -387,7 +1215,7 @@ error_t tlsWriteRecord(TlsContext *context, const uint8_t *data,
             encryptionEngine->hashAlgo != NULL)
          {
             //Encrypt TLS record
-            error = tlsEncryptRecord(context, encryptionEngine, record);
+            error = encryptionEngine->encryptRecord(context, encryptionEngine, record);
          }
 
          //Check status code
@@ -397,28 +1225,59 @@ error_t tlsWriteRecord(TlsContext *context, const uint8_t *data,
             context->txRecordLen = sizeof(TlsRecord) + ntohs(record->length);
             //Point to the beginning of the record
             context->txRecordPos = 0;
+
+            //Update statistics
+            TLS_CONTEXT_STATS_ADD(context, recordsOut, 1);
+            TLS_CONTEXT_STATS_ADD(context, bytesOut, context->txRecordLen);
          }
       }
       else if(context->txRecordPos < context->txRecordLen)
       {
-         //Total number of bytes that have been written
-         n = 0;
-
-         //Send more data
-         error = context->socketSendCallback(context->socketHandle,
-            context->txBuffer + context->txRecordPos,
-            context->txRecordLen - context->txRecordPos, &n, 0);
-
-         //Check status code
-         if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+#if (TLS_FLIGHT_COALESCING_SUPPORT == ENABLED)
+         //The records of a flight are gathered in the bulk send buffer, if
+         //any, so that the whole flight is sent with a single call
+         if(context->txFlightActive && context->txBulkBuffer != NULL)
          {
-            //Advance data pointer
-            context->txRecordPos += n;
+            //Check whether the record fits in the bulk send buffer
+            if((context->txBulkLen + context->txRecordLen) <= context->txBulkSize)
+            {
+               //Append the record to the batch
+               memcpy(context->txBulkBuffer + context->txBulkLen,
+                  context->txBuffer, context->txRecordLen);
+
+               //Update the length of the batch
+               context->txBulkLen += context->txRecordLen;
+               //The record is ready to be sent
+               context->txRecordPos = context->txRecordLen;
+            }
+            else
+            {
+               //Make room for the record
+               error = tlsSendBulkData(context);
+            }
          }
          else
+#endif
          {
-            //The write operation has failed
-            error = ERROR_WRITE_FAILED;
+            //Total number of bytes that have been written
+            n = 0;
+
+            //Send more data
+            error = tlsSocketSend(context,
+               context->txBuffer + context->txRecordPos,
+               context->txRecordLen - context->txRecordPos, &n);
+
+            //Check status code
+            if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+            {
+               //Advance data pointer
+               context->txRecordPos += n;
+            }
+            else
+            {
+               //The write operation has failed
+               error = ERROR_WRITE_FAILED;
+            }
          }
       }
       else
@@ -473,9 +1332,8 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
             n = 0;
 
             //Read TLS record header
-            error = context->socketReceiveCallback(context->socketHandle,
-               data + context->rxRecordPos,
-               sizeof(TlsRecord) - context->rxRecordPos, &n, 0);
+            error = tlsReceiveRecordData(context, data + context->rxRecordPos,
+               sizeof(TlsRecord) - context->rxRecordPos, &n);
 
             //Check status code
             if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
@@ -515,9 +1373,8 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
             n = 0;
 
             //Read TLS record contents
-            error = context->socketReceiveCallback(context->socketHandle,
-               data + context->rxRecordPos,
-               context->rxRecordLen - context->rxRecordPos, &n, 0);
+            error = tlsReceiveRecordData(context, data + context->rxRecordPos,
+               context->rxRecordLen - context->rxRecordPos, &n);
 
             //Check status code
             if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
@@ -557,6 +1414,10 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
             //Discard record header
             memmove(data, record->data, *length);
 
+            //Update statistics
+            TLS_CONTEXT_STATS_ADD(context, recordsIn, 1);
+            TLS_CONTEXT_STATS_ADD(context, bytesIn, context->rxRecordLen);
+
             //Prepare to receive the next TLS record
             context->rxRecordLen = 0;
             context->rxRecordPos = 0;
@@ -611,6 +1472,150 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
 }
 
 
+/**
+ * @brief Receive record data from the transport layer
+ *
+ * If a read-ahead buffer is configured, as many bytes as possible are
+ * fetched from the socket at once, and subsequent requests are served from
+ * the read-ahead buffer
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] data Buffer where to store the received data
+ * @param[in] size Maximum number of bytes to read
+ * @param[out] received Actual number of bytes that have been read
+ * @return Error code
+ **/
+
+error_t tlsReceiveRecordData(TlsContext *context, uint8_t *data,
+   size_t size, size_t *received)
+{
+   error_t error;
+   size_t n;
+
+   //Batched receive disabled?
+   if(context->rxAheadBuffer == NULL)
+   {
+      //Read data from the socket
+      return tlsSocketReceive(context, data, size, received);
+   }
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Empty read-ahead buffer?
+   if(context->rxAheadLen == 0)
+   {
+      //Total number of bytes that have been received
+      n = 0;
+
+      //Read as much data as the socket can deliver
+      error = tlsSocketReceive(context, context->rxAheadBuffer,
+         context->rxAheadSize, &n);
+
+      //Rewind to the beginning of the buffer
+      context->rxAheadPos = 0;
+      //Number of bytes available in the read-ahead buffer
+      context->rxAheadLen = n;
+   }
+
+   //Limit the number of bytes to copy at a time
+   n = MIN(size, context->rxAheadLen);
+
+   //Copy data from the read-ahead buffer
+   memcpy(data, context->rxAheadBuffer + context->rxAheadPos, n);
+
+   //Advance data pointer
+   context->rxAheadPos += n;
+   //Number of bytes still pending in the read-ahead buffer
+   context->rxAheadLen -= n;
+
+   //Actual number of bytes that have been read
+   *received = n;
+
+   //Data are returned to the caller even if the read operation has failed
+   if(n > 0 && (error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT))
+      error = NO_ERROR;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Receive data from the transport layer
+ *
+ * With a completion-based transport, a receive request pointing to the
+ * buffer is posted and ERROR_WOULD_BLOCK is returned until the application
+ * reports its completion with tlsCompleteReceive. The transport fills the
+ * buffer in place, and the next call with the same buffer returns the
+ * outcome of the request
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] data Buffer where to store the received data
+ * @param[in] size Maximum number of bytes to read
+ * @param[out] received Actual number of bytes that have been read
+ * @return Error code
+ **/
+
+error_t tlsSocketReceive(TlsContext *context, uint8_t *data, size_t size,
+   size_t *received)
+{
+   error_t error;
+
+#if (TLS_COMPLETION_IO_SUPPORT == ENABLED)
+   //Completion-based transport?
+   if(context->socketSubmitReceiveCallback != NULL)
+   {
+      //Nothing has been received yet
+      *received = 0;
+
+      //Any request in progress?
+      if(!context->rxIoRequest.posted)
+      {
+         //Ask the transport to fill the buffer
+         error = context->socketSubmitReceiveCallback(context->socketHandle,
+            data, size, 0);
+
+         //Check status code
+         if(!error)
+         {
+            //The request is now in progress
+            context->rxIoRequest.posted = TRUE;
+            context->rxIoRequest.completed = FALSE;
+            context->rxIoRequest.length = size;
+
+            //Wait for the completion
+            error = ERROR_WOULD_BLOCK;
+         }
+      }
+      else if(!context->rxIoRequest.completed)
+      {
+         //The request is still in progress
+         error = ERROR_WOULD_BLOCK;
+      }
+      else
+      {
+         //Report the outcome of the request
+         *received = MIN(context->rxIoRequest.count, size);
+         error = context->rxIoRequest.status;
+
+         //A new request can be posted
+         context->rxIoRequest.posted = FALSE;
+      }
+   }
+   else
+#endif
+   {
+      //Read data from the socket
+      error = context->socketReceiveCallback(context->socketHandle, data,
+         size, received, 0);
+   }
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Process incoming TLS record
  * @param[in] context Pointer to the TLS context
@@ -651,7 +1656,7 @@ error_t tlsProcessRecord(TlsContext *context, TlsRecord *record)
          decryptionEngine->hashAlgo != NULL)
       {
          //Decrypt TLS record
-         error = tlsDecryptRecord(context, decryptionEngine, record);
+         error = decryptionEngine->decryptRecord(context, decryptionEngine, record);
          //Any error to report?
          if(error)
             return error;
@@ -674,7 +1679,7 @@ error_t tlsProcessRecord(TlsContext *context, TlsRecord *record)
             decryptionEngine->hashAlgo != NULL)
          {
             //Decrypt TLS record
-            error = tlsDecryptRecord(context, decryptionEngine, record);
+            error = decryptionEngine->decryptRecord(context, decryptionEngine, record);
             //Any error to report?
             if(error)
                return error;
@@ -909,14 +1914,25 @@ void tlsFormatAad(TlsContext *context, TlsEncryptionEngine *encryptionEngine,
       //Point to the DTLS record
       dtlsRecord = (DtlsRecord *) record;
 
-      //Additional data to be authenticated
-      memcpy(aad, (void *) &dtlsRecord->epoch, 2);
-      memcpy(aad + 2, &dtlsRecord->seqNum, 6);
-      memcpy(aad + 8, &dtlsRecord->type, 3);
-      memcpy(aad + 11, (void *) &dtlsRecord->length, 2);
+#if (DTLS_CID_SUPPORT == ENABLED)
+      //Record carrying a connection ID?
+      if(encryptionEngine->cidLen > 0)
+      {
+         //The CID is authenticated along with the record header
+         *aadLen = tlsFormatCidAad(encryptionEngine, record, aad);
+      }
+      else
+#endif
+      {
+         //Additional data to be authenticated
+         memcpy(aad, (void *) &dtlsRecord->epoch, 2);
+         memcpy(aad + 2, &dtlsRecord->seqNum, 6);
+         memcpy(aad + 8, &dtlsRecord->type, 3);
+         memcpy(aad + 11, (void *) &dtlsRecord->length, 2);
 
-      //Length of the additional data, in bytes
-      *aadLen = 13;
+         //Length of the additional data, in bytes
+         *aadLen = 13;
+      }
    }
    else
 #endif
@@ -945,6 +1961,56 @@ void tlsFormatAad(TlsContext *context, TlsEncryptionEngine *encryptionEngine,
 }
 
 
+/**
+ * @brief Format the additional data of a record that carries a CID
+ *
+ * The same header is authenticated by AEAD ciphers and digested in front
+ * of the payload by MAC-based cipher suites (refer to RFC 9146, section 5)
+ *
+ * @param[in] encryptionEngine Pointer to the encryption engine
+ * @param[in] record Pointer to the DTLS record
+ * @param[out] aad Pointer to the buffer where to store the resulting AAD
+ * @return Length of the additional data, in bytes
+ **/
+
+size_t tlsFormatCidAad(TlsEncryptionEngine *encryptionEngine,
+   const void *record, uint8_t *aad)
+{
+   size_t n = 0;
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   const DtlsRecord *dtlsRecord;
+
+   //Point to the DTLS record
+   dtlsRecord = (DtlsRecord *) record;
+
+   //The sequence number placeholder is 8 bytes of 0xFF
+   memset(aad, 0xFF, 8);
+
+   //The content type and the length of the CID are authenticated
+   aad[8] = TLS_TYPE_TLS12_CID;
+   aad[9] = (uint8_t) encryptionEngine->cidLen;
+   aad[10] = TLS_TYPE_TLS12_CID;
+
+   //Version, epoch and sequence number
+   memcpy(aad + 11, (void *) &dtlsRecord->version, 2);
+   memcpy(aad + 13, (void *) &dtlsRecord->epoch, 2);
+   memcpy(aad + 15, &dtlsRecord->seqNum, 6);
+
+   //Connection ID
+   memcpy(aad + 21, encryptionEngine->cid, encryptionEngine->cidLen);
+   n = 21 + encryptionEngine->cidLen;
+
+   //Length of the DTLSInnerPlaintext
+   memcpy(aad + n, (void *) &dtlsRecord->length, 2);
+   n += 2;
+#endif
+
+   //Return the length of the additional data
+   return n;
+}
+
+
 /**
  * @brief Format nonce
  * @param[in] context Pointer to the TLS context
@@ -1017,6 +2083,41 @@ void tlsFormatNonce(TlsContext *context, TlsEncryptionEngine *encryptionEngine,
 }
 
 
+/**
+ * @brief Format the 64-bit sequence number of a record
+ * @param[in] context Pointer to the TLS context
+ * @param[in] encryptionEngine Pointer to the encryption engine
+ * @param[in] record Pointer to the TLS record
+ * @param[out] seqNum Buffer where to store the 8-byte, big-endian value
+ **/
+
+void tlsFormatRecordSeqNum(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, const void *record, uint8_t *seqNum)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      const DtlsRecord *dtlsRecord;
+
+      //Point to the DTLS record
+      dtlsRecord = (DtlsRecord *) record;
+
+      //The 64-bit value is formed by concatenating the epoch and the
+      //sequence number
+      memcpy(seqNum, (void *) &dtlsRecord->epoch, 2);
+      memcpy(seqNum + 2, &dtlsRecord->seqNum, 6);
+   }
+   else
+#endif
+   //TLS protocol?
+   {
+      //Implicit sequence number
+      memcpy(seqNum, &encryptionEngine->seqNum, 8);
+   }
+}
+
+
 /**
  * @brief Increment sequence number
  * @param[in,out] seqNum Sequence number to increment
@@ -34,6 +34,13 @@
 //Dependencies
 #include "tls.h"
 
+//Maximum size of the additional authenticated data
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   #define TLS_MAX_AAD_SIZE (23 + DTLS_MAX_CID_SIZE)
+#else
+   #define TLS_MAX_AAD_SIZE 13
+#endif
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
@@ -43,6 +50,28 @@ extern "C" {
 error_t tlsWriteProtocolData(TlsContext *context,
    const uint8_t *data, size_t length, TlsContentType contentType);
 
+size_t tlsGetTxFragmentLimit(TlsContext *context);
+size_t tlsGetAppDataFragmentLimit(TlsContext *context);
+void tlsUpdateDynamicRecordSizing(TlsContext *context, size_t length);
+
+error_t tlsWriteGatheredData(TlsContext *context, const TlsIoVec *iov,
+   uint_t iovCount, size_t *written, uint_t flags);
+
+error_t tlsFlushCorkedData(TlsContext *context);
+
+error_t tlsWriteBulkData(TlsContext *context, const uint8_t *data,
+   size_t length, size_t *written);
+
+error_t tlsSendBulkData(TlsContext *context);
+
+error_t tlsSocketSend(TlsContext *context, const void *data, size_t length,
+   size_t *written);
+
+error_t tlsReserveTxPayload(TlsContext *context, uint8_t **payload,
+   size_t *size);
+
+error_t tlsWriteReservedRecord(TlsContext *context, size_t length);
+
 error_t tlsReadProtocolData(TlsContext *context,
    uint8_t **data, size_t *length, TlsContentType *contentType);
 
@@ -52,6 +81,12 @@ error_t tlsWriteRecord(TlsContext *context, const uint8_t *data,
 error_t tlsReadRecord(TlsContext *context, uint8_t *data,
    size_t size, size_t *length, TlsContentType *contentType);
 
+error_t tlsReceiveRecordData(TlsContext *context, uint8_t *data,
+   size_t size, size_t *received);
+
+error_t tlsSocketReceive(TlsContext *context, uint8_t *data, size_t size,
+   size_t *received);
+
 error_t tlsProcessRecord(TlsContext *context, TlsRecord *record);
 
 void tlsSetRecordType(TlsContext *context, void *record, uint8_t type);
@@ -63,9 +98,15 @@ uint8_t *tlsGetRecordData(TlsContext *context, void *record);
 void tlsFormatAad(TlsContext *context, TlsEncryptionEngine *encryptionEngine,
    const void *record, uint8_t *aad, size_t *aadLen);
 
+size_t tlsFormatCidAad(TlsEncryptionEngine *encryptionEngine,
+   const void *record, uint8_t *aad);
+
 void tlsFormatNonce(TlsContext *context, TlsEncryptionEngine *encryptionEngine,
    const void *record, const uint8_t *recordIv, uint8_t *nonce, size_t *nonceLen);
 
+void tlsFormatRecordSeqNum(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, const void *record, uint8_t *seqNum);
+
 void tlsIncSequenceNumber(TlsSequenceNumber *seqNum);
 
 //C++ guard
@@ -78,8 +78,19 @@ error_t tlsDecryptRecord(TlsContext *context,
    //CBC block cipher?
    if(decryptionEngine->cipherMode == CIPHER_MODE_CBC)
    {
-      //Decrypt record and check message authentication code (constant time)
-      error = tlsDecryptCbcRecord(context, decryptionEngine, record);
+#if (TLS_CBC_FUSED_DECRYPTION_SUPPORT == ENABLED)
+      //TLS 1.0, TLS 1.1 or TLS 1.2 currently selected?
+      if(decryptionEngine->version >= TLS_VERSION_1_0)
+      {
+         //Decrypt record and feed the HMAC in the same pass (constant time)
+         error = tlsDecryptCbcHmacRecord(context, decryptionEngine, record);
+      }
+      else
+#endif
+      {
+         //Decrypt record and check message authentication code (constant time)
+         error = tlsDecryptCbcRecord(context, decryptionEngine, record);
+      }
    }
    else
 #endif
@@ -139,7 +150,7 @@ error_t tlsDecryptAeadRecord(TlsContext *context,
    uint8_t *tag;
    size_t aadLen;
    size_t nonceLen;
-   uint8_t aad[13];
+   uint8_t aad[TLS_MAX_AAD_SIZE];
    uint8_t nonce[12];
 
    //Get the length of the TLS record
@@ -282,6 +293,192 @@ error_t tlsDecryptAeadRecord(TlsContext *context,
 }
 
 
+/**
+ * @brief Record decryption (TLS 1.2 AES-GCM with explicit nonce)
+ *
+ * Specialized version of tlsDecryptAeadRecord for TLS stream transport, with
+ * the construction of the additional data and the nonce performed inline
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] decryptionEngine Pointer to the decryption engine
+ * @param[in,out] record TLS record to be decrypted
+ * @return Error code
+ **/
+
+error_t tlsDecryptGcmRecord(TlsContext *context,
+   TlsEncryptionEngine *decryptionEngine, void *record)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   error_t error;
+   size_t length;
+   uint8_t *data;
+   uint8_t aad[13];
+   uint8_t nonce[12];
+   TlsRecord *tlsRecord;
+
+   //Point to the TLS record
+   tlsRecord = (TlsRecord *) record;
+   //Get the length of the TLS record
+   length = ntohs(tlsRecord->length);
+   //Point to the payload
+   data = tlsRecord->data;
+
+   //Debug message
+   TRACE_DEBUG("Record to be decrypted (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //Make sure the message length is acceptable
+   if(length < (8 + decryptionEngine->authTagLen))
+      return ERROR_BAD_RECORD_MAC;
+
+   //Calculate the length of the ciphertext
+   length -= 8 + decryptionEngine->authTagLen;
+   //Fix the length field of the TLS record
+   tlsRecord->length = htons(length);
+
+   //The additional data consist of the sequence number and the record header
+   memcpy(aad, &decryptionEngine->seqNum, 8);
+   memcpy(aad + 8, tlsRecord, 5);
+
+   //The nonce is the concatenation of the salt and the explicit part
+   memcpy(nonce, decryptionEngine->iv, 4);
+   memcpy(nonce + 4, data, 8);
+
+   //Authenticated decryption using GCM
+   error = gcmDecrypt(decryptionEngine->gcmContext, nonce, 12, aad, 13,
+      data + 8, data + 8, length, data + 8 + length,
+      decryptionEngine->authTagLen);
+   //Wrong authentication tag?
+   if(error)
+      return ERROR_BAD_RECORD_MAC;
+
+   //Discard the explicit part of the nonce
+   memmove(data, data + 8, length);
+
+   //Increment sequence number
+   tlsIncSequenceNumber(&decryptionEngine->seqNum);
+
+   //Debug message
+   TRACE_DEBUG("Decrypted record (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //GCM cipher mode is not supported
+   return ERROR_UNSUPPORTED_CIPHER_MODE;
+#endif
+}
+
+
+/**
+ * @brief Record decryption (TLS 1.3 AES-GCM)
+ *
+ * Specialized version of tlsDecryptAeadRecord for TLS stream transport, with
+ * the construction of the additional data and the nonce performed inline
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] decryptionEngine Pointer to the decryption engine
+ * @param[in,out] record TLS record to be decrypted
+ * @return Error code
+ **/
+
+error_t tls13DecryptGcmRecord(TlsContext *context,
+   TlsEncryptionEngine *decryptionEngine, void *record)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
+   TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   error_t error;
+   size_t i;
+   size_t length;
+   uint8_t *data;
+   uint8_t nonce[12];
+   TlsRecord *tlsRecord;
+
+   //Point to the TLS record
+   tlsRecord = (TlsRecord *) record;
+   //Get the length of the TLS record
+   length = ntohs(tlsRecord->length);
+   //Point to the payload
+   data = tlsRecord->data;
+
+   //Debug message
+   TRACE_DEBUG("Record to be decrypted (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //Make sure the message length is acceptable
+   if(length < decryptionEngine->authTagLen)
+      return ERROR_BAD_RECORD_MAC;
+
+   //Calculate the length of the ciphertext
+   length -= decryptionEngine->authTagLen;
+
+   //The length must not exceed 2^14 octets + 1 octet for ContentType + the
+   //maximum AEAD expansion
+   if(length > (TLS_MAX_RECORD_LENGTH + 1))
+      return ERROR_RECORD_OVERFLOW;
+
+   //The outer opaque_type field of a TLS record is always set to the value
+   //23 (application data)
+   if(tlsRecord->type != TLS_TYPE_APPLICATION_DATA)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //The padded sequence number is XORed with the read IV to form the nonce
+   //(refer to RFC 8446, section 5.3)
+   memcpy(nonce, decryptionEngine->iv, 12);
+
+   for(i = 0; i < 8; i++)
+   {
+      nonce[4 + i] ^= decryptionEngine->seqNum.b[i];
+   }
+
+   //Authenticated decryption using GCM (the additional data input is the
+   //record header)
+   error = gcmDecrypt(decryptionEngine->gcmContext, nonce, 12,
+      (uint8_t *) tlsRecord, sizeof(TlsRecord), data, data, length,
+      data + length, decryptionEngine->authTagLen);
+   //Wrong authentication tag?
+   if(error)
+      return ERROR_BAD_RECORD_MAC;
+
+   //Scan the field from the end toward the beginning until a non-zero octet
+   //is found
+   while(length > 0 && data[length - 1] == 0)
+   {
+      length--;
+   }
+
+   //If a receiving implementation does not find a non-zero octet in the
+   //cleartext, it must terminate the connection with an unexpected_message
+   //alert
+   if(length == 0)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Retrieve the length of the plaintext
+   length--;
+
+   //The actual content type of the record is found in the type field
+   tlsRecord->type = data[length];
+   //Fix the length field of the TLS record
+   tlsRecord->length = htons(length);
+
+   //Increment sequence number
+   tlsIncSequenceNumber(&decryptionEngine->seqNum);
+
+   //Debug message
+   TRACE_DEBUG("Decrypted record (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //GCM cipher mode is not supported
+   return ERROR_UNSUPPORTED_CIPHER_MODE;
+#endif
+}
+
+
 /**
  * @brief Record decryption (CBC block cipher)
  * @param[in] context Pointer to the TLS context
@@ -427,6 +624,191 @@ error_t tlsDecryptCbcRecord(TlsContext *context,
 }
 
 
+/**
+ * @brief Record decryption (CBC block cipher with fused MAC verification)
+ *
+ * The payload is decrypted chunk by chunk and the part of each chunk that
+ * cannot be affected by the (secret) padding length is fed to the HMAC while
+ * it is still hot in the cache. Only the last 255 bytes are left to the
+ * constant-time MAC verification
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] decryptionEngine Pointer to the decryption engine
+ * @param[in,out] record TLS record to be decrypted
+ * @return Error code
+ **/
+
+error_t tlsDecryptCbcHmacRecord(TlsContext *context,
+   TlsEncryptionEngine *decryptionEngine, void *record)
+{
+#if (TLS_CBC_CIPHER_SUPPORT == ENABLED && TLS_CBC_FUSED_DECRYPTION_SUPPORT == ENABLED)
+   error_t error;
+   uint32_t bad;
+   size_t i;
+   size_t k;
+   size_t m;
+   size_t n;
+   size_t length;
+   size_t ivLen;
+   size_t headerLen;
+   size_t prefixLen;
+   size_t paddingLen;
+   uint8_t *data;
+   const uint8_t *iv;
+   const CipherAlgo *cipherAlgo;
+   const HashAlgo *hashAlgo;
+   uint8_t block[16];
+   uint8_t mac[MAX_HASH_DIGEST_SIZE];
+
+   //Point to the cipher algorithm
+   cipherAlgo = decryptionEngine->cipherAlgo;
+   //Point to the hash algorithm
+   hashAlgo = decryptionEngine->hashAlgo;
+
+   //Get the length of the ciphertext
+   length = tlsGetRecordLength(context, record);
+   //Point to the payload
+   data = tlsGetRecordData(context, record);
+
+   //Debug message
+   TRACE_DEBUG("Record to be decrypted (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //TLS 1.1 and 1.2 use an explicit IV
+   if(decryptionEngine->version >= TLS_VERSION_1_1)
+      ivLen = decryptionEngine->recordIvLen;
+   else
+      ivLen = 0;
+
+   //Calculate the minimum acceptable length of the ciphertext
+   n = MAX(cipherAlgo->blockSize, hashAlgo->digestSize + 1) + ivLen;
+
+   //Malformed TLS record?
+   if(length < n)
+      return ERROR_BAD_RECORD_MAC;
+
+   //The length of the ciphertext must be a multiple of the block size
+   if((length % cipherAlgo->blockSize) != 0)
+      return ERROR_BAD_RECORD_MAC;
+
+   //Sanity check
+   if(cipherAlgo->blockSize > sizeof(block))
+      return ERROR_UNSUPPORTED_CIPHER_MODE;
+
+   //The explicit IV is the chaining value of the first cipher block
+   if(ivLen > 0)
+      memcpy(decryptionEngine->iv, data, ivLen);
+
+   //Length of the payload, without the explicit IV
+   length -= ivLen;
+
+   //Point to the cipher block that precedes the last one
+   if(length > cipherAlgo->blockSize)
+      iv = data + ivLen + length - 2 * cipherAlgo->blockSize;
+   else
+      iv = decryptionEngine->iv;
+
+   //Decrypt the last cipher block first in order to retrieve the length of
+   //the padding string before the bulk data is fed to the HMAC
+   cipherAlgo->decryptBlock(decryptionEngine->cipherContext,
+      data + ivLen + length - cipherAlgo->blockSize, block);
+
+   //The last byte of the plaintext holds the length of the padding string
+   paddingLen = block[cipherAlgo->blockSize - 1] ^
+      iv[cipherAlgo->blockSize - 1];
+
+   //Discard the padding length if it is not consistent with the length of
+   //the record (the padding string is checked thoroughly afterwards)
+   bad = CRYPTO_TEST_LT_32(length, paddingLen + hashAlgo->digestSize + 1);
+   paddingLen = CRYPTO_SELECT_32(paddingLen, 0, bad);
+
+   //Tentative length of the plaintext data
+   n = length - hashAlgo->digestSize - paddingLen - 1;
+   //Maximum possible length of the plaintext data
+   m = length - hashAlgo->digestSize - 1;
+
+   //The length field of the record is part of the MAC computation
+   tlsSetRecordLength(context, record, n);
+   //Compute MAC over the sequence number and the record header
+   tlsInitVerifyMac(context, decryptionEngine, record, &headerLen);
+
+   //The first bytes of the plaintext data cannot be affected by the (secret)
+   //padding length
+   prefixLen = (m > 255) ? (m - 255) : 0;
+
+   //Decrypt the payload chunk by chunk
+   for(i = 0; i < length; i += k)
+   {
+      //Number of bytes to decrypt in this pass
+      k = MIN(length - i, TLS_CBC_DECRYPTION_CHUNK_SIZE);
+
+      //Perform CBC decryption
+      error = cbcDecrypt(cipherAlgo, decryptionEngine->cipherContext,
+         decryptionEngine->iv, data + ivLen + i, data + ivLen + i, k);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Discard the explicit IV
+      if(ivLen > 0)
+      {
+         memmove(data + i, data + ivLen + i, k);
+      }
+
+      //Digest the plaintext while it is still hot in the cache
+      if(i < prefixLen)
+      {
+         hmacUpdate(decryptionEngine->hmacContext, data + i,
+            MIN(k, prefixLen - i));
+      }
+   }
+
+   //Debug message
+   TRACE_DEBUG("Record with padding (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //The receiver must check the padding
+   bad = tlsVerifyPadding(data, length, &paddingLen);
+
+   //Actual length of the payload
+   n = length - paddingLen - 1;
+   //Maximum possible length of the payload
+   m = length - 1;
+
+   //Extract the MAC from the TLS record
+   bad |= tlsExtractMac(decryptionEngine, data, n, m, mac);
+
+   //Fix the length of the padding string if the format of the plaintext
+   //is not valid
+   paddingLen = CRYPTO_SELECT_32(paddingLen, 0, bad);
+
+   //Actual length of the plaintext data
+   n = length - hashAlgo->digestSize - paddingLen - 1;
+   //Maximum possible length of the plaintext data
+   m = length - hashAlgo->digestSize - 1;
+
+   //Fix the length field of the TLS record
+   tlsSetRecordLength(context, record, n);
+
+   //Process the last bytes of the plaintext data in constant time
+   bad |= tlsFinalizeVerifyMac(decryptionEngine, headerLen, data, prefixLen,
+      n, m, mac);
+
+   //Increment sequence number
+   tlsIncSequenceNumber(&decryptionEngine->seqNum);
+
+   //Return status code
+   if(bad)
+      return ERROR_BAD_RECORD_MAC;
+   else
+      return NO_ERROR;
+#else
+   //CBC cipher mode is not supported
+   return ERROR_UNSUPPORTED_CIPHER_MODE;
+#endif
+}
+
+
 /**
  * @brief Record decryption (stream cipher)
  * @param[in] context Pointer to the TLS context
@@ -628,11 +1010,134 @@ uint32_t tlsVerifyPadding(const uint8_t *data, size_t dataLen,
 uint32_t tlsVerifyMac(TlsContext *context,
    TlsEncryptionEngine *decryptionEngine, const void *record,
    const uint8_t *data, size_t dataLen, size_t maxDataLen, const uint8_t *mac)
+{
+   size_t headerLen;
+
+   //Compute MAC over the sequence number and the record header
+   tlsInitVerifyMac(context, decryptionEngine, record, &headerLen);
+
+   //Compute MAC over the plaintext data
+   return tlsFinalizeVerifyMac(decryptionEngine, headerLen, data, 0, dataLen,
+      maxDataLen, mac);
+}
+
+
+/**
+ * @brief Start MAC verification
+ *
+ * The HMAC context is initialized from the precomputed keyed context and the
+ * data that precedes the plaintext (sequence number and record header) is
+ * digested
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] decryptionEngine Pointer to the decryption engine
+ * @param[in] record Pointer to the TLS record
+ * @param[out] headerLen Length of the additional data hashed in prior to the
+ *   plaintext data, including the HMAC inner key block
+ **/
+
+void tlsInitVerifyMac(TlsContext *context,
+   TlsEncryptionEngine *decryptionEngine, const void *record,
+   size_t *headerLen)
+{
+   const HashAlgo *hashAlgo;
+   HmacContext *hmacContext;
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   size_t cidHeaderLen;
+   uint8_t cidHeader[TLS_MAX_AAD_SIZE];
+#endif
+
+   //Point to the hash algorithm to be used
+   hashAlgo = decryptionEngine->hashAlgo;
+   //Point to the HMAC context
+   hmacContext = decryptionEngine->hmacContext;
+
+   //Calculate the length of the additional data that will be hashed in
+   //prior to the application data
+   *headerLen = hashAlgo->blockSize + sizeof(TlsSequenceNumber) +
+      sizeof(TlsRecord);
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   //Records carrying a connection ID have a longer header
+   if(decryptionEngine->cidLen > 0)
+   {
+      cidHeaderLen = tlsFormatCidAad(decryptionEngine, record, cidHeader);
+      *headerLen = hashAlgo->blockSize + cidHeaderLen;
+   }
+#endif
+
+   //Initialize HMAC calculation from the precomputed keyed context
+   memcpy(hmacContext, decryptionEngine->hmacKeyContext, sizeof(HmacContext));
+
+#if (DTLS_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      const DtlsRecord *dtlsRecord;
+
+      //Point to the DTLS record
+      dtlsRecord = (DtlsRecord *) record;
+
+#if (DTLS_CID_SUPPORT == ENABLED)
+      //Record carrying a connection ID?
+      if(decryptionEngine->cidLen > 0)
+      {
+         //The CID is authenticated along with the record header
+         hmacUpdate(hmacContext, cidHeader, cidHeaderLen);
+      }
+      else
+#endif
+      {
+         //Compute the MAC over the 64-bit value formed by concatenating the
+         //epoch and the sequence number in the order they appear on the wire
+         hmacUpdate(hmacContext, (void *) &dtlsRecord->epoch, 2);
+         hmacUpdate(hmacContext, &dtlsRecord->seqNum, 6);
+
+         //Compute MAC over the record contents
+         hmacUpdate(hmacContext, &dtlsRecord->type, 3);
+         hmacUpdate(hmacContext, (void *) &dtlsRecord->length, 2);
+      }
+   }
+   else
+#endif
+   //TLS protocol?
+   {
+      const TlsRecord *tlsRecord;
+
+      //Point to the TLS record
+      tlsRecord = (TlsRecord *) record;
+
+      //Compute MAC over the implicit sequence number
+      hmacUpdate(hmacContext, &decryptionEngine->seqNum,
+         sizeof(TlsSequenceNumber));
+
+      //Compute MAC over the record contents
+      hmacUpdate(hmacContext, tlsRecord, sizeof(TlsRecord));
+   }
+}
+
+
+/**
+ * @brief Complete MAC verification (constant time)
+ * @param[in] decryptionEngine Pointer to the decryption engine
+ * @param[in] headerLen Length of the additional data hashed in prior to the
+ *   plaintext data, including the HMAC inner key block
+ * @param[in] data Pointer to the record payload
+ * @param[in] offset Number of bytes of plaintext data that have already been
+ *   digested (must not exceed maxDataLen - 255)
+ * @param[in] dataLen Actual length of the plaintext data (secret information)
+ * @param[in] maxDataLen Maximum possible length of the plaintext data
+ * @param[in] mac Message authentication code
+ * @return The function returns 0 if the MAC verification is successful, else 1
+ **/
+
+uint32_t tlsFinalizeVerifyMac(TlsEncryptionEngine *decryptionEngine,
+   size_t headerLen, const uint8_t *data, size_t offset, size_t dataLen,
+   size_t maxDataLen, const uint8_t *mac)
 {
    size_t i;
    size_t j;
    size_t n;
-   size_t headerLen;
    size_t paddingLen;
    size_t blockSizeMask;
    uint8_t b;
@@ -650,11 +1155,6 @@ uint32_t tlsVerifyMac(TlsContext *context,
    //The size of the block depends on the hash algorithm
    blockSizeMask = hashAlgo->blockSize - 1;
 
-   //Calculate the length of the additional data that will be hashed in
-   //prior to the application data
-   headerLen = hashAlgo->blockSize + sizeof(TlsSequenceNumber) +
-      sizeof(TlsRecord);
-
    //Calculate the length of the padding string
    paddingLen = (headerLen + dataLen + hashAlgo->minPadSize - 1) & blockSizeMask;
    paddingLen = hashAlgo->blockSize - paddingLen;
@@ -681,55 +1181,16 @@ uint32_t tlsVerifyMac(TlsContext *context,
    n = (n + hashAlgo->blockSize - 1) & ~blockSizeMask;
    n -= headerLen;
 
-   //Initialize HMAC calculation
-   hmacInit(hmacContext, hashAlgo, decryptionEngine->macKey,
-      decryptionEngine->macKeyLen);
-
-#if (DTLS_SUPPORT == ENABLED)
-   //DTLS protocol?
-   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
-   {
-      const DtlsRecord *dtlsRecord;
-
-      //Point to the DTLS record
-      dtlsRecord = (DtlsRecord *) record;
-
-      //Compute the MAC over the 64-bit value formed by concatenating the
-      //epoch and the sequence number in the order they appear on the wire
-      hmacUpdate(hmacContext, (void *) &dtlsRecord->epoch, 2);
-      hmacUpdate(hmacContext, &dtlsRecord->seqNum, 6);
-
-      //Compute MAC over the record contents
-      hmacUpdate(hmacContext, &dtlsRecord->type, 3);
-      hmacUpdate(hmacContext, (void *) &dtlsRecord->length, 2);
-   }
-   else
-#endif
-   //TLS protocol?
-   {
-      const TlsRecord *tlsRecord;
-
-      //Point to the TLS record
-      tlsRecord = (TlsRecord *) record;
-
-      //Compute MAC over the implicit sequence number
-      hmacUpdate(hmacContext, &decryptionEngine->seqNum,
-         sizeof(TlsSequenceNumber));
-
-      //Compute MAC over the record contents
-      hmacUpdate(hmacContext, tlsRecord, sizeof(TlsRecord));
-   }
-
-   //Point to the first byte of the plaintext data
-   i = 0;
+   //Skip the plaintext data that has already been digested
+   i = offset;
 
    //We can process the first blocks normally because the (secret) padding
    //length cannot affect them
-   if(maxDataLen > 255)
+   if(maxDataLen > 255 && i < (maxDataLen - 255))
    {
       //Digest the first part of the plaintext data
-      hmacUpdate(hmacContext, data, maxDataLen - 255);
-      i += maxDataLen - 255;
+      hmacUpdate(hmacContext, data + i, maxDataLen - 255 - i);
+      i = maxDataLen - 255;
    }
 
    //The last blocks need to be handled carefully
@@ -46,9 +46,18 @@ error_t tlsDecryptRecord(TlsContext *context,
 error_t tlsDecryptAeadRecord(TlsContext *context,
    TlsEncryptionEngine *decryptionEngine, void *record);
 
+error_t tlsDecryptGcmRecord(TlsContext *context,
+   TlsEncryptionEngine *decryptionEngine, void *record);
+
+error_t tls13DecryptGcmRecord(TlsContext *context,
+   TlsEncryptionEngine *decryptionEngine, void *record);
+
 error_t tlsDecryptCbcRecord(TlsContext *context,
    TlsEncryptionEngine *decryptionEngine, void *record);
 
+error_t tlsDecryptCbcHmacRecord(TlsContext *context,
+   TlsEncryptionEngine *decryptionEngine, void *record);
+
 error_t tlsDecryptStreamRecord(TlsContext *context,
    TlsEncryptionEngine *decryptionEngine, void *record);
 
@@ -62,6 +71,14 @@ uint32_t tlsVerifyMac(TlsContext *context,
    TlsEncryptionEngine *decryptionEngine, const void *record,
    const uint8_t *data, size_t dataLen, size_t maxDataLen, const uint8_t *mac);
 
+void tlsInitVerifyMac(TlsContext *context,
+   TlsEncryptionEngine *decryptionEngine, const void *record,
+   size_t *headerLen);
+
+uint32_t tlsFinalizeVerifyMac(TlsEncryptionEngine *decryptionEngine,
+   size_t headerLen, const uint8_t *data, size_t offset, size_t dataLen,
+   size_t maxDataLen, const uint8_t *mac);
+
 uint32_t tlsExtractMac(TlsEncryptionEngine *decryptionEngine,
    const uint8_t *data, size_t dataLen, size_t maxDataLen, uint8_t *mac);
 
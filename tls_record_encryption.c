@@ -144,7 +144,7 @@ error_t tlsEncryptAeadRecord(TlsContext *context,
    size_t nonceLen;
    uint8_t *tag;
    uint8_t *data;
-   uint8_t aad[13];
+   uint8_t aad[TLS_MAX_AAD_SIZE];
    uint8_t nonce[12];
 
    //Get the length of the TLS record
@@ -178,16 +178,32 @@ error_t tlsEncryptAeadRecord(TlsContext *context,
    //Check the length of the nonce explicit part
    if(encryptionEngine->recordIvLen != 0)
    {
-      //Make room for the explicit nonce at the beginning of the record
-      memmove(data + encryptionEngine->recordIvLen, data, length);
+      //Make room for the explicit nonce at the beginning of the record,
+      //unless the application has directly written the payload at the
+      //right offset (refer to tlsGetWriteBuffer)
+      if(!context->txZeroCopy)
+      {
+         memmove(data + encryptionEngine->recordIvLen, data, length);
+      }
 
-      //The explicit part of the nonce is chosen by the sender and is
-      //carried in each TLS record
-      error = context->prngAlgo->read(context->prngContext, data,
-         encryptionEngine->recordIvLen);
-      //Any error to report?
-      if(error)
-         return error;
+#if (TLS_SEQUENCE_NUMBER_NONCE_SUPPORT == ENABLED)
+      //The sequence number is unique for a given key and can be used as the
+      //explicit part of the nonce (refer to RFC 5288, section 3)
+      if(encryptionEngine->recordIvLen == 8)
+      {
+         tlsFormatRecordSeqNum(context, encryptionEngine, record, data);
+      }
+      else
+#endif
+      {
+         //The explicit part of the nonce is chosen by the sender and is
+         //carried in each TLS record
+         error = context->prngAlgo->read(context->prngContext, data,
+            encryptionEngine->recordIvLen);
+         //Any error to report?
+         if(error)
+            return error;
+      }
    }
 
    //Generate the nonce
@@ -262,6 +278,178 @@ error_t tlsEncryptAeadRecord(TlsContext *context,
 }
 
 
+/**
+ * @brief Record encryption (TLS 1.2 AES-GCM with explicit nonce)
+ *
+ * Specialized version of tlsEncryptAeadRecord for TLS stream transport, with
+ * the construction of the additional data and the nonce performed inline
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] encryptionEngine Pointer to the encryption engine
+ * @param[in,out] record TLS record to be encrypted
+ * @return Error code
+ **/
+
+error_t tlsEncryptGcmRecord(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, void *record)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   error_t error;
+   size_t length;
+   uint8_t *data;
+   uint8_t aad[13];
+   uint8_t nonce[12];
+   TlsRecord *tlsRecord;
+
+   //Point to the TLS record
+   tlsRecord = (TlsRecord *) record;
+   //Get the length of the TLS record
+   length = ntohs(tlsRecord->length);
+   //Point to the payload
+   data = tlsRecord->data;
+
+   //Debug message
+   TRACE_DEBUG("Record to be encrypted (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //The additional data consist of the sequence number and the record header
+   memcpy(aad, &encryptionEngine->seqNum, 8);
+   memcpy(aad + 8, tlsRecord, 5);
+
+   //Make room for the explicit nonce, unless the application has directly
+   //written the payload at the right offset (refer to tlsGetWriteBuffer)
+   if(!context->txZeroCopy)
+   {
+      memmove(data + 8, data, length);
+   }
+
+#if (TLS_SEQUENCE_NUMBER_NONCE_SUPPORT == ENABLED)
+   //The sequence number is unique for a given key and can be used as the
+   //explicit part of the nonce (refer to RFC 5288, section 3)
+   memcpy(data, &encryptionEngine->seqNum, 8);
+#else
+   //The explicit part of the nonce is chosen by the sender and is carried
+   //in each TLS record
+   error = context->prngAlgo->read(context->prngContext, data, 8);
+   //Any error to report?
+   if(error)
+      return error;
+#endif
+
+   //The nonce is the concatenation of the salt and the explicit part
+   memcpy(nonce, encryptionEngine->iv, 4);
+   memcpy(nonce + 4, data, 8);
+
+   //Authenticated encryption using GCM
+   error = gcmEncrypt(encryptionEngine->gcmContext, nonce, 12, aad, 13,
+      data + 8, data + 8, length, data + 8 + length,
+      encryptionEngine->authTagLen);
+   //Failed to encrypt data?
+   if(error)
+      return error;
+
+   //Compute the length of the resulting message
+   length += 8 + encryptionEngine->authTagLen;
+   //Fix length field
+   tlsRecord->length = htons(length);
+
+   //Increment sequence number
+   tlsIncSequenceNumber(&encryptionEngine->seqNum);
+
+   //Debug message
+   TRACE_DEBUG("Encrypted record (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //GCM cipher mode is not supported
+   return ERROR_UNSUPPORTED_CIPHER_MODE;
+#endif
+}
+
+
+/**
+ * @brief Record encryption (TLS 1.3 AES-GCM)
+ *
+ * Specialized version of tlsEncryptAeadRecord for TLS stream transport, with
+ * the construction of the additional data and the nonce performed inline
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] encryptionEngine Pointer to the encryption engine
+ * @param[in,out] record TLS record to be encrypted
+ * @return Error code
+ **/
+
+error_t tls13EncryptGcmRecord(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, void *record)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3 && \
+   TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   error_t error;
+   size_t i;
+   size_t length;
+   uint8_t *data;
+   uint8_t nonce[12];
+   TlsRecord *tlsRecord;
+
+   //Point to the TLS record
+   tlsRecord = (TlsRecord *) record;
+   //Get the length of the TLS record
+   length = ntohs(tlsRecord->length);
+   //Point to the payload
+   data = tlsRecord->data;
+
+   //Debug message
+   TRACE_DEBUG("Record to be encrypted (%" PRIuSIZE " bytes):\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //The type field indicates the higher-level protocol used to process the
+   //enclosed fragment
+   data[length++] = tlsRecord->type;
+
+   //The outer opaque_type field is always set to the value 23 (application
+   //data), and the length field covers the authentication tag
+   tlsRecord->type = TLS_TYPE_APPLICATION_DATA;
+   tlsRecord->length = htons(length + encryptionEngine->authTagLen);
+
+   //The padded sequence number is XORed with the write IV to form the nonce
+   //(refer to RFC 8446, section 5.3)
+   memcpy(nonce, encryptionEngine->iv, 12);
+
+   for(i = 0; i < 8; i++)
+   {
+      nonce[4 + i] ^= encryptionEngine->seqNum.b[i];
+   }
+
+   //Authenticated encryption using GCM (the additional data input is the
+   //record header)
+   error = gcmEncrypt(encryptionEngine->gcmContext, nonce, 12,
+      (uint8_t *) tlsRecord, sizeof(TlsRecord), data, data, length,
+      data + length, encryptionEngine->authTagLen);
+   //Failed to encrypt data?
+   if(error)
+      return error;
+
+   //Increment sequence number
+   tlsIncSequenceNumber(&encryptionEngine->seqNum);
+
+   //Debug message
+   TRACE_DEBUG("Encrypted record (%" PRIuSIZE " bytes):\r\n",
+      length + encryptionEngine->authTagLen);
+   TRACE_DEBUG_ARRAY("  ", record, length + encryptionEngine->authTagLen +
+      sizeof(TlsRecord));
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //GCM cipher mode is not supported
+   return ERROR_UNSUPPORTED_CIPHER_MODE;
+#endif
+}
+
+
 /**
  * @brief Record encryption (CBC block cipher)
  * @param[in] context Pointer to the TLS context
@@ -280,6 +468,9 @@ error_t tlsEncryptCbcRecord(TlsContext *context,
    size_t paddingLen;
    uint8_t *data;
    const CipherAlgo *cipherAlgo;
+#if (TLS_SEQUENCE_NUMBER_NONCE_SUPPORT == ENABLED)
+   uint8_t block[16];
+#endif
 
    //Point to the cipher algorithm
    cipherAlgo = encryptionEngine->cipherAlgo;
@@ -300,12 +491,33 @@ error_t tlsEncryptCbcRecord(TlsContext *context,
       //Make room for the IV at the beginning of the data
       memmove(data + encryptionEngine->recordIvLen, data, length);
 
-      //The initialization vector should be chosen at random
-      error = context->prngAlgo->read(context->prngContext, data,
-         encryptionEngine->recordIvLen);
-      //Any error to report?
-      if(error)
-         return error;
+#if (TLS_SEQUENCE_NUMBER_NONCE_SUPPORT == ENABLED)
+      //The first plaintext block is the encryption of the sequence number
+      //under the record key. The value is unique and cannot be predicted
+      //without the key, and it is masked by the previous ciphertext block
+      //(refer to NIST SP 800-38A, appendix C)
+      if(encryptionEngine->recordIvLen == cipherAlgo->blockSize &&
+         cipherAlgo->blockSize <= sizeof(block) &&
+         cipherAlgo->blockSize >= 8)
+      {
+         //Pad the 64-bit sequence number with zeroes
+         memset(block, 0, cipherAlgo->blockSize);
+         tlsFormatRecordSeqNum(context, encryptionEngine, record, block);
+
+         //Encrypt the counter block
+         cipherAlgo->encryptBlock(encryptionEngine->cipherContext, block,
+            data);
+      }
+      else
+#endif
+      {
+         //The initialization vector should be chosen at random
+         error = context->prngAlgo->read(context->prngContext, data,
+            encryptionEngine->recordIvLen);
+         //Any error to report?
+         if(error)
+            return error;
+      }
 
       //Adjust the length of the message
       length += encryptionEngine->recordIvLen;
@@ -484,9 +696,8 @@ error_t tlsComputeMac(TlsContext *context, TlsEncryptionEngine *encryptionEngine
    //Point to the HMAC context
    hmacContext = encryptionEngine->hmacContext;
 
-   //Initialize HMAC calculation
-   hmacInit(hmacContext, encryptionEngine->hashAlgo,
-      encryptionEngine->macKey, encryptionEngine->macKeyLen);
+   //Initialize HMAC calculation from the precomputed keyed context
+   memcpy(hmacContext, encryptionEngine->hmacKeyContext, sizeof(HmacContext));
 
 #if (DTLS_SUPPORT == ENABLED)
    //DTLS protocol?
@@ -497,14 +708,31 @@ error_t tlsComputeMac(TlsContext *context, TlsEncryptionEngine *encryptionEngine
       //Point to the DTLS record
       dtlsRecord = (DtlsRecord *) record;
 
-      //Compute the MAC over the 64-bit value formed by concatenating the
-      //epoch and the sequence number in the order they appear on the wire
-      hmacUpdate(hmacContext, (void *) &dtlsRecord->epoch, 2);
-      hmacUpdate(hmacContext, &dtlsRecord->seqNum, 6);
+#if (DTLS_CID_SUPPORT == ENABLED)
+      //Record carrying a connection ID?
+      if(encryptionEngine->cidLen > 0)
+      {
+         size_t n;
+         uint8_t header[TLS_MAX_AAD_SIZE];
 
-      //Compute MAC over the record contents
-      hmacUpdate(hmacContext, &dtlsRecord->type, 3);
-      hmacUpdate(hmacContext, (void *) &dtlsRecord->length, 2);
+         //The CID is authenticated along with the record header
+         n = tlsFormatCidAad(encryptionEngine, record, header);
+         hmacUpdate(hmacContext, header, n);
+      }
+      else
+#endif
+      {
+         //Compute the MAC over the 64-bit value formed by concatenating the
+         //epoch and the sequence number in the order they appear on the wire
+         hmacUpdate(hmacContext, (void *) &dtlsRecord->epoch, 2);
+         hmacUpdate(hmacContext, &dtlsRecord->seqNum, 6);
+
+         //Compute MAC over the record contents
+         hmacUpdate(hmacContext, &dtlsRecord->type, 3);
+         hmacUpdate(hmacContext, (void *) &dtlsRecord->length, 2);
+      }
+
+      //Compute MAC over the payload
       hmacUpdate(hmacContext, data, dataLen);
    }
    else
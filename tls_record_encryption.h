@@ -46,6 +46,12 @@ error_t tlsEncryptRecord(TlsContext *context,
 error_t tlsEncryptAeadRecord(TlsContext *context,
    TlsEncryptionEngine *encryptionEngine, void *record);
 
+error_t tlsEncryptGcmRecord(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, void *record);
+
+error_t tls13EncryptGcmRecord(TlsContext *context,
+   TlsEncryptionEngine *encryptionEngine, void *record);
+
 error_t tlsEncryptCbcRecord(TlsContext *context,
    TlsEncryptionEngine *encryptionEngine, void *record);
 
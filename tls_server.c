@@ -40,6 +40,7 @@
 //Dependencies
 #include <string.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_cipher_suites.h"
 #include "tls_handshake.h"
 #include "tls_server.h"
@@ -51,9 +52,12 @@
 #include "tls_key_material.h"
 #include "tls_transcript_hash.h"
 #include "tls_cache.h"
+#include "tls_trust_store.h"
+#include "tls_cert_store.h"
 #include "tls_ffdhe.h"
 #include "tls_record.h"
 #include "tls_misc.h"
+#include "tls_ocsp.h"
 #include "tls13_server.h"
 #include "tls13_server_extensions.h"
 #include "tls13_server_misc.h"
@@ -128,9 +132,21 @@ error_t tlsSendServerHello(TlsContext *context)
             //Key material successfully generated?
             if(!error)
             {
-               //At this point, both client and server must send ChangeCipherSpec
-               //messages and proceed directly to Finished messages
-               context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+               //The server may renew the ticket before its ChangeCipherSpec
+               //message (refer to RFC 5077, section 3.1)
+               if(context->sessionTicketNegotiated)
+               {
+                  context->state = TLS_STATE_NEW_SESSION_TICKET;
+               }
+               else
+#endif
+               {
+                  //At this point, both client and server must send
+                  //ChangeCipherSpec messages and proceed directly to
+                  //Finished messages
+                  context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
+               }
             }
          }
          else
@@ -236,6 +252,12 @@ error_t tlsSendServerKeyExchange(TlsContext *context)
       }
    }
 
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   //The handshake remains in the current state until the signature is posted
+   if(context->asyncSignState == TLS_ASYNC_SIGN_STATE_PENDING)
+      return ERROR_WOULD_BLOCK;
+#endif
+
    //Check status code
    if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
    {
@@ -375,6 +397,110 @@ error_t tlsSendServerHelloDone(TlsContext *context)
 }
 
 
+/**
+ * @brief Send NewSessionTicket message
+ *
+ * The server sends a NewSessionTicket message during the handshake, before
+ * its ChangeCipherSpec message, to issue a self-encrypted session ticket
+ * to the client (refer to RFC 5077, section 3.3)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsSendNewSessionTicket(TlsContext *context)
+{
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   error_t error;
+   size_t length;
+   TlsNewSessionTicket *message;
+
+   //Point to the buffer where to format the message
+   message = (TlsNewSessionTicket *) (context->txBuffer + context->txBufferLen);
+
+   //Format NewSessionTicket message
+   error = tlsFormatNewSessionTicket(context, message, &length);
+
+   //Check status code
+   if(!error)
+   {
+      //Debug message
+      TRACE_INFO("Sending NewSessionTicket message (%" PRIuSIZE " bytes)...\r\n", length);
+      TRACE_DEBUG_ARRAY("  ", message, length);
+
+      //Send handshake message
+      error = tlsSendHandshakeMessage(context, message, length,
+         TLS_TYPE_NEW_SESSION_TICKET);
+   }
+
+   //Check status code
+   if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+   {
+      //The server then sends its ChangeCipherSpec message
+      context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
+   }
+
+   //Return status code
+   return error;
+#else
+   //Session ticket mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Send CertificateStatus message
+ *
+ * The server sends a CertificateStatus message immediately after its
+ * Certificate message to staple the OCSP response of its certificate
+ * (refer to RFC 6066, section 8)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsSendCertificateStatus(TlsContext *context)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   error_t error;
+   size_t length;
+   TlsCertificateStatus *message;
+
+   //Point to the buffer where to format the message
+   message = (TlsCertificateStatus *) (context->txBuffer + context->txBufferLen);
+
+   //Format CertificateStatus message
+   error = tlsFormatCertStatus(context, message, &length);
+
+   //Check status code
+   if(!error)
+   {
+      //Debug message
+      TRACE_INFO("Sending CertificateStatus message (%" PRIuSIZE " bytes)...\r\n", length);
+      TRACE_DEBUG_ARRAY("  ", message, length);
+
+      //Send handshake message
+      error = tlsSendHandshakeMessage(context, message, length,
+         TLS_TYPE_CERTIFICATE_STATUS);
+   }
+
+   //Check status code
+   if(error == NO_ERROR || error == ERROR_WOULD_BLOCK || error == ERROR_TIMEOUT)
+   {
+      //The server then sends its ServerKeyExchange message
+      context->state = TLS_STATE_SERVER_KEY_EXCHANGE;
+   }
+
+   //Return status code
+   return error;
+#else
+   //OCSP stapling is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Format ServerHello message
  * @param[in] context Pointer to the TLS context
@@ -521,6 +647,34 @@ error_t tlsFormatServerHello(TlsContext *context,
       p += n;
 #endif
 
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+      //A server willing to use CIDs responds with its own ConnectionId
+      //extension
+      error = dtlsFormatServerConnectionIdExtension(context, p, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Fix the length of the extension list
+      extensionList->length += (uint16_t) n;
+      //Point to the next field
+      p += n;
+#endif
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+      //A server that selected a common SRTP protection profile responds
+      //with its own UseSrtp extension
+      error = dtlsFormatServerUseSrtpExtension(context, p, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Fix the length of the extension list
+      extensionList->length += (uint16_t) n;
+      //Point to the next field
+      p += n;
+#endif
+
 #if (TLS_ECDH_ANON_KE_SUPPORT == ENABLED || TLS_ECDHE_RSA_KE_SUPPORT == ENABLED || \
    TLS_ECDHE_ECDSA_KE_SUPPORT == ENABLED || TLS_ECDHE_PSK_KE_SUPPORT == ENABLED)
       //A server that selects an ECC cipher suite in response to a ClientHello
@@ -591,6 +745,34 @@ error_t tlsFormatServerHello(TlsContext *context,
       p += n;
 #endif
 
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //A server that will issue a new ticket includes an empty
+      //SessionTicket extension in its ServerHello message
+      error = tlsFormatServerSessionTicketExtension(context, p, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Fix the length of the extension list
+      extensionList->length += (uint16_t) n;
+      //Point to the next field
+      p += n;
+#endif
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+      //A server that will staple an OCSP response includes an empty
+      //StatusRequest extension in its ServerHello message
+      error = tlsFormatServerStatusRequestExtension(context, p, &n);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Fix the length of the extension list
+      extensionList->length += (uint16_t) n;
+      //Point to the next field
+      p += n;
+#endif
+
 #if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
       //During secure renegotiation, the server must include a renegotiation_info
       //extension containing the saved client_verify_data and server_verify_data
@@ -726,11 +908,24 @@ error_t tlsFormatServerKeyExchange(TlsContext *context,
       //Point to the server's key exchange parameters
       params = p;
 
-      //Format server's key exchange parameters
-      error = tlsFormatServerKeyParams(context, p, &paramsLen);
-      //Any error to report?
-      if(error)
-         return error;
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+      //Resume a handshake suspended while signing the parameters?
+      if(context->asyncSignMessage != NULL)
+      {
+         //Restore the parameters formatted before the handshake was
+         //suspended, so that the ephemeral key is not regenerated
+         memcpy(p, context->asyncSignMessage, context->asyncSignMessageLen);
+         paramsLen = context->asyncSignMessageLen;
+      }
+      else
+#endif
+      {
+         //Format server's key exchange parameters
+         error = tlsFormatServerKeyParams(context, p, &paramsLen);
+         //Any error to report?
+         if(error)
+            return error;
+      }
 
       //Advance data pointer
       p += paramsLen;
@@ -751,6 +946,9 @@ error_t tlsFormatServerKeyExchange(TlsContext *context,
       context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
       context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
    {
+      //Signature generation is about to start
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_SIGN_START);
+
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_1)
       //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
       if(context->version <= TLS_VERSION_1_1)
@@ -776,6 +974,27 @@ error_t tlsFormatServerKeyExchange(TlsContext *context,
          error = ERROR_INVALID_VERSION;
       }
 
+      //Signature generation is complete
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_SIGN_END);
+
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+      //The signature operation is pending?
+      if(error == ERROR_WOULD_BLOCK && context->asyncSignMessage == NULL &&
+         context->asyncSignState == TLS_ASYNC_SIGN_STATE_PENDING)
+      {
+         //Save the server's key exchange parameters until the handshake
+         //resumes
+         context->asyncSignMessage = tlsAllocMem(paramsLen);
+         //Failed to allocate memory?
+         if(context->asyncSignMessage == NULL)
+            return ERROR_OUT_OF_MEMORY;
+
+         //Copy the parameters
+         memcpy(context->asyncSignMessage, params, paramsLen);
+         context->asyncSignMessageLen = paramsLen;
+      }
+#endif
+
       //Any error to report?
       if(error)
          return error;
@@ -960,107 +1179,143 @@ error_t tlsFormatCertificateRequest(TlsContext *context,
       //Length of the list in bytes
       n = 0;
 
-      //Point to the first trusted CA certificate
-      trustedCaList = context->trustedCaList;
-      //Get the total length, in bytes, of the trusted CA list
-      trustedCaListLen = context->trustedCaListLen;
+      //Pre-decoded trusted CA store?
+      if(context->trustStore != NULL)
+      {
+         //Retrieve the length of the list of distinguished names
+         n = context->trustStore->certAuthoritiesLen;
+         //Adjust the length of the message
+         *length += n;
 
-      //Allocate a memory buffer to store X.509 certificate info
-      certInfo = tlsAllocMem(sizeof(X509CertificateInfo));
+         //Sanity check
+         if(*length <= context->txBufferMaxLen)
+         {
+            //The list of distinguished names is formatted once for all
+            if(n > 0)
+               memcpy(p, context->trustStore->certAuthorities, n);
 
-      //Successful memory allocation?
-      if(certInfo != NULL)
-      {
-         //Loop through the list of trusted CA certificates
-         while(trustedCaListLen > 0 && error == NO_ERROR)
+            //Fix the length of the list
+            certAuthorities->length = htons(n);
+         }
+         else
          {
-            //The first pass calculates the length of the DER-encoded certificate
-            error = pemImportCertificate(trustedCaList, trustedCaListLen, NULL,
-               &derCertLen, &pemCertLen);
+            //Report an error
+            error = ERROR_MESSAGE_TOO_LONG;
+         }
+      }
+      else
+      {
+         //Point to the first trusted CA certificate
+         trustedCaList = context->trustedCaList;
+         //Get the total length, in bytes, of the trusted CA list
+         trustedCaListLen = context->trustedCaListLen;
 
-            //Check status code
-            if(!error)
-            {
-               //Allocate a memory buffer to hold the DER-encoded certificate
-               derCert = tlsAllocMem(derCertLen);
+         //Allocate a memory buffer to store X.509 certificate info
+         certInfo = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO,
+            sizeof(X509CertificateInfo));
 
-               //Successful memory allocation?
-               if(derCert != NULL)
+         //Successful memory allocation?
+         if(certInfo != NULL)
+         {
+            //Loop through the list of trusted CA certificates
+            while(trustedCaListLen > 0 && error == NO_ERROR)
+            {
+               //The first pass calculates the length of the DER-encoded
+               //certificate
+               TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+               error = pemImportCertificate(trustedCaList, trustedCaListLen,
+                  NULL, &derCertLen, &pemCertLen);
+
+               //Check status code
+               if(!error)
                {
-                  //The second pass decodes the PEM certificate
-                  error = pemImportCertificate(trustedCaList, trustedCaListLen,
-                     derCert, &derCertLen, NULL);
-
-                  //Check status code
-                  if(!error)
-                  {
-                     //Parse X.509 certificate
-                     error = x509ParseCertificate(derCert, derCertLen, certInfo);
-                  }
+                  //Allocate a memory buffer to hold the DER-encoded certificate
+                  derCert = tlsAllocHandshakeObject(context,
+                     TLS_MEM_CLASS_DER_CERT, derCertLen);
 
-                  //Valid CA certificate?
-                  if(!error)
+                  //Successful memory allocation?
+                  if(derCert != NULL)
                   {
-                     //Adjust the length of the message
-                     *length += certInfo->tbsCert.subject.rawDataLen + 2;
+                     //The second pass decodes the PEM certificate
+                     TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+                     error = pemImportCertificate(trustedCaList,
+                        trustedCaListLen, derCert, &derCertLen, NULL);
 
-                     //Sanity check
-                     if(*length <= context->txBufferMaxLen)
+                     //Check status code
+                     if(!error)
                      {
-                        //Each distinguished name is preceded by a 2-byte length field
-                        STORE16BE(certInfo->tbsCert.subject.rawDataLen, p);
-
-                        //The distinguished name shall be DER-encoded
-                        memcpy(p + 2, certInfo->tbsCert.subject.rawData,
-                           certInfo->tbsCert.subject.rawDataLen);
+                        //Parse X.509 certificate
+                        TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
+                        error = x509ParseCertificate(derCert, derCertLen,
+                           certInfo);
+                     }
 
-                        //Advance write pointer
-                        p += certInfo->tbsCert.subject.rawDataLen + 2;
-                        n += certInfo->tbsCert.subject.rawDataLen + 2;
+                     //Valid CA certificate?
+                     if(!error)
+                     {
+                        //Adjust the length of the message
+                        *length += certInfo->tbsCert.subject.rawDataLen + 2;
+
+                        //Sanity check
+                        if(*length <= context->txBufferMaxLen)
+                        {
+                           //Each distinguished name is preceded by a 2-byte
+                           //length field
+                           STORE16BE(certInfo->tbsCert.subject.rawDataLen, p);
+
+                           //The distinguished name shall be DER-encoded
+                           memcpy(p + 2, certInfo->tbsCert.subject.rawData,
+                              certInfo->tbsCert.subject.rawDataLen);
+
+                           //Advance write pointer
+                           p += certInfo->tbsCert.subject.rawDataLen + 2;
+                           n += certInfo->tbsCert.subject.rawDataLen + 2;
+                        }
+                        else
+                        {
+                           //Report an error
+                           error = ERROR_MESSAGE_TOO_LONG;
+                        } 
                      }
                      else
                      {
-                        //Report an error
-                        error = ERROR_MESSAGE_TOO_LONG;
-                     } 
+                        //Discard current CA certificate
+                        error = NO_ERROR;
+                     }
+
+                     //Free previously allocated memory
+                     tlsFreeHandshakeObject(context,
+                        TLS_MEM_CLASS_DER_CERT, derCert);
                   }
                   else
                   {
-                     //Discard current CA certificate
-                     error = NO_ERROR;
+                     //Failed to allocate memory
+                     error = ERROR_OUT_OF_MEMORY;
                   }
 
-                  //Free previously allocated memory
-                  tlsFreeMem(derCert);
+                  //Advance read pointer
+                  trustedCaList += pemCertLen;
+                  trustedCaListLen -= pemCertLen;
                }
                else
                {
-                  //Failed to allocate memory
-                  error = ERROR_OUT_OF_MEMORY;
+                  //End of file detected
+                  trustedCaListLen = 0;
+                  error = NO_ERROR;
                }
-
-               //Advance read pointer
-               trustedCaList += pemCertLen;
-               trustedCaListLen -= pemCertLen;
             }
-            else
-            {
-               //End of file detected
-               trustedCaListLen = 0;
-               error = NO_ERROR;
-            }
-         }
 
-         //Fix the length of the list
-         certAuthorities->length = htons(n);
+            //Fix the length of the list
+            certAuthorities->length = htons(n);
 
-         //Free previously allocated memory
-         tlsFreeMem(certInfo);
-      }
-      else
-      {
-         //Failed to allocate memory
-         error = ERROR_OUT_OF_MEMORY;
+            //Free previously allocated memory
+            tlsFreeHandshakeObject(context, TLS_MEM_CLASS_CERT_INFO, certInfo);
+         }
+         else
+         {
+            //Failed to allocate memory
+            error = ERROR_OUT_OF_MEMORY;
+         }
       }
    }
    else
@@ -1159,6 +1414,46 @@ error_t tlsFormatServerHelloDone(TlsContext *context,
 }
 
 
+/**
+ * @brief Format NewSessionTicket message
+ * @param[in] context Pointer to the TLS context
+ * @param[out] message Buffer where to format the NewSessionTicket message
+ * @param[out] length Length of the resulting NewSessionTicket message
+ * @return Error code
+ **/
+
+error_t tlsFormatNewSessionTicket(TlsContext *context,
+   TlsNewSessionTicket *message, size_t *length)
+{
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+
+   //The lifetime hint is expressed in seconds
+   message->ticketLifetimeHint = HTONL(TLS_TICKET_LIFETIME / 1000);
+
+   //The ticket is opaque to the client. It holds the session state
+   //encrypted and authenticated by the server
+   error = tlsGenerateTicket(context, message->ticket, &n);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Fix the length of the ticket
+   message->ticketLen = htons(n);
+
+   //Total length of the message
+   *length = sizeof(TlsNewSessionTicket) + n;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session ticket mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Parse ClientHello message
  *
@@ -1428,19 +1723,51 @@ error_t tlsParseClientHello(TlsContext *context,
    //Any error to report?
    if(error)
       return error;
+
+#if (TLS_CERT_STORE_SUPPORT == ENABLED)
+   //Look up the credentials associated with the server name
+   error = tlsSelectCertStoreCredentials(context);
+   //Any error to report?
+   if(error)
+      return error;
+#endif
 #endif
 
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
    //SSL 3.0, TLS 1.0, TLS 1.1 or TLS 1.2 currently selected?
    if(context->version <= TLS_VERSION_1_2)
    {
-      //The server attempts to resume TLS session via session ID
-      error = tlsResumeServerSession(context, message->sessionId,
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //The server attempts to resume TLS session via session ticket
+      error = tlsResumeServerTicket(context, message->sessionId,
          message->sessionIdLen, cipherSuites, &extensions);
       //Any error to report?
       if(error)
          return error;
 
+      //Fall back to the session ID if the ticket is not accepted
+      if(!context->resume)
+#endif
+      {
+         //The server attempts to resume TLS session via session ID
+         error = tlsResumeServerSession(context, message->sessionId,
+            message->sessionIdLen, cipherSuites, &extensions);
+         //Any error to report?
+         if(error)
+            return error;
+      }
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //A server that is planning on issuing a ticket to a client that does
+      //not present one should include an empty session ID in its ServerHello
+      //(refer to RFC 5077, section 3.4)
+      if(!context->resume && context->sessionTicketNegotiated &&
+         extensions.sessionTicketLen == 0)
+      {
+         context->sessionIdLen = 0;
+      }
+#endif
+
       //Full handshake?
       if(!context->resume)
       {
@@ -1544,6 +1871,16 @@ error_t tlsParseClientHello(TlsContext *context,
       return error;
 #endif
 
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   //The client may advertise the certificate compression algorithms it
+   //supports
+   error = tlsParseClientCertCompressionExtension(context,
+      extensions.certCompressionAlgoList);
+   //Any error to report?
+   if(error)
+      return error;
+#endif
+
 #if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
    //The value of RecordSizeLimit is the maximum size of record in octets
    //that the peer is willing to receive
@@ -1554,6 +1891,31 @@ error_t tlsParseClientHello(TlsContext *context,
       return error;
 #endif
 
+#if (DTLS_SUPPORT == ENABLED && DTLS_CID_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      //The client offers the CID the server must use
+      error = dtlsParseClientConnectionIdExtension(context,
+         extensions.connectionId);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+#endif
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_SRTP_SUPPORT == ENABLED)
+   //DTLS protocol?
+   if(context->transportProtocol == TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      //The client offers the SRTP protection profiles it supports
+      error = dtlsParseClientUseSrtpExtension(context, extensions.useSrtp);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+#endif
+
 #if (TLS_ALPN_SUPPORT == ENABLED)
    //Parse ALPN extension
    error = tlsParseClientAlpnExtension(context, extensions.protocolNameList);
@@ -1578,6 +1940,15 @@ error_t tlsParseClientHello(TlsContext *context,
       return error;
 #endif
 
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Parse StatusRequest extension
+   error = tlsParseClientStatusRequestExtension(context,
+      extensions.statusRequest);
+   //Any error to report?
+   if(error)
+      return error;
+#endif
+
    //Version of TLS prior to TLS 1.3?
    if(context->version <= TLS_VERSION_1_2)
    {
@@ -44,6 +44,8 @@ error_t tlsSendServerHello(TlsContext *context);
 error_t tlsSendServerKeyExchange(TlsContext *context);
 error_t tlsSendCertificateRequest(TlsContext *context);
 error_t tlsSendServerHelloDone(TlsContext *context);
+error_t tlsSendNewSessionTicket(TlsContext *context);
+error_t tlsSendCertificateStatus(TlsContext *context);
 
 error_t tlsFormatServerHello(TlsContext *context,
    TlsServerHello *message, size_t *length);
@@ -57,6 +59,9 @@ error_t tlsFormatCertificateRequest(TlsContext *context,
 error_t tlsFormatServerHelloDone(TlsContext *context,
    TlsServerHelloDone *message, size_t *length);
 
+error_t tlsFormatNewSessionTicket(TlsContext *context,
+   TlsNewSessionTicket *message, size_t *length);
+
 error_t tlsParseClientHello(TlsContext *context,
    const TlsClientHello *message, size_t length);
 
@@ -38,6 +38,7 @@
 #include "tls_server_extensions.h"
 #include "tls_extensions.h"
 #include "tls_misc.h"
+#include "tls_ocsp.h"
 #include "debug.h"
 
 //Check TLS library configuration
@@ -501,6 +502,89 @@ error_t tlsFormatServerEmsExtension(TlsContext *context,
 }
 
 
+/**
+ * @brief Format SessionTicket extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the SessionTicket extension
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tlsFormatServerSessionTicketExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   size_t n = 0;
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //The server uses a zero-length SessionTicket extension to indicate to
+   //the client that it will send a new ticket (refer to RFC 5077,
+   //section 3.2)
+   if(context->sessionTicketNegotiated)
+   {
+      TlsExtension *extension;
+
+      //Add the SessionTicket extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_SESSION_TICKET);
+
+      //The extension data field of this extension is empty
+      extension->length = HTONS(0);
+
+      //Compute the length, in bytes, of the SessionTicket extension
+      n = sizeof(TlsExtension);
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format StatusRequest extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Output stream where to write the StatusRequest extension
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tlsFormatServerStatusRequestExtension(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   size_t n = 0;
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //A server that will send a CertificateStatus message includes an empty
+   //StatusRequest extension in its ServerHello (refer to RFC 6066, section 8)
+   if(context->certStatusNegotiated && context->version <= TLS_VERSION_1_2)
+   {
+      TlsExtension *extension;
+
+      //Add the StatusRequest extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_STATUS_REQUEST);
+
+      //The extension data field of this extension is empty
+      extension->length = HTONS(0);
+
+      //Compute the length, in bytes, of the StatusRequest extension
+      n = sizeof(TlsExtension);
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Format RenegotiationInfo extension
  * @param[in] context Pointer to the TLS context
@@ -777,6 +861,59 @@ error_t tlsParseClientMaxFragLenExtension(TlsContext *context,
 }
 
 
+/**
+ * @brief Parse CompressCertificate extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] certCompressionAlgoList Pointer to the CompressCertificate extension
+ * @return Error code
+ **/
+
+error_t tlsParseClientCertCompressionExtension(TlsContext *context,
+   const TlsCertCompressionAlgos *certCompressionAlgoList)
+{
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   uint16_t algorithm;
+
+   //The Certificate message is sent uncompressed by default
+   context->certCompressionAlgo = TLS_CERT_COMPRESSION_NONE;
+
+   //CompressCertificate extension found?
+   if(certCompressionAlgoList != NULL)
+   {
+      //Get the number of algorithms in the list
+      n = certCompressionAlgoList->length / sizeof(uint16_t);
+
+      //The algorithms are listed in the order of preference of the client
+      for(i = 0; i < n && context->certCompressionAlgo ==
+         TLS_CERT_COMPRESSION_NONE; i++)
+      {
+         //Get the current algorithm
+         algorithm = ntohs(certCompressionAlgoList->value[i]);
+
+         //Loop through the registered codecs
+         for(j = 0; j < context->numCertCompressionCodecs; j++)
+         {
+            //The server must be able to compress its certificate chain
+            if(context->certCompressionCodecs[j].algorithm == algorithm &&
+               context->certCompressionCodecs[j].compressCallback != NULL)
+            {
+               //Select the current algorithm
+               context->certCompressionAlgo = (TlsCertCompressionAlgo) algorithm;
+               break;
+            }
+         }
+      }
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Parse RecordSizeLimit extension
  * @param[in] context Pointer to the TLS context
@@ -1215,6 +1352,38 @@ error_t tlsParseClientEmsExtension(TlsContext *context,
 }
 
 
+/**
+ * @brief Parse StatusRequest extension
+ * @param[in] context Pointer to the TLS context
+ * @param[in] statusRequest Pointer to the StatusRequest extension
+ * @return Error code
+ **/
+
+error_t tlsParseClientStatusRequestExtension(TlsContext *context,
+   const uint8_t *statusRequest)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //The client requests an OCSP response for the server certificate?
+   if(statusRequest != NULL && context->ocspCache != NULL &&
+      statusRequest[0] == TLS_CERT_STATUS_TYPE_OCSP)
+   {
+      //Pick up the cached response that matches the selected certificate.
+      //The handshake never waits for the OCSP responder
+      tlsSelectOcspResponse(context);
+   }
+   else
+   {
+      //Servers that receive a client hello containing an unknown status type
+      //must ignore the extension (refer to RFC 6066, section 8)
+      tlsReleaseStapledOcspResponse(context);
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Parse RenegotiationInfo extension
  * @param[in] context Pointer to the TLS context
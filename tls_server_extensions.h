@@ -64,6 +64,12 @@ error_t tlsFormatServerCertTypeExtension(TlsContext *context,
 error_t tlsFormatServerEmsExtension(TlsContext *context,
    uint8_t *p, size_t *written);
 
+error_t tlsFormatServerSessionTicketExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
+error_t tlsFormatServerStatusRequestExtension(TlsContext *context,
+   uint8_t *p, size_t *written);
+
 error_t tlsFormatServerRenegoInfoExtension(TlsContext *context,
    uint8_t *p, size_t *written);
 
@@ -76,6 +82,9 @@ error_t tlsParseClientSniExtension(TlsContext *context,
 error_t tlsParseClientMaxFragLenExtension(TlsContext *context,
    const uint8_t *maxFragLen);
 
+error_t tlsParseClientCertCompressionExtension(TlsContext *context,
+   const TlsCertCompressionAlgos *certCompressionAlgoList);
+
 error_t tlsParseClientRecordSizeLimitExtension(TlsContext *context,
    const uint8_t *recordSizeLimit);
 
@@ -94,6 +103,9 @@ error_t tlsParseServerCertTypeListExtension(TlsContext *context,
 error_t tlsParseClientEmsExtension(TlsContext *context,
    const uint8_t *extendedMasterSecret);
 
+error_t tlsParseClientStatusRequestExtension(TlsContext *context,
+   const uint8_t *statusRequest);
+
 error_t tlsParseClientRenegoInfoExtension(TlsContext *context,
    const TlsRenegoInfo *renegoInfo);
 
@@ -80,6 +80,11 @@ error_t tlsPerformServerHandshake(TlsContext *context)
          }
       }
 
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+      //Report state transitions to the trace callback
+      tlsTraceStateChange(context);
+#endif
+
       //Check whether the handshake is complete
       if(context->state == TLS_STATE_APPLICATION_DATA)
       {
@@ -114,6 +119,15 @@ error_t tlsPerformServerHandshake(TlsContext *context)
          error = tlsSendCertificate(context);
          break;
 
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+      //Sending CertificateStatus message?
+      case TLS_STATE_SERVER_CERTIFICATE_STATUS:
+         //The server staples the OCSP response of its certificate immediately
+         //after the Certificate message
+         error = tlsSendCertificateStatus(context);
+         break;
+#endif
+
       //Sending Certificate message?
       case TLS_STATE_CERTIFICATE_REQUEST:
          //A non-anonymous server can optionally request a certificate from the
@@ -122,6 +136,33 @@ error_t tlsPerformServerHandshake(TlsContext *context)
          error = tlsSendCertificateRequest(context);
          break;
 
+#if ((TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3) || \
+   TLS12_TICKET_SUPPORT == ENABLED)
+      //Sending NewSessionTicket message message?
+      case TLS_STATE_NEW_SESSION_TICKET:
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+         //Version of TLS prior to TLS 1.3?
+         if(context->version <= TLS_VERSION_1_2)
+         {
+            //The server issues the ticket before its ChangeCipherSpec
+            //message (refer to RFC 5077, section 3.3)
+            error = tlsSendNewSessionTicket(context);
+         }
+         else
+#endif
+         {
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+            //At any time after the server has received the client Finished
+            //message, it may send a NewSessionTicket message
+            error = tls13SendNewSessionTicket(context);
+#else
+            //Report an error
+            error = ERROR_UNEXPECTED_STATE;
+#endif
+         }
+         break;
+#endif
+
       //Sending ChangeCipherSpec message?
       case TLS_STATE_SERVER_CHANGE_CIPHER_SPEC:
       case TLS_STATE_SERVER_CHANGE_CIPHER_SPEC_2:
@@ -208,13 +249,6 @@ error_t tlsPerformServerHandshake(TlsContext *context)
          error = tls13GenerateClientAppTrafficKeys(context);
          break;
 
-      //Sending NewSessionTicket message message?
-      case TLS_STATE_NEW_SESSION_TICKET:
-         //At any time after the server has received the client Finished
-         //message, it may send a NewSessionTicket message
-         error = tls13SendNewSessionTicket(context);
-         break;
-
       //Sending KeyUpdate message?
       case TLS_STATE_KEY_UPDATE:
          //The KeyUpdate handshake message is used to indicate that the sender
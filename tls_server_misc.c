@@ -45,7 +45,10 @@
 #include "tls_cache.h"
 #include "tls_ffdhe.h"
 #include "tls_record.h"
+#include "tls_credential.h"
+#include "tls_key_pool.h"
 #include "tls_misc.h"
+#include "tls_stats.h"
 #include "pkix/pem_import.h"
 #include "debug.h"
 
@@ -145,9 +148,22 @@ error_t tlsFormatServerKeyParams(TlsContext *context,
       //Check status code
       if(!error)
       {
-         //Generate an ephemeral key pair
-         error = dhGenerateKeyPair(&context->dhContext, context->prngAlgo,
-            context->prngContext);
+#if (TLS_FFDHE_SUPPORT == ENABLED)
+         //Take a pre-generated key pair from the pool, if any
+         if(ffdheGroup != NULL)
+            error = tlsTakeKeyPair(context, context->namedGroup);
+         else
+#endif
+            error = ERROR_NOT_FOUND;
+
+         //No key pair available?
+         if(error == ERROR_NOT_FOUND)
+         {
+            //Generate an ephemeral key pair
+            TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+            error = dhGenerateKeyPair(&context->dhContext, context->prngAlgo,
+               context->prngContext);
+         }
       }
 
       //Check status code
@@ -241,10 +257,20 @@ error_t tlsFormatServerKeyParams(TlsContext *context,
 
             //Check status code
             if(error == ERROR_UNSUPPORTED_ELLIPTIC_CURVE)
+            {
+               //Take a pre-generated key pair from the pool, if any
+               error = tlsTakeKeyPair(context, context->namedGroup);
+            }
+
+            //No key pair available?
+            if(error == ERROR_NOT_FOUND)
             {
                //Generate an ephemeral key pair
+               TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_START);
+               TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
                error = ecdhGenerateKeyPair(&context->ecdhContext,
                   context->prngAlgo, context->prngContext);
+               TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_END);
             }
          }
 
@@ -342,12 +368,14 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
       Md5Context *md5Context;
       Sha1Context *sha1Context;
       RsaPrivateKey privateKey;
+      const RsaPrivateKey *rsaPrivateKey;
 
       //Initialize RSA private key
       rsaInitPrivateKey(&privateKey);
 
       //Allocate a memory buffer to hold the MD5 context
-      md5Context = tlsAllocMem(sizeof(Md5Context));
+      md5Context = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         sizeof(Md5Context));
 
       //Successful memory allocation?
       if(md5Context != NULL)
@@ -361,7 +389,8 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
          md5Final(md5Context, context->serverVerifyData);
 
          //Release previously allocated memory
-         tlsFreeMem(md5Context);
+         tlsFreeHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, md5Context);
       }
       else
       {
@@ -373,7 +402,8 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
       if(!error)
       {
          //Allocate a memory buffer to hold the SHA-1 context
-         sha1Context = tlsAllocMem(sizeof(Sha1Context));
+         sha1Context = tlsAllocHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, sizeof(Sha1Context));
 
          //Successful memory allocation?
          if(sha1Context != NULL)
@@ -387,7 +417,8 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
             sha1Final(sha1Context, context->serverVerifyData + MD5_DIGEST_SIZE);
 
             //Release previously allocated memory
-            tlsFreeMem(sha1Context);
+            tlsFreeHandshakeObject(context,
+               TLS_MEM_CLASS_HASH_CONTEXT, sha1Context);
          }
          else
          {
@@ -399,16 +430,16 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
       //Check status code
       if(!error)
       {
-         //Decode the PEM structure that holds the RSA private key
-         error = pemImportRsaPrivateKey(context->cert->privateKey,
-            context->cert->privateKeyLen, &privateKey);
+         //Retrieve the RSA private key
+         error = tlsGetRsaPrivateKey(context->cert, &privateKey,
+            &rsaPrivateKey);
       }
 
       //Check status code
       if(!error)
       {
          //Sign the key exchange parameters using RSA
-         error = tlsGenerateRsaSignature(&privateKey,
+         error = tlsGenerateRsaSignature(rsaPrivateKey,
             context->serverVerifyData, signature->value, written);
       }
 
@@ -424,7 +455,8 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
       Sha1Context *sha1Context;
 
       //Allocate a memory buffer to hold the SHA-1 context
-      sha1Context = tlsAllocMem(sizeof(Sha1Context));
+      sha1Context = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         sizeof(Sha1Context));
 
       //Successful memory allocation?
       if(sha1Context != NULL)
@@ -438,7 +470,8 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
          sha1Final(sha1Context, context->serverVerifyData);
 
          //Release previously allocated memory
-         tlsFreeMem(sha1Context);
+         tlsFreeHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, sha1Context);
       }
       else
       {
@@ -463,7 +496,8 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
       Sha1Context *sha1Context;
 
       //Allocate a memory buffer to hold the SHA-1 context
-      sha1Context = tlsAllocMem(sizeof(Sha1Context));
+      sha1Context = tlsAllocHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         sizeof(Sha1Context));
 
       //Successful memory allocation?
       if(sha1Context != NULL)
@@ -477,7 +511,8 @@ error_t tlsGenerateServerKeySignature(TlsContext *context,
          sha1Final(sha1Context, context->serverVerifyData);
 
          //Release previously allocated memory
-         tlsFreeMem(sha1Context);
+         tlsFreeHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, sha1Context);
       }
       else
       {
@@ -542,6 +577,39 @@ error_t tls12GenerateServerKeySignature(TlsContext *context,
    //Total number of bytes that have been written
    *written = 0;
 
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   //The private key operation is delegated to the application?
+   if(context->asyncSignCallback != NULL)
+   {
+      uint8_t *buffer;
+
+      //A temporary buffer is needed to concatenate ClientHello.random +
+      //ServerHello.random + ServerKeyExchange.params
+      buffer = tlsAllocMem(paramsLen + 2 * TLS_RANDOM_SIZE);
+
+      //Successful memory allocation?
+      if(buffer != NULL)
+      {
+         //The unhashed content is passed to the application
+         memcpy(buffer, context->clientRandom, TLS_RANDOM_SIZE);
+         memcpy(buffer + 32, context->serverRandom, TLS_RANDOM_SIZE);
+         memcpy(buffer + 64, params, paramsLen);
+
+         //Sign the key exchange parameters
+         error = tlsGenerateAsyncSignature(context, buffer, paramsLen + 64,
+            &signature->algorithm, signature->value, written);
+
+         //Release previously allocated memory
+         tlsFreeMem(buffer);
+      }
+      else
+      {
+         //Failed to allocate memory
+         error = ERROR_OUT_OF_MEMORY;
+      }
+   }
+   else
+#endif
 #if (TLS_RSA_SIGN_SUPPORT == ENABLED || TLS_RSA_PSS_SIGN_SUPPORT == ENABLED || \
    TLS_DSA_SIGN_SUPPORT == ENABLED || TLS_ECDSA_SIGN_SUPPORT == ENABLED)
    //RSA, DSA or ECDSA signature scheme?
@@ -587,7 +655,8 @@ error_t tls12GenerateServerKeySignature(TlsContext *context,
       if(hashAlgo != NULL)
       {
          //Allocate a memory buffer to hold the hash context
-         hashContext = tlsAllocMem(hashAlgo->contextSize);
+         hashContext = tlsAllocHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, hashAlgo->contextSize);
 
          //Successful memory allocation?
          if(hashContext != NULL)
@@ -605,6 +674,7 @@ error_t tls12GenerateServerKeySignature(TlsContext *context,
             if(context->signAlgo == TLS_SIGN_ALGO_RSA)
             {
                RsaPrivateKey privateKey;
+               const RsaPrivateKey *rsaPrivateKey;
 
                //Initialize RSA private key
                rsaInitPrivateKey(&privateKey);
@@ -613,15 +683,15 @@ error_t tls12GenerateServerKeySignature(TlsContext *context,
                signature->algorithm.signature = TLS_SIGN_ALGO_RSA;
                signature->algorithm.hash = context->signHashAlgo;
 
-               //Decode the PEM structure that holds the RSA private key
-               error = pemImportRsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLen, &privateKey);
+               //Retrieve the RSA private key
+               error = tlsGetRsaPrivateKey(context->cert, &privateKey,
+                  &rsaPrivateKey);
 
                //Check status code
                if(!error)
                {
                   //Generate RSA signature (RSASSA-PKCS1-v1_5 signature scheme)
-                  error = rsassaPkcs1v15Sign(&privateKey, hashAlgo,
+                  error = rsassaPkcs1v15Sign(rsaPrivateKey, hashAlgo,
                      hashContext->digest, signature->value, written);
                }
 
@@ -640,6 +710,7 @@ error_t tls12GenerateServerKeySignature(TlsContext *context,
                context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA512)
             {
                RsaPrivateKey privateKey;
+               const RsaPrivateKey *rsaPrivateKey;
 
                //Initialize RSA private key
                rsaInitPrivateKey(&privateKey);
@@ -648,16 +719,16 @@ error_t tls12GenerateServerKeySignature(TlsContext *context,
                signature->algorithm.signature = context->signAlgo;
                signature->algorithm.hash = TLS_HASH_ALGO_INTRINSIC;
 
-               //Decode the PEM structure that holds the RSA private key
-               error = pemImportRsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLen, &privateKey);
+               //Retrieve the RSA private key
+               error = tlsGetRsaPrivateKey(context->cert, &privateKey,
+                  &rsaPrivateKey);
 
                //Check status code
                if(!error)
                {
                   //Generate RSA signature (RSASSA-PSS signature scheme)
                   error = rsassaPssSign(context->prngAlgo, context->prngContext,
-                     &privateKey, hashAlgo, hashAlgo->digestSize,
+                     rsaPrivateKey, hashAlgo, hashAlgo->digestSize,
                      hashContext->digest, signature->value, written);
                }
 
@@ -701,7 +772,8 @@ error_t tls12GenerateServerKeySignature(TlsContext *context,
             }
 
             //Release previously allocated memory
-            tlsFreeMem(hashContext);
+            tlsFreeHandshakeObject(context,
+               TLS_MEM_CLASS_HASH_CONTEXT, hashContext);
          }
          else
          {
@@ -930,15 +1002,66 @@ error_t tlsResumeServerSession(TlsContext *context, const uint8_t *sessionId,
 
 #if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
    //Check whether session caching is supported
-   if(context->cache != NULL)
+   if(context->cache != NULL || context->extCacheGetCallback != NULL)
    {
       uint_t i;
       uint_t n;
       TlsSessionState *session;
+      TlsSessionState extSession;
+
+      //Initialize session state
+      tlsInitSessionState(&extSession);
+      session = NULL;
 
       //If the session ID was non-empty, the server will look in its
       //session cache for a match
-      session = tlsFindCache(context->cache, sessionId, sessionIdLen);
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_CACHE_LOOKUP_START);
+      error = tlsFindCache(context->cache, sessionId, sessionIdLen,
+         &extSession);
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_CACHE_LOOKUP_END);
+
+      //Matching session found? (the lookup returns a copy of the entry)
+      if(!error)
+      {
+         session = &extSession;
+      }
+      else
+      {
+         //The entry may have been partially decoded before the failure, so
+         //discard the copy before it is reused for the external lookup
+         tlsFreeSessionState(&extSession);
+         tlsInitSessionState(&extSession);
+
+         //Do not carry any resumption state over
+         context->resume = FALSE;
+      }
+
+      //The in-process session cache acts as a first tier in front of the
+      //external session cache
+      if(session == NULL)
+      {
+         //Search the external session cache
+         error = tlsFindExtCache(context, sessionId, sessionIdLen, &extSession);
+
+         //The ClientHello is parked until the result of the lookup is posted
+         if(error == ERROR_WOULD_BLOCK)
+            return error;
+
+         //Matching session found?
+         if(!error)
+         {
+            session = &extSession;
+         }
+         else
+         {
+            //Discard any partially decoded session state
+            tlsFreeSessionState(&extSession);
+            tlsInitSessionState(&extSession);
+         }
+
+         //A lookup failure is not fatal
+         error = NO_ERROR;
+      }
 
       //Matching session found?
       if(session != NULL)
@@ -1019,6 +1142,9 @@ error_t tlsResumeServerSession(TlsContext *context, const uint8_t *sessionId,
       //Check whether the server has decided to resume a previous session
       if(session != NULL)
       {
+         //Update statistics
+         TLS_GLOBAL_STATS_INC(context, cacheHits);
+
          //Perform abbreviated handshake
          context->resume = TRUE;
          //Restore cached session parameters
@@ -1029,6 +1155,9 @@ error_t tlsResumeServerSession(TlsContext *context, const uint8_t *sessionId,
       }
       else
       {
+         //Update statistics
+         TLS_GLOBAL_STATS_INC(context, cacheMisses);
+
          //Perform a full handshake
          context->resume = FALSE;
          //Session ID is limited to 32 bytes
@@ -1038,6 +1167,9 @@ error_t tlsResumeServerSession(TlsContext *context, const uint8_t *sessionId,
          error = context->prngAlgo->read(context->prngContext,
             context->sessionId, context->sessionIdLen);
       }
+
+      //Release the copy of the session state
+      tlsFreeSessionState(&extSession);
    }
    else
 #endif
@@ -1057,6 +1189,250 @@ error_t tlsResumeServerSession(TlsContext *context, const uint8_t *sessionId,
 }
 
 
+/**
+ * @brief Resume TLS session via session ticket
+ * @param[in] context Pointer to the TLS context
+ * @param[in] sessionId Pointer to the session ID offered by the client
+ * @param[in] sessionIdLen Length of the session ID, in bytes
+ * @param[in] cipherSuites List of cipher suites offered by the client
+ * @param[in] extensions ClientHello extensions offered by the client
+ * @return Error code
+ **/
+
+error_t tlsResumeServerTicket(TlsContext *context, const uint8_t *sessionId,
+   size_t sessionIdLen, const TlsCipherSuites *cipherSuites,
+   const TlsHelloExtensions *extensions)
+{
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   error_t error;
+   uint_t i;
+   uint_t n;
+   size_t length;
+   systime_t ticketAge;
+   TlsTicketState *state;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Initialize flags
+   context->sessionTicketNegotiated = FALSE;
+   context->ticketResume = FALSE;
+
+   //The server issues tickets only if the client advertised support for
+   //the SessionTicket extension and an encryption callback is registered
+   if(extensions->sessionTicket == NULL || !context->sessionTicketEnabled ||
+      context->ticketEncryptCallback == NULL)
+   {
+      return NO_ERROR;
+   }
+
+   //The server will issue a new ticket
+   context->sessionTicketNegotiated = TRUE;
+
+   //The client must include a session ID along with the ticket so that it
+   //can tell whether the server accepted it (refer to RFC 5077, section 3.4)
+   if(extensions->sessionTicketLen == 0 || sessionIdLen == 0 ||
+      context->ticketDecryptCallback == NULL)
+   {
+      return NO_ERROR;
+   }
+
+   //Allocate a buffer to store the decrypted state information
+   length = extensions->sessionTicketLen;
+   state = tlsAllocHandshakeMem(context, length);
+   //Failed to allocate memory?
+   if(state == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Start of exception handling block
+   do
+   {
+      //Decrypt the received ticket
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_TICKET_DECRYPT_START);
+      error = context->ticketDecryptCallback(context, extensions->sessionTicket,
+         extensions->sessionTicketLen, (uint8_t *) state, &length,
+         context->ticketParam);
+      TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_TICKET_DECRYPT_END);
+
+      //Check status code
+      if(!error)
+      {
+         //Update statistics
+         TLS_GLOBAL_STATS_INC(context, ticketDecryptSuccesses);
+      }
+      else
+      {
+         //Update statistics
+         TLS_GLOBAL_STATS_INC(context, ticketDecryptFailures);
+         //Report an error
+         break;
+      }
+
+      //Check the length of the decrypted ticket
+      if(length != sizeof(TlsTicketState))
+      {
+         //The ticket is malformed
+         error = ERROR_INVALID_TICKET;
+         break;
+      }
+
+      //The ticket must have been issued for the negotiated version
+      if(state->version != context->version)
+      {
+         //The ticket is not valid
+         error = ERROR_INVALID_TICKET;
+         break;
+      }
+
+      //Compute the time since the ticket was issued
+      ticketAge = osGetSystemTime() - state->ticketTimestamp;
+
+      //Verify ticket's validity
+      if(ticketAge >= (state->ticketLifetime * 1000))
+      {
+         //The ticket is not valid
+         error = ERROR_INVALID_TICKET;
+         break;
+      }
+
+      //Get the total number of cipher suites offered by the client
+      n = ntohs(cipherSuites->length) / 2;
+
+      //Loop through the list of cipher suite identifiers
+      for(i = 0; i < n; i++)
+      {
+         //Matching cipher suite?
+         if(ntohs(cipherSuites->value[i]) == state->cipherSuite)
+            break;
+      }
+
+      //If the cipher suite is not present in the list cipher suites offered
+      //by the client, the server must not perform the abbreviated handshake
+      if(i >= n)
+      {
+         error = ERROR_INVALID_TICKET;
+         break;
+      }
+
+#if (TLS_EXT_MASTER_SECRET_SUPPORT == ENABLED)
+      //If the original session did not use the ExtendedMasterSecret
+      //extension but the new ClientHello contains the extension, then the
+      //server must not perform the abbreviated handshake
+      if(extensions->extendedMasterSecret != NULL &&
+         !state->extendedMasterSecret)
+      {
+         error = ERROR_INVALID_TICKET;
+         break;
+      }
+#endif
+
+      //Select the relevant cipher suite before the resumption state is
+      //applied, so that an unusable ticket leaves the context untouched
+      error = tlsSelectCipherSuite(context, state->cipherSuite);
+      //The cipher suite cannot be used for this connection?
+      if(error)
+         break;
+
+      //Perform abbreviated handshake
+      context->resume = TRUE;
+      context->ticketResume = TRUE;
+
+      //The server echoes the session ID offered by the client to indicate
+      //that the ticket has been accepted
+      memcpy(context->sessionId, sessionId, sessionIdLen);
+      context->sessionIdLen = sessionIdLen;
+
+      //Restore master secret
+      memcpy(context->masterSecret, state->secret, TLS_MASTER_SECRET_SIZE);
+
+#if (TLS_EXT_MASTER_SECRET_SUPPORT == ENABLED)
+      //Extended master secret computation
+      context->extendedMasterSecretExtReceived = state->extendedMasterSecret;
+#endif
+
+      //End of exception handling block
+   } while(0);
+
+   //Release state information
+   memset(state, 0, extensions->sessionTicketLen);
+   tlsFreeHandshakeMem(context, state);
+
+   //An invalid ticket is not fatal. The server falls back to a full
+   //handshake (refer to RFC 5077, section 3.1)
+   if(error)
+   {
+      //Discard any resumption state
+      context->resume = FALSE;
+      context->ticketResume = FALSE;
+      context->sessionIdLen = 0;
+      memset(context->masterSecret, 0, TLS_MASTER_SECRET_SIZE);
+
+      //Perform a full handshake
+      error = NO_ERROR;
+   }
+
+   //Return status code
+   return error;
+#else
+   //Session ticket mechanism is not implemented
+   return NO_ERROR;
+#endif
+}
+
+
+/**
+ * @brief Session ticket generation
+ * @param[in] context Pointer to the TLS context
+ * @param[out] ticket Output stream where to write the session ticket
+ * @param[out] length Length of the session ticket, in bytes
+ * @return Error code
+ **/
+
+error_t tlsGenerateTicket(TlsContext *context, uint8_t *ticket,
+   size_t *length)
+{
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   error_t error;
+   TlsTicketState *state;
+
+   //Point to the session state information
+   state = (TlsTicketState *) ticket;
+
+   //Save session state
+   state->version = context->version;
+   state->cipherSuite = context->cipherSuite.identifier;
+   state->ticketTimestamp = osGetSystemTime();
+   state->ticketLifetime = TLS_TICKET_LIFETIME / 1000;
+   memcpy(state->secret, context->masterSecret, TLS_MASTER_SECRET_SIZE);
+
+#if (TLS_EXT_MASTER_SECRET_SUPPORT == ENABLED)
+   //Extended master secret computation
+   state->extendedMasterSecret = context->extendedMasterSecretExtReceived;
+#else
+   //The ExtendedMasterSecret extension is not supported
+   state->extendedMasterSecret = FALSE;
+#endif
+
+   //Make sure a valid callback has been registered
+   if(context->ticketEncryptCallback == NULL)
+      return ERROR_FAILURE;
+
+   //Encrypt the state information
+   error = context->ticketEncryptCallback(context, (uint8_t *) state,
+      sizeof(TlsTicketState), ticket, length, context->ticketParam);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session ticket mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Version negotiation
  * @param[in] context Pointer to the TLS context
@@ -1166,10 +1542,14 @@ error_t tlsNegotiateCipherSuite(TlsContext *context, const HashAlgo *hashAlgo,
    const TlsCipherSuites *cipherSuites, TlsHelloExtensions *extensions)
 {
    error_t error;
+   uint_t k;
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == DISABLED)
    uint_t i;
    uint_t j;
-   uint_t k;
+   uint_t l;
+   uint_t m;
    uint_t n;
+#endif
 
    //Initialize status code
    error = ERROR_HANDSHAKE_FAILED;
@@ -1182,6 +1562,31 @@ error_t tlsNegotiateCipherSuite(TlsContext *context, const HashAlgo *hashAlgo,
       extensions->certSignAlgoList = extensions->signAlgoList;
    }
 
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+   //Build the negotiation table on first use
+   if(context->cipherSuiteTable == NULL)
+   {
+      context->cipherSuiteTable = tlsInitCipherSuiteTable(context->cipherSuites,
+         context->numCipherSuites, context->cipherSuiteGroups,
+         context->numCipherSuiteGroups);
+
+      //Failed to allocate memory?
+      if(context->cipherSuiteTable == NULL)
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Select the most appropriate cipher suite (2-pass process)
+   for(k = 0; k < 2 && error; k++)
+   {
+      //Select the most appropriate cipher suite in a single pass over the
+      //list offered by the client
+      error = tlsNegotiateCipherSuiteFromTable(context, hashAlgo,
+         cipherSuites, extensions);
+
+      //The second pass relaxes the constraints
+      extensions->certSignAlgoList = NULL;
+   }
+#else
    //Get the total number of cipher suites offered by the client
    n = ntohs(cipherSuites->length) / 2;
 
@@ -1192,41 +1597,60 @@ error_t tlsNegotiateCipherSuite(TlsContext *context, const HashAlgo *hashAlgo,
       if(context->numCipherSuites > 0)
       {
          //Loop through the list of allowed cipher suites (most preferred first)
-         for(i = 0; i < context->numCipherSuites && error; i++)
+         for(i = 0; i < context->numCipherSuites && error; i = m)
          {
+            //Cipher suites of the same equal-preference group are ranked
+            //equally, and the client's order decides among them
+            for(m = i + 1; m < context->numCipherSuites; m++)
+            {
+               //Check whether the next cipher suite belongs to the group
+               if(m >= context->numCipherSuiteGroups ||
+                  context->cipherSuiteGroups[m] == 0)
+               {
+                  break;
+               }
+            }
+
             //Loop through the list of cipher suites offered by the client
             for(j = 0; j < n && error; j++)
             {
-               //If the list contains cipher suites the server does not
-               //recognize, support, or wish to use, the server must ignore
-               //those cipher suites, and process the remaining ones as usual
-               if(context->cipherSuites[i] == ntohs(cipherSuites->value[j]))
+               //Loop through the members of the current group
+               for(l = i; l < m && error; l++)
                {
-                  //Select current cipher suite
-                  error = tlsSelectCipherSuite(context, context->cipherSuites[i]);
-
-                  //If a KDF hash algorithm has been specified, the server must
-                  //select a compatible cipher suite
-                  if(!error && hashAlgo != NULL)
-                  {
-                     //Make sure the selected cipher suite is compatible
-                     if(context->cipherSuite.prfHashAlgo != hashAlgo)
-                        error = ERROR_HANDSHAKE_FAILED;
-                  }
-
-                  //Check status code
-                  if(!error)
-                  {
-                     //Select the group to be used when performing (EC)DHE key
-                     //exchange
-                     error = tlsSelectGroup(context, extensions->supportedGroupList);
-                  }
-
-                  //Check status code
-                  if(!error)
+                  //If the list contains cipher suites the server does not
+                  //recognize, support, or wish to use, the server must ignore
+                  //those cipher suites, and process the remaining ones as
+                  //usual
+                  if(context->cipherSuites[l] == ntohs(cipherSuites->value[j]))
                   {
-                     //Select the appropriate certificate
-                     error = tlsSelectCertificate(context, extensions);
+                     //Select current cipher suite
+                     error = tlsSelectCipherSuite(context,
+                        context->cipherSuites[l]);
+
+                     //If a KDF hash algorithm has been specified, the server
+                     //must select a compatible cipher suite
+                     if(!error && hashAlgo != NULL)
+                     {
+                        //Make sure the selected cipher suite is compatible
+                        if(context->cipherSuite.prfHashAlgo != hashAlgo)
+                           error = ERROR_HANDSHAKE_FAILED;
+                     }
+
+                     //Check status code
+                     if(!error)
+                     {
+                        //Select the group to be used when performing (EC)DHE
+                        //key exchange
+                        error = tlsSelectGroup(context,
+                           extensions->supportedGroupList);
+                     }
+
+                     //Check status code
+                     if(!error)
+                     {
+                        //Select the appropriate certificate
+                        error = tlsSelectCertificate(context, extensions);
+                     }
                   }
                }
             }
@@ -1271,12 +1695,189 @@ error_t tlsNegotiateCipherSuite(TlsContext *context, const HashAlgo *hashAlgo,
       //The second pass relaxes the constraints
       extensions->certSignAlgoList = NULL;
    }
+#endif
 
    //Return status code
    return error;
 }
 
 
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+
+/**
+ * @brief Cipher suite negotiation using the precompiled table
+ *
+ * The list offered by the client is scanned once. The outcome of group and
+ * certificate selection only depends on the key exchange method, so it is
+ * computed once per key exchange method and reused for the other candidates
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] hashAlgo Desired KDF hash algorithm
+ * @param[in] cipherSuites List of cipher suites offered by the client
+ * @param[in] extensions ClientHello extensions offered by the client
+ * @return Error code
+ **/
+
+error_t tlsNegotiateCipherSuiteFromTable(TlsContext *context,
+   const HashAlgo *hashAlgo, const TlsCipherSuites *cipherSuites,
+   const TlsHelloExtensions *extensions)
+{
+   error_t error;
+   uint_t j;
+   uint_t n;
+   uint32_t mask;
+   uint32_t tested;
+   uint32_t passed;
+   uint16_t identifier;
+   uint16_t selected;
+   uint16_t winner;
+   const TlsCipherSuiteInfo *cipherSuite;
+   const TlsCipherSuiteEntry *entry;
+   const TlsCipherSuiteEntry *best;
+
+   //Get the total number of cipher suites offered by the client
+   n = ntohs(cipherSuites->length) / 2;
+
+   //Initialize variables
+   tested = 0;
+   passed = 0;
+   selected = 0;
+   winner = 0;
+   best = NULL;
+
+   //Loop through the list of cipher suites offered by the client
+   for(j = 0; j < n; j++)
+   {
+      //Get cipher suite identifier
+      identifier = ntohs(cipherSuites->value[j]);
+
+      //If the list contains cipher suites the server does not recognize,
+      //support, or wish to use, the server must ignore those cipher suites,
+      //and process the remaining ones as usual
+      entry = tlsLookupCipherSuite(context->cipherSuiteTable, identifier);
+      //Unknown or restricted cipher suite?
+      if(entry == NULL)
+         continue;
+
+      //When the server has its own preferences, only a cipher suite that
+      //ranks better than the current best can win
+      if(best != NULL && entry->rank >= best->rank)
+         continue;
+
+      //Point to the cipher suite definition
+      cipherSuite = &tlsSupportedCipherSuites[entry->index];
+
+      //Check whether the cipher suite can be negotiated with the negotiated
+      //protocol version
+      if(!tlsIsCipherSuiteAcceptable(cipherSuite, context->version,
+         context->version, context->transportProtocol))
+      {
+         continue;
+      }
+
+      //If a KDF hash algorithm has been specified, the server must select a
+      //compatible cipher suite
+      if(hashAlgo != NULL)
+      {
+         //PRF with the SHA-256 is used for all cipher suites published prior
+         //than TLS 1.2
+         if(cipherSuite->prfHashAlgo != NULL &&
+            cipherSuite->prfHashAlgo != hashAlgo)
+         {
+            continue;
+         }
+
+         if(cipherSuite->prfHashAlgo == NULL && hashAlgo != SHA256_HASH_ALGO)
+            continue;
+      }
+
+      //Key exchange method of the cipher suite
+      mask = 1U << cipherSuite->keyExchMethod;
+
+      //Group and certificate selection not yet performed for this key
+      //exchange method?
+      if((tested & mask) == 0)
+      {
+         //Select current cipher suite
+         error = tlsSelectCipherSuite(context, identifier);
+
+         //Check status code
+         if(!error)
+         {
+            //Select the group to be used when performing (EC)DHE key exchange
+            error = tlsSelectGroup(context, extensions->supportedGroupList);
+         }
+
+         //Check status code
+         if(!error)
+         {
+            //Select the appropriate certificate
+            error = tlsSelectCertificate(context, extensions);
+         }
+
+         //Memoize the outcome
+         tested |= mask;
+
+         if(!error)
+            passed |= mask;
+
+         //The TLS context now reflects the current cipher suite
+         selected = identifier;
+      }
+
+      //Acceptable cipher suite?
+      if((passed & mask) != 0)
+      {
+         //Save the best candidate so far
+         best = entry;
+         winner = identifier;
+
+         //No other cipher suite can rank better (all the cipher suites have
+         //the same rank when the client's preferences are honored)
+         if(best->rank == 0)
+         {
+            break;
+         }
+      }
+   }
+
+   //No acceptable cipher suite?
+   if(best == NULL)
+      return ERROR_HANDSHAKE_FAILED;
+
+   //The TLS context reflects the last cipher suite that has been checked
+   if(selected != winner)
+   {
+      //Select the winning cipher suite
+      error = tlsSelectCipherSuite(context, winner);
+
+      //Check status code
+      if(!error)
+      {
+         //Select the group to be used when performing (EC)DHE key exchange
+         error = tlsSelectGroup(context, extensions->supportedGroupList);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Select the appropriate certificate
+         error = tlsSelectCertificate(context, extensions);
+      }
+   }
+   else
+   {
+      //The TLS context already reflects the winning cipher suite
+      error = NO_ERROR;
+   }
+
+   //Return status code
+   return error;
+}
+
+#endif
+
+
 /**
  * @brief Select the group to be used when performing (EC)DHE key exchange
  * @param[in] context Pointer to the TLS context
@@ -1448,8 +2049,10 @@ error_t tlsSelectCertificate(TlsContext *context,
    error_t error;
    uint_t i;
    uint_t n;
+   uint_t numCerts;
    bool_t acceptable;
    uint8_t certTypes[2];
+   TlsCertDesc *cert;
 
    //Initialize status code
    error = NO_ERROR;
@@ -1541,12 +2144,32 @@ error_t tlsSelectCertificate(TlsContext *context,
       //Reset currently selected certificate
       context->cert = NULL;
 
+      //Total number of candidate certificates
+      numCerts = context->numCerts;
+
+#if (TLS_CERT_STORE_SUPPORT == ENABLED)
+      //The certificates selected from the store by server name are tried
+      //before the certificates attached to the context
+      numCerts += context->numStoreCerts;
+#endif
+
       //Loop through the list of available certificates
-      for(i = 0; i < context->numCerts && context->cert == NULL; i++)
+      for(i = 0; i < numCerts && context->cert == NULL; i++)
       {
+#if (TLS_CERT_STORE_SUPPORT == ENABLED)
+         //Point to the current certificate
+         if(i < context->numStoreCerts)
+            cert = &context->storeCerts[i];
+         else
+            cert = &context->certs[i - context->numStoreCerts];
+#else
+         //Point to the current certificate
+         cert = &context->certs[i];
+#endif
+
          //Check whether the current certificate is acceptable
-         acceptable = tlsIsCertificateAcceptable(context, &context->certs[i],
-            certTypes, n, extensions->signAlgoList, extensions->certSignAlgoList,
+         acceptable = tlsIsCertificateAcceptable(context, cert, certTypes, n,
+            extensions->signAlgoList, extensions->certSignAlgoList,
             extensions->supportedGroupList, NULL);
 
          //The certificate must be appropriate for the negotiated cipher
@@ -1555,7 +2178,7 @@ error_t tlsSelectCertificate(TlsContext *context,
          {
             //The hash algorithm to be used when generating signatures must
             //be one of those present in the SignatureAlgorithms extension
-            error = tlsSelectSignatureScheme(context, &context->certs[i],
+            error = tlsSelectSignatureScheme(context, cert,
                extensions->signAlgoList);
 
             //Check status code
@@ -1563,7 +2186,7 @@ error_t tlsSelectCertificate(TlsContext *context,
             {
                //If all the requirements were met, the certificate can be
                //used in conjunction with the selected cipher suite
-               context->cert = &context->certs[i];
+               context->cert = cert;
             }
          }
       }
@@ -1708,6 +2331,7 @@ error_t tlsParseClientKeyParams(TlsContext *context,
       uint32_t bad;
       uint16_t version;
       RsaPrivateKey privateKey;
+      const RsaPrivateKey *rsaPrivateKey;
       uint8_t randPremasterSecret[48];
 
       //The RSA-encrypted premaster secret in a ClientKeyExchange is preceded by
@@ -1741,17 +2365,18 @@ error_t tlsParseClientKeyParams(TlsContext *context,
       //Initialize RSA private key
       rsaInitPrivateKey(&privateKey);
 
-      //Decode the PEM structure that holds the RSA private key
-      error = pemImportRsaPrivateKey(context->cert->privateKey,
-         context->cert->privateKeyLen, &privateKey);
+      //Retrieve the RSA private key
+      error = tlsGetRsaPrivateKey(context->cert, &privateKey,
+         &rsaPrivateKey);
 
       //Check status code
       if(!error)
       {
          //Decrypt the premaster secret using the server private key
-         error = rsaesPkcs1v15Decrypt(&privateKey, p, length,
-            context->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
-            &context->premasterSecretLen);
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+         error = rsaesPkcs1v15Decrypt(rsaPrivateKey, p, length,
+            context->handshake->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
+            &context->handshake->premasterSecretLen);
       }
 
       //Release RSA private key
@@ -1759,13 +2384,13 @@ error_t tlsParseClientKeyParams(TlsContext *context,
 
       //Retrieve the latest version supported by the client. This is used
       //to detect version roll-back attacks
-      version = LOAD16BE(context->premasterSecret);
+      version = LOAD16BE(context->handshake->premasterSecret);
 
       //The best way to avoid vulnerability to the Bleichenbacher attack is to
       //treat incorrectly formatted messages in a manner indistinguishable from
       //correctly formatted RSA blocks
       bad = CRYPTO_TEST_NZ_32(error);
-      bad |= CRYPTO_TEST_NEQ_32(context->premasterSecretLen, 48);
+      bad |= CRYPTO_TEST_NEQ_32(context->handshake->premasterSecretLen, 48);
       bad |= CRYPTO_TEST_NEQ_16(version, context->clientVersion);
 
       //Generate a random 48-byte value
@@ -1776,12 +2401,13 @@ error_t tlsParseClientKeyParams(TlsContext *context,
       //proceed using the random 48-byte value as the premaster secret
       for(n = 0; n < 48; n++)
       {
-         context->premasterSecret[n] = CRYPTO_SELECT_8(
-            context->premasterSecret[n], randPremasterSecret[n], bad);
+         context->handshake->premasterSecret[n] = CRYPTO_SELECT_8(
+            context->handshake->premasterSecret[n], randPremasterSecret[n],
+            bad);
       }
 
       //Fix the length of the premaster secret
-      context->premasterSecretLen = 48;
+      context->handshake->premasterSecretLen = 48;
    }
    else
 #endif
@@ -1813,9 +2439,10 @@ error_t tlsParseClientKeyParams(TlsContext *context,
       if(!error)
       {
          //Calculate the negotiated key Z
+         TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
          error = dhComputeSharedSecret(&context->dhContext,
-            context->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
-            &context->premasterSecretLen);
+            context->handshake->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
+            &context->handshake->premasterSecretLen);
       }
 
       //Check status code
@@ -1823,9 +2450,9 @@ error_t tlsParseClientKeyParams(TlsContext *context,
       {
          //Leading bytes of Z that contain all zero bits are stripped before
          //it is used as the premaster secret (RFC 4346, section 8.2.1)
-         for(n = 0; n < context->premasterSecretLen; n++)
+         for(n = 0; n < context->handshake->premasterSecretLen; n++)
          {
-            if(context->premasterSecret[n] != 0x00)
+            if(context->handshake->premasterSecret[n] != 0x00)
                break;
          }
 
@@ -1833,11 +2460,12 @@ error_t tlsParseClientKeyParams(TlsContext *context,
          if(n > 0)
          {
             //Strip leading zero bytes from the negotiated key
-            memmove(context->premasterSecret, context->premasterSecret + n,
-               context->premasterSecretLen - n);
+            memmove(context->handshake->premasterSecret,
+               context->handshake->premasterSecret + n,
+               context->handshake->premasterSecretLen - n);
 
             //Adjust the length of the premaster secret
-            context->premasterSecretLen -= n;
+            context->handshake->premasterSecretLen -= n;
          }
       }
    }
@@ -1891,9 +2519,12 @@ error_t tlsParseClientKeyParams(TlsContext *context,
          {
             //Calculate the shared secret Z. Leading zeros found in this octet
             //string must not be truncated (see RFC 4492, section 5.10)
+            TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_START);
+            TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
             error = ecdhComputeSharedSecret(&context->ecdhContext,
-               context->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
-               &context->premasterSecretLen);
+               context->handshake->premasterSecret, TLS_PREMASTER_SECRET_SIZE,
+               &context->handshake->premasterSecretLen);
+            TLS_TRACE_HANDSHAKE(context, TLS_TRACE_EVENT_KEY_EXCHANGE_END);
          }
       }
    }
@@ -61,12 +61,23 @@ error_t tlsResumeServerSession(TlsContext *context, const uint8_t *sessionId,
    size_t sessionIdLen, const TlsCipherSuites *cipherSuites,
    const TlsHelloExtensions *extensions);
 
+error_t tlsResumeServerTicket(TlsContext *context, const uint8_t *sessionId,
+   size_t sessionIdLen, const TlsCipherSuites *cipherSuites,
+   const TlsHelloExtensions *extensions);
+
+error_t tlsGenerateTicket(TlsContext *context, uint8_t *ticket,
+   size_t *length);
+
 error_t tlsNegotiateVersion(TlsContext *context, uint16_t clientVersion,
    const TlsSupportedVersionList *supportedVersionList);
 
 error_t tlsNegotiateCipherSuite(TlsContext *context, const HashAlgo *hashAlgo,
    const TlsCipherSuites *cipherSuites, TlsHelloExtensions *extensions);
 
+error_t tlsNegotiateCipherSuiteFromTable(TlsContext *context,
+   const HashAlgo *hashAlgo, const TlsCipherSuites *cipherSuites,
+   const TlsHelloExtensions *extensions);
+
 error_t tlsSelectGroup(TlsContext *context,
    const TlsSupportedGroupList *groupList);
 
@@ -0,0 +1,693 @@
+/**
+ * @file tls_session_store.c
+ * @brief Client-side session store
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_session_store.h"
+#include "tls_misc.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CLIENT_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Client-side session store initialization
+ *
+ * The session store keeps the session IDs and the TLS 1.3 tickets received
+ * from the servers a client connects to, indexed by server name, port and
+ * list of ALPN protocols, so that subsequent connections to the same server
+ * resume automatically
+ *
+ * @param[in] size Maximum number of entries
+ * @param[in] maxTickets Maximum number of TLS 1.3 tickets kept per server
+ * @param[in] maxAge Maximum age of an entry, in milliseconds
+ * @return Handle referencing the fully initialized session store
+ **/
+
+TlsSessionStore *tlsInitSessionStore(uint_t size, uint_t maxTickets,
+   systime_t maxAge)
+{
+   size_t n;
+   TlsSessionStore *store;
+
+   //Make sure the parameters are acceptable
+   if(size < 1 || maxTickets < 1 || maxAge < 1000)
+      return NULL;
+
+   //Size of the memory required (the group hints follow the entries)
+   n = sizeof(TlsSessionStore) + size * sizeof(TlsSessionStoreEntry) +
+      size * sizeof(TlsGroupHint);
+
+   //Allocate a memory buffer to hold the session store
+   store = tlsAllocMem(n);
+   //Failed to allocate memory?
+   if(store == NULL)
+      return NULL;
+
+   //Clear memory
+   memset(store, 0, n);
+
+   //Create a mutex to prevent simultaneous access to the session store
+   if(!osCreateMutex(&store->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(store);
+      //Report an error
+      return NULL;
+   }
+
+   //Save parameters
+   store->size = size;
+   store->maxTickets = maxTickets;
+   store->maxAge = maxAge;
+   store->groupHints = (TlsGroupHint *) (store->entries + size);
+
+   //Return a pointer to the newly created session store
+   return store;
+}
+
+
+/**
+ * @brief Compute the hash of a session store key
+ * @param[in] serverName Fully qualified DNS hostname of the server
+ * @param[in] port Port number of the server
+ * @param[in] protocolList List of ALPN protocols offered by the client
+ * @return Hash value (FNV-1a)
+ **/
+
+uint32_t tlsComputeSessionStoreHash(const char_t *serverName, uint16_t port,
+   const char_t *protocolList)
+{
+   uint32_t h;
+
+   //Offset basis
+   h = 2166136261U;
+
+   //Digest the server name
+   while(serverName != NULL && *serverName != '\0')
+   {
+      h = (h ^ (uint8_t) *(serverName++)) * 16777619U;
+   }
+
+   //Digest the port number
+   h = (h ^ 0) * 16777619U;
+   h = (h ^ MSB(port)) * 16777619U;
+   h = (h ^ LSB(port)) * 16777619U;
+
+   //Digest the list of ALPN protocols
+   while(protocolList != NULL && *protocolList != '\0')
+   {
+      h = (h ^ (uint8_t) *(protocolList++)) * 16777619U;
+   }
+
+   //Return the resulting hash value
+   return h;
+}
+
+
+/**
+ * @brief Check whether an entry matches a given key
+ * @param[in] entry Pointer to the session store entry
+ * @param[in] hash Hash of the key
+ * @param[in] serverName Fully qualified DNS hostname of the server
+ * @param[in] port Port number of the server
+ * @param[in] protocolList List of ALPN protocols offered by the client
+ * @return TRUE if the entry matches the key, else FALSE
+ **/
+
+bool_t tlsMatchSessionStoreEntry(const TlsSessionStoreEntry *entry,
+   uint32_t hash, const char_t *serverName, uint16_t port,
+   const char_t *protocolList)
+{
+   //Empty entry?
+   if(entry->session.version == 0)
+      return FALSE;
+
+   //Compare hash values and port numbers first
+   if(entry->hash != hash || entry->port != port)
+      return FALSE;
+
+   //Compare server names
+   if(strcmp(entry->serverName, (serverName != NULL) ? serverName : ""))
+      return FALSE;
+
+   //Compare the lists of ALPN protocols
+   if(strcmp(entry->protocolList, (protocolList != NULL) ? protocolList : ""))
+      return FALSE;
+
+   //The entry matches the key
+   return TRUE;
+}
+
+
+/**
+ * @brief Offer the freshest session or ticket available for the server
+ *
+ * This function is called at the start of a handshake. It does nothing if
+ * the application has already restored a session by itself. TLS 1.3 tickets
+ * are single-use and are removed from the store as soon as they are taken
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsLoadFromSessionStore(TlsContext *context)
+{
+   error_t error;
+   uint_t i;
+   uint32_t hash;
+   systime_t time;
+   const char_t *protocolList;
+   TlsSessionStore *store;
+   TlsSessionStoreEntry *entry;
+   TlsSessionStoreEntry *freshest;
+
+   //Point to the session store
+   store = context->sessionStore;
+
+   //Session store not used?
+   if(store == NULL)
+      return NO_ERROR;
+
+   //Session already restored by the application?
+   if(context->sessionIdLen > 0)
+      return NO_ERROR;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Ticket already restored by the application?
+   if(context->ticketLen > 0)
+      return NO_ERROR;
+#endif
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //List of ALPN protocols offered by the client
+   protocolList = context->protocolList;
+#else
+   //ALPN is not supported
+   protocolList = NULL;
+#endif
+
+   //Compute the hash of the key
+   hash = tlsComputeSessionStoreHash(context->serverName, context->serverPort,
+      protocolList);
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Get current time
+   time = osGetSystemTime();
+   //Keep track of the freshest matching entry
+   freshest = NULL;
+
+   //Acquire exclusive access to the session store
+   osAcquireMutex(&store->mutex);
+
+   //Loop through the entries
+   for(i = 0; i < store->size; i++)
+   {
+      //Point to the current entry
+      entry = &store->entries[i];
+
+      //Skip empty entries
+      if(entry->session.version == 0)
+         continue;
+
+      //Evict entries by age
+      if((time - entry->session.timestamp) >= store->maxAge)
+      {
+         tlsFreeSessionStoreEntry(entry);
+         continue;
+      }
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //Evict TLS 1.3 tickets whose lifetime has expired
+      if(entry->session.version == TLS_VERSION_1_3 &&
+         (time - entry->session.ticketTimestamp) >=
+         (entry->session.ticketLifetime * 1000))
+      {
+         tlsFreeSessionStoreEntry(entry);
+         continue;
+      }
+#endif
+
+      //Check whether the entry matches the server
+      if(tlsMatchSessionStoreEntry(entry, hash, context->serverName,
+         context->serverPort, protocolList))
+      {
+         //Make sure the version is acceptable
+         if(entry->session.version >= context->versionMin &&
+            entry->session.version <= context->versionMax)
+         {
+            //Keep the most recent entry
+            if(freshest == NULL ||
+               timeCompare(entry->session.timestamp, freshest->session.timestamp) > 0)
+            {
+               freshest = entry;
+            }
+         }
+      }
+   }
+
+   //Any session available for the server?
+   if(freshest != NULL)
+   {
+      //Restore the session state
+      error = tlsRestoreSessionState(context, &freshest->session);
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+      //Clients should not reuse a ticket for multiple connections
+      if(freshest->session.version == TLS_VERSION_1_3)
+      {
+         tlsFreeSessionStoreEntry(freshest);
+      }
+#endif
+
+      //Update statistics
+      store->hitCount++;
+   }
+   else
+   {
+      //Update statistics
+      store->missCount++;
+   }
+
+   //Release exclusive access to the session store
+   osReleaseMutex(&store->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Save the current session or ticket in the session store
+ *
+ * A single session ID is kept per server, whereas up to maxTickets TLS 1.3
+ * tickets can be kept for the same server. When the store is full, the
+ * oldest entry is evicted
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsSaveToSessionStore(TlsContext *context)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint32_t hash;
+   const char_t *serverName;
+   const char_t *protocolList;
+   TlsSessionState session;
+   TlsSessionStore *store;
+   TlsSessionStoreEntry *entry;
+   TlsSessionStoreEntry *target;
+   TlsSessionStoreEntry *oldest;
+   TlsSessionStoreEntry *oldestTicket;
+
+   //Point to the session store
+   store = context->sessionStore;
+
+   //Session store not used?
+   if(store == NULL)
+      return NO_ERROR;
+
+   //Initialize session state
+   tlsInitSessionState(&session);
+
+   //Save the current session or ticket
+   error = tlsSaveSessionState(context, &session);
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Nothing to save?
+   if(session.version == 0)
+      return NO_ERROR;
+
+   //Retrieve the server name
+   serverName = (context->serverName != NULL) ? context->serverName : "";
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //List of ALPN protocols offered by the client
+   protocolList = (context->protocolList != NULL) ? context->protocolList : "";
+#else
+   //ALPN is not supported
+   protocolList = "";
+#endif
+
+   //Compute the hash of the key
+   hash = tlsComputeSessionStoreHash(serverName, context->serverPort,
+      protocolList);
+
+   //Initialize pointers
+   target = NULL;
+   oldest = NULL;
+   oldestTicket = NULL;
+   //Number of TLS 1.3 tickets kept for the server
+   n = 0;
+
+   //Acquire exclusive access to the session store
+   osAcquireMutex(&store->mutex);
+
+   //Loop through the entries
+   for(i = 0; i < store->size; i++)
+   {
+      //Point to the current entry
+      entry = &store->entries[i];
+
+      //Empty entry?
+      if(entry->session.version == 0)
+      {
+         //Remember the first free entry
+         if(target == NULL)
+            target = entry;
+
+         continue;
+      }
+
+      //Keep track of the oldest entry
+      if(oldest == NULL ||
+         timeCompare(entry->session.timestamp, oldest->session.timestamp) < 0)
+      {
+         oldest = entry;
+      }
+
+      //Check whether the entry matches the server
+      if(tlsMatchSessionStoreEntry(entry, hash, serverName,
+         context->serverPort, protocolList))
+      {
+         //TLS 1.3 ticket?
+         if(entry->session.version == TLS_VERSION_1_3)
+         {
+            //Keep track of the oldest ticket for the server
+            if(oldestTicket == NULL || timeCompare(entry->session.timestamp,
+               oldestTicket->session.timestamp) < 0)
+            {
+               oldestTicket = entry;
+            }
+
+            //Count the number of tickets kept for the server
+            n++;
+         }
+      }
+   }
+
+   //Check the version of the saved session
+   if(session.version == TLS_VERSION_1_3)
+   {
+      //Limit the number of tickets kept per server
+      if(n >= store->maxTickets)
+         target = oldestTicket;
+   }
+   else
+   {
+      //Only one session ID is kept per server
+      for(i = 0; i < store->size; i++)
+      {
+         //Point to the current entry
+         entry = &store->entries[i];
+
+         //Replace the previous session ID, if any
+         if(entry->session.version != TLS_VERSION_1_3 &&
+            tlsMatchSessionStoreEntry(entry, hash, serverName,
+            context->serverPort, protocolList))
+         {
+            target = entry;
+            break;
+         }
+      }
+   }
+
+   //The store is full?
+   if(target == NULL)
+      target = oldest;
+
+   //Release the previous contents of the entry
+   tlsFreeSessionStoreEntry(target);
+
+   //Allocate memory to hold the key
+   target->serverName = tlsAllocMem(strlen(serverName) + 1);
+   target->protocolList = tlsAllocMem(strlen(protocolList) + 1);
+
+   //Successful memory allocation?
+   if(target->serverName != NULL && target->protocolList != NULL)
+   {
+      //Save the key
+      target->hash = hash;
+      target->port = context->serverPort;
+      strcpy(target->serverName, serverName);
+      strcpy(target->protocolList, protocolList);
+
+      //The entry takes ownership of the session state
+      target->session = session;
+   }
+   else
+   {
+      //Clean up side effects
+      tlsFreeSessionStoreEntry(target);
+      tlsFreeSessionState(&session);
+      //Report an error
+      error = ERROR_OUT_OF_MEMORY;
+   }
+
+   //Release exclusive access to the session store
+   osReleaseMutex(&store->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Retrieve the named group the server selected last time
+ *
+ * Group hints are only keyed by a hash of the server name and port. A
+ * collision merely leads the ClientHello with a group the server does not
+ * prefer, which costs the HelloRetryRequest the hint was meant to avoid
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Named group (TLS_GROUP_NONE if no hint is available)
+ **/
+
+uint16_t tlsLoadGroupHint(TlsContext *context)
+{
+   uint_t i;
+   uint32_t hash;
+   uint16_t namedGroup;
+   TlsSessionStore *store;
+   TlsGroupHint *hint;
+
+   //Point to the session store
+   store = context->sessionStore;
+
+   //Session store not used?
+   if(store == NULL)
+      return TLS_GROUP_NONE;
+
+   //Compute the hash of the key
+   hash = tlsComputeSessionStoreHash(context->serverName, context->serverPort,
+      NULL);
+
+   //Initialize named group
+   namedGroup = TLS_GROUP_NONE;
+
+   //Acquire exclusive access to the session store
+   osAcquireMutex(&store->mutex);
+
+   //Loop through the group hints
+   for(i = 0; i < store->size; i++)
+   {
+      //Point to the current hint
+      hint = &store->groupHints[i];
+
+      //Matching hint?
+      if(hint->namedGroup != TLS_GROUP_NONE && hint->hash == hash)
+      {
+         //Discard stale hints
+         if((osGetSystemTime() - hint->timestamp) < store->maxAge)
+         {
+            namedGroup = hint->namedGroup;
+         }
+         else
+         {
+            hint->namedGroup = TLS_GROUP_NONE;
+         }
+
+         //We are done
+         break;
+      }
+   }
+
+   //Release exclusive access to the session store
+   osReleaseMutex(&store->mutex);
+
+   //Return the named group
+   return namedGroup;
+}
+
+
+/**
+ * @brief Remember the named group the server has selected
+ *
+ * This function is called when a TLS 1.3 handshake completes. Only the
+ * groups used for an (EC)DHE exchange are recorded. When all the hints are
+ * in use, the oldest one is replaced
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsSaveGroupHint(TlsContext *context)
+{
+   uint_t i;
+   uint32_t hash;
+   TlsSessionStore *store;
+   TlsGroupHint *hint;
+   TlsGroupHint *target;
+
+   //Point to the session store
+   store = context->sessionStore;
+
+   //Session store not used?
+   if(store == NULL)
+      return;
+
+   //PSK-only handshakes do not reveal the group preferred by the server
+   if(context->keyExchMethod != TLS13_KEY_EXCH_DHE &&
+      context->keyExchMethod != TLS13_KEY_EXCH_ECDHE &&
+      context->keyExchMethod != TLS13_KEY_EXCH_PSK_DHE &&
+      context->keyExchMethod != TLS13_KEY_EXCH_PSK_ECDHE)
+   {
+      return;
+   }
+
+   //Compute the hash of the key
+   hash = tlsComputeSessionStoreHash(context->serverName, context->serverPort,
+      NULL);
+
+   //Initialize pointer
+   target = NULL;
+
+   //Acquire exclusive access to the session store
+   osAcquireMutex(&store->mutex);
+
+   //Loop through the group hints
+   for(i = 0; i < store->size; i++)
+   {
+      //Point to the current hint
+      hint = &store->groupHints[i];
+
+      //Matching hint?
+      if(hint->namedGroup != TLS_GROUP_NONE && hint->hash == hash)
+      {
+         //Refresh the existing hint
+         target = hint;
+         break;
+      }
+
+      //Keep track of a free hint, or else of the oldest one
+      if(target == NULL || (target->namedGroup != TLS_GROUP_NONE &&
+         (hint->namedGroup == TLS_GROUP_NONE ||
+         timeCompare(hint->timestamp, target->timestamp) < 0)))
+      {
+         target = hint;
+      }
+   }
+
+   //Save the named group selected by the server
+   target->hash = hash;
+   target->timestamp = osGetSystemTime();
+   target->namedGroup = context->namedGroup;
+
+   //Release exclusive access to the session store
+   osReleaseMutex(&store->mutex);
+}
+
+
+/**
+ * @brief Release the contents of a session store entry
+ * @param[in] entry Pointer to the session store entry
+ **/
+
+void tlsFreeSessionStoreEntry(TlsSessionStoreEntry *entry)
+{
+   //Release the server name
+   if(entry->serverName != NULL)
+   {
+      tlsFreeMem(entry->serverName);
+   }
+
+   //Release the list of ALPN protocols
+   if(entry->protocolList != NULL)
+   {
+      tlsFreeMem(entry->protocolList);
+   }
+
+   //Release the session state
+   tlsFreeSessionState(&entry->session);
+
+   //Clear the entry
+   memset(entry, 0, sizeof(TlsSessionStoreEntry));
+}
+
+
+/**
+ * @brief Properly dispose a client-side session store
+ * @param[in] store Pointer to the session store
+ **/
+
+void tlsFreeSessionStore(TlsSessionStore *store)
+{
+   uint_t i;
+
+   //Valid session store?
+   if(store != NULL)
+   {
+      //Loop through the entries
+      for(i = 0; i < store->size; i++)
+      {
+         //Release the current entry
+         tlsFreeSessionStoreEntry(&store->entries[i]);
+      }
+
+      //Release the mutex
+      osDeleteMutex(&store->mutex);
+      //Release the session store
+      tlsFreeMem(store);
+   }
+}
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * @file tls_session_store.h
+ * @brief Client-side session store
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_SESSION_STORE_H
+#define _TLS_SESSION_STORE_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Client-side session store
+uint32_t tlsComputeSessionStoreHash(const char_t *serverName, uint16_t port,
+   const char_t *protocolList);
+
+bool_t tlsMatchSessionStoreEntry(const TlsSessionStoreEntry *entry,
+   uint32_t hash, const char_t *serverName, uint16_t port,
+   const char_t *protocolList);
+
+error_t tlsLoadFromSessionStore(TlsContext *context);
+error_t tlsSaveToSessionStore(TlsContext *context);
+
+uint16_t tlsLoadGroupHint(TlsContext *context);
+void tlsSaveGroupHint(TlsContext *context);
+
+void tlsFreeSessionStoreEntry(TlsSessionStoreEntry *entry);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
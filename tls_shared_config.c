@@ -0,0 +1,2743 @@
+/**
+ * @file tls_shared_config.c
+ * @brief Shared TLS configuration
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_stats.h"
+#include "tls_shared_config.h"
+#include "tls_cipher_suites.h"
+#include "tls_client_template.h"
+#include "tls_credential.h"
+#include "tls_extensions.h"
+#include "tls_trust_store.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a shared TLS configuration
+ *
+ * The configuration is populated once using the tlsConfigXxx() functions
+ * and then handed to tlsInitFromConfig(). It becomes immutable as soon as
+ * the first TLS context has been created from it, so that it can be shared
+ * by any number of connections without locking. Each TLS context receives
+ * a copy of its settings when it is created
+ *
+ * @return Handle referencing the newly created configuration
+ **/
+
+TlsConfig *tlsInitConfig(void)
+{
+   TlsConfig *config;
+
+   //Allocate a memory buffer to hold the configuration
+   config = tlsAllocMem(sizeof(TlsConfig));
+   //Failed to allocate memory?
+   if(config == NULL)
+      return NULL;
+
+   //Clear the configuration
+   memset(config, 0, sizeof(TlsConfig));
+
+   //Create a mutex to protect the reference counter
+   if(!osCreateMutex(&config->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(config);
+      //Report an error
+      return NULL;
+   }
+
+   //The caller holds the first reference
+   config->refCount = 1;
+
+   //Default transport protocol
+   config->transportProtocol = TLS_TRANSPORT_PROTOCOL_STREAM;
+   //Default operation mode
+   config->entity = TLS_CONNECTION_END_CLIENT;
+   //Default client authentication mode
+   config->clientAuthMode = TLS_CLIENT_AUTH_NONE;
+
+#if (TLS_DH_SUPPORT == ENABLED)
+   //Initialize Diffie-Hellman parameters
+   mpiInit(&config->dhParams.p);
+   mpiInit(&config->dhParams.g);
+#endif
+
+   //Minimum and maximum versions accepted by the implementation
+   config->versionMin = TLS_MIN_VERSION;
+   config->versionMax = TLS_MAX_VERSION;
+
+   //Maximum number of plaintext data the TX and RX buffers can hold
+   config->txBufferMaxLen = TLS_MAX_RECORD_LENGTH;
+   config->rxBufferMaxLen = TLS_MAX_RECORD_LENGTH;
+
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+   //Size of the per-handshake arena
+   config->handshakeArenaSize = TLS_HANDSHAKE_ARENA_SIZE;
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //The default named group is selected by tlsInit()
+   config->preferredGroup = TLS_GROUP_NONE;
+   //No speculative key share by default
+   config->speculativeGroup = TLS_GROUP_NONE;
+   //Number of NewSessionTicket messages sent by the server
+   config->newSessionTicketLimit = TLS13_NEW_SESSION_TICKET_COUNT;
+#endif
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   //Maximum fragment length
+   config->maxFragLen = TLS_MAX_RECORD_LENGTH;
+#endif
+
+#if (DTLS_SUPPORT == ENABLED)
+   //Default PMTU
+   config->pmtu = DTLS_DEFAULT_PMTU;
+   //Default timeout
+   config->timeout = INFINITE_DELAY;
+#endif
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   //Anti-replay mechanism is enabled by default
+   config->replayDetectionEnabled = TRUE;
+   //Default sliding window
+   config->replayWindowSize = DTLS_REPLAY_WINDOW_SIZE;
+#endif
+
+   //Return a pointer to the freshly created configuration
+   return config;
+}
+
+
+/**
+ * @brief Set the transport protocol to be used
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] transportProtocol Transport protocol to be used
+ * @return Error code
+ **/
+
+error_t tlsConfigSetTransportProtocol(TlsConfig *config,
+   TlsTransportProtocol transportProtocol)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(transportProtocol != TLS_TRANSPORT_PROTOCOL_STREAM &&
+      transportProtocol != TLS_TRANSPORT_PROTOCOL_DATAGRAM)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Set transport protocol
+   config->transportProtocol = transportProtocol;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set operation mode (client or server)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] entity Specifies whether this entity is considered a client or a server
+ * @return Error code
+ **/
+
+error_t tlsConfigSetConnectionEnd(TlsConfig *config, TlsConnectionEnd entity)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(entity != TLS_CONNECTION_END_CLIENT && entity != TLS_CONNECTION_END_SERVER)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check whether TLS operates as a client or a server
+   config->entity = entity;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the pseudo-random number generator to be used
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] prngAlgo PRNG algorithm
+ * @param[in] prngContext Pointer to the PRNG context
+ * @return Error code
+ **/
+
+error_t tlsConfigSetPrng(TlsConfig *config, const PrngAlgo *prngAlgo,
+   void *prngContext)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(prngAlgo == NULL || prngContext == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //PRNG algorithm that will be used to generate random numbers
+   config->prngAlgo = prngAlgo;
+   //PRNG context
+   config->prngContext = prngContext;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set minimum and maximum versions permitted
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] versionMin Minimum version accepted by the TLS implementation
+ * @param[in] versionMax Maximum version accepted by the TLS implementation
+ * @return Error code
+ **/
+
+error_t tlsConfigSetVersion(TlsConfig *config, uint16_t versionMin,
+   uint16_t versionMax)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(versionMin < TLS_MIN_VERSION || versionMax > TLS_MAX_VERSION)
+      return ERROR_INVALID_PARAMETER;
+   if(versionMin > versionMax)
+      return ERROR_INVALID_PARAMETER;
+
+   //Minimum version accepted by the implementation
+   config->versionMin = versionMin;
+   //Maximum version accepted by the implementation
+   config->versionMax = versionMax;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Specify the list of allowed cipher suites
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] cipherSuites List of allowed cipher suites (most preferred first)
+ * @param[in] length Number of cipher suites in the list
+ * @return Error code
+ **/
+
+error_t tlsConfigSetCipherSuites(TlsConfig *config,
+   const uint16_t *cipherSuites, uint_t length)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(cipherSuites == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Restrict the cipher suites that can be used
+   config->cipherSuites = cipherSuites;
+   config->numCipherSuites = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Define equal-preference groups in the list of allowed cipher suites
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] groups Array of flags, one per allowed cipher suite. A non-zero
+ *   value indicates that the cipher suite has the same preference as the
+ *   previous entry of the list
+ * @param[in] length Number of flags in the array
+ * @return Error code
+ **/
+
+error_t tlsConfigSetCipherSuiteGroups(TlsConfig *config,
+   const uint8_t *groups, uint_t length)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(groups == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save equal-preference groups
+   config->cipherSuiteGroups = groups;
+   config->numCipherSuiteGroups = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Specify the list of allowed ECDHE and FFDHE groups
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] groups List of named groups
+ * @param[in] length Number of named groups in the list
+ * @return Error code
+ **/
+
+error_t tlsConfigSetSupportedGroups(TlsConfig *config,
+   const uint16_t *groups, uint_t length)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(groups == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Restrict the named groups that can be used
+   config->supportedGroups = groups;
+   config->numSupportedGroups = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Specify the preferred ECDHE or FFDHE group
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] group Preferred ECDHE or FFDHE named group
+ * @return Error code
+ **/
+
+error_t tlsConfigSetPreferredGroup(TlsConfig *config, uint16_t group)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the preferred named group
+   config->preferredGroup = group;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Specify the ECDHE group of the speculative key share
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] group ECDHE named group (TLS_GROUP_NONE to disable the
+ *   speculative key share)
+ * @return Error code
+ **/
+
+error_t tlsConfigSetSpeculativeGroup(TlsConfig *config, uint16_t group)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the named group of the speculative key share
+   config->speculativeGroup = group;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Import Diffie-Hellman parameters
+ *
+ * The PEM structure is decoded once. The resulting parameters are copied to
+ * each TLS context created from the configuration
+ *
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] params PEM structure that holds Diffie-Hellman parameters
+ * @param[in] length Total length of the DER structure
+ * @return Error code
+ **/
+
+error_t tlsConfigSetDhParameters(TlsConfig *config, const char_t *params,
+   size_t length)
+{
+#if (TLS_DH_SUPPORT == ENABLED)
+   //Check parameters
+   if(config == NULL || (params == NULL && length != 0))
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Decode the PEM structure that holds Diffie-Hellman parameters
+   TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+   return pemImportDhParameters(params, length, &config->dhParams);
+#else
+   //Diffie-Hellman is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set client authentication mode (for servers only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] mode Client authentication mode
+ * @return Error code
+ **/
+
+error_t tlsConfigSetClientAuthMode(TlsConfig *config, TlsClientAuthMode mode)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save client authentication mode
+   config->clientAuthMode = mode;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set session cache
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] cache Session cache that will be used to save/resume TLS sessions
+ * @return Error code
+ **/
+
+error_t tlsConfigSetCache(TlsConfig *config, TlsCache *cache)
+{
+   //Check parameters
+   if(config == NULL || cache == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save session cache
+   config->cache = cache;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set client-side session store
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] store Session store created by tlsInitSessionStore()
+ * @return Error code
+ **/
+
+error_t tlsConfigSetSessionStore(TlsConfig *config, TlsSessionStore *store)
+{
+   //Check parameters
+   if(config == NULL || store == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save session store
+   config->sessionStore = store;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set TLS buffer size
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] txBufferSize TX buffer size
+ * @param[in] rxBufferSize RX buffer size
+ * @return Error code
+ **/
+
+error_t tlsConfigSetBufferSize(TlsConfig *config, size_t txBufferSize,
+   size_t rxBufferSize)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(txBufferSize < TLS_MIN_RECORD_LENGTH ||
+      rxBufferSize < TLS_MIN_RECORD_LENGTH)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Maximum number of plaintext data the TX and RX buffers can hold
+   config->txBufferMaxLen = txBufferSize;
+   config->rxBufferMaxLen = rxBufferSize;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the size of the per-handshake arena
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] size Size of the arena, in bytes (0 to disable the arena)
+ * @return Error code
+ **/
+
+error_t tlsConfigSetHandshakeArenaSize(TlsConfig *config, size_t size)
+{
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the size of the arena
+   config->handshakeArenaSize = size;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Per-handshake arena is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the pool the TX and RX buffers are taken from
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] bufferPool Pool created by tlsInitBufferPool()
+ * @return Error code
+ **/
+
+error_t tlsConfigSetBufferPool(TlsConfig *config, TlsBufferPool *bufferPool)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the pool
+   config->bufferPool = bufferPool;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the pool the ephemeral key pairs are taken from
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] keyPairPool Pool created by tlsInitKeyPairPool()
+ * @return Error code
+ **/
+
+error_t tlsConfigSetKeyPairPool(TlsConfig *config, TlsKeyPairPool *keyPairPool)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the pool
+   config->keyPairPool = keyPairPool;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release the TX/RX buffers of idle connections
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether idle buffers are released
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableBufferRelease(TlsConfig *config, bool_t enabled)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable buffer release mode
+   config->bufferReleaseEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Shrink the TX/RX buffers to the negotiated record size
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether the buffers are shrunk
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableBufferShrink(TlsConfig *config, bool_t enabled)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable buffer shrinking
+   config->bufferShrinkEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send pre-encoded ClientHello messages
+ *
+ * The first ClientHello sent by a TLS context created from the configuration
+ * is saved as a template. Subsequent connections copy the template and only
+ * patch the client random, the session ID and the key share. The template
+ * is bypassed (and a ClientHello is formatted from scratch) when resuming a
+ * session, when renegotiating, or when the server name or the key share
+ * group differs from the ones the template was built for. Other ClientHello
+ * parameters must not be overridden on the TLS contexts
+ *
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether template mode is enabled
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableClientHelloTemplate(TlsConfig *config, bool_t enabled)
+{
+#if (TLS_CLIENT_SUPPORT == ENABLED && TLS_CLIENT_HELLO_TEMPLATE_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable template mode
+   config->clientHelloTemplateEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set maximum fragment length
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] maxFragLen Maximum fragment length
+ * @return Error code
+ **/
+
+error_t tlsConfigSetMaxFragmentLength(TlsConfig *config, size_t maxFragLen)
+{
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Make sure the specified value is acceptable (ref to RFC 6066, section 4)
+   if(maxFragLen != 512 && maxFragLen != 1024 &&
+      maxFragLen != 2048 && maxFragLen != 4096 &&
+      maxFragLen != 16384)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Set maximum fragment length
+   config->maxFragLen = maxFragLen;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register ECDH key agreement callback function
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] ecdhCallback ECDH callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetEcdhCallback(TlsConfig *config,
+   TlsEcdhCallback ecdhCallback)
+{
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
+   //Check parameters
+   if(config == NULL || ecdhCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save ECDH key agreement callback function
+   config->ecdhCallback = ecdhCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //ECC callback functions are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register ECDSA signature generation callback function
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] ecdsaSignCallback ECDSA signature generation callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetEcdsaSignCallback(TlsConfig *config,
+   TlsEcdsaSignCallback ecdsaSignCallback)
+{
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
+   //Check parameters
+   if(config == NULL || ecdsaSignCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save ECDSA signature generation callback function
+   config->ecdsaSignCallback = ecdsaSignCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //ECC callback functions are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register ECDSA signature verification callback function
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] ecdsaVerifyCallback ECDSA signature verification callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetEcdsaVerifyCallback(TlsConfig *config,
+   TlsEcdsaVerifyCallback ecdsaVerifyCallback)
+{
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
+   //Check parameters
+   if(config == NULL || ecdsaVerifyCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save ECDSA signature verification callback function
+   config->ecdsaVerifyCallback = ecdsaVerifyCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //ECC callback functions are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register asynchronous signature generation callback function
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] asyncSignCallback Asynchronous signature generation callback function
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetAsyncSignCallback(TlsConfig *config,
+   TlsAsyncSignCallback asyncSignCallback, void *param)
+{
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   //Check parameters
+   if(config == NULL || asyncSignCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save asynchronous signature generation callback function
+   config->asyncSignCallback = asyncSignCallback;
+   config->asyncSignParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Asynchronous private key operations are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Specify the crypto providers to be used by the TLS contexts
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] providers List of crypto providers
+ * @param[in] numProviders Number of crypto providers in the list
+ * @return Error code
+ **/
+
+error_t tlsConfigSetCryptoProviders(TlsConfig *config,
+   const TlsCryptoProvider *const *providers, uint_t numProviders)
+{
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Check parameters
+   if(config == NULL || (providers == NULL && numProviders != 0))
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Make sure the list is not too long
+   if(numProviders > TLS_MAX_CRYPTO_PROVIDERS)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the list of crypto providers
+   for(i = 0; i < numProviders; i++)
+   {
+      config->cryptoProviders[i] = providers[i];
+   }
+
+   //Save the number of crypto providers
+   config->numCryptoProviders = numProviders;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Crypto providers are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register the key logging callback function (for debugging purpose only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] keyLogCallback Key logging callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetKeyLogCallback(TlsConfig *config,
+   TlsKeyLogCallback keyLogCallback)
+{
+#if (TLS_KEY_LOG_SUPPORT == ENABLED)
+   //Check parameters
+   if(config == NULL || keyLogCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save key logging callback function
+   config->keyLogCallback = keyLogCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Key logging is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register handshake trace callback function
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] traceCallback Handshake trace callback function
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetHandshakeTraceCallback(TlsConfig *config,
+   TlsHandshakeTraceCallback traceCallback, void *param)
+{
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the trace callback function
+   config->traceCallback = traceCallback;
+   config->traceParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Handshake tracing is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Allow unknown ALPN protocols
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] allowed Specifies whether unknown ALPN protocols are allowed
+ * @return Error code
+ **/
+
+error_t tlsConfigAllowUnknownAlpnProtocols(TlsConfig *config, bool_t allowed)
+{
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Allow or disallow unknown ALPN protocols
+   config->unknownProtocolsAllowed = allowed;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //ALPN is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the list of supported ALPN protocols
+ *
+ * The list is compiled once into the configuration (see
+ * tlsCompileAlpnList). The TLS contexts created from the configuration
+ * reference the compiled list instead of duplicating it
+ *
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] protocolList Comma-delimited list of supported protocols
+ * @return Error code
+ **/
+
+error_t tlsConfigSetAlpnProtocolList(TlsConfig *config,
+   const char_t *protocolList)
+{
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   error_t error;
+
+   //Check parameters
+   if(config == NULL || protocolList == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check whether the list of supported protocols has already been configured
+   if(config->alpnList != NULL)
+   {
+      //Release memory
+      tlsFreeAlpnList(config->alpnList);
+      config->alpnList = NULL;
+      config->protocolList = NULL;
+   }
+
+   //Check whether the list of protocols is valid
+   if(protocolList[0] != '\0')
+   {
+      //Compile the list of supported protocols
+      error = tlsCompileAlpnList(protocolList, &config->alpnList);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //The compiled list holds a copy of the comma-delimited list
+      config->protocolList = config->alpnList->protocolList;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //ALPN is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the PSK identity hint to be used by the server
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] pskIdentityHint NULL-terminated string that contains the PSK identity hint
+ * @return Error code
+ **/
+
+error_t tlsConfigSetPskIdentityHint(TlsConfig *config,
+   const char_t *pskIdentityHint)
+{
+#if (TLS_PSK_SUPPORT == ENABLED)
+   size_t length;
+
+   //Check parameters
+   if(config == NULL || pskIdentityHint == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Retrieve the length of the PSK identity hint
+   length = strlen(pskIdentityHint);
+
+   //Check whether the PSK identity hint has already been configured
+   if(config->pskIdentityHint != NULL)
+   {
+      //Release memory
+      tlsFreeMem(config->pskIdentityHint);
+      config->pskIdentityHint = NULL;
+   }
+
+   //Valid PSK identity hint?
+   if(length > 0)
+   {
+      //Allocate a memory block to hold the PSK identity hint
+      config->pskIdentityHint = tlsAllocMem(length + 1);
+      //Failed to allocate memory?
+      if(config->pskIdentityHint == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Save the PSK identity hint
+      strcpy(config->pskIdentityHint, pskIdentityHint);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //PSK key exchange is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register the PSK callback function
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] pskCallback PSK callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetPskCallback(TlsConfig *config, TlsPskCallback pskCallback)
+{
+#if (TLS_PSK_SUPPORT == ENABLED)
+   //Check parameters
+   if(config == NULL || pskCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the PSK callback function
+   config->pskCallback = pskCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //PSK key exchange is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register the raw public key verification callback function
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] rpkVerifyCallback RPK verification callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetRpkVerifyCallback(TlsConfig *config,
+   TlsRpkVerifyCallback rpkVerifyCallback)
+{
+#if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+   //Check parameters
+   if(config == NULL || rpkVerifyCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the raw public key verification callback function
+   config->rpkVerifyCallback = rpkVerifyCallback;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Raw public keys are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Import a trusted CA list
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] trustedCaList List of trusted CA (PEM format)
+ * @param[in] length Total length of the list
+ * @return Error code
+ **/
+
+error_t tlsConfigSetTrustedCaList(TlsConfig *config,
+   const char_t *trustedCaList, size_t length)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(trustedCaList == NULL && length != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the list of trusted CA
+   config->trustedCaList = trustedCaList;
+   config->trustedCaListLen = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Attach a pre-decoded trusted CA store to the configuration
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] trustStore Trusted CA store created by tlsInitTrustStore()
+ *   (NULL to detach the current store)
+ * @return Error code
+ **/
+
+error_t tlsConfigSetTrustStore(TlsConfig *config, TlsTrustStore *trustStore)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Release the previous store, if any
+   tlsFreeTrustStore(config->trustStore);
+   //Acquire a reference to the new store
+   config->trustStore = tlsReferenceTrustStore(trustStore);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Attach a certificate verification cache to the configuration
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] certVerifyCache Cache created by tlsInitCertVerifyCache()
+ *   (NULL to detach the current cache)
+ * @return Error code
+ **/
+
+error_t tlsConfigSetCertVerifyCache(TlsConfig *config,
+   TlsCertVerifyCache *certVerifyCache)
+{
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the certificate verification cache
+   config->certVerifyCache = certVerifyCache;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Certificate verification cache is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Attach a verification worker pool to the configuration
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] verifyPool Pool created by tlsInitVerifyPool()
+ *   (NULL to verify the chain on the handshake thread only)
+ * @return Error code
+ **/
+
+error_t tlsConfigSetVerifyPool(TlsConfig *config, TlsVerifyPool *verifyPool)
+{
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the verification worker pool
+   config->verifyPool = verifyPool;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Parallel chain verification is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Attach an OCSP response cache to the configuration
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] ocspCache Cache created by tlsInitOcspCache()
+ * @return Error code
+ **/
+
+error_t tlsConfigSetOcspCache(TlsConfig *config, TlsOcspCache *ocspCache)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the OCSP response cache
+   config->ocspCache = ocspCache;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //OCSP stapling is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Request the status of the server certificate (OCSP stapling)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether the client sends a StatusRequest
+ *   extension in its ClientHello
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableOcspStapling(TlsConfig *config, bool_t enabled)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable OCSP stapling
+   config->ocspStaplingEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //OCSP stapling is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register the stapled OCSP response callback function
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] ocspResponseCallback Stapled OCSP response callback function
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetOcspResponseCallback(TlsConfig *config,
+   TlsOcspResponseCallback ocspResponseCallback, void *param)
+{
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the callback function
+   config->ocspResponseCallback = ocspResponseCallback;
+   //This opaque pointer will be directly passed to the callback function
+   config->ocspResponseParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //OCSP stapling is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable TLS False Start
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether the client may send application data
+ *   before the server's Finished message has been received
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableFalseStart(TlsConfig *config, bool_t enabled)
+{
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable False Start
+   config->falseStartEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //False Start is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable TCP Fast Open integration
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether the first flight of the client is
+ *   handed to the transport with the TLS_FLAG_FAST_OPEN flag
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableFastOpen(TlsConfig *config, bool_t enabled)
+{
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable TCP Fast Open integration
+   config->fastOpenEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //TCP Fast Open integration is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Attach an SNI-indexed certificate store to the configuration
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] certStore Store created by tlsInitCertStore() (NULL to detach
+ *   the current store)
+ * @return Error code
+ **/
+
+error_t tlsConfigSetCertStore(TlsConfig *config, TlsCertStore *certStore)
+{
+#if (TLS_CERT_STORE_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the certificate store
+   config->certStore = certStore;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //SNI-indexed certificate store is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Add a credential to the configuration
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] credential Credential created by tlsInitCredential()
+ * @return Error code
+ **/
+
+error_t tlsConfigAddCredential(TlsConfig *config, TlsCredential *credential)
+{
+   //Check parameters
+   if(config == NULL || credential == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Make sure there is enough room to add the credential
+   if(config->numCredentials >= TLS_MAX_CERTIFICATES)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Acquire a reference to the credential
+   config->credentials[config->numCredentials++] =
+      tlsReferenceCredential(credential);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set certificate verification callback
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] certVerifyCallback Certificate verification callback
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsConfigSetCertificateVerifyCallback(TlsConfig *config,
+   TlsCertVerifyCallback certVerifyCallback, void *param)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save certificate verification callback
+   config->certVerifyCallback = certVerifyCallback;
+   //This opaque pointer will be directly passed to the callback function
+   config->certVerifyParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Enable secure renegotiation
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether secure renegotiation is allowed
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableSecureRenegotiation(TlsConfig *config, bool_t enabled)
+{
+#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable secure renegotiation
+   config->secureRenegoEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Secure renegotiation is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Perform fallback retry (for clients only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether FALLBACK_SCSV is enabled
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableFallbackScsv(TlsConfig *config, bool_t enabled)
+{
+#if (TLS_FALLBACK_SCSV_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable support for FALLBACK_SCSV
+   config->fallbackScsvEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set ticket encryption/decryption callbacks
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] ticketEncryptCallback Ticket encryption callback function
+ * @param[in] ticketDecryptCallback Ticket decryption callback function
+ * @param[in] param An opaque pointer passed to the callback functions
+ * @return Error code
+ **/
+
+error_t tlsConfigSetTicketCallbacks(TlsConfig *config,
+   TlsTicketEncryptCallback ticketEncryptCallback,
+   TlsTicketDecryptCallback ticketDecryptCallback, void *param)
+{
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save ticket encryption/decryption callback functions
+   config->ticketEncryptCallback = ticketEncryptCallback;
+   config->ticketDecryptCallback = ticketDecryptCallback;
+
+   //This opaque pointer will be directly passed to the callback functions
+   config->ticketParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session ticket mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Offer the SessionTicket extension (TLS 1.2)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether session tickets are requested
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableSessionTickets(TlsConfig *config, bool_t enabled)
+{
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable session tickets
+   config->sessionTicketEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session ticket mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register a certificate compression algorithm (RFC 8879)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] algorithm Compression algorithm (zlib, brotli or zstd)
+ * @param[in] compressCallback Compression callback function
+ * @param[in] decompressCallback Decompression callback function
+ * @param[in] param An opaque pointer passed to the callback functions
+ * @return Error code
+ **/
+
+error_t tlsConfigAddCertCompressionAlgo(TlsConfig *config,
+   TlsCertCompressionAlgo algorithm, TlsCertCompressCallback compressCallback,
+   TlsCertDecompressCallback decompressCallback, void *param)
+{
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   uint_t i;
+   TlsCertCompressionCodec *codec;
+
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(algorithm == TLS_CERT_COMPRESSION_NONE)
+      return ERROR_INVALID_PARAMETER;
+   if(compressCallback == NULL && decompressCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Loop through the registered codecs
+   for(i = 0; i < config->numCertCompressionCodecs; i++)
+   {
+      //Algorithm already registered?
+      if(config->certCompressionCodecs[i].algorithm == algorithm)
+         break;
+   }
+
+   //Make sure there is enough room to add the codec
+   if(i >= TLS_MAX_CERT_COMPRESSION_ALGOS)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Point to the codec
+   codec = &config->certCompressionCodecs[i];
+
+   //Save compression/decompression callback functions
+   codec->algorithm = algorithm;
+   codec->compressCallback = compressCallback;
+   codec->decompressCallback = decompressCallback;
+
+   //This opaque pointer will be directly passed to the callback functions
+   codec->param = param;
+
+   //New entry?
+   if(i >= config->numCertCompressionCodecs)
+      config->numCertCompressionCodecs++;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Certificate compression is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Register external session cache callbacks
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] getCallback Lookup callback function
+ * @param[in] putCallback Insertion callback function
+ * @param[in] deleteCallback Removal callback function
+ * @param[in] param An opaque pointer passed to the callback functions
+ * @return Error code
+ **/
+
+error_t tlsConfigSetExtCacheCallbacks(TlsConfig *config,
+   TlsExtCacheGetCallback getCallback, TlsExtCachePutCallback putCallback,
+   TlsExtCacheDeleteCallback deleteCallback, void *param)
+{
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save external session cache callback functions
+   config->extCacheGetCallback = getCallback;
+   config->extCachePutCallback = putCallback;
+   config->extCacheDeleteCallback = deleteCallback;
+
+   //This opaque pointer will be directly passed to the callback functions
+   config->extCacheParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session resumption is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set PMTU value (for DTLS only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] pmtu PMTU value
+ * @return Error code
+ **/
+
+error_t tlsConfigSetPmtu(TlsConfig *config, size_t pmtu)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Make sure the PMTU value is acceptable
+   if(pmtu < DTLS_MIN_PMTU)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save PMTU value
+   config->pmtu = pmtu;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Pack application data records into datagrams (for DTLS only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether record packing is enabled
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableRecordPacking(TlsConfig *config, bool_t enabled)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable record packing
+   config->recordPackingEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set timeout for blocking calls (for DTLS only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] timeout Maximum time to wait
+ * @return Error code
+ **/
+
+error_t tlsConfigSetTimeout(TlsConfig *config, systime_t timeout)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save timeout value
+   config->timeout = timeout;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set cookie generation/verification callbacks (for DTLS only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] cookieGenerateCallback Cookie generation callback function
+ * @param[in] cookieVerifyCallback Cookie verification callback function
+ * @param[in] param An opaque pointer passed to the callback functions
+ * @return Error code
+ **/
+
+error_t tlsConfigSetCookieCallbacks(TlsConfig *config,
+   DtlsCookieGenerateCallback cookieGenerateCallback,
+   DtlsCookieVerifyCallback cookieVerifyCallback, void *param)
+{
+#if (DTLS_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Check parameters
+   if(cookieGenerateCallback == NULL || cookieVerifyCallback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save cookie generation/verification callback functions
+   config->cookieGenerateCallback = cookieGenerateCallback;
+   config->cookieVerifyCallback = cookieVerifyCallback;
+
+   //This opaque pointer will be directly passed to the callback functions
+   config->cookieParam = param;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //DTLS is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable anti-replay mechanism (for DTLS only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether anti-replay protection is enabled
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableReplayDetection(TlsConfig *config, bool_t enabled)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable anti-replay mechanism
+   config->replayDetectionEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Anti-replay mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the size of the sliding window used for replay detection (for DTLS only)
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] size Number of records covered by the window
+ * @return Error code
+ **/
+
+error_t tlsConfigSetReplayWindowSize(TlsConfig *config, uint_t size)
+{
+#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the size of the window
+   if(size < 1 || size > DTLS_MAX_REPLAY_WINDOW_SIZE)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the size of the window
+   config->replayWindowSize = size;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Anti-replay mechanism is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Send the maximum amount of 0-RTT data the server can accept
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] maxEarlyDataSize Maximum amount of 0-RTT data that the client
+ *   is allowed to send
+ * @return Error code
+ **/
+
+error_t tlsConfigSetMaxEarlyDataSize(TlsConfig *config,
+   size_t maxEarlyDataSize)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the maximum amount of 0-RTT data that the client is allowed to send
+   config->maxEarlyDataSize = maxEarlyDataSize;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the 0-RTT anti-replay store
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] antiReplay Anti-replay store created by tlsInitAntiReplay()
+ * @return Error code
+ **/
+
+error_t tlsConfigSetAntiReplay(TlsConfig *config, TlsAntiReplay *antiReplay)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the anti-replay store
+   config->antiReplay = antiReplay;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the number of session tickets issued per connection
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] count Number of NewSessionTicket messages sent by the server
+ *   after the handshake (0 to disable the issuance of tickets)
+ * @return Error code
+ **/
+
+error_t tlsConfigSetNewSessionTicketCount(TlsConfig *config, uint_t count)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Save the number of NewSessionTicket messages to be sent
+   config->newSessionTicketLimit = count;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Defer the issuance of session tickets
+ * @param[in] config Pointer to the shared configuration
+ * @param[in] enabled Specifies whether the tickets are sent after the first
+ *   application data rather than right after the handshake
+ * @return Error code
+ **/
+
+error_t tlsConfigEnableDeferredTickets(TlsConfig *config, bool_t enabled)
+{
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration cannot be modified once it is in use
+   if(config->frozen)
+      return ERROR_WRONG_STATE;
+
+   //Enable or disable the deferred issuance of tickets
+   config->deferredTicketsEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Acquire a reference to a shared configuration
+ * @param[in] config Pointer to the shared configuration
+ * @return Pointer to the shared configuration
+ **/
+
+TlsConfig *tlsReferenceConfig(TlsConfig *config)
+{
+   //Valid configuration?
+   if(config != NULL)
+   {
+      //Acquire exclusive access to the reference counter
+      osAcquireMutex(&config->mutex);
+      //Increment the reference counter
+      config->refCount++;
+      //Release exclusive access to the reference counter
+      osReleaseMutex(&config->mutex);
+   }
+
+   //Return a pointer to the configuration
+   return config;
+}
+
+
+/**
+ * @brief Freeze a shared configuration
+ *
+ * The configuration can no longer be modified. The data derived from it
+ * are computed once, here, rather than when the first TLS context is
+ * created. This function is called implicitly by tlsCopyConfig() and
+ * tlsPublishConfig()
+ *
+ * @param[in] config Pointer to the shared configuration
+ * @return Error code
+ **/
+
+error_t tlsFreezeConfig(TlsConfig *config)
+{
+   //Invalid configuration?
+   if(config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the configuration
+   osAcquireMutex(&config->mutex);
+   //The configuration can no longer be modified
+   config->frozen = TRUE;
+
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+   //The cipher suite negotiation table is built once, when the configuration
+   //is frozen, and shared by all the TLS contexts
+   if(config->cipherSuiteTable == NULL)
+   {
+      config->cipherSuiteTable = tlsInitCipherSuiteTable(config->cipherSuites,
+         config->numCipherSuites, config->cipherSuiteGroups,
+         config->numCipherSuiteGroups);
+   }
+#endif
+
+   //Release exclusive access to the configuration
+   osReleaseMutex(&config->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Copy the settings of a shared configuration into a TLS context
+ *
+ * The configuration is frozen and its settings are copied into the TLS
+ * context, which is then independent of any later configuration slot
+ * update. Lists, strings, tables and credentials are owned by the
+ * configuration and are referenced, not duplicated, so the configuration
+ * outlives the TLS context (the context holds a reference to it)
+ *
+ * @param[in] context Pointer to a freshly initialized TLS context
+ * @param[in] config Pointer to the shared configuration
+ * @return Error code
+ **/
+
+error_t tlsCopyConfig(TlsContext *context, TlsConfig *config)
+{
+   error_t error;
+   uint_t i;
+
+   //Check parameters
+   if(context == NULL || config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The configuration can no longer be modified
+   tlsFreezeConfig(config);
+
+   //Save the configuration the TLS context has been created from
+   context->config = tlsReferenceConfig(config);
+
+   //Transport protocol and operation mode
+   context->transportProtocol = config->transportProtocol;
+   context->entity = config->entity;
+
+   //Pseudo-random number generator
+   context->prngAlgo = config->prngAlgo;
+   context->prngContext = config->prngContext;
+
+   //Minimum and maximum versions accepted by the implementation
+   context->versionMin = config->versionMin;
+   context->versionMax = config->versionMax;
+
+   //Default record layer version number
+   context->version = config->versionMin;
+   context->encryptionEngine.version = config->versionMin;
+
+   //Cipher suites and named groups that can be used
+   context->cipherSuites = config->cipherSuites;
+   context->numCipherSuites = config->numCipherSuites;
+   context->cipherSuiteGroups = config->cipherSuiteGroups;
+   context->numCipherSuiteGroups = config->numCipherSuiteGroups;
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+   context->cipherSuiteTable = config->cipherSuiteTable;
+#endif
+   context->supportedGroups = config->supportedGroups;
+   context->numSupportedGroups = config->numSupportedGroups;
+
+   //Client authentication mode, session cache and session store
+   context->clientAuthMode = config->clientAuthMode;
+   context->cache = config->cache;
+   context->sessionStore = config->sessionStore;
+
+   //TX/RX buffer management
+   context->bufferPool = config->bufferPool;
+   context->bufferReleaseEnabled = config->bufferReleaseEnabled;
+   context->bufferShrinkEnabled = config->bufferShrinkEnabled;
+
+   //Pre-generated ephemeral key pairs
+   context->keyPairPool = config->keyPairPool;
+
+   //Trusted CA list
+   context->trustedCaList = config->trustedCaList;
+   context->trustedCaListLen = config->trustedCaListLen;
+   context->trustStore = tlsReferenceTrustStore(config->trustStore);
+
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   //Cache of verified certificate signatures
+   context->certVerifyCache = config->certVerifyCache;
+#endif
+
+#if (TLS_VERIFY_POOL_SUPPORT == ENABLED)
+   //Verification worker pool
+   context->verifyPool = config->verifyPool;
+#endif
+
+#if (TLS_OCSP_STAPLING_SUPPORT == ENABLED)
+   //OCSP stapling
+   context->ocspCache = config->ocspCache;
+   context->ocspStaplingEnabled = config->ocspStaplingEnabled;
+   context->ocspResponseCallback = config->ocspResponseCallback;
+   context->ocspResponseParam = config->ocspResponseParam;
+#endif
+
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //TLS False Start
+   context->falseStartEnabled = config->falseStartEnabled;
+#endif
+
+#if (TLS_FAST_OPEN_SUPPORT == ENABLED)
+   //TCP Fast Open integration
+   context->fastOpenEnabled = config->fastOpenEnabled;
+#endif
+
+#if (TLS_CERT_STORE_SUPPORT == ENABLED)
+   //SNI-indexed certificate store
+   context->certStore = config->certStore;
+#endif
+
+   //Certificate verification callback
+   context->certVerifyCallback = config->certVerifyCallback;
+   context->certVerifyParam = config->certVerifyParam;
+
+#if (TLS_ECC_CALLBACK_SUPPORT == ENABLED)
+   //ECC callback functions
+   context->ecdhCallback = config->ecdhCallback;
+   context->ecdsaSignCallback = config->ecdsaSignCallback;
+   context->ecdsaVerifyCallback = config->ecdsaVerifyCallback;
+#endif
+
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   //Asynchronous signature generation callback
+   context->asyncSignCallback = config->asyncSignCallback;
+   context->asyncSignParam = config->asyncSignParam;
+#endif
+
+#if (TLS_CRYPTO_PROVIDER_SUPPORT == ENABLED)
+   //Crypto providers
+   memcpy(context->cryptoProviders, config->cryptoProviders,
+      sizeof(config->cryptoProviders));
+   context->numCryptoProviders = config->numCryptoProviders;
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //Override the default named group, if specified
+   if(config->preferredGroup != TLS_GROUP_NONE)
+   {
+      context->preferredGroup = config->preferredGroup;
+   }
+
+   //Named group of the speculative key share
+   context->speculativeGroup = config->speculativeGroup;
+
+   //Maximum amount of 0-RTT data that the client is allowed to send
+   context->maxEarlyDataSize = config->maxEarlyDataSize;
+   //0-RTT anti-replay store
+   context->antiReplay = config->antiReplay;
+
+   //Issuance of session tickets
+   context->newSessionTicketLimit = config->newSessionTicketLimit;
+   context->deferredTicketsEnabled = config->deferredTicketsEnabled;
+#endif
+
+#if (TLS_PSK_SUPPORT == ENABLED)
+   //The PSK identity hint is owned by the configuration
+   context->pskIdentityHint = config->pskIdentityHint;
+   context->pskCallback = config->pskCallback;
+#endif
+
+#if (TLS_MAX_FRAG_LEN_SUPPORT == ENABLED)
+   //Maximum fragment length
+   context->maxFragLen = config->maxFragLen;
+#endif
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //The list of ALPN protocols is owned by the configuration
+   context->unknownProtocolsAllowed = config->unknownProtocolsAllowed;
+   context->protocolList = config->protocolList;
+   context->alpnList = config->alpnList;
+#endif
+
+#if (TLS_RAW_PUBLIC_KEY_SUPPORT == ENABLED)
+   //Raw public key verification callback function
+   context->rpkVerifyCallback = config->rpkVerifyCallback;
+#endif
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Ticket encryption/decryption callback functions
+   context->ticketEncryptCallback = config->ticketEncryptCallback;
+   context->ticketDecryptCallback = config->ticketDecryptCallback;
+   context->ticketParam = config->ticketParam;
+#endif
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+   //SessionTicket extension (TLS 1.2)
+   context->sessionTicketEnabled = config->sessionTicketEnabled;
+#endif
+
+#if (TLS_CERT_COMPRESSION_SUPPORT == ENABLED)
+   //Certificate compression codecs
+   memcpy(context->certCompressionCodecs, config->certCompressionCodecs,
+      sizeof(context->certCompressionCodecs));
+   context->numCertCompressionCodecs = config->numCertCompressionCodecs;
+#endif
+
+#if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
+   //External session cache callback functions
+   context->extCacheGetCallback = config->extCacheGetCallback;
+   context->extCachePutCallback = config->extCachePutCallback;
+   context->extCacheDeleteCallback = config->extCacheDeleteCallback;
+   context->extCacheParam = config->extCacheParam;
+#endif
+
+#if (TLS_SECURE_RENEGOTIATION_SUPPORT == ENABLED)
+   //Secure renegotiation
+   context->secureRenegoEnabled = config->secureRenegoEnabled;
+#endif
+
+#if (TLS_FALLBACK_SCSV_SUPPORT == ENABLED)
+   //Support for FALLBACK_SCSV
+   context->fallbackScsvEnabled = config->fallbackScsvEnabled;
+#endif
+
+#if (TLS_KEY_LOG_SUPPORT == ENABLED)
+   //Key logging callback function
+   context->keyLogCallback = config->keyLogCallback;
+#endif
+
+#if (TLS_HANDSHAKE_TRACE_SUPPORT == ENABLED)
+   //Handshake trace callback function
+   context->traceCallback = config->traceCallback;
+   context->traceParam = config->traceParam;
+#endif
+
+#if (DTLS_SUPPORT == ENABLED)
+   //PMTU and timeout values
+   context->pmtu = config->pmtu;
+   context->timeout = config->timeout;
+   //Record packing
+   context->recordPackingEnabled = config->recordPackingEnabled;
+
+   //Cookie generation/verification callback functions
+   context->cookieGenerateCallback = config->cookieGenerateCallback;
+   context->cookieVerifyCallback = config->cookieVerifyCallback;
+   context->cookieParam = config->cookieParam;
+#endif
+
+#if (DTLS_SUPPORT == ENABLED && DTLS_REPLAY_DETECTION_SUPPORT == ENABLED)
+   //Anti-replay mechanism
+   context->replayDetectionEnabled = config->replayDetectionEnabled;
+
+   //Size of the sliding window
+   error = tlsSetReplayWindowSize(context, config->replayWindowSize);
+   //Any error to report?
+   if(error)
+      return error;
+#endif
+
+#if (TLS_HANDSHAKE_ARENA_SUPPORT == ENABLED)
+   //Size of the per-handshake arena
+   error = tlsSetHandshakeArenaSize(context, config->handshakeArenaSize);
+   //Any error to report?
+   if(error)
+      return error;
+#endif
+
+   //Size of the TX and RX buffers
+   error = tlsSetBufferSize(context, config->txBufferMaxLen,
+      config->rxBufferMaxLen);
+
+#if (TLS_DH_SUPPORT == ENABLED)
+   //Any Diffie-Hellman parameters?
+   if(!error && mpiGetBitLength(&config->dhParams.p) > 0)
+   {
+      //Copy the decoded prime modulus
+      error = mpiCopy(&context->dhContext.params.p, &config->dhParams.p);
+
+      //Check status code
+      if(!error)
+      {
+         //Copy the decoded generator
+         error = mpiCopy(&context->dhContext.params.g, &config->dhParams.g);
+      }
+   }
+#endif
+
+   //Loop through the credentials
+   for(i = 0; i < config->numCredentials && !error; i++)
+   {
+      //The certificate chains and private keys are shared, not re-parsed
+      error = tlsAddCredential(context, config->credentials[i]);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release a reference to a shared configuration
+ *
+ * The configuration is disposed when the last reference is released
+ *
+ * @param[in] config Pointer to the shared configuration
+ **/
+
+void tlsFreeConfig(TlsConfig *config)
+{
+   uint_t i;
+   uint_t refCount;
+
+   //Valid configuration?
+   if(config != NULL)
+   {
+      //Acquire exclusive access to the reference counter
+      osAcquireMutex(&config->mutex);
+      //Decrement the reference counter
+      refCount = --config->refCount;
+      //Release exclusive access to the reference counter
+      osReleaseMutex(&config->mutex);
+
+      //Last reference?
+      if(refCount == 0)
+      {
+         //Release the credentials
+         for(i = 0; i < config->numCredentials; i++)
+         {
+            tlsFreeCredential(config->credentials[i]);
+         }
+
+         //Release the trusted CA store
+         tlsFreeTrustStore(config->trustStore);
+
+#if (TLS_CIPHER_SUITE_TABLE_SUPPORT == ENABLED)
+         //Release the cipher suite negotiation table
+         tlsFreeCipherSuiteTable(config->cipherSuiteTable);
+#endif
+
+#if (TLS_CLIENT_SUPPORT == ENABLED && TLS_CLIENT_HELLO_TEMPLATE_SUPPORT == ENABLED)
+         //Release the pre-encoded ClientHello message
+         tlsFreeClientHelloTemplate(config->clientHelloTemplate);
+#endif
+
+#if (TLS_DH_SUPPORT == ENABLED)
+         //Release Diffie-Hellman parameters
+         mpiFree(&config->dhParams.p);
+         mpiFree(&config->dhParams.g);
+#endif
+
+#if (TLS_PSK_SUPPORT == ENABLED)
+         //Release the PSK identity hint
+         if(config->pskIdentityHint != NULL)
+         {
+            tlsFreeMem(config->pskIdentityHint);
+         }
+#endif
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+         //Release the list of supported ALPN protocols
+         tlsFreeAlpnList(config->alpnList);
+#endif
+
+         //Release mutex object
+         osDeleteMutex(&config->mutex);
+
+         //Properly dispose the configuration
+         memset(config, 0, sizeof(TlsConfig));
+         tlsFreeMem(config);
+      }
+   }
+}
+
+
+/**
+ * @brief Create a configuration slot
+ *
+ * A configuration slot is the publication point through which a server
+ * rotates its configuration (and the credentials it holds) without any
+ * downtime. New TLS contexts are created from the configuration currently
+ * published in the slot, while the contexts created from an older
+ * configuration keep their reference to it until they are released
+ *
+ * @param[in] config Initial configuration (optional parameter)
+ * @return Handle referencing the newly created configuration slot
+ **/
+
+TlsConfigSlot *tlsInitConfigSlot(TlsConfig *config)
+{
+   TlsConfigSlot *slot;
+
+   //Allocate a memory buffer to hold the configuration slot
+   slot = tlsAllocMem(sizeof(TlsConfigSlot));
+   //Failed to allocate memory?
+   if(slot == NULL)
+      return NULL;
+
+   //Clear memory
+   memset(slot, 0, sizeof(TlsConfigSlot));
+
+   //Create a mutex to protect the published configuration
+   if(!osCreateMutex(&slot->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(slot);
+      //Report an error
+      return NULL;
+   }
+
+   //Publish the initial configuration, if any
+   if(config != NULL)
+      tlsPublishConfig(slot, config);
+
+   //Return a pointer to the newly created configuration slot
+   return slot;
+}
+
+
+/**
+ * @brief Publish a new configuration
+ *
+ * The configuration is frozen and its derived data are computed before it
+ * becomes visible, so that no work is left to the handshakes that pick it
+ * up. The critical section only swaps a pointer. The slot holds its own
+ * reference to the configuration, and the reference to the previously
+ * published configuration is released once the swap is complete
+ *
+ * @param[in] slot Pointer to the configuration slot
+ * @param[in] config Configuration to be published
+ * @return Error code
+ **/
+
+error_t tlsPublishConfig(TlsConfigSlot *slot, TlsConfig *config)
+{
+   TlsConfig *oldConfig;
+
+   //Check parameters
+   if(slot == NULL || config == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Freeze the configuration before it is shared
+   tlsFreezeConfig(config);
+   //The slot holds a reference to the configuration
+   tlsReferenceConfig(config);
+
+   //Acquire exclusive access to the configuration slot
+   osAcquireMutex(&slot->mutex);
+
+   //Swap configurations
+   oldConfig = slot->config;
+   slot->config = config;
+   slot->generation++;
+
+   //Release exclusive access to the configuration slot
+   osReleaseMutex(&slot->mutex);
+
+   //The previous configuration is disposed as soon as the last TLS context
+   //created from it is released
+   tlsFreeConfig(oldConfig);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get the configuration currently published in a slot
+ * @param[in] slot Pointer to the configuration slot
+ * @return Reference to the configuration (to be released with
+ *   tlsFreeConfig), or NULL if no configuration has been published
+ **/
+
+TlsConfig *tlsAcquireConfig(TlsConfigSlot *slot)
+{
+   TlsConfig *config;
+
+   //Invalid configuration slot?
+   if(slot == NULL)
+      return NULL;
+
+   //Acquire exclusive access to the configuration slot
+   osAcquireMutex(&slot->mutex);
+   //Reference the published configuration
+   config = tlsReferenceConfig(slot->config);
+   //Release exclusive access to the configuration slot
+   osReleaseMutex(&slot->mutex);
+
+   //Return a pointer to the configuration
+   return config;
+}
+
+
+/**
+ * @brief Get the generation of a configuration slot
+ *
+ * The generation is incremented each time a configuration is published. It
+ * lets the application detect a reload without acquiring the configuration
+ *
+ * @param[in] slot Pointer to the configuration slot
+ * @return Number of configurations published so far
+ **/
+
+uint_t tlsGetConfigGeneration(TlsConfigSlot *slot)
+{
+   //Invalid configuration slot?
+   if(slot == NULL)
+      return 0;
+
+   //Return the current generation
+   return slot->generation;
+}
+
+
+/**
+ * @brief Release a configuration slot
+ *
+ * The TLS contexts created from the slot are not affected
+ *
+ * @param[in] slot Pointer to the configuration slot
+ **/
+
+void tlsFreeConfigSlot(TlsConfigSlot *slot)
+{
+   //Valid configuration slot?
+   if(slot != NULL)
+   {
+      //Release the reference to the published configuration
+      tlsFreeConfig(slot->config);
+
+      //Release mutex object
+      osDeleteMutex(&slot->mutex);
+
+      //Properly dispose the configuration slot
+      memset(slot, 0, sizeof(TlsConfigSlot));
+      tlsFreeMem(slot);
+   }
+}
+
+#endif
@@ -0,0 +1,661 @@
+/**
+ * @file tls_sign_engine.c
+ * @brief Signing engine shared by several TLS contexts
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_sign_engine.h"
+#include "tls_credential.h"
+#include "tls_misc.h"
+#include "pkc/rsa.h"
+#include "ecc/ecdsa.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a signing engine
+ *
+ * The signing engine collects the signature requests issued by several TLS
+ * contexts and processes them as a batch, either when the specified number
+ * of requests is reached or when the oldest request has been waiting for
+ * more than the latency bound. The engine is attached to a TLS context by
+ * registering tlsSignEngineCallback as asynchronous signature callback, with
+ * the engine as opaque parameter
+ *
+ * @param[in] prngAlgo Pseudo-random number generator used by RSA-PSS and ECDSA
+ * @param[in] prngContext Pseudo-random number generator context
+ * @param[in] batchSize Number of requests that triggers the processing of a batch
+ * @param[in] maxLatency Maximum time a request may wait in the queue, in milliseconds
+ * @return Handle referencing the newly created signing engine
+ **/
+
+TlsSignEngine *tlsInitSignEngine(const PrngAlgo *prngAlgo, void *prngContext,
+   uint_t batchSize, systime_t maxLatency)
+{
+   TlsSignEngine *engine;
+
+   //Check parameters
+   if(prngAlgo == NULL || prngContext == NULL || batchSize == 0)
+      return NULL;
+
+   //Allocate a memory buffer to hold the signing engine
+   engine = tlsAllocMem(sizeof(TlsSignEngine));
+   //Failed to allocate memory?
+   if(engine == NULL)
+      return NULL;
+
+   //Clear the signing engine
+   memset(engine, 0, sizeof(TlsSignEngine));
+
+   //Allocate the queue of pending requests
+   engine->queue = tlsAllocMem(batchSize * sizeof(TlsSignRequest));
+   //Failed to allocate memory?
+   if(engine->queue == NULL)
+   {
+      //Clean up side effects
+      tlsFreeMem(engine);
+      //Report an error
+      return NULL;
+   }
+
+   //Create a mutex to prevent simultaneous access to the queue
+   if(!osCreateMutex(&engine->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(engine->queue);
+      tlsFreeMem(engine);
+      //Report an error
+      return NULL;
+   }
+
+   //Save parameters
+   engine->prngAlgo = prngAlgo;
+   engine->prngContext = prngContext;
+   engine->batchSize = batchSize;
+   engine->maxLatency = maxLatency;
+
+   //Return a pointer to the newly created signing engine
+   return engine;
+}
+
+
+/**
+ * @brief Register completion notification callback function
+ *
+ * The callback is invoked once the signature has been posted to a TLS
+ * context, so that the application can resume the handshake by calling
+ * tlsConnect again
+ *
+ * @param[in] engine Pointer to the signing engine
+ * @param[in] notifyCallback Completion notification callback function
+ * @param[in] param An opaque pointer passed to the callback function
+ * @return Error code
+ **/
+
+error_t tlsSetSignEngineNotifyCallback(TlsSignEngine *engine,
+   TlsSignEngineNotifyCallback notifyCallback, void *param)
+{
+   //Invalid signing engine?
+   if(engine == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the signing engine
+   osAcquireMutex(&engine->mutex);
+
+   //Save the completion notification callback function
+   engine->notifyCallback = notifyCallback;
+   engine->notifyParam = param;
+
+   //Release exclusive access to the signing engine
+   osReleaseMutex(&engine->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Asynchronous signature callback queuing requests to the engine
+ * @param[in] context Pointer to the TLS context
+ * @param[in] signAlgo Signature algorithm
+ * @param[in] hashAlgo Hash algorithm
+ * @param[in] data Content covered by the signature
+ * @param[in] length Length of the content, in bytes
+ * @param[in] param Pointer to the signing engine
+ * @return Error code
+ **/
+
+error_t tlsSignEngineCallback(TlsContext *context, TlsSignatureAlgo signAlgo,
+   TlsHashAlgo hashAlgo, const uint8_t *data, size_t length, void *param)
+{
+   uint_t n;
+   TlsSignEngine *engine;
+   TlsSignRequest *request;
+   TlsSignRequest *batch;
+
+   //Point to the signing engine
+   engine = (TlsSignEngine *) param;
+
+   //Invalid signing engine?
+   if(engine == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The signing engine operates on pre-parsed credentials only
+   if(context->cert == NULL || context->cert->credential == NULL)
+      return ERROR_INVALID_KEY;
+
+   //Make sure the private key is available
+   if(!context->cert->credential->hasPrivateKey)
+      return ERROR_INVALID_KEY;
+
+   //Acquire exclusive access to the signing engine
+   osAcquireMutex(&engine->mutex);
+
+   //Point to the next free entry of the queue
+   request = &engine->queue[engine->queueLen];
+
+   //Allocate a memory buffer to hold the content to be signed
+   request->data = tlsAllocMem(length);
+
+   //Failed to allocate memory?
+   if(request->data == NULL)
+   {
+      //Release exclusive access to the signing engine
+      osReleaseMutex(&engine->mutex);
+      //Report an error
+      return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Save the parameters of the request
+   memcpy(request->data, data, length);
+   request->length = length;
+   request->context = context;
+   request->credential = tlsReferenceCredential(context->cert->credential);
+   request->signAlgo = signAlgo;
+   request->hashAlgo = hashAlgo;
+   request->timestamp = osGetSystemTime();
+
+   //Update the number of pending requests
+   engine->queueLen++;
+
+   //Enough requests to process a batch?
+   if(engine->queueLen >= engine->batchSize)
+   {
+      //Detach the pending requests from the queue
+      batch = tlsDetachSignBatch(engine, &n);
+   }
+   else
+   {
+      //Wait for more requests
+      batch = NULL;
+      n = 0;
+   }
+
+   //Release exclusive access to the signing engine
+   osReleaseMutex(&engine->mutex);
+
+   //The batch is processed outside of the critical section, so that other
+   //contexts can queue their requests in the meantime
+   if(batch != NULL)
+   {
+      tlsProcessSignBatch(engine, batch, n);
+      tlsFreeMem(batch);
+   }
+
+   //The result is posted asynchronously
+   return ERROR_WOULD_BLOCK;
+}
+
+
+/**
+ * @brief Process the pending requests whose latency bound has elapsed
+ *
+ * This function should be called periodically, from the event loop or from
+ * a dedicated crypto thread. The whole queue is processed as soon as the
+ * oldest request has been waiting for more than the latency bound
+ *
+ * @param[in] engine Pointer to the signing engine
+ * @return Error code
+ **/
+
+error_t tlsPollSignEngine(TlsSignEngine *engine)
+{
+   uint_t n;
+   systime_t time;
+   TlsSignRequest *batch;
+
+   //Invalid signing engine?
+   if(engine == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize pointer
+   batch = NULL;
+   n = 0;
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //Acquire exclusive access to the signing engine
+   osAcquireMutex(&engine->mutex);
+
+   //The requests are queued in chronological order
+   if(engine->queueLen > 0)
+   {
+      //Check whether the oldest request has been waiting for too long
+      if(timeCompare(time, engine->queue[0].timestamp +
+         engine->maxLatency) >= 0)
+      {
+         //Detach the pending requests from the queue
+         batch = tlsDetachSignBatch(engine, &n);
+      }
+   }
+
+   //Release exclusive access to the signing engine
+   osReleaseMutex(&engine->mutex);
+
+   //Process the batch
+   if(batch != NULL)
+   {
+      tlsProcessSignBatch(engine, batch, n);
+      tlsFreeMem(batch);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process all the pending requests immediately
+ * @param[in] engine Pointer to the signing engine
+ * @return Error code
+ **/
+
+error_t tlsFlushSignEngine(TlsSignEngine *engine)
+{
+   uint_t n;
+   TlsSignRequest *batch;
+
+   //Invalid signing engine?
+   if(engine == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the signing engine
+   osAcquireMutex(&engine->mutex);
+   //Detach the pending requests from the queue
+   batch = tlsDetachSignBatch(engine, &n);
+   //Release exclusive access to the signing engine
+   osReleaseMutex(&engine->mutex);
+
+   //Process the batch
+   if(batch != NULL)
+   {
+      tlsProcessSignBatch(engine, batch, n);
+      tlsFreeMem(batch);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Withdraw the requests queued on behalf of a given TLS context
+ *
+ * This function is called when the TLS context is released. Requests that
+ * have already been detached as part of a batch are not affected
+ *
+ * @param[in] engine Pointer to the signing engine
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsCancelSignRequests(TlsSignEngine *engine, TlsContext *context)
+{
+   uint_t i;
+   uint_t j;
+
+   //Valid signing engine?
+   if(engine != NULL)
+   {
+      //Acquire exclusive access to the signing engine
+      osAcquireMutex(&engine->mutex);
+
+      //Loop through the pending requests
+      for(i = 0, j = 0; i < engine->queueLen; i++)
+      {
+         //Matching TLS context?
+         if(engine->queue[i].context == context)
+         {
+            //Release the request
+            tlsFreeSignRequest(&engine->queue[i]);
+         }
+         else
+         {
+            //Keep the request, preserving the chronological order
+            engine->queue[j++] = engine->queue[i];
+         }
+      }
+
+      //Update the number of pending requests
+      engine->queueLen = j;
+
+      //Release exclusive access to the signing engine
+      osReleaseMutex(&engine->mutex);
+   }
+}
+
+
+/**
+ * @brief Detach the pending requests from the queue
+ *
+ * The caller must hold the mutex of the signing engine
+ *
+ * @param[in] engine Pointer to the signing engine
+ * @param[out] count Number of requests in the batch
+ * @return Pointer to the batch of requests
+ **/
+
+TlsSignRequest *tlsDetachSignBatch(TlsSignEngine *engine, uint_t *count)
+{
+   TlsSignRequest *batch;
+
+   //Initialize pointer
+   batch = NULL;
+   *count = 0;
+
+   //Any pending request?
+   if(engine->queueLen > 0)
+   {
+      //Allocate a memory buffer to hold the batch
+      batch = tlsAllocMem(engine->queueLen * sizeof(TlsSignRequest));
+
+      //Successful memory allocation?
+      if(batch != NULL)
+      {
+         //Move the pending requests to the batch
+         memcpy(batch, engine->queue, engine->queueLen * sizeof(TlsSignRequest));
+         *count = engine->queueLen;
+
+         //The queue is now empty
+         engine->queueLen = 0;
+      }
+   }
+
+   //Return a pointer to the batch
+   return batch;
+}
+
+
+/**
+ * @brief Process a batch of signature requests
+ *
+ * A single hash context is shared by all the requests of the batch, and the
+ * private keys are taken from the pre-decoded credentials
+ *
+ * @param[in] engine Pointer to the signing engine
+ * @param[in] batch Batch of requests
+ * @param[in] count Number of requests in the batch
+ **/
+
+void tlsProcessSignBatch(TlsSignEngine *engine, TlsSignRequest *batch,
+   uint_t count)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   HashContext *hashContext;
+   uint8_t signature[TLS_MAX_RSA_MODULUS_SIZE / 8];
+
+   //Allocate a hash context shared by the requests of the batch
+   hashContext = tlsAllocObject(TLS_MEM_CLASS_HASH_CONTEXT,
+      sizeof(HashContext));
+
+   //Loop through the requests
+   for(i = 0; i < count; i++)
+   {
+      //Successful memory allocation?
+      if(hashContext != NULL)
+      {
+         //Generate the signature
+         error = tlsSignEngineGenerateSignature(engine, hashContext,
+            &batch[i], signature, &n);
+      }
+      else
+      {
+         //Failed to allocate memory
+         error = ERROR_OUT_OF_MEMORY;
+         n = 0;
+      }
+
+      //Post the result to the TLS context
+      tlsPostAsyncSignResult(batch[i].context, error, signature, n);
+
+      //Notify the application that the handshake can be resumed
+      if(engine->notifyCallback != NULL)
+      {
+         engine->notifyCallback(batch[i].context, engine->notifyParam);
+      }
+
+      //Release the request
+      tlsFreeSignRequest(&batch[i]);
+   }
+
+   //Release the hash context
+   if(hashContext != NULL)
+   {
+      tlsFreeObject(TLS_MEM_CLASS_HASH_CONTEXT, hashContext);
+   }
+}
+
+
+/**
+ * @brief Generate the signature for a given request
+ * @param[in] engine Pointer to the signing engine
+ * @param[in] hashContext Hash context used to digest the content
+ * @param[in] request Signature request to be processed
+ * @param[out] signature Buffer where to store the resulting signature
+ * @param[out] signatureLen Length of the resulting signature
+ * @return Error code
+ **/
+
+error_t tlsSignEngineGenerateSignature(TlsSignEngine *engine,
+   HashContext *hashContext, const TlsSignRequest *request,
+   uint8_t *signature, size_t *signatureLen)
+{
+   error_t error;
+   const HashAlgo *hashAlgo;
+   TlsCredential *credential;
+
+   //Length of the signature
+   *signatureLen = 0;
+
+   //Point to the credential holding the private key
+   credential = request->credential;
+
+   //Retrieve the hash algorithm used for signing
+   if(request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256 ||
+      request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA256)
+   {
+      //The hashing is intrinsic to the signature algorithm
+      hashAlgo = tlsGetHashAlgo(TLS_HASH_ALGO_SHA256);
+   }
+   else if(request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384 ||
+      request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA384)
+   {
+      //The hashing is intrinsic to the signature algorithm
+      hashAlgo = tlsGetHashAlgo(TLS_HASH_ALGO_SHA384);
+   }
+   else if(request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512 ||
+      request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA512)
+   {
+      //The hashing is intrinsic to the signature algorithm
+      hashAlgo = tlsGetHashAlgo(TLS_HASH_ALGO_SHA512);
+   }
+   else
+   {
+      //Select the relevant hash algorithm
+      hashAlgo = tlsGetHashAlgo(request->hashAlgo);
+   }
+
+   //Make sure the hash algorithm is supported
+   if(hashAlgo == NULL)
+      return ERROR_UNSUPPORTED_SIGNATURE_ALGO;
+
+   //Digest the content covered by the signature
+   hashAlgo->init(hashContext);
+   hashAlgo->update(hashContext, request->data, request->length);
+   hashAlgo->final(hashContext, NULL);
+
+#if (TLS_RSA_SIGN_SUPPORT == ENABLED)
+   //RSA signature scheme?
+   if(request->signAlgo == TLS_SIGN_ALGO_RSA)
+   {
+      //Generate RSA signature (RSASSA-PKCS1-v1_5 signature scheme)
+      error = rsassaPkcs1v15Sign(&credential->rsaPrivateKey, hashAlgo,
+         hashContext->digest, signature, signatureLen);
+   }
+   else
+#endif
+#if (TLS_RSA_PSS_SIGN_SUPPORT == ENABLED)
+   //RSA-PSS signature scheme?
+   if(request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256 ||
+      request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384 ||
+      request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512 ||
+      request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA256 ||
+      request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA384 ||
+      request->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA512)
+   {
+      //Generate RSA signature (RSASSA-PSS signature scheme)
+      error = rsassaPssSign(engine->prngAlgo, engine->prngContext,
+         &credential->rsaPrivateKey, hashAlgo, hashAlgo->digestSize,
+         hashContext->digest, signature, signatureLen);
+   }
+   else
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+   //ECDSA signature scheme?
+   if(request->signAlgo == TLS_SIGN_ALGO_ECDSA)
+   {
+      EcdsaSignature ecdsaSignature;
+
+      //Initialize ECDSA signature
+      ecdsaInitSignature(&ecdsaSignature);
+
+      //Generate ECDSA signature
+      error = ecdsaGenerateSignature(engine->prngAlgo, engine->prngContext,
+         &credential->ecParams, &credential->ecPrivateKey, hashContext->digest,
+         hashAlgo->digestSize, &ecdsaSignature);
+
+      //Check status code
+      if(!error)
+      {
+         //Encode the resulting (R, S) integer pair using ASN.1
+         error = ecdsaWriteSignature(&ecdsaSignature, signature, signatureLen);
+      }
+
+      //Release previously allocated resources
+      ecdsaFreeSignature(&ecdsaSignature);
+   }
+   else
+#endif
+   //Invalid signature scheme?
+   {
+      //Report an error
+      error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release the resources held by a signature request
+ * @param[in] request Signature request
+ **/
+
+void tlsFreeSignRequest(TlsSignRequest *request)
+{
+   //Release the content to be signed
+   if(request->data != NULL)
+   {
+      tlsFreeMem(request->data);
+   }
+
+   //Release the reference to the credential
+   tlsFreeCredential(request->credential);
+
+   //Clear the request
+   memset(request, 0, sizeof(TlsSignRequest));
+}
+
+
+/**
+ * @brief Release signing engine
+ *
+ * The pending requests are discarded. The engine must not be released while
+ * TLS contexts are still using it
+ *
+ * @param[in] engine Pointer to the signing engine
+ **/
+
+void tlsFreeSignEngine(TlsSignEngine *engine)
+{
+   uint_t i;
+
+   //Valid signing engine?
+   if(engine != NULL)
+   {
+      //Discard the pending requests
+      for(i = 0; i < engine->queueLen; i++)
+      {
+         tlsFreeSignRequest(&engine->queue[i]);
+      }
+
+      //Release the queue
+      tlsFreeMem(engine->queue);
+      //Release previously allocated resources
+      osDeleteMutex(&engine->mutex);
+
+      //Clear the signing engine
+      memset(engine, 0, sizeof(TlsSignEngine));
+      //Release the signing engine
+      tlsFreeMem(engine);
+   }
+}
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file tls_sign_engine.h
+ * @brief Signing engine shared by several TLS contexts
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_SIGN_ENGINE_H
+#define _TLS_SIGN_ENGINE_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Signing engine management
+TlsSignEngine *tlsInitSignEngine(const PrngAlgo *prngAlgo, void *prngContext,
+   uint_t batchSize, systime_t maxLatency);
+
+error_t tlsSetSignEngineNotifyCallback(TlsSignEngine *engine,
+   TlsSignEngineNotifyCallback notifyCallback, void *param);
+
+error_t tlsSignEngineCallback(TlsContext *context, TlsSignatureAlgo signAlgo,
+   TlsHashAlgo hashAlgo, const uint8_t *data, size_t length, void *param);
+
+error_t tlsPollSignEngine(TlsSignEngine *engine);
+error_t tlsFlushSignEngine(TlsSignEngine *engine);
+
+void tlsCancelSignRequests(TlsSignEngine *engine, TlsContext *context);
+
+TlsSignRequest *tlsDetachSignBatch(TlsSignEngine *engine, uint_t *count);
+
+void tlsProcessSignBatch(TlsSignEngine *engine, TlsSignRequest *batch,
+   uint_t count);
+
+error_t tlsSignEngineGenerateSignature(TlsSignEngine *engine,
+   HashContext *hashContext, const TlsSignRequest *request,
+   uint8_t *signature, size_t *signatureLen);
+
+void tlsFreeSignRequest(TlsSignRequest *request);
+void tlsFreeSignEngine(TlsSignEngine *engine);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
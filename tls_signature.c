@@ -34,8 +34,10 @@
 //Dependencies
 #include <string.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_signature.h"
 #include "tls_transcript_hash.h"
+#include "tls_credential.h"
 #include "tls_misc.h"
 #include "pkix/pem_import.h"
 #include "pkc/rsa.h"
@@ -363,6 +365,9 @@ error_t tlsGenerateSignature(TlsContext *context, uint8_t *p,
    size_t n;
    TlsDigitalSignature *signature;
 
+   //Account for the public key operation
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+
    //The digitally-signed element does not convey the signature algorithm
    //to use, and hence implementations need to inspect the certificate to
    //find out the signature algorithm to use
@@ -373,6 +378,7 @@ error_t tlsGenerateSignature(TlsContext *context, uint8_t *p,
    if(context->cert->type == TLS_CERT_RSA_SIGN)
    {
       RsaPrivateKey privateKey;
+      const RsaPrivateKey *rsaPrivateKey;
 
       //Initialize RSA private key
       rsaInitPrivateKey(&privateKey);
@@ -393,16 +399,16 @@ error_t tlsGenerateSignature(TlsContext *context, uint8_t *p,
       //Check status code
       if(!error)
       {
-         //Decode the PEM structure that holds the RSA private key
-         error = pemImportRsaPrivateKey(context->cert->privateKey,
-            context->cert->privateKeyLen, &privateKey);
+         //Retrieve the RSA private key
+         error = tlsGetRsaPrivateKey(context->cert, &privateKey,
+            &rsaPrivateKey);
       }
 
       //Check status code
       if(!error)
       {
          //Generate an RSA signature using the client's private key
-         error = tlsGenerateRsaSignature(&privateKey,
+         error = tlsGenerateRsaSignature(rsaPrivateKey,
             context->clientVerifyData, signature->value, &n);
       }
 
@@ -481,6 +487,9 @@ error_t tlsVerifySignature(TlsContext *context, const uint8_t *p,
    error_t error;
    const TlsDigitalSignature *signature;
 
+   //Account for the public key operation
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+
    //The digitally-signed element does not convey the signature algorithm
    //to use, and hence implementations need to inspect the certificate to
    //find out the signature algorithm to use
@@ -585,6 +594,9 @@ error_t tls12GenerateSignature(TlsContext *context, uint8_t *p,
    Tls12DigitalSignature *signature;
    const HashAlgo *hashAlgo;
 
+   //Account for the public key operation
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+
    //Point to the digitally-signed element
    signature = (Tls12DigitalSignature *) p;
 
@@ -640,6 +652,7 @@ error_t tls12GenerateSignature(TlsContext *context, uint8_t *p,
       if(context->signAlgo == TLS_SIGN_ALGO_RSA)
       {
          RsaPrivateKey privateKey;
+         const RsaPrivateKey *rsaPrivateKey;
 
          //Initialize RSA private key
          rsaInitPrivateKey(&privateKey);
@@ -648,15 +661,15 @@ error_t tls12GenerateSignature(TlsContext *context, uint8_t *p,
          signature->algorithm.signature = TLS_SIGN_ALGO_RSA;
          signature->algorithm.hash = context->signHashAlgo;
 
-         //Decode the PEM structure that holds the RSA private key
-         error = pemImportRsaPrivateKey(context->cert->privateKey,
-            context->cert->privateKeyLen, &privateKey);
+         //Retrieve the RSA private key
+         error = tlsGetRsaPrivateKey(context->cert, &privateKey,
+            &rsaPrivateKey);
 
          //Check status code
          if(!error)
          {
             //Generate RSA signature (RSASSA-PKCS1-v1_5 signature scheme)
-            error = rsassaPkcs1v15Sign(&privateKey, hashAlgo,
+            error = rsassaPkcs1v15Sign(rsaPrivateKey, hashAlgo,
                context->clientVerifyData, signature->value, &n);
          }
 
@@ -675,6 +688,7 @@ error_t tls12GenerateSignature(TlsContext *context, uint8_t *p,
          context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA512)
       {
          RsaPrivateKey privateKey;
+         const RsaPrivateKey *rsaPrivateKey;
 
          //Initialize RSA private key
          rsaInitPrivateKey(&privateKey);
@@ -683,16 +697,16 @@ error_t tls12GenerateSignature(TlsContext *context, uint8_t *p,
          signature->algorithm.signature = context->signAlgo;
          signature->algorithm.hash = TLS_HASH_ALGO_INTRINSIC;
 
-         //Decode the PEM structure that holds the RSA private key
-         error = pemImportRsaPrivateKey(context->cert->privateKey,
-            context->cert->privateKeyLen, &privateKey);
+         //Retrieve the RSA private key
+         error = tlsGetRsaPrivateKey(context->cert, &privateKey,
+            &rsaPrivateKey);
 
          //Check status code
          if(!error)
          {
             //Generate RSA signature (RSASSA-PSS signature scheme)
             error = rsassaPssSign(context->prngAlgo, context->prngContext,
-               &privateKey, hashAlgo, hashAlgo->digestSize,
+               rsaPrivateKey, hashAlgo, hashAlgo->digestSize,
                context->clientVerifyData, signature->value, &n);
          }
 
@@ -765,6 +779,9 @@ error_t tls12VerifySignature(TlsContext *context, const uint8_t *p,
    const Tls12DigitalSignature *signature;
    const HashAlgo *hashAlgo;
 
+   //Account for the public key operation
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+
    //Point to the digitally-signed element
    signature = (Tls12DigitalSignature *) p;
 
@@ -1191,6 +1208,7 @@ error_t tlsGenerateDsaSignature(TlsContext *context, const uint8_t *digest,
 #if (TLS_DSA_SIGN_SUPPORT == ENABLED)
    error_t error;
    DsaPrivateKey privateKey;
+   const DsaPrivateKey *dsaPrivateKey;
    DsaSignature dsaSignature;
 
    //Initialize DSA private key
@@ -1198,16 +1216,15 @@ error_t tlsGenerateDsaSignature(TlsContext *context, const uint8_t *digest,
    //Initialize DSA signature
    dsaInitSignature(&dsaSignature);
 
-   //Decode the PEM structure that holds the DSA private key
-   error = pemImportDsaPrivateKey(context->cert->privateKey,
-      context->cert->privateKeyLen, &privateKey);
+   //Retrieve the DSA private key
+   error = tlsGetDsaPrivateKey(context->cert, &privateKey, &dsaPrivateKey);
 
    //Check status code
    if(!error)
    {
       //Generate DSA signature
       error = dsaGenerateSignature(context->prngAlgo, context->prngContext,
-         &privateKey, digest, digestLen, &dsaSignature);
+         dsaPrivateKey, digest, digestLen, &dsaSignature);
    }
 
    //Check status code
@@ -1311,30 +1328,24 @@ error_t tlsGenerateEcdsaSignature(TlsContext *context, const uint8_t *digest,
    {
       EcDomainParameters params;
       Mpi privateKey;
+      const EcDomainParameters *ecParams;
+      const Mpi *ecPrivateKey;
 
       //Initialize EC domain parameters
       ecInitDomainParameters(&params);
       //Initialize EC private key
       mpiInit(&privateKey);
 
-      //Decode the PEM structure that holds the EC domain parameters
-      error = pemImportEcParameters(context->cert->privateKey,
-         context->cert->privateKeyLen, &params);
-
-      //Check status code
-      if(!error)
-      {
-         //Decode the PEM structure that holds the EC private key
-         error = pemImportEcPrivateKey(context->cert->privateKey,
-            context->cert->privateKeyLen, &privateKey);
-      }
+      //Retrieve the EC domain parameters and the EC private key
+      error = tlsGetEcPrivateKey(context->cert, &params, &privateKey,
+         &ecParams, &ecPrivateKey);
 
       //Check status code
       if(!error)
       {
          //Generate ECDSA signature
          error = ecdsaGenerateSignature(context->prngAlgo, context->prngContext,
-            &params, &privateKey, digest, digestLen, &ecdsaSignature);
+            ecParams, ecPrivateKey, digest, digestLen, &ecdsaSignature);
       }
 
       //Release previously allocated resources
@@ -1444,48 +1455,68 @@ error_t tlsGenerateEddsaSignature(TlsContext *context, const uint8_t *message,
 {
 #if (TLS_EDDSA_SIGN_SUPPORT == ENABLED)
    error_t error;
+   const TlsCredential *credential;
+
+   //Point to the pre-parsed credential, if any
+   credential = context->cert->credential;
 
 #if (TLS_ED25519_SUPPORT == ENABLED)
    //Ed25519 elliptic curve?
    if(context->cert->type == TLS_CERT_ED25519_SIGN)
    {
       EddsaPrivateKey privateKey;
+      const EddsaPrivateKey *eddsaPrivateKey;
 
-      //Initialize EdDSA private key
-      eddsaInitPrivateKey(&privateKey);
-
-      //Decode the PEM structure that holds the EdDSA private key
-      error = pemImportEddsaPrivateKey(context->cert->privateKey,
-         context->cert->privateKeyLen, &privateKey);
-
-      //Check the length of the EdDSA private key
-      if(mpiGetByteLength(&privateKey.d) == ED25519_PRIVATE_KEY_LEN)
+      //Precomputed signing material available?
+      if(credential != NULL &&
+         credential->eddsaKeyLen == ED25519_PRIVATE_KEY_LEN)
       {
-         uint8_t d[ED25519_PRIVATE_KEY_LEN];
-
-         //Retrieve private key
-         error = mpiExport(&privateKey.d, d, ED25519_PRIVATE_KEY_LEN,
-            MPI_FORMAT_LITTLE_ENDIAN);
-
-         //Check status code
-         if(!error)
-         {
-            //Generate Ed25519 signature (PureEdDSA mode)
-            error = ed25519GenerateSignature(d, NULL, message, messageLen,
-               NULL, 0, 0, signature);
-         }
+         //Generate Ed25519 signature (PureEdDSA mode)
+         error = ed25519GenerateSignature(credential->eddsaSecretKey,
+            credential->eddsaPublicKey, message, messageLen, NULL, 0, 0,
+            signature);
 
          //Length of the resulting EdDSA signature
          *signatureLen = ED25519_SIGNATURE_LEN;
       }
       else
       {
-         //The length of the EdDSA private key is not valid
-         error = ERROR_INVALID_KEY;
-      }
+         //Initialize EdDSA private key
+         eddsaInitPrivateKey(&privateKey);
+
+         //Retrieve the EdDSA private key
+         error = tlsGetEddsaPrivateKey(context->cert, &privateKey,
+            &eddsaPrivateKey);
+
+         //Check the length of the EdDSA private key
+         if(mpiGetByteLength(&eddsaPrivateKey->d) == ED25519_PRIVATE_KEY_LEN)
+         {
+            uint8_t d[ED25519_PRIVATE_KEY_LEN];
+
+            //Retrieve private key
+            error = mpiExport(&eddsaPrivateKey->d, d, ED25519_PRIVATE_KEY_LEN,
+               MPI_FORMAT_LITTLE_ENDIAN);
+
+            //Check status code
+            if(!error)
+            {
+               //Generate Ed25519 signature (PureEdDSA mode)
+               error = ed25519GenerateSignature(d, NULL, message, messageLen,
+                  NULL, 0, 0, signature);
+            }
+
+            //Length of the resulting EdDSA signature
+            *signatureLen = ED25519_SIGNATURE_LEN;
+         }
+         else
+         {
+            //The length of the EdDSA private key is not valid
+            error = ERROR_INVALID_KEY;
+         }
 
-      //Free previously allocated resources
-      eddsaFreePrivateKey(&privateKey);
+         //Free previously allocated resources
+         eddsaFreePrivateKey(&privateKey);
+      }
    }
    else
 #endif
@@ -1494,42 +1525,58 @@ error_t tlsGenerateEddsaSignature(TlsContext *context, const uint8_t *message,
    if(context->cert->type == TLS_CERT_ED448_SIGN)
    {
       EddsaPrivateKey privateKey;
+      const EddsaPrivateKey *eddsaPrivateKey;
 
-      //Initialize EdDSA private key
-      eddsaInitPrivateKey(&privateKey);
-
-      //Decode the PEM structure that holds the EdDSA private key
-      error = pemImportEddsaPrivateKey(context->cert->privateKey,
-         context->cert->privateKeyLen, &privateKey);
-
-      //Check the length of the EdDSA private key
-      if(mpiGetByteLength(&privateKey.d) == ED448_PRIVATE_KEY_LEN)
+      //Precomputed signing material available?
+      if(credential != NULL &&
+         credential->eddsaKeyLen == ED448_PRIVATE_KEY_LEN)
       {
-         uint8_t d[ED448_PRIVATE_KEY_LEN];
-
-         //Retrieve private key
-         error = mpiExport(&privateKey.d, d, ED448_PRIVATE_KEY_LEN,
-            MPI_FORMAT_LITTLE_ENDIAN);
-
-         //Check status code
-         if(!error)
-         {
-            //Generate Ed448 signature (PureEdDSA mode)
-            error = ed448GenerateSignature(d, NULL, message, messageLen,
-               NULL, 0, 0, signature);
-         }
+         //Generate Ed448 signature (PureEdDSA mode)
+         error = ed448GenerateSignature(credential->eddsaSecretKey,
+            credential->eddsaPublicKey, message, messageLen, NULL, 0, 0,
+            signature);
 
          //Length of the resulting EdDSA signature
          *signatureLen = ED448_SIGNATURE_LEN;
       }
       else
       {
-         //The length of the EdDSA private key is not valid
-         error = ERROR_INVALID_KEY;
-      }
+         //Initialize EdDSA private key
+         eddsaInitPrivateKey(&privateKey);
+
+         //Retrieve the EdDSA private key
+         error = tlsGetEddsaPrivateKey(context->cert, &privateKey,
+            &eddsaPrivateKey);
 
-      //Free previously allocated resources
-      eddsaFreePrivateKey(&privateKey);
+         //Check the length of the EdDSA private key
+         if(mpiGetByteLength(&eddsaPrivateKey->d) == ED448_PRIVATE_KEY_LEN)
+         {
+            uint8_t d[ED448_PRIVATE_KEY_LEN];
+
+            //Retrieve private key
+            error = mpiExport(&eddsaPrivateKey->d, d, ED448_PRIVATE_KEY_LEN,
+               MPI_FORMAT_LITTLE_ENDIAN);
+
+            //Check status code
+            if(!error)
+            {
+               //Generate Ed448 signature (PureEdDSA mode)
+               error = ed448GenerateSignature(d, NULL, message, messageLen,
+                  NULL, 0, 0, signature);
+            }
+
+            //Length of the resulting EdDSA signature
+            *signatureLen = ED448_SIGNATURE_LEN;
+         }
+         else
+         {
+            //The length of the EdDSA private key is not valid
+            error = ERROR_INVALID_KEY;
+         }
+
+         //Free previously allocated resources
+         eddsaFreePrivateKey(&privateKey);
+      }
    }
    else
 #endif
@@ -1636,4 +1683,132 @@ error_t tlsVerifyEddsaSignature(TlsContext *context, const uint8_t *message,
 #endif
 }
 
+
+/**
+ * @brief Asynchronous signature generation
+ *
+ * The content covered by the signature is handed over to the application
+ * through the asynchronous signature callback. ERROR_WOULD_BLOCK is returned
+ * as long as the result has not been posted, so that the calling state
+ * can be re-entered later on
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Content covered by the signature
+ * @param[in] length Length of the content, in bytes
+ * @param[out] algorithm Signature algorithm and hash algorithm
+ * @param[out] signature Buffer where to store the resulting signature
+ * @param[out] signatureLen Length of the resulting signature
+ * @return Error code
+ **/
+
+error_t tlsGenerateAsyncSignature(TlsContext *context, const uint8_t *data,
+   size_t length, TlsSignHashAlgo *algorithm, uint8_t *signature,
+   size_t *signatureLen)
+{
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   error_t error;
+   TlsHashAlgo hashAlgo;
+
+   //Make sure the callback function has been registered
+   if(context->asyncSignCallback == NULL)
+      return ERROR_FAILURE;
+
+   //RSA-PSS and EdDSA signature schemes have an intrinsic hash algorithm
+   if(context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256 ||
+      context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384 ||
+      context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512 ||
+      context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA256 ||
+      context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA384 ||
+      context->signAlgo == TLS_SIGN_ALGO_RSA_PSS_PSS_SHA512 ||
+      context->signAlgo == TLS_SIGN_ALGO_ED25519 ||
+      context->signAlgo == TLS_SIGN_ALGO_ED448)
+   {
+      hashAlgo = TLS_HASH_ALGO_INTRINSIC;
+   }
+   else
+   {
+      hashAlgo = context->signHashAlgo;
+   }
+
+   //No signature operation in progress?
+   if(context->asyncSignState == TLS_ASYNC_SIGN_STATE_IDLE)
+   {
+      //The operation is pending until the application posts the result
+      context->asyncSignState = TLS_ASYNC_SIGN_STATE_PENDING;
+
+      //Invoke user callback function
+      error = context->asyncSignCallback(context, context->signAlgo,
+         hashAlgo, data, length, context->asyncSignParam);
+
+      //The callback function may post the result synchronously
+      if(error != NO_ERROR && error != ERROR_WOULD_BLOCK)
+      {
+         //Release the state of the signature operation
+         tlsFreeAsyncSign(context);
+         //Report an error
+         return error;
+      }
+   }
+
+   //The result has not been posted yet?
+   if(context->asyncSignState == TLS_ASYNC_SIGN_STATE_PENDING)
+      return ERROR_WOULD_BLOCK;
+
+   //Retrieve the status of the signature operation
+   error = context->asyncSignStatus;
+
+   //Check status code
+   if(!error)
+   {
+      //Set the relevant signature algorithm
+      algorithm->signature = context->signAlgo;
+      algorithm->hash = hashAlgo;
+
+      //Copy the resulting signature
+      memcpy(signature, context->asyncSignResult, context->asyncSignResultLen);
+      *signatureLen = context->asyncSignResultLen;
+   }
+
+   //The signature operation is complete
+   tlsFreeAsyncSign(context);
+
+   //Return status code
+   return error;
+#else
+   //Asynchronous private key operations are not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Release the state of the asynchronous signature operation
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsFreeAsyncSign(TlsContext *context)
+{
+#if (TLS_ASYNC_SIGN_SUPPORT == ENABLED)
+   //Release the posted signature
+   if(context->asyncSignResult != NULL)
+   {
+      tlsFreeMem(context->asyncSignResult);
+      context->asyncSignResult = NULL;
+   }
+
+   //Release the saved handshake message
+   if(context->asyncSignMessage != NULL)
+   {
+      tlsFreeMem(context->asyncSignMessage);
+      context->asyncSignMessage = NULL;
+   }
+
+   //Reset state
+   context->asyncSignResultLen = 0;
+   context->asyncSignMessageLen = 0;
+   context->asyncSignStatus = NO_ERROR;
+   context->asyncSignState = TLS_ASYNC_SIGN_STATE_IDLE;
+#endif
+}
+
 #endif
@@ -79,6 +79,12 @@ error_t tlsGenerateEddsaSignature(TlsContext *context, const uint8_t *message,
 error_t tlsVerifyEddsaSignature(TlsContext *context, const uint8_t *message,
    size_t messageLen, const uint8_t *signature, size_t signatureLen);
 
+error_t tlsGenerateAsyncSignature(TlsContext *context, const uint8_t *data,
+   size_t length, TlsSignHashAlgo *algorithm, uint8_t *signature,
+   size_t *signatureLen);
+
+void tlsFreeAsyncSign(TlsContext *context);
+
 //C++ guard
 #ifdef __cplusplus
 }
@@ -0,0 +1,468 @@
+/**
+ * @file tls_stats.c
+ * @brief TLS statistics
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_stats.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_STATS_SUPPORT == ENABLED)
+
+//Shards of the global statistics
+static TlsGlobalStats tlsGlobalStats[TLS_STATS_NUM_SHARDS];
+//Index of the shard assigned to the next TLS context
+static uint_t tlsNextStatsShard;
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+//Counters of the handshake in progress on the calling thread
+TLS_THREAD_LOCAL TlsHandshakeCounters *tlsHandshakeCounters = NULL;
+#endif
+
+
+/**
+ * @brief Initialize the statistics of a TLS context
+ *
+ * Each context is bound to one shard of the global statistics, so that
+ * contexts driven by different threads seldom update the same counters. The
+ * counters are updated without any lock, hence the global figures are
+ * approximate under heavy concurrency
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsInitContextStats(TlsContext *context)
+{
+   //Clear per-context statistics
+   memset(&context->stats, 0, sizeof(TlsContextStats));
+
+   //Assign a shard in a round-robin fashion
+   context->statsShard = &tlsGlobalStats[tlsNextStatsShard++ %
+      TLS_STATS_NUM_SHARDS];
+}
+
+
+/**
+ * @brief Record the start of a handshake
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsStatsHandshakeStarted(TlsContext *context)
+{
+   //Save the time at which the handshake started
+   context->stats.handshakeStart = osGetSystemTime();
+   //No HelloRetryRequest has been exchanged yet
+   context->stats.helloRetry = FALSE;
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //Clear the resources charged to the previous handshake
+   memset(&context->stats.handshakeCounters, 0, sizeof(TlsHandshakeCounters));
+#endif
+}
+
+
+/**
+ * @brief Record the completion of a handshake
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsStatsHandshakeCompleted(TlsContext *context)
+{
+   TlsGlobalStats *shard;
+   TlsResumptionType resumptionType;
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   TlsHandshakeType handshakeType;
+#endif
+
+   //Point to the shard bound to the context
+   shard = context->statsShard;
+
+   //Duration of the handshake
+   context->stats.handshakeDuration = osGetSystemTime() -
+      context->stats.handshakeStart;
+
+   //Full handshake by default
+   resumptionType = TLS_RESUMPTION_NONE;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //TLS 1.3 currently selected?
+   if(context->version == TLS_VERSION_1_3)
+   {
+      //PSK-based key exchange?
+      if(context->keyExchMethod == TLS13_KEY_EXCH_PSK ||
+         context->keyExchMethod == TLS13_KEY_EXCH_PSK_DHE ||
+         context->keyExchMethod == TLS13_KEY_EXCH_PSK_ECDHE)
+      {
+         resumptionType = TLS_RESUMPTION_PSK;
+      }
+   }
+   else
+#endif
+   {
+      //Abbreviated handshake?
+      if(context->resume)
+         resumptionType = TLS_RESUMPTION_SESSION_ID;
+
+#if (TLS12_TICKET_SUPPORT == ENABLED)
+      //Session resumed using a session ticket?
+      if(context->ticketResume)
+         resumptionType = TLS_RESUMPTION_TICKET;
+#endif
+   }
+
+   //Save the resumption type
+   context->stats.resumptionType = resumptionType;
+
+   //Update global counters
+   shard->handshakes++;
+   shard->handshakesByResumption[resumptionType]++;
+
+   //Handshakes by version
+   if(context->version >= SSL_VERSION_3_0 && context->version <= TLS_VERSION_1_3)
+      shard->handshakesByVersion[context->version - SSL_VERSION_3_0]++;
+
+   //Handshakes by cipher suite
+   tlsStatsIncEntry(shard->handshakesByCipherSuite, TLS_STATS_MAX_CIPHER_SUITES,
+      context->cipherSuite.identifier, &shard->otherCipherSuites);
+
+   //Handshakes by named group
+   if(context->namedGroup != TLS_GROUP_NONE)
+   {
+      tlsStatsIncEntry(shard->handshakesByGroup, TLS_STATS_MAX_GROUPS,
+         context->namedGroup, &shard->otherGroups);
+   }
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //A HelloRetryRequest adds a round trip and a second ClientHello, whatever
+   //the key exchange
+   if(context->stats.helloRetry)
+      handshakeType = TLS_HANDSHAKE_TYPE_HRR;
+   else if(resumptionType == TLS_RESUMPTION_PSK)
+      handshakeType = TLS_HANDSHAKE_TYPE_PSK;
+   else if(resumptionType != TLS_RESUMPTION_NONE)
+      handshakeType = TLS_HANDSHAKE_TYPE_RESUMED;
+   else
+      handshakeType = TLS_HANDSHAKE_TYPE_FULL;
+
+   //Resources used by the handshakes, by handshake type
+   shard->handshakesByType[handshakeType]++;
+   tlsStatsMergeCounters(&shard->countersByType[handshakeType],
+      &context->stats.handshakeCounters);
+#endif
+}
+
+
+/**
+ * @brief Charge the events of the calling thread to a TLS context
+ *
+ * Allocations and crypto operations performed by the calling thread are
+ * attributed to the handshake of the context until tlsStatsLeaveHandshake
+ * is called. Events that occur outside any handshake step (credential
+ * loading, background key generation) are not charged to any context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Counters that were active before the call
+ **/
+
+TlsHandshakeCounters *tlsStatsEnterHandshake(TlsContext *context)
+{
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //Charge subsequent events to the context
+   return tlsStatsEnterCounters(&context->stats.handshakeCounters);
+#else
+   //Handshake accounting is not implemented
+   return NULL;
+#endif
+}
+
+
+/**
+ * @brief Charge the events of the calling thread to a set of counters
+ *
+ * Work done on behalf of a handshake by another thread is charged to
+ * private counters, which the handshake thread adds to its own ones later
+ *
+ * @param[in] counters Counters the events are charged to
+ * @return Counters that were active before the call
+ **/
+
+TlsHandshakeCounters *tlsStatsEnterCounters(TlsHandshakeCounters *counters)
+{
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   TlsHandshakeCounters *prevCounters;
+
+   //Save the counters that were active
+   prevCounters = tlsHandshakeCounters;
+   //Charge subsequent events to the specified counters
+   tlsHandshakeCounters = counters;
+
+   //Return the previous counters
+   return prevCounters;
+#else
+   //Handshake accounting is not implemented
+   return NULL;
+#endif
+}
+
+
+/**
+ * @brief Stop charging the events of the calling thread to a TLS context
+ * @param[in] counters Counters returned by tlsStatsEnterHandshake
+ **/
+
+void tlsStatsLeaveHandshake(TlsHandshakeCounters *counters)
+{
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //Restore the counters that were active
+   tlsHandshakeCounters = counters;
+#endif
+}
+
+
+/**
+ * @brief Sum up handshake counters
+ * @param[in,out] counters Aggregated counters
+ * @param[in] shardCounters Counters to be added
+ **/
+
+void tlsStatsMergeCounters(TlsHandshakeCounters *counters,
+   const TlsHandshakeCounters *shardCounters)
+{
+   counters->allocCount += shardCounters->allocCount;
+   counters->allocBytes += shardCounters->allocBytes;
+   counters->hashOps += shardCounters->hashOps;
+   counters->hmacOps += shardCounters->hmacOps;
+   counters->publicKeyOps += shardCounters->publicKeyOps;
+   counters->pemImports += shardCounters->pemImports;
+   counters->x509Parses += shardCounters->x509Parses;
+}
+
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+
+/**
+ * @brief Memory allocation (handshake accounting)
+ * @param[in] size Bytes to allocate
+ * @return Pointer to the allocated space
+ **/
+
+void *tlsStatsAllocMem(size_t size)
+{
+   //Charge the allocation to the handshake in progress, if any
+   TLS_HANDSHAKE_ACCOUNT(allocCount, 1);
+   TLS_HANDSHAKE_ACCOUNT(allocBytes, size);
+
+   //Allocate memory
+   return osAllocMem(size);
+}
+
+#endif
+
+
+/**
+ * @brief Increment the counter associated with a given identifier
+ * @param[in] entries Table of counters
+ * @param[in] numEntries Number of entries in the table
+ * @param[in] id Cipher suite or named group
+ * @param[in,out] other Counter used when the table is full
+ **/
+
+void tlsStatsIncEntry(TlsStatsEntry *entries, uint_t numEntries, uint16_t id,
+   uint32_t *other)
+{
+   uint_t i;
+
+   //Loop through the table
+   for(i = 0; i < numEntries; i++)
+   {
+      //Matching identifier or unused entry?
+      if(entries[i].id == id || entries[i].count == 0)
+      {
+         //Update the entry
+         entries[i].id = id;
+         entries[i].count++;
+         return;
+      }
+   }
+
+   //The table is full
+   (*other)++;
+}
+
+
+/**
+ * @brief Merge the counters of a shard into an aggregated table
+ * @param[in,out] entries Aggregated table of counters
+ * @param[in] numEntries Number of entries in the tables
+ * @param[in] shardEntries Table of counters of the shard
+ * @param[in,out] other Counter used when the aggregated table is full
+ **/
+
+void tlsStatsMergeEntries(TlsStatsEntry *entries, uint_t numEntries,
+   const TlsStatsEntry *shardEntries, uint32_t *other)
+{
+   uint_t i;
+   uint_t j;
+
+   //Loop through the counters of the shard
+   for(i = 0; i < numEntries && shardEntries[i].count != 0; i++)
+   {
+      //Search the aggregated table for the same identifier
+      for(j = 0; j < numEntries; j++)
+      {
+         //Matching identifier or unused entry?
+         if(entries[j].id == shardEntries[i].id || entries[j].count == 0)
+         {
+            //Update the entry
+            entries[j].id = shardEntries[i].id;
+            entries[j].count += shardEntries[i].count;
+            break;
+         }
+      }
+
+      //The aggregated table is full?
+      if(j >= numEntries)
+         *other += shardEntries[i].count;
+   }
+}
+
+
+/**
+ * @brief Retrieve the statistics of a TLS context
+ * @param[in] context Pointer to the TLS context
+ * @param[out] stats Per-context statistics
+ * @return Error code
+ **/
+
+error_t tlsGetContextStats(TlsContext *context, TlsContextStats *stats)
+{
+   //Check parameters
+   if(context == NULL || stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Copy the per-context statistics
+   *stats = context->stats;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve the global statistics
+ *
+ * The counters of all the shards are summed up. Since the shards are
+ * updated without locking, a snapshot may be slightly inconsistent
+ *
+ * @param[out] stats Aggregated global statistics
+ * @return Error code
+ **/
+
+error_t tlsGetGlobalStats(TlsGlobalStats *stats)
+{
+   uint_t i;
+   uint_t j;
+   const TlsGlobalStats *shard;
+
+   //Check parameters
+   if(stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Clear the aggregated statistics
+   memset(stats, 0, sizeof(TlsGlobalStats));
+
+   //Loop through the shards
+   for(i = 0; i < TLS_STATS_NUM_SHARDS; i++)
+   {
+      //Point to the current shard
+      shard = &tlsGlobalStats[i];
+
+      //Sum up the counters
+      stats->handshakes += shard->handshakes;
+
+      for(j = 0; j < arraysize(stats->handshakesByVersion); j++)
+         stats->handshakesByVersion[j] += shard->handshakesByVersion[j];
+
+      for(j = 0; j < arraysize(stats->handshakesByResumption); j++)
+         stats->handshakesByResumption[j] += shard->handshakesByResumption[j];
+
+      tlsStatsMergeEntries(stats->handshakesByCipherSuite,
+         TLS_STATS_MAX_CIPHER_SUITES, shard->handshakesByCipherSuite,
+         &stats->otherCipherSuites);
+
+      tlsStatsMergeEntries(stats->handshakesByGroup, TLS_STATS_MAX_GROUPS,
+         shard->handshakesByGroup, &stats->otherGroups);
+
+      stats->otherCipherSuites += shard->otherCipherSuites;
+      stats->otherGroups += shard->otherGroups;
+      stats->cacheHits += shard->cacheHits;
+      stats->cacheMisses += shard->cacheMisses;
+      stats->ticketDecryptSuccesses += shard->ticketDecryptSuccesses;
+      stats->ticketDecryptFailures += shard->ticketDecryptFailures;
+
+      for(j = 0; j < arraysize(stats->alertsSent); j++)
+      {
+         stats->alertsSent[j] += shard->alertsSent[j];
+         stats->alertsReceived[j] += shard->alertsReceived[j];
+      }
+
+      stats->dtlsRetransmissions += shard->dtlsRetransmissions;
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+      for(j = 0; j < arraysize(stats->handshakesByType); j++)
+      {
+         stats->handshakesByType[j] += shard->handshakesByType[j];
+         tlsStatsMergeCounters(&stats->countersByType[j],
+            &shard->countersByType[j]);
+      }
+#endif
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Reset the global statistics
+ **/
+
+void tlsResetGlobalStats(void)
+{
+   //Clear all the shards
+   memset(tlsGlobalStats, 0, sizeof(tlsGlobalStats));
+}
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * @file tls_stats.h
+ * @brief TLS statistics
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_STATS_H
+#define _TLS_STATS_H
+
+//Dependencies
+#include "tls.h"
+
+//Statistics enabled?
+#if (TLS_STATS_SUPPORT == ENABLED)
+
+//Update a per-context counter
+#define TLS_CONTEXT_STATS_ADD(context, field, n) ((context)->stats.field += (n))
+//Increment a global counter
+#define TLS_GLOBAL_STATS_INC(context, field) ((context)->statsShard->field++)
+
+#else
+
+//Statistics are compiled out
+#define TLS_CONTEXT_STATS_ADD(context, field, n)
+#define TLS_GLOBAL_STATS_INC(context, field)
+
+#endif
+
+//Handshake accounting enabled?
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+
+//Charge an event to the handshake in progress on the calling thread
+#define TLS_HANDSHAKE_ACCOUNT(field, n) ((tlsHandshakeCounters != NULL) ? \
+   (void) (tlsHandshakeCounters->field += (n)) : (void) 0)
+
+//Counters of the handshake in progress on the calling thread
+extern TLS_THREAD_LOCAL TlsHandshakeCounters *tlsHandshakeCounters;
+
+#else
+
+//Handshake accounting is compiled out
+#define TLS_HANDSHAKE_ACCOUNT(field, n)
+
+#endif
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Statistics related functions
+void tlsInitContextStats(TlsContext *context);
+void tlsStatsHandshakeStarted(TlsContext *context);
+void tlsStatsHandshakeCompleted(TlsContext *context);
+
+TlsHandshakeCounters *tlsStatsEnterHandshake(TlsContext *context);
+TlsHandshakeCounters *tlsStatsEnterCounters(TlsHandshakeCounters *counters);
+void tlsStatsLeaveHandshake(TlsHandshakeCounters *counters);
+
+void tlsStatsMergeCounters(TlsHandshakeCounters *counters,
+   const TlsHandshakeCounters *shardCounters);
+
+void tlsStatsIncEntry(TlsStatsEntry *entries, uint_t numEntries, uint16_t id,
+   uint32_t *other);
+
+void tlsStatsMergeEntries(TlsStatsEntry *entries, uint_t numEntries,
+   const TlsStatsEntry *shardEntries, uint32_t *other);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
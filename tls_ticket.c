@@ -437,4 +437,777 @@ void tlsFreeTicketContext(TlsTicketContext *ticketContext)
    }
 }
 
+
+/**
+ * @brief Initialize a ticket keyring
+ *
+ * A keyring holds up to TLS_TICKET_KEYRING_SIZE live keys, each with its own
+ * pre-expanded AES/GCM context. The keys are published as an immutable set,
+ * so that tickets are encrypted and decrypted without holding any lock. The
+ * mutex is only taken to grab a reference to the current set
+ *
+ * @param[in] keyring Pointer to the ticket keyring
+ * @return Error code
+ **/
+
+error_t tlsInitTicketKeyring(TlsTicketKeyring *keyring)
+{
+   //Make sure the keyring is valid
+   if(keyring == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Erase keyring
+   memset(keyring, 0, sizeof(TlsTicketKeyring));
+
+   //Create a mutex to protect the published key set
+   if(!osCreateMutex(&keyring->mutex))
+   {
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Sucessful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Import a ticket key
+ *
+ * Every node behind a load balancer can import the same keys, so that a
+ * ticket issued by one node can be decrypted by any other node. Imported
+ * keys are never rotated automatically
+ *
+ * @param[in] keyring Pointer to the ticket keyring
+ * @param[in] keyName Key identifier (TLS_TICKET_KEY_NAME_SIZE bytes)
+ * @param[in] key Encryption key (TLS_TICKET_KEY_SIZE bytes)
+ * @param[in] encrypt Use this key to protect new tickets
+ * @return Error code
+ **/
+
+error_t tlsImportTicketKey(TlsTicketKeyring *keyring, const uint8_t *keyName,
+   const uint8_t *key, bool_t encrypt)
+{
+   //Check parameters
+   if(keyring == NULL || keyName == NULL || key == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Publish a new key set that includes the imported key
+   return tlsUpdateTicketKeySet(keyring, keyName, key, encrypt, FALSE, FALSE);
+}
+
+
+/**
+ * @brief Export the key currently used to protect new tickets
+ * @param[in] keyring Pointer to the ticket keyring
+ * @param[out] keyName Key identifier (TLS_TICKET_KEY_NAME_SIZE bytes)
+ * @param[out] key Encryption key (TLS_TICKET_KEY_SIZE bytes)
+ * @return Error code
+ **/
+
+error_t tlsExportTicketKey(TlsTicketKeyring *keyring, uint8_t *keyName,
+   uint8_t *key)
+{
+   error_t error;
+   TlsTicketKeySet *keySet;
+
+   //Check parameters
+   if(keyring == NULL || keyName == NULL || key == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Grab a reference to the current key set
+   keySet = tlsAcquireTicketKeySet(keyring);
+
+   //Any key used to protect new tickets?
+   if(keySet != NULL && keySet->encryptionKey < keySet->numKeys)
+   {
+      //Copy the key name and the key
+      memcpy(keyName, keySet->keys[keySet->encryptionKey].keyName,
+         TLS_TICKET_KEY_NAME_SIZE);
+      memcpy(key, keySet->keys[keySet->encryptionKey].key,
+         TLS_TICKET_KEY_SIZE);
+
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //No key available
+      error = ERROR_NOT_FOUND;
+   }
+
+   //Release the reference to the key set
+   tlsReleaseTicketKeySet(keyring, keySet);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Remove a ticket key
+ * @param[in] keyring Pointer to the ticket keyring
+ * @param[in] keyName Identifier of the key to be removed
+ * @return Error code
+ **/
+
+error_t tlsRemoveTicketKey(TlsTicketKeyring *keyring, const uint8_t *keyName)
+{
+   //Check parameters
+   if(keyring == NULL || keyName == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Publish a new key set that no longer includes the key
+   return tlsUpdateTicketKeySet(keyring, keyName, NULL, FALSE, FALSE, FALSE);
+}
+
+
+/**
+ * @brief Generate a new local key and use it to protect new tickets
+ * @param[in] keyring Pointer to the ticket keyring
+ * @param[in] prngAlgo PRNG algorithm
+ * @param[in] prngContext Pointer to the PRNG context
+ * @return Error code
+ **/
+
+error_t tlsRotateTicketKeys(TlsTicketKeyring *keyring,
+   const PrngAlgo *prngAlgo, void *prngContext)
+{
+   //Check parameters
+   if(keyring == NULL || prngAlgo == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Unconditionally replace the key used to protect new tickets
+   return tlsGenerateTicketKey(keyring, prngAlgo, prngContext, FALSE);
+}
+
+
+/**
+ * @brief Generate a new local key
+ *
+ * When staleOnly is set, the key is published only if the key protecting
+ * new tickets is still stale once the keyring is locked. Concurrent
+ * handshakes that all observe the expiry of the key thus trigger a single
+ * rotation, rather than one each, which would evict the other live keys
+ *
+ * @param[in] keyring Pointer to the ticket keyring
+ * @param[in] prngAlgo PRNG algorithm
+ * @param[in] prngContext Pointer to the PRNG context
+ * @param[in] staleOnly Skip the rotation if another thread already did it
+ * @return Error code
+ **/
+
+error_t tlsGenerateTicketKey(TlsTicketKeyring *keyring,
+   const PrngAlgo *prngAlgo, void *prngContext, bool_t staleOnly)
+{
+   error_t error;
+   uint8_t keyName[TLS_TICKET_KEY_NAME_SIZE];
+   uint8_t key[TLS_TICKET_KEY_SIZE];
+
+   //The key name should be randomly generated to avoid collisions between
+   //servers (refer to RFC 5077, section 4)
+   error = prngAlgo->read(prngContext, keyName, TLS_TICKET_KEY_NAME_SIZE);
+
+   //Check status code
+   if(!error)
+   {
+      //Generate a random encryption key
+      error = prngAlgo->read(prngContext, key, TLS_TICKET_KEY_SIZE);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Publish a new key set that includes the generated key
+      error = tlsUpdateTicketKeySet(keyring, keyName, key, TRUE, TRUE,
+         staleOnly);
+   }
+
+   //Erase the local copy of the key
+   memset(key, 0, TLS_TICKET_KEY_SIZE);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Session ticket encryption using a ticket keyring
+ * @param[in] context Pointer to the TLS context
+ * @param[in] plaintext Plaintext session state
+ * @param[in] plaintextLen Length of the plaintext session state, in bytes
+ * @param[out] ciphertext Encrypted ticket
+ * @param[out] ciphertextLen Length of the encrypted ticket, in bytes
+ * @param[in] param Pointer to the ticket keyring
+ * @return Error code
+ **/
+
+error_t tlsKeyringEncryptTicket(TlsContext *context, const uint8_t *plaintext,
+   size_t plaintextLen, uint8_t *ciphertext, size_t *ciphertextLen, void *param)
+{
+   error_t error;
+   uint8_t *iv;
+   uint8_t *data;
+   uint8_t *tag;
+   systime_t time;
+   TlsTicketKey *key;
+   TlsTicketKeySet *keySet;
+   TlsTicketKeyring *keyring;
+
+   //Check parameters
+   if(context == NULL || param == NULL)
+      return ERROR_INVALID_PARAMETER;
+   if(plaintext == NULL || ciphertext == NULL || ciphertextLen == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Point to the ticket keyring
+   keyring = (TlsTicketKeyring *) param;
+
+   //Grab a reference to the current key set
+   keySet = tlsAcquireTicketKeySet(keyring);
+
+   //Get current time
+   time = osGetSystemTime();
+
+   //No key available? Local keys should be changed regularly (refer to
+   //RFC 5077, section 5.5)
+   if(tlsIsTicketKeySetStale(keySet, time))
+   {
+      //Release the reference to the stale key set
+      tlsReleaseTicketKeySet(keyring, keySet);
+
+      //Generate a new local key, unless another handshake already did
+      error = tlsGenerateTicketKey(keyring, context->prngAlgo,
+         context->prngContext, TRUE);
+      //Any error to report?
+      if(error)
+         return error;
+
+      //Grab a reference to the new key set
+      keySet = tlsAcquireTicketKeySet(keyring);
+
+      //Just for sanity
+      if(keySet == NULL || keySet->encryptionKey >= keySet->numKeys)
+      {
+         //Release the reference to the key set
+         tlsReleaseTicketKeySet(keyring, keySet);
+         //Report an error
+         return ERROR_FAILURE;
+      }
+   }
+
+   //Point to the key used to protect new tickets
+   key = &keySet->keys[keySet->encryptionKey];
+
+   //Point to the IV
+   iv = ciphertext + TLS_TICKET_KEY_NAME_SIZE;
+   //Point to the data
+   data = iv + TLS_TICKET_IV_SIZE;
+   //Point to the buffer where to store the authentication tag
+   tag = data + plaintextLen;
+
+   //Copy plaintext state
+   memmove(data, plaintext, plaintextLen);
+   //Copy key name
+   memcpy(ciphertext, key->keyName, TLS_TICKET_KEY_NAME_SIZE);
+
+   //Generate a random IV
+   error = context->prngAlgo->read(context->prngContext, iv,
+      TLS_TICKET_IV_SIZE);
+
+   //Check status code
+   if(!error)
+   {
+      //Calculate the length of the encrypted ticket
+      *ciphertextLen = plaintextLen + TLS_TICKET_KEY_NAME_SIZE +
+         TLS_TICKET_IV_SIZE + TLS_TICKET_TAG_SIZE;
+
+      //The pre-computed GCM context is never modified, so that it can be
+      //shared by all the connections
+      error = gcmEncrypt(&key->gcmContext, iv, TLS_TICKET_IV_SIZE,
+         key->keyName, TLS_TICKET_KEY_NAME_SIZE, data, data, plaintextLen,
+         tag, TLS_TICKET_TAG_SIZE);
+   }
+
+   //Release the reference to the key set
+   tlsReleaseTicketKeySet(keyring, keySet);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Session ticket decryption using a ticket keyring
+ * @param[in] context Pointer to the TLS context
+ * @param[in] ciphertext Encrypted ticket
+ * @param[in] ciphertextLen Length of the encrypted ticket, in bytes
+ * @param[out] plaintext Plaintext session state
+ * @param[out] plaintextLen Length of the plaintext session state, in bytes
+ * @param[in] param Pointer to the ticket keyring
+ * @return Error code
+ **/
+
+error_t tlsKeyringDecryptTicket(TlsContext *context, const uint8_t *ciphertext,
+   size_t ciphertextLen, uint8_t *plaintext, size_t *plaintextLen, void *param)
+{
+   error_t error;
+   const uint8_t *iv;
+   const uint8_t *data;
+   const uint8_t *tag;
+   TlsTicketKey *key;
+   TlsTicketKeySet *keySet;
+   TlsTicketKeyring *keyring;
+
+   //Check parameters
+   if(context == NULL || param == NULL)
+      return ERROR_INVALID_PARAMETER;
+   if(ciphertext == NULL || plaintext == NULL || plaintextLen == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check the length of the encrypted ticket
+   if(ciphertextLen < (TLS_TICKET_KEY_NAME_SIZE + TLS_TICKET_IV_SIZE +
+      TLS_TICKET_TAG_SIZE))
+   {
+      //Report an error
+      return ERROR_DECRYPTION_FAILED;
+   }
+
+   //Point to the ticket keyring
+   keyring = (TlsTicketKeyring *) param;
+
+   //Grab a reference to the current key set
+   keySet = tlsAcquireTicketKeySet(keyring);
+
+   //Look for the key that protects the ticket
+   key = tlsFindTicketKey(keySet, ciphertext, ciphertextLen);
+
+   //Known key name?
+   if(key != NULL)
+   {
+      //Point to the IV
+      iv = ciphertext + TLS_TICKET_KEY_NAME_SIZE;
+      //Point to the data
+      data = iv + TLS_TICKET_IV_SIZE;
+      //Point to the authentication tag
+      tag = ciphertext + ciphertextLen - TLS_TICKET_TAG_SIZE;
+
+      //Retrieve the length of the data
+      *plaintextLen = ciphertextLen - TLS_TICKET_KEY_NAME_SIZE -
+         TLS_TICKET_IV_SIZE - TLS_TICKET_TAG_SIZE;
+
+      //The actual state information in encrypted using AES-GCM
+      error = gcmDecrypt(&key->gcmContext, iv, TLS_TICKET_IV_SIZE,
+         key->keyName, TLS_TICKET_KEY_NAME_SIZE, data, plaintext,
+         *plaintextLen, tag, TLS_TICKET_TAG_SIZE);
+   }
+   else
+   {
+      //Unknown key name
+      error = ERROR_DECRYPTION_FAILED;
+   }
+
+   //Release the reference to the key set
+   tlsReleaseTicketKeySet(keyring, keySet);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Publish a new key set
+ *
+ * The current key set is copied, the specified key is added (or removed if
+ * key is NULL), and the resulting set replaces the current one. Connections
+ * that still hold a reference to the previous set keep using it until they
+ * release it
+ *
+ * @param[in] keyring Pointer to the ticket keyring
+ * @param[in] keyName Key identifier
+ * @param[in] key Encryption key (NULL to remove the key)
+ * @param[in] encrypt Use this key to protect new tickets
+ * @param[in] local Key generated locally
+ * @param[in] staleOnly Publish the key only if the key protecting new
+ *   tickets is stale
+ * @return Error code
+ **/
+
+error_t tlsUpdateTicketKeySet(TlsTicketKeyring *keyring, const uint8_t *keyName,
+   const uint8_t *key, bool_t encrypt, bool_t local, bool_t staleOnly)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint_t k;
+   bool_t found;
+   systime_t time;
+   TlsTicketKey *entry;
+   TlsTicketKey newKey;
+   TlsTicketKeySet *oldSet;
+   TlsTicketKeySet *newSet;
+
+   //Add a new key?
+   if(key != NULL)
+   {
+      //Copy the key
+      memset(&newKey, 0, sizeof(TlsTicketKey));
+      memcpy(newKey.keyName, keyName, TLS_TICKET_KEY_NAME_SIZE);
+      memcpy(newKey.key, key, TLS_TICKET_KEY_SIZE);
+      newKey.local = local;
+
+      //Expand the new key before the keyring is locked. The keys of the
+      //current set are already expanded
+      error = aesInit(&newKey.aesContext, newKey.key, TLS_TICKET_KEY_SIZE);
+
+      //Check status code
+      if(!error)
+      {
+         //Initialize GCM context
+         error = gcmInit(&newKey.gcmContext, AES_CIPHER_ALGO,
+            &newKey.aesContext);
+      }
+
+      //Any error to report?
+      if(error)
+      {
+         //Erase the expanded key
+         memset(&newKey, 0, sizeof(TlsTicketKey));
+         //Report an error
+         return error;
+      }
+   }
+
+   //Allocate a new key set
+   newSet = tlsAllocMem(sizeof(TlsTicketKeySet));
+
+   //Failed to allocate memory?
+   if(newSet == NULL)
+   {
+      //Erase the expanded key
+      memset(&newKey, 0, sizeof(TlsTicketKey));
+      //Report an error
+      return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Clear the key set
+   memset(newSet, 0, sizeof(TlsTicketKeySet));
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //The keyring holds a reference to the published set
+   newSet->refCount = 1;
+   //No key is used to protect new tickets yet
+   k = TLS_TICKET_KEYRING_SIZE;
+   //Number of keys in the new set
+   n = 0;
+   //The key has not been found yet
+   found = FALSE;
+
+   //Acquire exclusive access to the keyring
+   osAcquireMutex(&keyring->mutex);
+
+   //Get current time. The time is read under the lock, so that it cannot
+   //precede the timestamp of a key published by another thread
+   time = osGetSystemTime();
+
+   //Point to the current key set
+   oldSet = keyring->keySet;
+
+   //Another thread may have rotated the key while this one was waiting
+   if(staleOnly && !tlsIsTicketKeySetStale(oldSet, time))
+   {
+      //Release exclusive access to the keyring
+      osReleaseMutex(&keyring->mutex);
+
+      //Discard the new key set and the expanded key
+      memset(newSet, 0, sizeof(TlsTicketKeySet));
+      tlsFreeMem(newSet);
+      memset(&newKey, 0, sizeof(TlsTicketKey));
+
+      //The current key can be used to protect new tickets
+      return NO_ERROR;
+   }
+
+   //Copy the surviving keys
+   for(i = 0; oldSet != NULL && i < oldSet->numKeys; i++)
+   {
+      //Point to the current key
+      entry = &oldSet->keys[i];
+
+      //The key is replaced or removed?
+      if(memcmp(entry->keyName, keyName, TLS_TICKET_KEY_NAME_SIZE) == 0)
+      {
+         found = TRUE;
+         continue;
+      }
+
+      //Local keys are kept during two lifetimes so that outstanding tickets
+      //can still be decrypted
+      if(entry->local && (time - entry->timestamp) >= (2 * TLS_TICKET_LIFETIME))
+         continue;
+
+      //Keep track of the key used to protect new tickets
+      if(i == oldSet->encryptionKey)
+         k = n;
+
+      //Copy the key together with its expanded cipher contexts
+      newSet->keys[n] = *entry;
+      n++;
+   }
+
+   //Add a new key?
+   if(key != NULL)
+   {
+      //The keyring is full?
+      if(n >= TLS_TICKET_KEYRING_SIZE)
+      {
+         //Select the oldest key that does not protect new tickets
+         for(entry = NULL, i = 0; i < n; i++)
+         {
+            if(i != k && (entry == NULL ||
+               timeCompare(newSet->keys[i].timestamp, entry->timestamp) < 0))
+            {
+               entry = &newSet->keys[i];
+            }
+         }
+
+         //Index of the key to be evicted
+         i = entry - newSet->keys;
+
+         //Adjust the index of the key used to protect new tickets
+         if(k != TLS_TICKET_KEYRING_SIZE && k > i)
+            k--;
+
+         //Evict the key
+         memmove(entry, entry + 1, (n - i - 1) * sizeof(TlsTicketKey));
+         n--;
+      }
+
+      //Point to the new key
+      entry = &newSet->keys[n];
+
+      //Copy the expanded key
+      *entry = newKey;
+      //Save the time at which the key is published
+      entry->timestamp = time;
+
+      //Use this key to protect new tickets?
+      if(encrypt || k == TLS_TICKET_KEYRING_SIZE)
+         k = n;
+
+      //One more key in the set
+      n++;
+   }
+   else if(k == TLS_TICKET_KEYRING_SIZE && n > 0)
+   {
+      //The key that protected new tickets has been removed. Fall back to
+      //the most recent key
+      for(k = 0, i = 1; i < n; i++)
+      {
+         if(timeCompare(newSet->keys[i].timestamp, newSet->keys[k].timestamp) > 0)
+            k = i;
+      }
+   }
+
+   //Save the number of keys and the key used to protect new tickets
+   newSet->numKeys = n;
+   newSet->encryptionKey = k;
+
+   //The GCM contexts refer to the AES contexts of the keys they were copied
+   //with. Point them to the AES contexts of the new set
+   for(i = 0; i < n; i++)
+   {
+      newSet->keys[i].gcmContext.cipherContext = &newSet->keys[i].aesContext;
+   }
+
+   //Nothing to remove?
+   if(key == NULL && !found)
+      error = ERROR_NOT_FOUND;
+
+   //Check status code
+   if(!error)
+   {
+      //Publish the new key set
+      keyring->keySet = newSet;
+
+      //Drop the reference the keyring held to the previous set
+      if(oldSet != NULL && --oldSet->refCount == 0)
+      {
+         memset(oldSet, 0, sizeof(TlsTicketKeySet));
+         tlsFreeMem(oldSet);
+      }
+   }
+   else
+   {
+      //Discard the new key set
+      memset(newSet, 0, sizeof(TlsTicketKeySet));
+      tlsFreeMem(newSet);
+   }
+
+   //Release exclusive access to the keyring
+   osReleaseMutex(&keyring->mutex);
+
+   //Erase the expanded key
+   memset(&newKey, 0, sizeof(TlsTicketKey));
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check whether a new key is needed to protect new tickets
+ * @param[in] keySet Pointer to the key set (may be NULL)
+ * @param[in] time Current time
+ * @return TRUE if no key can be used or if the local key has expired
+ **/
+
+bool_t tlsIsTicketKeySetStale(const TlsTicketKeySet *keySet, systime_t time)
+{
+   const TlsTicketKey *key;
+
+   //No key available?
+   if(keySet == NULL || keySet->encryptionKey >= keySet->numKeys)
+      return TRUE;
+
+   //Point to the key used to protect new tickets
+   key = &keySet->keys[keySet->encryptionKey];
+
+   //Local keys should be changed regularly (refer to RFC 5077, section 5.5)
+   return (key->local && (time - key->timestamp) >= TLS_TICKET_LIFETIME) ?
+      TRUE : FALSE;
+}
+
+
+/**
+ * @brief Grab a reference to the published key set
+ * @param[in] keyring Pointer to the ticket keyring
+ * @return Pointer to the key set, or NULL if no key has been published
+ **/
+
+TlsTicketKeySet *tlsAcquireTicketKeySet(TlsTicketKeyring *keyring)
+{
+   TlsTicketKeySet *keySet;
+
+   //Acquire exclusive access to the keyring
+   osAcquireMutex(&keyring->mutex);
+
+   //Point to the published key set
+   keySet = keyring->keySet;
+
+   //Increment the reference counter
+   if(keySet != NULL)
+      keySet->refCount++;
+
+   //Release exclusive access to the keyring
+   osReleaseMutex(&keyring->mutex);
+
+   //Return a pointer to the key set
+   return keySet;
+}
+
+
+/**
+ * @brief Release a reference to a key set
+ * @param[in] keyring Pointer to the ticket keyring
+ * @param[in] keySet Pointer to the key set
+ **/
+
+void tlsReleaseTicketKeySet(TlsTicketKeyring *keyring,
+   TlsTicketKeySet *keySet)
+{
+   //Valid key set?
+   if(keySet != NULL)
+   {
+      //Acquire exclusive access to the keyring
+      osAcquireMutex(&keyring->mutex);
+
+      //The key set is released when the last reference is dropped
+      if(--keySet->refCount == 0)
+      {
+         memset(keySet, 0, sizeof(TlsTicketKeySet));
+         tlsFreeMem(keySet);
+      }
+
+      //Release exclusive access to the keyring
+      osReleaseMutex(&keyring->mutex);
+   }
+}
+
+
+/**
+ * @brief Look for the key that protects a given ticket
+ * @param[in] keySet Pointer to the key set
+ * @param[in] ticket Encrypted ticket
+ * @param[in] ticketLen Length of the encrypted ticket, in bytes
+ * @return Pointer to the matching key, or NULL if the key name is unknown
+ **/
+
+TlsTicketKey *tlsFindTicketKey(TlsTicketKeySet *keySet, const uint8_t *ticket,
+   size_t ticketLen)
+{
+   uint_t i;
+   systime_t time;
+   TlsTicketKey *key;
+
+   //Initialize pointer
+   key = NULL;
+
+   //Valid key set?
+   if(keySet != NULL && ticketLen >= TLS_TICKET_KEY_NAME_SIZE)
+   {
+      //Get current time
+      time = osGetSystemTime();
+
+      //Loop through the live keys
+      for(i = 0; i < keySet->numKeys; i++)
+      {
+         //The key name serves to identify a particular set of keys used to
+         //protect the ticket (refer to RFC 5077, section 4)
+         if(memcmp(ticket, keySet->keys[i].keyName, TLS_TICKET_KEY_NAME_SIZE) == 0)
+         {
+            //Local keys expire after two lifetimes
+            if(!keySet->keys[i].local ||
+               (time - keySet->keys[i].timestamp) < (2 * TLS_TICKET_LIFETIME))
+            {
+               key = &keySet->keys[i];
+            }
+
+            break;
+         }
+      }
+   }
+
+   //Return the matching key, if any
+   return key;
+}
+
+
+/**
+ * @brief Properly dispose a ticket keyring
+ * @param[in] keyring Pointer to the ticket keyring
+ **/
+
+void tlsFreeTicketKeyring(TlsTicketKeyring *keyring)
+{
+   //Make sure the keyring is valid
+   if(keyring != NULL)
+   {
+      //Drop the reference the keyring holds to the published set
+      if(keyring->keySet != NULL && --keyring->keySet->refCount == 0)
+      {
+         memset(keyring->keySet, 0, sizeof(TlsTicketKeySet));
+         tlsFreeMem(keyring->keySet);
+      }
+
+      //Release previously allocated resources
+      osDeleteMutex(&keyring->mutex);
+
+      //Erase keyring
+      memset(keyring, 0, sizeof(TlsTicketKeyring));
+   }
+}
+
 #endif
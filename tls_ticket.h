@@ -64,6 +64,13 @@
    #error TLS_TICKET_TAG_SIZE parameter is not valid
 #endif
 
+//Maximum number of live keys in a ticket keyring
+#ifndef TLS_TICKET_KEYRING_SIZE
+   #define TLS_TICKET_KEYRING_SIZE 4
+#elif (TLS_TICKET_KEYRING_SIZE < 2)
+   #error TLS_TICKET_KEYRING_SIZE parameter is not valid
+#endif
+
 //C++ guard
 #ifdef __cplusplus
 extern "C" {
@@ -97,6 +104,45 @@ typedef struct
 } TlsTicketContext;
 
 
+/**
+ * @brief Ticket key with pre-expanded cipher contexts
+ **/
+
+typedef struct
+{
+   uint8_t keyName[TLS_TICKET_KEY_NAME_SIZE]; ///<Key identifier
+   uint8_t key[TLS_TICKET_KEY_SIZE];          ///<Encryption key
+   systime_t timestamp;                       ///<Time at which the key was added
+   bool_t local;                              ///<Key generated locally (subject to automatic rotation)
+   AesContext aesContext;                     ///<Pre-expanded AES key schedule
+   GcmContext gcmContext;                     ///<Pre-computed GCM context
+} TlsTicketKey;
+
+
+/**
+ * @brief Immutable set of ticket keys
+ **/
+
+typedef struct
+{
+   uint_t refCount;                          ///<Reference counter (protected by the keyring mutex)
+   uint_t numKeys;                           ///<Number of live keys
+   uint_t encryptionKey;                     ///<Index of the key used to protect new tickets
+   TlsTicketKey keys[TLS_TICKET_KEYRING_SIZE]; ///<Live keys
+} TlsTicketKeySet;
+
+
+/**
+ * @brief Ticket keyring
+ **/
+
+typedef struct
+{
+   OsMutex mutex;           ///<Mutex protecting the published key set and the reference counters
+   TlsTicketKeySet *keySet; ///<Currently published key set
+} TlsTicketKeyring;
+
+
 //TLS related functions
 error_t tlsInitTicketContext(TlsTicketContext *ticketContext);
 
@@ -116,6 +162,43 @@ bool_t tlsCompareTicketKeyName(const uint8_t *ticket, size_t ticketLen,
 
 void tlsFreeTicketContext(TlsTicketContext *ticketContext);
 
+error_t tlsInitTicketKeyring(TlsTicketKeyring *keyring);
+
+error_t tlsImportTicketKey(TlsTicketKeyring *keyring, const uint8_t *keyName,
+   const uint8_t *key, bool_t encrypt);
+
+error_t tlsExportTicketKey(TlsTicketKeyring *keyring, uint8_t *keyName,
+   uint8_t *key);
+
+error_t tlsRemoveTicketKey(TlsTicketKeyring *keyring, const uint8_t *keyName);
+
+error_t tlsRotateTicketKeys(TlsTicketKeyring *keyring,
+   const PrngAlgo *prngAlgo, void *prngContext);
+
+error_t tlsGenerateTicketKey(TlsTicketKeyring *keyring,
+   const PrngAlgo *prngAlgo, void *prngContext, bool_t staleOnly);
+
+error_t tlsKeyringEncryptTicket(TlsContext *context, const uint8_t *plaintext,
+   size_t plaintextLen, uint8_t *ciphertext, size_t *ciphertextLen, void *param);
+
+error_t tlsKeyringDecryptTicket(TlsContext *context, const uint8_t *ciphertext,
+   size_t ciphertextLen, uint8_t *plaintext, size_t *plaintextLen, void *param);
+
+error_t tlsUpdateTicketKeySet(TlsTicketKeyring *keyring, const uint8_t *keyName,
+   const uint8_t *key, bool_t encrypt, bool_t local, bool_t staleOnly);
+
+bool_t tlsIsTicketKeySetStale(const TlsTicketKeySet *keySet, systime_t time);
+
+TlsTicketKeySet *tlsAcquireTicketKeySet(TlsTicketKeyring *keyring);
+
+void tlsReleaseTicketKeySet(TlsTicketKeyring *keyring,
+   TlsTicketKeySet *keySet);
+
+TlsTicketKey *tlsFindTicketKey(TlsTicketKeySet *keySet, const uint8_t *ticket,
+   size_t ticketLen);
+
+void tlsFreeTicketKeyring(TlsTicketKeyring *keyring);
+
 //C++ guard
 #ifdef __cplusplus
 }
@@ -34,6 +34,7 @@
 //Dependencies
 #include <string.h>
 #include "tls.h"
+#include "tls_stats.h"
 #include "tls_client.h"
 #include "tls_key_material.h"
 #include "tls_transcript_hash.h"
@@ -57,7 +58,8 @@ error_t tlsInitTranscriptHash(TlsContext *context)
    //MD5 context already instantiated?
    if(context->transcriptMd5Context != NULL)
    {
-      tlsFreeMem(context->transcriptMd5Context);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         context->transcriptMd5Context);
       context->transcriptMd5Context = NULL;
    }
 #endif
@@ -66,16 +68,28 @@ error_t tlsInitTranscriptHash(TlsContext *context)
    //SHA-1 context already instantiated?
    if(context->transcriptSha1Context != NULL)
    {
-      tlsFreeMem(context->transcriptSha1Context);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         context->transcriptSha1Context);
       context->transcriptSha1Context = NULL;
    }
 #endif
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_TRANSCRIPT_LOG_SIZE > 0)
+   //Handshake message log already instantiated?
+   if(context->transcriptLog != NULL)
+   {
+      tlsFreeHandshakeMem(context, context->transcriptLog);
+      context->transcriptLog = NULL;
+   }
+#endif
+
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
    //Hash algorithm context already instantiated?
    if(context->transcriptHashContext != NULL)
    {
-      tlsFreeMem(context->transcriptHashContext);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         context->transcriptHashContext);
       context->transcriptHashContext = NULL;
    }
 #endif
@@ -85,7 +99,8 @@ error_t tlsInitTranscriptHash(TlsContext *context)
    if(context->version <= TLS_VERSION_1_1)
    {
       //Allocate MD5 context
-      context->transcriptMd5Context = tlsAllocMem(sizeof(Md5Context));
+      context->transcriptMd5Context = tlsAllocHandshakeObject(context,
+         TLS_MEM_CLASS_HASH_CONTEXT, sizeof(Md5Context));
       //Failed to allocate memory?
       if(context->transcriptMd5Context == NULL)
          return ERROR_OUT_OF_MEMORY;
@@ -96,11 +111,36 @@ error_t tlsInitTranscriptHash(TlsContext *context)
 #endif
 
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
-   //SSL 3.0, TLS 1.0, TLS 1.1 or TLS 1.2 currently selected?
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_TRANSCRIPT_LOG_SIZE > 0)
+   //TLS 1.2 currently selected?
+   if(context->version == TLS_VERSION_1_2)
+   {
+      //With TLS 1.2, the SHA-1 digest of the handshake messages is only
+      //needed by a CertificateVerify message that uses SHA-1. Digesting is
+      //deferred until the algorithm of the CertificateVerify message is known
+      if(context->entity == TLS_CONNECTION_END_CLIENT ||
+         context->clientAuthMode != TLS_CLIENT_AUTH_NONE)
+      {
+         //Allocate a buffer to hold the handshake messages
+         context->transcriptLog = tlsAllocHandshakeMem(context,
+            TLS_TRANSCRIPT_LOG_SIZE);
+         //Failed to allocate memory?
+         if(context->transcriptLog == NULL)
+            return ERROR_OUT_OF_MEMORY;
+
+         //The log is initially empty
+         context->transcriptLogLen = 0;
+      }
+   }
+   else
+#endif
+   //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
    if(context->version <= TLS_VERSION_1_2)
    {
       //Allocate SHA-1 context
-      context->transcriptSha1Context = tlsAllocMem(sizeof(Sha1Context));
+      context->transcriptSha1Context = tlsAllocHandshakeObject(context,
+         TLS_MEM_CLASS_HASH_CONTEXT, sizeof(Sha1Context));
       //Failed to allocate memory?
       if(context->transcriptSha1Context == NULL)
          return ERROR_OUT_OF_MEMORY;
@@ -123,7 +163,8 @@ error_t tlsInitTranscriptHash(TlsContext *context)
          return ERROR_FAILURE;
 
       //Allocate hash algorithm context
-      context->transcriptHashContext = tlsAllocMem(hashAlgo->contextSize);
+      context->transcriptHashContext = tlsAllocHandshakeObject(context,
+         TLS_MEM_CLASS_HASH_CONTEXT, hashAlgo->contextSize);
       //Failed to allocate memory?
       if(context->transcriptHashContext == NULL)
          return ERROR_OUT_OF_MEMORY;
@@ -195,6 +236,9 @@ error_t tlsInitTranscriptHash(TlsContext *context)
 void tlsUpdateTranscriptHash(TlsContext *context, const void *data,
    size_t length)
 {
+   //Account for the hash operation
+   TLS_HANDSHAKE_ACCOUNT(hashOps, 1);
+
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_1)
    //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
    if(context->version <= TLS_VERSION_1_1)
@@ -212,6 +256,29 @@ void tlsUpdateTranscriptHash(TlsContext *context, const void *data,
    //SSL 3.0, TLS 1.0, TLS 1.1 or TLS 1.2 currently selected?
    if(context->version <= TLS_VERSION_1_2)
    {
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_TRANSCRIPT_LOG_SIZE > 0)
+      //SHA-1 digest deferred?
+      if(context->transcriptLog != NULL)
+      {
+         //Check whether the message fits in the log
+         if((context->transcriptLogLen + length) <= TLS_TRANSCRIPT_LOG_SIZE)
+         {
+            //Append the message to the log
+            memcpy(context->transcriptLog + context->transcriptLogLen, data,
+               length);
+
+            //Update the length of the log
+            context->transcriptLogLen += length;
+         }
+         else
+         {
+            //The log is full. Digest its contents and switch to SHA-1
+            tlsFlushTranscriptLog(context);
+         }
+      }
+#endif
+
       //Valid SHA-1 context?
       if(context->transcriptSha1Context != NULL)
       {
@@ -241,6 +308,45 @@ void tlsUpdateTranscriptHash(TlsContext *context, const void *data,
 }
 
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_TRANSCRIPT_LOG_SIZE > 0)
+
+/**
+ * @brief Digest the handshake message log with SHA-1
+ *
+ * The log is released and subsequent handshake messages are digested as
+ * they are exchanged
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsFlushTranscriptLog(TlsContext *context)
+{
+   //Any handshake message log?
+   if(context->transcriptLog != NULL)
+   {
+      //Allocate SHA-1 context
+      context->transcriptSha1Context = tlsAllocHandshakeObject(context,
+         TLS_MEM_CLASS_HASH_CONTEXT, sizeof(Sha1Context));
+
+      //Successful memory allocation?
+      if(context->transcriptSha1Context != NULL)
+      {
+         //Digest the handshake messages exchanged so far
+         sha1Init(context->transcriptSha1Context);
+         sha1Update(context->transcriptSha1Context, context->transcriptLog,
+            context->transcriptLogLen);
+      }
+
+      //Release the log
+      tlsFreeHandshakeMem(context, context->transcriptLog);
+      context->transcriptLog = NULL;
+   }
+}
+
+#endif
+
+
 /**
  * @brief Finalize hash calculation from previous handshake messages
  * @param[in] context Pointer to the TLS context
@@ -257,12 +363,29 @@ error_t tlsFinalizeTranscriptHash(TlsContext *context, const HashAlgo *hash,
    error_t error;
    HashContext *tempHashContext;
 
+   //Account for the hash operation
+   TLS_HANDSHAKE_ACCOUNT(hashOps, 1);
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_TRANSCRIPT_LOG_SIZE > 0)
+   //SHA-1 digest deferred?
+   if(hash == SHA1_HASH_ALGO && hashContext == NULL &&
+      context->transcriptLog != NULL)
+   {
+      //The log holds all the handshake messages, so there is no hash context
+      //to be preserved
+      return hash->compute(context->transcriptLog, context->transcriptLogLen,
+         output);
+   }
+#endif
+
    //Make sure the hash context is valid
    if(hash == NULL || hashContext == NULL)
       return ERROR_INVALID_PARAMETER;
 
    //Allocate a temporary hash context
-   tempHashContext = tlsAllocMem(hash->contextSize);
+   tempHashContext = tlsAllocHandshakeObject(context,
+      TLS_MEM_CLASS_HASH_CONTEXT, hash->contextSize);
 
    //Successful memory allocation?
    if(tempHashContext != NULL)
@@ -320,7 +443,8 @@ error_t tlsFinalizeTranscriptHash(TlsContext *context, const HashAlgo *hash,
       }
 
       //Release previously allocated resources
-      tlsFreeMem(tempHashContext);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         tempHashContext);
    }
    else
    {
@@ -346,7 +470,8 @@ void tlsFreeTranscriptHash(TlsContext *context)
    if(context->transcriptMd5Context != NULL)
    {
       memset(context->transcriptMd5Context, 0, sizeof(Md5Context));
-      tlsFreeMem(context->transcriptMd5Context);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         context->transcriptMd5Context);
       context->transcriptMd5Context = NULL;
    }
 #endif
@@ -356,16 +481,28 @@ void tlsFreeTranscriptHash(TlsContext *context)
    if(context->transcriptSha1Context != NULL)
    {
       memset(context->transcriptSha1Context, 0, sizeof(Sha1Context));
-      tlsFreeMem(context->transcriptSha1Context);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         context->transcriptSha1Context);
       context->transcriptSha1Context = NULL;
    }
 #endif
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2 && \
+   TLS_TRANSCRIPT_LOG_SIZE > 0)
+   //Release the handshake message log
+   if(context->transcriptLog != NULL)
+   {
+      tlsFreeHandshakeMem(context, context->transcriptLog);
+      context->transcriptLog = NULL;
+   }
+#endif
+
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
    //Release transcript hash context
    if(context->transcriptHashContext != NULL)
    {
-      tlsFreeMem(context->transcriptHashContext);
+      tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+         context->transcriptHashContext);
       context->transcriptHashContext = NULL;
    }
 #endif
@@ -465,7 +602,8 @@ error_t tlsComputeVerifyData(TlsContext *context, TlsConnectionEnd entity,
       if(hashAlgo != NULL && context->transcriptHashContext != NULL)
       {
          //Allocate hash algorithm context
-         hashContext = tlsAllocMem(hashAlgo->contextSize);
+         hashContext = tlsAllocHandshakeObject(context,
+            TLS_MEM_CLASS_HASH_CONTEXT, hashAlgo->contextSize);
 
          //Successful memory allocation?
          if(hashContext != NULL)
@@ -489,7 +627,8 @@ error_t tlsComputeVerifyData(TlsContext *context, TlsConnectionEnd entity,
                verifyData, context->cipherSuite.verifyDataLen);
 
             //Release previously allocated memory
-            tlsFreeMem(hashContext);
+            tlsFreeHandshakeObject(context, TLS_MEM_CLASS_HASH_CONTEXT,
+               hashContext);
          }
          else
          {
@@ -522,9 +661,9 @@ error_t tlsComputeVerifyData(TlsContext *context, TlsConnectionEnd entity,
       {
          //Check whether the computation is performed at client or server side
          if(entity == TLS_CONNECTION_END_CLIENT)
-            baseKey = context->clientHsTrafficSecret;
+            baseKey = context->handshake->clientHsTrafficSecret;
          else
-            baseKey = context->serverHsTrafficSecret;
+            baseKey = context->handshake->serverHsTrafficSecret;
 
          //The key used to compute the Finished message is computed from the
          //base key using HKDF
@@ -543,6 +682,7 @@ error_t tlsComputeVerifyData(TlsContext *context, TlsConnectionEnd entity,
          if(!error)
          {
             //Compute the verify data
+            TLS_HANDSHAKE_ACCOUNT(hmacOps, 1);
             error = hmacCompute(hashAlgo, finishedKey, hashAlgo->digestSize,
                digest, hashAlgo->digestSize, verifyData);
          }
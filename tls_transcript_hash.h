@@ -45,6 +45,8 @@ error_t tlsInitTranscriptHash(TlsContext *context);
 void tlsUpdateTranscriptHash(TlsContext *context, const void *data,
    size_t length);
 
+void tlsFlushTranscriptLog(TlsContext *context);
+
 error_t tlsFinalizeTranscriptHash(TlsContext *context, const HashAlgo *hash,
    const void *hashContext, const char_t *label, uint8_t *output);
 
@@ -0,0 +1,489 @@
+/**
+ * @file tls_trust_store.c
+ * @brief Trusted CA store
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_stats.h"
+#include "tls_trust_store.h"
+#include "tls_cert_verify_cache.h"
+#include "tls_misc.h"
+#include "pkix/pem_import.h"
+#include "pkix/x509_cert_parse.h"
+#include "pkix/x509_cert_validate.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a trusted CA store from a list of CA certificates
+ *
+ * The CA certificates are decoded and parsed once, then indexed by subject
+ * name and subject key identifier. The resulting store is immutable and can
+ * be shared by any number of TLS contexts
+ *
+ * @param[in] trustedCaList List of trusted CA (PEM format)
+ * @param[in] length Total length of the list
+ * @return Handle referencing the newly created store
+ **/
+
+TlsTrustStore *tlsInitTrustStore(const char_t *trustedCaList, size_t length)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint32_t h;
+   size_t m;
+   size_t offset;
+   size_t derCertLen;
+   size_t pemCertLen;
+   const char_t *p;
+   uint8_t *q;
+   TlsTrustStore *trustStore;
+   X509CertificateInfo *certInfo;
+
+   //Check parameters
+   if(trustedCaList == NULL || length == 0)
+      return NULL;
+
+   //Point to the first trusted CA certificate
+   p = trustedCaList;
+   m = length;
+   //Total length of the DER-encoded certificates
+   offset = 0;
+
+   //The first pass calculates the number of CA certificates
+   for(n = 0; m > 0; n++)
+   {
+      //Calculate the length of the DER-encoded certificate
+      TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+      error = pemImportCertificate(p, m, NULL, &derCertLen, &pemCertLen);
+      //End of file detected?
+      if(error)
+         break;
+
+      //Update the total length of the DER-encoded certificates
+      offset += derCertLen;
+
+      //Advance read pointer
+      p += pemCertLen;
+      m -= pemCertLen;
+   }
+
+   //The list must contain at least one certificate
+   if(n == 0)
+      return NULL;
+
+   //Allocate a memory buffer to hold the store and its hash buckets
+   trustStore = tlsAllocMem(sizeof(TlsTrustStore) + n * sizeof(TlsTrustedCa) +
+      2 * n * sizeof(uint_t));
+   //Failed to allocate memory?
+   if(trustStore == NULL)
+      return NULL;
+
+   //Clear the store
+   memset(trustStore, 0, sizeof(TlsTrustStore));
+
+   //Create a mutex to protect the reference counter
+   if(!osCreateMutex(&trustStore->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(trustStore);
+      //Report an error
+      return NULL;
+   }
+
+   //The caller holds the first reference
+   trustStore->refCount = 1;
+
+   //One hash bucket per CA certificate
+   trustStore->numBuckets = n;
+   trustStore->subjectBuckets = (uint_t *) (trustStore->cas + n);
+   trustStore->keyIdBuckets = trustStore->subjectBuckets + n;
+
+   //All the hash chains are initially empty
+   for(i = 0; i < n; i++)
+   {
+      trustStore->subjectBuckets[i] = TLS_TRUST_STORE_INVALID_INDEX;
+      trustStore->keyIdBuckets[i] = TLS_TRUST_STORE_INVALID_INDEX;
+   }
+
+   //Start of exception handling block
+   do
+   {
+      //Allocate a memory buffer to hold the DER-encoded certificates
+      trustStore->derCerts = tlsAllocMem(offset);
+      //Failed to allocate memory?
+      if(trustStore->derCerts == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //Save the total length of the DER-encoded certificates
+      trustStore->derCertsLen = offset;
+
+      //Point to the first trusted CA certificate
+      p = trustedCaList;
+      m = length;
+      offset = 0;
+
+      //The second pass decodes and parses the CA certificates
+      for(i = 0; i < n; i++)
+      {
+         //Decode the PEM certificate
+         TLS_HANDSHAKE_ACCOUNT(pemImports, 1);
+         error = pemImportCertificate(p, m, trustStore->derCerts + offset,
+            &derCertLen, &pemCertLen);
+         //Any error to report?
+         if(error)
+            break;
+
+         //Point to the next entry
+         certInfo = &trustStore->cas[trustStore->numCerts].certInfo;
+
+         //Parse X.509 certificate
+         TLS_HANDSHAKE_ACCOUNT(x509Parses, 1);
+         error = x509ParseCertificate(trustStore->derCerts + offset,
+            derCertLen, certInfo);
+
+         //Valid CA certificate?
+         if(!error)
+         {
+            //Update the length of the list of distinguished names
+            trustStore->certAuthoritiesLen +=
+               certInfo->tbsCert.subject.rawDataLen + 2;
+
+            //Index the CA certificate by subject name
+            h = tlsComputeIndexHash(certInfo->tbsCert.subject.rawData,
+               certInfo->tbsCert.subject.rawDataLen) % n;
+
+            trustStore->cas[trustStore->numCerts].nextBySubject =
+               trustStore->subjectBuckets[h];
+            trustStore->subjectBuckets[h] = trustStore->numCerts;
+
+            //Index the CA certificate by subject key identifier
+            if(certInfo->tbsCert.extensions.subjectKeyId.length > 0)
+            {
+               h = tlsComputeIndexHash(
+                  certInfo->tbsCert.extensions.subjectKeyId.value,
+                  certInfo->tbsCert.extensions.subjectKeyId.length) % n;
+
+               trustStore->cas[trustStore->numCerts].nextByKeyId =
+                  trustStore->keyIdBuckets[h];
+               trustStore->keyIdBuckets[h] = trustStore->numCerts;
+            }
+            else
+            {
+               //The CA certificate does not contain a subject key identifier
+               trustStore->cas[trustStore->numCerts].nextByKeyId =
+                  TLS_TRUST_STORE_INVALID_INDEX;
+            }
+
+            //Update the number of trusted CA certificates
+            trustStore->numCerts++;
+         }
+
+         //Discard invalid CA certificates
+         error = NO_ERROR;
+
+         //Advance pointers
+         offset += derCertLen;
+         p += pemCertLen;
+         m -= pemCertLen;
+      }
+
+      //Any error to report?
+      if(error)
+         break;
+
+      //Any distinguished name?
+      if(trustStore->certAuthoritiesLen > 0)
+      {
+         //Allocate a memory buffer to hold the distinguished names
+         trustStore->certAuthorities = tlsAllocMem(trustStore->certAuthoritiesLen);
+         //Failed to allocate memory?
+         if(trustStore->certAuthorities == NULL)
+         {
+            error = ERROR_OUT_OF_MEMORY;
+            break;
+         }
+
+         //Point to the list of distinguished names
+         q = trustStore->certAuthorities;
+
+         //Format the list of distinguished names once for all
+         for(i = 0; i < trustStore->numCerts; i++)
+         {
+            //Point to the current CA certificate
+            certInfo = &trustStore->cas[i].certInfo;
+
+            //Each distinguished name is preceded by a 2-byte length field
+            STORE16BE(certInfo->tbsCert.subject.rawDataLen, q);
+
+            //The distinguished name shall be DER-encoded
+            memcpy(q + 2, certInfo->tbsCert.subject.rawData,
+               certInfo->tbsCert.subject.rawDataLen);
+
+            //Advance write pointer
+            q += certInfo->tbsCert.subject.rawDataLen + 2;
+         }
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Any error to report?
+   if(error)
+   {
+      //Clean up side effects
+      tlsFreeTrustStore(trustStore);
+      trustStore = NULL;
+   }
+
+   //Return a pointer to the newly created store
+   return trustStore;
+}
+
+
+/**
+ * @brief Acquire a new reference to a trusted CA store
+ * @param[in] trustStore Pointer to the trusted CA store
+ * @return Pointer to the trusted CA store
+ **/
+
+TlsTrustStore *tlsReferenceTrustStore(TlsTrustStore *trustStore)
+{
+   //Valid store?
+   if(trustStore != NULL)
+   {
+      //Acquire exclusive access to the reference counter
+      osAcquireMutex(&trustStore->mutex);
+      //Increment the reference counter
+      trustStore->refCount++;
+      //Release exclusive access to the reference counter
+      osReleaseMutex(&trustStore->mutex);
+   }
+
+   //Return a pointer to the store
+   return trustStore;
+}
+
+
+/**
+ * @brief Release a reference to a trusted CA store
+ *
+ * The store is disposed when the last reference is released
+ *
+ * @param[in] trustStore Pointer to the trusted CA store
+ **/
+
+void tlsFreeTrustStore(TlsTrustStore *trustStore)
+{
+   uint_t refCount;
+
+   //Valid store?
+   if(trustStore != NULL)
+   {
+      //Acquire exclusive access to the reference counter
+      osAcquireMutex(&trustStore->mutex);
+      //Decrement the reference counter
+      refCount = --trustStore->refCount;
+      //Release exclusive access to the reference counter
+      osReleaseMutex(&trustStore->mutex);
+
+      //Last reference?
+      if(refCount == 0)
+      {
+         //Release the DER-encoded certificates
+         if(trustStore->derCerts != NULL)
+         {
+            tlsFreeMem(trustStore->derCerts);
+         }
+
+         //Release the list of distinguished names
+         if(trustStore->certAuthorities != NULL)
+         {
+            tlsFreeMem(trustStore->certAuthorities);
+         }
+
+         //Release mutex object
+         osDeleteMutex(&trustStore->mutex);
+
+         //Properly dispose the store
+         tlsFreeMem(trustStore);
+      }
+   }
+}
+
+
+/**
+ * @brief Verify certificate against the trusted CA store
+ * @param[in] trustStore Pointer to the trusted CA store
+ * @param[in] cache Certificate verification cache (optional parameter)
+ * @param[in] certInfo Certificate to be verified
+ * @param[in] pathLen Certificate path length
+ * @param[in] subjectName Subject name (optional parameter)
+ * @return Error code
+ **/
+
+error_t tlsValidateWithTrustStore(const TlsTrustStore *trustStore,
+   TlsCertVerifyCache *cache, const X509CertificateInfo *certInfo,
+   uint_t pathLen, const char_t *subjectName)
+{
+   error_t error;
+   uint_t i;
+   uint32_t h;
+   const X509Name *issuer;
+   const X509AuthorityKeyId *authKeyId;
+   const X509CertificateInfo *caCertInfo;
+
+   //Initialize status code
+   error = ERROR_UNKNOWN_CA;
+
+   //Point to the authority key identifier of the certificate
+   authKeyId = &certInfo->tbsCert.extensions.authKeyId;
+
+   //The authority key identifier identifies the public key to be used to
+   //verify the signature on this certificate
+   if(authKeyId->keyIdLen > 0)
+   {
+      //Select the relevant hash chain
+      h = tlsComputeIndexHash(authKeyId->keyId, authKeyId->keyIdLen) %
+         trustStore->numBuckets;
+
+      //Walk through the hash chain
+      for(i = trustStore->keyIdBuckets[h]; i != TLS_TRUST_STORE_INVALID_INDEX &&
+         error == ERROR_UNKNOWN_CA; i = trustStore->cas[i].nextByKeyId)
+      {
+         //Point to the current CA certificate
+         caCertInfo = &trustStore->cas[i].certInfo;
+
+         //Matching subject key identifier?
+         if(caCertInfo->tbsCert.extensions.subjectKeyId.length == authKeyId->keyIdLen &&
+            !memcmp(caCertInfo->tbsCert.extensions.subjectKeyId.value,
+            authKeyId->keyId, authKeyId->keyIdLen))
+         {
+            //Validate the certificate with the current CA
+            error = tlsCheckTrustedCa(cache, caCertInfo, certInfo, pathLen,
+               subjectName);
+         }
+      }
+   }
+
+   //Fall back to the subject name index if necessary
+   if(error == ERROR_UNKNOWN_CA)
+   {
+      //Point to the issuer of the certificate
+      issuer = &certInfo->tbsCert.issuer;
+
+      //Select the relevant hash chain
+      h = tlsComputeIndexHash(issuer->rawData, issuer->rawDataLen) %
+         trustStore->numBuckets;
+
+      //Walk through the hash chain
+      for(i = trustStore->subjectBuckets[h]; i != TLS_TRUST_STORE_INVALID_INDEX &&
+         error == ERROR_UNKNOWN_CA; i = trustStore->cas[i].nextBySubject)
+      {
+         //Point to the current CA certificate
+         caCertInfo = &trustStore->cas[i].certInfo;
+
+         //Matching subject name?
+         if(x509CompareName(caCertInfo->tbsCert.subject.rawData,
+            caCertInfo->tbsCert.subject.rawDataLen, issuer->rawData,
+            issuer->rawDataLen))
+         {
+            //Validate the certificate with the current CA
+            error = tlsCheckTrustedCa(cache, caCertInfo, certInfo, pathLen,
+               subjectName);
+         }
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Verify certificate against a given trusted CA
+ * @param[in] cache Certificate verification cache (optional parameter)
+ * @param[in] caCertInfo Trusted CA certificate
+ * @param[in] certInfo Certificate to be verified
+ * @param[in] pathLen Certificate path length
+ * @param[in] subjectName Subject name (optional parameter)
+ * @return Error code
+ **/
+
+error_t tlsCheckTrustedCa(TlsCertVerifyCache *cache,
+   const X509CertificateInfo *caCertInfo, const X509CertificateInfo *certInfo,
+   uint_t pathLen, const char_t *subjectName)
+{
+   error_t error;
+
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   //Validate the certificate with the current CA (the signature is not
+   //checked again if the pair is found in the verification cache)
+   error = tlsValidateCertificateCached(cache, certInfo, caCertInfo, pathLen);
+#else
+   //Validate the certificate with the current CA
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+   error = x509ValidateCertificate(certInfo, caCertInfo, pathLen);
+#endif
+
+   //Check status code
+   if(!error)
+   {
+      //Check name constraints
+      error = x509CheckNameConstraints(subjectName, caCertInfo);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //The certificate is issued by a trusted CA
+      error = NO_ERROR;
+   }
+   else
+   {
+      //The certificate cannot be matched with the current CA
+      error = ERROR_UNKNOWN_CA;
+   }
+
+   //Return status code
+   return error;
+}
+
+#endif
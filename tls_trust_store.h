@@ -0,0 +1,64 @@
+/**
+ * @file tls_trust_store.h
+ * @brief Trusted CA store
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_TRUST_STORE_H
+#define _TLS_TRUST_STORE_H
+
+//Dependencies
+#include "tls.h"
+
+//Invalid index in hash chains
+#define TLS_TRUST_STORE_INVALID_INDEX ((uint_t) -1)
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Trusted CA store management
+TlsTrustStore *tlsInitTrustStore(const char_t *trustedCaList, size_t length);
+
+TlsTrustStore *tlsReferenceTrustStore(TlsTrustStore *trustStore);
+void tlsFreeTrustStore(TlsTrustStore *trustStore);
+
+error_t tlsValidateWithTrustStore(const TlsTrustStore *trustStore,
+   TlsCertVerifyCache *cache, const X509CertificateInfo *certInfo,
+   uint_t pathLen, const char_t *subjectName);
+
+error_t tlsCheckTrustedCa(TlsCertVerifyCache *cache,
+   const X509CertificateInfo *caCertInfo, const X509CertificateInfo *certInfo,
+   uint_t pathLen, const char_t *subjectName);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif
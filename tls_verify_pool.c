@@ -0,0 +1,468 @@
+/**
+ * @file tls_verify_pool.c
+ * @brief Parallel verification of certificate chains
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_stats.h"
+#include "tls_verify_pool.h"
+#include "tls_cert_verify_cache.h"
+#include "pkix/x509_cert_validate.h"
+#include "debug.h"
+
+//Check TLS library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_VERIFY_POOL_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Create a verification worker pool
+ *
+ * The pool runs the signature checks of the peer certificate chains on
+ * behalf of any number of TLS contexts. The worker threads are owned by the
+ * application, each of them calling tlsRunVerifyPool in a loop. While the
+ * signatures are being checked, the handshake thread keeps on parsing the
+ * chain, then picks up the jobs no worker has started yet
+ *
+ * @return Handle referencing the newly created pool
+ **/
+
+TlsVerifyPool *tlsInitVerifyPool(void)
+{
+   TlsVerifyPool *verifyPool;
+
+   //Allocate a memory buffer to hold the pool
+   verifyPool = tlsAllocMem(sizeof(TlsVerifyPool));
+   //Failed to allocate memory?
+   if(verifyPool == NULL)
+      return NULL;
+
+   //Clear the pool
+   memset(verifyPool, 0, sizeof(TlsVerifyPool));
+
+   //Create a mutex to prevent simultaneous access to the pool
+   if(!osCreateMutex(&verifyPool->mutex))
+   {
+      //Clean up side effects
+      tlsFreeMem(verifyPool);
+      //Report an error
+      return NULL;
+   }
+
+   //Create an event object to wake up the worker threads
+   if(!osCreateEvent(&verifyPool->event))
+   {
+      //Clean up side effects
+      osDeleteMutex(&verifyPool->mutex);
+      tlsFreeMem(verifyPool);
+      //Report an error
+      return NULL;
+   }
+
+   //Return a pointer to the newly created pool
+   return verifyPool;
+}
+
+
+/**
+ * @brief Run the signature checks queued to the pool
+ *
+ * This function is intended to be called in a loop by each worker thread.
+ * It waits until jobs are queued (or the timeout elapses), then processes
+ * them until the queue is empty. Another worker is woken up whenever a job
+ * is left behind, so that the checks of a chain run side by side
+ *
+ * @param[in] verifyPool Pointer to the pool
+ * @param[in] timeout Maximum time to wait for a job
+ * @return Error code
+ **/
+
+error_t tlsRunVerifyPool(TlsVerifyPool *verifyPool, systime_t timeout)
+{
+   bool_t more;
+   TlsVerifyJob *job;
+
+   //Invalid pool?
+   if(verifyPool == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Wait until a job is queued
+   osWaitForEvent(&verifyPool->event, timeout);
+
+   //Process the queued jobs
+   while(1)
+   {
+      //Acquire exclusive access to the pool
+      osAcquireMutex(&verifyPool->mutex);
+
+      //Remove the first job from the queue
+      job = verifyPool->queue;
+
+      //Any job pending?
+      if(job != NULL)
+      {
+         verifyPool->queue = job->next;
+         verifyPool->jobCount++;
+      }
+
+      //Check whether other jobs are waiting
+      more = (verifyPool->queue != NULL) ? TRUE : FALSE;
+
+      //Release exclusive access to the pool
+      osReleaseMutex(&verifyPool->mutex);
+
+      //The queue is empty?
+      if(job == NULL)
+         break;
+
+      //Hand the remaining jobs over to another worker thread
+      if(more)
+      {
+         osSetEvent(&verifyPool->event);
+      }
+
+      //Check the signature of the certificate
+      tlsProcessVerifyJob(job);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release verification worker pool
+ *
+ * The worker threads must have been stopped and no handshake may be using
+ * the pool anymore
+ *
+ * @param[in] verifyPool Pointer to the pool
+ **/
+
+void tlsFreeVerifyPool(TlsVerifyPool *verifyPool)
+{
+   //Valid pool?
+   if(verifyPool != NULL)
+   {
+      //Release previously allocated resources
+      osDeleteEvent(&verifyPool->event);
+      osDeleteMutex(&verifyPool->mutex);
+
+      //Free previously allocated memory
+      tlsFreeMem(verifyPool);
+   }
+}
+
+
+/**
+ * @brief Start the parallel verification of a certificate chain
+ * @param[in] context Pointer to the TLS context
+ * @param[out] batch Signature checks of the chain
+ * @return Error code
+ **/
+
+error_t tlsInitVerifyBatch(TlsContext *context, TlsVerifyBatch *batch)
+{
+   //No verification worker pool attached to the TLS context?
+   if(context->verifyPool == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //Clear the batch
+   memset(batch, 0, sizeof(TlsVerifyBatch));
+
+   //Create an event object signaling the completion of the jobs
+   if(!osCreateEvent(&batch->event))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Save the verification worker pool
+   batch->pool = context->verifyPool;
+
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   //The workers consult the verification cache before checking a signature
+   batch->cache = context->certVerifyCache;
+#endif
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //The signature checks are charged to the handshake in progress on the
+   //calling thread once the batch is complete
+   batch->counters = tlsHandshakeCounters;
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Queue the signature check of a certificate to the pool
+ *
+ * The certificates are copied to the job. They still reference the DER
+ * encoding of the Certificate message, which must remain available until
+ * tlsCompleteVerifyBatch returns. The certificate is checked synchronously
+ * if the job cannot be allocated
+ *
+ * @param[in] batch Signature checks of the chain
+ * @param[in] certInfo Certificate to be verified
+ * @param[in] issuerCertInfo Issuer certificate
+ * @param[in] pathLen Certificate path length
+ * @return Error code
+ **/
+
+error_t tlsSubmitVerifyJob(TlsVerifyBatch *batch,
+   const X509CertificateInfo *certInfo,
+   const X509CertificateInfo *issuerCertInfo, uint_t pathLen)
+{
+   TlsVerifyJob *job;
+   TlsVerifyJob **p;
+
+   //Allocate a memory buffer to hold the job
+   job = tlsAllocMem(sizeof(TlsVerifyJob));
+
+   //Failed to allocate memory?
+   if(job == NULL)
+   {
+      //Check the signature on the handshake thread
+      return tlsVerifyCertificatePair(batch, certInfo, issuerCertInfo,
+         pathLen);
+   }
+
+   //Format the job
+   memset(job, 0, sizeof(TlsVerifyJob));
+   job->batch = batch;
+   job->certInfo = *certInfo;
+   job->issuerCertInfo = *issuerCertInfo;
+   job->pathLen = pathLen;
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&batch->pool->mutex);
+
+   //Append the job to the queue of the pool
+   for(p = &batch->pool->queue; *p != NULL; p = &(*p)->next);
+   *p = job;
+
+   //Append the job to the chain, so that the results are collected in order
+   for(p = &batch->jobs; *p != NULL; p = &(*p)->batchNext);
+   *p = job;
+
+   //Update the number of pending jobs
+   batch->numPending++;
+
+   //Wake up a worker thread
+   osSetEvent(&batch->pool->event);
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&batch->pool->mutex);
+
+   //The result is collected by tlsCompleteVerifyBatch
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Check the signature of a certificate and post the result
+ * @param[in] job Job removed from the queue of the pool
+ **/
+
+void tlsProcessVerifyJob(TlsVerifyJob *job)
+{
+   error_t status;
+   TlsVerifyBatch *batch;
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   TlsHandshakeCounters *counters;
+#endif
+
+   //Point to the chain the job belongs to
+   batch = job->batch;
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //The counters of the handshake are not thread-safe, so the job is charged
+   //to its own counters
+   counters = tlsStatsEnterCounters(&job->counters);
+#endif
+
+   //Validate the certificate against its issuer
+   status = tlsVerifyCertificatePair(batch, &job->certInfo,
+      &job->issuerCertInfo, job->pathLen);
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+   //Restore the counters of the calling thread
+   tlsStatsLeaveHandshake(counters);
+#endif
+
+   //Acquire exclusive access to the pool
+   osAcquireMutex(&batch->pool->mutex);
+
+   //Save the result of the signature check
+   job->status = status;
+   job->done = TRUE;
+
+   //Update the number of pending jobs
+   batch->numPending--;
+
+   //Notify the handshake thread
+   osSetEvent(&batch->event);
+
+   //Release exclusive access to the pool
+   osReleaseMutex(&batch->pool->mutex);
+}
+
+
+/**
+ * @brief Collect the signature checks of a certificate chain
+ *
+ * The handshake thread runs the jobs no worker has started yet, then waits
+ * for the remaining ones. The failure reported is the one the serial chain
+ * validation would have hit first
+ *
+ * @param[in] batch Signature checks of the chain
+ * @return Error code
+ **/
+
+error_t tlsCompleteVerifyBatch(TlsVerifyBatch *batch)
+{
+   error_t error;
+   uint_t numPending;
+   TlsVerifyJob *job;
+   TlsVerifyJob **p;
+
+   //Wait for all the jobs of the chain
+   while(1)
+   {
+      //Acquire exclusive access to the pool
+      osAcquireMutex(&batch->pool->mutex);
+
+      //Look for a job of the chain that is still queued
+      for(p = &batch->pool->queue; *p != NULL; p = &(*p)->next)
+      {
+         if((*p)->batch == batch)
+            break;
+      }
+
+      //Found?
+      if(*p != NULL)
+      {
+         //Remove the job from the queue of the pool
+         job = *p;
+         *p = job->next;
+         batch->pool->inlineCount++;
+      }
+      else
+      {
+         //No job left to steal
+         job = NULL;
+      }
+
+      //Get the number of pending jobs
+      numPending = batch->numPending;
+
+      //Release exclusive access to the pool
+      osReleaseMutex(&batch->pool->mutex);
+
+      //Run the job on the handshake thread
+      if(job != NULL)
+      {
+         tlsProcessVerifyJob(job);
+      }
+      else if(numPending > 0)
+      {
+         //Wait for the worker threads to complete their jobs
+         osWaitForEvent(&batch->event, INFINITE_DELAY);
+      }
+      else
+      {
+         //All the signature checks have completed
+         break;
+      }
+   }
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Loop through the jobs of the chain
+   while(batch->jobs != NULL)
+   {
+      //Point to the first job
+      job = batch->jobs;
+      batch->jobs = job->batchNext;
+
+      //Report the first failure in chain order
+      if(!error)
+      {
+         error = job->status;
+      }
+
+#if (TLS_HANDSHAKE_ACCOUNTING_SUPPORT == ENABLED)
+      //Charge the resources used by the job to the handshake
+      if(batch->counters != NULL)
+      {
+         tlsStatsMergeCounters(batch->counters, &job->counters);
+      }
+#endif
+
+      //Release the job
+      tlsFreeMem(job);
+   }
+
+   //Release previously allocated resources
+   osDeleteEvent(&batch->event);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Validate a certificate against its issuer
+ * @param[in] batch Signature checks of the chain
+ * @param[in] certInfo Certificate to be verified
+ * @param[in] issuerCertInfo Issuer certificate
+ * @param[in] pathLen Certificate path length
+ * @return Error code
+ **/
+
+error_t tlsVerifyCertificatePair(TlsVerifyBatch *batch,
+   const X509CertificateInfo *certInfo,
+   const X509CertificateInfo *issuerCertInfo, uint_t pathLen)
+{
+#if (TLS_CERT_VERIFY_CACHE_SUPPORT == ENABLED)
+   //The signature is not checked again if the pair is found in the
+   //verification cache
+   return tlsValidateCertificateCached(batch->cache, certInfo,
+      issuerCertInfo, pathLen);
+#else
+   //Check the signature of the certificate
+   TLS_HANDSHAKE_ACCOUNT(publicKeyOps, 1);
+   return x509ValidateCertificate(certInfo, issuerCertInfo, pathLen);
+#endif
+}
+
+#endif
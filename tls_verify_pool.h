@@ -0,0 +1,65 @@
+/**
+ * @file tls_verify_pool.h
+ * @brief Parallel verification of certificate chains
+ *
+ * @section License
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2010-2019 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.9.6
+ **/
+
+#ifndef _TLS_VERIFY_POOL_H
+#define _TLS_VERIFY_POOL_H
+
+//Dependencies
+#include "tls.h"
+
+//C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Verification worker pool management
+TlsVerifyPool *tlsInitVerifyPool(void);
+error_t tlsRunVerifyPool(TlsVerifyPool *verifyPool, systime_t timeout);
+void tlsFreeVerifyPool(TlsVerifyPool *verifyPool);
+
+error_t tlsInitVerifyBatch(TlsContext *context, TlsVerifyBatch *batch);
+
+error_t tlsSubmitVerifyJob(TlsVerifyBatch *batch,
+   const X509CertificateInfo *certInfo,
+   const X509CertificateInfo *issuerCertInfo, uint_t pathLen);
+
+void tlsProcessVerifyJob(TlsVerifyJob *job);
+error_t tlsCompleteVerifyBatch(TlsVerifyBatch *batch);
+
+error_t tlsVerifyCertificatePair(TlsVerifyBatch *batch,
+   const X509CertificateInfo *certInfo,
+   const X509CertificateInfo *issuerCertInfo, uint_t pathLen);
+
+//C++ guard
+#ifdef __cplusplus
+}
+#endif
+
+#endif